@@ -0,0 +1,242 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Measure the speed of adding frames to and retrieving frames from a vtkPlusBuffer,
+// without other threads and while multiple reader threads access the buffer concurrently.
+
+#include "PlusConfigure.h"
+#include "PlusBenchmarkReport.h"
+#include "vtkMultiThreader.h"
+#include "vtkPlusBuffer.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+  const double FRAME_PERIOD_SEC = 0.01;
+
+  //----------------------------------------------------------------------------
+  double GetFrameTimestamp(int frameIndex)
+  {
+    return 1.0 + frameIndex * FRAME_PERIOD_SEC;
+  }
+
+  //----------------------------------------------------------------------------
+  struct ContentionThreadInfoStruct
+  {
+    vtkPlusBuffer* Buffer;
+    std::vector<unsigned char>* FramePixels;
+    int FrameSize[3];
+    int NumberOfFrames;
+    // Set by the writer thread when all the frames are added
+    volatile bool WriterFinished;
+    // Duration of each operation, for each thread
+    std::vector< std::vector<double> > DurationsSec;
+  };
+
+  //----------------------------------------------------------------------------
+  PlusStatus AddFrame(vtkPlusBuffer* buffer, std::vector<unsigned char>& framePixels, const int frameSize[3], int frameIndex)
+  {
+    const int clipRectangleOrigin[3] = {PlusCommon::NO_CLIP, PlusCommon::NO_CLIP, PlusCommon::NO_CLIP};
+    const int clipRectangleSize[3] = {PlusCommon::NO_CLIP, PlusCommon::NO_CLIP, PlusCommon::NO_CLIP};
+    const double timestamp = GetFrameTimestamp(frameIndex);
+    return buffer->AddItem(&framePixels[0], US_IMG_ORIENT_MF, frameSize, VTK_UNSIGNED_CHAR, 1, US_IMG_BRIGHTNESS, 0, frameIndex,
+                           clipRectangleOrigin, clipRectangleSize, timestamp, timestamp);
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Thread 0 adds frames to the buffer, all other threads read the latest frame and a frame at a recent timestamp */
+  VTK_THREAD_RETURN_TYPE ContentionThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    ContentionThreadInfoStruct* info = static_cast<ContentionThreadInfoStruct*>(threadInfo->UserData);
+    std::vector<double>& durationsSec = info->DurationsSec[threadInfo->ThreadID];
+
+    if (threadInfo->ThreadID == 0)
+    {
+      for (int frameIndex = 0; frameIndex < info->NumberOfFrames; ++frameIndex)
+      {
+        double startTime = vtkPlusAccurateTimer::GetSystemTime();
+        AddFrame(info->Buffer, *info->FramePixels, info->FrameSize, frameIndex);
+        durationsSec.push_back(vtkPlusAccurateTimer::GetSystemTime() - startTime);
+      }
+      info->WriterFinished = true;
+      return VTK_THREAD_RETURN_VALUE;
+    }
+
+    StreamBufferItem bufferItem;
+    while (!info->WriterFinished)
+    {
+      double startTime = vtkPlusAccurateTimer::GetSystemTime();
+      if (info->Buffer->GetLatestStreamBufferItem(&bufferItem) == ITEM_OK)
+      {
+        // Get an item that is slightly older than the latest, as it is done when synchronizing video and tracking data
+        info->Buffer->GetStreamBufferItemFromTime(bufferItem.GetFilteredTimestamp(0) - 2.5 * FRAME_PERIOD_SEC, &bufferItem, vtkPlusBuffer::CLOSEST_TIME);
+        durationsSec.push_back(vtkPlusAccurateTimer::GetSystemTime() - startTime);
+      }
+    }
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  //----------------------------------------------------------------------------
+  vtkSmartPointer<vtkPlusBuffer> CreateBuffer(int bufferSize, const int frameSize[3])
+  {
+    vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+    if (buffer->SetBufferSize(bufferSize) != PLUS_SUCCESS
+        || buffer->SetPixelType(VTK_UNSIGNED_CHAR) != PLUS_SUCCESS
+        || buffer->SetNumberOfScalarComponents(1) != PLUS_SUCCESS
+        || buffer->SetImageType(US_IMG_BRIGHTNESS) != PLUS_SUCCESS
+        || buffer->SetImageOrientation(US_IMG_ORIENT_MF) != PLUS_SUCCESS
+        || buffer->SetFrameSize(frameSize[0], frameSize[1], frameSize[2]) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to set up the buffer");
+      return NULL;
+    }
+    return buffer;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  std::string outputFileName;
+  int numberOfFrames = 1000;
+  int bufferSize = 150;
+  int numberOfReaderThreads = 3;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--output-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputFileName, "JSON file to write the results to (default: [benchmark name].json in the output directory)");
+  args.AddArgument("--frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfFrames, "Number of frames added to the buffer in each case (default: 1000)");
+  args.AddArgument("--buffer-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &bufferSize, "Number of items in the buffer (default: 150)");
+  args.AddArgument("--reader-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfReaderThreads, "Number of threads reading the buffer while frames are added (default: 3)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfFrames < 1 || bufferSize < 2 || numberOfReaderThreads < 0)
+  {
+    LOG_ERROR("Invalid arguments: --frames must be positive, --buffer-size must be at least 2, --reader-threads must not be negative");
+    exit(EXIT_FAILURE);
+  }
+
+  PlusBenchmarkReport report("BufferBenchmark");
+  const int frameSizes[][3] = { {640, 480, 1}, {1920, 1080, 1} };
+  for (unsigned int frameSizeIndex = 0; frameSizeIndex < sizeof(frameSizes) / sizeof(frameSizes[0]); ++frameSizeIndex)
+  {
+    const int* frameSize = frameSizes[frameSizeIndex];
+    std::vector<unsigned char> framePixels(frameSize[0] * frameSize[1] * frameSize[2]);
+    for (unsigned int i = 0; i < framePixels.size(); ++i)
+    {
+      framePixels[i] = static_cast<unsigned char>(i);
+    }
+
+    PlusBenchmarkReport::ParameterMapType parameters;
+    parameters["FrameSize"] = PlusCommon::ToString<int>(frameSize[0]) + "x" + PlusCommon::ToString<int>(frameSize[1]);
+    parameters["BufferSize"] = PlusCommon::ToString<int>(bufferSize);
+
+    // Add frames without contention
+    vtkSmartPointer<vtkPlusBuffer> buffer = CreateBuffer(bufferSize, frameSize);
+    if (buffer == NULL)
+    {
+      exit(EXIT_FAILURE);
+    }
+    report.BeginCase("AddItem", parameters, 1, "frames/s");
+    for (int frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+    {
+      report.StartIteration();
+      if (AddFrame(buffer, framePixels, frameSize, frameIndex) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add frame " << frameIndex << " to the buffer");
+        exit(EXIT_FAILURE);
+      }
+      report.StopIteration();
+    }
+    report.LogCaseSummary();
+
+    // Get frames by timestamp without contention
+    report.BeginCase("GetStreamBufferItemFromTime", parameters, 1, "frames/s");
+    StreamBufferItem bufferItem;
+    const int firstFrameInBuffer = std::max(0, numberOfFrames - bufferSize + 1);
+    for (int i = 0; i < numberOfFrames; ++i)
+    {
+      const int frameIndex = firstFrameInBuffer + i % (numberOfFrames - firstFrameInBuffer);
+      report.StartIteration();
+      if (buffer->GetStreamBufferItemFromTime(GetFrameTimestamp(frameIndex), &bufferItem, vtkPlusBuffer::EXACT_TIME) != ITEM_OK)
+      {
+        LOG_ERROR("Failed to get frame " << frameIndex << " from the buffer");
+        exit(EXIT_FAILURE);
+      }
+      report.StopIteration();
+    }
+    report.LogCaseSummary();
+
+    // Add and get frames concurrently
+    buffer = CreateBuffer(bufferSize, frameSize);
+    if (buffer == NULL)
+    {
+      exit(EXIT_FAILURE);
+    }
+    ContentionThreadInfoStruct info;
+    info.Buffer = buffer;
+    info.FramePixels = &framePixels;
+    std::copy(frameSize, frameSize + 3, info.FrameSize);
+    info.NumberOfFrames = numberOfFrames;
+    info.WriterFinished = false;
+    info.DurationsSec.resize(1 + numberOfReaderThreads);
+
+    vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+    threader->SetNumberOfThreads(1 + numberOfReaderThreads);
+    threader->SetSingleMethod(ContentionThreadFunction, &info);
+    threader->SingleMethodExecute();
+
+    parameters["ReaderThreads"] = PlusCommon::ToString<int>(numberOfReaderThreads);
+    report.BeginCase("AddItemWithConcurrentReaders", parameters, 1, "frames/s");
+    for (std::vector<double>::iterator it = info.DurationsSec[0].begin(); it != info.DurationsSec[0].end(); ++it)
+    {
+      report.AddIteration(*it);
+    }
+    report.LogCaseSummary();
+    if (numberOfReaderThreads > 0)
+    {
+      report.BeginCase("GetLatestItemWithConcurrentWriter", parameters, 1, "frames/s");
+      for (int threadIndex = 1; threadIndex <= numberOfReaderThreads; ++threadIndex)
+      {
+        for (std::vector<double>::iterator it = info.DurationsSec[threadIndex].begin(); it != info.DurationsSec[threadIndex].end(); ++it)
+        {
+          report.AddIteration(*it);
+        }
+      }
+      report.LogCaseSummary();
+    }
+  }
+
+  if (report.WriteJsonToFile(outputFileName) != PLUS_SUCCESS)
+  {
+    exit(EXIT_FAILURE);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,279 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Measure the speed of packing tracked frames into OpenIGTLink messages and sending them
+// to a client that is connected through the loopback interface.
+
+#include "PlusConfigure.h"
+#include "PlusBenchmarkReport.h"
+#include "PlusIgtlClientInfo.h"
+#include "PlusTrackedFrame.h"
+#include "igtlClientSocket.h"
+#include "igtlMessageHeader.h"
+#include "igtlServerSocket.h"
+#include "vtkMultiThreader.h"
+#include "vtkPlusIgtlMessageFactory.h"
+#include "vtkPlusTransformRepository.h"
+#include "vtkSmartPointer.h"
+#include "vtkTransform.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <vector>
+
+namespace
+{
+  const int SOCKET_TIMEOUT_MSEC = 5000;
+
+  //----------------------------------------------------------------------------
+  struct ReceiverThreadInfoStruct
+  {
+    igtl::ClientSocket::Pointer Socket;
+    vtkPlusIgtlMessageFactory* MessageFactory;
+    int NumberOfExpectedMessages;
+    int NumberOfReceivedMessages;
+    double NumberOfReceivedBytes;
+    bool ReceiveFailed;
+  };
+
+  //----------------------------------------------------------------------------
+  /*! Receive messages (as an OpenIGTLink client would) until the expected number of messages arrive */
+  void* ReceiverThread(vtkMultiThreader::ThreadInfo* data)
+  {
+    ReceiverThreadInfoStruct* info = static_cast<ReceiverThreadInfoStruct*>(data->UserData);
+    igtl::MessageHeader::Pointer headerMsg = info->MessageFactory->CreateHeaderMessage(IGTL_HEADER_VERSION_1);
+    while (info->NumberOfReceivedMessages < info->NumberOfExpectedMessages)
+    {
+      headerMsg->InitBuffer();
+      if (info->Socket->Receive(headerMsg->GetBufferPointer(), headerMsg->GetBufferSize()) != headerMsg->GetBufferSize())
+      {
+        info->ReceiveFailed = true;
+        break;
+      }
+      headerMsg->Unpack();
+      info->Socket->Skip(headerMsg->GetBodySizeToRead(), 0);
+      info->NumberOfReceivedBytes += headerMsg->GetBufferSize() + headerMsg->GetBodySizeToRead();
+      ++info->NumberOfReceivedMessages;
+    }
+    return NULL;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Create a frame with a B-mode like image and the transforms of a tracked ultrasound setup */
+  PlusStatus CreateTrackedFrame(PlusTrackedFrame& trackedFrame, const int frameSize[3])
+  {
+    if (trackedFrame.GetImageData()->AllocateFrame(frameSize, VTK_UNSIGNED_CHAR, 1) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to allocate frame");
+      return PLUS_FAIL;
+    }
+    trackedFrame.GetImageData()->SetImageOrientation(US_IMG_ORIENT_MF);
+    trackedFrame.GetImageData()->SetImageType(US_IMG_BRIGHTNESS);
+    unsigned char* pixel = static_cast<unsigned char*>(trackedFrame.GetImageData()->GetScalarPointer());
+    for (int y = 0; y < frameSize[1]; ++y)
+    {
+      for (int x = 0; x < frameSize[0]; ++x)
+      {
+        *(pixel++) = static_cast<unsigned char>((x / 8 + y / 16) % 64 + (rand() % 16));
+      }
+    }
+
+    vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
+    const char* transformFromNames[] = { "Image", "Probe", "Stylus" };
+    const char* transformToNames[] = { "Reference", "Reference", "Reference" };
+    for (int i = 0; i < 3; ++i)
+    {
+      PlusTransformName transformName(transformFromNames[i], transformToNames[i]);
+      transform->Translate(10, 20, 30);
+      transform->RotateZ(5);
+      trackedFrame.SetCustomFrameTransform(transformName, transform->GetMatrix());
+      trackedFrame.SetCustomFrameTransformStatus(transformName, FIELD_OK);
+    }
+    trackedFrame.SetTimestamp(1.0);
+    return PLUS_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  std::string outputFileName;
+  int numberOfFrames = 200;
+  int port = 18950;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--output-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputFileName, "JSON file to write the results to (default: [benchmark name].json in the output directory)");
+  args.AddArgument("--frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfFrames, "Number of frames sent in each case (default: 200)");
+  args.AddArgument("--port", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &port, "Loopback port used for the connection (default: 18950)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfFrames < 1)
+  {
+    LOG_ERROR("Invalid arguments: --frames must be positive");
+    exit(EXIT_FAILURE);
+  }
+
+  // Connect a client to a server socket through the loopback interface
+  igtl::ServerSocket::Pointer serverSocket = igtl::ServerSocket::New();
+  if (serverSocket->CreateServer(port) != 0)
+  {
+    LOG_ERROR("Failed to create server socket on port " << port);
+    exit(EXIT_FAILURE);
+  }
+  igtl::ClientSocket::Pointer receiverSocket = igtl::ClientSocket::New();
+  if (receiverSocket->ConnectToServer("127.0.0.1", port) != 0)
+  {
+    LOG_ERROR("Failed to connect to the server socket on port " << port);
+    exit(EXIT_FAILURE);
+  }
+  igtl::ClientSocket::Pointer senderSocket = serverSocket->WaitForConnection(SOCKET_TIMEOUT_MSEC);
+  if (senderSocket.IsNull())
+  {
+    LOG_ERROR("Client connection was not accepted on port " << port);
+    exit(EXIT_FAILURE);
+  }
+  receiverSocket->SetReceiveTimeout(SOCKET_TIMEOUT_MSEC);
+  senderSocket->SetSendTimeout(SOCKET_TIMEOUT_MSEC);
+
+  const int frameSize[3] = {640, 480, 1};
+  PlusTrackedFrame trackedFrame;
+  if (CreateTrackedFrame(trackedFrame, frameSize) != PLUS_SUCCESS)
+  {
+    exit(EXIT_FAILURE);
+  }
+
+  vtkSmartPointer<vtkPlusIgtlMessageFactory> messageFactory = vtkSmartPointer<vtkPlusIgtlMessageFactory>::New();
+  vtkSmartPointer<vtkPlusTransformRepository> transformRepository = vtkSmartPointer<vtkPlusTransformRepository>::New();
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+
+  // Image stream with embedded transform, and tracking data only
+  PlusIgtlClientInfo imageClientInfo;
+  imageClientInfo.IgtlMessageTypes.push_back("IMAGE");
+  PlusIgtlClientInfo::ImageStream imageStream;
+  imageStream.Name = "Image";
+  imageStream.EmbeddedTransformToFrame = "Reference";
+  imageClientInfo.ImageStreams.push_back(imageStream);
+  PlusIgtlClientInfo transformClientInfo;
+  transformClientInfo.IgtlMessageTypes.push_back("TRANSFORM");
+  transformClientInfo.TransformNames.push_back(PlusTransformName("Probe", "Reference"));
+  transformClientInfo.TransformNames.push_back(PlusTransformName("Stylus", "Reference"));
+  const PlusIgtlClientInfo* clientInfos[] = { &imageClientInfo, &transformClientInfo };
+  const char* messageTypeNames[] = { "IMAGE", "TRANSFORM" };
+
+  PlusBenchmarkReport report("IgtlLoopbackBenchmark");
+  for (int clientInfoIndex = 0; clientInfoIndex < 2; ++clientInfoIndex)
+  {
+    const PlusIgtlClientInfo& clientInfo = *clientInfos[clientInfoIndex];
+    std::vector<igtl::MessageBase::Pointer> igtlMessages;
+    if (messageFactory->PackMessages(clientInfo, igtlMessages, trackedFrame, true, transformRepository) != PLUS_SUCCESS || igtlMessages.empty())
+    {
+      LOG_ERROR("Failed to pack " << messageTypeNames[clientInfoIndex] << " messages");
+      exit(EXIT_FAILURE);
+    }
+    const int messagesPerFrame = igtlMessages.size();
+
+    ReceiverThreadInfoStruct receiverInfo;
+    receiverInfo.Socket = receiverSocket;
+    receiverInfo.MessageFactory = messageFactory;
+    receiverInfo.NumberOfExpectedMessages = numberOfFrames * messagesPerFrame;
+    receiverInfo.NumberOfReceivedMessages = 0;
+    receiverInfo.NumberOfReceivedBytes = 0;
+    receiverInfo.ReceiveFailed = false;
+    const int receiverThreadId = threader->SpawnThread((vtkThreadFunctionType)&ReceiverThread, &receiverInfo);
+
+    std::vector<double> packDurationsSec;
+    std::vector<double> sendDurationsSec;
+    const double startTime = vtkPlusAccurateTimer::GetSystemTime();
+    for (int frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+    {
+      trackedFrame.SetTimestamp(1.0 + frameIndex * 0.01);
+      double packStartTime = vtkPlusAccurateTimer::GetSystemTime();
+      igtlMessages.clear();
+      if (messageFactory->PackMessages(clientInfo, igtlMessages, trackedFrame, true, transformRepository) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to pack " << messageTypeNames[clientInfoIndex] << " messages");
+        exit(EXIT_FAILURE);
+      }
+      double sendStartTime = vtkPlusAccurateTimer::GetSystemTime();
+      packDurationsSec.push_back(sendStartTime - packStartTime);
+      for (std::vector<igtl::MessageBase::Pointer>::iterator it = igtlMessages.begin(); it != igtlMessages.end(); ++it)
+      {
+        if (senderSocket->Send((*it)->GetBufferPointer(), (*it)->GetBufferSize()) == 0)
+        {
+          LOG_ERROR("Failed to send " << messageTypeNames[clientInfoIndex] << " message");
+          exit(EXIT_FAILURE);
+        }
+      }
+      sendDurationsSec.push_back(vtkPlusAccurateTimer::GetSystemTime() - sendStartTime);
+    }
+    // Terminating the thread waits until the receiver gets all the messages
+    threader->TerminateThread(receiverThreadId);
+    const double totalDurationSec = vtkPlusAccurateTimer::GetSystemTime() - startTime;
+    if (receiverInfo.ReceiveFailed)
+    {
+      LOG_ERROR("Failed to receive " << messageTypeNames[clientInfoIndex] << " messages, received "
+                << receiverInfo.NumberOfReceivedMessages << " of " << receiverInfo.NumberOfExpectedMessages);
+      exit(EXIT_FAILURE);
+    }
+
+    PlusBenchmarkReport::ParameterMapType parameters;
+    parameters["MessageType"] = messageTypeNames[clientInfoIndex];
+    parameters["MessagesPerFrame"] = PlusCommon::ToString<int>(messagesPerFrame);
+    parameters["BytesPerFrame"] = PlusCommon::ToString<double>(receiverInfo.NumberOfReceivedBytes / numberOfFrames);
+    if (clientInfoIndex == 0)
+    {
+      parameters["FrameSize"] = PlusCommon::ToString<int>(frameSize[0]) + "x" + PlusCommon::ToString<int>(frameSize[1]);
+    }
+
+    report.BeginCase("PackMessages", parameters, 1, "frames/s");
+    for (std::vector<double>::iterator it = packDurationsSec.begin(); it != packDurationsSec.end(); ++it)
+    {
+      report.AddIteration(*it);
+    }
+    report.LogCaseSummary();
+
+    report.BeginCase("Send", parameters, 1, "frames/s");
+    for (std::vector<double>::iterator it = sendDurationsSec.begin(); it != sendDurationsSec.end(); ++it)
+    {
+      report.AddIteration(*it);
+    }
+    report.LogCaseSummary();
+
+    // From the first packed frame until the last message is received
+    report.BeginCase("LoopbackThroughput", parameters, numberOfFrames, "frames/s");
+    report.AddIteration(totalDurationSec);
+    report.LogCaseSummary();
+  }
+
+  senderSocket->CloseSocket();
+  receiverSocket->CloseSocket();
+  serverSocket->CloseSocket();
+
+  if (report.WriteJsonToFile(outputFileName) != PLUS_SUCCESS)
+  {
+    exit(EXIT_FAILURE);
+  }
+  return EXIT_SUCCESS;
+}
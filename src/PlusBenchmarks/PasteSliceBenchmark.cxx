@@ -0,0 +1,151 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Measure the speed of inserting slices into a volume with vtkPlusPasteSliceIntoVolume
+// at each optimization level, for nearest neighbor and linear interpolation.
+
+#include "PlusConfigure.h"
+#include "PlusBenchmarkReport.h"
+#include "PlusVideoFrame.h"
+#include "vtkImageData.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusPasteSliceIntoVolume.h"
+#include "vtkSmartPointer.h"
+#include "vtkTransform.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /*! Pixel (i,j) of slice k is at position (0.3*i, 0.3*j, 10+80*k/numberOfSlices) mm, slightly tilted around the X axis */
+  void GetSliceToReferenceTransform(int sliceIndex, int numberOfSlices, vtkMatrix4x4* imageToReference)
+  {
+    vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
+    transform->Translate(2.0, 10.0, 10.0 + 80.0 * sliceIndex / numberOfSlices);
+    transform->RotateX(-60.0 + 30.0 * sliceIndex / numberOfSlices);
+    transform->Scale(0.3, 0.3, 0.3);
+    imageToReference->DeepCopy(transform->GetMatrix());
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  std::string outputFileName;
+  int numberOfSlices = 100;
+  int numberOfThreads = 0;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--output-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputFileName, "JSON file to write the results to (default: [benchmark name].json in the output directory)");
+  args.AddArgument("--slices", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfSlices, "Number of slices inserted in each case (default: 100)");
+  args.AddArgument("--threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of threads used for pasting slices, 0 means number of processors (default: 0)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfSlices < 1 || numberOfThreads < 0)
+  {
+    LOG_ERROR("Invalid arguments: --slices must be positive, --threads must not be negative");
+    exit(EXIT_FAILURE);
+  }
+
+  // Synthetic B-mode like image
+  const int sliceSize[3] = {320, 240, 1};
+  vtkSmartPointer<vtkImageData> slice = vtkSmartPointer<vtkImageData>::New();
+  if (PlusVideoFrame::AllocateFrame(slice, sliceSize, VTK_UNSIGNED_CHAR, 1) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to allocate slice");
+    exit(EXIT_FAILURE);
+  }
+  unsigned char* pixel = static_cast<unsigned char*>(slice->GetScalarPointer());
+  for (int y = 0; y < sliceSize[1]; ++y)
+  {
+    for (int x = 0; x < sliceSize[0]; ++x)
+    {
+      *(pixel++) = static_cast<unsigned char>(1 + (x / 10 + y / 10) % 200 + rand() % 50);
+    }
+  }
+
+  const vtkPlusPasteSliceIntoVolume::OptimizationType optimizations[] =
+  {
+    vtkPlusPasteSliceIntoVolume::NO_OPTIMIZATION,
+    vtkPlusPasteSliceIntoVolume::PARTIAL_OPTIMIZATION,
+    vtkPlusPasteSliceIntoVolume::FULL_OPTIMIZATION
+  };
+  const vtkPlusPasteSliceIntoVolume::InterpolationType interpolations[] =
+  {
+    vtkPlusPasteSliceIntoVolume::NEAREST_NEIGHBOR_INTERPOLATION,
+    vtkPlusPasteSliceIntoVolume::LINEAR_INTERPOLATION
+  };
+
+  PlusBenchmarkReport report("PasteSliceBenchmark");
+  vtkSmartPointer<vtkMatrix4x4> imageToReference = vtkSmartPointer<vtkMatrix4x4>::New();
+  for (unsigned int interpolationIndex = 0; interpolationIndex < sizeof(interpolations) / sizeof(interpolations[0]); ++interpolationIndex)
+  {
+    for (unsigned int optimizationIndex = 0; optimizationIndex < sizeof(optimizations) / sizeof(optimizations[0]); ++optimizationIndex)
+    {
+      vtkSmartPointer<vtkPlusPasteSliceIntoVolume> reconstructor = vtkSmartPointer<vtkPlusPasteSliceIntoVolume>::New();
+      reconstructor->SetOutputOrigin(0, 0, 0);
+      reconstructor->SetOutputSpacing(0.5, 0.5, 0.5);
+      reconstructor->SetOutputExtent(0, 199, 0, 199, 0, 199);
+      reconstructor->SetInterpolationMode(interpolations[interpolationIndex]);
+      reconstructor->SetOptimization(optimizations[optimizationIndex]);
+      reconstructor->SetCompoundingMode(vtkPlusPasteSliceIntoVolume::MEAN_COMPOUNDING_MODE);
+      reconstructor->SetNumberOfThreads(numberOfThreads);
+      if (reconstructor->ResetOutput() != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to allocate the output volume");
+        exit(EXIT_FAILURE);
+      }
+
+      PlusBenchmarkReport::ParameterMapType parameters;
+      parameters["Optimization"] = reconstructor->GetOptimizationModeAsString(optimizations[optimizationIndex]);
+      parameters["Interpolation"] = reconstructor->GetInterpolationModeAsString(interpolations[interpolationIndex]);
+      parameters["Compounding"] = reconstructor->GetCompoundingModeAsString(vtkPlusPasteSliceIntoVolume::MEAN_COMPOUNDING_MODE);
+      parameters["SliceSize"] = PlusCommon::ToString<int>(sliceSize[0]) + "x" + PlusCommon::ToString<int>(sliceSize[1]);
+      parameters["VolumeSize"] = "200x200x200";
+      parameters["Threads"] = PlusCommon::ToString<int>(numberOfThreads);
+
+      report.BeginCase("InsertSlice", parameters, 1, "slices/s");
+      for (int sliceIndex = 0; sliceIndex < numberOfSlices; ++sliceIndex)
+      {
+        GetSliceToReferenceTransform(sliceIndex, numberOfSlices, imageToReference);
+        report.StartIteration();
+        if (reconstructor->InsertSlice(slice, imageToReference) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to insert slice " << sliceIndex);
+          exit(EXIT_FAILURE);
+        }
+        report.StopIteration();
+      }
+      report.LogCaseSummary();
+    }
+  }
+
+  if (report.WriteJsonToFile(outputFileName) != PLUS_SUCCESS)
+  {
+    exit(EXIT_FAILURE);
+  }
+  return EXIT_SUCCESS;
+}
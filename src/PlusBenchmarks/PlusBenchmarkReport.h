@@ -0,0 +1,251 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusBenchmarkReport_h
+#define __PlusBenchmarkReport_h
+
+#include "PlusConfigure.h"
+#include "PlusCommon.h"
+#include "vtkPlusAccurateTimer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <string>
+#include <vector>
+
+/*!
+\class PlusBenchmarkReport
+\brief Collects timing results of a benchmark and writes them in JSON format
+
+Each benchmark executable measures a number of cases. For each case the duration of every
+iteration is recorded (see StartIteration/StopIteration or AddIteration), and the summary
+statistics (mean, min, max, median, 99th percentile, throughput) are written by WriteJson.
+
+The output is a single JSON object:
+\verbatim
+{
+  "benchmark": "BufferBenchmark",
+  "plusVersion": "...",
+  "cases": [
+    { "name": "AddItem", "parameters": { "FrameSize": "640x480" }, "iterations": 100,
+      "meanMs": 0.12, "minMs": 0.1, "maxMs": 0.3, "p50Ms": 0.11, "p99Ms": 0.29,
+      "itemsPerIteration": 1, "throughput": 8333.3, "throughputUnit": "frames/s" }
+  ]
+}
+\endverbatim
+
+\ingroup PlusLibBenchmarks
+*/
+class PlusBenchmarkReport
+{
+public:
+  typedef std::map<std::string, std::string> ParameterMapType;
+
+  PlusBenchmarkReport(const std::string& benchmarkName)
+    : BenchmarkName(benchmarkName)
+    , IterationStartTime(0)
+  {
+  }
+
+  /*!
+    Start a new benchmark case. Iterations are added to this case until the next BeginCase call.
+    \param itemsPerIteration Number of processed items (frames, messages, ...) in one iteration, used for computing throughput
+    \param throughputUnit Unit of the throughput value (e.g., frames/s)
+  */
+  void BeginCase(const std::string& name, const ParameterMapType& parameters, double itemsPerIteration, const std::string& throughputUnit)
+  {
+    CaseType newCase;
+    newCase.Name = name;
+    newCase.Parameters = parameters;
+    newCase.ItemsPerIteration = itemsPerIteration;
+    newCase.ThroughputUnit = throughputUnit;
+    this->Cases.push_back(newCase);
+  }
+
+  /*! Start measuring the time of one iteration of the current case */
+  void StartIteration()
+  {
+    this->IterationStartTime = vtkPlusAccurateTimer::GetSystemTime();
+  }
+
+  /*! Stop measuring the time of one iteration and add it to the current case */
+  void StopIteration()
+  {
+    this->AddIteration(vtkPlusAccurateTimer::GetSystemTime() - this->IterationStartTime);
+  }
+
+  /*! Add an iteration with a duration that was measured by the caller */
+  void AddIteration(double durationSec)
+  {
+    if (this->Cases.empty())
+    {
+      LOG_ERROR("PlusBenchmarkReport::AddIteration failed: BeginCase has not been called");
+      return;
+    }
+    this->Cases.back().DurationsSec.push_back(durationSec);
+  }
+
+  /*! Log a short summary of the current case */
+  void LogCaseSummary() const
+  {
+    if (this->Cases.empty())
+    {
+      return;
+    }
+    const CaseType& currentCase = this->Cases.back();
+    CaseStatistics stats = ComputeStatistics(currentCase);
+    std::ostringstream parameters;
+    for (ParameterMapType::const_iterator it = currentCase.Parameters.begin(); it != currentCase.Parameters.end(); ++it)
+    {
+      parameters << " " << it->first << "=" << it->second;
+    }
+    LOG_INFO(this->BenchmarkName << " " << currentCase.Name << parameters.str() << ": "
+             << std::fixed << std::setprecision(3) << "mean " << stats.MeanSec * 1000 << " ms, p99 " << stats.P99Sec * 1000 << " ms, "
+             << std::setprecision(1) << stats.Throughput << " " << currentCase.ThroughputUnit);
+  }
+
+  /*! Write all results as a JSON object */
+  void WriteJson(std::ostream& os) const
+  {
+    os << "{" << std::endl;
+    os << "  \"benchmark\": \"" << EscapeJsonString(this->BenchmarkName) << "\"," << std::endl;
+    os << "  \"plusVersion\": \"" << EscapeJsonString(PlusCommon::GetPlusLibVersionString()) << "\"," << std::endl;
+    os << "  \"cases\": [";
+    for (std::vector<CaseType>::const_iterator caseIt = this->Cases.begin(); caseIt != this->Cases.end(); ++caseIt)
+    {
+      CaseStatistics stats = ComputeStatistics(*caseIt);
+      os << (caseIt == this->Cases.begin() ? "" : ",") << std::endl;
+      os << "    {" << std::endl;
+      os << "      \"name\": \"" << EscapeJsonString(caseIt->Name) << "\"," << std::endl;
+      os << "      \"parameters\": {";
+      for (ParameterMapType::const_iterator paramIt = caseIt->Parameters.begin(); paramIt != caseIt->Parameters.end(); ++paramIt)
+      {
+        os << (paramIt == caseIt->Parameters.begin() ? " " : ", ")
+           << "\"" << EscapeJsonString(paramIt->first) << "\": \"" << EscapeJsonString(paramIt->second) << "\"";
+      }
+      os << (caseIt->Parameters.empty() ? "" : " ") << "}," << std::endl;
+      os << std::setprecision(9);
+      os << "      \"iterations\": " << caseIt->DurationsSec.size() << "," << std::endl;
+      os << "      \"meanMs\": " << stats.MeanSec * 1000 << "," << std::endl;
+      os << "      \"minMs\": " << stats.MinSec * 1000 << "," << std::endl;
+      os << "      \"maxMs\": " << stats.MaxSec * 1000 << "," << std::endl;
+      os << "      \"p50Ms\": " << stats.P50Sec * 1000 << "," << std::endl;
+      os << "      \"p99Ms\": " << stats.P99Sec * 1000 << "," << std::endl;
+      os << "      \"itemsPerIteration\": " << caseIt->ItemsPerIteration << "," << std::endl;
+      os << "      \"throughput\": " << stats.Throughput << "," << std::endl;
+      os << "      \"throughputUnit\": \"" << EscapeJsonString(caseIt->ThroughputUnit) << "\"" << std::endl;
+      os << "    }";
+    }
+    os << std::endl << "  ]" << std::endl;
+    os << "}" << std::endl;
+  }
+
+  /*!
+    Write all results to a JSON file. If the file name is empty then the results are written to
+    [BenchmarkName].json in the output directory (not to the standard output, where the log messages would mix with the results).
+  */
+  PlusStatus WriteJsonToFile(const std::string& requestedFileName) const
+  {
+    std::string fileName = requestedFileName;
+    if (fileName.empty())
+    {
+      fileName = vtkPlusConfig::GetInstance()->GetOutputPath(this->BenchmarkName + ".json");
+    }
+    std::ofstream outputFile(fileName.c_str());
+    if (!outputFile.is_open())
+    {
+      LOG_ERROR("Failed to open benchmark result file for writing: " << fileName);
+      return PLUS_FAIL;
+    }
+    this->WriteJson(outputFile);
+    LOG_INFO("Benchmark results written to " << fileName);
+    return PLUS_SUCCESS;
+  }
+
+protected:
+  struct CaseType
+  {
+    std::string Name;
+    ParameterMapType Parameters;
+    double ItemsPerIteration;
+    std::string ThroughputUnit;
+    std::vector<double> DurationsSec;
+  };
+
+  struct CaseStatistics
+  {
+    CaseStatistics() : MeanSec(0), MinSec(0), MaxSec(0), P50Sec(0), P99Sec(0), Throughput(0) {}
+    double MeanSec;
+    double MinSec;
+    double MaxSec;
+    double P50Sec;
+    double P99Sec;
+    double Throughput;
+  };
+
+  //----------------------------------------------------------------------------
+  static CaseStatistics ComputeStatistics(const CaseType& benchmarkCase)
+  {
+    CaseStatistics stats;
+    if (benchmarkCase.DurationsSec.empty())
+    {
+      return stats;
+    }
+    std::vector<double> sortedDurationsSec = benchmarkCase.DurationsSec;
+    std::sort(sortedDurationsSec.begin(), sortedDurationsSec.end());
+    double sumSec = 0;
+    for (std::vector<double>::const_iterator it = sortedDurationsSec.begin(); it != sortedDurationsSec.end(); ++it)
+    {
+      sumSec += *it;
+    }
+    const size_t numberOfIterations = sortedDurationsSec.size();
+    stats.MeanSec = sumSec / numberOfIterations;
+    stats.MinSec = sortedDurationsSec.front();
+    stats.MaxSec = sortedDurationsSec.back();
+    stats.P50Sec = sortedDurationsSec[(numberOfIterations - 1) / 2];
+    stats.P99Sec = sortedDurationsSec[((numberOfIterations - 1) * 99) / 100];
+    stats.Throughput = (sumSec > 0) ? benchmarkCase.ItemsPerIteration * numberOfIterations / sumSec : 0;
+    return stats;
+  }
+
+  //----------------------------------------------------------------------------
+  static std::string EscapeJsonString(const std::string& str)
+  {
+    std::string escaped;
+    for (std::string::const_iterator it = str.begin(); it != str.end(); ++it)
+    {
+      switch (*it)
+      {
+        case '"':
+          escaped += "\\\"";
+          break;
+        case '\\':
+          escaped += "\\\\";
+          break;
+        case '\n':
+          escaped += "\\n";
+          break;
+        case '\r':
+          escaped += "\\r";
+          break;
+        case '\t':
+          escaped += "\\t";
+          break;
+        default:
+          escaped += *it;
+      }
+    }
+    return escaped;
+  }
+
+  std::string BenchmarkName;
+  std::vector<CaseType> Cases;
+  double IterationStartTime;
+};
+
+#endif
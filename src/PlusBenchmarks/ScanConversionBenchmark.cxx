@@ -0,0 +1,152 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Measure the speed of scan conversion of brightness scanlines for linear and curvilinear transducers.
+
+#include "PlusConfigure.h"
+#include "PlusBenchmarkReport.h"
+#include "PlusVideoFrame.h"
+#include "vtkImageData.h"
+#include "vtkPlusUsScanConvertCurvilinear.h"
+#include "vtkPlusUsScanConvertLinear.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLDataElement.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  vtkSmartPointer<vtkPlusUsScanConvert> CreateScanConverter(const std::string& transducerGeometry)
+  {
+    vtkSmartPointer<vtkXMLDataElement> scanConversionElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    scanConversionElement->SetName("ScanConversion");
+    scanConversionElement->SetAttribute("TransducerGeometry", transducerGeometry.c_str());
+    scanConversionElement->SetAttribute("OutputImageSizePixel", "820 616");
+    vtkSmartPointer<vtkPlusUsScanConvert> scanConverter;
+    if (transducerGeometry == "CURVILINEAR")
+    {
+      scanConverter = vtkSmartPointer<vtkPlusUsScanConvert>::Take(vtkPlusUsScanConvertCurvilinear::New());
+      scanConversionElement->SetAttribute("RadiusStartMm", "50");
+      scanConversionElement->SetAttribute("RadiusStopMm", "150");
+      scanConversionElement->SetAttribute("ThetaStartDeg", "-30");
+      scanConversionElement->SetAttribute("ThetaStopDeg", "30");
+      scanConversionElement->SetAttribute("OutputImageSpacingMmPerPixel", "0.2 0.2");
+      scanConversionElement->SetAttribute("TransducerCenterPixel", "410 -200");
+    }
+    else
+    {
+      scanConverter = vtkSmartPointer<vtkPlusUsScanConvert>::Take(vtkPlusUsScanConvertLinear::New());
+      scanConversionElement->SetAttribute("ImagingDepthMm", "60");
+      scanConversionElement->SetAttribute("TransducerWidthMm", "80");
+      scanConversionElement->SetAttribute("OutputImageSpacingMmPerPixel", "0.1 0.1");
+      scanConversionElement->SetAttribute("TransducerCenterPixel", "410 0");
+    }
+    if (scanConverter->ReadConfiguration(scanConversionElement) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to configure " << transducerGeometry << " scan converter");
+      return NULL;
+    }
+    return scanConverter;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  std::string outputFileName;
+  int numberOfIterations = 100;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--output-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputFileName, "JSON file to write the results to (default: [benchmark name].json in the output directory)");
+  args.AddArgument("--iterations", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfIterations, "Number of scan converted frames in each case (default: 100)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfIterations < 1)
+  {
+    LOG_ERROR("Invalid arguments: --iterations must be positive");
+    exit(EXIT_FAILURE);
+  }
+
+  // Brightness scanlines: each row of the image is a scanline
+  const int scanLinesSize[3] = {512, 128, 1};
+  vtkSmartPointer<vtkImageData> scanLines = vtkSmartPointer<vtkImageData>::New();
+  if (PlusVideoFrame::AllocateFrame(scanLines, scanLinesSize, VTK_UNSIGNED_CHAR, 1) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to allocate scanlines image");
+    exit(EXIT_FAILURE);
+  }
+  unsigned char* pixel = static_cast<unsigned char*>(scanLines->GetScalarPointer());
+  for (int scanLineIndex = 0; scanLineIndex < scanLinesSize[1]; ++scanLineIndex)
+  {
+    for (int sampleIndex = 0; sampleIndex < scanLinesSize[0]; ++sampleIndex)
+    {
+      *(pixel++) = static_cast<unsigned char>((sampleIndex / 16 + scanLineIndex / 8) % 128 + rand() % 64);
+    }
+  }
+
+  PlusBenchmarkReport report("ScanConversionBenchmark");
+  const char* transducerGeometries[] = { "LINEAR", "CURVILINEAR" };
+  for (int geometryIndex = 0; geometryIndex < 2; ++geometryIndex)
+  {
+    vtkSmartPointer<vtkPlusUsScanConvert> scanConverter = CreateScanConverter(transducerGeometries[geometryIndex]);
+    if (scanConverter == NULL)
+    {
+      exit(EXIT_FAILURE);
+    }
+    scanConverter->SetInputData(scanLines);
+
+    int outputImageSize[2] = {0, 0};
+    scanConverter->GetOutputImageSizePixel(outputImageSize);
+    PlusBenchmarkReport::ParameterMapType parameters;
+    parameters["TransducerGeometry"] = transducerGeometries[geometryIndex];
+    parameters["ScanLines"] = PlusCommon::ToString<int>(scanLinesSize[1]) + "x" + PlusCommon::ToString<int>(scanLinesSize[0]);
+    parameters["OutputImageSize"] = PlusCommon::ToString<int>(outputImageSize[0]) + "x" + PlusCommon::ToString<int>(outputImageSize[1]);
+
+    // The first update computes lookup tables, measure it separately
+    report.BeginCase("FirstUpdate", parameters, 1, "frames/s");
+    report.StartIteration();
+    scanConverter->Update();
+    report.StopIteration();
+    report.LogCaseSummary();
+
+    report.BeginCase("Update", parameters, 1, "frames/s");
+    for (int i = 0; i < numberOfIterations; ++i)
+    {
+      // Mark the input as modified so that the output is actually recomputed, as it happens when a new frame is acquired
+      scanLines->Modified();
+      report.StartIteration();
+      scanConverter->Update();
+      report.StopIteration();
+    }
+    report.LogCaseSummary();
+  }
+
+  if (report.WriteJsonToFile(outputFileName) != PLUS_SUCCESS)
+  {
+    exit(EXIT_FAILURE);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,157 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Measure the speed of writing and reading MetaImage sequence files with and without compression.
+
+#include "PlusConfigure.h"
+#include "PlusBenchmarkReport.h"
+#include "PlusTrackedFrame.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusSequenceIO.h"
+#include "vtkPlusTrackedFrameList.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include "vtksys/SystemTools.hxx"
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /*! Create frames with smooth image content (similar to B-mode images in compressibility) and a tracking transform */
+  PlusStatus CreateTrackedFrameList(vtkPlusTrackedFrameList* trackedFrameList, const int frameSize[3], int numberOfFrames)
+  {
+    PlusTransformName probeToTrackerName("Probe", "Tracker");
+    vtkSmartPointer<vtkMatrix4x4> probeToTracker = vtkSmartPointer<vtkMatrix4x4>::New();
+    for (int frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+    {
+      PlusTrackedFrame trackedFrame;
+      if (trackedFrame.GetImageData()->AllocateFrame(frameSize, VTK_UNSIGNED_CHAR, 1) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to allocate frame");
+        return PLUS_FAIL;
+      }
+      trackedFrame.GetImageData()->SetImageOrientation(US_IMG_ORIENT_MF);
+      trackedFrame.GetImageData()->SetImageType(US_IMG_BRIGHTNESS);
+      unsigned char* pixel = static_cast<unsigned char*>(trackedFrame.GetImageData()->GetScalarPointer());
+      for (int y = 0; y < frameSize[1]; ++y)
+      {
+        for (int x = 0; x < frameSize[0]; ++x)
+        {
+          *(pixel++) = static_cast<unsigned char>(((x + frameIndex) / 8 + y / 16) % 64 + (rand() % 16));
+        }
+      }
+      probeToTracker->SetElement(0, 3, frameIndex * 0.5);
+      trackedFrame.SetCustomFrameTransform(probeToTrackerName, probeToTracker);
+      trackedFrame.SetCustomFrameTransformStatus(probeToTrackerName, FIELD_OK);
+      trackedFrame.SetTimestamp(frameIndex * 0.05);
+      if (trackedFrameList->AddTrackedFrame(&trackedFrame) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add frame to the tracked frame list");
+        return PLUS_FAIL;
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  std::string outputFileName;
+  int numberOfFrames = 50;
+  int numberOfIterations = 5;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--output-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputFileName, "JSON file to write the results to (default: [benchmark name].json in the output directory)");
+  args.AddArgument("--frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfFrames, "Number of frames in the sequence file (default: 50)");
+  args.AddArgument("--iterations", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfIterations, "Number of times each file is written and read (default: 5)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfFrames < 1 || numberOfIterations < 1)
+  {
+    LOG_ERROR("Invalid arguments: --frames and --iterations must be positive");
+    exit(EXIT_FAILURE);
+  }
+
+  const int frameSize[3] = {640, 480, 1};
+  vtkSmartPointer<vtkPlusTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkPlusTrackedFrameList>::New();
+  if (CreateTrackedFrameList(trackedFrameList, frameSize, numberOfFrames) != PLUS_SUCCESS)
+  {
+    exit(EXIT_FAILURE);
+  }
+
+  PlusBenchmarkReport report("SequenceIOBenchmark");
+  const bool useCompressionValues[] = { false, true };
+  for (int compressionIndex = 0; compressionIndex < 2; ++compressionIndex)
+  {
+    const bool useCompression = useCompressionValues[compressionIndex];
+    std::string sequenceFileName = vtkPlusConfig::GetInstance()->GetOutputPath(
+                                     useCompression ? "SequenceIOBenchmarkCompressed.mha" : "SequenceIOBenchmarkRaw.mha");
+
+    PlusBenchmarkReport::ParameterMapType parameters;
+    parameters["FrameSize"] = PlusCommon::ToString<int>(frameSize[0]) + "x" + PlusCommon::ToString<int>(frameSize[1]);
+    parameters["Compression"] = useCompression ? "true" : "false";
+
+    report.BeginCase("Write", parameters, numberOfFrames, "frames/s");
+    for (int i = 0; i < numberOfIterations; ++i)
+    {
+      report.StartIteration();
+      if (vtkPlusSequenceIO::Write(sequenceFileName, trackedFrameList, US_IMG_ORIENT_MF, useCompression) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to write sequence file: " << sequenceFileName);
+        exit(EXIT_FAILURE);
+      }
+      report.StopIteration();
+    }
+    report.LogCaseSummary();
+
+    report.BeginCase("Read", parameters, numberOfFrames, "frames/s");
+    for (int i = 0; i < numberOfIterations; ++i)
+    {
+      vtkSmartPointer<vtkPlusTrackedFrameList> readFrameList = vtkSmartPointer<vtkPlusTrackedFrameList>::New();
+      report.StartIteration();
+      if (vtkPlusSequenceIO::Read(sequenceFileName, readFrameList) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to read sequence file: " << sequenceFileName);
+        exit(EXIT_FAILURE);
+      }
+      report.StopIteration();
+      if (readFrameList->GetNumberOfTrackedFrames() != static_cast<unsigned int>(numberOfFrames))
+      {
+        LOG_ERROR("Unexpected number of frames read from " << sequenceFileName << ": " << readFrameList->GetNumberOfTrackedFrames());
+        exit(EXIT_FAILURE);
+      }
+    }
+    report.LogCaseSummary();
+
+    vtksys::SystemTools::RemoveFile(sequenceFileName.c_str());
+  }
+
+  if (report.WriteJsonToFile(outputFileName) != PLUS_SUCCESS)
+  {
+    exit(EXIT_FAILURE);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,157 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Measure the speed of vtkPlusTransformRepository::GetTransform for direct, inverse, and computed (chained) transforms,
+// and of updating the repository from a tracked frame.
+
+#include "PlusConfigure.h"
+#include "PlusBenchmarkReport.h"
+#include "PlusTrackedFrame.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusTransformRepository.h"
+#include "vtkSmartPointer.h"
+#include "vtkTransform.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  void SetTestTransform(vtkPlusTransformRepository* transformRepository, const PlusTransformName& transformName, double offset)
+  {
+    vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
+    transform->Translate(offset, 2 * offset, 3 * offset);
+    transform->RotateZ(offset * 10);
+    transformRepository->SetTransform(transformName, transform->GetMatrix());
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  std::string outputFileName;
+  int numberOfIterations = 100;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--output-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputFileName, "JSON file to write the results to (default: [benchmark name].json in the output directory)");
+  args.AddArgument("--iterations", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfIterations, "Number of iterations in each case, each iteration performs 1000 calls (default: 100)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfIterations < 1)
+  {
+    LOG_ERROR("Invalid arguments: --iterations must be positive");
+    exit(EXIT_FAILURE);
+  }
+
+  // Typical transform graph of a tracked ultrasound setup
+  vtkSmartPointer<vtkPlusTransformRepository> transformRepository = vtkSmartPointer<vtkPlusTransformRepository>::New();
+  SetTestTransform(transformRepository, PlusTransformName("Probe", "Tracker"), 1);
+  SetTestTransform(transformRepository, PlusTransformName("Reference", "Tracker"), 2);
+  SetTestTransform(transformRepository, PlusTransformName("Stylus", "Tracker"), 3);
+  SetTestTransform(transformRepository, PlusTransformName("StylusTip", "Stylus"), 4);
+  SetTestTransform(transformRepository, PlusTransformName("Image", "Probe"), 5);
+  SetTestTransform(transformRepository, PlusTransformName("TransducerOriginPixel", "Image"), 6);
+  SetTestTransform(transformRepository, PlusTransformName("Ras", "Reference"), 7);
+  for (int i = 0; i < 10; ++i)
+  {
+    // Additional tools to make the graph more realistic
+    SetTestTransform(transformRepository, PlusTransformName("Tool" + PlusCommon::ToString<int>(i), "Tracker"), 8 + i);
+  }
+
+  struct GetTransformCase
+  {
+    const char* Name;
+    const char* From;
+    const char* To;
+  };
+  const GetTransformCase getTransformCases[] =
+  {
+    { "GetTransformStored", "Probe", "Tracker" },
+    { "GetTransformInverse", "Tracker", "Probe" },
+    { "GetTransformChain3", "Image", "Reference" },
+    { "GetTransformChain5", "TransducerOriginPixel", "StylusTip" },
+    { "GetTransformChain6", "TransducerOriginPixel", "Ras" }
+  };
+
+  const int CALLS_PER_ITERATION = 1000;
+  PlusBenchmarkReport report("TransformRepositoryBenchmark");
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  for (unsigned int caseIndex = 0; caseIndex < sizeof(getTransformCases) / sizeof(getTransformCases[0]); ++caseIndex)
+  {
+    PlusTransformName transformName(getTransformCases[caseIndex].From, getTransformCases[caseIndex].To);
+    PlusBenchmarkReport::ParameterMapType parameters;
+    parameters["Transform"] = std::string(getTransformCases[caseIndex].From) + "To" + getTransformCases[caseIndex].To;
+    report.BeginCase(getTransformCases[caseIndex].Name, parameters, CALLS_PER_ITERATION, "calls/s");
+    for (int i = 0; i < numberOfIterations; ++i)
+    {
+      report.StartIteration();
+      for (int callIndex = 0; callIndex < CALLS_PER_ITERATION; ++callIndex)
+      {
+        if (transformRepository->GetTransform(transformName, matrix) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to get transform " << parameters["Transform"]);
+          exit(EXIT_FAILURE);
+        }
+      }
+      report.StopIteration();
+    }
+    report.LogCaseSummary();
+  }
+
+  // Update the repository from a tracked frame, as it is done for each frame sent by the server
+  PlusTrackedFrame trackedFrame;
+  vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
+  transform->Translate(10, 20, 30);
+  const char* trackedToolNames[] = { "Probe", "Reference", "Stylus" };
+  for (int i = 0; i < 3; ++i)
+  {
+    PlusTransformName toolToTracker(trackedToolNames[i], "Tracker");
+    trackedFrame.SetCustomFrameTransform(toolToTracker, transform->GetMatrix());
+    trackedFrame.SetCustomFrameTransformStatus(toolToTracker, FIELD_OK);
+  }
+  PlusBenchmarkReport::ParameterMapType parameters;
+  parameters["TransformsInFrame"] = "3";
+  report.BeginCase("SetTransformsFromTrackedFrame", parameters, CALLS_PER_ITERATION, "calls/s");
+  for (int i = 0; i < numberOfIterations; ++i)
+  {
+    report.StartIteration();
+    for (int callIndex = 0; callIndex < CALLS_PER_ITERATION; ++callIndex)
+    {
+      if (transformRepository->SetTransforms(trackedFrame) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to set transforms from tracked frame");
+        exit(EXIT_FAILURE);
+      }
+    }
+    report.StopIteration();
+  }
+  report.LogCaseSummary();
+
+  if (report.WriteJsonToFile(outputFileName) != PLUS_SUCCESS)
+  {
+    exit(EXIT_FAILURE);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,541 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file LinearObjectRegistrationTest.cxx
+  \brief This test checks the geometric computations of the linear object phantom registration on synthetic data:
+  signature matching is compared to an exhaustive search, the centroid of linear objects and the spherical
+  registration must recover known transforms, linear object extraction must give the same result on one and on
+  multiple threads, and ill-conditioned inputs must be rejected.
+*/
+
+#include "PlusConfigure.h"
+#include "LinearObjectBuffer.h"
+#include "PointObservationBuffer.h"
+#include "vtkMultiThreader.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+#include <vector>
+
+namespace
+{
+  const double TOLERANCE = 1e-6;
+
+  //----------------------------------------------------------------------------
+  // Deterministic pseudo-random numbers, so that the test data is the same on all platforms
+  class RandomGenerator
+  {
+  public:
+    RandomGenerator(uint32_t seed) : State(seed) {}
+
+    double Uniform(double minValue, double maxValue)
+    {
+      this->State = this->State * 1103515245u + 12345u;
+      return minValue + (maxValue - minValue) * ((this->State >> 8) & 0xFFFFFF) / 16777216.0;
+    }
+
+    LinearObject::VectorType UniformVector(double minValue, double maxValue)
+    {
+      LinearObject::VectorType vector;
+      for (int d = 0; d < LinearObject::DIMENSION; d++)
+      {
+        vector[d] = this->Uniform(minValue, maxValue);
+      }
+      return vector;
+    }
+
+  protected:
+    uint32_t State;
+  };
+
+  //----------------------------------------------------------------------------
+  LinearObject::VectorType MakeVector(double x, double y, double z)
+  {
+    LinearObject::VectorType vector;
+    vector[0] = x;
+    vector[1] = y;
+    vector[2] = z;
+    return vector;
+  }
+
+  //----------------------------------------------------------------------------
+  // Rotation around the axis by the angle (Rodrigues' formula)
+  PointObservationBuffer::MatrixType MakeRotation(const LinearObject::VectorType& axis, double angleRad)
+  {
+    const LinearObject::VectorType u = LinearObject::Multiply(1.0 / LinearObject::Norm(axis), axis);
+    const double c = cos(angleRad);
+    const double s = sin(angleRad);
+    PointObservationBuffer::MatrixType rotation;
+    rotation(0, 0) = c + u[0] * u[0] * (1 - c);
+    rotation(0, 1) = u[0] * u[1] * (1 - c) - u[2] * s;
+    rotation(0, 2) = u[0] * u[2] * (1 - c) + u[1] * s;
+    rotation(1, 0) = u[1] * u[0] * (1 - c) + u[2] * s;
+    rotation(1, 1) = c + u[1] * u[1] * (1 - c);
+    rotation(1, 2) = u[1] * u[2] * (1 - c) - u[0] * s;
+    rotation(2, 0) = u[2] * u[0] * (1 - c) - u[1] * s;
+    rotation(2, 1) = u[2] * u[1] * (1 - c) + u[0] * s;
+    rotation(2, 2) = c + u[2] * u[2] * (1 - c);
+    return rotation;
+  }
+
+  //----------------------------------------------------------------------------
+  std::vector<double> RandomSignature(RandomGenerator& random, int signatureSize)
+  {
+    std::vector<double> signature(signatureSize);
+    for (int d = 0; d < signatureSize; d++)
+    {
+      signature[d] = random.Uniform(0, 200);
+    }
+    return signature;
+  }
+
+  //----------------------------------------------------------------------------
+  // Candidates with random signatures, some of them with identical signatures. The objects are either random
+  // (most of them do not match), or perturbed or exact copies of a candidate signature.
+  void CreateMatchingData(uint32_t seed, LinearObjectBuffer& objects, LinearObjectBuffer& candidates)
+  {
+    const int SIGNATURE_SIZE = 4;
+    const int NUMBER_OF_CANDIDATES = 300;
+    const int NUMBER_OF_DUPLICATE_CANDIDATES = 20;
+    const int NUMBER_OF_OBJECTS = 200;
+
+    RandomGenerator random(seed);
+    for (int j = 0; j < NUMBER_OF_CANDIDATES; j++)
+    {
+      Point* candidate = new Point(random.UniformVector(-100, 100));
+      candidate->Signature = RandomSignature(random, SIGNATURE_SIZE);
+      candidates.AddLinearObject(candidate);
+    }
+    // Ties must be resolved in favour of the first candidate
+    for (int j = 0; j < NUMBER_OF_DUPLICATE_CANDIDATES; j++)
+    {
+      Point* candidate = new Point(random.UniformVector(-100, 100));
+      candidate->Signature = candidates.GetLinearObject(j * 7)->Signature;
+      candidates.AddLinearObject(candidate);
+    }
+    // Signatures of different length never match
+    Point* shortCandidate = new Point();
+    shortCandidate->Signature = RandomSignature(random, SIGNATURE_SIZE - 1);
+    candidates.AddLinearObject(shortCandidate);
+
+    for (int i = 0; i < NUMBER_OF_OBJECTS; i++)
+    {
+      Point* object = new Point(random.UniformVector(-100, 100));
+      switch (i % 4)
+      {
+        case 0:
+          object->Signature = RandomSignature(random, SIGNATURE_SIZE);
+          break;
+        case 1:
+          object->Signature = candidates.GetLinearObject(((i / 4) % NUMBER_OF_DUPLICATE_CANDIDATES) * 7)->Signature;
+          break;
+        default:
+          object->Signature = candidates.GetLinearObject(static_cast<int>(random.Uniform(0, NUMBER_OF_CANDIDATES)))->Signature;
+          for (int d = 0; d < SIGNATURE_SIZE; d++)
+          {
+            object->Signature[d] += random.Uniform(-3, 3);
+          }
+      }
+      objects.AddLinearObject(object);
+    }
+    Point* shortObject = new Point();
+    shortObject->Signature = shortCandidate->Signature;
+    objects.AddLinearObject(shortObject);
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus TestGetMatches()
+  {
+    PlusStatus status = PLUS_SUCCESS;
+    const double matchingThresholds[3] = { 1.0, 5.0, 50.0 };
+    for (uint32_t seed = 1; seed <= 3; seed++)
+    {
+      for (int t = 0; t < 3; t++)
+      {
+        LinearObjectBuffer objects;
+        LinearObjectBuffer candidates;
+        CreateMatchingData(seed, objects, candidates);
+
+        // Exhaustive search: the first candidate with the smallest signature distance below the threshold
+        std::vector<LinearObject*> expectedObjects;
+        std::vector<LinearObject*> expectedMatches;
+        for (int i = 0; i < objects.Size(); i++)
+        {
+          const std::vector<double>& signature = objects.GetLinearObject(i)->Signature;
+          double closestSquaredDistance = matchingThresholds[t] * matchingThresholds[t];
+          int closestIndex = -1;
+          for (int j = 0; j < candidates.Size(); j++)
+          {
+            const std::vector<double>& candidateSignature = candidates.GetLinearObject(j)->Signature;
+            if (candidateSignature.size() != candidates.GetLinearObject(0)->Signature.size() || candidateSignature.size() != signature.size())
+            {
+              continue;
+            }
+            double squaredDistance = 0.0;
+            for (size_t d = 0; d < signature.size(); d++)
+            {
+              squaredDistance += (signature[d] - candidateSignature[d]) * (signature[d] - candidateSignature[d]);
+            }
+            if (squaredDistance < closestSquaredDistance)
+            {
+              closestSquaredDistance = squaredDistance;
+              closestIndex = j;
+            }
+          }
+          if (closestIndex >= 0)
+          {
+            expectedObjects.push_back(objects.GetLinearObject(i));
+            expectedMatches.push_back(candidates.GetLinearObject(closestIndex));
+          }
+        }
+
+        LinearObjectBuffer matchedCandidates;
+        objects.GetMatches(candidates, matchingThresholds[t], matchedCandidates);
+
+        if (objects.Size() != static_cast<int>(expectedObjects.size()) || matchedCandidates.Size() != static_cast<int>(expectedMatches.size()))
+        {
+          LOG_ERROR("GetMatches (seed " << seed << ", threshold " << matchingThresholds[t] << ") found " << objects.Size() << " matches, exhaustive search found " << expectedObjects.size());
+          status = PLUS_FAIL;
+          continue;
+        }
+        for (int i = 0; i < objects.Size(); i++)
+        {
+          if (objects.GetLinearObject(i) != expectedObjects[i] || matchedCandidates.GetLinearObject(i) != expectedMatches[i])
+          {
+            LOG_ERROR("GetMatches (seed " << seed << ", threshold " << matchingThresholds[t] << ") match " << i << " differs from the exhaustive search");
+            status = PLUS_FAIL;
+            break;
+          }
+        }
+        LOG_DEBUG("GetMatches (seed " << seed << ", threshold " << matchingThresholds[t] << "): " << objects.Size() << " matches");
+      }
+    }
+    return status;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus CheckCentroid(const std::string& name, const LinearObjectBuffer& buffer, const LinearObject::VectorType& expectedCentroid)
+  {
+    LinearObject::VectorType centroid;
+    if (buffer.CalculateCentroid(centroid) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Centroid calculation of " << name << " failed");
+      return PLUS_FAIL;
+    }
+    if (LinearObject::Distance(centroid, expectedCentroid) > TOLERANCE)
+    {
+      LOG_ERROR("Centroid of " << name << " is " << LinearObject::VectorToString(centroid) << ", expected " << LinearObject::VectorToString(expectedCentroid));
+      return PLUS_FAIL;
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  // Lines and planes through a known point, so the least squares centroid is that point
+  PlusStatus TestCalculateCentroid()
+  {
+    PlusStatus status = PLUS_SUCCESS;
+    const LinearObject::VectorType intersection = MakeVector(12.5, -40.0, 73.0);
+
+    LinearObjectBuffer lines;
+    lines.AddLinearObject(new Line(intersection + MakeVector(-30, 5, 2), intersection + 2.0 * MakeVector(-30, 5, 2)));
+    lines.AddLinearObject(new Line(intersection - MakeVector(1, 20, 4), intersection + MakeVector(1, 20, 4)));
+    lines.AddLinearObject(new Line(intersection + MakeVector(3, 3, 50), intersection + MakeVector(6, 6, 100)));
+
+    LinearObjectBuffer planes;
+    const LinearObject::VectorType planeAxes[3][2] =
+    {
+      { MakeVector(1, 0, 0), MakeVector(0, 1, 0.5) },
+      { MakeVector(0, 1, 0), MakeVector(1, 0, 1) },
+      { MakeVector(0, 0, 1), MakeVector(1, 1, 0) }
+    };
+    for (int i = 0; i < 3; i++)
+    {
+      const LinearObject::VectorType basePoint = intersection + 10.0 * planeAxes[i][0];
+      planes.AddLinearObject(new Plane(basePoint, basePoint + planeAxes[i][0], basePoint + planeAxes[i][1]));
+    }
+
+    LinearObjectBuffer mixed;
+    mixed.Concatenate(lines);
+    mixed.Concatenate(planes);
+    mixed.AddLinearObject(new Point(intersection));
+
+    if (CheckCentroid("lines", lines, intersection) != PLUS_SUCCESS
+        || CheckCentroid("planes", planes, intersection) != PLUS_SUCCESS
+        || CheckCentroid("lines, planes and a point", mixed, intersection) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+
+    // Translating the objects translates the centroid (the objects of lines and planes are shared with mixed)
+    const LinearObject::VectorType translation = MakeVector(-5.0, 100.0, 0.25);
+    mixed.Translate(translation);
+    if (CheckCentroid("translated lines, planes and a point", mixed, intersection + translation) != PLUS_SUCCESS
+        || CheckCentroid("translated lines", lines, intersection + translation) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+
+    // Parallel lines and a single plane do not determine a point
+    LinearObjectBuffer parallelLines;
+    parallelLines.AddLinearObject(new Line(MakeVector(0, 0, 0), MakeVector(1, 1, 0)));
+    parallelLines.AddLinearObject(new Line(MakeVector(0, 5, 0), MakeVector(1, 6, 0)));
+    LinearObjectBuffer singlePlane;
+    singlePlane.AddLinearObject(new Plane(MakeVector(0, 0, 0), MakeVector(1, 0, 0), MakeVector(0, 1, 0)));
+    LinearObjectBuffer empty;
+
+    const int logLevel = vtkPlusLogger::Instance()->GetLogLevel();
+    vtkPlusLogger::Instance()->SetLogLevel(vtkPlusLogger::LOG_LEVEL_ERROR - 1); // temporarily disable error logging (as we are expecting errors)
+    LinearObject::VectorType centroid;
+    const bool illConditionedAccepted = (parallelLines.CalculateCentroid(centroid) != PLUS_FAIL
+                                         || singlePlane.CalculateCentroid(centroid) != PLUS_FAIL
+                                         || empty.CalculateCentroid(centroid) != PLUS_FAIL);
+    vtkPlusLogger::Instance()->SetLogLevel(logLevel);
+    if (illConditionedAccepted)
+    {
+      LOG_ERROR("Ill-conditioned centroid calculation did not fail");
+      status = PLUS_FAIL;
+    }
+
+    return status;
+  }
+
+  //----------------------------------------------------------------------------
+  void MakeZeroMean(PointObservationBuffer& buffer, LinearObject::VectorType& centroid)
+  {
+    centroid.fill(0.0);
+    for (unsigned int i = 0; i < buffer.Size(); i++)
+    {
+      centroid += buffer.GetObservation(i).Observation;
+    }
+    centroid /= buffer.Size();
+    buffer.Translate(-centroid);
+  }
+
+  //----------------------------------------------------------------------------
+  // The points are rotated and translated by a known transform, which must be recovered
+  PlusStatus TestSphericalRegistration()
+  {
+    PlusStatus status = PLUS_SUCCESS;
+    const PointObservationBuffer::MatrixType expectedRotation = MakeRotation(MakeVector(1, 2, 3), 0.7);
+    const LinearObject::VectorType expectedTranslation = MakeVector(20.0, -35.5, 110.0);
+
+    RandomGenerator random(5);
+    PointObservationBuffer fromPoints;
+    PointObservationBuffer toPoints;
+    for (int i = 0; i < 30; i++)
+    {
+      LinearObject::VectorType point = random.UniformVector(-100, 100);
+      fromPoints.AddObservation(PointObservation(point));
+      toPoints.AddObservation(PointObservation(expectedRotation * point + expectedTranslation));
+    }
+
+    LinearObject::VectorType fromCentroid;
+    LinearObject::VectorType toCentroid;
+    MakeZeroMean(fromPoints, fromCentroid);
+    MakeZeroMean(toPoints, toCentroid);
+
+    PointObservationBuffer::MatrixType rotation;
+    if (toPoints.SphericalRegistration(fromPoints, rotation) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Spherical registration failed");
+      return PLUS_FAIL;
+    }
+    const double rotationError = (rotation - expectedRotation).absolute_value_max();
+    if (rotationError > TOLERANCE)
+    {
+      LOG_ERROR("Spherical registration did not recover the rotation, largest matrix element difference: " << rotationError);
+      status = PLUS_FAIL;
+    }
+    LinearObject::VectorType translation = toPoints.TranslationalRegistration(toCentroid, fromCentroid, rotation);
+    if (LinearObject::Distance(translation, expectedTranslation) > TOLERANCE)
+    {
+      LOG_ERROR("Translational registration result is " << LinearObject::VectorToString(translation) << ", expected " << LinearObject::VectorToString(expectedTranslation));
+      status = PLUS_FAIL;
+    }
+
+    // Collinear (or no) points do not determine the rotation, and the point sets must have the same size
+    PointObservationBuffer collinearFromPoints;
+    PointObservationBuffer collinearToPoints;
+    for (int i = -5; i <= 5; i++)
+    {
+      collinearFromPoints.AddObservation(PointObservation(MakeVector(i, 2 * i, -i)));
+      collinearToPoints.AddObservation(PointObservation(expectedRotation * MakeVector(i, 2 * i, -i)));
+    }
+    const int logLevel = vtkPlusLogger::Instance()->GetLogLevel();
+    vtkPlusLogger::Instance()->SetLogLevel(vtkPlusLogger::LOG_LEVEL_ERROR - 1); // temporarily disable error logging (as we are expecting errors)
+    PointObservationBuffer emptyPoints;
+    const bool illConditionedAccepted = (collinearToPoints.SphericalRegistration(collinearFromPoints, rotation) != PLUS_FAIL
+                                         || collinearToPoints.SphericalRegistration(fromPoints, rotation) != PLUS_FAIL
+                                         || emptyPoints.SphericalRegistration(emptyPoints, rotation) != PLUS_FAIL);
+    vtkPlusLogger::Instance()->SetLogLevel(logLevel);
+    if (illConditionedAccepted)
+    {
+      LOG_ERROR("Ill-conditioned spherical registration did not fail");
+      status = PLUS_FAIL;
+    }
+
+    return status;
+  }
+
+  //----------------------------------------------------------------------------
+  // Stationary, linear and planar motions, separated by random motion. Long enough to be analyzed on multiple threads.
+  void CreateTrajectory(PointObservationBuffer& trajectory)
+  {
+    const int RANDOM_FRAMES = 200;
+    const int LINEAR_OBJECT_FRAMES = 300;
+
+    RandomGenerator random(7);
+    for (int repeat = 0; repeat < 2; repeat++)
+    {
+      for (int i = 0; i < RANDOM_FRAMES; i++)
+      {
+        trajectory.AddObservation(PointObservation(random.UniformVector(-100, 100)));
+      }
+      // Point
+      for (int i = 0; i < LINEAR_OBJECT_FRAMES; i++)
+      {
+        trajectory.AddObservation(PointObservation(MakeVector(10, 20, 30 + repeat)));
+      }
+      for (int i = 0; i < RANDOM_FRAMES; i++)
+      {
+        trajectory.AddObservation(PointObservation(random.UniformVector(-100, 100)));
+      }
+      // Line
+      for (int i = 0; i < LINEAR_OBJECT_FRAMES; i++)
+      {
+        trajectory.AddObservation(PointObservation(MakeVector(-50 + 0.3 * i, 0.2 * i, repeat + 0.1 * i)));
+      }
+      for (int i = 0; i < RANDOM_FRAMES; i++)
+      {
+        trajectory.AddObservation(PointObservation(random.UniformVector(-100, 100)));
+      }
+      // Plane
+      for (int i = 0; i < LINEAR_OBJECT_FRAMES; i++)
+      {
+        const double angleRad = 0.1 * i;
+        trajectory.AddObservation(PointObservation(MakeVector(30 * cos(angleRad), 30 * sin(angleRad) / sqrt(2.0), 5 * repeat + 30 * sin(angleRad) / sqrt(2.0))));
+      }
+    }
+    for (int i = 0; i < RANDOM_FRAMES; i++)
+    {
+      trajectory.AddObservation(PointObservation(random.UniformVector(-100, 100)));
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus TestExtractLinearObjects()
+  {
+    const int COLLECTION_FRAMES = 100;
+    const double EXTRACTION_THRESHOLD = 1.0;
+    const int EXPECTED_DOF[6] = { 0, 1, 2, 0, 1, 2 };
+
+    PointObservationBuffer trajectory;
+    CreateTrajectory(trajectory);
+
+    PlusStatus status = PLUS_SUCCESS;
+    // The single-threaded run is the last one, so that a window left out by the thread partitioning
+    // cannot silently reuse an eigenvalue computed by a previous run in the same memory block
+    const int NUMBER_OF_RUNS = 3;
+    const int numberOfThreads[NUMBER_OF_RUNS] = { 7, 4, 1 };
+    std::vector<PointObservationBuffer> linearObjects[NUMBER_OF_RUNS];
+    std::vector<int> dof[NUMBER_OF_RUNS];
+    for (int t = 0; t < NUMBER_OF_RUNS; t++)
+    {
+      vtkMultiThreader::SetGlobalDefaultNumberOfThreads(numberOfThreads[t]);
+      trajectory.ExtractLinearObjects(COLLECTION_FRAMES, EXTRACTION_THRESHOLD, linearObjects[t], dof[t]);
+      LOG_DEBUG("Extracted " << linearObjects[t].size() << " linear objects on " << numberOfThreads[t] << " threads");
+      if (dof[t].size() != 6 || !std::equal(dof[t].begin(), dof[t].end(), EXPECTED_DOF))
+      {
+        LOG_ERROR("Extracted " << dof[t].size() << " linear objects on " << numberOfThreads[t] << " threads, expected a point, a line and a plane twice");
+        status = PLUS_FAIL;
+      }
+    }
+    // Restore the automatic number of threads
+    vtkMultiThreader::SetGlobalDefaultNumberOfThreads(0);
+    if (status != PLUS_SUCCESS)
+    {
+      return status;
+    }
+
+    const int singleThreadedRun = NUMBER_OF_RUNS - 1;
+    for (int t = 0; t < singleThreadedRun; t++)
+    {
+      for (size_t i = 0; i < linearObjects[t].size(); i++)
+      {
+        bool equal = (linearObjects[t][i].Size() == linearObjects[singleThreadedRun][i].Size());
+        for (unsigned int j = 0; equal && j < linearObjects[t][i].Size(); j++)
+        {
+          equal = (linearObjects[t][i].GetObservation(j).Observation == linearObjects[singleThreadedRun][i].GetObservation(j).Observation);
+        }
+        if (!equal)
+        {
+          LOG_ERROR("Observations of linear object " << i << " extracted on " << numberOfThreads[t] << " threads differ from the ones extracted on one thread");
+          status = PLUS_FAIL;
+        }
+      }
+    }
+
+    return status;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfFailures = 0;
+  if (TestGetMatches() != PLUS_SUCCESS)
+  {
+    ++numberOfFailures;
+  }
+  if (TestCalculateCentroid() != PLUS_SUCCESS)
+  {
+    ++numberOfFailures;
+  }
+  if (TestSphericalRegistration() != PLUS_SUCCESS)
+  {
+    ++numberOfFailures;
+  }
+  if (TestExtractLinearObjects() != PLUS_SUCCESS)
+  {
+    ++numberOfFailures;
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("LinearObjectRegistrationTest failed");
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Test completed successfully!");
+  return EXIT_SUCCESS;
+}
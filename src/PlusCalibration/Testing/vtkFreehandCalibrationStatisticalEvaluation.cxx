@@ -8,6 +8,9 @@ See License.txt for details.
   \file vtkFreehandCalibrationStatisticalEvaluation.cxx
   \brief This test runs a freehand calibration on a recorded data set using
   several subsequences of frames and save the results
+
+  If a baseline file is specified then the calibration is first computed from all the
+  calibration frames and the result is compared to the baseline.
 */
 
 #include "PlusConfigure.h"
@@ -19,6 +22,7 @@ See License.txt for details.
 #include "vtkCommand.h"
 #include "vtkMath.h"
 #include "vtkMatrix4x4.h"
+#include "vtkPlusAccurateTimer.h"
 #include "vtkPlusProbeCalibrationAlgo.h"
 #include "vtkPlusSequenceIO.h"
 #include "vtkSmartPointer.h"
@@ -35,6 +39,8 @@ See License.txt for details.
 
 PlusStatus SubSequenceMetafile( vtkPlusTrackedFrameList* aTrackedFrameList, std::vector<unsigned int> selectedFrames );
 PlusStatus SetOptimizationMethod( vtkPlusProbeCalibrationAlgo* freehandCalibration, std::string method );
+PlusStatus SetOptimizerAlgorithm( vtkPlusProbeCalibrationAlgo* freehandCalibration, std::string algorithm );
+int CompareCalibrationResultsWithBaseline( const char* baselineFileName, const char* currentResultFileName, double translationErrorThreshold, double rotationErrorThreshold );
 
 enum OperationType
 {
@@ -54,6 +60,10 @@ int main ( int argc, char* argv[] )
   std::string resultConfigFileName = "";
   std::string saveResultsFilename;
   std::string strOperation;
+  std::string inputBaselineFileName;
+  double inputTranslationErrorThreshold( LINUXTOLERANCE );
+  double inputRotationErrorThreshold( LINUXTOLERANCE );
+  std::string optimizerAlgorithm;
 
 #ifndef _WIN32
   //double inputTranslationErrorThreshold(LINUXTOLERANCE);
@@ -74,6 +84,10 @@ int main ( int argc, char* argv[] )
   cmdargs.AddArgument( "--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Configuration file name prefix" );
   cmdargs.AddArgument( "--save-results-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &saveResultsFilename, "Save results file name" );
   cmdargs.AddArgument( "--operation", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &strOperation, "Type of experiment to perform" );
+  cmdargs.AddArgument( "--optimizer-algorithm", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &optimizerAlgorithm, "Calibration optimizer algorithm (POWELL or LEVENBERG_MARQUARDT). If not specified then the algorithm defined in the configuration file is used." );
+  cmdargs.AddArgument( "--baseline-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputBaselineFileName, "Name of file storing baseline calibration results. If specified then the calibration computed from all the calibration frames is compared to the baseline." );
+  cmdargs.AddArgument( "--translation-error-threshold", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputTranslationErrorThreshold, "Translation error threshold in mm. Used for baseline comparison." );
+  cmdargs.AddArgument( "--rotation-error-threshold", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputRotationErrorThreshold, "Rotation error threshold in degrees. Used for baseline comparison." );
 
   cmdargs.AddArgument( "--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)" );
 
@@ -107,6 +121,10 @@ int main ( int argc, char* argv[] )
 
   vtkSmartPointer<vtkPlusProbeCalibrationAlgo> freehandCalibration = vtkSmartPointer<vtkPlusProbeCalibrationAlgo>::New();
   freehandCalibration->ReadConfiguration( configRootElement );
+  if ( !optimizerAlgorithm.empty() && SetOptimizerAlgorithm( freehandCalibration, optimizerAlgorithm ) != PLUS_SUCCESS )
+  {
+    return EXIT_FAILURE;
+  }
 
   PlusFidPatternRecognition patternRecognition;
   PlusFidPatternRecognition::PatternRecognitionError error;
@@ -153,6 +171,26 @@ int main ( int argc, char* argv[] )
   // Keep only the images properly segmented
   SubSequenceMetafile( calibrationTrackedFrameList, segmentedCalibrationFramesIndices );
 
+  if ( !inputBaselineFileName.empty() )
+  {
+    // Calibrate using all the frames with the optimization method defined in the configuration file
+    double calibrationStartTimeSec = vtkPlusAccurateTimer::GetSystemTime();
+    if ( freehandCalibration->Calibrate( validationTrackedFrameList, calibrationTrackedFrameList, transformRepository, patternRecognition.GetFidLineFinder()->GetNWires() ) != PLUS_SUCCESS )
+    {
+      LOG_ERROR( "Calibration failed!" );
+      return EXIT_FAILURE;
+    }
+    LOG_INFO( "Calibration time using all the frames: " << vtkPlusAccurateTimer::GetSystemTime() - calibrationStartTimeSec << " sec" );
+
+    std::string currentResultFileName = vtkPlusConfig::GetInstance()->GetOutputPath(
+                                          vtkPlusConfig::GetInstance()->GetApplicationStartTimestamp() + ".Calibration.results.xml" );
+    if ( CompareCalibrationResultsWithBaseline( inputBaselineFileName.c_str(), currentResultFileName.c_str(), inputTranslationErrorThreshold, inputRotationErrorThreshold ) != 0 )
+    {
+      LOG_ERROR( "Comparison of calibration data to baseline failed" );
+      return EXIT_FAILURE;
+    }
+  }
+
 
   ofstream outputFile;
   outputFile.open( saveResultsFilename.c_str(), std::ios_base::app );
@@ -181,6 +219,14 @@ int main ( int argc, char* argv[] )
     operation = MOBILE_WINDOW;
   }
 
+  if ( operation == NO_OPERATION )
+  {
+    // No subsequences to evaluate
+    outputFile.close();
+    std::cout << "Exit success!!!" << std::endl;
+    return EXIT_SUCCESS;
+  }
+
   int minFrame = 0;
   int maxFrame = segmentedCalibrationFramesIndices.size();
   int numberOfConfigurations = 15;
@@ -298,6 +344,7 @@ int main ( int argc, char* argv[] )
         SetOptimizationMethod( freehandCalibration, methods[k] );
 
         // Calibrate
+        double calibrationStartTimeSec = vtkPlusAccurateTimer::GetSystemTime();
         if ( freehandCalibration->Calibrate( validationTrackedFrameList, sequenceTrackedFrameList, transformRepository, patternRecognition.GetFidLineFinder()->GetNWires() ) != PLUS_SUCCESS )
         {
           LOG_ERROR( "Calibration failed!" );
@@ -309,12 +356,15 @@ int main ( int argc, char* argv[] )
           //return EXIT_FAILURE;
         }
 
+        double calibrationTimeSec = vtkPlusAccurateTimer::GetSystemTime() - calibrationStartTimeSec;
+
         freehandCalibration->GetCalibrationReport( &calibError, &validError, &imageToProbeTransformMatrix );
         // TODO: double-check if the reported values matches the expected values
 
         outputFile << "Calibration error = ";
         outputFile << calibError.at( 0 ) << " " << calibError.at( 1 ) << " ";
         outputFile << validError.at( 0 ) << " " << validError.at( 1 )  << " \n ";
+        outputFile << "Calibration time (sec) = " << calibrationTimeSec << " \n ";
 
         outputFile << "\n ";
         outputFile << "Image to Probe transform matrix = \n ";
@@ -404,3 +454,82 @@ PlusStatus SetOptimizationMethod( vtkPlusProbeCalibrationAlgo* freehandCalibrati
   }
   return PLUS_SUCCESS;
 }
+
+//-------------------------------------------------------------------------------------------------
+PlusStatus SetOptimizerAlgorithm( vtkPlusProbeCalibrationAlgo* freehandCalibration, std::string algorithm )
+{
+  vtkPlusProbeCalibrationOptimizerAlgo* optimizer = freehandCalibration->GetOptimizer();
+
+  if ( STRCASECMP( algorithm.c_str(), vtkPlusProbeCalibrationOptimizerAlgo::GetOptimizerAlgorithmAsString( vtkPlusProbeCalibrationOptimizerAlgo::OPTIMIZER_POWELL ) ) == 0 )
+  {
+    optimizer->SetOptimizerAlgorithm( vtkPlusProbeCalibrationOptimizerAlgo::OPTIMIZER_POWELL );
+  }
+  else if ( STRCASECMP( algorithm.c_str(), vtkPlusProbeCalibrationOptimizerAlgo::GetOptimizerAlgorithmAsString( vtkPlusProbeCalibrationOptimizerAlgo::OPTIMIZER_LEVENBERG_MARQUARDT ) ) == 0 )
+  {
+    optimizer->SetOptimizerAlgorithm( vtkPlusProbeCalibrationOptimizerAlgo::OPTIMIZER_LEVENBERG_MARQUARDT );
+  }
+  else
+  {
+    LOG_ERROR( "Unknown optimizer algorithm: " << algorithm );
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//-------------------------------------------------------------------------------------------------
+// return the number of differences
+int CompareCalibrationResultsWithBaseline( const char* baselineFileName, const char* currentResultFileName, double translationErrorThreshold, double rotationErrorThreshold )
+{
+  vtkSmartPointer<vtkXMLDataElement> baselineRootElem = vtkSmartPointer<vtkXMLDataElement>::Take(
+        vtkXMLUtilities::ReadElementFromFile( baselineFileName ) );
+  vtkSmartPointer<vtkXMLDataElement> currentRootElem = vtkSmartPointer<vtkXMLDataElement>::Take(
+        vtkXMLUtilities::ReadElementFromFile( currentResultFileName ) );
+  if ( baselineRootElem == NULL )
+  {
+    LOG_ERROR( "Reading baseline data file failed: " << baselineFileName );
+    return 1;
+  }
+  if ( currentRootElem == NULL )
+  {
+    LOG_ERROR( "Reading newly generated data file failed: " << currentResultFileName );
+    return 1;
+  }
+
+  vtkXMLDataElement* calibrationResultsBaseline = baselineRootElem->FindNestedElementWithName( "CalibrationResults" );
+  vtkXMLDataElement* calibrationResults = currentRootElem->FindNestedElementWithName( "CalibrationResults" );
+  vtkXMLDataElement* transformBaseline = ( calibrationResultsBaseline != NULL ? calibrationResultsBaseline->FindNestedElementWithName( "Transform" ) : NULL );
+  vtkXMLDataElement* transform = ( calibrationResults != NULL ? calibrationResults->FindNestedElementWithName( "Transform" ) : NULL );
+  double blTransformImageToProbe[16];
+  double cTransformImageToProbe[16];
+  if ( transformBaseline == NULL || !transformBaseline->GetVectorAttribute( "Matrix", 16, blTransformImageToProbe ) )
+  {
+    LOG_ERROR( "Reading baseline CalibrationResults/Transform matrix failed: " << baselineFileName );
+    return 1;
+  }
+  if ( transform == NULL || !transform->GetVectorAttribute( "Matrix", 16, cTransformImageToProbe ) )
+  {
+    LOG_ERROR( "Reading current CalibrationResults/Transform matrix failed: " << currentResultFileName );
+    return 1;
+  }
+
+  vtkSmartPointer<vtkMatrix4x4> baseTransMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkSmartPointer<vtkMatrix4x4> currentTransMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  baseTransMatrix->DeepCopy( blTransformImageToProbe );
+  currentTransMatrix->DeepCopy( cTransformImageToProbe );
+
+  int numberOfFailures = 0;
+  double translationError = PlusMath::GetPositionDifference( baseTransMatrix, currentTransMatrix );
+  double rotationError = PlusMath::GetOrientationDifference( baseTransMatrix, currentTransMatrix );
+  LOG_INFO( "TransformImageToProbe difference compared to baseline: translation " << translationError << " mm, rotation " << rotationError << " degree" );
+  if ( translationError > translationErrorThreshold )
+  {
+    LOG_ERROR( "TransformImageToProbe translation difference (compared to baseline) is higher than expected: " << translationError << " mm (threshold: " << translationErrorThreshold << " mm). " );
+    numberOfFailures++;
+  }
+  if ( rotationError > rotationErrorThreshold )
+  {
+    LOG_ERROR( "TransformImageToProbe rotation difference (compared to baseline) is higher than expected: " << rotationError << " degree (threshold: " << rotationErrorThreshold << " degree). " );
+    numberOfFailures++;
+  }
+  return numberOfFailures;
+}
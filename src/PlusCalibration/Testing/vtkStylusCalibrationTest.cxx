@@ -44,6 +44,7 @@ int main (int argc, char* argv[])
   int numberOfPointsToAcquire=100;
   int verboseLevel=vtkPlusLogger::LOG_LEVEL_UNDEFINED;
   double outlierGenerationProbability=0.0;
+  bool incrementalCalibration=false;
 
   vtksys::CommandLineArguments cmdargs;
   cmdargs.Initialize(argc, argv);
@@ -52,6 +53,7 @@ int main (int argc, char* argv[])
   cmdargs.AddArgument("--baseline-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputBaselineFileName, "Name of file storing baseline calibration results");
   cmdargs.AddArgument("--number-of-points-to-acquire", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfPointsToAcquire, "Number of acquired points during the pivot calibration (default: 100)");
   cmdargs.AddArgument("--outlier-generation-probability", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outlierGenerationProbability, "Probability for a point being an outlier. If this number is larger than 0 then some valid measurement points are replaced by randomly generated samples to test the robustness of the algorithm. (range: 0.0-1.0; default: 0.0)");
+  cmdargs.AddArgument("--incremental-calibration", vtksys::CommandLineArguments::NO_ARGUMENT, &incrementalCalibration, "Use the incrementally computed pivot point as calibration result instead of solving the complete system after the acquisition");
   cmdargs.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");  
 
   if ( !cmdargs.Parse() )
@@ -128,6 +130,10 @@ int main (int argc, char* argv[])
     LOG_ERROR("Unable to read pivot calibration configuration!");
     exit(EXIT_FAILURE);
   }
+  if (incrementalCalibration)
+  {
+    pivotCalibration->IncrementalCalibrationOn();
+  }
 
   // Create and initialize transform repository
   PlusTrackedFrame trackedFrame;
@@ -201,6 +207,15 @@ int main (int argc, char* argv[])
     }
 
     pivotCalibration->InsertNextCalibrationPoint(stylusToReferenceMatrix);
+
+    double pivotPoint_Marker[3] = {0, 0, 0};
+    double pivotPoint_Reference[3] = {0, 0, 0};
+    if (pivotCalibration->GetIncrementalPivotPointPosition(pivotPoint_Marker, pivotPoint_Reference) == PLUS_SUCCESS)
+    {
+      LOG_DEBUG("Point " << i << ": pivot point = " << pivotPoint_Marker[0] << " x " << pivotPoint_Marker[1] << " x " << pivotPoint_Marker[2]
+        << ", RMS error = " << pivotCalibration->GetIncrementalCalibrationError() << " mm, condition number = " << pivotCalibration->GetIncrementalConditionNumber()
+        << ", outliers = " << pivotCalibration->GetNumberOfIncrementallyDetectedOutliers());
+    }
   }
   vtkPlusLogger::PrintProgressbar(100.0); 
 
@@ -45,6 +45,7 @@ int main (int argc, char* argv[])
   std::string inputProbeToReferenceTransformName("ProbeToReference"); 
   double inputTranslationErrorThreshold(1e-10); 
   double inputRotationErrorThreshold(1e-10); 
+  std::string optimizerAlgorithm;
 
   int verboseLevel=vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
@@ -60,6 +61,7 @@ int main (int argc, char* argv[])
   cmdargs.AddArgument("--baseline-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputBaselineFileName, "Name of file storing baseline calibration results");
   cmdargs.AddArgument("--translation-error-threshold", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputTranslationErrorThreshold, "Translation error threshold in mm.");  
   cmdargs.AddArgument("--rotation-error-threshold", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputRotationErrorThreshold, "Rotation error threshold in degrees.");  
+  cmdargs.AddArgument("--optimizer-algorithm", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &optimizerAlgorithm, "Override the calibration optimizer algorithm defined in the configuration file (POWELL or LEVENBERG_MARQUARDT).");  
   cmdargs.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");  
 
   if ( !cmdargs.Parse() )
@@ -196,6 +198,22 @@ int main (int argc, char* argv[])
   // Initialize the probe calibration algo 
   vtkSmartPointer<vtkPlusProbeCalibrationAlgo> probeCal = vtkSmartPointer<vtkPlusProbeCalibrationAlgo>::New(); 
   probeCal->ReadConfiguration(configRootElement); 
+  if (!optimizerAlgorithm.empty())
+  {
+    if (STRCASECMP(optimizerAlgorithm.c_str(), vtkPlusProbeCalibrationOptimizerAlgo::GetOptimizerAlgorithmAsString(vtkPlusProbeCalibrationOptimizerAlgo::OPTIMIZER_LEVENBERG_MARQUARDT)) == 0)
+    {
+      probeCal->GetOptimizer()->SetOptimizerAlgorithm(vtkPlusProbeCalibrationOptimizerAlgo::OPTIMIZER_LEVENBERG_MARQUARDT);
+    }
+    else if (STRCASECMP(optimizerAlgorithm.c_str(), vtkPlusProbeCalibrationOptimizerAlgo::GetOptimizerAlgorithmAsString(vtkPlusProbeCalibrationOptimizerAlgo::OPTIMIZER_POWELL)) == 0)
+    {
+      probeCal->GetOptimizer()->SetOptimizerAlgorithm(vtkPlusProbeCalibrationOptimizerAlgo::OPTIMIZER_POWELL);
+    }
+    else
+    {
+      LOG_ERROR("Unknown optimizer algorithm: " << optimizerAlgorithm);
+      exit(EXIT_FAILURE);
+    }
+  }
 
   // Calibrate
   if (probeCal->Calibrate( validationTrackedFrameList, calibrationTrackedFrameList, transformRepository, patternRecognition.GetFidLineFinder()->GetNWires()) != PLUS_SUCCESS)
@@ -328,6 +346,7 @@ int CompareCalibrationResultsWithBaseline(const char* baselineFileName, const ch
         }
 
         double rotationError = PlusMath::GetOrientationDifference(baseTransMatrix, currentTransMatrix); 
+        LOG_INFO("TransformImageToProbe difference compared to baseline: translation " << translationError << " mm, rotation " << rotationError << " degree");
         if ( rotationError > rotationErrorThreshold )
         {
           LOG_ERROR("TransformImageToProbe rotation error is higher than expected: " << rotationError << " degree (threshold: " << rotationErrorThreshold << " degree). " );
@@ -15,10 +15,8 @@ See License.txt for details.
 
 // ITK includes
 #include <itkBinaryThresholdImageFilter.h>
-#include <itkImageDuplicator.h>
 #include <itkImageFileWriter.h>
 #include <itkImageRegionIterator.h>
-#include <itkLineIterator.h>
 #include <itkOtsuThresholdImageFilter.h>
 #include <itkRGBPixel.h>
 #include <itkResampleImageFilter.h>
@@ -29,6 +27,7 @@ See License.txt for details.
 #include <vtkContextScene.h>
 #include <vtkContextView.h>
 #include <vtkDoubleArray.h>
+#include <vtkImageData.h>
 #include <vtkIntArray.h>
 #include <vtkObjectFactory.h>
 #include <vtkPen.h>
@@ -71,6 +70,7 @@ vtkPlusLineSegmentationAlgo::vtkPlusLineSegmentationAlgo()
   , PlotIntensityProfile(false)
   , m_SignalTimeRangeMin(0.0)
   , m_SignalTimeRangeMax(-1.0)
+  , NumberOfThreads(0)
 {
   m_ClipRectangleOrigin[0] = 0;
   m_ClipRectangleOrigin[1] = 0;
@@ -179,6 +179,14 @@ PlusStatus vtkPlusLineSegmentationAlgo::VerifyVideoInput()
   return PLUS_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
+struct SegmentFramesThreadFunctionInfoStruct
+{
+  vtkPlusLineSegmentationAlgo* Algo;
+  /*! Detected position of the line on each frame (only valid if the line was detected) */
+  std::vector<double>* FrameSignalValues;
+};
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric()
 {
@@ -191,216 +199,269 @@ PlusStatus vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric()
   nonDetectedLineParams.lineOriginPoint_Image[1] = 0;
   nonDetectedLineParams.lineDirectionVector_Image[0] = 0;
   nonDetectedLineParams.lineDirectionVector_Image[1] = 1;
-  m_LineParameters.assign(m_TrackedFrameList->GetNumberOfTrackedFrames(), nonDetectedLineParams);
+  const unsigned int numberOfFrames = m_TrackedFrameList->GetNumberOfTrackedFrames();
+  m_LineParameters.assign(numberOfFrames, nonDetectedLineParams);
+  std::vector<double> frameSignalValues(numberOfFrames, 0.0);
 
   //  For each video frame, detect line and extract mindpoint and slope parameters
-  int numberOfSuccessfulLineSegmentations = 0;
-  bool signalTimeRangeDefined = (m_SignalTimeRangeMin <= m_SignalTimeRangeMax);
-  for (unsigned int frameNumber = 0; frameNumber < m_TrackedFrameList->GetNumberOfTrackedFrames(); ++frameNumber)
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+  if (this->NumberOfThreads > 0)
   {
-    LOG_TRACE("Calculating video position metric for frame " << frameNumber);
-    PlusTrackedFrame* trackedFrame = m_TrackedFrameList->GetTrackedFrame(frameNumber);
-    if (signalTimeRangeDefined && (trackedFrame->GetTimestamp() < m_SignalTimeRangeMin || trackedFrame->GetTimestamp() > m_SignalTimeRangeMax))
-    {
-      // frame is out of the specified signal range
-      LOG_TRACE("Skip frame, it is out of the valid signal range");
-      continue;
-    }
+    threader->SetNumberOfThreads(this->NumberOfThreads);
+  }
+  if (m_SaveIntermediateImages || this->PlotIntensityProfile)
+  {
+    // Debug outputs are generated in frame order, and plots can only be displayed from the main thread
+    threader->SetNumberOfThreads(1);
+  }
+  SegmentFramesThreadFunctionInfoStruct str;
+  str.Algo = this;
+  str.FrameSignalValues = &frameSignalValues;
+  threader->SetSingleMethod(SegmentFramesThreadFunction, &str);
+  threader->SingleMethodExecute();
 
-    // Get current image
-    if (trackedFrame->GetImageData()->GetVTKScalarPixelType() != VTK_UNSIGNED_CHAR)
-    {
-      LOG_ERROR("vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric only supports 8-bit images");
-      continue;
-    }
-    CharImageType::Pointer localImage = CharImageType::New();
-    PlusVideoFrame::DeepCopyVtkVolumeToItkImage<CharPixelType>(trackedFrame->GetImageData()->GetImage(), localImage);
-    if (localImage.IsNull())
+  // Collect the results in frame order
+  int numberOfSuccessfulLineSegmentations = 0;
+  for (unsigned int frameNumber = 0; frameNumber < numberOfFrames; ++frameNumber)
+  {
+    if (!m_LineParameters[frameNumber].lineDetected)
     {
-      // Dropped frame
-      LOG_ERROR("vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric failed to retrieve image data from frame");
       continue;
     }
+    ++numberOfSuccessfulLineSegmentations;
+    m_SignalValues.push_back(frameSignalValues[frameNumber]);
+    m_SignalTimestamps.push_back(m_TrackedFrameList->GetTrackedFrame(frameNumber)->GetTimestamp());
+  }
 
-    // Create an image duplicator to copy the original image
-    typedef itk::ImageDuplicator<CharImageType> DuplicatorType;
-    DuplicatorType::Pointer duplicator = DuplicatorType::New();
-    CharImageType::Pointer scanlineImage;
-    if (m_SaveIntermediateImages == true)
-    {
-      duplicator->SetInputImage(localImage);
-      duplicator->Update();
+  double segmentationSuccessRate = double(numberOfSuccessfulLineSegmentations) / numberOfFrames;
+  if (segmentationSuccessRate < EXPECTED_LINE_SEGMENTATION_SUCCESS_RATE)
+  {
+    LOG_WARNING("Line segmentation success rate is very low (" << segmentationSuccessRate * 100 << "%): a line could only be detected on " << numberOfSuccessfulLineSegmentations << " frames out of " << numberOfFrames);
+  }
 
-      // Create an image copy to draw the scanlines on
-      scanlineImage = duplicator->GetOutput();
-    }
+  bool plotVideoMetric = vtkPlusLogger::Instance()->GetLogLevel() >= vtkPlusLogger::LOG_LEVEL_TRACE;
+  if (plotVideoMetric)
+  {
+    PlotDoubleArray(m_SignalValues);
+  }
 
-    std::vector<itk::Point<double, 2> > intensityPeakPositions;
-    CharImageType::RegionType region = localImage->GetLargestPossibleRegion();
-    LimitToClipRegion(region);
+  return PLUS_SUCCESS;
 
-    int numOfValidScanlines = 0;
+} //  End LineDetection
 
-    for (int currScanlineNum = 0; currScanlineNum < NUMBER_OF_SCANLINES; ++currScanlineNum)
+//-----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkPlusLineSegmentationAlgo::SegmentFramesThreadFunction(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  SegmentFramesThreadFunctionInfoStruct* str = static_cast<SegmentFramesThreadFunctionInfoStruct*>(threadInfo->UserData);
+  vtkPlusLineSegmentationAlgo* self = str->Algo;
+  unsigned int threadId = threadInfo->ThreadID;
+  unsigned int threadCount = threadInfo->NumberOfThreads;
+
+  // Buffers are owned by this thread and reused for all its frames to avoid reallocations
+  FrameSegmentationWorkspace workspace;
+  LineParameters params;
+  double signalValue = 0;
+
+  // Frames are interleaved between the threads, because frames outside the signal time range are skipped quickly
+  // and so contiguous blocks of frames would distribute the work unevenly.
+  // Each frame's results are written to its own element in the output arrays, so no synchronization is needed.
+  const unsigned int numberOfFrames = self->m_TrackedFrameList->GetNumberOfTrackedFrames();
+  for (unsigned int frameNumber = threadId; frameNumber < numberOfFrames; frameNumber += threadCount)
+  {
+    if (self->SegmentFrame(frameNumber, workspace, params, signalValue) == PLUS_SUCCESS)
     {
-      // Set the scanline start pixel
-      CharImageType::IndexType startPixel;
-      double scanlineSpacingPix = static_cast<double>(region.GetSize()[0] - 1) / (NUMBER_OF_SCANLINES - 1);
-      startPixel[0] = region.GetIndex()[0] + scanlineSpacingPix * (currScanlineNum);
-      startPixel[1] = region.GetIndex()[1];
-
-      // Set the scanline end pixel
-      CharImageType::IndexType endPixel;
-      endPixel[0] = startPixel[0];
-      endPixel[1] = startPixel[1] + region.GetSize()[1] - 1;
-
-      std::deque<int> intensityProfile; // Holds intensity profile of the line
-      itk::LineIterator<CharImageType> it(localImage, startPixel, endPixel);
-      it.GoToBegin();
-
-      itk::LineIterator<CharImageType>* itScanlineImage = NULL;
-      if (m_SaveIntermediateImages == true)
-      {
-        // Iterator for the scanline image copy
-        // it's time-consuming to instantiate this iterator, so only do it if intermediate image saving is requested
-        itScanlineImage = new itk::LineIterator<CharImageType>(scanlineImage, startPixel, endPixel);
-        itScanlineImage->GoToBegin();
-      }
+      self->m_LineParameters[frameNumber] = params;
+      (*str->FrameSignalValues)[frameNumber] = signalValue;
+    }
+  }
 
-      while (!it.IsAtEnd())
-      {
-        intensityProfile.push_back((int)it.Get());
-        if (m_SaveIntermediateImages == true)
-        {
-          // Set the pixels on the scanline image copy to white
-          itScanlineImage->Set(255);
-          ++(*itScanlineImage);
-        }
-        ++it;
-      }
+  return VTK_THREAD_RETURN_VALUE;
+}
 
-      // Delete the iterator declared with new()
-      if (itScanlineImage != NULL)
-      {
-        delete itScanlineImage;
-        itScanlineImage = NULL;
-      }
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusLineSegmentationAlgo::SegmentFrame(unsigned int frameNumber, FrameSegmentationWorkspace& workspace, LineParameters& lineParameters, double& signalValue)
+{
+  LOG_TRACE("Calculating video position metric for frame " << frameNumber);
+  PlusTrackedFrame* trackedFrame = m_TrackedFrameList->GetTrackedFrame(frameNumber);
+  bool signalTimeRangeDefined = (m_SignalTimeRangeMin <= m_SignalTimeRangeMax);
+  if (signalTimeRangeDefined && (trackedFrame->GetTimestamp() < m_SignalTimeRangeMin || trackedFrame->GetTimestamp() > m_SignalTimeRangeMax))
+  {
+    // frame is out of the specified signal range
+    LOG_TRACE("Skip frame, it is out of the valid signal range");
+    return PLUS_FAIL;
+  }
 
-      if (this->PlotIntensityProfile)
-      {
-        // Plot the intensity profile
-        PlotIntArray(intensityProfile);
-      }
+  // Get current image
+  if (trackedFrame->GetImageData()->GetVTKScalarPixelType() != VTK_UNSIGNED_CHAR)
+  {
+    LOG_ERROR("vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric only supports 8-bit images");
+    return PLUS_FAIL;
+  }
+  vtkImageData* frameImage = trackedFrame->GetImageData()->GetImage();
+  const unsigned char* framePixels = static_cast<const unsigned char*>(frameImage->GetScalarPointer());
+  if (framePixels == NULL || frameImage->GetNumberOfScalarComponents() != 1)
+  {
+    // Dropped frame
+    LOG_ERROR("vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric failed to retrieve image data from frame");
+    return PLUS_FAIL;
+  }
+  int frameSize[3] = {0, 0, 0};
+  frameImage->GetDimensions(frameSize);
 
-      // Find the max intensity value from the peak with the largest area
-      int maxFromLargestArea = -1;
-      int maxFromLargestAreaIndex = -1;
-      int startOfMaxArea = -1;
-      if (FindLargestPeak(intensityProfile, maxFromLargestArea, maxFromLargestAreaIndex, startOfMaxArea) == PLUS_SUCCESS)
-      {
-        double currPeakPos_y = -1;
-        switch (PEAK_POS_METRIC)
-        {
-        case PEAK_POS_COG:
-        {
-          /* Use center-of-gravity (COG) as peak-position metric*/
-          if (ComputeCenterOfGravity(intensityProfile, startOfMaxArea, currPeakPos_y) != PLUS_SUCCESS)
-          {
-            // unable to compute center-of-gravity; this scanline is invalid
-            continue;
-          }
-          break;
-        }
-        case PEAK_POS_START:
-        {
-          /* Use peak start as peak-position metric*/
-          if (FindPeakStart(intensityProfile, maxFromLargestArea, startOfMaxArea, currPeakPos_y) != PLUS_SUCCESS)
-          {
-            // unable to compute peak start; this scanline is invalid
-            continue;
-          }
-          break;
-        }
-        }
+  CharImageType::Pointer scanlineImage;
+  if (m_SaveIntermediateImages == true)
+  {
+    // Create an image copy to draw the scanlines on
+    scanlineImage = CharImageType::New();
+    PlusVideoFrame::DeepCopyVtkVolumeToItkImage<CharPixelType>(frameImage, scanlineImage);
+  }
 
-        itk::Point<double, 2> currPeakPos;
-        currPeakPos[0] = static_cast<double>(startPixel[0]);
-        currPeakPos[1] = startPixel[1] + currPeakPos_y;
-        intensityPeakPositions.push_back(currPeakPos);
-        ++numOfValidScanlines;
+  std::vector<int>& intensityProfile = workspace.IntensityProfile; // Holds intensity profile of the line
+  std::vector<itk::Point<double, 2> >& intensityPeakPositions = workspace.IntensityPeakPositions;
+  intensityPeakPositions.clear();
 
-      } // end if() found intensity peak
+  CharImageType::RegionType region;
+  CharImageType::IndexType imageOrigin;
+  imageOrigin.Fill(0);
+  CharImageType::SizeType imageSize;
+  imageSize[0] = frameSize[0];
+  imageSize[1] = frameSize[1];
+  region.SetIndex(imageOrigin);
+  region.SetSize(imageSize);
+  LimitToClipRegion(region);
 
-    } // end currScanlineNum loop
+  int numOfValidScanlines = 0;
 
-    if (numOfValidScanlines < MINIMUM_NUMBER_OF_VALID_SCANLINES)
+  for (int currScanlineNum = 0; currScanlineNum < NUMBER_OF_SCANLINES; ++currScanlineNum)
+  {
+    // Set the scanline start pixel
+    CharImageType::IndexType startPixel;
+    double scanlineSpacingPix = static_cast<double>(region.GetSize()[0] - 1) / (NUMBER_OF_SCANLINES - 1);
+    startPixel[0] = region.GetIndex()[0] + scanlineSpacingPix * (currScanlineNum);
+    startPixel[1] = region.GetIndex()[1];
+
+    // Set the scanline end pixel
+    CharImageType::IndexType endPixel;
+    endPixel[0] = startPixel[0];
+    endPixel[1] = startPixel[1] + region.GetSize()[1] - 1;
+
+    // The scanline is an image column, read it directly from the frame buffer
+    intensityProfile.clear();
+    const unsigned char* scanlinePixel = framePixels + startPixel[1] * frameSize[0] + startPixel[0];
+    for (CharImageType::IndexValueType y = startPixel[1]; y <= endPixel[1]; ++y, scanlinePixel += frameSize[0])
     {
-      //TODO: drop the frame from the analysis
-      LOG_DEBUG("Only " << numOfValidScanlines << " valid scanlines; this is less than the required " << MINIMUM_NUMBER_OF_VALID_SCANLINES << ". Skipping frame" << frameNumber);
+      intensityProfile.push_back(*scanlinePixel);
     }
 
-    LineParameters params;
-    ComputeLineParameters(intensityPeakPositions, params);
-    if (!params.lineDetected)
+    if (m_SaveIntermediateImages == true)
     {
-      LOG_DEBUG("Unable to compute line parameters for frame " << frameNumber);
-      continue;
+      // Set the pixels on the scanline image copy to white
+      CharPixelType* scanlineImagePixel = scanlineImage->GetBufferPointer() + startPixel[1] * frameSize[0] + startPixel[0];
+      for (CharImageType::IndexValueType y = startPixel[1]; y <= endPixel[1]; ++y, scanlineImagePixel += frameSize[0])
+      {
+        *scanlineImagePixel = 255;
+      }
     }
-    if (params.lineDirectionVector_Image[0] < MIN_X_SLOPE_COMPONENT_FOR_DETECTED_LINE)
+
+    if (this->PlotIntensityProfile)
     {
-      // Line is close to vertical, skip frame because intersection of
-      // line with image's horizontal half point is unstable
-      LOG_TRACE("Line on frame " << frameNumber << " is too close to vertical, skip the frame");
-      continue;
+      // Plot the intensity profile
+      PlotIntArray(intensityProfile);
     }
 
-    ++numberOfSuccessfulLineSegmentations;
-    m_LineParameters[frameNumber] = params;
+    // Find the max intensity value from the peak with the largest area
+    int maxFromLargestArea = -1;
+    int maxFromLargestAreaIndex = -1;
+    int startOfMaxArea = -1;
+    if (FindLargestPeak(intensityProfile, maxFromLargestArea, maxFromLargestAreaIndex, startOfMaxArea) == PLUS_SUCCESS)
+    {
+      double currPeakPos_y = -1;
+      switch (PEAK_POS_METRIC)
+      {
+      case PEAK_POS_COG:
+      {
+        /* Use center-of-gravity (COG) as peak-position metric*/
+        if (ComputeCenterOfGravity(intensityProfile, startOfMaxArea, currPeakPos_y) != PLUS_SUCCESS)
+        {
+          // unable to compute center-of-gravity; this scanline is invalid
+          continue;
+        }
+        break;
+      }
+      case PEAK_POS_START:
+      {
+        /* Use peak start as peak-position metric*/
+        if (FindPeakStart(intensityProfile, maxFromLargestArea, startOfMaxArea, currPeakPos_y) != PLUS_SUCCESS)
+        {
+          // unable to compute peak start; this scanline is invalid
+          continue;
+        }
+        break;
+      }
+      }
 
-    // Store the y-value of the line, when the line's x-value is half of the image's width
-    double t = (region.GetIndex()[0] + 0.5 * region.GetSize()[0] - params.lineOriginPoint_Image[0]) / params.lineDirectionVector_Image[0];
-    m_SignalValues.push_back(std::abs(params.lineOriginPoint_Image[1] + t * params.lineDirectionVector_Image[1]));
+      itk::Point<double, 2> currPeakPos;
+      currPeakPos[0] = static_cast<double>(startPixel[0]);
+      currPeakPos[1] = startPixel[1] + currPeakPos_y;
+      intensityPeakPositions.push_back(currPeakPos);
+      ++numOfValidScanlines;
 
-    //  Store timestamp for image frame
-    m_SignalTimestamps.push_back(m_TrackedFrameList->GetTrackedFrame(frameNumber)->GetTimestamp());
+    } // end if() found intensity peak
 
-    if (m_SaveIntermediateImages == true)
-    {
-      SaveIntermediateImage(frameNumber, scanlineImage,
-                            params.lineOriginPoint_Image[0], params.lineOriginPoint_Image[1], params.lineDirectionVector_Image[0], params.lineDirectionVector_Image[1],
-                            numOfValidScanlines, intensityPeakPositions);
-    }
+  } // end currScanlineNum loop
 
-  } // end frameNum loop
+  if (numOfValidScanlines < MINIMUM_NUMBER_OF_VALID_SCANLINES)
+  {
+    //TODO: drop the frame from the analysis
+    LOG_DEBUG("Only " << numOfValidScanlines << " valid scanlines; this is less than the required " << MINIMUM_NUMBER_OF_VALID_SCANLINES << ". Skipping frame" << frameNumber);
+  }
 
-  double segmentationSuccessRate = double(numberOfSuccessfulLineSegmentations) / m_TrackedFrameList->GetNumberOfTrackedFrames();
-  if (segmentationSuccessRate < EXPECTED_LINE_SEGMENTATION_SUCCESS_RATE)
+  ComputeLineParameters(intensityPeakPositions, lineParameters);
+  if (!lineParameters.lineDetected)
   {
-    LOG_WARNING("Line segmentation success rate is very low (" << segmentationSuccessRate * 100 << "%): a line could only be detected on " << numberOfSuccessfulLineSegmentations << " frames out of " << m_TrackedFrameList->GetNumberOfTrackedFrames());
+    LOG_DEBUG("Unable to compute line parameters for frame " << frameNumber);
+    return PLUS_FAIL;
+  }
+  if (lineParameters.lineDirectionVector_Image[0] < MIN_X_SLOPE_COMPONENT_FOR_DETECTED_LINE)
+  {
+    // Line is close to vertical, skip frame because intersection of
+    // line with image's horizontal half point is unstable
+    LOG_TRACE("Line on frame " << frameNumber << " is too close to vertical, skip the frame");
+    return PLUS_FAIL;
   }
 
-  bool plotVideoMetric = vtkPlusLogger::Instance()->GetLogLevel() >= vtkPlusLogger::LOG_LEVEL_TRACE;
-  if (plotVideoMetric)
+  // Store the y-value of the line, when the line's x-value is half of the image's width
+  double t = (region.GetIndex()[0] + 0.5 * region.GetSize()[0] - lineParameters.lineOriginPoint_Image[0]) / lineParameters.lineDirectionVector_Image[0];
+  signalValue = std::abs(lineParameters.lineOriginPoint_Image[1] + t * lineParameters.lineDirectionVector_Image[1]);
+
+  if (m_SaveIntermediateImages == true)
   {
-    PlotDoubleArray(m_SignalValues);
+    SaveIntermediateImage(frameNumber, scanlineImage,
+                          lineParameters.lineOriginPoint_Image[0], lineParameters.lineOriginPoint_Image[1], lineParameters.lineDirectionVector_Image[0], lineParameters.lineDirectionVector_Image[1],
+                          numOfValidScanlines, intensityPeakPositions);
   }
 
   return PLUS_SUCCESS;
-
-} //  End LineDetection
+}
 
 //-----------------------------------------------------------------------------
-PlusStatus vtkPlusLineSegmentationAlgo::FindPeakStart(std::deque<int>& intensityProfile, int maxFromLargestArea, int startOfMaxArea, double& startOfPeak)
+PlusStatus vtkPlusLineSegmentationAlgo::FindPeakStart(const std::vector<int>& intensityProfile, int maxFromLargestArea, int startOfMaxArea, double& startOfPeak)
 {
   // Start of peak is defined as the location at which it reaches 50% of its maximum value.
   double startPeakValue = maxFromLargestArea * 0.5;
 
   int pixelIndex = startOfMaxArea;
+  const int profileSize = intensityProfile.size();
 
-  while (intensityProfile.at(pixelIndex) <= startPeakValue)
+  while (pixelIndex < profileSize && intensityProfile[pixelIndex] <= startPeakValue)
   {
     ++pixelIndex;
   }
+  if (pixelIndex >= profileSize)
+  {
+    return PLUS_FAIL;
+  }
 
   startOfPeak = --pixelIndex;
 
@@ -408,7 +469,7 @@ PlusStatus vtkPlusLineSegmentationAlgo::FindPeakStart(std::deque<int>& intensity
 }
 
 //-----------------------------------------------------------------------------
-PlusStatus vtkPlusLineSegmentationAlgo::FindLargestPeak(std::deque<int>& intensityProfile, int& maxFromLargestArea, int& maxFromLargestAreaIndex, int& startOfMaxArea)
+PlusStatus vtkPlusLineSegmentationAlgo::FindLargestPeak(const std::vector<int>& intensityProfile, int& maxFromLargestArea, int& maxFromLargestAreaIndex, int& startOfMaxArea)
 {
   int currentLargestArea = 0;
   int currentArea = 0;
@@ -426,12 +487,12 @@ PlusStatus vtkPlusLineSegmentationAlgo::FindLargestPeak(std::deque<int>& intensi
     return PLUS_FAIL;
   }
 
-  double intensityMax = intensityProfile.at(0);
+  double intensityMax = intensityProfile[0];
   for (unsigned int pixelLoc = 1; pixelLoc < intensityProfile.size(); ++pixelLoc)
   {
-    if (intensityProfile.at(pixelLoc) > intensityMax)
+    if (intensityProfile[pixelLoc] > intensityMax)
     {
-      intensityMax = intensityProfile.at(pixelLoc);
+      intensityMax = intensityProfile[pixelLoc];
     }
   }
 
@@ -439,27 +500,27 @@ PlusStatus vtkPlusLineSegmentationAlgo::FindLargestPeak(std::deque<int>& intensi
 
   for (unsigned int pixelLoc = 0; pixelLoc < intensityProfile.size(); ++pixelLoc)
   {
-    if (intensityProfile.at(pixelLoc) > peakIntensityThreshold  && !underPeak)
+    if (intensityProfile[pixelLoc] > peakIntensityThreshold  && !underPeak)
     {
       // reached start of the peak
       underPeak = true;
-      currentMax = intensityProfile.at(pixelLoc);
+      currentMax = intensityProfile[pixelLoc];
       currentMaxIndex = pixelLoc;
-      currentArea = intensityProfile.at(pixelLoc);
+      currentArea = intensityProfile[pixelLoc];
       currentStart = pixelLoc;
     }
-    else if (intensityProfile.at(pixelLoc) > peakIntensityThreshold  && underPeak)
+    else if (intensityProfile[pixelLoc] > peakIntensityThreshold  && underPeak)
     {
       // still under the the peak, cumulate the area
-      currentArea += intensityProfile.at(pixelLoc);
+      currentArea += intensityProfile[pixelLoc];
 
-      if (intensityProfile.at(pixelLoc) > currentMax)
+      if (intensityProfile[pixelLoc] > currentMax)
       {
-        currentMax = intensityProfile.at(pixelLoc);
+        currentMax = intensityProfile[pixelLoc];
         currentMaxIndex = pixelLoc;
       }
     }
-    else if (intensityProfile.at(pixelLoc) < peakIntensityThreshold && underPeak)
+    else if (intensityProfile[pixelLoc] < peakIntensityThreshold && underPeak)
     {
       // exited the peak area
       underPeak = false;
@@ -487,31 +548,32 @@ PlusStatus vtkPlusLineSegmentationAlgo::FindLargestPeak(std::deque<int>& intensi
 }
 //-----------------------------------------------------------------------------
 
-PlusStatus vtkPlusLineSegmentationAlgo::ComputeCenterOfGravity(std::deque<int>& intensityProfile, int startOfMaxArea, double& centerOfGravity)
+PlusStatus vtkPlusLineSegmentationAlgo::ComputeCenterOfGravity(const std::vector<int>& intensityProfile, int startOfMaxArea, double& centerOfGravity)
 {
   if (intensityProfile.size() == 0)
   {
     return PLUS_FAIL;
   }
 
-  double intensityMax = intensityProfile.at(0);
+  double intensityMax = intensityProfile[0];
   for (unsigned int pixelLoc = 1; pixelLoc < intensityProfile.size(); ++pixelLoc)
   {
-    if (intensityProfile.at(pixelLoc) > intensityMax)
+    if (intensityProfile[pixelLoc] > intensityMax)
     {
-      intensityMax = intensityProfile.at(pixelLoc);
+      intensityMax = intensityProfile[pixelLoc];
     }
   }
 
   double peakIntensityThreshold = intensityMax * INTESNITY_THRESHOLD_PERCENTAGE_OF_PEAK;
 
   int pixelLoc = startOfMaxArea;
+  const int profileSize = intensityProfile.size();
   int pointsInPeak = 0;
   double intensitySum = 0;
-  while (intensityProfile.at(pixelLoc) > peakIntensityThreshold)
+  while (pixelLoc < profileSize && intensityProfile[pixelLoc] > peakIntensityThreshold)
   {
-    intensitySum += pixelLoc * intensityProfile.at(pixelLoc);
-    pointsInPeak += intensityProfile.at(pixelLoc);
+    intensitySum += pixelLoc * intensityProfile[pixelLoc];
+    pointsInPeak += intensityProfile[pixelLoc];
     ++pixelLoc;
   }
 
@@ -555,6 +617,8 @@ void vtkPlusLineSegmentationAlgo::ComputeLineParameters(std::vector<itk::Point<d
   //create and initialize the RANSAC algorithm
   double desiredProbabilityForNoOutliers = 0.999;
   RANSACType::Pointer ransacEstimator = RANSACType::New();
+  // Fixed seed makes the detected lines (and so the temporal calibration results) reproducible
+  ransacEstimator->SetRandomSeed(0);
 
   try
   {
@@ -729,7 +793,7 @@ PlusStatus vtkPlusLineSegmentationAlgo::Update()
 }
 
 //-----------------------------------------------------------------------------
-void vtkPlusLineSegmentationAlgo::PlotIntArray(const std::deque<int>& intensityValues)
+void vtkPlusLineSegmentationAlgo::PlotIntArray(const std::vector<int>& intensityValues)
 {
   //  Create table
   vtkSmartPointer<vtkTable> table = vtkSmartPointer<vtkTable>::New();
@@ -916,6 +980,7 @@ PlusStatus vtkPlusLineSegmentationAlgo::ReadConfiguration(vtkXMLDataElement* aCo
 
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(SaveIntermediateImages, lineSegmentationElement);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(PlotIntensityProfile, lineSegmentationElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfThreads, lineSegmentationElement);
 
   this->IntermediateFilesOutputDirectory = vtkPlusConfig::GetInstance()->GetOutputDirectory();
   XML_READ_CSTRING_ATTRIBUTE_OPTIONAL(IntermediateFilesOutputDirectory, lineSegmentationElement);
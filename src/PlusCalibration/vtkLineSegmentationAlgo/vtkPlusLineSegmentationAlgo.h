@@ -10,7 +10,9 @@
 #include "itkImage.h"
 #include "vtkPlusCalibrationExport.h"
 #include "vtkObject.h"
+#include "vtkMultiThreader.h"
 #include <deque>
+#include <vector>
 
 class PlusTrackedFrame;
 class vtkPlusTrackedFrameList;
@@ -18,6 +20,8 @@ class vtkPlusTrackedFrameList;
 /*!
   \class vtkPlusLineSegmentationAlgo
   \brief Detect the position of a line (image of a plane) in an US image sequence.
+
+  Frames are processed in parallel. The detected positions and timestamps are returned in the order of the input frames.
   \ingroup PlusLibCalibrationAlgorithm
 */
 class vtkPlusCalibrationExport vtkPlusLineSegmentationAlgo : public vtkObject
@@ -81,23 +85,46 @@ public:
   vtkGetMacro(PlotIntensityProfile, bool);
   vtkSetMacro(PlotIntensityProfile, bool);
 
+  /*! Number of threads that process the frames. If 0 then the number of processor cores is used. */
+  vtkSetMacro(NumberOfThreads, int);
+  vtkGetMacro(NumberOfThreads, int);
+
 protected:
   vtkPlusLineSegmentationAlgo();
   virtual ~vtkPlusLineSegmentationAlgo();
 
   PlusStatus VerifyVideoInput();
 
+  /*! Buffers used for processing a frame. Each thread has its own instance, which is reused for all the frames that the thread processes. */
+  struct FrameSegmentationWorkspace
+  {
+    std::vector<int> IntensityProfile;
+    std::vector<itk::Point<double, 2> > IntensityPeakPositions;
+  };
+
   PlusStatus ComputeVideoPositionMetric();
 
-  PlusStatus FindPeakStart(std::deque<int>& intensityProfile, int maxFromLargestArea, int startOfMaxArea, double& startOfPeak);
+  /*!
+    Detect the line on a single frame. It does not modify the algorithm object, so it can be called for multiple frames concurrently.
+    \param frameNumber Index of the frame in the tracked frame list
+    \param workspace Buffers for the computation
+    \param lineParameters Detected line parameters
+    \param signalValue Position of the line at the horizontal center of the image
+    \return PLUS_SUCCESS if a line is detected that can be used in the signal
+  */
+  PlusStatus SegmentFrame(unsigned int frameNumber, FrameSegmentationWorkspace& workspace, LineParameters& lineParameters, double& signalValue);
+
+  static VTK_THREAD_RETURN_TYPE SegmentFramesThreadFunction(void* arg);
 
-  PlusStatus FindLargestPeak(std::deque<int>& intensityProfile, int& maxFromLargestArea, int& maxFromLargestAreaIndex, int& startOfMaxArea);
+  PlusStatus FindPeakStart(const std::vector<int>& intensityProfile, int maxFromLargestArea, int startOfMaxArea, double& startOfPeak);
 
-  PlusStatus ComputeCenterOfGravity(std::deque<int>& intensityProfile, int startOfMaxArea, double& centerOfGravity);
+  PlusStatus FindLargestPeak(const std::vector<int>& intensityProfile, int& maxFromLargestArea, int& maxFromLargestAreaIndex, int& startOfMaxArea);
+
+  PlusStatus ComputeCenterOfGravity(const std::vector<int>& intensityProfile, int startOfMaxArea, double& centerOfGravity);
 
   void ComputeLineParameters(std::vector<itk::Point<double, 2> >& data, LineParameters& outputParameters);
 
-  void PlotIntArray(const std::deque<int>& intensityValues);
+  void PlotIntArray(const std::vector<int>& intensityValues);
 
   void PlotDoubleArray(const std::deque<double>& intensityValues);
 
@@ -131,6 +158,9 @@ protected:
   /*! Clip rectangle origin for the processing (in pixels). Everything outside the rectangle is ignored. */
   CharImageType::SizeValueType m_ClipRectangleSize[2];
 
+  /*! Number of threads that process the frames. If 0 then the number of processor cores is used. */
+  int NumberOfThreads;
+
 private:
   vtkPlusLineSegmentationAlgo(const vtkPlusLineSegmentationAlgo&);
   void operator=(const vtkPlusLineSegmentationAlgo&);
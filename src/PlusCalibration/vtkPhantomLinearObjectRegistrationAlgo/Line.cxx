@@ -11,11 +11,12 @@ See License.txt for details.
 Line::Line()
 {
   this->Type = "Line";
+  this->EndPoint.fill( 0.0 );
 }
 
 //-----------------------------------------------------------------------------
 
-Line::Line( std::vector<double> newBasePoint, std::vector<double> newEndPoint )
+Line::Line( const VectorType& newBasePoint, const VectorType& newEndPoint )
 {
   this->Type = "Line";
   this->BasePoint = newBasePoint;
@@ -26,98 +27,83 @@ Line::Line( std::vector<double> newBasePoint, std::vector<double> newEndPoint )
 
 Line::~Line()
 {
-  this->EndPoint.clear();
 }
 
 //-----------------------------------------------------------------------------
 
-std::vector<double> Line::GetDirection()
+LinearObject::VectorType Line::GetDirection() const
 {
-  std::vector<double> vector = Subtract( this->EndPoint, this->BasePoint );
+  VectorType vector = Subtract( this->EndPoint, this->BasePoint );
   return Multiply( 1 / Norm( vector ), vector );
 }
 
 //-----------------------------------------------------------------------------
 
-std::vector<double> Line::ProjectVector( std::vector<double> vector )
+LinearObject::VectorType Line::ProjectVector( const VectorType& vector ) const
 {
-  std::vector<double> outVec = Subtract( vector, this->BasePoint );
-  return Add( Multiply( Dot( this->GetDirection(), outVec ), this->GetDirection() ), this->BasePoint );
+  VectorType direction = this->GetDirection();
+  VectorType outVec = Subtract( vector, this->BasePoint );
+  return Add( Multiply( Dot( direction, outVec ), direction ), this->BasePoint );
 }
 
 //-----------------------------------------------------------------------------
 
-void Line::Translate( std::vector<double> vector )
+void Line::Translate( const VectorType& vector )
 {
-  for ( unsigned int i = 0; i < vector.size(); i++ )
-  {
-    this->BasePoint.at(i) = this->BasePoint.at(i) + vector.at(i);
-  this->EndPoint.at(i) = this->EndPoint.at(i) + vector.at(i);
-  }
+  this->BasePoint += vector;
+  this->EndPoint += vector;
 }
 
 //-----------------------------------------------------------------------------
 
-std::vector<double> Line::GetOrthogonalNormal1()
+void Line::GetOrthogonalNormals( VectorType& normal1, VectorType& normal2 ) const
 {
+  VectorType direction = this->GetDirection();
+
   // Find the two axis unit vectors least parallel with the direction vector
-  std::vector<double> e1( 3, 0.0 );
-  std::vector<double> e2( 3, 0.0 );
-  if ( fabs( this->GetDirection().at(1) ) <= fabs( this->GetDirection().at(0) ) && fabs( this->GetDirection().at(2) ) <= fabs( this->GetDirection().at(0) ) )
+  VectorType e1( 0.0 );
+  VectorType e2( 0.0 );
+  if ( fabs( direction[1] ) <= fabs( direction[0] ) && fabs( direction[2] ) <= fabs( direction[0] ) )
   {
-    e1.at(0) = 0; e1.at(1) = 1; e1.at(2) = 0;
-  e2.at(0) = 0; e2.at(1) = 0; e2.at(2) = 1;
+    e1[1] = 1;
+    e2[2] = 1;
   }
-  if ( fabs( this->GetDirection().at(0) ) <= fabs( this->GetDirection().at(1) ) && fabs( this->GetDirection().at(2) ) <= fabs( this->GetDirection().at(1) ) )
+  if ( fabs( direction[0] ) <= fabs( direction[1] ) && fabs( direction[2] ) <= fabs( direction[1] ) )
   {
-    e1.at(0) = 1; e1.at(1) = 0; e1.at(2) = 0;
-  e2.at(0) = 0; e2.at(1) = 0; e2.at(2) = 1;
+    e1.fill( 0.0 ); e1[0] = 1;
+    e2.fill( 0.0 ); e2[2] = 1;
   }
-  if ( fabs( this->GetDirection().at(0) ) <= fabs( this->GetDirection().at(2) ) && fabs( this->GetDirection().at(1) ) <= fabs( this->GetDirection().at(2) ) )
+  if ( fabs( direction[0] ) <= fabs( direction[2] ) && fabs( direction[1] ) <= fabs( direction[2] ) )
   {
-    e1.at(0) = 1; e1.at(1) = 0; e1.at(2) = 0;
-  e2.at(0) = 0; e2.at(1) = 1; e2.at(2) = 0;
+    e1.fill( 0.0 ); e1[0] = 1;
+    e2.fill( 0.0 ); e2[1] = 1;
   }
 
-  std::vector<double> Normal1 = Subtract( e1, Multiply( Dot( e1, this->GetDirection() ), this->GetDirection() ) );
-  Normal1 = Multiply( 1 / Norm( Normal1 ), Normal1 );
-
-  std::vector<double> Normal2 = Subtract( e2, Add( Multiply( Dot( e2, this->GetDirection() ), this->GetDirection() ), Multiply( Dot( e2, Normal1 ), Normal1 ) ) );
-  Normal2 = Multiply( 1 / Norm( Normal2 ), Normal2 );
+  normal1 = Subtract( e1, Multiply( Dot( e1, direction ), direction ) );
+  normal1 = Multiply( 1 / Norm( normal1 ), normal1 );
 
-  return Normal1;
+  normal2 = Subtract( e2, Add( Multiply( Dot( e2, direction ), direction ), Multiply( Dot( e2, normal1 ), normal1 ) ) );
+  normal2 = Multiply( 1 / Norm( normal2 ), normal2 );
 }
 
 //-----------------------------------------------------------------------------
 
-std::vector<double> Line::GetOrthogonalNormal2()
+LinearObject::VectorType Line::GetOrthogonalNormal1() const
 {
-  // Find the two axis unit vectors least parallel with the direction vector
-  std::vector<double> e1( 3, 0.0 );
-  std::vector<double> e2( 3, 0.0 );
-  if ( fabs( this->GetDirection().at(1) ) <= fabs( this->GetDirection().at(0) ) && fabs( this->GetDirection().at(2) ) <= fabs( this->GetDirection().at(0) ) )
-  {
-    e1.at(0) = 0; e1.at(1) = 1; e1.at(2) = 0;
-  e2.at(0) = 0; e2.at(1) = 0; e2.at(2) = 1;
-  }
-  if ( fabs( this->GetDirection().at(0) ) <= fabs( this->GetDirection().at(1) ) && fabs( this->GetDirection().at(2) ) <= fabs( this->GetDirection().at(1) ) )
-  {
-    e1.at(0) = 1; e1.at(1) = 0; e1.at(2) = 0;
-  e2.at(0) = 0; e2.at(1) = 0; e2.at(2) = 1;
-  }
-  if ( fabs( this->GetDirection().at(0) ) <= fabs( this->GetDirection().at(2) ) && fabs( this->GetDirection().at(1) ) <= fabs( this->GetDirection().at(2) ) )
-  {
-    e1.at(0) = 1; e1.at(1) = 0; e1.at(2) = 0;
-  e2.at(0) = 0; e2.at(1) = 1; e2.at(2) = 0;
-  }
-
-  std::vector<double> Normal1 = Subtract( e1, Multiply( Dot( e1, this->GetDirection() ), this->GetDirection() ) );
-  Normal1 = Multiply( 1 / Norm( Normal1 ), Normal1 );
+  VectorType normal1;
+  VectorType normal2;
+  this->GetOrthogonalNormals( normal1, normal2 );
+  return normal1;
+}
 
-  std::vector<double> Normal2 = Subtract( e2, Add( Multiply( Dot( e2, this->GetDirection() ), this->GetDirection() ), Multiply( Dot( e2, Normal1 ), Normal1 ) ) );
-  Normal2 = Multiply( 1 / Norm( Normal2 ), Normal2 );
+//-----------------------------------------------------------------------------
 
-  return Normal2;
+LinearObject::VectorType Line::GetOrthogonalNormal2() const
+{
+  VectorType normal1;
+  VectorType normal2;
+  this->GetOrthogonalNormals( normal1, normal2 );
+  return normal2;
 }
 
 //-----------------------------------------------------------------------------
@@ -146,7 +132,7 @@ void Line::FromXMLElement( vtkXMLDataElement* element )
   }
 
   this->Name = std::string( element->GetAttribute( "Name" ) );
-  this->BasePoint = StringToVector( std::string( element->GetAttribute( "BasePoint" ) ), 3 );
-  this->EndPoint = StringToVector( std::string( element->GetAttribute( "EndPoint" ) ), 3 );
+  this->BasePoint = StringToVector( std::string( element->GetAttribute( "BasePoint" ) ) );
+  this->EndPoint = StringToVector( std::string( element->GetAttribute( "EndPoint" ) ) );
 
 }
\ No newline at end of file
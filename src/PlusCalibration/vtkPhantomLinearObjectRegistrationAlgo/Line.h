@@ -7,6 +7,8 @@ See License.txt for details.
 #ifndef LINE_H
 #define LINE_H
 
+#include "vtkPlusCalibrationExport.h"
+
 #include "LinearObject.h"
 #include <cmath>
 #include <sstream>
@@ -14,21 +16,24 @@ See License.txt for details.
 #include <vector>
 
 // This class stores a vector of values and a string label
-class Line : public LinearObject
+class vtkPlusCalibrationExport Line : public LinearObject
 {
 public:
-  std::vector<double> EndPoint;
+  VectorType EndPoint;
 
   Line();
-  Line( std::vector<double> newBasePoint, std::vector<double> newEndPoint );
+  Line( const VectorType& newBasePoint, const VectorType& newEndPoint );
   ~Line();
 
-  std::vector<double> GetDirection();
-  std::vector<double> ProjectVector( std::vector<double> vector );
-  void Translate( std::vector<double> vector );
+  VectorType GetDirection() const;
+  VectorType ProjectVector( const VectorType& vector ) const;
+  void Translate( const VectorType& vector );
+
+  VectorType GetOrthogonalNormal1() const;
+  VectorType GetOrthogonalNormal2() const;
 
-  std::vector<double> GetOrthogonalNormal1();
-  std::vector<double> GetOrthogonalNormal2();
+  // Compute both normals at once, they are orthogonal to each other and to the direction
+  void GetOrthogonalNormals( VectorType& normal1, VectorType& normal2 ) const;
 
   virtual std::string ToXMLString() const;
   virtual void FromXMLElement( vtkXMLDataElement* element );
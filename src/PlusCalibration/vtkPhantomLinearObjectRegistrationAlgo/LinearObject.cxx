@@ -14,36 +14,30 @@ LinearObject::LinearObject()
 {
   this->Name = "";
   this->Type = "LinearObject";
+  this->BasePoint.fill( 0.0 );
 }
 
 //-----------------------------------------------------------------------------
 
 LinearObject::~LinearObject()
 {
-  this->BasePoint.clear();
-  this->Signature.clear();
 }
 
 //-----------------------------------------------------------------------------
 
-double LinearObject::DistanceToVector( std::vector<double> vector )
+double LinearObject::DistanceToVector( const VectorType& vector ) const
 {
   return Distance( vector, this->ProjectVector( vector ) );
 }
 
 //-----------------------------------------------------------------------------
 
-double LinearObject::Distance( std::vector<double> v1, std::vector<double> v2 )
+double LinearObject::Distance( const VectorType& v1, const VectorType& v2 )
 {
-  if ( v1.size() != v2.size() )
-  {
-    return -1;
-  }
-
   double distance = 0.0;
-  for ( unsigned int i = 0; i < v1.size(); i++ )
+  for ( int i = 0; i < DIMENSION; i++ )
   {
-    distance += ( v1.at(i) - v2.at(i) ) * ( v1.at(i) - v2.at(i) );
+    distance += ( v1[i] - v2[i] ) * ( v1[i] - v2[i] );
   }
 
   return sqrt( distance );
@@ -51,110 +45,60 @@ double LinearObject::Distance( std::vector<double> v1, std::vector<double> v2 )
 
 //-----------------------------------------------------------------------------
 
-double LinearObject::Norm( std::vector<double> vector )
+double LinearObject::Norm( const VectorType& vector )
 {
-  double norm = 0.0;
-  for ( unsigned int i = 0; i < vector.size(); i++ )
-  {
-    norm += vector.at(i) * vector.at(i);
-  }
-
-  return sqrt( norm );
+  return sqrt( Dot( vector, vector ) );
 }
 
 //-----------------------------------------------------------------------------
 
-double LinearObject::Dot( std::vector<double> v1, std::vector<double> v2 )
+double LinearObject::Dot( const VectorType& v1, const VectorType& v2 )
 {
-  if ( v1.size() != v2.size() )
-  {
-    return -1;
-  }
-
-  double dot = 0.0;
-  for ( unsigned int i = 0; i < v1.size(); i++ )
-  {
-    dot += v1.at(i) * v2.at(i);
-  }
-
-  return dot;
+  return v1[0] * v2[0] + v1[1] * v2[1] + v1[2] * v2[2];
 }
 
 //-----------------------------------------------------------------------------
 
-std::vector<double> LinearObject::Cross( std::vector<double> v1, std::vector<double> v2 )
+LinearObject::VectorType LinearObject::Cross( const VectorType& v1, const VectorType& v2 )
 {
-  if ( v1.size() != 3 || v2.size() != 3 )
-  {
-    return std::vector<double>( 0, 0.0 );
-  }
-
-  std::vector<double> result( 3, 0.0 );
-  result.at(0) = v1.at(1) * v2.at(2) - v1.at(2) * v2.at(1);
-  result.at(1) = v1.at(2) * v2.at(0) - v1.at(0) * v2.at(2);
-  result.at(2) = v1.at(0) * v2.at(1) - v1.at(1) * v2.at(0);
+  VectorType result;
+  result[0] = v1[1] * v2[2] - v1[2] * v2[1];
+  result[1] = v1[2] * v2[0] - v1[0] * v2[2];
+  result[2] = v1[0] * v2[1] - v1[1] * v2[0];
 
   return result;
 }
 
 //-----------------------------------------------------------------------------
 
-std::vector<double> LinearObject::Add( std::vector<double> v1, std::vector<double> v2 )
+LinearObject::VectorType LinearObject::Add( const VectorType& v1, const VectorType& v2 )
 {
-  if ( v1.size() != v2.size() )
-  {
-    return std::vector<double>( 0, 0.0 );
-  }
-
-  std::vector<double> result( v1.size(), 0.0 );
-  for ( unsigned int i = 0; i < v1.size(); i++ )
-  {
-    result.at(i) = v1.at(i) + v2.at(i);
-  }
-
-  return result;
+  return v1 + v2;
 }
 
 //-----------------------------------------------------------------------------
 
-std::vector<double> LinearObject::Subtract( std::vector<double> v1, std::vector<double> v2 )
+LinearObject::VectorType LinearObject::Subtract( const VectorType& v1, const VectorType& v2 )
 {
-  if ( v1.size() != v2.size() )
-  {
-    return std::vector<double>( 0, 0.0 );
-  }
-
-  std::vector<double> result( v1.size(), 0.0 );
-  for ( unsigned int i = 0; i < v1.size(); i++ )
-  {
-    result.at(i) = v1.at(i) - v2.at(i);
-  }
-
-  return result;
+  return v1 - v2;
 }
 
 //-----------------------------------------------------------------------------
 
-std::vector<double> LinearObject::Multiply( double c, std::vector<double> vector )
+LinearObject::VectorType LinearObject::Multiply( double c, const VectorType& vector )
 {
-  std::vector<double> result( vector.size(), 0.0 );
-  for ( unsigned int i = 0; i < vector.size(); i++ )
-  {
-    result.at(i) = c * vector.at(i);
-  }
-
-  return result;
+  return c * vector;
 }
 
 //-----------------------------------------------------------------------------
 
-std::string LinearObject::VectorToString( std::vector<double> vector )
+std::string LinearObject::VectorToString( const VectorType& vector )
 {
   std::ostringstream s;
 
-  for ( unsigned int i = 0; i < vector.size(); i++ )
+  for ( int i = 0; i < DIMENSION; i++ )
   {
-    s << vector.at(i) << " ";
+    s << vector[i] << " ";
   }
 
   return s.str();
@@ -162,17 +106,17 @@ std::string LinearObject::VectorToString( std::vector<double> vector )
 
 //-----------------------------------------------------------------------------
 
-std::vector<double> LinearObject::StringToVector( std::string s, int size )
+LinearObject::VectorType LinearObject::StringToVector( const std::string& s )
 {
   std::stringstream ss( s );
   double value;
-  std::vector<double> vector( size, 0.0 );
+  VectorType vector( 0.0 );
 
-  for ( int i = 0; i < size; i++ )
+  for ( int i = 0; i < DIMENSION; i++ )
   {
     ss >> value;
-    vector.at(i) = value;
+    vector[i] = value;
   }
 
   return vector;
-}
+}
\ No newline at end of file
@@ -7,49 +7,53 @@ See License.txt for details.
 #ifndef LINEAROBJECT_H
 #define LINEAROBJECT_H
 
+#include "vtkPlusCalibrationExport.h"
+
 #include "vtkXMLDataElement.h"
+#include "vnl/vnl_vector_fixed.h"
 #include <cmath>
 #include <sstream>
 #include <string>
 #include <vector>
 
 // This class stores a vector of values and a string label
-class LinearObject
+class vtkPlusCalibrationExport LinearObject
 {
 public:
+  static const int DIMENSION = 3;
+
+  // Fixed size vector, stored in place, so computations with it do not allocate memory
+  typedef vnl_vector_fixed<double, DIMENSION> VectorType;
+
   std::string Name;
   std::string Type;
   std::vector<double> Signature;
-  std::vector<double> BasePoint;
-
-  static const int DIMENSION = 3;
+  VectorType BasePoint;
 
 public:
   LinearObject();
   virtual ~LinearObject();
 
-  double DistanceToVector( std::vector<double> vector );
+  double DistanceToVector( const VectorType& vector ) const;
 
-  // TODO: This should be abstract, but I can't get this to work right now
-  // We can just avoid using this class directly for now
-  virtual std::vector<double> ProjectVector( std::vector<double> vector ) = 0;
-  virtual void Translate( std::vector<double> vector ) = 0;
+  virtual VectorType ProjectVector( const VectorType& vector ) const = 0;
+  virtual void Translate( const VectorType& vector ) = 0;
 
   virtual std::string ToXMLString() const = 0;
   virtual void FromXMLElement( vtkXMLDataElement* element ) = 0;
 
 public:
-  static double Distance( std::vector<double> v1, std::vector<double> v2 );
-  static double Norm( std::vector<double> vector );
-  static double Dot( std::vector<double> v1, std::vector<double> v2 );
-  static std::vector<double> Cross( std::vector<double> v1, std::vector<double> v2 );
+  static double Distance( const VectorType& v1, const VectorType& v2 );
+  static double Norm( const VectorType& vector );
+  static double Dot( const VectorType& v1, const VectorType& v2 );
+  static VectorType Cross( const VectorType& v1, const VectorType& v2 );
 
-  static std::vector<double> Add( std::vector<double> v1, std::vector<double> v2 );
-  static std::vector<double> Subtract( std::vector<double> v1, std::vector<double> v2 );
-  static std::vector<double> Multiply( double c, std::vector<double> vector ); 
+  static VectorType Add( const VectorType& v1, const VectorType& v2 );
+  static VectorType Subtract( const VectorType& v1, const VectorType& v2 );
+  static VectorType Multiply( double c, const VectorType& vector );
 
-  static std::string VectorToString( std::vector<double> vector );
-  static std::vector<double> StringToVector( std::string s, int size );
+  static std::string VectorToString( const VectorType& vector );
+  static VectorType StringToVector( const std::string& s );
 
 };
 
@@ -9,6 +9,50 @@ See License.txt for details.
 #include "LinearObjectBuffer.h"
 #include "PlusCommon.h"
 
+#include "vnl/vnl_matrix.h"
+#include "vnl/vnl_matrix_fixed.h"
+#include "vnl/vnl_vector.h"
+#include "vnl/algo/vnl_matrix_inverse.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /*! Squared distance of two signatures, signatures of different length never match */
+  double SquaredSignatureDistance( const std::vector<double>& signature1, const std::vector<double>& signature2 )
+  {
+    if ( signature1.size() != signature2.size() )
+    {
+      return std::numeric_limits<double>::infinity();
+    }
+    double squaredDistance = 0.0;
+    for ( size_t i = 0; i < signature1.size(); i++ )
+    {
+      const double difference = signature1[i] - signature2[i];
+      squaredDistance += difference * difference;
+    }
+    return squaredDistance;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Add the outer product of the normal to A^T*A and the normal scaled by its dot product with the base point to A^T*b */
+  void AddNormalEquation( vnl_matrix_fixed<double, LinearObject::DIMENSION, LinearObject::DIMENSION>& ataMatrix, LinearObject::VectorType& atbVector,
+    const LinearObject::VectorType& normal, const LinearObject::VectorType& basePoint )
+  {
+    for ( int d1 = 0; d1 < LinearObject::DIMENSION; d1++ )
+    {
+      for ( int d2 = 0; d2 < LinearObject::DIMENSION; d2++ )
+      {
+        ataMatrix( d1, d2 ) += normal[d1] * normal[d2];
+      }
+    }
+    atbVector += LinearObject::Dot( normal, basePoint ) * normal;
+  }
+}
+
 //-----------------------------------------------------------------------------
 
 LinearObjectBuffer::LinearObjectBuffer()
@@ -19,11 +63,6 @@ LinearObjectBuffer::LinearObjectBuffer()
 
 LinearObjectBuffer::~LinearObjectBuffer()
 {
-  for ( int i = 0; i < this->Size(); i++ )
-  {
-    delete this->objects.at(i);
-  }
-  this->objects.clear();
 }
 
 //-----------------------------------------------------------------------------
@@ -37,12 +76,12 @@ int LinearObjectBuffer::Size() const
 
 LinearObject* LinearObjectBuffer::GetLinearObject( int index ) const
 {
-  return this->objects.at(index);
+  return this->objects.at(index).get();
 }
 
 //-----------------------------------------------------------------------------
 
-LinearObject* LinearObjectBuffer::GetLinearObject( std::string name ) const
+LinearObject* LinearObjectBuffer::GetLinearObject( const std::string& name ) const
 {
   for ( int i = 0; i < this->Size(); i++ )
   {
@@ -60,22 +99,20 @@ LinearObject* LinearObjectBuffer::GetLinearObject( std::string name ) const
 
 void LinearObjectBuffer::AddLinearObject( LinearObject* newObject )
 {
-  this->objects.push_back( newObject );
+  this->objects.push_back( LinearObjectPointer( newObject ) );
 }
 
 //-----------------------------------------------------------------------------
 
-void LinearObjectBuffer::Concatenate( LinearObjectBuffer* catBuffer )
+void LinearObjectBuffer::Concatenate( const LinearObjectBuffer& catBuffer )
 {
-  for ( int i = 0; i < catBuffer->Size(); i++ )
-  {
-    this->AddLinearObject( catBuffer->GetLinearObject(i) );
-  }
+  // Share the objects, so that they are deleted only when neither buffer refers to them anymore
+  this->objects.insert( this->objects.end(), catBuffer.objects.begin(), catBuffer.objects.end() );
 }
 
 //-----------------------------------------------------------------------------
 
-void LinearObjectBuffer::Translate( std::vector<double> vector )
+void LinearObjectBuffer::Translate( const LinearObject::VectorType& vector )
 {
   for ( int i = 0; i < this->Size(); i++ )
   {
@@ -85,128 +122,185 @@ void LinearObjectBuffer::Translate( std::vector<double> vector )
 
 //-----------------------------------------------------------------------------
 
-void LinearObjectBuffer::CalculateSignature( LinearObjectBuffer* refBuffer )
+void LinearObjectBuffer::CalculateSignature( const LinearObjectBuffer& refBuffer )
 {
   // Calculate the signature of everything in this, assume the inputted object is a buffer of references
   for ( int i = 0; i < this->Size(); i++ )
   {
-    std::vector<double> sig( refBuffer->Size(), 0.0 );
-    for ( int j = 0; j < refBuffer->Size(); j++ )
+    std::vector<double>& sig = this->GetLinearObject(i)->Signature;
+    sig.resize( refBuffer.Size() );
+    for ( int j = 0; j < refBuffer.Size(); j++ )
     {
-      sig.at(j) = this->GetLinearObject(i)->DistanceToVector( refBuffer->GetLinearObject(j)->BasePoint );
+      sig[j] = this->GetLinearObject(i)->DistanceToVector( refBuffer.GetLinearObject(j)->BasePoint );
     }
-    this->GetLinearObject(i)->Signature = sig;
   }
 }
 
 //-----------------------------------------------------------------------------
 
-LinearObjectBuffer* LinearObjectBuffer::GetMatches( LinearObjectBuffer* candidates, double matchingThreshold )
+void LinearObjectBuffer::GetMatches( const LinearObjectBuffer& candidates, double matchingThreshold, LinearObjectBuffer& matchedCandidates )
 {
   // For each object in this, find the object in candidates that has the closest signature
-  LinearObjectBuffer* matchedCandidates = new LinearObjectBuffer();
-  std::vector<LinearObject*> matchedObjects;
-  if ( this->Size() == 0 || candidates->Size() == 0 )
+  matchedCandidates.objects.clear();
+  std::vector<LinearObjectPointer> matchedObjects;
+  if ( this->Size() == 0 || candidates.Size() == 0 || matchingThreshold <= 0 )
   {
     this->objects = matchedObjects;
-    return matchedCandidates;
+    return;
   }
 
+  // Sort the candidates by the signature component that has the largest spread. The difference in a single component
+  // is a lower bound of the signature distance, so only the candidates with a close enough sort key have to be compared.
+  const size_t signatureSize = candidates.GetLinearObject(0)->Signature.size();
+  size_t sortComponent = 0;
+  double largestSpread = -1.0;
+  for ( size_t d = 0; d < signatureSize; d++ )
+  {
+    double minValue = std::numeric_limits<double>::max();
+    double maxValue = -std::numeric_limits<double>::max();
+    for ( int j = 0; j < candidates.Size(); j++ )
+    {
+      const std::vector<double>& signature = candidates.GetLinearObject(j)->Signature;
+      if ( signature.size() == signatureSize )
+      {
+        minValue = std::min( minValue, signature[d] );
+        maxValue = std::max( maxValue, signature[d] );
+      }
+    }
+    if ( maxValue - minValue > largestSpread )
+    {
+      largestSpread = maxValue - minValue;
+      sortComponent = d;
+    }
+  }
+
+  // Pairs of (sort key, candidate index), candidates with a differently sized signature can never match
+  std::vector< std::pair<double, int> > sortedCandidates;
+  sortedCandidates.reserve( candidates.Size() );
+  for ( int j = 0; j < candidates.Size(); j++ )
+  {
+    const std::vector<double>& signature = candidates.GetLinearObject(j)->Signature;
+    if ( signature.size() == signatureSize )
+    {
+      sortedCandidates.push_back( std::make_pair( signatureSize > 0 ? signature[sortComponent] : 0.0, j ) );
+    }
+  }
+  std::sort( sortedCandidates.begin(), sortedCandidates.end() );
+
   for ( int i = 0; i < this->Size(); i++ )
   {
+    const std::vector<double>& signature = this->GetLinearObject(i)->Signature;
+    if ( signature.size() != signatureSize )
+    {
+      continue;
+    }
+    const double key = ( signatureSize > 0 ? signature[sortComponent] : 0.0 );
 
-    LinearObject* closestObject = candidates->GetLinearObject(0);
-    double closestDistance = LinearObject::Norm( LinearObject::Subtract( this->GetLinearObject(i)->Signature, closestObject->Signature ) );
+    // Only accept the matching if it is sufficiently good (this throws away potentially wrongly identified collected objects)
+    double closestSquaredDistance = matchingThreshold * matchingThreshold;
+    int closestIndex = -1;
 
-    for ( int j = 0; j < candidates->Size(); j++ )
+    // Scan outwards from the sort key in both directions until the key difference alone exceeds the closest distance found
+    std::vector< std::pair<double, int> >::const_iterator start = std::lower_bound( sortedCandidates.begin(), sortedCandidates.end(), std::make_pair( key, -1 ) );
+    for ( int direction = 0; direction < 2; direction++ )
     {
-      if ( LinearObject::Norm( LinearObject::Subtract( this->GetLinearObject(i)->Signature, candidates->GetLinearObject(j)->Signature ) ) < closestDistance )
+      std::vector< std::pair<double, int> >::const_iterator it = start;
+      while ( direction == 0 ? it != sortedCandidates.end() : it != sortedCandidates.begin() )
       {
-        closestObject = candidates->GetLinearObject(j);
-        closestDistance = LinearObject::Norm( LinearObject::Subtract( this->GetLinearObject(i)->Signature, candidates->GetLinearObject(j)->Signature ) );
+        if ( direction == 1 )
+        {
+          --it;
+        }
+        const double keyDifference = it->first - key;
+        if ( keyDifference * keyDifference > closestSquaredDistance )
+        {
+          break;
+        }
+        const double squaredDistance = SquaredSignatureDistance( signature, candidates.GetLinearObject( it->second )->Signature );
+        // Ties are resolved in favour of the first candidate, like an exhaustive search would do
+        if ( squaredDistance < closestSquaredDistance || ( squaredDistance == closestSquaredDistance && closestIndex >= 0 && it->second < closestIndex ) )
+        {
+          closestSquaredDistance = squaredDistance;
+          closestIndex = it->second;
+        }
+        if ( direction == 0 )
+        {
+          ++it;
+        }
       }
     }
 
-    // Only accept the matching if it is sufficiently good (this throws away potentially wrongly identified collected objects)
-    if ( closestDistance < matchingThreshold )
+    if ( closestIndex >= 0 )
     {
-      matchedObjects.push_back( this->GetLinearObject(i) );
-      matchedCandidates->AddLinearObject( closestObject );
+      matchedObjects.push_back( this->objects[i] );
+      matchedCandidates.objects.push_back( candidates.objects[closestIndex] );
     }
 
   }
 
   this->objects = matchedObjects;
-
-  return matchedCandidates;
 }
 
 //-----------------------------------------------------------------------------
 
-std::vector<double> LinearObjectBuffer::CalculateCentroid()
+PlusStatus LinearObjectBuffer::CalculateCentroid( LinearObject::VectorType& centroid ) const
 {
   const double CONDITION_THRESHOLD = 1e-3;
 
-  // Assume each will take 3 rows. If it doesn't leaving them blank won't affect the result
-  vnl_matrix<double>* A = new vnl_matrix<double>( LinearObject::DIMENSION * this->Size(), LinearObject::DIMENSION, 0.0 );
-  vnl_matrix<double>* B = new vnl_matrix<double>( LinearObject::DIMENSION * this->Size(), 1, 0.0 );
+  // We wish to solve the system A * X = B in the least squares sense, so accumulate the normal equations
+  // A^T * A * X = A^T * B directly, each object contributes its rows (if it has any)
+  vnl_matrix_fixed<double, LinearObject::DIMENSION, LinearObject::DIMENSION> ataMatrix( 0.0 );
+  LinearObject::VectorType atbVector( 0.0 );
 
-  // We wish to solve the system A * X = B
   for ( int i = 0; i < this->Size(); i++ )
   {
-    int row = LinearObject::DIMENSION * i; 
     // A = I for point, B = coordinates
     if ( strcmp( this->GetLinearObject(i)->Type.c_str(), "Point" ) == 0 )
     {
       Point* PointObject = (Point*) this->GetLinearObject(i);
-      A->put( row + 0, 0, 1.0 ); 
-      A->put( row + 1, 1, 1.0 );
-      A->put( row + 2, 2, 1.0 );
-      B->put( row + 0, 0, PointObject->BasePoint.at(0) );
-      B->put( row + 1, 0, PointObject->BasePoint.at(1) );
-      B->put( row + 2, 0, PointObject->BasePoint.at(2) );
+      for ( int d = 0; d < LinearObject::DIMENSION; d++ )
+      {
+        ataMatrix( d, d ) += 1.0;
+      }
+      atbVector += PointObject->BasePoint;
     }
 
     // A = Normal 1, Normal 2, B = Dot( Normal 1, BasePoint ), Dot( Normal 2, BasePoint )
     if ( strcmp( this->GetLinearObject(i)->Type.c_str(), "Line" ) == 0 )
     {
       Line* LineObject = (Line*) this->GetLinearObject(i);
-      A->put( row + 0, 0, LineObject->GetOrthogonalNormal1().at(0) );
-      A->put( row + 0, 1, LineObject->GetOrthogonalNormal1().at(1) );
-      A->put( row + 0, 2, LineObject->GetOrthogonalNormal1().at(2) );
-      A->put( row + 1, 0, LineObject->GetOrthogonalNormal2().at(0) );
-      A->put( row + 1, 1, LineObject->GetOrthogonalNormal2().at(1) );
-      A->put( row + 1, 2, LineObject->GetOrthogonalNormal2().at(2) );
-      B->put( row + 0, 0, LinearObject::Dot( LineObject->GetOrthogonalNormal1(), LineObject->BasePoint ) );
-      B->put( row + 1, 0, LinearObject::Dot( LineObject->GetOrthogonalNormal2(), LineObject->BasePoint ) );
+      LinearObject::VectorType normal1;
+      LinearObject::VectorType normal2;
+      LineObject->GetOrthogonalNormals( normal1, normal2 );
+      AddNormalEquation( ataMatrix, atbVector, normal1, LineObject->BasePoint );
+      AddNormalEquation( ataMatrix, atbVector, normal2, LineObject->BasePoint );
     }
 
     // A = Normal, B = Dot( Normal, BasePoint )
     if ( strcmp( this->GetLinearObject(i)->Type.c_str(), "Plane" ) == 0 )
     {
       Plane* PlaneObject = (Plane*) this->GetLinearObject(i);
-      A->put( row + 0, 0, PlaneObject->GetNormal().at(0) );
-      A->put( row + 0, 1, PlaneObject->GetNormal().at(1) );
-      A->put( row + 0, 2, PlaneObject->GetNormal().at(2) );
-      B->put( row + 0, 0, LinearObject::Dot( PlaneObject->GetNormal(), PlaneObject->BasePoint ) );
+      AddNormalEquation( ataMatrix, atbVector, PlaneObject->GetNormal(), PlaneObject->BasePoint );
     }
 
   }
 
   // Now, calculate X
-  vnl_matrix_inverse<double>* X = new vnl_matrix_inverse<double>( A->transpose() * (*A) );
-  if ( X->well_condition() < CONDITION_THRESHOLD ) // This is the inverse of the condition number
+  vnl_matrix_inverse<double> X( vnl_matrix<double>( ataMatrix.data_block(), LinearObject::DIMENSION, LinearObject::DIMENSION ) );
+  // This is the inverse of the condition number, it is NaN if there are no equations at all (so test for the good case)
+  if ( !( X.well_condition() >= CONDITION_THRESHOLD ) )
   {
-    throw std::logic_error("Failed - centroid calculation is ill-conditioned!");
-  } // TODO: Error if ill-conditioned
-  vnl_matrix<double>* Y = new vnl_matrix<double>( X->inverse() * A->transpose() * (*B) );
+    LOG_ERROR( "Failed - centroid calculation is ill-conditioned!" );
+    return PLUS_FAIL;
+  }
+  vnl_vector<double> Y = X.inverse() * vnl_vector<double>( atbVector.data_block(), LinearObject::DIMENSION );
 
-  std::vector<double> centroid( LinearObject::DIMENSION, 0.0 );
-  centroid.at(0) = Y->get( 0, 0 );
-  centroid.at(1) = Y->get( 1, 0 );
-  centroid.at(2) = Y->get( 2, 0 );
+  for ( int d = 0; d < LinearObject::DIMENSION; d++ )
+  {
+    centroid[d] = Y[d];
+  }
 
-  return centroid;
+  return PLUS_SUCCESS;
 }
 
 //-----------------------------------------------------------------------------
@@ -229,8 +323,7 @@ std::string LinearObjectBuffer::ToXMLString() const
 
 void LinearObjectBuffer::FromXMLElement( vtkXMLDataElement* element )
 {
-  LinearObject* blankObject = NULL;
-  this->objects = std::vector<LinearObject*>( 0, blankObject );
+  this->objects.clear();
 
   int numElements = element->GetNumberOfNestedElements();
 
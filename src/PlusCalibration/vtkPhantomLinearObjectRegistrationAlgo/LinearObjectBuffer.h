@@ -7,25 +7,28 @@ See License.txt for details.
 #ifndef LINEAROBJECTBUFFER_H
 #define LINEAROBJECTBUFFER_H
 
+#include "vtkPlusCalibrationExport.h"
+
+#include "PlusConfigure.h"
 #include "LinearObject.h"
 #include "Reference.h"
 #include "Point.h"
 #include "Line.h"
 #include "Plane.h"
 
+#include <memory>
 #include <string>
 #include <sstream>
 #include <vector>
 #include <cmath>
 
-#include "vnl/vnl_matrix.h"
-#include "vnl/algo/vnl_matrix_inverse.h"
-
 // This class stores a vector of values and a string label
-class LinearObjectBuffer
+class vtkPlusCalibrationExport LinearObjectBuffer
 {
 private:
-  std::vector<LinearObject*> objects;
+  // Objects may be referenced by more than one buffer (after Concatenate or GetMatches), they are deleted with the last buffer
+  typedef std::shared_ptr<LinearObject> LinearObjectPointer;
+  std::vector<LinearObjectPointer> objects;
 
 public:
   LinearObjectBuffer();
@@ -33,17 +36,19 @@ public:
 
   int Size() const;
   LinearObject* GetLinearObject( int index ) const;
-  LinearObject* GetLinearObject( std::string name ) const;
+  LinearObject* GetLinearObject( const std::string& name ) const;
+  // The buffer takes ownership of the object
   void AddLinearObject( LinearObject* newObject );
-  void Concatenate( LinearObjectBuffer* catBuffer );
+  void Concatenate( const LinearObjectBuffer& catBuffer );
 
-  void Translate( std::vector<double> vector );
+  void Translate( const LinearObject::VectorType& vector );
 
-  void CalculateSignature( LinearObjectBuffer* refBuffer );
+  void CalculateSignature( const LinearObjectBuffer& refBuffer );
 
-  LinearObjectBuffer* GetMatches( LinearObjectBuffer* candidates, double matchingThreshold );
+  // Keeps only the objects that have a candidate with a close enough signature, matchedCandidates will contain the match of each kept object
+  void GetMatches( const LinearObjectBuffer& candidates, double matchingThreshold, LinearObjectBuffer& matchedCandidates );
 
-  std::vector<double> CalculateCentroid();
+  PlusStatus CalculateCentroid( LinearObject::VectorType& centroid ) const;
 
   std::string ToXMLString() const;
   void FromXMLElement( vtkXMLDataElement* element );
@@ -11,11 +11,13 @@ See License.txt for details.
 Plane::Plane()
 {
   this->Type = "Plane";
+  this->EndPoint1.fill( 0.0 );
+  this->EndPoint2.fill( 0.0 );
 }
 
 //-----------------------------------------------------------------------------
 
-Plane::Plane( std::vector<double> newBasePoint, std::vector<double> newEndPoint1, std::vector<double> newEndPoint2 )
+Plane::Plane( const VectorType& newBasePoint, const VectorType& newEndPoint1, const VectorType& newEndPoint2 )
 {
   this->Type = "Plane";
   this->BasePoint = newBasePoint;
@@ -27,37 +29,33 @@ Plane::Plane( std::vector<double> newBasePoint, std::vector<double> newEndPoint1
 
 Plane::~Plane()
 {
-  this->EndPoint1.clear();
-  this->EndPoint2.clear();
 }
 
 //-----------------------------------------------------------------------------
 
-std::vector<double> Plane::GetNormal()
+LinearObject::VectorType Plane::GetNormal() const
 {
-  std::vector<double> vector = Cross( Subtract( this->EndPoint1, this->BasePoint ), Subtract( this->EndPoint2, this->BasePoint ) );
+  VectorType vector = Cross( Subtract( this->EndPoint1, this->BasePoint ), Subtract( this->EndPoint2, this->BasePoint ) );
   vector = Multiply( 1 / Norm( vector ), vector );
   return vector;
 }
 
 //-----------------------------------------------------------------------------
 
-std::vector<double> Plane::ProjectVector( std::vector<double> vector )
+LinearObject::VectorType Plane::ProjectVector( const VectorType& vector ) const
 {
-  std::vector<double> outVec = Subtract( vector, this->BasePoint );
-  return Subtract( vector, Multiply( Dot( this->GetNormal(), outVec ), this->GetNormal() ) );
+  VectorType normal = this->GetNormal();
+  VectorType outVec = Subtract( vector, this->BasePoint );
+  return Subtract( vector, Multiply( Dot( normal, outVec ), normal ) );
 }
 
 //-----------------------------------------------------------------------------
 
-void Plane::Translate( std::vector<double> vector )
+void Plane::Translate( const VectorType& vector )
 {
-  for ( unsigned int i = 0; i < vector.size(); i++ )
-  {
-    this->BasePoint.at(i) = this->BasePoint.at(i) + vector.at(i);
-    this->EndPoint1.at(i) = this->EndPoint1.at(i) + vector.at(i);
-    this->EndPoint2.at(i) = this->EndPoint2.at(i) + vector.at(i);
-  }
+  this->BasePoint += vector;
+  this->EndPoint1 += vector;
+  this->EndPoint2 += vector;
 }
 
 //-----------------------------------------------------------------------------
@@ -87,8 +85,8 @@ void Plane::FromXMLElement( vtkXMLDataElement* element )
   }
 
   this->Name = std::string( element->GetAttribute( "Name" ) );
-  this->BasePoint = StringToVector( std::string( element->GetAttribute( "BasePoint" ) ), 3 );
-  this->EndPoint1 = StringToVector( std::string( element->GetAttribute( "EndPoint1" ) ), 3 );
-  this->EndPoint2 = StringToVector( std::string( element->GetAttribute( "EndPoint2" ) ), 3 );
+  this->BasePoint = StringToVector( std::string( element->GetAttribute( "BasePoint" ) ) );
+  this->EndPoint1 = StringToVector( std::string( element->GetAttribute( "EndPoint1" ) ) );
+  this->EndPoint2 = StringToVector( std::string( element->GetAttribute( "EndPoint2" ) ) );
 
 }
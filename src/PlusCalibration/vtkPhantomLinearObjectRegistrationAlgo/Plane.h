@@ -8,6 +8,8 @@ See License.txt for details.
 #define PLANE_H
 
 
+#include "vtkPlusCalibrationExport.h"
+
 #include "LinearObject.h"
 #include <cmath>
 #include <sstream>
@@ -15,23 +17,23 @@ See License.txt for details.
 #include <vector>
 
 // This class stores a vector of values and a string label
-class Plane : public LinearObject
+class vtkPlusCalibrationExport Plane : public LinearObject
 {
 public:
   Plane();
-  Plane( std::vector<double> newBasePoint, std::vector<double> newEndPoint1, std::vector<double> newEndPoint2 );
+  Plane( const VectorType& newBasePoint, const VectorType& newEndPoint1, const VectorType& newEndPoint2 );
   ~Plane();
 
-  std::vector<double> GetNormal();
-  std::vector<double> ProjectVector( std::vector<double> vector );
-  void Translate( std::vector<double> vector );
+  VectorType GetNormal() const;
+  VectorType ProjectVector( const VectorType& vector ) const;
+  void Translate( const VectorType& vector );
 
   virtual std::string ToXMLString() const;
   virtual void FromXMLElement( vtkXMLDataElement* element );
 
 protected:
-  std::vector<double> EndPoint1;
-  std::vector<double> EndPoint2;
+  VectorType EndPoint1;
+  VectorType EndPoint2;
 };
 
 #endif
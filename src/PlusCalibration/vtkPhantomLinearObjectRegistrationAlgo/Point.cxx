@@ -15,7 +15,7 @@ Point::Point()
 
 //-----------------------------------------------------------------------------
 
-Point::Point( std::vector<double> newBasePoint )
+Point::Point( const VectorType& newBasePoint )
 {
   this->Type = "Point";
   this->BasePoint = newBasePoint;
@@ -29,19 +29,16 @@ Point::~Point()
 
 //-----------------------------------------------------------------------------
 
-std::vector<double> Point::ProjectVector( std::vector<double> vector )
+LinearObject::VectorType Point::ProjectVector( const VectorType& vector ) const
 {
   return this->BasePoint;
 }
 
 //-----------------------------------------------------------------------------
 
-void Point::Translate( std::vector<double> vector )
+void Point::Translate( const VectorType& vector )
 {
-  for ( unsigned int i = 0; i < vector.size(); i++ )
-  {
-    this->BasePoint.at(i) = this->BasePoint.at(i) + vector.at(i);
-  }
+  this->BasePoint += vector;
 }
 
 //-----------------------------------------------------------------------------
@@ -69,6 +66,6 @@ void Point::FromXMLElement( vtkXMLDataElement* element )
   }
 
   this->Name = std::string( element->GetAttribute( "Name" ) );
-  this->BasePoint = StringToVector( std::string( element->GetAttribute( "BasePoint" ) ), 3 );
+  this->BasePoint = StringToVector( std::string( element->GetAttribute( "BasePoint" ) ) );
 
 }
@@ -7,6 +7,8 @@ See License.txt for details.
 #ifndef POINT_H
 #define POINT_H
 
+#include "vtkPlusCalibrationExport.h"
+
 #include "LinearObject.h"
 
 #include <string>
@@ -15,15 +17,15 @@ See License.txt for details.
 #include <cmath>
 
 // This class stores a vector of values and a string label
-class Point : public LinearObject
+class vtkPlusCalibrationExport Point : public LinearObject
 {
 public:
   Point();
-  Point( std::vector<double> newBasePoint );
+  Point( const VectorType& newBasePoint );
   ~Point();
 
-  std::vector<double> ProjectVector( std::vector<double> vector );
-  void Translate( std::vector<double> vector );
+  VectorType ProjectVector( const VectorType& vector ) const;
+  void Translate( const VectorType& vector );
 
   virtual std::string ToXMLString() const;
   virtual void FromXMLElement( vtkXMLDataElement* element );
@@ -5,11 +5,12 @@
 PointObservation
 ::PointObservation()
 {
+  this->Observation.fill( 0.0 );
 }
 
 
 PointObservation
-::PointObservation( std::vector<double> newObervation )
+::PointObservation( const LinearObject::VectorType& newObervation )
 {
   this->Observation = newObervation;
 }
@@ -18,40 +19,31 @@ PointObservation
 PointObservation
 ::~PointObservation()
 {
-  this->Observation.clear();
 }
 
 
 void PointObservation
-::Translate( std::vector<double> translation )
+::Translate( const LinearObject::VectorType& translation )
 {
-  this->Observation = LinearObject::Add( this->Observation, translation );
+  this->Observation += translation;
 }
 
 
 void PointObservation
-::Rotate( vnl_matrix<double>* rotation )
+::Rotate( const vnl_matrix_fixed<double, SIZE, SIZE>& rotation )
 {
-  vnl_matrix<double>* currPoint = new vnl_matrix<double>( PointObservation::SIZE, 1, 0.0 );
-  currPoint->put( 0, 0, this->Observation.at(0) );
-  currPoint->put( 1, 0, this->Observation.at(1) );
-  currPoint->put( 2, 0, this->Observation.at(2) );
-
-  vnl_matrix<double>* rotPoint = new vnl_matrix<double>( ( *rotation ) * ( *currPoint ) );
-  this->Observation.at(0) = rotPoint->get( 0, 0 );
-  this->Observation.at(1) = rotPoint->get( 1, 0 );
-  this->Observation.at(2) = rotPoint->get( 2, 0 );
+  this->Observation = rotation * this->Observation;
 }
 
 
 std::string PointObservation
-::ToXMLString()
+::ToXMLString() const
 {
   std::ostringstream xmlstring;
   std::ostringstream matrixstring;
-  matrixstring << "0 0 0 " << this->Observation.at(0) << " ";
-  matrixstring << "0 0 0 " << this->Observation.at(1) << " ";
-  matrixstring << "0 0 0 " << this->Observation.at(2) << " ";
+  matrixstring << "0 0 0 " << this->Observation[0] << " ";
+  matrixstring << "0 0 0 " << this->Observation[1] << " ";
+  matrixstring << "0 0 0 " << this->Observation[2] << " ";
   matrixstring << "0 0 0 1";
 
   xmlstring << "  <log";
@@ -75,7 +67,7 @@ void PointObservation
     return;  // If it's not a "log" or is the wrong tool jump to the next.
   }
 
-  this->Observation = std::vector<double>( SIZE, 0.0 );
+  this->Observation.fill( 0.0 );
 
   std::stringstream matrixstring( std::string( element->GetAttribute( "transform" ) ) );
   double value;
@@ -85,15 +77,15 @@ void PointObservation
     matrixstring >> value;
   if ( i == 3 )
   {
-    this->Observation.at(0) = value;
+    this->Observation[0] = value;
   }
   if ( i == 7 )
   {
-    this->Observation.at(1) = value;
+    this->Observation[1] = value;
   }
   if ( i == 11 )
   {
-    this->Observation.at(2) = value;
+    this->Observation[2] = value;
   }
   }
 
@@ -120,8 +112,8 @@ bool PointObservation
   std::stringstream prevmatrixstring( std::string( prevElement->GetAttribute( "transform" ) ) );
   double currValue, prevValue;
 
-  std::vector<double> currRotation, prevRotation;
-  std::vector<double> currTranslation, prevTranslation;
+  double rotationDistance2 = 0.0;
+  double translationDistance2 = 0.0;
 
   for ( int i = 0; i < 16; i++ )
   {
@@ -129,17 +121,15 @@ bool PointObservation
   prevmatrixstring >> prevValue;
   if ( i == 0 || i == 1 || i == 2 || i == 4 || i == 5 || i == 6 || i == 8 || i == 9 || i == 10 )
   {
-    currRotation.push_back( currValue );
-    prevRotation.push_back( prevValue );
+    rotationDistance2 += ( currValue - prevValue ) * ( currValue - prevValue );
   }
   if ( i == 3 || i == 7 || i == 11 )
   {
-    currTranslation.push_back( currValue );
-    prevTranslation.push_back( prevValue );
+    translationDistance2 += ( currValue - prevValue ) * ( currValue - prevValue );
   }
   }
 
-  if ( LinearObject::Distance( currRotation, prevRotation ) > ROTATION_THRESHOLD || LinearObject::Distance( currTranslation, prevTranslation ) > TRANSLATION_THRESHOLD )
+  if ( rotationDistance2 > ROTATION_THRESHOLD * ROTATION_THRESHOLD || translationDistance2 > TRANSLATION_THRESHOLD * TRANSLATION_THRESHOLD )
   {
     this->FromXMLElement( currElement );
   return true;
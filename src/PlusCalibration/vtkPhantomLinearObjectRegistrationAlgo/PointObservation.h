@@ -3,6 +3,8 @@
 #ifndef POINTOBSERVATION_H
 #define POINTOBSERVATION_H
 
+#include "vtkPlusCalibrationExport.h"
+
 #include "LinearObject.h"
 
 #include <string>
@@ -11,25 +13,25 @@
 #include <cmath>
 
 #include "vtkXMLDataElement.h"
-#include "vnl/vnl_matrix.h"
+#include "vnl/vnl_matrix_fixed.h"
 
 
 // This class stores a vector of values only - we do not care about time
-class PointObservation
+class vtkPlusCalibrationExport PointObservation
 {
 public:
-  std::vector<double> Observation;
   static const int SIZE = 3;
+  LinearObject::VectorType Observation;
 
 public:
   PointObservation();
-  PointObservation( std::vector<double> newObservation );
+  PointObservation( const LinearObject::VectorType& newObservation );
   ~PointObservation();
 
-  void Translate ( std::vector<double> translation );
-  void Rotate( vnl_matrix<double>* rotation );
+  void Translate ( const LinearObject::VectorType& translation );
+  void Rotate( const vnl_matrix_fixed<double, SIZE, SIZE>& rotation );
 
-  std::string ToXMLString();
+  std::string ToXMLString() const;
   void FromXMLElement( vtkXMLDataElement* element );
   bool FromXMLElement( vtkXMLDataElement* currElement, vtkXMLDataElement* prevElement );
 
@@ -9,6 +9,80 @@ See License.txt for details.
 #include "PointObservationBuffer.h"
 #include "PlusCommon.h"
 
+#include "vnl/vnl_matrix.h"
+#include "vnl/vnl_vector.h"
+#include "vnl/algo/vnl_symmetric_eigensystem.h"
+#include "vnl/algo/vnl_svd.h"
+#include "vtkMultiThreader.h"
+#include "vtkSmartPointer.h"
+
+#include <algorithm>
+
+namespace
+{
+  // Number of consecutive observations that are examined together for linearity
+  const int TEST_INTERVAL = 21;
+
+  // Windows are analyzed on multiple threads only if there are more windows than this limit, because for short
+  // recordings starting the threads takes longer than the computation
+  const unsigned int MINIMUM_NUMBER_OF_WINDOWS_PER_THREAD = 1000;
+
+  struct WindowEigenvaluesThreadFunctionInfoStruct
+  {
+    const PointObservationBuffer* Buffer;
+    std::vector<LinearObject::VectorType>* Eigenvalues;
+  };
+
+  //----------------------------------------------------------------------------
+  /*! Compute the covariance eigenvalues (in increasing order) of the windows from firstWindow to lastWindow-1 */
+  void ComputeWindowEigenvalues(const WindowEigenvaluesThreadFunctionInfoStruct& str, size_t firstWindow, size_t lastWindow)
+  {
+    const PointObservationBuffer& buffer = *str.Buffer;
+    std::vector<LinearObject::VectorType>& eigenvalues = *str.Eigenvalues;
+    for ( size_t window = firstWindow; window < lastWindow; ++window )
+    {
+      LinearObject::VectorType centroid( 0.0 );
+      for ( size_t j = window; j < window + TEST_INTERVAL; ++j )
+      {
+        centroid += buffer.GetObservation( j ).Observation;
+      }
+      centroid /= TEST_INTERVAL;
+
+      PointObservationBuffer::MatrixType cov( 0.0 );
+      for ( size_t j = window; j < window + TEST_INTERVAL; ++j )
+      {
+        const LinearObject::VectorType zeroMean = buffer.GetObservation( j ).Observation - centroid;
+        for ( int d1 = 0; d1 < PointObservation::SIZE; d1++ )
+        {
+          for ( int d2 = d1; d2 < PointObservation::SIZE; d2++ )
+          {
+            cov( d1, d2 ) += zeroMean[ d1 ] * zeroMean[ d2 ];
+          }
+        }
+      }
+      cov /= TEST_INTERVAL;
+
+      // Closed form solution for symmetric 3x3 matrices, the eigenvalues are in increasing order
+      vnl_symmetric_eigensystem_compute_eigenvals( cov( 0, 0 ), cov( 0, 1 ), cov( 0, 2 ), cov( 1, 1 ), cov( 1, 2 ), cov( 2, 2 ),
+        eigenvalues[ window ][ 0 ], eigenvalues[ window ][ 1 ], eigenvalues[ window ][ 2 ] );
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE ComputeWindowEigenvaluesThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    WindowEigenvaluesThreadFunctionInfoStruct* str = static_cast<WindowEigenvaluesThreadFunctionInfoStruct*>(threadInfo->UserData);
+    size_t threadId = threadInfo->ThreadID;
+    size_t threadCount = threadInfo->NumberOfThreads;
+    size_t numberOfWindows = str->Eigenvalues->size();
+    ComputeWindowEigenvalues(*str, numberOfWindows * threadId / threadCount, numberOfWindows * (threadId + 1) / threadCount);
+    return VTK_THREAD_RETURN_VALUE;
+  }
+}
+
+//-----------------------------------------------------------------------------
+
 PointObservationBuffer::PointObservationBuffer()
 {
 }
@@ -17,11 +91,6 @@ PointObservationBuffer::PointObservationBuffer()
 
 PointObservationBuffer::~PointObservationBuffer()
 {
-  for ( unsigned int i = 0; i < this->Size(); i++ )
-  {
-    delete this->observations.at( i );
-  }
-  this->observations.clear();
 }
 
 //-----------------------------------------------------------------------------
@@ -33,14 +102,21 @@ PointObservationBuffer::PointObservationVector::size_type PointObservationBuffer
 
 //-----------------------------------------------------------------------------
 
-PointObservation* PointObservationBuffer::GetObservation( int index ) const
+const PointObservation& PointObservationBuffer::GetObservation( int index ) const
 {
   return this->observations.at( index );
 }
 
 //-----------------------------------------------------------------------------
 
-void PointObservationBuffer::AddObservation( PointObservation* newObservation )
+PointObservation& PointObservationBuffer::GetObservation( int index )
+{
+  return this->observations.at( index );
+}
+
+//-----------------------------------------------------------------------------
+
+void PointObservationBuffer::AddObservation( const PointObservation& newObservation )
 {
   this->observations.push_back( newObservation );
 }
@@ -54,93 +130,83 @@ void PointObservationBuffer::Clear()
 
 //-----------------------------------------------------------------------------
 
-void PointObservationBuffer::Translate( std::vector<double> translation )
+void PointObservationBuffer::Translate( const LinearObject::VectorType& translation )
 {
   for ( unsigned int i = 0; i < this->Size(); i++ )
   {
-    this->GetObservation( i )->Translate( translation );
+    this->observations[ i ].Translate( translation );
   }
 }
 
 //-----------------------------------------------------------------------------
 
-vnl_matrix<double>* PointObservationBuffer::SphericalRegistration( PointObservationBuffer* fromPoints )
+PlusStatus PointObservationBuffer::SphericalRegistration( const PointObservationBuffer& fromPoints, MatrixType& rotation ) const
 {
   // Assume that it is already mean zero
   const double CONDITION_THRESHOLD = 1e-3;
 
-  // Let us construct the data matrix
-  vnl_matrix<double>* DataMatrix = new vnl_matrix<double>( PointObservation::SIZE, PointObservation::SIZE, 0.0 );
+  if ( fromPoints.Size() != this->Size() )
+  {
+    LOG_ERROR( "Failed - spherical registration requires the same number of points in both buffers (" << fromPoints.Size() << " and " << this->Size() << ")!" );
+    return PLUS_FAIL;
+  }
 
-  // Pick two dimensions, and find their data matrix entry
-  for ( int d1 = 0; d1 < PointObservation::SIZE; d1++ )
+  // Let us construct the data matrix, sum of the outer products of the corresponding points
+  MatrixType dataMatrix( 0.0 );
+  for ( unsigned int i = 0; i < this->Size(); i++ )
   {
-    for ( int d2 = 0; d2 < PointObservation::SIZE; d2++ )
+    const LinearObject::VectorType& fromObservation = fromPoints.observations[ i ].Observation;
+    const LinearObject::VectorType& toObservation = this->observations[ i ].Observation;
+    for ( int d1 = 0; d1 < PointObservation::SIZE; d1++ )
     {
-      // Iterate over all times
-      for ( unsigned int i = 0; i < this->Size(); i++ )
+      for ( int d2 = 0; d2 < PointObservation::SIZE; d2++ )
       {
-        DataMatrix->put( d1, d2, DataMatrix->get( d1, d2 ) + fromPoints->GetObservation( i )->Observation.at( d1 ) * this->GetObservation( i )->Observation.at( d2 ) );
+        dataMatrix( d1, d2 ) += fromObservation[ d1 ] * toObservation[ d2 ];
       }
     }
   }
 
   // Now we can calculate its svd
-  vnl_svd<double>* SVDMatrix = new vnl_svd<double>( *DataMatrix, 0.0 );
-  if ( SVDMatrix->well_condition() < CONDITION_THRESHOLD ) // This is the inverse of the condition number
+  vnl_svd<double> svdMatrix( vnl_matrix<double>( dataMatrix.data_block(), PointObservation::SIZE, PointObservation::SIZE ), 0.0 );
+  // This is the inverse of the condition number, it is NaN for an all-zero data matrix (so test for the good case)
+  if ( !( svdMatrix.well_condition() >= CONDITION_THRESHOLD ) )
   {
     LOG_ERROR( "Failed - spherical registration is ill-conditioned!" );
-  } // TODO: Error if ill-conditioned
+    return PLUS_FAIL;
+  }
 
-  return new vnl_matrix<double>( SVDMatrix->V() * SVDMatrix->U().transpose() );
+  rotation = MatrixType( ( svdMatrix.V() * svdMatrix.U().transpose() ).data_block() );
+  return PLUS_SUCCESS;
 }
 
 //-----------------------------------------------------------------------------
 
-vnl_matrix<double>* PointObservationBuffer::TranslationalRegistration( std::vector<double> toCentroid, std::vector<double> fromCentroid, vnl_matrix<double>* rotation )
+LinearObject::VectorType PointObservationBuffer::TranslationalRegistration( const LinearObject::VectorType& toCentroid, const LinearObject::VectorType& fromCentroid, const MatrixType& rotation ) const
 {
-  // Make matrices out of the centroids
-  vnl_matrix<double>* toMatrix = new vnl_matrix<double>( PointObservation::SIZE, 1, 0.0 );
-  vnl_matrix<double>* fromMatrix = new vnl_matrix<double>( PointObservation::SIZE, 1, 0.0 );
-
-  for ( int i = 0; i < PointObservation::SIZE; i++ )
-  {
-    toMatrix->put( i, 0, toCentroid.at( i ) );
-    fromMatrix->put( i, 0, fromCentroid.at( i ) );
-  }
-
-  return new vnl_matrix<double>( ( *toMatrix ) - ( *rotation ) * ( *fromMatrix ) );
+  return toCentroid - rotation * fromCentroid;
 }
 
 //-----------------------------------------------------------------------------
 
-LinearObject* PointObservationBuffer::LeastSquaresLinearObject( int dof )
+LinearObject* PointObservationBuffer::LeastSquaresLinearObject( int dof ) const
 {
-  std::vector<double> centroid = this->CalculateCentroid();
-  vnl_matrix<double>* cov = this->CovarianceMatrix( centroid );
+  LinearObject::VectorType centroid = this->CalculateCentroid();
+  MatrixType cov = this->CovarianceMatrix( centroid );
 
   //Calculate the eigenvectors of the covariance matrix
   vnl_matrix<double> eigenvectors( PointObservation::SIZE, PointObservation::SIZE, 0.0 );
   vnl_vector<double> eigenvalues( PointObservation::SIZE, 0.0 );
-  vnl_symmetric_eigensystem_compute( *cov, eigenvectors, eigenvalues );
+  vnl_symmetric_eigensystem_compute( vnl_matrix<double>( cov.data_block(), PointObservation::SIZE, PointObservation::SIZE ), eigenvectors, eigenvalues );
   // Note: eigenvectors are ordered in increasing eigenvalue ( 0 = smallest, end = biggest )
 
   // Grab only the most important eigenvectors
-  std::vector<double> Eigenvector1( PointObservation::SIZE, 0.0 ); // Smallest
-  std::vector<double> Eigenvector2( PointObservation::SIZE, 0.0 ); // Medium
-  std::vector<double> Eigenvector3( PointObservation::SIZE, 0.0 ); // Largest
-
-  Eigenvector1.at( 0 ) = eigenvectors.get( 0, 0 );
-  Eigenvector1.at( 1 ) = eigenvectors.get( 1, 0 );
-  Eigenvector1.at( 2 ) = eigenvectors.get( 2, 0 );
-
-  Eigenvector2.at( 0 ) = eigenvectors.get( 0, 1 );
-  Eigenvector2.at( 1 ) = eigenvectors.get( 1, 1 );
-  Eigenvector2.at( 2 ) = eigenvectors.get( 2, 1 );
-
-  Eigenvector3.at( 0 ) = eigenvectors.get( 0, 2 );
-  Eigenvector3.at( 1 ) = eigenvectors.get( 1, 2 );
-  Eigenvector3.at( 2 ) = eigenvectors.get( 2, 2 );
+  LinearObject::VectorType Eigenvector2; // Medium
+  LinearObject::VectorType Eigenvector3; // Largest
+  for ( int d = 0; d < PointObservation::SIZE; d++ )
+  {
+    Eigenvector2[ d ] = eigenvectors.get( d, 1 );
+    Eigenvector3[ d ] = eigenvectors.get( d, 2 );
+  }
 
   // The threshold noise is twice the extraction threshold
   if ( dof == 0 )
@@ -149,11 +215,11 @@ LinearObject* PointObservationBuffer::LeastSquaresLinearObject( int dof )
   }
   if ( dof == 1 )
   {
-    return new Line( centroid, LinearObject::Add( centroid, Eigenvector3 ) );
+    return new Line( centroid, centroid + Eigenvector3 );
   }
   if ( dof == 2 )
   {
-    return new Plane( centroid, LinearObject::Add( centroid, Eigenvector2 ), LinearObject::Add( centroid, Eigenvector3 ) );
+    return new Plane( centroid, centroid + Eigenvector2, centroid + Eigenvector3 );
   }
 
   LinearObject* obj = NULL;
@@ -163,49 +229,41 @@ LinearObject* PointObservationBuffer::LeastSquaresLinearObject( int dof )
 
 //-----------------------------------------------------------------------------
 
-void PointObservationBuffer::Filter( LinearObject* object, int filterWidth )
+void PointObservationBuffer::Filter( const LinearObject* object, int filterWidth )
 {
-  const int THRESHOLD = 1e-3; // Deal with the case of very little noise
+  const double THRESHOLD = 1e-3; // Deal with the case of very little noise
   bool changed = true;
 
-  while ( changed )
+  std::vector<double> distances;
+  while ( changed && this->Size() > 0 )
   {
-    std::vector<double> distances( this->Size(), 0 );
+    distances.resize( this->Size() );
     double meanDistance = 0;
     double stdev = 0;
 
     // Calculate the distance of each point to the linear object
     for ( unsigned int i = 0; i < this->Size(); i++ )
     {
-      distances.at( i ) = object->DistanceToVector( this->GetObservation( i )->Observation );
-      meanDistance = meanDistance + distances.at( i );
-      stdev = stdev + distances.at( i ) * distances.at( i );
+      distances[ i ] = object->DistanceToVector( this->observations[ i ].Observation );
+      meanDistance = meanDistance + distances[ i ];
+      stdev = stdev + distances[ i ] * distances[ i ];
     }
     meanDistance = meanDistance / this->Size();
     stdev = stdev / this->Size();
-    stdev = sqrt( stdev - meanDistance * meanDistance );
+    stdev = sqrt( std::max( 0.0, stdev - meanDistance * meanDistance ) );
 
-    // Keep only the points that are within certain number of standard deviations
-    std::vector<PointObservation*> newObservations;
+    // Keep only the points that are within certain number of standard deviations, compact the buffer in place
+    unsigned int numberOfKeptObservations = 0;
     for ( unsigned int i = 0; i < this->Size(); i++ )
     {
-      if ( distances.at( i ) < filterWidth * stdev || distances.at( i ) < THRESHOLD )
+      if ( distances[ i ] < filterWidth * stdev || distances[ i ] < THRESHOLD )
       {
-        newObservations.push_back( this->GetObservation( i ) );
+        this->observations[ numberOfKeptObservations++ ] = this->observations[ i ];
       }
     }
 
-    if ( newObservations.size() < this->Size() )
-    {
-      changed = true;
-    }
-    else
-    {
-      changed = false;
-    }
-
-    this->observations = newObservations;
-
+    changed = ( numberOfKeptObservations < this->Size() );
+    this->observations.resize( numberOfKeptObservations );
   }
 
 }
@@ -218,7 +276,7 @@ std::string PointObservationBuffer::ToXMLString() const
 
   for ( unsigned int i = 0; i < this->Size(); i++ )
   {
-    xmlstring << this->GetObservation( i )->ToXMLString();
+    xmlstring << this->observations[ i ].ToXMLString();
   }
 
   return xmlstring.str();
@@ -228,17 +286,17 @@ std::string PointObservationBuffer::ToXMLString() const
 
 void PointObservationBuffer::FromXMLElement( vtkXMLDataElement* element )
 {
-  PointObservation* blankObservation = new PointObservation();
-  this->observations = std::vector<PointObservation*>( 0, blankObservation );
-
   int numElements = element->GetNumberOfNestedElements();
 
+  this->observations.clear();
+  this->observations.reserve( numElements );
+
   for ( int i = 0; i < numElements; i++ )
   {
     vtkXMLDataElement* noteElement = element->GetNestedElement( i );
 
-    PointObservation* newObservation = new PointObservation();
-    newObservation->FromXMLElement( noteElement );
+    PointObservation newObservation;
+    newObservation.FromXMLElement( noteElement );
     this->AddObservation( newObservation );
 
   }
@@ -247,109 +305,88 @@ void PointObservationBuffer::FromXMLElement( vtkXMLDataElement* element )
 
 //-----------------------------------------------------------------------------
 
-vnl_matrix<double>* PointObservationBuffer::CovarianceMatrix( std::vector<double> centroid )
+PointObservationBuffer::MatrixType PointObservationBuffer::CovarianceMatrix( const LinearObject::VectorType& centroid ) const
 {
-  // Construct a buffer for the zero mean data; initialize covariance matrix
-  PointObservationBuffer* zeroMeanBuffer = new PointObservationBuffer();
-  vnl_matrix<double>* cov = new vnl_matrix<double>( PointObservation::SIZE, PointObservation::SIZE );
-  cov->fill( 0.0 );
+  MatrixType cov( 0.0 );
 
-  // Subtract the mean from each observation
+  // Accumulate the outer products of the zero mean observations
   for ( unsigned int i = 0; i < this->Size(); i++ )
   {
-    PointObservation* newObservation = new PointObservation();
-    for( int d = 0; d < PointObservation::SIZE; d++ )
+    const LinearObject::VectorType zeroMean = this->observations[ i ].Observation - centroid;
+    for ( int d1 = 0; d1 < PointObservation::SIZE; d1++ )
     {
-      newObservation->Observation.push_back( this->GetObservation( i )->Observation.at( d ) - centroid.at( d ) );
-    }
-    zeroMeanBuffer->AddObservation( newObservation );
-  }
-
-  // Pick two dimensions, and find their covariance
-  for ( int d1 = 0; d1 < PointObservation::SIZE; d1++ )
-  {
-    for ( int d2 = 0; d2 < PointObservation::SIZE; d2++ )
-    {
-      // Iterate over all times
-      for ( unsigned int i = 0; i < this->Size(); i++ )
+      for ( int d2 = 0; d2 < PointObservation::SIZE; d2++ )
       {
-        cov->put( d1, d2, cov->get( d1, d2 ) + zeroMeanBuffer->GetObservation( i )->Observation.at( d1 ) * zeroMeanBuffer->GetObservation( i )->Observation.at( d2 ) );
+        cov( d1, d2 ) += zeroMean[ d1 ] * zeroMean[ d2 ];
       }
-      // Divide by the number of records
-      cov->put( d1, d2, cov->get( d1, d2 ) / this->Size() );
     }
   }
 
+  // Divide by the number of records
+  cov /= this->Size();
+
   return cov;
 
 }
 
 //-----------------------------------------------------------------------------
 
-std::vector<double> PointObservationBuffer::CalculateCentroid()
+LinearObject::VectorType PointObservationBuffer::CalculateCentroid() const
 {
   // Calculate the centroid
-  std::vector<double> centroid( PointObservation::SIZE, 0.0 );
+  LinearObject::VectorType centroid( 0.0 );
   for ( unsigned int i = 0; i < this->Size(); i++ )
   {
-    for ( int d = 0; d < PointObservation::SIZE; d++ )
-    {
-      centroid.at( d ) = centroid.at( d ) + this->GetObservation( i )->Observation.at( d );
-    }
-  }
-  for ( int d = 0; d < PointObservation::SIZE; d++ )
-  {
-    centroid.at( d ) = centroid.at( d ) / this->Size();
+    centroid += this->observations[ i ].Observation;
   }
+  centroid /= this->Size();
 
   return centroid;
 }
 
 //-----------------------------------------------------------------------------
 
-std::vector<PointObservationBuffer*> PointObservationBuffer::ExtractLinearObjects( int collectionFrames, double extractionThreshold, std::vector<int>* dof )
+void PointObservationBuffer::ExtractLinearObjects( int collectionFrames, double extractionThreshold, std::vector<PointObservationBuffer>& linearObjects, std::vector<int>& dof ) const
 {
   // First, let us identify the segmentation points and the associated DOFs, then we can divide up the points
-  int TEST_INTERVAL = 21;
-
-  PointObservationBuffer* eigenBuffer = new PointObservationBuffer(); // Note: 1 < 2 < 3
-  int currStartIndex, currEndIndex;
-  bool collecting = false;
-
-  std::vector<PointObservationBuffer*> linearObjects;
-
-  // Note: i is the start of the interval over which we will exam for linearity
-  for ( unsigned int i = 0; i < this->Size() - TEST_INTERVAL; i++ )
+  linearObjects.clear();
+  dof.clear();
+  if ( this->Size() <= static_cast<PointObservationVector::size_type>( TEST_INTERVAL ) )
   {
-    // Create a smaller point observation buffer to work with at each iteration with the points of interest
-    PointObservationBuffer* tempBuffer = new PointObservationBuffer();
-    for ( unsigned int j = i; j < i + TEST_INTERVAL; j++ )
-    {
-      tempBuffer->AddObservation( this->GetObservation( j ) );
-    }
+    return;
+  }
 
-    // Find the eigenvalues of covariance matrix
-    std::vector<double> centroid = tempBuffer->CalculateCentroid();
-    vnl_matrix<double>* cov = tempBuffer->CovarianceMatrix( centroid );
+  // Note: window i is the interval starting at observation i over which we will exam for linearity
+  const unsigned int numberOfWindows = this->Size() - TEST_INTERVAL;
 
-    //Calculate the eigenvectors of the covariance matrix
-    vnl_matrix<double> eigenvectors( PointObservation::SIZE, PointObservation::SIZE, 0.0 );
-    vnl_vector<double> eigenvalues( PointObservation::SIZE, 0.0 );
-    vnl_symmetric_eigensystem_compute( *cov, eigenvectors, eigenvalues );
-    // Note: eigenvectors are ordered in increasing eigenvalue ( 0 = smallest, end = biggest )
+  // The windows are independent of each other, so their eigenvalues are computed up front (on multiple threads for long recordings)
+  std::vector<LinearObject::VectorType> eigenBuffer( numberOfWindows ); // Note: 1 < 2 < 3
+  WindowEigenvaluesThreadFunctionInfoStruct str;
+  str.Buffer = this;
+  str.Eigenvalues = &eigenBuffer;
+  if ( numberOfWindows >= 2 * MINIMUM_NUMBER_OF_WINDOWS_PER_THREAD )
+  {
+    vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+    threader->SetSingleMethod( ComputeWindowEigenvaluesThreadFunction, &str );
+    threader->SingleMethodExecute();
+  }
+  else
+  {
+    ComputeWindowEigenvalues( str, 0, numberOfWindows );
+  }
 
-    std::vector<double> eigen( 3, 0.0 );
-    eigen.at( 0 ) = eigenvalues.get( 0 );
-    eigen.at( 1 ) = eigenvalues.get( 1 );
-    eigen.at( 2 ) = eigenvalues.get( 2 );
-    eigenBuffer->AddObservation( new PointObservation( eigen ) );
+  int currStartIndex = 0;
+  int currEndIndex = 0;
+  bool collecting = false;
 
+  for ( unsigned int i = 0; i < numberOfWindows; i++ )
+  {
     if ( !collecting )
     {
       currStartIndex = i;
     }
 
-    if ( eigenvalues.get( 0 ) < extractionThreshold )
+    if ( eigenBuffer[ i ][ 0 ] < extractionThreshold )
     {
       collecting = true;
       continue;
@@ -373,7 +410,7 @@ std::vector<PointObservationBuffer*> PointObservationBuffer::ExtractLinearObject
       dofInterval.push_back( currStartIndex );
       for ( int j = currStartIndex; j < currEndIndex; j++ )
       {
-        if ( eigenBuffer->GetObservation( j )->Observation.at( e ) > extractionThreshold )
+        if ( eigenBuffer[ j ][ e ] > extractionThreshold )
         {
           dofInterval.push_back( j );
         }
@@ -399,17 +436,13 @@ std::vector<PointObservationBuffer*> PointObservationBuffer::ExtractLinearObject
       }
 
       // Otherwise, this is a collected linear object
-      PointObservationBuffer* foundBuffer = new PointObservationBuffer();
-      for ( int j = dofInterval.at( maxIntervalIndex ); j < dofInterval.at( maxIntervalIndex + 1 ); j++ )
-      {
-        foundBuffer->AddObservation( this->GetObservation( j + TEST_INTERVAL ) );
-      }
+      linearObjects.push_back( PointObservationBuffer() );
+      PointObservationBuffer& foundBuffer = linearObjects.back();
+      foundBuffer.observations.assign( this->observations.begin() + dofInterval.at( maxIntervalIndex ) + TEST_INTERVAL,
+        this->observations.begin() + dofInterval.at( maxIntervalIndex + 1 ) + TEST_INTERVAL );
 
-      linearObjects.push_back( foundBuffer );
-      dof->push_back( PointObservation::SIZE - 1 - e );
+      dof.push_back( PointObservation::SIZE - 1 - e );
       break;
     }
   }
-
-  return linearObjects;
 }
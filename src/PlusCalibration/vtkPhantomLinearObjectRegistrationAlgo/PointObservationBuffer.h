@@ -7,6 +7,9 @@ See License.txt for details.
 #ifndef POINTOBSERVATIONBUFFER_H
 #define POINTOBSERVATIONBUFFER_H
 
+#include "vtkPlusCalibrationExport.h"
+
+#include "PlusConfigure.h"
 #include "PointObservation.h"
 #include "LinearObject.h"
 #include "Point.h"
@@ -19,44 +22,47 @@ See License.txt for details.
 #include <vector>
 #include <cmath>
 
-#include "vnl/vnl_matrix.h"
-#include "vnl/algo/vnl_symmetric_eigensystem.h"
-#include "vnl/algo/vnl_svd.h"
+#include "vnl/vnl_matrix_fixed.h"
 
 
-class PointObservationBuffer
+// This class stores the observations by value in contiguous memory, copies of a buffer are independent
+class vtkPlusCalibrationExport PointObservationBuffer
 {
 private:
-  typedef std::vector<PointObservation*> PointObservationVector;
+  typedef std::vector<PointObservation> PointObservationVector;
   PointObservationVector observations;
 
 public:
+  typedef vnl_matrix_fixed<double, PointObservation::SIZE, PointObservation::SIZE> MatrixType;
 
   PointObservationBuffer();
   ~PointObservationBuffer();
 
   PointObservationVector::size_type Size() const;
-  PointObservation* GetObservation( int index ) const;
+  const PointObservation& GetObservation( int index ) const;
+  PointObservation& GetObservation( int index );
 
-  void AddObservation( PointObservation* newObservation );
+  void AddObservation( const PointObservation& newObservation );
   void Clear();
 
-  void Translate( std::vector<double> translation );
+  void Translate( const LinearObject::VectorType& translation );
 
-  LinearObject* LeastSquaresLinearObject( int dof );
-  void Filter( LinearObject* object, int filterWidth );
+  // Returns a new object, the caller is responsible for deleting it
+  LinearObject* LeastSquaresLinearObject( int dof ) const;
+  void Filter( const LinearObject* object, int filterWidth );
 
-  vnl_matrix<double>* SphericalRegistration( PointObservationBuffer* fromPoints );
-  vnl_matrix<double>* TranslationalRegistration( std::vector<double> toCentroid, std::vector<double> fromCentroid, vnl_matrix<double>* rotation );
+  PlusStatus SphericalRegistration( const PointObservationBuffer& fromPoints, MatrixType& rotation ) const;
+  LinearObject::VectorType TranslationalRegistration( const LinearObject::VectorType& toCentroid, const LinearObject::VectorType& fromCentroid, const MatrixType& rotation ) const;
 
-  std::vector<PointObservationBuffer*> ExtractLinearObjects( int collectionFrames, double extractionThreshold, std::vector<int>* dof );
+  // The windows of consecutive observations are analyzed in parallel, the result does not depend on the number of threads
+  void ExtractLinearObjects( int collectionFrames, double extractionThreshold, std::vector<PointObservationBuffer>& linearObjects, std::vector<int>& dof ) const;
 
   std::string ToXMLString() const;
   void FromXMLElement( vtkXMLDataElement* element );
 
 private:
-  std::vector<double> CalculateCentroid();
-  vnl_matrix<double>* CovarianceMatrix( std::vector<double> centroid );
+  LinearObject::VectorType CalculateCentroid() const;
+  MatrixType CovarianceMatrix( const LinearObject::VectorType& centroid ) const;
 
 };
 
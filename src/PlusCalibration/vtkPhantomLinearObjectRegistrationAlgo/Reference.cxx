@@ -17,7 +17,7 @@ Reference::Reference()
 
 //-----------------------------------------------------------------------------
 
-Reference::Reference( std::vector<double> newBasePoint )
+Reference::Reference( const VectorType& newBasePoint )
 {
   this->Type = "Reference";
   this->BasePoint = newBasePoint;
@@ -31,19 +31,16 @@ Reference::~Reference()
 
 //-----------------------------------------------------------------------------
 
-std::vector<double> Reference::ProjectVector( std::vector<double> vector )
+LinearObject::VectorType Reference::ProjectVector( const VectorType& vector ) const
 {
   return this->BasePoint;
 }
 
 //-----------------------------------------------------------------------------
 
-void Reference::Translate( std::vector<double> vector )
+void Reference::Translate( const VectorType& vector )
 {
-  for ( unsigned int i = 0; i < vector.size(); i++ )
-  {
-    this->BasePoint.at(i) = this->BasePoint.at(i) + vector.at(i);
-  }
+  this->BasePoint += vector;
 }
 
 //-----------------------------------------------------------------------------
@@ -70,6 +67,6 @@ void Reference::FromXMLElement( vtkXMLDataElement* element )
   }
 
   this->Name = std::string( element->GetAttribute( "Name" ) );
-  this->BasePoint = StringToVector( std::string( element->GetAttribute( "BasePoint" ) ), 3 );
+  this->BasePoint = StringToVector( std::string( element->GetAttribute( "BasePoint" ) ) );
 
 }
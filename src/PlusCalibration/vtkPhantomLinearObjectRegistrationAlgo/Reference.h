@@ -7,6 +7,8 @@ See License.txt for details.
 #ifndef REFERENCE_H
 #define REFERENCE_H
 
+#include "vtkPlusCalibrationExport.h"
+
 #include "LinearObject.h"
 
 #include <string>
@@ -15,15 +17,15 @@ See License.txt for details.
 #include <cmath>
 
 // This class stores a vector of values and a string label
-class Reference : public LinearObject
+class vtkPlusCalibrationExport Reference : public LinearObject
 {
 public:
   Reference();
-  Reference( std::vector<double> newBasePoint );
+  Reference( const VectorType& newBasePoint );
   ~Reference();
 
-  std::vector<double> ProjectVector( std::vector<double> vector );
-  void Translate( std::vector<double> vector );
+  VectorType ProjectVector( const VectorType& vector ) const;
+  void Translate( const VectorType& vector );
 
   virtual std::string ToXMLString() const;
   virtual void FromXMLElement( vtkXMLDataElement* element );
@@ -213,13 +213,7 @@ PlusStatus vtkPlusPhantomLinearObjectRegistrationAlgo::ReadConfiguration(vtkXMLD
         continue;
       }
       
-      std::vector<double> referencePositionVector;
-      for(int j=0; j<3;j++)
-      {
-        referencePositionVector.push_back(referencePosition[j]);
-      }
-      
-      this->DefinedReferences.InsertReference(Reference(referencePositionVector));
+      this->DefinedReferences.InsertReference(Reference(LinearObject::VectorType(referencePosition)));
       this->DefinedReferenceNames[i] = referenceName;
     }
   }
@@ -272,7 +266,7 @@ PlusStatus vtkPlusPhantomLinearObjectRegistrationAlgo::ReadConfiguration(vtkXMLD
       }
 
       //define an array of length 3 of 3-tuples (each plane has 3 points that define it each with 3 rectangular coordinates in the phantom coordinate system)
-      std::vector<double> pointsOnPlane[3];
+      LinearObject::VectorType pointsOnPlane[3];
 
       double pointOnPlane[3];
       //test the validity of each point on the plane then add the plane to the DefinedPlanes
@@ -281,30 +275,21 @@ PlusStatus vtkPlusPhantomLinearObjectRegistrationAlgo::ReadConfiguration(vtkXMLD
         LOG_WARNING("Invalid base point position!");
         continue;
       }
-      for(int j=0; j<3; j++)
-      {
-        pointsOnPlane[0].push_back(pointOnPlane[j]);
-      }
+      pointsOnPlane[0] = LinearObject::VectorType(pointOnPlane);
 
       if (! plane->GetVectorAttribute("EndPoint1", 3, pointOnPlane))
       {
         LOG_WARNING("Invalid end point 1 position!");
         continue;
       }
-      for(int j=0; j<3; j++)
-      {
-        pointsOnPlane[1].push_back(pointOnPlane[j]);
-      }
+      pointsOnPlane[1] = LinearObject::VectorType(pointOnPlane);
       
       if (! plane->GetVectorAttribute("EndPoint2", 3, pointOnPlane))
       {
         LOG_WARNING("Invalid end point 2 position!");
         continue;
       }
-      for(int j=0; j<3; j++)
-      {
-        pointsOnPlane[2].push_back(pointOnPlane[j]);
-      }
+      pointsOnPlane[2] = LinearObject::VectorType(pointOnPlane);
       
       this->DefinedPlanes.InsertPlane(Plane(pointsOnPlane[0], pointsOnPlane[1], pointsOnPlane[2]));
       this->DefinedPlaneNames[i] = planeName;
@@ -16,8 +16,28 @@
 #include "vtkMath.h"
 #include "vtksys/SystemTools.hxx"
 
+#include "vnl/algo/vnl_symmetric_eigensystem.h"
+
+#include <algorithm>
+
 vtkStandardNewMacro(vtkPlusPivotCalibrationAlgo);
 
+namespace
+{
+  // Points are not rejected as outliers and the outlier error threshold is not computed until this many points are inserted
+  const unsigned int MINIMUM_NUMBER_OF_POINTS_FOR_OUTLIER_REJECTION = 10;
+  // Inserted points are only rejected if the condition number is below this value (if the stylus has not been rotated
+  // by at least a few degrees then the pivot point is not accurate enough to decide if a point is an outlier)
+  const double MAXIMUM_CONDITION_NUMBER_FOR_OUTLIER_REJECTION = 20.0;
+  // Pivot point cannot be computed if the smallest eigenvalue of the normal equations is smaller than this times the largest eigenvalue
+  const double MINIMUM_RELATIVE_EIGENVALUE = 1e-12;
+  // Points that have larger error than this times the median error are outliers
+  const double OUTLIER_ERROR_THRESHOLD_MEDIAN_MULTIPLIER = 3.0;
+  // Points that have smaller error than this are never outliers (to not reject points because of normal tracking inaccuracy)
+  const double MINIMUM_OUTLIER_ERROR_THRESHOLD_MM = 0.5;
+  const int MAXIMUM_NUMBER_OF_OUTLIER_REFINEMENT_ITERATIONS = 3;
+}
+
 //-----------------------------------------------------------------------------
 vtkPlusPivotCalibrationAlgo::vtkPlusPivotCalibrationAlgo()
 {
@@ -31,6 +51,9 @@ vtkPlusPivotCalibrationAlgo::vtkPlusPivotCalibrationAlgo()
   this->PivotPointPosition_Reference[1] = 0.0;
   this->PivotPointPosition_Reference[2] = 0.0;
   this->PivotPointPosition_Reference[3] = 1.0;
+
+  this->IncrementalCalibration = false;
+  this->ResetIncrementalCalibration();
 }
 
 //-----------------------------------------------------------------------------
@@ -49,6 +72,7 @@ void vtkPlusPivotCalibrationAlgo::RemoveAllCalibrationPoints()
   }
   this->MarkerToReferenceTransformMatrixArray.clear();
   this->OutlierIndices.clear();
+  this->ResetIncrementalCalibration();
 }
 
 //----------------------------------------------------------------------------
@@ -57,6 +81,29 @@ PlusStatus vtkPlusPivotCalibrationAlgo::InsertNextCalibrationPoint(vtkMatrix4x4*
   vtkMatrix4x4* markerToReferenceTransformMatrixCopy = vtkMatrix4x4::New();
   markerToReferenceTransformMatrixCopy->DeepCopy(aMarkerToReferenceTransformMatrix);
   this->MarkerToReferenceTransformMatrixArray.push_back(markerToReferenceTransformMatrixCopy);
+  unsigned int numberOfPoints = this->MarkerToReferenceTransformMatrixArray.size();
+
+  // Reject the point if it is far from the current pivot point estimate
+  if (this->IncrementalSolutionValid && this->IncrementalOutlierErrorThreshold >= 0
+      && this->IncrementalConditionNumber <= MAXIMUM_CONDITION_NUMBER_FOR_OUTLIER_REJECTION
+      && GetIncrementalPivotPointError(markerToReferenceTransformMatrixCopy) > this->IncrementalOutlierErrorThreshold)
+  {
+    LOG_DEBUG("Pivot calibration point " << numberOfPoints - 1 << " is an outlier");
+    this->IncrementalOutlierIndices.insert(this->IncrementalOutlierIndices.end(), numberOfPoints - 1);
+  }
+  else
+  {
+    UpdateIncrementalNormalEquations(markerToReferenceTransformMatrixCopy, 1.0);
+    UpdateIncrementalSolution();
+  }
+
+  // Classify all the points again each time the number of points doubles, so the average cost per point remains constant
+  if (numberOfPoints >= this->NextIncrementalRefinementNumberOfPoints)
+  {
+    RefineIncrementalCalibration();
+    this->NextIncrementalRefinementNumberOfPoints = 2 * numberOfPoints;
+  }
+
   return PLUS_SUCCESS;
 }
 
@@ -165,7 +212,18 @@ PlusStatus vtkPlusPivotCalibrationAlgo::DoPivotCalibration(vtkPlusTransformRepos
 
   double pivotPoint_Marker[4] = {0, 0, 0, 1};
   double pivotPoint_Reference[4] = {0, 0, 0, 1};
-  if (GetPivotPointPosition(pivotPoint_Marker, pivotPoint_Reference) != PLUS_SUCCESS)
+  if (this->IncrementalCalibration)
+  {
+    // Make sure that all the points are classified using the final estimate
+    RefineIncrementalCalibration();
+    if (GetIncrementalPivotPointPosition(pivotPoint_Marker, pivotPoint_Reference) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("vtkPlusPivotCalibrationAlgo failed: the pivot point cannot be determined, the stylus has not been rotated enough");
+      return PLUS_FAIL;
+    }
+    this->OutlierIndices = this->IncrementalOutlierIndices;
+  }
+  else if (GetPivotPointPosition(pivotPoint_Marker, pivotPoint_Reference) != PLUS_SUCCESS)
   {
     return PLUS_FAIL;
   }
@@ -282,6 +340,7 @@ PlusStatus vtkPlusPivotCalibrationAlgo::ReadConfiguration(vtkXMLDataElement* aCo
   XML_READ_CSTRING_ATTRIBUTE_REQUIRED(ObjectMarkerCoordinateFrame, pivotCalibrationElement);
   XML_READ_CSTRING_ATTRIBUTE_REQUIRED(ReferenceCoordinateFrame, pivotCalibrationElement);
   XML_READ_CSTRING_ATTRIBUTE_REQUIRED(ObjectPivotPointCoordinateFrame, pivotCalibrationElement);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(IncrementalCalibration, pivotCalibrationElement);
   return PLUS_SUCCESS;
 }
 
@@ -289,11 +348,15 @@ PlusStatus vtkPlusPivotCalibrationAlgo::ReadConfiguration(vtkXMLDataElement* aCo
 void vtkPlusPivotCalibrationAlgo::ComputeCalibrationError()
 {
   double* pivotPoint_Reference = this->PivotPointPosition_Reference;
-
-  vtkSmartPointer<vtkMatrix4x4> pivotPointToReferenceMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  double pivotPoint_Marker[4] = {0, 0, 0, 1};
+  for (int i = 0; i < 3; i++)
+  {
+    pivotPoint_Marker[i] = this->PivotPointToMarkerTransformMatrix->Element[i][3];
+  }
 
   // Compute the error for each sample as distance between the mean pivot point position and the pivot point position computed from each sample
   std::vector<double> errorValues;
+  errorValues.reserve(this->MarkerToReferenceTransformMatrixArray.size());
   double currentPivotPoint_Reference[4] = {0, 0, 0, 1};
   unsigned int sampleIndex = 0;
   for (std::list< vtkMatrix4x4* >::iterator markerToReferenceTransformIt = this->MarkerToReferenceTransformMatrixArray.begin();
@@ -305,11 +368,7 @@ void vtkPlusPivotCalibrationAlgo::ComputeCalibrationError()
       continue;
     }
 
-    vtkMatrix4x4::Multiply4x4((*markerToReferenceTransformIt), this->PivotPointToMarkerTransformMatrix, pivotPointToReferenceMatrix);
-    for (int i = 0; i < 3; i++)
-    {
-      currentPivotPoint_Reference[i] = pivotPointToReferenceMatrix->Element[i][3];
-    }
+    (*markerToReferenceTransformIt)->MultiplyPoint(pivotPoint_Marker, currentPivotPoint_Reference);
     double errorValue = sqrt(vtkMath::Distance2BetweenPoints(currentPivotPoint_Reference, pivotPoint_Reference));
     errorValues.push_back(errorValue);
   }
@@ -326,3 +385,168 @@ int vtkPlusPivotCalibrationAlgo::GetNumberOfDetectedOutliers()
 {
   return this->OutlierIndices.size();
 }
+
+//----------------------------------------------------------------------------
+void vtkPlusPivotCalibrationAlgo::ResetIncrementalCalibration()
+{
+  this->IncrementalAtA.set_size(6, 6);
+  this->IncrementalAtA.fill(0.0);
+  this->IncrementalAtb.set_size(6);
+  this->IncrementalAtb.fill(0.0);
+  this->IncrementalBtb = 0.0;
+  this->IncrementalSolution.set_size(6);
+  this->IncrementalSolution.fill(0.0);
+  this->IncrementalSolutionValid = false;
+  this->IncrementalCalibrationError = -1.0;
+  this->IncrementalConditionNumber = -1.0;
+  this->IncrementalOutlierErrorThreshold = -1.0;
+  this->NextIncrementalRefinementNumberOfPoints = MINIMUM_NUMBER_OF_POINTS_FOR_OUTLIER_REJECTION;
+  this->IncrementalOutlierIndices.clear();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusPivotCalibrationAlgo::UpdateIncrementalNormalEquations(vtkMatrix4x4* markerToReferenceTransformMatrix, double sign)
+{
+  // Each point adds 3 equations (see GetPivotPointPosition):
+  //  Ai = [ MarkerToReferenceTransformRotationMatrix | -Identity3x3 ], bi = -MarkerToReferenceTransformTranslationVector
+  for (int i = 0; i < 3; i++)
+  {
+    double aRow[6] = { markerToReferenceTransformMatrix->Element[i][0], markerToReferenceTransformMatrix->Element[i][1], markerToReferenceTransformMatrix->Element[i][2],
+                       (i == 0 ? -1.0 : 0.0), (i == 1 ? -1.0 : 0.0), (i == 2 ? -1.0 : 0.0)
+                     };
+    double b = -markerToReferenceTransformMatrix->Element[i][3];
+    for (int row = 0; row < 6; row++)
+    {
+      for (int col = 0; col < 6; col++)
+      {
+        this->IncrementalAtA(row, col) += sign * aRow[row] * aRow[col];
+      }
+      this->IncrementalAtb(row) += sign * aRow[row] * b;
+    }
+    this->IncrementalBtb += sign * b * b;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusPivotCalibrationAlgo::UpdateIncrementalSolution()
+{
+  this->IncrementalSolutionValid = false;
+  this->IncrementalCalibrationError = -1.0;
+  this->IncrementalConditionNumber = -1.0;
+
+  unsigned int numberOfNotOutlierPoints = this->MarkerToReferenceTransformMatrixArray.size() - this->IncrementalOutlierIndices.size();
+  if (numberOfNotOutlierPoints < 2)
+  {
+    // Rotation around at least two different axes is needed
+    return;
+  }
+
+  // Eigenvalues are in increasing order
+  vnl_symmetric_eigensystem<double> eigenSystem(this->IncrementalAtA);
+  double minEigenvalue = eigenSystem.get_eigenvalue(0);
+  double maxEigenvalue = eigenSystem.get_eigenvalue(5);
+  if (maxEigenvalue <= 0 || minEigenvalue <= maxEigenvalue * MINIMUM_RELATIVE_EIGENVALUE)
+  {
+    // All the points have (almost) the same orientation, the pivot point cannot be determined
+    return;
+  }
+  // Eigenvalues of A^T*A are the squared singular values of A
+  this->IncrementalConditionNumber = sqrt(maxEigenvalue / minEigenvalue);
+  this->IncrementalSolution = eigenSystem.solve(this->IncrementalAtb);
+  this->IncrementalSolutionValid = true;
+
+  // Sum of squared residuals: |Ax-b|^2 = x^T*A^T*A*x - 2*x^T*A^T*b + b^T*b
+  const vnl_vector<double>& x = this->IncrementalSolution;
+  double sumSquaredError = dot_product(x, this->IncrementalAtA * x) - 2 * dot_product(x, this->IncrementalAtb) + this->IncrementalBtb;
+  // The 3 residuals of a point are the coordinates of the pivot point error vector, so the RMS of the residual vector lengths is the RMS pivot point error
+  this->IncrementalCalibrationError = sqrt(std::max(sumSquaredError, 0.0) / numberOfNotOutlierPoints);
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusPivotCalibrationAlgo::GetIncrementalPivotPointError(vtkMatrix4x4* markerToReferenceTransformMatrix)
+{
+  double pivotPoint_Marker[4] = { this->IncrementalSolution[0], this->IncrementalSolution[1], this->IncrementalSolution[2], 1 };
+  double currentPivotPoint_Reference[4] = { 0, 0, 0, 1 };
+  markerToReferenceTransformMatrix->MultiplyPoint(pivotPoint_Marker, currentPivotPoint_Reference);
+  double pivotPoint_Reference[3] = { this->IncrementalSolution[3], this->IncrementalSolution[4], this->IncrementalSolution[5] };
+  return sqrt(vtkMath::Distance2BetweenPoints(currentPivotPoint_Reference, pivotPoint_Reference));
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusPivotCalibrationAlgo::RefineIncrementalCalibration()
+{
+  std::vector<double> errorValues(this->MarkerToReferenceTransformMatrixArray.size());
+  std::vector<double> sortedErrorValues;
+  for (int iteration = 0; iteration < MAXIMUM_NUMBER_OF_OUTLIER_REFINEMENT_ITERATIONS && this->IncrementalSolutionValid; iteration++)
+  {
+    unsigned int sampleIndex = 0;
+    for (std::list< vtkMatrix4x4* >::iterator markerToReferenceTransformIt = this->MarkerToReferenceTransformMatrixArray.begin();
+         markerToReferenceTransformIt != this->MarkerToReferenceTransformMatrixArray.end(); ++markerToReferenceTransformIt, ++sampleIndex)
+    {
+      errorValues[sampleIndex] = GetIncrementalPivotPointError(*markerToReferenceTransformIt);
+    }
+
+    // The median is not influenced by the outliers (as long as less than half of the points are outliers), so it is used instead of the standard deviation
+    sortedErrorValues = errorValues;
+    std::vector<double>::iterator medianIt = sortedErrorValues.begin() + sortedErrorValues.size() / 2;
+    std::nth_element(sortedErrorValues.begin(), medianIt, sortedErrorValues.end());
+    this->IncrementalOutlierErrorThreshold = std::max(OUTLIER_ERROR_THRESHOLD_MEDIAN_MULTIPLIER * (*medianIt), MINIMUM_OUTLIER_ERROR_THRESHOLD_MM);
+
+    std::set<unsigned int> outlierIndices;
+    for (unsigned int i = 0; i < errorValues.size(); i++)
+    {
+      if (errorValues[i] > this->IncrementalOutlierErrorThreshold)
+      {
+        outlierIndices.insert(outlierIndices.end(), i);
+      }
+    }
+    if (outlierIndices == this->IncrementalOutlierIndices)
+    {
+      // Classification has not changed
+      break;
+    }
+    this->IncrementalOutlierIndices.swap(outlierIndices);
+
+    // Recompute the normal equations from scratch, it is faster than updating them if many points are reclassified and it prevents accumulation of numerical errors
+    this->IncrementalAtA.fill(0.0);
+    this->IncrementalAtb.fill(0.0);
+    this->IncrementalBtb = 0.0;
+    sampleIndex = 0;
+    for (std::list< vtkMatrix4x4* >::iterator markerToReferenceTransformIt = this->MarkerToReferenceTransformMatrixArray.begin();
+         markerToReferenceTransformIt != this->MarkerToReferenceTransformMatrixArray.end(); ++markerToReferenceTransformIt, ++sampleIndex)
+    {
+      if (this->IncrementalOutlierIndices.find(sampleIndex) == this->IncrementalOutlierIndices.end())
+      {
+        UpdateIncrementalNormalEquations(*markerToReferenceTransformIt, 1.0);
+      }
+    }
+    UpdateIncrementalSolution();
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusPivotCalibrationAlgo::GetIncrementalPivotPointPosition(double* pivotPoint_Marker, double* pivotPoint_Reference)
+{
+  if (!this->IncrementalSolutionValid)
+  {
+    return PLUS_FAIL;
+  }
+  for (int i = 0; i < 3; i++)
+  {
+    pivotPoint_Marker[i] = this->IncrementalSolution[i];
+    pivotPoint_Reference[i] = this->IncrementalSolution[i + 3];
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusPivotCalibrationAlgo::GetNumberOfIncrementallyDetectedOutliers()
+{
+  return this->IncrementalOutlierIndices.size();
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusPivotCalibrationAlgo::GetNumberOfCalibrationPoints()
+{
+  return this->MarkerToReferenceTransformMatrixArray.size();
+}
@@ -15,6 +15,10 @@ See License.txt for details.
 #include <vtkObject.h>
 #include <vtkMatrix4x4.h>
 
+// VNL includes
+#include "vnl/vnl_matrix.h"
+#include "vnl/vnl_vector.h"
+
 // STL includes
 #include <list>
 #include <set>
@@ -40,6 +44,14 @@ class vtkXMLDataElement;
   The method detects outlier points (points that have larger than 3x error than the standard deviation) and ignores them when computing the pivot point
   coordinates and the calibration error.
 
+  The pivot point is also estimated incrementally while the calibration points are inserted: the normal equations of the
+  linear least squares problem are updated with each point, so the current pivot point, error and condition number are
+  available after each insertion (for providing live feedback to the user) at a constant computational cost per point.
+  Points that have much larger error than the other points are rejected as outliers when they are inserted. All points are
+  classified again each time the number of points doubles, so points that were misclassified by an early, less accurate
+  estimate are classified correctly later. If IncrementalCalibration is enabled then DoPivotCalibration uses the
+  incrementally computed result instead of solving the complete system again.
+
   \ingroup PlusLibCalibrationAlgorithm
 */
 class vtkPlusCalibrationExport vtkPlusPivotCalibrationAlgo : public vtkObject
@@ -86,8 +98,26 @@ public:
   */
   int GetNumberOfDetectedOutliers();
 
+  /*! Get the number of inserted calibration points */
+  int GetNumberOfCalibrationPoints();
+
+  /*!
+    Get the pivot point position computed from the calibration points that have been inserted so far.
+    The result is updated at each InsertNextCalibrationPoint call.
+    \return PLUS_FAIL if the position cannot be computed yet (not enough points or the stylus has not been rotated enough)
+  */
+  PlusStatus GetIncrementalPivotPointPosition(double* pivotPoint_Marker, double* pivotPoint_Reference);
+
+  /*! Get the number of points that are currently considered as outliers by the incremental calibration */
+  int GetNumberOfIncrementallyDetectedOutliers();
+
 public:
   vtkGetMacro(CalibrationError, double);
+  vtkGetMacro(IncrementalCalibrationError, double);
+  vtkGetMacro(IncrementalConditionNumber, double);
+  vtkGetMacro(IncrementalCalibration, bool);
+  vtkSetMacro(IncrementalCalibration, bool);
+  vtkBooleanMacro(IncrementalCalibration, bool);
   vtkGetObjectMacro(PivotPointToMarkerTransformMatrix, vtkMatrix4x4);
   vtkGetVector3Macro(PivotPointPosition_Reference, double);
   vtkGetStringMacro(ObjectMarkerCoordinateFrame);
@@ -110,6 +140,21 @@ protected:
 
   PlusStatus GetPivotPointPosition(double* pivotPoint_Marker, double* pivotPoint_Reference);
 
+  /*! Clear the incremental calibration normal equations and results */
+  void ResetIncrementalCalibration();
+
+  /*! Add (sign=1) or remove (sign=-1) the equations of a calibration point to/from the incremental normal equations */
+  void UpdateIncrementalNormalEquations(vtkMatrix4x4* markerToReferenceTransformMatrix, double sign);
+
+  /*! Solve the incremental normal equations and update the incremental pivot point, error, and condition number */
+  void UpdateIncrementalSolution();
+
+  /*! Classify all calibration points as outliers or not outliers based on the current incremental estimate and recompute the normal equations */
+  void RefineIncrementalCalibration();
+
+  /*! Distance between the pivot point position computed from the calibration point and the incrementally estimated pivot point position (in mm) */
+  double GetIncrementalPivotPointError(vtkMatrix4x4* markerToReferenceTransformMatrix);
+
 protected:
   /*! Pivot point to marker transform (eg. stylus tip to stylus) - the result of the calibration */
   vtkMatrix4x4*             PivotPointToMarkerTransformMatrix;
@@ -134,6 +179,39 @@ protected:
 
   /*! List of outlier sample indices */
   std::set<unsigned int>    OutlierIndices;
+
+  /*! If enabled then DoPivotCalibration uses the incrementally computed pivot point instead of solving the complete system again */
+  bool                      IncrementalCalibration;
+
+  /*! A^T*A of the pivot calibration equations of the points that are not incremental outliers */
+  vnl_matrix<double>        IncrementalAtA;
+
+  /*! A^T*b of the pivot calibration equations of the points that are not incremental outliers */
+  vnl_vector<double>        IncrementalAtb;
+
+  /*! b^T*b of the pivot calibration equations of the points that are not incremental outliers */
+  double                    IncrementalBtb;
+
+  /*! Incrementally computed pivot point position in the marker (first 3 elements) and reference (last 3 elements) coordinate system */
+  vnl_vector<double>        IncrementalSolution;
+
+  /*! True if the IncrementalSolution is computed from a well-determined system */
+  bool                      IncrementalSolutionValid;
+
+  /*! Root mean square of the pivot point errors of the points that are not incremental outliers (in mm) */
+  double                    IncrementalCalibrationError;
+
+  /*! Condition number of the pivot calibration equations, large value means that the stylus has not been rotated enough */
+  double                    IncrementalConditionNumber;
+
+  /*! Inserted points that have larger error than this threshold are outliers (in mm). Negative if no threshold has been computed yet. */
+  double                    IncrementalOutlierErrorThreshold;
+
+  /*! All the points are classified again when this number of points is reached */
+  unsigned int              NextIncrementalRefinementNumberOfPoints;
+
+  /*! List of sample indices that are outliers according to the incremental calibration */
+  std::set<unsigned int>    IncrementalOutlierIndices;
 };
 
 #endif
@@ -1145,6 +1145,23 @@ void vtkPlusProbeCalibrationAlgo::ComputeError3d(const vnl_matrix_fixed<double,
   PlusMath::ComputeRms(reprojectionErrors, errorRms);
 }
 
+//--------------------------------------------------------------------------------
+void vtkPlusProbeCalibrationAlgo::GetOptimizationWirePositions(std::vector< vnl_vector_fixed<double, 4> >& allWiresIntersectionPointsPos_Image,
+    std::vector< vnl_vector_fixed<double, 4> >& middleWireIntersectionPointsPos_Probe,
+    std::vector< vnl_matrix_fixed<double, 4, 4> >& probeToPhantomTransforms)
+{
+  allWiresIntersectionPointsPos_Image.clear();
+  middleWireIntersectionPointsPos_Probe.clear();
+  probeToPhantomTransforms.clear();
+  const std::vector<NWirePositionType>& framePositions = this->PreProcessedWirePositions[CALIBRATION_NOT_OUTLIER].FramePositions;
+  for (std::vector<NWirePositionType>::const_iterator frameIt = framePositions.begin(); frameIt != framePositions.end(); ++frameIt)
+  {
+    allWiresIntersectionPointsPos_Image.insert(allWiresIntersectionPointsPos_Image.end(), frameIt->AllWiresIntersectionPointsPos_Image.begin(), frameIt->AllWiresIntersectionPointsPos_Image.end());
+    middleWireIntersectionPointsPos_Probe.insert(middleWireIntersectionPointsPos_Probe.end(), frameIt->MiddleWireIntersectionPointsPos_Probe.begin(), frameIt->MiddleWireIntersectionPointsPos_Probe.end());
+    probeToPhantomTransforms.push_back(frameIt->ProbeToPhantomTransform);
+  }
+}
+
 //--------------------------------------------------------------------------------
 double vtkPlusProbeCalibrationAlgo::GetCalibrationReprojectionError3DMean()
 {
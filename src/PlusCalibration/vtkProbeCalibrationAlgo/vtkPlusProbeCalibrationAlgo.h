@@ -122,6 +122,22 @@ public:
   void ComputeError2d( const vnl_matrix_fixed<double, 4, 4>& imageToProbeMatrix, double& errorMean, double& errorStDev, double& errorRms );
   void ComputeError3d( const vnl_matrix_fixed<double, 4, 4>& imageToProbeMatrix, double& errorMean, double& errorStDev, double& errorRms );
 
+  /*!
+    Get the wire positions that the optimizer computes the error for (the calibration frames that are not outliers)
+    \param allWiresIntersectionPointsPos_Image Segmented wire intersection positions in the image frame (3 positions for each N-wire in each frame)
+    \param middleWireIntersectionPointsPos_Probe Computed middle wire intersection positions in the probe frame (1 position for each N-wire in each frame)
+    \param probeToPhantomTransforms Probe to phantom transform of each frame
+  */
+  void GetOptimizationWirePositions( std::vector< vnl_vector_fixed<double, 4> >& allWiresIntersectionPointsPos_Image,
+                                     std::vector< vnl_vector_fixed<double, 4> >& middleWireIntersectionPointsPos_Probe,
+                                     std::vector< vnl_matrix_fixed<double, 4, 4> >& probeToPhantomTransforms );
+
+  /*! Get the N-wires that are used for calibration and error computation */
+  const std::vector<PlusNWire>& GetNWires() const
+  {
+    return this->NWires;
+  };
+
 protected:
 
   enum PreProcessedWirePositionIdType
@@ -10,6 +10,8 @@ See License.txt for details.
 
 #include "vtkObjectFactory.h"
 #include "vtkMath.h"
+#include "vtkMultiThreader.h"
+#include "vtkPlusAccurateTimer.h"
 #include "vtkPlusProbeCalibrationOptimizerAlgo.h"
 #include "vtkPlusProbeCalibrationAlgo.h"
 #include "vtkTransform.h"
@@ -18,6 +20,10 @@ See License.txt for details.
 
 #include "vtksys/SystemTools.hxx"
 
+#include <vnl/vnl_inverse.h>
+
+#include <algorithm>
+
 #include "itkPowellOptimizer.h"
 #include "itkScaleVersor3DTransform.h"
 #include "itkSimilarity3DTransform.h"
@@ -159,12 +165,398 @@ private:
   vtkPlusProbeCalibrationOptimizerAlgo* m_CalibrationOptimizer;
 }; 
 
+//-----------------------------------------------------------------------------
+namespace
+{
+  const int LM_MAX_NUMBER_OF_PARAMETERS = 8;
+  const int LM_MAX_NUMBER_OF_ITERATIONS = 100;
+  const double LM_INITIAL_DAMPING = 1e-3;
+  const double LM_MAX_DAMPING = 1e10;
+  const double LM_VALUE_TOLERANCE = 1e-8;
+  const double LM_STEP_TOLERANCE = 1e-8;
+
+  /*! Segmented middle wire position in the image frame and computed middle wire position in the probe frame (input of the 3D error) */
+  struct MiddleWireObservation
+  {
+    double Point_Image[3];
+    double Point_Probe[3];
+  };
+
+  /*! Segmented wire position in the image frame and wire end points in the probe frame (input of the 2D error) */
+  struct WireObservation
+  {
+    double Point_Image[2];
+    double WireFrontPoint_Probe[3];
+    double WireBackPoint_Probe[3];
+  };
+
+  /*!
+    Image to probe transform estimate of the Levenberg-Marquardt optimizer: ImageToProbe = [Rotation * diag(Scale), Translation].
+    The 7 or 8 optimized parameters are: 3 versor components of a rotation update (the updated rotation is VersorRotation * Rotation),
+    3 translation and 1 (isotropic) or 2 (X, Y) scale components. Derivatives are computed at zero rotation update, where they are
+    well-defined for any rotation, unlike the derivatives of the absolute versor parameters at rotation angles close to 180 deg.
+  */
+  struct ImageToProbeTransformEstimate
+  {
+    int NumberOfParameters;
+    double Rotation[3][3];
+    double Translation[3];
+    double Scale[3];
+    /*! Derivative of Scale with respect to the scale parameters ([scale parameter][axis]) */
+    double ScaleDerivatives[2][3];
+  };
+
+  /*! Sum of squared errors and the normal equations of the Gauss-Newton step */
+  struct ErrorAccumulator
+  {
+    int NumberOfParameters;
+    double SumOfSquares;
+    /*! Jacobian transpose * Jacobian (only the upper triangle is accumulated) */
+    double JtJ[LM_MAX_NUMBER_OF_PARAMETERS][LM_MAX_NUMBER_OF_PARAMETERS];
+    /*! Jacobian transpose * residual */
+    double Jtr[LM_MAX_NUMBER_OF_PARAMETERS];
+
+    void Clear(int numberOfParameters)
+    {
+      this->NumberOfParameters = numberOfParameters;
+      this->SumOfSquares = 0.0;
+      for (int i = 0; i < LM_MAX_NUMBER_OF_PARAMETERS; ++i)
+      {
+        this->Jtr[i] = 0.0;
+        for (int j = 0; j < LM_MAX_NUMBER_OF_PARAMETERS; ++j)
+        {
+          this->JtJ[i][j] = 0.0;
+        }
+      }
+    }
+
+    void Add(double residual, const double* jacobianRow)
+    {
+      this->SumOfSquares += residual * residual;
+      if (jacobianRow == NULL)
+      {
+        return;
+      }
+      for (int i = 0; i < this->NumberOfParameters; ++i)
+      {
+        this->Jtr[i] += jacobianRow[i] * residual;
+        for (int j = i; j < this->NumberOfParameters; ++j)
+        {
+          this->JtJ[i][j] += jacobianRow[i] * jacobianRow[j];
+        }
+      }
+    }
+
+    void Add(const ErrorAccumulator& errors)
+    {
+      this->SumOfSquares += errors.SumOfSquares;
+      for (int i = 0; i < this->NumberOfParameters; ++i)
+      {
+        this->Jtr[i] += errors.Jtr[i];
+        for (int j = i; j < this->NumberOfParameters; ++j)
+        {
+          this->JtJ[i][j] += errors.JtJ[i][j];
+        }
+      }
+    }
+  };
+
+  //-----------------------------------------------------------------------------
+  /*! Compute the rotation matrix of a versor (same convention as itk::Versor). Returns false if the versor is invalid. */
+  bool GetVersorRotationMatrix(const double versor[3], double rotation[3][3])
+  {
+    double x = versor[0];
+    double y = versor[1];
+    double z = versor[2];
+    double squaredNorm = x * x + y * y + z * z;
+    if (squaredNorm >= 1.0)
+    {
+      return false;
+    }
+    double w = sqrt(1.0 - squaredNorm);
+    rotation[0][0] = 1.0 - 2.0 * (y * y + z * z);
+    rotation[1][1] = 1.0 - 2.0 * (x * x + z * z);
+    rotation[2][2] = 1.0 - 2.0 * (x * x + y * y);
+    rotation[0][1] = 2.0 * (x * y - z * w);
+    rotation[0][2] = 2.0 * (x * z + y * w);
+    rotation[1][0] = 2.0 * (x * y + z * w);
+    rotation[2][0] = 2.0 * (x * z - y * w);
+    rotation[1][2] = 2.0 * (y * z - x * w);
+    rotation[2][1] = 2.0 * (y * z + x * w);
+    return true;
+  }
+
+  //-----------------------------------------------------------------------------
+  /*!
+    Set the derivatives of VersorRotation * v with respect to the 3 versor components at zero rotation update
+    (2 * e_k x v) in columns 0-2 of the jacobian, multiplied by factor
+  */
+  void SetRotationUpdateDerivatives(const double v[3], double factor, double jacobian[3][LM_MAX_NUMBER_OF_PARAMETERS])
+  {
+    const double f = 2.0 * factor;
+    jacobian[0][0] = 0.0;
+    jacobian[1][0] = -f * v[2];
+    jacobian[2][0] = f * v[1];
+    jacobian[0][1] = f * v[2];
+    jacobian[1][1] = 0.0;
+    jacobian[2][1] = -f * v[0];
+    jacobian[0][2] = -f * v[1];
+    jacobian[1][2] = f * v[0];
+    jacobian[2][2] = 0.0;
+  }
+
+  //-----------------------------------------------------------------------------
+  /*! Compute the 3D error vector (transformed segmented point - computed point in probe frame) and optionally its derivatives */
+  void ComputeMiddleWireError(const ImageToProbeTransformEstimate& estimate, const MiddleWireObservation& observation,
+                              double residual[3], double jacobian[3][LM_MAX_NUMBER_OF_PARAMETERS])
+  {
+    double rotatedPoint[3] = {0, 0, 0};
+    for (int i = 0; i < 3; ++i)
+    {
+      for (int j = 0; j < 3; ++j)
+      {
+        rotatedPoint[i] += estimate.Rotation[i][j] * estimate.Scale[j] * observation.Point_Image[j];
+      }
+      residual[i] = rotatedPoint[i] + estimate.Translation[i] - observation.Point_Probe[i];
+    }
+    if (jacobian == NULL)
+    {
+      return;
+    }
+
+    SetRotationUpdateDerivatives(rotatedPoint, 1.0, jacobian);
+    for (int i = 0; i < 3; ++i)
+    {
+      for (int j = 0; j < 3; ++j)
+      {
+        jacobian[i][3 + j] = (i == j ? 1.0 : 0.0);
+      }
+      for (int k = 0; k < estimate.NumberOfParameters - 6; ++k)
+      {
+        double derivative = 0.0;
+        for (int j = 0; j < 3; ++j)
+        {
+          derivative += estimate.Rotation[i][j] * estimate.ScaleDerivatives[k][j] * observation.Point_Image[j];
+        }
+        jacobian[i][6 + k] = derivative;
+      }
+    }
+  }
+
+  //-----------------------------------------------------------------------------
+  /*!
+    Compute the 2D error vector (segmented point - intersection of the wire with the image plane) and optionally its derivatives.
+    Returns false if the wire is parallel to the image plane.
+  */
+  bool ComputeWireError(const ImageToProbeTransformEstimate& estimate, const WireObservation& observation,
+                        double residual[2], double jacobian[2][LM_MAX_NUMBER_OF_PARAMETERS])
+  {
+    // Wire end points in the image frame: a = diag(1/Scale) * Rotation^T * (wireFrontPoint_Probe - Translation)
+    double frontOffset[3] = {0, 0, 0};
+    double backOffset[3] = {0, 0, 0};
+    double a[3] = {0, 0, 0};
+    double b[3] = {0, 0, 0};
+    for (int i = 0; i < 3; ++i)
+    {
+      frontOffset[i] = observation.WireFrontPoint_Probe[i] - estimate.Translation[i];
+      backOffset[i] = observation.WireBackPoint_Probe[i] - estimate.Translation[i];
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+      for (int j = 0; j < 3; ++j)
+      {
+        a[i] += estimate.Rotation[j][i] * frontOffset[j];
+        b[i] += estimate.Rotation[j][i] * backOffset[j];
+      }
+      a[i] /= estimate.Scale[i];
+      b[i] /= estimate.Scale[i];
+    }
+
+    // Intersection with the image plane (z=0): x = (a_z * b - b_z * a) / (a_z - b_z)
+    double denominator = a[2] - b[2];
+    if (fabs(denominator) < 1e-12)
+    {
+      return false;
+    }
+    double intersection[2] = {0, 0};
+    for (int i = 0; i < 2; ++i)
+    {
+      intersection[i] = (a[2] * b[i] - b[2] * a[i]) / denominator;
+      residual[i] = observation.Point_Image[i] - intersection[i];
+    }
+    if (jacobian == NULL)
+    {
+      return true;
+    }
+
+    // Derivatives of the wire end points in the image frame
+    double aDerivatives[3][LM_MAX_NUMBER_OF_PARAMETERS];
+    double bDerivatives[3][LM_MAX_NUMBER_OF_PARAMETERS];
+    // Rotation: d(Rotation^T)/dv_k * offset = -2 * Rotation^T * (e_k x offset)
+    double frontRotationDerivatives[3][LM_MAX_NUMBER_OF_PARAMETERS];
+    double backRotationDerivatives[3][LM_MAX_NUMBER_OF_PARAMETERS];
+    SetRotationUpdateDerivatives(frontOffset, -1.0, frontRotationDerivatives);
+    SetRotationUpdateDerivatives(backOffset, -1.0, backRotationDerivatives);
+    for (int i = 0; i < 3; ++i)
+    {
+      for (int k = 0; k < 3; ++k)
+      {
+        double aDerivative = 0.0;
+        double bDerivative = 0.0;
+        for (int j = 0; j < 3; ++j)
+        {
+          aDerivative += estimate.Rotation[j][i] * frontRotationDerivatives[j][k];
+          bDerivative += estimate.Rotation[j][i] * backRotationDerivatives[j][k];
+        }
+        aDerivatives[i][k] = aDerivative / estimate.Scale[i];
+        bDerivatives[i][k] = bDerivative / estimate.Scale[i];
+      }
+      // Translation
+      for (int j = 0; j < 3; ++j)
+      {
+        aDerivatives[i][3 + j] = -estimate.Rotation[j][i] / estimate.Scale[i];
+        bDerivatives[i][3 + j] = aDerivatives[i][3 + j];
+      }
+      // Scale
+      for (int k = 0; k < estimate.NumberOfParameters - 6; ++k)
+      {
+        aDerivatives[i][6 + k] = -a[i] / estimate.Scale[i] * estimate.ScaleDerivatives[k][i];
+        bDerivatives[i][6 + k] = -b[i] / estimate.Scale[i] * estimate.ScaleDerivatives[k][i];
+      }
+    }
+
+    for (int p = 0; p < estimate.NumberOfParameters; ++p)
+    {
+      double denominatorDerivative = aDerivatives[2][p] - bDerivatives[2][p];
+      for (int i = 0; i < 2; ++i)
+      {
+        double numeratorDerivative = aDerivatives[2][p] * b[i] + a[2] * bDerivatives[i][p] - bDerivatives[2][p] * a[i] - b[2] * aDerivatives[i][p];
+        double intersectionDerivative = (numeratorDerivative - intersection[i] * denominatorDerivative) / denominator;
+        jacobian[i][p] = -intersectionDerivative;
+      }
+    }
+    return true;
+  }
+
+  //-----------------------------------------------------------------------------
+  /*! Apply a parameter update to the estimate. Returns false if the updated transform is invalid. */
+  bool UpdateImageToProbeTransformEstimate(const ImageToProbeTransformEstimate& estimate, const double* parameterUpdate, ImageToProbeTransformEstimate& updatedEstimate)
+  {
+    updatedEstimate = estimate;
+    double rotationUpdate[3][3];
+    if (!GetVersorRotationMatrix(parameterUpdate, rotationUpdate))
+    {
+      return false;
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+      for (int j = 0; j < 3; ++j)
+      {
+        updatedEstimate.Rotation[i][j] = 0.0;
+        for (int k = 0; k < 3; ++k)
+        {
+          updatedEstimate.Rotation[i][j] += rotationUpdate[i][k] * estimate.Rotation[k][j];
+        }
+      }
+      updatedEstimate.Translation[i] += parameterUpdate[3 + i];
+    }
+    for (int k = 0; k < estimate.NumberOfParameters - 6; ++k)
+    {
+      for (int i = 0; i < 3; ++i)
+      {
+        updatedEstimate.Scale[i] += parameterUpdate[6 + k] * estimate.ScaleDerivatives[k][i];
+      }
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+      if (updatedEstimate.Scale[i] <= 0)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //-----------------------------------------------------------------------------
+  struct ComputeErrorsThreadFunctionInfoStruct
+  {
+    const ImageToProbeTransformEstimate* Estimate;
+    const std::vector<MiddleWireObservation>* MiddleWireObservations;
+    const std::vector<WireObservation>* WireObservations;
+    bool ComputeDerivatives;
+    std::vector<ErrorAccumulator> ThreadErrors;
+  };
+
+  //-----------------------------------------------------------------------------
+  /*! Thread function that computes the errors (and optionally their derivatives) for a contiguous block of the observations */
+  VTK_THREAD_RETURN_TYPE ComputeErrorsThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    ComputeErrorsThreadFunctionInfoStruct* str = static_cast<ComputeErrorsThreadFunctionInfoStruct*>(threadInfo->UserData);
+    size_t threadId = threadInfo->ThreadID;
+    size_t threadCount = threadInfo->NumberOfThreads;
+    const ImageToProbeTransformEstimate& estimate = *str->Estimate;
+
+    ErrorAccumulator& errors = str->ThreadErrors[threadId];
+    errors.Clear(estimate.NumberOfParameters);
+    double residual[3] = {0, 0, 0};
+    double jacobian[3][LM_MAX_NUMBER_OF_PARAMETERS];
+
+    const std::vector<MiddleWireObservation>& middleWireObservations = *str->MiddleWireObservations;
+    size_t numberOfObservations = middleWireObservations.size();
+    for (size_t i = numberOfObservations * threadId / threadCount; i < numberOfObservations * (threadId + 1) / threadCount; ++i)
+    {
+      ComputeMiddleWireError(estimate, middleWireObservations[i], residual, str->ComputeDerivatives ? jacobian : NULL);
+      for (int row = 0; row < 3; ++row)
+      {
+        errors.Add(residual[row], str->ComputeDerivatives ? jacobian[row] : NULL);
+      }
+    }
+
+    const std::vector<WireObservation>& wireObservations = *str->WireObservations;
+    numberOfObservations = wireObservations.size();
+    for (size_t i = numberOfObservations * threadId / threadCount; i < numberOfObservations * (threadId + 1) / threadCount; ++i)
+    {
+      if (!ComputeWireError(estimate, wireObservations[i], residual, str->ComputeDerivatives ? jacobian : NULL))
+      {
+        // Image plane and wire are parallel
+        continue;
+      }
+      for (int row = 0; row < 2; ++row)
+      {
+        errors.Add(residual[row], str->ComputeDerivatives ? jacobian[row] : NULL);
+      }
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  //-----------------------------------------------------------------------------
+  /*! Compute the errors of an estimate on all threads and sum the results */
+  void ComputeErrors(vtkMultiThreader* threader, ComputeErrorsThreadFunctionInfoStruct& str, const ImageToProbeTransformEstimate& estimate, bool computeDerivatives, ErrorAccumulator& errors)
+  {
+    str.Estimate = &estimate;
+    str.ComputeDerivatives = computeDerivatives;
+    threader->SetSingleMethod(ComputeErrorsThreadFunction, &str);
+    threader->SingleMethodExecute();
+
+    errors.Clear(estimate.NumberOfParameters);
+    for (std::vector<ErrorAccumulator>::const_iterator threadErrorsIt = str.ThreadErrors.begin(); threadErrorsIt != str.ThreadErrors.end(); ++threadErrorsIt)
+    {
+      errors.Add(*threadErrorsIt);
+    }
+  }
+}
+
 //-----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkPlusProbeCalibrationOptimizerAlgo);
 
 //-----------------------------------------------------------------------------
 vtkPlusProbeCalibrationOptimizerAlgo::vtkPlusProbeCalibrationOptimizerAlgo()
 : IsotropicPixelSpacing(true)
+, OptimizationMethod(MINIMIZE_NONE)
+, OptimizerAlgorithm(OPTIMIZER_POWELL)
+, NumberOfThreads(0)
 , ProbeCalibrationAlgo(NULL)
 {  
 }
@@ -253,6 +645,59 @@ PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::Update()
     PlusMath::LogVtkMatrix(vtkMatrix);
   }
 
+  DistanceToWiresCostFunction::ParametersType imageToProbeTransformParameters(imageToProbeSeedTransformParameters);
+  double optimizationStartTimeSec = vtkPlusAccurateTimer::GetSystemTime();
+  PlusStatus optimizationStatus = PLUS_FAIL;
+  switch (this->OptimizerAlgorithm)
+  {
+  case OPTIMIZER_POWELL:
+    optimizationStatus = OptimizeUsingPowell(imageToProbeTransformParameters);
+    break;
+  case OPTIMIZER_LEVENBERG_MARQUARDT:
+    optimizationStatus = OptimizeUsingLevenbergMarquardt(imageToProbeTransformParameters);
+    break;
+  default:
+    LOG_ERROR("Unknown optimizer algorithm: " << this->OptimizerAlgorithm);
+  }
+  if (optimizationStatus != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  LOG_INFO("Optimization time using " << GetOptimizerAlgorithmAsString(this->OptimizerAlgorithm) << " optimizer: " << vtkPlusAccurateTimer::GetSystemTime() - optimizationStartTimeSec << " sec");
+
+  // Store the matrix
+
+  costFunction->GetTransformMatrix(this->ImageToProbeTransformMatrix, imageToProbeTransformParameters);
+  {
+    vtkSmartPointer<vtkMatrix4x4> vtkMatrix=vtkSmartPointer<vtkMatrix4x4>::New();
+    PlusMath::ConvertVnlMatrixToVtkMatrix(this->ImageToProbeTransformMatrix, vtkMatrix); 
+    PlusMath::LogVtkMatrix(vtkMatrix);
+  }
+
+  // Store the optimized parameters and show the results
+  LOG_INFO("Cost function = " << GetOptimizationMethodAsString(this->OptimizationMethod));
+
+  LOG_INFO("Without optimization:");
+  ShowTransformation(this->ImageToProbeSeedTransformMatrix);
+
+  LOG_INFO("With optimization:");
+  ShowTransformation(this->ImageToProbeTransformMatrix);
+
+  vtkSmartPointer<vtkMatrix4x4> imageToProbeSeedTransformMatrixVtk = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkSmartPointer<vtkMatrix4x4> imageToProbeTransformMatrixVtk = vtkSmartPointer<vtkMatrix4x4>::New();
+  PlusMath::ConvertVnlMatrixToVtkMatrix(this->ImageToProbeSeedTransformMatrix,imageToProbeSeedTransformMatrixVtk);
+  PlusMath::ConvertVnlMatrixToVtkMatrix(this->ImageToProbeTransformMatrix,imageToProbeTransformMatrixVtk);
+  double angleDifference = PlusMath::GetOrientationDifference(imageToProbeSeedTransformMatrixVtk, imageToProbeTransformMatrixVtk);
+  LOG_INFO("Orientation difference between unoptimized and optimized matrices =  " << angleDifference << " deg");
+
+  return PLUS_SUCCESS; 
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::OptimizeUsingPowell(vnl_vector<double>& imageToProbeTransformParameters)
+{
+  DistanceToWiresCostFunction::Pointer costFunction = new DistanceToWiresCostFunction(this);
+
   OptimizerType::Pointer  optimizer = OptimizerType::New();
   try 
   {
@@ -303,7 +748,12 @@ PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::Update()
   }
   optimizer->SetScales(scales);
 
-  optimizer->SetInitialPosition(imageToProbeSeedTransformParameters);
+  DistanceToWiresCostFunction::ParametersType initialPosition(imageToProbeTransformParameters.size());
+  for (unsigned int i=0; i<imageToProbeTransformParameters.size(); ++i)
+  {
+    initialPosition[i]=imageToProbeTransformParameters[i];
+  }
+  optimizer->SetInitialPosition(initialPosition);
 
   try 
   {
@@ -318,32 +768,260 @@ PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::Update()
   std::string stopCondition=optimizer->GetStopConditionDescription();
   LOG_INFO("Optimization stopping condition: "<<stopCondition<<". Number of iterations: " << optimizer->GetCurrentIteration());
 
-  // Store the matrix
+  const DistanceToWiresCostFunction::ParametersType& optimizedPosition=optimizer->GetCurrentPosition();
+  for (unsigned int i=0; i<imageToProbeTransformParameters.size(); ++i)
+  {
+    imageToProbeTransformParameters[i]=optimizedPosition[i];
+  }
+
+  return PLUS_SUCCESS;
+}
 
-  costFunction->GetTransformMatrix(this->ImageToProbeTransformMatrix, optimizer->GetCurrentPosition());
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::OptimizeUsingLevenbergMarquardt(vnl_vector<double>& imageToProbeTransformParameters)
+{
+  const int numberOfParameters = imageToProbeTransformParameters.size();
+  if (numberOfParameters != 7 && numberOfParameters != 8)
   {
-    vtkSmartPointer<vtkMatrix4x4> vtkMatrix=vtkSmartPointer<vtkMatrix4x4>::New();
-    PlusMath::ConvertVnlMatrixToVtkMatrix(this->ImageToProbeTransformMatrix, vtkMatrix); 
-    PlusMath::LogVtkMatrix(vtkMatrix);
+    LOG_ERROR("Number of transformation parameters is incorrect");
+    return PLUS_FAIL;
+  }
+  if (this->ProbeCalibrationAlgo == NULL)
+  {
+    LOG_ERROR("Unable to optimize calibration: probe calibration algorithm is not set");
+    return PLUS_FAIL;
   }
 
-  // Store the optimized parameters and show the results
-  LOG_INFO("Cost function = " << GetOptimizationMethodAsString(this->OptimizationMethod));
+  // Collect the observations. Wire end points are transformed to the probe frame here, as they do not depend on the optimized parameters.
+  std::vector< vnl_vector_fixed<double, 4> > allWiresIntersectionPointsPos_Image;
+  std::vector< vnl_vector_fixed<double, 4> > middleWireIntersectionPointsPos_Probe;
+  std::vector< vnl_matrix_fixed<double, 4, 4> > probeToPhantomTransforms;
+  this->ProbeCalibrationAlgo->GetOptimizationWirePositions(allWiresIntersectionPointsPos_Image, middleWireIntersectionPointsPos_Probe, probeToPhantomTransforms);
+  const std::vector<PlusNWire>& nWires = this->ProbeCalibrationAlgo->GetNWires();
+  const unsigned int numberOfNWires = nWires.size();
 
-  LOG_INFO("Without optimization:");
-  ShowTransformation(this->ImageToProbeSeedTransformMatrix);
+  std::vector<MiddleWireObservation> middleWireObservations;
+  std::vector<WireObservation> wireObservations;
+  switch (this->OptimizationMethod)
+  {
+  case MINIMIZE_DISTANCE_OF_MIDDLE_WIRES_IN_3D:
+    middleWireObservations.resize(middleWireIntersectionPointsPos_Probe.size());
+    for (unsigned int i = 0; i < middleWireObservations.size(); ++i)
+    {
+      for (int axis = 0; axis < 3; ++axis)
+      {
+        middleWireObservations[i].Point_Image[axis] = allWiresIntersectionPointsPos_Image[i * 3 + 1][axis];
+        middleWireObservations[i].Point_Probe[axis] = middleWireIntersectionPointsPos_Probe[i][axis];
+      }
+    }
+    break;
+  case MINIMIZE_DISTANCE_OF_ALL_WIRES_IN_2D:
+    wireObservations.resize(probeToPhantomTransforms.size() * numberOfNWires * 3);
+    for (unsigned int frameIndex = 0; frameIndex < probeToPhantomTransforms.size(); ++frameIndex)
+    {
+      vnl_matrix_fixed<double, 4, 4> phantomToProbeTransform = vnl_inverse(probeToPhantomTransforms[frameIndex]);
+      for (unsigned int wireIndex = 0; wireIndex < numberOfNWires * 3; ++wireIndex)
+      {
+        const PlusFidWire& wire = nWires[wireIndex / 3].GetWires()[wireIndex % 3];
+        vnl_vector_fixed<double, 4> wireFrontPoint_Probe = phantomToProbeTransform * vnl_vector_fixed<double, 4>(wire.EndPointFront[0], wire.EndPointFront[1], wire.EndPointFront[2], 1.0);
+        vnl_vector_fixed<double, 4> wireBackPoint_Probe = phantomToProbeTransform * vnl_vector_fixed<double, 4>(wire.EndPointBack[0], wire.EndPointBack[1], wire.EndPointBack[2], 1.0);
+        WireObservation& observation = wireObservations[frameIndex * numberOfNWires * 3 + wireIndex];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+          observation.WireFrontPoint_Probe[axis] = wireFrontPoint_Probe[axis];
+          observation.WireBackPoint_Probe[axis] = wireBackPoint_Probe[axis];
+        }
+        observation.Point_Image[0] = allWiresIntersectionPointsPos_Image[frameIndex * numberOfNWires * 3 + wireIndex][0];
+        observation.Point_Image[1] = allWiresIntersectionPointsPos_Image[frameIndex * numberOfNWires * 3 + wireIndex][1];
+      }
+    }
+    break;
+  default:
+    LOG_ERROR("Invalid cost function");
+    return PLUS_FAIL;
+  }
+  const unsigned int numberOfObservations = middleWireObservations.size() + wireObservations.size();
+  if (numberOfObservations == 0)
+  {
+    LOG_ERROR("Unable to optimize calibration: no wire positions are available");
+    return PLUS_FAIL;
+  }
 
-  LOG_INFO("With optimization:");
-  ShowTransformation(this->ImageToProbeTransformMatrix);
+  // Initial estimate
+  ImageToProbeTransformEstimate estimate;
+  estimate.NumberOfParameters = numberOfParameters;
+  {
+    DistanceToWiresCostFunction::ParametersType rigidParameters(6);
+    for (int i = 0; i < 6; ++i)
+    {
+      rigidParameters[i] = imageToProbeTransformParameters[i];
+    }
+    DistanceToWiresCostFunction::RigidTransformType::Pointer rigidTransform = DistanceToWiresCostFunction::RigidTransformType::New();
+    rigidTransform->SetParameters(rigidParameters);
+    for (int i = 0; i < 3; ++i)
+    {
+      for (int j = 0; j < 3; ++j)
+      {
+        estimate.Rotation[i][j] = rigidTransform->GetMatrix()(i, j);
+      }
+      estimate.Translation[i] = imageToProbeTransformParameters[3 + i];
+    }
+  }
+  if (numberOfParameters == 7)
+  {
+    // X, Y, and Z spacing are the same
+    estimate.Scale[0] = estimate.Scale[1] = estimate.Scale[2] = imageToProbeTransformParameters[6];
+    estimate.ScaleDerivatives[0][0] = estimate.ScaleDerivatives[0][1] = estimate.ScaleDerivatives[0][2] = 1.0;
+  }
+  else
+  {
+    // X and Y spacing are different, Z spacing is their average
+    estimate.Scale[0] = imageToProbeTransformParameters[6];
+    estimate.Scale[1] = imageToProbeTransformParameters[7];
+    estimate.Scale[2] = (estimate.Scale[0] + estimate.Scale[1]) / 2.0;
+    estimate.ScaleDerivatives[0][0] = 1.0;
+    estimate.ScaleDerivatives[0][1] = 0.0;
+    estimate.ScaleDerivatives[0][2] = 0.5;
+    estimate.ScaleDerivatives[1][0] = 0.0;
+    estimate.ScaleDerivatives[1][1] = 1.0;
+    estimate.ScaleDerivatives[1][2] = 0.5;
+  }
 
-  vtkSmartPointer<vtkMatrix4x4> imageToProbeSeedTransformMatrixVtk = vtkSmartPointer<vtkMatrix4x4>::New();
-  vtkSmartPointer<vtkMatrix4x4> imageToProbeTransformMatrixVtk = vtkSmartPointer<vtkMatrix4x4>::New();
-  PlusMath::ConvertVnlMatrixToVtkMatrix(this->ImageToProbeSeedTransformMatrix,imageToProbeSeedTransformMatrixVtk);
-  PlusMath::ConvertVnlMatrixToVtkMatrix(this->ImageToProbeTransformMatrix,imageToProbeTransformMatrixVtk);
-  double angleDifference = PlusMath::GetOrientationDifference(imageToProbeSeedTransformMatrixVtk, imageToProbeTransformMatrixVtk);
-  LOG_INFO("Orientation difference between unoptimized and optimized matrices =  " << angleDifference << " deg");
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+  if (this->NumberOfThreads > 0)
+  {
+    threader->SetNumberOfThreads(this->NumberOfThreads);
+  }
+  ComputeErrorsThreadFunctionInfoStruct str;
+  str.MiddleWireObservations = &middleWireObservations;
+  str.WireObservations = &wireObservations;
+  str.ThreadErrors.resize(threader->GetNumberOfThreads());
 
-  return PLUS_SUCCESS; 
+  ErrorAccumulator errors;
+  ComputeErrors(threader, str, estimate, true, errors);
+  int numberOfErrorEvaluations = 1;
+  LOG_DEBUG("Levenberg-Marquardt initial cost function value = " << sqrt(errors.SumOfSquares / numberOfObservations));
+
+  std::string stopCondition = "Maximum number of iterations reached";
+  double damping = LM_INITIAL_DAMPING;
+  double dampingIncreaseFactor = 2.0;
+  int iteration = 0;
+  vnl_matrix<double> normalMatrix(numberOfParameters, numberOfParameters);
+  vnl_vector<double> normalVector(numberOfParameters);
+  ImageToProbeTransformEstimate updatedEstimate;
+  ErrorAccumulator updatedErrors;
+  for (iteration = 1; iteration <= LM_MAX_NUMBER_OF_ITERATIONS; ++iteration)
+  {
+    // Solve (JtJ + damping * diag(JtJ)) * step = -Jtr. Scaling the damping by the diagonal makes it independent of the parameter units.
+    for (int i = 0; i < numberOfParameters; ++i)
+    {
+      for (int j = i; j < numberOfParameters; ++j)
+      {
+        normalMatrix(i, j) = errors.JtJ[i][j];
+        normalMatrix(j, i) = errors.JtJ[i][j];
+      }
+      normalMatrix(i, i) += damping * std::max(errors.JtJ[i][i], 1e-12);
+      normalVector(i) = -errors.Jtr[i];
+    }
+    vnl_vector<double> step = vnl_svd<double>(normalMatrix).solve(normalVector);
+
+    bool errorDecreased = false;
+    if (UpdateImageToProbeTransformEstimate(estimate, step.data_block(), updatedEstimate))
+    {
+      ComputeErrors(threader, str, updatedEstimate, false, updatedErrors);
+      ++numberOfErrorEvaluations;
+      errorDecreased = (updatedErrors.SumOfSquares < errors.SumOfSquares);
+    }
+    if (!errorDecreased)
+    {
+      // Step is too long, get closer to gradient descent with a shorter step. Repeated failures increase the damping faster.
+      damping *= dampingIncreaseFactor;
+      dampingIncreaseFactor *= 2.0;
+      if (damping > LM_MAX_DAMPING)
+      {
+        stopCondition = "Error function value cannot be decreased";
+        break;
+      }
+      continue;
+    }
+
+    // Adjust the damping by how well the linearized model predicted the error decrease (Nielsen's update rule).
+    // Dividing the damping by a constant factor instead makes it oscillate when the residuals are large (e.g., the
+    // isotropic 2D cost function used with anisotropic image spacing), every other step is rejected and the iteration
+    // limit is reached before convergence.
+    double errorDecrease = errors.SumOfSquares - updatedErrors.SumOfSquares;
+    double predictedErrorDecrease = 0.0;
+    for (int i = 0; i < numberOfParameters; ++i)
+    {
+      predictedErrorDecrease += step(i) * (damping * std::max(errors.JtJ[i][i], 1e-12) * step(i) - errors.Jtr[i]);
+    }
+    double dampingDecreaseFactor = 1.0 / 3.0;
+    if (predictedErrorDecrease > 0.0)
+    {
+      double gainRatio = errorDecrease / predictedErrorDecrease;
+      dampingDecreaseFactor = std::max(dampingDecreaseFactor, 1.0 - pow(2.0 * gainRatio - 1.0, 3));
+    }
+    damping = std::max(damping * dampingDecreaseFactor, 1e-12);
+    dampingIncreaseFactor = 2.0;
+    estimate = updatedEstimate;
+    errors.SumOfSquares = updatedErrors.SumOfSquares;
+    LOG_DEBUG("Levenberg-Marquardt iteration " << iteration << ": cost function value = " << sqrt(errors.SumOfSquares / numberOfObservations));
+
+    if (errorDecrease <= LM_VALUE_TOLERANCE * errors.SumOfSquares)
+    {
+      stopCondition = "Error function value tolerance reached";
+      break;
+    }
+    if (step.magnitude() <= LM_STEP_TOLERANCE)
+    {
+      stopCondition = "Step tolerance reached";
+      break;
+    }
+
+    ComputeErrors(threader, str, estimate, true, errors);
+    ++numberOfErrorEvaluations;
+  }
+  if (iteration > LM_MAX_NUMBER_OF_ITERATIONS)
+  {
+    iteration = LM_MAX_NUMBER_OF_ITERATIONS;
+  }
+  LOG_INFO("Optimization stopping condition: " << stopCondition << ". Number of iterations: " << iteration
+    << ", number of cost function evaluations: " << numberOfErrorEvaluations << ", cost function value: " << sqrt(errors.SumOfSquares / numberOfObservations));
+
+  // Convert the estimate to versor parameters. The rotation matrix is orthogonalized to remove accumulated numerical errors.
+  vnl_matrix<double> rotationMatrix(3, 3);
+  for (int i = 0; i < 3; ++i)
+  {
+    for (int j = 0; j < 3; ++j)
+    {
+      rotationMatrix(i, j) = estimate.Rotation[i][j];
+    }
+  }
+  vnl_svd<double> svd(rotationMatrix);
+  vnl_matrix<double> orthogonalizedRotationMatrix = svd.U() * svd.V().transpose();
+  try
+  {
+    DistanceToWiresCostFunction::RigidTransformType::Pointer rigidTransform = DistanceToWiresCostFunction::RigidTransformType::New();
+    rigidTransform->SetMatrix(orthogonalizedRotationMatrix);
+    DistanceToWiresCostFunction::RigidTransformType::ParametersType rigidParameters = rigidTransform->GetParameters();
+    for (int i = 0; i < 3; ++i)
+    {
+      imageToProbeTransformParameters[i] = rigidParameters[i];
+      imageToProbeTransformParameters[3 + i] = estimate.Translation[i];
+    }
+  }
+  catch (itk::ExceptionObject& e)
+  {
+    LOG_ERROR("Failed to convert optimized rotation to versor parameters: " << e.GetDescription());
+    return PLUS_FAIL;
+  }
+  imageToProbeTransformParameters[6] = estimate.Scale[0];
+  if (numberOfParameters == 8)
+  {
+    imageToProbeTransformParameters[7] = estimate.Scale[1];
+  }
+
+  return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
@@ -383,6 +1061,19 @@ const char* vtkPlusProbeCalibrationOptimizerAlgo::GetOptimizationMethodAsString(
   }
 }
 
+//----------------------------------------------------------------------------
+const char* vtkPlusProbeCalibrationOptimizerAlgo::GetOptimizerAlgorithmAsString(OptimizerAlgorithmType type)
+{
+  switch (type)
+  {
+  case OPTIMIZER_POWELL: return "POWELL";
+  case OPTIMIZER_LEVENBERG_MARQUARDT: return "LEVENBERG_MARQUARDT";
+  default:
+    LOG_ERROR("Unknown optimizer algorithm: "<<type);
+    return "unknown";
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::ReadConfiguration( vtkXMLDataElement* aConfig )
 {
@@ -415,5 +1106,28 @@ PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::ReadConfiguration( vtkXMLDataEl
 
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(IsotropicPixelSpacing, aConfig);
 
+  const char* optimizerAlgorithm=aConfig->GetAttribute("OptimizerAlgorithm");
+  if (optimizerAlgorithm==NULL)
+  {
+    // no optimizer algorithm is defined, use the default
+    this->OptimizerAlgorithm=OPTIMIZER_POWELL;
+  }
+  else if (STRCASECMP(optimizerAlgorithm, GetOptimizerAlgorithmAsString(OPTIMIZER_POWELL)) == 0)
+  {
+    this->OptimizerAlgorithm=OPTIMIZER_POWELL;
+  }
+  else if (STRCASECMP(optimizerAlgorithm, GetOptimizerAlgorithmAsString(OPTIMIZER_LEVENBERG_MARQUARDT)) == 0)
+  {
+    this->OptimizerAlgorithm=OPTIMIZER_LEVENBERG_MARQUARDT;
+  }
+  else
+  {
+    LOG_ERROR("Unknown OptimizerAlgorithm: " << optimizerAlgorithm << ". Valid values: " << GetOptimizerAlgorithmAsString(OPTIMIZER_POWELL)
+      << ", " << GetOptimizerAlgorithmAsString(OPTIMIZER_LEVENBERG_MARQUARDT));
+    return PLUS_FAIL;
+  }
+
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfThreads, aConfig);
+
   return PLUS_SUCCESS;
 }
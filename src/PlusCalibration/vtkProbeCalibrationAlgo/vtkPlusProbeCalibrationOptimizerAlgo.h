@@ -31,6 +31,11 @@ class vtkPlusProbeCalibrationAlgo;
   it is more accurate to optimize the in-plane (2D) error. Also this optimizer enforces orthogonality of the image to
   probe matrix and optionally it can enforce isotropic image pixel spacing.
 
+  The cost function can be minimized by a Powell optimizer (that only uses cost function values) or by a
+  Levenberg-Marquardt optimizer (that uses the analytic derivatives of the individual point errors and
+  typically needs much fewer cost function evaluations). The point errors are computed on multiple threads
+  in the Levenberg-Marquardt optimizer.
+
   \ingroup PlusLibCalibrationAlgo
 */
 class vtkPlusProbeCalibrationOptimizerAlgo : public vtkObject
@@ -46,6 +51,13 @@ public:
     MINIMIZE_DISTANCE_OF_ALL_WIRES_IN_2D
   };  
 
+  /* Choose one of the possible optimizer algorithms */
+  enum OptimizerAlgorithmType
+  {
+    OPTIMIZER_POWELL,
+    OPTIMIZER_LEVENBERG_MARQUARDT
+  };
+
   vtkTypeMacro(vtkPlusProbeCalibrationOptimizerAlgo,vtkObject);
   static vtkPlusProbeCalibrationOptimizerAlgo *New();
 
@@ -75,6 +87,14 @@ public:
   void SetOptimizationMethod(OptimizationMethodType optimizationMethod) { this->OptimizationMethod=optimizationMethod; }
   static const char* GetOptimizationMethodAsString(OptimizationMethodType type);
 
+  OptimizerAlgorithmType GetOptimizerAlgorithm() { return this->OptimizerAlgorithm; }
+  void SetOptimizerAlgorithm(OptimizerAlgorithmType optimizerAlgorithm) { this->OptimizerAlgorithm=optimizerAlgorithm; }
+  static const char* GetOptimizerAlgorithmAsString(OptimizerAlgorithmType type);
+
+  /*! Set the number of threads that compute the point errors in the Levenberg-Marquardt optimizer. If 0 then the default number of threads is used. */
+  vtkSetMacro(NumberOfThreads, int);
+  vtkGetMacro(NumberOfThreads, int);
+
   void SetImageToProbeSeedTransform(const vnl_matrix_fixed<double,4,4> &imageToProbeTransformMatrix);
 
   void SetProbeCalibrationAlgo(vtkPlusProbeCalibrationAlgo* probeCalibrationAlgo);
@@ -82,6 +102,12 @@ public:
 protected:
 
   PlusStatus ShowTransformation(const vnl_matrix_fixed<double,4,4> &transformationMatrix);
+
+  /*! Minimize the cost function using a Powell optimizer. Parameters contain the seed on input and the optimized values on output. */
+  PlusStatus OptimizeUsingPowell(vnl_vector<double>& imageToProbeTransformParameters);
+
+  /*! Minimize the cost function using a Levenberg-Marquardt optimizer. Parameters contain the seed on input and the optimized values on output. */
+  PlusStatus OptimizeUsingLevenbergMarquardt(vnl_vector<double>& imageToProbeTransformParameters);
   
   vtkPlusProbeCalibrationOptimizerAlgo();
   virtual  ~vtkPlusProbeCalibrationOptimizerAlgo();
@@ -93,6 +119,12 @@ protected:
   /*! Cost function to minimize during the optimization */
   OptimizationMethodType OptimizationMethod;
 
+  /*! Algorithm that minimizes the cost function */
+  OptimizerAlgorithmType OptimizerAlgorithm;
+
+  /*! Number of threads used for computing the point errors in the Levenberg-Marquardt optimizer (0 means default) */
+  int NumberOfThreads;
+
   /*! Store the seed for the optimization process */
   vnl_matrix_fixed<double,4,4> ImageToProbeSeedTransformMatrix;
 
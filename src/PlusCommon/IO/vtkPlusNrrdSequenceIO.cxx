@@ -63,6 +63,12 @@ vtkPlusNrrdSequenceIO::~vtkPlusNrrdSequenceIO()
 {
 }
 
+//----------------------------------------------------------------------------
+std::string vtkPlusNrrdSequenceIO::GetImageStatusFieldName()
+{
+  return SEQUENCE_FIELD_IMG_STATUS;
+}
+
 //----------------------------------------------------------------------------
 std::string vtkPlusNrrdSequenceIO::EncodingToString(NrrdEncoding encoding)
 {
@@ -96,6 +96,9 @@ protected:
   /*! Read pixel data from the image */
   virtual PlusStatus ReadImagePixels();
 
+  /*! Get the name of the frame field that stores whether the image data of the frame is valid */
+  virtual std::string GetImageStatusFieldName();
+
   /*! Prepare the image file for writing */
   virtual PlusStatus PrepareImageFile();
 
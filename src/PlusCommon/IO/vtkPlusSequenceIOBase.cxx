@@ -11,6 +11,13 @@ See License.txt for details.
 #include "vtksys/SystemTools.hxx"
 #include "PlusTrackedFrame.h"
 
+#ifdef _WIN32
+  #define FSEEK _fseeki64
+#else
+  // FilePositionOffsetType is off_t, use the matching seek function so that offsets beyond 2GB work on 32-bit platforms
+  #define FSEEK fseeko
+#endif
+
 #if _WIN32
 #include <errno.h>
 
@@ -43,6 +50,9 @@ vtkPlusSequenceIOBase::vtkPlusSequenceIOBase()
   , PixelDataFileOffset( 0 )
   , PixelDataFileName( "" )
   , OutputImageFileHandle( NULL )
+  , SequentialImageReadFileHandle( NULL )
+  , SequentialImageReadInflateInitialized( false )
+  , SequentialImageReadNextFrameNumber( 0 )
 {
   this->Dimensions[0] = 1;
   this->Dimensions[1] = 1;
@@ -53,6 +63,7 @@ vtkPlusSequenceIOBase::vtkPlusSequenceIOBase()
 //----------------------------------------------------------------------------
 vtkPlusSequenceIOBase::~vtkPlusSequenceIOBase()
 {
+  this->StopSequentialImageRead();
   if( this->TrackedFrameList != NULL )
   {
     this->SetTrackedFrameList( NULL );
@@ -84,6 +95,211 @@ PlusStatus vtkPlusSequenceIOBase::Read()
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSequenceIOBase::ReadHeader()
+{
+  this->StopSequentialImageRead();
+  this->TrackedFrameList->Clear();
+
+  if ( this->ReadImageHeader() != PLUS_SUCCESS )
+  {
+    LOG_ERROR( "Could not load header from file: " << this->FileName );
+    return PLUS_FAIL;
+  }
+
+  // Frames are normally created when the pixel data is read, so make sure all frames exist
+  if ( this->Dimensions[3] > 0 )
+  {
+    this->CreateTrackedFrameIfNonExisting( this->Dimensions[3] - 1 );
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSequenceIOBase::StartSequentialImageRead( int firstFrameNumber )
+{
+  this->StopSequentialImageRead();
+
+  unsigned int frameSizeInBytes = this->GetFrameSizeInBytes();
+  if ( frameSizeInBytes == 0 )
+  {
+    LOG_ERROR( "Cannot read images from " << this->FileName << ": the file contains no image data" );
+    return PLUS_FAIL;
+  }
+  if ( firstFrameNumber < 0 || firstFrameNumber >= static_cast<int>( this->Dimensions[3] ) )
+  {
+    LOG_ERROR( "Cannot read images from " << this->FileName << ": invalid frame number " << firstFrameNumber );
+    return PLUS_FAIL;
+  }
+
+  if ( FileOpen( &this->SequentialImageReadFileHandle, this->GetPixelDataFilePath().c_str(), "rb" ) != PLUS_SUCCESS )
+  {
+    LOG_ERROR( "The file " << this->GetPixelDataFilePath() << " could not be opened for reading" );
+    this->SequentialImageReadFileHandle = NULL;
+    return PLUS_FAIL;
+  }
+
+  this->SequentialImageReadPixelBuffer.resize( frameSizeInBytes );
+  this->SequentialImageReadNextFrameNumber = firstFrameNumber;
+
+  if ( !this->UseCompression )
+  {
+    // Uncompressed frames can be accessed directly
+    FilePositionOffsetType offset = this->PixelDataFileOffset + static_cast<FilePositionOffsetType>( firstFrameNumber ) * frameSizeInBytes;
+    if ( FSEEK( this->SequentialImageReadFileHandle, offset, SEEK_SET ) != 0 )
+    {
+      LOG_ERROR( "Failed to seek to frame " << firstFrameNumber << " in " << this->GetPixelDataFilePath() );
+      this->StopSequentialImageRead();
+      return PLUS_FAIL;
+    }
+    return PLUS_SUCCESS;
+  }
+
+  if ( FSEEK( this->SequentialImageReadFileHandle, this->PixelDataFileOffset, SEEK_SET ) != 0 )
+  {
+    LOG_ERROR( "Failed to seek to the image data in " << this->GetPixelDataFilePath() );
+    this->StopSequentialImageRead();
+    return PLUS_FAIL;
+  }
+  memset( &this->SequentialImageReadInflateStream, 0, sizeof( z_stream ) );
+  // Detect zlib or gzip header automatically (MetaImage files use zlib, NRRD files use gzip)
+  if ( inflateInit2( &this->SequentialImageReadInflateStream, 15 + 32 ) != Z_OK )
+  {
+    LOG_ERROR( "Failed to initialize decompression of image data in " << this->GetPixelDataFilePath() );
+    this->StopSequentialImageRead();
+    return PLUS_FAIL;
+  }
+  this->SequentialImageReadInflateInitialized = true;
+  this->SequentialImageReadCompressedBuffer.resize( Z_BUFSIZE );
+
+  // Compressed frames can only be accessed in order, decompress (and discard) the frames before the first frame
+  for ( int frameNumber = 0; frameNumber < firstFrameNumber; ++frameNumber )
+  {
+    if ( this->ReadNextFrameRawImage( &this->SequentialImageReadPixelBuffer[0], frameSizeInBytes ) != PLUS_SUCCESS )
+    {
+      this->StopSequentialImageRead();
+      return PLUS_FAIL;
+    }
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSequenceIOBase::ReadNextFrameImage( PlusVideoFrame& frame, int& frameNumber, bool& imageValid )
+{
+  if ( this->SequentialImageReadFileHandle == NULL )
+  {
+    LOG_ERROR( "Cannot read the next frame image: sequential image reading is not started" );
+    return PLUS_FAIL;
+  }
+  if ( this->SequentialImageReadNextFrameNumber >= static_cast<int>( this->Dimensions[3] ) )
+  {
+    LOG_ERROR( "Cannot read the next frame image: all the " << this->Dimensions[3] << " frames have been read" );
+    return PLUS_FAIL;
+  }
+
+  unsigned int frameSizeInBytes = static_cast<unsigned int>( this->SequentialImageReadPixelBuffer.size() );
+  if ( this->ReadNextFrameRawImage( &this->SequentialImageReadPixelBuffer[0], frameSizeInBytes ) != PLUS_SUCCESS )
+  {
+    return PLUS_FAIL;
+  }
+  frameNumber = this->SequentialImageReadNextFrameNumber++;
+
+  imageValid = true;
+  PlusTrackedFrame* trackedFrame = this->TrackedFrameList->GetTrackedFrame( frameNumber );
+  const char* imgStatus = ( trackedFrame != NULL ) ? trackedFrame->GetCustomFrameField( this->GetImageStatusFieldName() ) : NULL;
+  if ( imgStatus != NULL && !PlusCommon::IsEqualInsensitive( imgStatus, "OK" ) )
+  {
+    imageValid = false;
+    return PLUS_SUCCESS;
+  }
+
+  PlusVideoFrame::FlipInfoType flipInfo;
+  if ( PlusVideoFrame::GetFlipAxes( this->ImageOrientationInFile, this->ImageType, this->ImageOrientationInMemory, flipInfo ) != PLUS_SUCCESS )
+  {
+    LOG_ERROR( "Failed to convert image data to the requested orientation, from " << PlusVideoFrame::GetStringFromUsImageOrientation( this->ImageOrientationInFile ) <<
+               " to " << PlusVideoFrame::GetStringFromUsImageOrientation( this->ImageOrientationInMemory ) );
+    return PLUS_FAIL;
+  }
+
+  frame.SetImageOrientation( this->ImageOrientationInMemory );
+  frame.SetImageType( this->ImageType );
+  if ( frame.AllocateFrame( this->Dimensions, this->PixelType, this->NumberOfScalarComponents ) != PLUS_SUCCESS )
+  {
+    LOG_ERROR( "Cannot allocate memory for frame " << frameNumber );
+    return PLUS_FAIL;
+  }
+
+  int clipRectOrigin[3] = {PlusCommon::NO_CLIP, PlusCommon::NO_CLIP, PlusCommon::NO_CLIP};
+  int clipRectSize[3] = {PlusCommon::NO_CLIP, PlusCommon::NO_CLIP, PlusCommon::NO_CLIP};
+  if ( PlusVideoFrame::GetOrientedClippedImage( &this->SequentialImageReadPixelBuffer[0], flipInfo, this->ImageType, this->PixelType, this->NumberOfScalarComponents, this->Dimensions, frame, clipRectOrigin, clipRectSize ) != PLUS_SUCCESS )
+  {
+    LOG_ERROR( "Failed to get oriented image from sequence file (frame number: " << frameNumber << ")!" );
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSequenceIOBase::StopSequentialImageRead()
+{
+  if ( this->SequentialImageReadInflateInitialized )
+  {
+    inflateEnd( &this->SequentialImageReadInflateStream );
+    this->SequentialImageReadInflateInitialized = false;
+  }
+  if ( this->SequentialImageReadFileHandle != NULL )
+  {
+    fclose( this->SequentialImageReadFileHandle );
+    this->SequentialImageReadFileHandle = NULL;
+  }
+  this->SequentialImageReadNextFrameNumber = 0;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSequenceIOBase::ReadNextFrameRawImage( unsigned char* buffer, unsigned int frameSizeInBytes )
+{
+  if ( !this->SequentialImageReadInflateInitialized )
+  {
+    if ( fread( buffer, 1, frameSizeInBytes, this->SequentialImageReadFileHandle ) != frameSizeInBytes )
+    {
+      LOG_ERROR( "Could not read " << frameSizeInBytes << " bytes from " << this->GetPixelDataFilePath() );
+      return PLUS_FAIL;
+    }
+    return PLUS_SUCCESS;
+  }
+
+  z_stream& stream = this->SequentialImageReadInflateStream;
+  stream.next_out = buffer;
+  stream.avail_out = frameSizeInBytes;
+  while ( stream.avail_out > 0 )
+  {
+    if ( stream.avail_in == 0 )
+    {
+      size_t bytesRead = fread( &this->SequentialImageReadCompressedBuffer[0], 1, this->SequentialImageReadCompressedBuffer.size(), this->SequentialImageReadFileHandle );
+      if ( bytesRead == 0 )
+      {
+        LOG_ERROR( "Unexpected end of compressed image data in " << this->GetPixelDataFilePath() );
+        return PLUS_FAIL;
+      }
+      stream.next_in = &this->SequentialImageReadCompressedBuffer[0];
+      stream.avail_in = static_cast<uInt>( bytesRead );
+    }
+    int result = inflate( &stream, Z_NO_FLUSH );
+    if ( result == Z_STREAM_END && stream.avail_out > 0 )
+    {
+      LOG_ERROR( "Compressed image data in " << this->GetPixelDataFilePath() << " ended before the end of the frame" );
+      return PLUS_FAIL;
+    }
+    if ( result != Z_OK && result != Z_STREAM_END )
+    {
+      LOG_ERROR( "Failed to decompress image data in " << this->GetPixelDataFilePath() << " (error code: " << result << ")" );
+      return PLUS_FAIL;
+    }
+  }
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusSequenceIOBase::DeleteCustomFrameString( int frameNumber, const char* fieldName )
 {
@@ -499,6 +715,22 @@ void vtkPlusSequenceIOBase::GetMaximumImageDimensions( unsigned int maxFrameSize
   }
 }
 
+//----------------------------------------------------------------------------
+std::string vtkPlusSequenceIOBase::GetImageStatusFieldName()
+{
+  return "ImageStatus";
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkPlusSequenceIOBase::GetFrameSizeInBytes()
+{
+  if ( this->Dimensions[0] == 0 || this->Dimensions[1] == 0 || this->Dimensions[2] == 0 )
+  {
+    return 0;
+  }
+  return this->Dimensions[0] * this->Dimensions[1] * this->Dimensions[2] * PlusVideoFrame::GetNumberOfBytesPerScalar( this->PixelType ) * this->NumberOfScalarComponents;
+}
+
 //----------------------------------------------------------------------------
 std::string vtkPlusSequenceIOBase::GetPixelDataFilePath()
 {
@@ -11,6 +11,9 @@
 #include "vtkPlusCommonExport.h"
 #include "PlusVideoFrame.h"
 #include "vtkObject.h"
+#include "vtk_zlib.h"
+
+#include <vector>
 
 class vtkPlusTrackedFrameList;
 class PlusTrackedFrame;
@@ -39,6 +42,30 @@ public:
   /*! Read file contents into the object */
   virtual PlusStatus Read();
 
+  /*!
+    Read only the header of the file: the frame fields (timestamps, transforms, etc.) of all the frames
+    are stored in the tracked frame list, but image data is not loaded.
+    Image data can be read frame by frame afterwards, using StartSequentialImageRead and ReadNextFrameImage.
+  */
+  virtual PlusStatus ReadHeader();
+
+  /*!
+    Prepare reading the image data of the frames in order, starting from the specified frame. ReadHeader must be called before.
+    Compressed image data is decompressed incrementally, so only one frame is kept in memory, but starting
+    from a later frame requires decompressing all the preceding frames.
+  */
+  virtual PlusStatus StartSequentialImageRead(int firstFrameNumber);
+
+  /*!
+    Read the image data of the next frame into the video frame. The video frame is only reallocated if its size or type changes.
+    \param frameNumber Set to the index of the frame that has been read
+    \param imageValid Set to false if the image is marked as invalid in the file, in this case the video frame is not modified
+  */
+  virtual PlusStatus ReadNextFrameImage(PlusVideoFrame& frame, int& frameNumber, bool& imageValid);
+
+  /*! Close the file that was opened for sequential image reading */
+  virtual void StopSequentialImageRead();
+
   /*! Write images to disc, compression allowed */
   virtual PlusStatus WriteImages();
 
@@ -168,6 +195,15 @@ protected:
   /*! Get full path to the file for storing the pixel data */
   std::string GetPixelDataFilePath();
 
+  /*! Get the name of the frame field that stores whether the image data of the frame is valid ("OK") */
+  virtual std::string GetImageStatusFieldName();
+
+  /*! Get the size of the image data of one frame in the file */
+  unsigned int GetFrameSizeInBytes();
+
+  /*! Read (and decompress, if needed) the image data of the next frame, as it is stored in the file */
+  PlusStatus ReadNextFrameRawImage(unsigned char* buffer, unsigned int frameSizeInBytes);
+
   /*! Get the largest possible image size in the tracked frame list */
   virtual void GetMaximumImageDimensions( unsigned int maxFrameSize[3] );
 
@@ -254,6 +290,18 @@ protected:
   /*! file handle for image output */
   FILE* OutputImageFileHandle;
 
+  /*! File handle for sequential image reading, NULL if sequential reading is not started */
+  FILE* SequentialImageReadFileHandle;
+  /*! Decompression state for sequential reading of compressed image data */
+  z_stream SequentialImageReadInflateStream;
+  bool SequentialImageReadInflateInitialized;
+  /*! Compressed data read from the file that has not been decompressed yet */
+  std::vector<unsigned char> SequentialImageReadCompressedBuffer;
+  /*! Image data of one frame, as it is stored in the file */
+  std::vector<unsigned char> SequentialImageReadPixelBuffer;
+  /*! Index of the frame that is read next */
+  int SequentialImageReadNextFrameNumber;
+
 protected:
   vtkPlusSequenceIOBase();
   virtual ~vtkPlusSequenceIOBase();
@@ -11,6 +11,16 @@ See License.txt for details.
 
 #include <iomanip>
 
+// SSE2 is available on all x64 processors, SSSE3 (byte shuffle) is used only if the compiler is allowed to generate it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define PLUS_PIXELCODEC_SSE2
+  #include <emmintrin.h>
+#endif
+#if defined(PLUS_PIXELCODEC_SSE2) && (defined(__SSSE3__) || defined(__AVX__))
+  #define PLUS_PIXELCODEC_SSSE3
+  #include <tmmintrin.h>
+#endif
+
 // Helper macros for YUY2 conversion (source: http://sundararajana.blogspot.ca/2007/12/yuy2-to-rgb24-conversion.html)
 #define FIXNUM 16
 #define FIX(a, b) ((int)((a)*(1<<(b))))
@@ -41,6 +51,11 @@ static const long VTK_BI_YUY2 = 0x32595559;
 /*!
 \class PixelCodec
 \brief A utility class that contains static functions for converting between various pixel encodings
+
+The YUY2 to RGB24/grayscale conversions use SSE2, the RGB/BGR swap and RGB24 to grayscale conversions
+use SSSE3 if the compiler is allowed to generate it. The SIMD implementations produce exactly the same
+output as the scalar ones (available as ...Scalar methods), which are used for the remaining pixels
+and on platforms without SIMD support.
 \ingroup PlusLibCommon
 */
 class PixelCodec
@@ -246,6 +261,25 @@ public:
 
   //----------------------------------------------------------------------------
   static inline void RgbBgrSwap(int width, int height, unsigned char* s, unsigned char* d)
+  {
+    int totalLen = width * height;
+    int i = 0;
+#if defined(PLUS_PIXELCODEC_SSSE3)
+    // Swap 5 pixels (15 bytes) at a time. The 16th byte is copied unchanged and then overwritten
+    // by the next iteration, therefore a full vector must be available after the current pixel.
+    const __m128i swapMask = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+    for (; i * 3 + 16 <= totalLen * 3; i += 5)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i * 3));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i * 3), _mm_shuffle_epi8(v, swapMask));
+    }
+#endif
+    RgbBgrSwapScalar(totalLen - i, 1, s + i * 3, d + i * 3);
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Scalar implementation of RgbBgrSwap */
+  static inline void RgbBgrSwapScalar(int width, int height, unsigned char* s, unsigned char* d)
   {
     int totalLen = width * height;
     for (int i = 0; i < totalLen; i++)
@@ -290,6 +324,38 @@ public:
   This is not equivalent with the perceived luminance of color images (e.g., 0.21R + 0.72G + 0.07B or 0.30R + 0.59G + 0.11B)
   */
   static inline void Rgb24ToGray(int width, int height, unsigned char* s, unsigned char* d)
+  {
+    int totalLen = width * height;
+    int i = 0;
+#if defined(PLUS_PIXELCODEC_SSSE3)
+    // Process 16 pixels (3 vectors) at a time: gather each color component into a separate vector,
+    // sum them on 16 bits, then divide by 3 (multiplying by 65536/3 is exact for sums up to 765)
+    __m128i componentMasks[3][3];
+    GetDeinterleaveMasks(componentMasks);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i oneThird = _mm_set1_epi16(21846);
+    for (; i + 16 <= totalLen; i += 16)
+    {
+      __m128i in[3];
+      LoadRgbPixels16(s + i * 3, in);
+      __m128i sumLo = zero;
+      __m128i sumHi = zero;
+      for (int component = 0; component < 3; ++component)
+      {
+        __m128i c = ShuffleRgbPixels16(in, componentMasks[component]);
+        sumLo = _mm_add_epi16(sumLo, _mm_unpacklo_epi8(c, zero));
+        sumHi = _mm_add_epi16(sumHi, _mm_unpackhi_epi8(c, zero));
+      }
+      __m128i gray = _mm_packus_epi16(_mm_mulhi_epu16(sumLo, oneThird), _mm_mulhi_epu16(sumHi, oneThird));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i), gray);
+    }
+#endif
+    Rgb24ToGrayScalar(totalLen - i, 1, s + i * 3, d + i);
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Scalar implementation of Rgb24ToGray */
+  static inline void Rgb24ToGrayScalar(int width, int height, unsigned char* s, unsigned char* d)
   {
     int totalLen = width * height;
     for (int i = 0; i < totalLen; i++)
@@ -317,6 +383,111 @@ public:
     }
   }
 
+  //----------------------------------------------------------------------------
+  /*!
+  Downsample an 8-bit image by an integer factor by averaging each factor x factor block of pixels (rounded to nearest).
+  Incomplete blocks at the right and bottom edges are dropped. Output size is (width/factor) x (height/factor).
+  \param inputRowStride Distance between the first bytes of consecutive input rows, in bytes. Allows downsampling
+    a rectangular region of a larger image without copying it first.
+  */
+  static inline void DownsampleAverage(int width, int height, int numberOfComponents, int inputRowStride, int factor, const unsigned char* s, unsigned char* d)
+  {
+    int outputWidth = width / factor;
+    int outputHeight = height / factor;
+#if defined(PLUS_PIXELCODEC_SSE2)
+    if (factor == 2 && numberOfComponents == 1)
+    {
+      // Compute 16 output pixels at a time: add horizontally adjacent bytes of both rows on 16 bits,
+      // then add the two rows and divide by 4 with rounding
+      const __m128i lowByteMask = _mm_set1_epi16(0x00FF);
+      const __m128i rounding = _mm_set1_epi16(2);
+      for (int y = 0; y < outputHeight; ++y)
+      {
+        const unsigned char* row0 = s + (2 * y) * inputRowStride;
+        const unsigned char* row1 = row0 + inputRowStride;
+        unsigned char* outputRow = d + y * outputWidth;
+        int x = 0;
+        for (; x + 16 <= outputWidth; x += 16)
+        {
+          __m128i sum[2];
+          for (int half = 0; half < 2; ++half)
+          {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2 * x + half * 16));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2 * x + half * 16));
+            __m128i sumA = _mm_add_epi16(_mm_and_si128(a, lowByteMask), _mm_srli_epi16(a, 8));
+            __m128i sumB = _mm_add_epi16(_mm_and_si128(b, lowByteMask), _mm_srli_epi16(b, 8));
+            sum[half] = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(sumA, sumB), rounding), 2);
+          }
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(outputRow + x), _mm_packus_epi16(sum[0], sum[1]));
+        }
+        for (; x < outputWidth; ++x)
+        {
+          outputRow[x] = static_cast<unsigned char>((row0[2 * x] + row0[2 * x + 1] + row1[2 * x] + row1[2 * x + 1] + 2) >> 2);
+        }
+      }
+      return;
+    }
+#endif
+    DownsampleAverageScalar(width, height, numberOfComponents, inputRowStride, factor, s, d);
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Scalar implementation of DownsampleAverage */
+  static inline void DownsampleAverageScalar(int width, int height, int numberOfComponents, int inputRowStride, int factor, const unsigned char* s, unsigned char* d)
+  {
+    int outputWidth = width / factor;
+    int outputHeight = height / factor;
+    unsigned int blockSize = factor * factor;
+    for (int y = 0; y < outputHeight; ++y)
+    {
+      const unsigned char* blockRow = s + (factor * y) * inputRowStride;
+      for (int x = 0; x < outputWidth; ++x)
+      {
+        for (int c = 0; c < numberOfComponents; ++c)
+        {
+          unsigned int sum = 0;
+          for (int j = 0; j < factor; ++j)
+          {
+            const unsigned char* p = blockRow + j * inputRowStride + (factor * x) * numberOfComponents + c;
+            for (int i = 0; i < factor; ++i)
+            {
+              sum += p[i * numberOfComponents];
+            }
+          }
+          *(d++) = static_cast<unsigned char>((sum + blockSize / 2) / blockSize);
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+  Downsample an image by an integer factor by keeping the top-left pixel of each factor x factor block.
+  Works with any pixel type. Output size is (width/factor) x (height/factor).
+  \param bytesPerPixel Size of a pixel (all components), in bytes
+  \param inputRowStride Distance between the first bytes of consecutive input rows, in bytes
+  */
+  static inline void DownsampleDecimate(int width, int height, int bytesPerPixel, int inputRowStride, int factor, const unsigned char* s, unsigned char* d)
+  {
+    int outputWidth = width / factor;
+    int outputHeight = height / factor;
+    for (int y = 0; y < outputHeight; ++y)
+    {
+      const unsigned char* inputRow = s + (factor * y) * inputRowStride;
+      if (factor == 1)
+      {
+        memcpy(d, inputRow, outputWidth * bytesPerPixel);
+        d += outputWidth * bytesPerPixel;
+        continue;
+      }
+      for (int x = 0; x < outputWidth; ++x)
+      {
+        memcpy(d, inputRow + (factor * x) * bytesPerPixel, bytesPerPixel);
+        d += bytesPerPixel;
+      }
+    }
+  }
+
   //----------------------------------------------------------------------------
   /*! Conversion from YUV to RGB space
   Uses integer math, which is faster but more complex to read
@@ -378,6 +549,54 @@ public:
   source: http://sundararajana.blogspot.ca/2007/12/yuy2-to-rgb24-conversion.html
   */
   static PlusStatus Yuv422pToBmp24(ComponentOrdering outputOrdering, int width, int height, unsigned char* s, unsigned char* d)
+  {
+    int size = height * (width / 2);
+    int i = 0;
+#if defined(PLUS_PIXELCODEC_SSE2)
+    // Process 8 macropixels (16 output pixels) at a time
+#if defined(PLUS_PIXELCODEC_SSSE3)
+    __m128i interleaveMasks[3][3];
+    GetInterleaveMasks(interleaveMasks);
+#endif
+    for (; i + 8 <= size; i += 8)
+    {
+      __m128i r, g, b;
+      Yuv422pToRgbPixels16(s + i * 4, r, g, b);
+      __m128i planes[3] = { r, g, b };
+      if (outputOrdering == ComponentOrder_BGR)
+      {
+        planes[0] = b;
+        planes[2] = r;
+      }
+#if defined(PLUS_PIXELCODEC_SSSE3)
+      for (int outputVectorIndex = 0; outputVectorIndex < 3; ++outputVectorIndex)
+      {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i * 6 + outputVectorIndex * 16), ShuffleRgbPixels16(planes, interleaveMasks[outputVectorIndex]));
+      }
+#else
+      // No byte shuffle instruction in SSE2, interleave the components from a temporary buffer
+      unsigned char planeBuffer[3][16];
+      for (int component = 0; component < 3; ++component)
+      {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(planeBuffer[component]), planes[component]);
+      }
+      unsigned char* p_dest = d + i * 6;
+      for (int pixel = 0; pixel < 16; ++pixel)
+      {
+        p_dest[0] = planeBuffer[0][pixel];
+        p_dest[1] = planeBuffer[1][pixel];
+        p_dest[2] = planeBuffer[2][pixel];
+        p_dest += 3;
+      }
+#endif
+    }
+#endif
+    return Yuv422pToBmp24Scalar(outputOrdering, (size - i) * 2, 1, s + i * 4, d + i * 6);
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Scalar implementation of Yuv422pToBmp24 */
+  static PlusStatus Yuv422pToBmp24Scalar(ComponentOrdering outputOrdering, int width, int height, unsigned char* s, unsigned char* d)
   {
     unsigned char* p_dest;
     unsigned char y1, u, y2, v;
@@ -473,6 +692,36 @@ public:
   source: http://sundararajana.blogspot.ca/2007/12/yuy2-to-rgb24-conversion.html
   */
   static void Yuv422pToGray(int width, int height, unsigned char* s, unsigned char* d)
+  {
+    int size = height * (width / 2);
+    int i = 0;
+#if defined(PLUS_PIXELCODEC_SSE2)
+    // Process 8 macropixels (16 output pixels) at a time. Components are clipped as in the scalar version
+    // and the sum is divided by 3 by multiplying with 65536/3, which is exact for sums up to 765.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i maxValue = _mm_set1_epi16(255);
+    const __m128i oneThird = _mm_set1_epi16(21846);
+    for (; i + 8 <= size; i += 8)
+    {
+      __m128i gray[2];
+      for (int half = 0; half < 2; ++half)
+      {
+        __m128i r, g, b;
+        YuyvToRgb8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i * 4 + half * 16)), r, g, b);
+        r = _mm_min_epi16(_mm_max_epi16(r, zero), maxValue);
+        g = _mm_min_epi16(_mm_max_epi16(g, zero), maxValue);
+        b = _mm_min_epi16(_mm_max_epi16(b, zero), maxValue);
+        gray[half] = _mm_mulhi_epu16(_mm_add_epi16(_mm_add_epi16(r, g), b), oneThird);
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i * 2), _mm_packus_epi16(gray[0], gray[1]));
+    }
+#endif
+    Yuv422pToGrayScalar((size - i) * 2, 1, s + i * 4, d + i * 2);
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Scalar implementation of Yuv422pToGray */
+  static void Yuv422pToGrayScalar(int width, int height, unsigned char* s, unsigned char* d)
   {
     int i;
     unsigned char* p_dest;
@@ -516,6 +765,136 @@ public:
     }
   }
 
+protected:
+#if defined(PLUS_PIXELCODEC_SSE2)
+  //----------------------------------------------------------------------------
+  /*!
+    Convert 4 YUY2 macropixels (16 bytes) to 8 RGB pixels. Output components are 16-bit signed integers, not clipped.
+    Computes the same integer math as the scalar version: the divisions of ICCIRY and ICCIRUV are replaced by
+    multiplications (exact in the range of 8-bit inputs) and the fixed point color transform is computed on 32 bits,
+    using the identity UNFIX(FIX(1.0)*Y + c*V) = Y + UNFIX((c - FIX(1.0))*V), to fit the coefficients into 16 bits.
+  */
+  static inline void YuyvToRgb8(__m128i yuyv, __m128i& r, __m128i& g, __m128i& b)
+  {
+    // y: Y0 Y1 ... Y7, uv: U0 V0 U1 V1 U2 V2 U3 V3 (16 bit each)
+    __m128i y = _mm_and_si128(yuyv, _mm_set1_epi16(0x00FF));
+    __m128i uv = _mm_srli_epi16(yuyv, 8);
+
+    // ICCIRY(y) = ((y-16)<<8)/219 and ICCIRUV(uv-128) = ((uv-128)<<8)/224, rounded towards zero
+    y = DivideTowardsZero(_mm_sub_epi16(y, _mm_set1_epi16(16)), 38305);
+    uv = DivideTowardsZero(_mm_sub_epi16(uv, _mm_set1_epi16(128)), 37450);
+
+    // Chroma contributions for each macropixel (32 bit lanes: U in the lower, V in the upper half)
+    const __m128i round = _mm_set1_epi32(1 << (FIXNUM - 1));
+    __m128i vFixed = _mm_and_si128(uv, _mm_set1_epi32(static_cast<int>(0xFFFF0000))); // V*FIX(1.0)
+    __m128i uFixed = _mm_slli_epi32(uv, 16); // U*FIX(1.0)
+    // R: FIX(1.402) = FIX(1.0) + 26345
+    __m128i rChroma = _mm_add_epi32(vFixed, _mm_madd_epi16(uv, _mm_setr_epi16(0, 26345, 0, 26345, 0, 26345, 0, 26345)));
+    // G: FIX(-0.714) = -FIX(1.0) + 18744
+    __m128i gChroma = _mm_sub_epi32(_mm_madd_epi16(uv, _mm_setr_epi16(-22544, 18744, -22544, 18744, -22544, 18744, -22544, 18744)), vFixed);
+    // B: FIX(1.772) = 2*FIX(1.0) - 14943
+    __m128i bChroma = _mm_add_epi32(_mm_add_epi32(uFixed, uFixed), _mm_madd_epi16(uv, _mm_setr_epi16(-14943, 0, -14943, 0, -14943, 0, -14943, 0)));
+    rChroma = _mm_srai_epi32(_mm_add_epi32(rChroma, round), FIXNUM);
+    gChroma = _mm_srai_epi32(_mm_add_epi32(gChroma, round), FIXNUM);
+    bChroma = _mm_srai_epi32(_mm_add_epi32(bChroma, round), FIXNUM);
+
+    // Both pixels of a macropixel use the same chroma
+    rChroma = _mm_packs_epi32(rChroma, rChroma);
+    gChroma = _mm_packs_epi32(gChroma, gChroma);
+    bChroma = _mm_packs_epi32(bChroma, bChroma);
+    r = _mm_add_epi16(y, _mm_unpacklo_epi16(rChroma, rChroma));
+    g = _mm_add_epi16(y, _mm_unpacklo_epi16(gChroma, gChroma));
+    b = _mm_add_epi16(y, _mm_unpacklo_epi16(bChroma, bChroma));
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+    Compute (x<<8)/divisor rounded towards zero for 16-bit signed x values in the range of [-128, 255].
+    reciprocal is the fixed point reciprocal of the divisor: floor((|x|<<9)*reciprocal/65536) = (|x|<<8)/divisor.
+  */
+  static inline __m128i DivideTowardsZero(__m128i x, unsigned short reciprocal)
+  {
+    __m128i sign = _mm_srai_epi16(x, 15);
+    __m128i absX = _mm_sub_epi16(_mm_xor_si128(x, sign), sign);
+    __m128i quotient = _mm_mulhi_epu16(_mm_slli_epi16(absX, 1), _mm_set1_epi16(static_cast<short>(reciprocal)));
+    return _mm_sub_epi16(_mm_xor_si128(quotient, sign), sign);
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Convert 8 YUY2 macropixels (32 bytes) to 16 RGB pixels, each component in a separate vector, clipped to 8 bits */
+  static inline void Yuv422pToRgbPixels16(const unsigned char* s, __m128i& r, __m128i& g, __m128i& b)
+  {
+    __m128i r0, g0, b0, r1, g1, b1;
+    YuyvToRgb8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s)), r0, g0, b0);
+    YuyvToRgb8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16)), r1, g1, b1);
+    // saturation to unsigned 8 bits is the same as CLIP
+    r = _mm_packus_epi16(r0, r1);
+    g = _mm_packus_epi16(g0, g1);
+    b = _mm_packus_epi16(b0, b1);
+  }
+#endif
+
+#if defined(PLUS_PIXELCODEC_SSSE3)
+  //----------------------------------------------------------------------------
+  /*!
+    Byte shuffle masks for gathering the components of 16 interleaved RGB pixels (3 vectors) into separate vectors:
+    masks[component][inputVectorIndex]. Mask value -128 (0x80) clears the byte.
+  */
+  static inline void GetDeinterleaveMasks(__m128i masks[3][3])
+  {
+    for (int component = 0; component < 3; ++component)
+    {
+      for (int inputVectorIndex = 0; inputVectorIndex < 3; ++inputVectorIndex)
+      {
+        signed char mask[16];
+        for (int pixel = 0; pixel < 16; ++pixel)
+        {
+          int inputByte = pixel * 3 + component;
+          mask[pixel] = (inputByte / 16 == inputVectorIndex) ? static_cast<signed char>(inputByte % 16) : -128;
+        }
+        masks[component][inputVectorIndex] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask));
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+    Byte shuffle masks for interleaving 16 pixels stored in separate component vectors into 3 vectors of RGB pixels:
+    masks[outputVectorIndex][component]. Mask value -128 (0x80) clears the byte.
+  */
+  static inline void GetInterleaveMasks(__m128i masks[3][3])
+  {
+    for (int outputVectorIndex = 0; outputVectorIndex < 3; ++outputVectorIndex)
+    {
+      for (int component = 0; component < 3; ++component)
+      {
+        signed char mask[16];
+        for (int i = 0; i < 16; ++i)
+        {
+          int outputByte = outputVectorIndex * 16 + i;
+          mask[i] = (outputByte % 3 == component) ? static_cast<signed char>(outputByte / 3) : -128;
+        }
+        masks[outputVectorIndex][component] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask));
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  static inline void LoadRgbPixels16(const unsigned char* s, __m128i in[3])
+  {
+    in[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+    in[1] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+    in[2] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Combine byte shuffles of 3 vectors, using the masks generated by GetDeinterleaveMasks or GetInterleaveMasks */
+  static inline __m128i ShuffleRgbPixels16(const __m128i in[3], const __m128i masks[3])
+  {
+    return _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(in[0], masks[0]), _mm_shuffle_epi8(in[1], masks[1])), _mm_shuffle_epi8(in[2], masks[2]));
+  }
+#endif
+
 private:
   PixelCodec(); // prevent instantiation
 };
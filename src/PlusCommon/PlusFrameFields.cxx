@@ -0,0 +1,387 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusFrameFields.h"
+#include "vtkPlusRecursiveCriticalSection.h"
+
+#include <algorithm>
+#include <deque>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /*!
+    Process-wide registry of field names. Names are never removed, therefore the identifiers and
+    the addresses of the stored names remain valid for the lifetime of the process.
+  */
+  class PlusFrameFieldNameRegistry
+  {
+  public:
+    static PlusFrameFieldNameRegistry& GetInstance()
+    {
+      static PlusFrameFieldNameRegistry instance;
+      return instance;
+    }
+
+    //----------------------------------------------------------------------------
+    PlusFrameFields::FieldId GetId(const std::string& fieldName)
+    {
+      PlusLockGuard<vtkPlusSimpleRecursiveCriticalSection> registryGuardedLock(&this->Mutex);
+      std::map<std::string, PlusFrameFields::FieldId>::iterator idIt = this->Ids.lower_bound(fieldName);
+      if (idIt != this->Ids.end() && idIt->first == fieldName)
+      {
+        return idIt->second;
+      }
+      PlusFrameFields::FieldId fieldId = static_cast<PlusFrameFields::FieldId>(this->Names.size());
+      this->Names.push_back(fieldName);
+      this->Ids.insert(idIt, std::make_pair(fieldName, fieldId));
+      return fieldId;
+    }
+
+    //----------------------------------------------------------------------------
+    bool FindId(const std::string& fieldName, PlusFrameFields::FieldId& fieldId)
+    {
+      PlusLockGuard<vtkPlusSimpleRecursiveCriticalSection> registryGuardedLock(&this->Mutex);
+      std::map<std::string, PlusFrameFields::FieldId>::const_iterator idIt = this->Ids.find(fieldName);
+      if (idIt == this->Ids.end())
+      {
+        return false;
+      }
+      fieldId = idIt->second;
+      return true;
+    }
+
+    //----------------------------------------------------------------------------
+    const std::string* GetName(PlusFrameFields::FieldId fieldId)
+    {
+      PlusLockGuard<vtkPlusSimpleRecursiveCriticalSection> registryGuardedLock(&this->Mutex);
+      if (fieldId >= this->Names.size())
+      {
+        return NULL;
+      }
+      // Elements of a deque are not moved when new elements are added at the end
+      return &this->Names[fieldId];
+    }
+
+  private:
+    vtkPlusSimpleRecursiveCriticalSection Mutex;
+    std::deque<std::string> Names;
+    std::map<std::string, PlusFrameFields::FieldId> Ids;
+  };
+
+  const std::string EMPTY_FIELD_NAME;
+}
+
+//----------------------------------------------------------------------------
+PlusFrameFields::PlusFrameFields()
+{
+}
+
+//----------------------------------------------------------------------------
+PlusFrameFields::PlusFrameFields(const PlusFrameFields& fields)
+  : Fields(fields.Fields)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusFrameFields& PlusFrameFields::operator=(const PlusFrameFields& fields)
+{
+  this->Fields = fields.Fields;
+  return *this;
+}
+
+//----------------------------------------------------------------------------
+PlusFrameFields::~PlusFrameFields()
+{
+}
+
+//----------------------------------------------------------------------------
+PlusFrameFields::FieldId PlusFrameFields::GetFieldId(const std::string& fieldName)
+{
+  return PlusFrameFieldNameRegistry::GetInstance().GetId(fieldName);
+}
+
+//----------------------------------------------------------------------------
+bool PlusFrameFields::FindFieldId(const std::string& fieldName, FieldId& fieldId)
+{
+  return PlusFrameFieldNameRegistry::GetInstance().FindId(fieldName, fieldId);
+}
+
+//----------------------------------------------------------------------------
+const std::string& PlusFrameFields::GetFieldName(FieldId fieldId)
+{
+  const std::string* fieldName = PlusFrameFieldNameRegistry::GetInstance().GetName(fieldId);
+  if (fieldName == NULL)
+  {
+    LOG_ERROR("Unable to get frame field name: field identifier " << fieldId << " is not registered");
+    return EMPTY_FIELD_NAME;
+  }
+  return *fieldName;
+}
+
+//----------------------------------------------------------------------------
+unsigned int PlusFrameFields::GetNumberOfFields() const
+{
+  return (this->Fields ? static_cast<unsigned int>(this->Fields->size()) : 0);
+}
+
+//----------------------------------------------------------------------------
+bool PlusFrameFields::IsEmpty() const
+{
+  return (this->GetNumberOfFields() == 0);
+}
+
+//----------------------------------------------------------------------------
+PlusFrameFields::FieldId PlusFrameFields::GetFieldIdAt(unsigned int index) const
+{
+  return (*this->Fields)[index].Id;
+}
+
+//----------------------------------------------------------------------------
+const std::string& PlusFrameFields::GetFieldNameAt(unsigned int index) const
+{
+  return *(*this->Fields)[index].Name;
+}
+
+//----------------------------------------------------------------------------
+const std::string& PlusFrameFields::GetFieldValueAt(unsigned int index) const
+{
+  return (*this->Fields)[index].Value;
+}
+
+//----------------------------------------------------------------------------
+int PlusFrameFields::FindField(FieldId fieldId) const
+{
+  if (!this->Fields)
+  {
+    return -1;
+  }
+  // Linear search is faster than a binary search by name for the typical number of fields
+  const FieldVector& fields = *this->Fields;
+  for (unsigned int i = 0; i < fields.size(); ++i)
+  {
+    if (fields[i].Id == fieldId)
+    {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+const std::string* PlusFrameFields::GetFieldValue(FieldId fieldId) const
+{
+  int fieldIndex = this->FindField(fieldId);
+  if (fieldIndex < 0)
+  {
+    return NULL;
+  }
+  return &(*this->Fields)[fieldIndex].Value;
+}
+
+//----------------------------------------------------------------------------
+const std::string* PlusFrameFields::GetFieldValue(const std::string& fieldName) const
+{
+  FieldId fieldId(0);
+  if (!FindFieldId(fieldName, fieldId))
+  {
+    // The name is not registered, so no container can have this field
+    return NULL;
+  }
+  return this->GetFieldValue(fieldId);
+}
+
+//----------------------------------------------------------------------------
+PlusFrameFields::FieldVector& PlusFrameFields::GetWritableFields()
+{
+  if (!this->Fields)
+  {
+    this->Fields = std::make_shared<FieldVector>();
+  }
+  else if (this->Fields.use_count() > 1)
+  {
+    // Fields are shared with other containers, make our own copy before modifying them
+    this->Fields = std::make_shared<FieldVector>(*this->Fields);
+  }
+  return *this->Fields;
+}
+
+//----------------------------------------------------------------------------
+std::string& PlusFrameFields::GetWritableFieldValue(FieldId fieldId)
+{
+  int fieldIndex = this->FindField(fieldId);
+  FieldVector& fields = this->GetWritableFields();
+  if (fieldIndex >= 0)
+  {
+    return fields[fieldIndex].Value;
+  }
+
+  // New field, insert it at the position that keeps the fields ordered by name
+  Field newField;
+  newField.Id = fieldId;
+  newField.Name = &GetFieldName(fieldId);
+  FieldVector::iterator insertPosition = fields.begin();
+  while (insertPosition != fields.end() && *insertPosition->Name < *newField.Name)
+  {
+    ++insertPosition;
+  }
+  return fields.insert(insertPosition, newField)->Value;
+}
+
+//----------------------------------------------------------------------------
+void PlusFrameFields::SetFieldValue(FieldId fieldId, const std::string& value)
+{
+  this->GetWritableFieldValue(fieldId) = value;
+}
+
+//----------------------------------------------------------------------------
+void PlusFrameFields::SetFieldValue(FieldId fieldId, const char* value, size_t length)
+{
+  this->GetWritableFieldValue(fieldId).assign(value, length);
+}
+
+//----------------------------------------------------------------------------
+void PlusFrameFields::SetFieldValue(const std::string& fieldName, const std::string& value)
+{
+  this->GetWritableFieldValue(GetFieldId(fieldName)) = value;
+}
+
+//----------------------------------------------------------------------------
+void PlusFrameFields::SetFieldValues(const PlusFrameFields& fields)
+{
+  if (this->Fields == fields.Fields || fields.IsEmpty())
+  {
+    return;
+  }
+  if (this->IsEmpty())
+  {
+    // Nothing to keep, just share the fields
+    this->Fields = fields.Fields;
+    return;
+  }
+  const FieldVector& sourceFields = *fields.Fields;
+  for (FieldVector::const_iterator fieldIt = sourceFields.begin(); fieldIt != sourceFields.end(); ++fieldIt)
+  {
+    this->GetWritableFieldValue(fieldIt->Id) = fieldIt->Value;
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusFrameFields::SetFieldValues(const FieldMapType& fields)
+{
+  for (FieldMapType::const_iterator fieldIt = fields.begin(); fieldIt != fields.end(); ++fieldIt)
+  {
+    this->SetFieldValue(fieldIt->first, fieldIt->second);
+  }
+}
+
+//----------------------------------------------------------------------------
+bool PlusFrameFields::RemoveField(const std::string& fieldName)
+{
+  FieldId fieldId(0);
+  if (!FindFieldId(fieldName, fieldId))
+  {
+    return false;
+  }
+  int fieldIndex = this->FindField(fieldId);
+  if (fieldIndex < 0)
+  {
+    return false;
+  }
+  FieldVector& fields = this->GetWritableFields();
+  fields.erase(fields.begin() + fieldIndex);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void PlusFrameFields::Clear()
+{
+  if (this->Fields && this->Fields.use_count() == 1)
+  {
+    // Keep the allocated vector for reuse
+    this->Fields->clear();
+  }
+  else
+  {
+    this->Fields.reset();
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusFrameFields::RemoveFieldsExcept(const std::vector<FieldId>& sortedFieldIds)
+{
+  if (this->IsEmpty())
+  {
+    return;
+  }
+
+  // Check first if any field has to be removed, so that shared fields are not copied unnecessarily
+  FieldVector::const_iterator firstRemovedIt = this->Fields->begin();
+  while (firstRemovedIt != this->Fields->end() && std::binary_search(sortedFieldIds.begin(), sortedFieldIds.end(), firstRemovedIt->Id))
+  {
+    ++firstRemovedIt;
+  }
+  if (firstRemovedIt == this->Fields->end())
+  {
+    return;
+  }
+
+  int firstRemovedIndex = firstRemovedIt - this->Fields->begin();
+  FieldVector& fields = this->GetWritableFields();
+  // Move the kept fields forward (the values are swapped, so no string is reallocated), then remove the rest
+  FieldVector::iterator keptEndIt = fields.begin() + firstRemovedIndex;
+  for (FieldVector::iterator fieldIt = keptEndIt + 1; fieldIt != fields.end(); ++fieldIt)
+  {
+    if (std::binary_search(sortedFieldIds.begin(), sortedFieldIds.end(), fieldIt->Id))
+    {
+      keptEndIt->Id = fieldIt->Id;
+      keptEndIt->Name = fieldIt->Name;
+      keptEndIt->Value.swap(fieldIt->Value);
+      ++keptEndIt;
+    }
+  }
+  fields.erase(keptEndIt, fields.end());
+}
+
+//----------------------------------------------------------------------------
+void PlusFrameFields::GetFieldMap(FieldMapType& fieldMap) const
+{
+  fieldMap.clear();
+  if (!this->Fields)
+  {
+    return;
+  }
+  for (FieldVector::const_iterator fieldIt = this->Fields->begin(); fieldIt != this->Fields->end(); ++fieldIt)
+  {
+    // Fields are ordered by name, so the end of the map is always the right insert position
+    fieldMap.insert(fieldMap.end(), std::make_pair(*fieldIt->Name, fieldIt->Value));
+  }
+}
+
+//----------------------------------------------------------------------------
+bool PlusFrameFields::operator==(const PlusFrameFields& fields) const
+{
+  if (this->Fields == fields.Fields)
+  {
+    return true;
+  }
+  if (this->GetNumberOfFields() != fields.GetNumberOfFields())
+  {
+    return false;
+  }
+  // Both containers are ordered by name, so equal containers have the fields in the same order
+  for (unsigned int i = 0; i < this->GetNumberOfFields(); ++i)
+  {
+    const Field& field = (*this->Fields)[i];
+    const Field& otherField = (*fields.Fields)[i];
+    if (field.Id != otherField.Id || field.Value != otherField.Value)
+    {
+      return false;
+    }
+  }
+  return true;
+}
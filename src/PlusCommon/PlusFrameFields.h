@@ -0,0 +1,128 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusFrameFields_h
+#define __PlusFrameFields_h
+
+#include "vtkPlusCommonExport.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*!
+  \class PlusFrameFields
+  \brief Compact storage of the custom fields (name/value string pairs) of a frame
+
+  Field names are registered once in a process-wide registry and are referred to by a small integer
+  identifier afterwards, so a container only stores an identifier and a value for each field. Fields
+  are kept in a vector, ordered by name (the same order as in a std::map of the names), which is
+  faster to search and copy than a map for the typical number of fields in a frame.
+
+  Copying a container does not copy the fields: the copies share the field vector until one of them
+  is modified (copy-on-write). This makes copying between buffer items and tracked frames cheap.
+  Modifying a field of a container that does not share its fields reuses the existing value storage.
+
+  A container may be read from multiple threads, but it must not be modified while another thread
+  accesses the same container (the same rule as for standard containers). Containers that share
+  fields can be used from different threads independently.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusFrameFields
+{
+public:
+  typedef unsigned int FieldId;
+  typedef std::map<std::string, std::string> FieldMapType;
+
+  PlusFrameFields();
+  PlusFrameFields(const PlusFrameFields& fields);
+  PlusFrameFields& operator=(const PlusFrameFields& fields);
+  ~PlusFrameFields();
+
+  /*! Get the identifier of a field name. The name is registered if it has not been registered yet. */
+  static FieldId GetFieldId(const std::string& fieldName);
+
+  /*! Get the identifier of a field name without registering it. Returns false if the name has not been registered. */
+  static bool FindFieldId(const std::string& fieldName, FieldId& fieldId);
+
+  /*! Get the name of a registered field */
+  static const std::string& GetFieldName(FieldId fieldId);
+
+  /*! Get the number of fields */
+  unsigned int GetNumberOfFields() const;
+
+  /*! Returns true if there are no fields */
+  bool IsEmpty() const;
+
+  /*! Get the identifier of the field at the specified position (fields are ordered by name) */
+  FieldId GetFieldIdAt(unsigned int index) const;
+
+  /*! Get the name of the field at the specified position (fields are ordered by name) */
+  const std::string& GetFieldNameAt(unsigned int index) const;
+
+  /*! Get the value of the field at the specified position (fields are ordered by name) */
+  const std::string& GetFieldValueAt(unsigned int index) const;
+
+  /*! Get a field value. Returns NULL if the field is not defined. */
+  const std::string* GetFieldValue(FieldId fieldId) const;
+  const std::string* GetFieldValue(const std::string& fieldName) const;
+
+  /*! Set a field value. The field is added if it is not defined yet. */
+  void SetFieldValue(FieldId fieldId, const std::string& value);
+  void SetFieldValue(FieldId fieldId, const char* value, size_t length);
+  void SetFieldValue(const std::string& fieldName, const std::string& value);
+
+  /*! Set the value of all the fields of the input container (fields that are not in the input container are kept) */
+  void SetFieldValues(const PlusFrameFields& fields);
+
+  /*! Set the value of all the fields of the input map (fields that are not in the input map are kept) */
+  void SetFieldValues(const FieldMapType& fields);
+
+  /*! Remove a field. Returns false if the field was not defined. */
+  bool RemoveField(const std::string& fieldName);
+
+  /*! Remove all fields */
+  void Clear();
+
+  /*!
+    Remove all fields whose identifier is not in the list (the list must be sorted).
+    The storage of the kept fields is reused and nothing is copied if no field has to be removed.
+  */
+  void RemoveFieldsExcept(const std::vector<FieldId>& sortedFieldIds);
+
+  /*! Get all fields in a map */
+  void GetFieldMap(FieldMapType& fieldMap) const;
+
+  /*! Returns true if the two containers have the same fields with the same values */
+  bool operator==(const PlusFrameFields& fields) const;
+  bool operator!=(const PlusFrameFields& fields) const { return !(*this == fields); }
+
+protected:
+  struct Field
+  {
+    FieldId Id;
+    /*! Points to the name in the registry, so that the name is available without locking the registry */
+    const std::string* Name;
+    std::string Value;
+  };
+  typedef std::vector<Field> FieldVector;
+
+  /*! Get the position of a field, returns -1 if the field is not defined */
+  int FindField(FieldId fieldId) const;
+
+  /*! Get a field vector that is not shared with other containers (the fields are copied if they are shared) */
+  FieldVector& GetWritableFields();
+
+  /*! Get the value of a field for writing, the field is added if it is not defined yet */
+  std::string& GetWritableFieldValue(FieldId fieldId);
+
+  /*! Shared field vector, NULL if there are no fields */
+  std::shared_ptr<FieldVector> Fields;
+};
+
+#endif
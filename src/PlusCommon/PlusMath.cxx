@@ -9,13 +9,15 @@
 #include "PlusMath.h"
 
 #include "vnl/vnl_sparse_matrix.h"
-#include "vnl/vnl_sparse_matrix_linear_system.h"  
-#include "vnl/algo/vnl_lsqr.h"  
+#include "vnl/algo/vnl_svd.h"  
 #include "vnl/vnl_cross.h"  
 
 #include "vtkMath.h"
+#include "vtkMultiThreader.h"
 #include "vtkTransform.h"
 
+#include <algorithm>
+
 #define MINIMUM_NUMBER_OF_CALIBRATION_EQUATIONS 8
 
 //----------------------------------------------------------------------------
@@ -30,6 +32,73 @@ PlusMath::~PlusMath()
 
 }
 
+//----------------------------------------------------------------------------
+namespace
+{
+  // Residuals are computed on multiple threads only if the number of multiplications exceeds this limit, because for smaller
+  // systems starting the threads takes longer than the computation
+  const unsigned int MINIMUM_NUMBER_OF_MULTIPLICATIONS_PER_THREAD = 50000;
+
+  struct ComputeResidualsThreadFunctionInfoStruct
+  {
+    const std::vector<double>* AMatrix;
+    const std::vector<double>* BVector;
+    const std::vector<unsigned int>* ActiveRows;
+    unsigned int NumberOfUnknowns;
+    const double* Solution;
+    std::vector<double>* Residuals;
+  };
+
+  //----------------------------------------------------------------------------
+  /*! Compute Ax - b for the active rows from firstActiveRow to lastActiveRow-1 */
+  void ComputeResiduals(const ComputeResidualsThreadFunctionInfoStruct& str, size_t firstActiveRow, size_t lastActiveRow)
+  {
+    const std::vector<double>& aMatrix = *str.AMatrix;
+    const std::vector<double>& bVector = *str.BVector;
+    const std::vector<unsigned int>& activeRows = *str.ActiveRows;
+    std::vector<double>& residuals = *str.Residuals;
+    for (size_t i = firstActiveRow; i < lastActiveRow; ++i)
+    {
+      const unsigned int row = activeRows[i];
+      const double* rowCoefficients = &aMatrix[row * str.NumberOfUnknowns];
+      double difference = -bVector[row];
+      for (unsigned int col = 0; col < str.NumberOfUnknowns; ++col)
+      {
+        difference += rowCoefficients[col] * str.Solution[col];
+      }
+      residuals[i] = difference;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE ComputeResidualsThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    ComputeResidualsThreadFunctionInfoStruct* str = static_cast<ComputeResidualsThreadFunctionInfoStruct*>(threadInfo->UserData);
+    size_t threadId = threadInfo->ThreadID;
+    size_t threadCount = threadInfo->NumberOfThreads;
+    size_t numberOfActiveRows = str->ActiveRows->size();
+    ComputeResiduals(*str, numberOfActiveRows * threadId / threadCount, numberOfActiveRows * (threadId + 1) / threadCount);
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Add (sign=1) or remove (sign=-1) an equation to/from the normal equations (upper triangle of A^T*A, and A^T*b) */
+  void UpdateNormalEquations(vnl_matrix<double>& ataMatrix, vnl_vector<double>& atbVector, const double* rowCoefficients, double rightSide, double sign)
+  {
+    const unsigned int numberOfUnknowns = atbVector.size();
+    for (unsigned int i = 0; i < numberOfUnknowns; ++i)
+    {
+      const double weightedCoefficient = sign * rowCoefficients[i];
+      for (unsigned int j = i; j < numberOfUnknowns; ++j)
+      {
+        ataMatrix(i, j) += weightedCoefficient * rowCoefficients[j];
+      }
+      atbVector(i) += weightedCoefficient * rightSide;
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusStatus PlusMath::LSQRMinimize(const std::vector< std::vector<double> > &aMatrix, const std::vector<double> &bVector, vnl_vector<double> &resultVector, double* mean/*=NULL*/, double* stdev/*=NULL*/,vnl_vector<unsigned int> *notOutliersIndices/*=NULL*/)
 {
@@ -49,21 +118,28 @@ PlusStatus PlusMath::LSQRMinimize(const std::vector< std::vector<double> > &aMat
   }
 
   // The coefficient matrix aMatrix should be m-by-n and the column vector bVector must have length m.
-  const int n = aMatrix.begin()->size(); 
-  const int m = bVector.size();
+  const unsigned int n = aMatrix.begin()->size(); 
+  const unsigned int m = bVector.size();
+  if (aMatrix.size() != m)
+  {
+    LOG_ERROR("LSQRMinimize: number of rows of A matrix (" << aMatrix.size() << ") and size of b vector (" << m << ") are different");
+    resultVector.clear();
+    return PLUS_FAIL;
+  }
 
-  std::vector<vnl_vector<double> > aMatrixVnl(m); 
-  vnl_vector<double> row(n); 
-  for ( unsigned int i = 0; i < aMatrix.size(); ++i )
+  std::vector<double> aMatrixDense(m * n); 
+  for ( unsigned int row = 0; row < m; ++row )
   {
-    for ( unsigned int r = 0; r < aMatrix[i].size(); ++r )
+    if (aMatrix[row].size() != n)
     {
-      row[r] = aMatrix[i][r]; 
+      LOG_ERROR("LSQRMinimize: row " << row << " of A matrix has " << aMatrix[row].size() << " elements, expected " << n);
+      resultVector.clear();
+      return PLUS_FAIL;
     }
-    aMatrixVnl.push_back(row); 
+    std::copy(aMatrix[row].begin(), aMatrix[row].end(), aMatrixDense.begin() + row * n);
   }
 
-  return PlusMath::LSQRMinimize(aMatrixVnl, bVector, resultVector, mean, stdev,notOutliersIndices); 
+  return PlusMath::SolveLinearLeastSquaresWithOutlierRemoval(aMatrixDense, bVector, n, resultVector, mean, stdev, notOutliersIndices); 
 }
 
 //----------------------------------------------------------------------------
@@ -85,252 +161,229 @@ PlusStatus PlusMath::LSQRMinimize(const std::vector< vnl_vector<double> > &aMatr
   }
 
   // The coefficient matrix aMatrix should be m-by-n and the column vector bVector must have length m.
-  const int n = aMatrix.begin()->size(); 
-  const int m = bVector.size();
-
-  vnl_sparse_matrix<double> sparseMatrixLeftSide(m, n);
-  vnl_vector<double> vectorRightSide(m);
+  const unsigned int n = aMatrix.begin()->size(); 
+  const unsigned int m = bVector.size();
+  if (aMatrix.size() != m)
+  {
+    LOG_ERROR("LSQRMinimize: number of rows of A matrix (" << aMatrix.size() << ") and size of b vector (" << m << ") are different");
+    resultVector.clear();
+    return PLUS_FAIL;
+  }
 
-  for(int row = 0; row < m; row++)
+  std::vector<double> aMatrixDense(m * n); 
+  for ( unsigned int row = 0; row < m; ++row )
   {
-    // Populate the sparse matrix
-    for ( int i = 0; i < n; i++)
+    if (aMatrix[row].size() != n)
     {
-      sparseMatrixLeftSide(row,i) = aMatrix[row].get(i);
+      LOG_ERROR("LSQRMinimize: row " << row << " of A matrix has " << aMatrix[row].size() << " elements, expected " << n);
+      resultVector.clear();
+      return PLUS_FAIL;
     }
-
-    // Populate the vector
-    vectorRightSide.put(row, bVector[row]);
+    std::copy(aMatrix[row].begin(), aMatrix[row].end(), aMatrixDense.begin() + row * n);
   }
 
-  return PlusMath::LSQRMinimize(sparseMatrixLeftSide, vectorRightSide, resultVector, mean, stdev, notOutliersIndices); 
+  return PlusMath::SolveLinearLeastSquaresWithOutlierRemoval(aMatrixDense, bVector, n, resultVector, mean, stdev, notOutliersIndices); 
 }
 
-
 //----------------------------------------------------------------------------
 PlusStatus PlusMath::LSQRMinimize(const vnl_sparse_matrix<double> &sparseMatrixLeftSide, const vnl_vector<double> &vectorRightSide, vnl_vector<double> &resultVector, double* mean/*=NULL*/, double* stdev/*=NULL*/, vnl_vector<unsigned int>* notOutliersIndices/*NULL*/)
 {
   LOG_TRACE("PlusMath::LSQRMinimize"); 
 
-  PlusStatus returnStatus = PLUS_SUCCESS; 
-
-  vnl_sparse_matrix<double> aMatrix(sparseMatrixLeftSide); 
-  vnl_vector<double> bVector(vectorRightSide); 
-
-  bool outlierFound(true); 
-
-  while ( outlierFound && (bVector.size()>MINIMUM_NUMBER_OF_CALIBRATION_EQUATIONS) )
+  const unsigned int n = sparseMatrixLeftSide.cols(); 
+  const unsigned int m = sparseMatrixLeftSide.rows();
+  if (vectorRightSide.size() != m)
   {
-    // Construct linear system defined in VNL
-    vnl_sparse_matrix_linear_system<double> linearSystem( aMatrix, bVector );
-
-    // Instantiate the LSQR solver
-    vnl_lsqr lsqr( linearSystem );
-
-    // call minimize on the solver
-    int returnCode = lsqr.minimize( resultVector );
-
-    switch (returnCode)
-    {
-    case 0: // x = 0  is the exact solution. No iterations were performed.
-      returnStatus = PLUS_SUCCESS;
-      break;
-    case 1: // The equations A*x = b are probably compatible.  "
-      // Norm(A*x - b) is sufficiently small, given the "
-      // "values of ATOL and BTOL.",
-      returnStatus = PLUS_SUCCESS;
-      break;
-    case 2: // "The system A*x = b is probably not compatible.  "
-      // "A least-squares solution has been obtained that is "
-      // "sufficiently accurate, given the value of ATOL.",
-      returnStatus = PLUS_SUCCESS;
-      break;
-    case 3: // "An estimate of cond(Abar) has exceeded CONLIM.  "
-      //"The system A*x = b appears to be ill-conditioned.  "
-      // "Otherwise, there could be an error in subroutine APROD.",
-      LOG_WARNING("LSQR fit may be inaccurate, CONLIM exceeded");
-      returnStatus = PLUS_SUCCESS;
-      break;
-    case 4: // "The equations A*x = b are probably compatible.  "
-      // "Norm(A*x - b) is as small as seems reasonable on this machine.",
-      returnStatus = PLUS_SUCCESS;
-      break;
-    case 5: // "The system A*x = b is probably not compatible.  A least-squares "
-      // "solution has been obtained that is as accurate as seems "
-      // "reasonable on this machine.",
-      returnStatus = PLUS_SUCCESS;
-      break;
-    case 6: // "Cond(Abar) seems to be so large that there is no point in doing further "
-      // "iterations, given the precision of this machine. "
-      // "There could be an error in subroutine APROD.",
-      LOG_ERROR("LSQR fit may be inaccurate, ill-conditioned matrix");
-      return PLUS_FAIL;
-    case 7: // "The iteration limit ITNLIM was reached."
-      LOG_WARNING("LSQR fit may be inaccurate, ITNLIM was reached");
-      returnStatus = PLUS_SUCCESS;
-      break;
-    default:
-      LOG_ERROR("Unkown LSQR return code "<<returnCode);
-      return PLUS_FAIL;
-    }
-
-    const double thresholdMultiplier = 3.0; 
-
-    if ( PlusMath::RemoveOutliersFromLSQR(aMatrix, bVector, resultVector, outlierFound, thresholdMultiplier, mean, stdev , notOutliersIndices) != PLUS_SUCCESS )
-    {
-      LOG_WARNING("Failed to remove outliers from linear equations!"); 
-      return PLUS_FAIL; 
-    }
+    LOG_ERROR("Input A matrix and b vector dimensions were not met (number of equations were not the same)!"); 
+    return PLUS_FAIL; 
+  }
 
-    if (bVector.size()<= MINIMUM_NUMBER_OF_CALIBRATION_EQUATIONS)
+  std::vector<double> aMatrixDense(m * n, 0.0); 
+  for ( unsigned int row = 0; row < m; ++row )
+  {
+    const vnl_sparse_matrix<double>::row& matrixRow = sparseMatrixLeftSide.get_row(row);
+    for ( vnl_sparse_matrix<double>::row::const_iterator elementIt = matrixRow.begin(); elementIt != matrixRow.end(); ++elementIt )
     {
-      LOG_ERROR("It was not possible calibrate! Not enough equations!"); 
-      return PLUS_FAIL; 
+      aMatrixDense[row * n + elementIt->first] = elementIt->second;
     }
   }
+  std::vector<double> bVector(vectorRightSide.begin(), vectorRightSide.end());
 
-  return returnStatus; 
+  return PlusMath::SolveLinearLeastSquaresWithOutlierRemoval(aMatrixDense, bVector, n, resultVector, mean, stdev, notOutliersIndices); 
 }
 
 //----------------------------------------------------------------------------
-PlusStatus PlusMath::RemoveOutliersFromLSQR(vnl_sparse_matrix<double> &sparseMatrixLeftSide, 
-                                            vnl_vector<double> &vectorRightSide, 
-                                            vnl_vector<double> &resultVector, 
-                                            bool &outlierFound, 
-                                            double thresholdMultiplier/* = 3.0*/, 
-                                            double* mean/*=NULL*/, 
-                                            double* stdev/*=NULL*/,
-                      vnl_vector<unsigned int>* nonOutlierIndices /*NULL*/)
+PlusStatus PlusMath::SolveLinearLeastSquaresWithOutlierRemoval(const std::vector<double>& aMatrix, const std::vector<double>& bVector, unsigned int numberOfUnknowns,
+    vnl_vector<double>& resultVector, double* mean/*=NULL*/, double* stdev/*=NULL*/, vnl_vector<unsigned int>* notOutliersIndices/*=NULL*/, double thresholdMultiplier/*=3.0*/)
 {
-  // Set outlierFound flag to false by default 
-  outlierFound = false; 
-
-  const unsigned int numberOfEquations = sparseMatrixLeftSide.rows(); 
-  const unsigned int numberOfUnknowns = resultVector.size(); 
-
-  if ( vectorRightSide.size() != numberOfEquations )
+  const unsigned int numberOfEquations = bVector.size(); 
+  if ( numberOfUnknowns == 0 || aMatrix.size() != numberOfEquations * numberOfUnknowns )
   {
     LOG_ERROR("Input A matrix and b vector dimensions were not met (number of equations were not the same)!"); 
     return PLUS_FAIL; 
   }
-
-  if ( sparseMatrixLeftSide.cols() != numberOfUnknowns )
+  if ( notOutliersIndices != NULL && notOutliersIndices->size() != numberOfEquations )
   {
-    LOG_ERROR("Input A matrix dimension (columns) and number of unknowns are different (cols: " << sparseMatrixLeftSide.cols() << "  unknowns: " << numberOfUnknowns << ")" ); 
+    LOG_ERROR("Size of the not outliers indices vector (" << notOutliersIndices->size() << ") is different from the number of equations (" << numberOfEquations << ")"); 
     return PLUS_FAIL; 
   }
+  resultVector.set_size(numberOfUnknowns);
 
-
-  vnl_vector<double> differenceVector(numberOfEquations, 0); 
-  // Compute the difference between the measured and computed data ( Ax - b )
+  // Indices of the equations that are not outliers
+  std::vector<unsigned int> activeRows(numberOfEquations);
   for ( unsigned int row = 0; row < numberOfEquations; ++row )
   {
-    vnl_sparse_matrix<double>::row matrixRow = sparseMatrixLeftSide.get_row(row);
-    double difference(0); 
-    // Compute Ax - b for each row
-    for ( unsigned int i = 0; i < numberOfUnknowns; ++i )
-    {
-      // difference = A1x = a11*x1 + a12*x2 + ...
-      difference += (matrixRow[i].second * resultVector[i] ); 
-    }
-    // difference = A1x - b1 = a11*x1 + a12*x2 + ... - b1
-    difference -= vectorRightSide[row]; 
-    
-    // Add the difference to the vector 
-    differenceVector.put(row, difference); 
-  }
-
-  // Compute the mean difference 
-  const double meanDifference = differenceVector.mean(); 
-
-  // Compute the stdev of differences 
-  vnl_vector<double> diffFromMean = differenceVector - meanDifference; 
-  const double stdevDifference = sqrt( diffFromMean.squared_magnitude() / (1.0 * diffFromMean.size()) ); 
-
-  LOG_DEBUG("Mean = " << std::fixed << meanDifference << "   Stdev = " << stdevDifference); 
-
-  if ( mean != NULL )
-  {
-    *mean = meanDifference; 
+    activeRows[row] = row;
   }
 
-  if ( stdev != NULL )
+  // Normal equations: A^T*A x = A^T*b. Only the upper triangle of A^T*A is accumulated.
+  vnl_matrix<double> ataMatrix(numberOfUnknowns, numberOfUnknowns, 0.0);
+  vnl_vector<double> atbVector(numberOfUnknowns, 0.0);
+  for ( unsigned int row = 0; row < numberOfEquations; ++row )
   {
-    *stdev = stdevDifference; 
+    UpdateNormalEquations(ataMatrix, atbVector, &aMatrix[row * numberOfUnknowns], bVector[row], 1.0);
   }
 
-  // Temporary containers for input data 
-  std::vector< vcl_vector<double> > matrixRowsData; 
-  std::vector< vcl_vector<int> > matrixRowsIndecies; 
-  std::vector<double> bVector;   
-  std::vector<double> auxiliarNonOutlierIndicesVector;   
- 
-  vcl_vector<double> rowData(numberOfUnknowns, 0.0); 
-  vcl_vector<int> rowIndecies(numberOfUnknowns, 0); 
+  std::vector<double> residuals(numberOfEquations);
+  ComputeResidualsThreadFunctionInfoStruct str;
+  str.AMatrix = &aMatrix;
+  str.BVector = &bVector;
+  str.ActiveRows = &activeRows;
+  str.NumberOfUnknowns = numberOfUnknowns;
+  str.Residuals = &residuals;
+  vtkSmartPointer<vtkMultiThreader> threader;
 
-  // Look for outliers in each equations 
-  // If the difference from mean larger than thresholdMultiplier * stdev, remove it from equation 
-  for ( unsigned int row = 0; row < numberOfEquations; ++row )
+  std::vector<unsigned int> outlierRows;
+  bool outlierFound(true); 
+  bool outlierRemoved(false); 
+  while ( outlierFound && (activeRows.size()>MINIMUM_NUMBER_OF_CALIBRATION_EQUATIONS) )
   {
-    if ( fabs(differenceVector[row] - meanDifference) < thresholdMultiplier * stdevDifference )
-    { // Not an outlier 
-
-      // Copy data from matrix row in a format which is good for vnl_sparse_matrix<T>::set_row function 
-      vnl_sparse_matrix<double>::row matrixRow = sparseMatrixLeftSide.get_row(row);
-      for ( unsigned int i = 0; i < matrixRow.size(); ++i )
+    // Solve the normal equations
+    vnl_matrix<double> symmetricAtaMatrix(ataMatrix);
+    for ( unsigned int i = 0; i < numberOfUnknowns; ++i )
+    {
+      for ( unsigned int j = 0; j < i; ++j )
       {
-        rowIndecies[i] = matrixRow[i].first; 
-        rowData[i] = matrixRow[i].second; 
+        symmetricAtaMatrix(i, j) = ataMatrix(j, i);
       }
+    }
+    vnl_svd<double> svd(symmetricAtaMatrix);
+    if ( svd.sigma_max() <= 0 )
+    {
+      LOG_ERROR("Linear least squares fit failed, the coefficient matrix is zero");
+      return PLUS_FAIL;
+    }
+    svd.zero_out_relative(1e-14);
+    if ( svd.rank() < numberOfUnknowns )
+    {
+      LOG_WARNING("Linear least squares fit may be inaccurate, ill-conditioned matrix");
+    }
+    resultVector = svd.solve(atbVector);
 
-      // Save matrix row data, indecies and result vector into std::vectors
-      matrixRowsData.push_back(rowData); 
-      matrixRowsIndecies.push_back(rowIndecies); 
-      bVector.push_back(vectorRightSide[row]); 
-      if (nonOutlierIndices != NULL)
+    // Compute the difference between the measured and computed data ( Ax - b )
+    str.Solution = resultVector.data_block();
+    if ( activeRows.size() * numberOfUnknowns >= 2 * MINIMUM_NUMBER_OF_MULTIPLICATIONS_PER_THREAD )
+    {
+      if ( threader.GetPointer() == NULL )
       {
-        auxiliarNonOutlierIndicesVector.push_back(nonOutlierIndices->get(row));
+        threader = vtkSmartPointer<vtkMultiThreader>::New();
       }
+      threader->SetSingleMethod(ComputeResidualsThreadFunction, &str);
+      threader->SingleMethodExecute();
     }
     else
     {
-      // Outlier found
-      outlierFound = true; 
-      LOG_DEBUG("Outlier: " << std::fixed << differenceVector[row] << "(mean: " << meanDifference << "  stdev: " << stdevDifference << "  outlierTreshold: " << thresholdMultiplier * stdevDifference << ")" ); 
+      ComputeResiduals(str, 0, activeRows.size());
     }
-  }
 
-  // Resize matrices only if we found an outlier
-  if ( outlierFound ) 
-  {
-    // Copy back the new aMatrix and bVector 
-    vectorRightSide.clear(); 
-    vectorRightSide.set_size(bVector.size()); 
-    for ( unsigned int i = 0; i < bVector.size(); ++i )
+    // Compute the mean and stdev of differences
+    const unsigned int numberOfActiveRows = activeRows.size();
+    double sumDifference = 0; 
+    for ( unsigned int i = 0; i < numberOfActiveRows; ++i )
+    {
+      sumDifference += residuals[i];
+    }
+    const double meanDifference = sumDifference / numberOfActiveRows; 
+    double sumSquaredDifferenceFromMean = 0; 
+    for ( unsigned int i = 0; i < numberOfActiveRows; ++i )
     {
-      vectorRightSide.put(i, bVector[i]); 
+      sumSquaredDifferenceFromMean += (residuals[i] - meanDifference) * (residuals[i] - meanDifference);
     }
+    const double stdevDifference = sqrt( sumSquaredDifferenceFromMean / numberOfActiveRows ); 
 
-  if (nonOutlierIndices != NULL)
-  {
-    (*nonOutlierIndices).clear();
-      (*nonOutlierIndices).set_size(auxiliarNonOutlierIndicesVector.size());
-    for ( unsigned int i = 0; i < auxiliarNonOutlierIndicesVector.size(); ++i )
+    LOG_DEBUG("Mean = " << std::fixed << meanDifference << "   Stdev = " << stdevDifference); 
+
+    if ( mean != NULL )
+    {
+      *mean = meanDifference; 
+    }
+    if ( stdev != NULL )
+    {
+      *stdev = stdevDifference; 
+    }
+
+    // Look for outliers in each equations 
+    // If the difference from mean larger than thresholdMultiplier * stdev, remove it from equation 
+    outlierRows.clear();
+    unsigned int numberOfKeptRows = 0;
+    for ( unsigned int i = 0; i < numberOfActiveRows; ++i )
+    {
+      if ( stdevDifference == 0 || fabs(residuals[i] - meanDifference) < thresholdMultiplier * stdevDifference )
       {
-      (*nonOutlierIndices).put(i,auxiliarNonOutlierIndicesVector[i]);
+        // Not an outlier, keep it (in the original order)
+        activeRows[numberOfKeptRows++] = activeRows[i];
       }
-  }
+      else
+      {
+        LOG_DEBUG("Outlier: " << std::fixed << residuals[i] << "(mean: " << meanDifference << "  stdev: " << stdevDifference << "  outlierTreshold: " << thresholdMultiplier * stdevDifference << ")" ); 
+        outlierRows.push_back(activeRows[i]);
+      }
+    }
+    activeRows.resize(numberOfKeptRows);
+    outlierFound = !outlierRows.empty();
 
+    if ( outlierFound )
+    {
+      outlierRemoved = true;
+      if ( outlierRows.size() < activeRows.size() )
+      {
+        // Remove the outlier equations from the normal equations
+        for ( std::vector<unsigned int>::const_iterator rowIt = outlierRows.begin(); rowIt != outlierRows.end(); ++rowIt )
+        {
+          UpdateNormalEquations(ataMatrix, atbVector, &aMatrix[(*rowIt) * numberOfUnknowns], bVector[*rowIt], -1.0);
+        }
+      }
+      else
+      {
+        // Most of the equations are removed, recomputing the normal equations is faster and more accurate
+        ataMatrix.fill(0.0);
+        atbVector.fill(0.0);
+        for ( std::vector<unsigned int>::const_iterator rowIt = activeRows.begin(); rowIt != activeRows.end(); ++rowIt )
+        {
+          UpdateNormalEquations(ataMatrix, atbVector, &aMatrix[(*rowIt) * numberOfUnknowns], bVector[*rowIt], 1.0);
+        }
+      }
+    }
+    else
+    {
+      LOG_DEBUG("*** Outlier removal was successful! No more outlier found!"); 
+    }
 
-    sparseMatrixLeftSide.resize(matrixRowsData.size(), numberOfUnknowns); 
-    for ( unsigned int r = 0; r < matrixRowsData.size(); r++ )
+    if (activeRows.size()<= MINIMUM_NUMBER_OF_CALIBRATION_EQUATIONS)
     {
-      sparseMatrixLeftSide.set_row(r, matrixRowsIndecies[r], matrixRowsData[r]); 
+      LOG_ERROR("It was not possible calibrate! Not enough equations!"); 
+      return PLUS_FAIL; 
     }
   }
-  else
+
+  if ( outlierRemoved && notOutliersIndices != NULL )
   {
-    LOG_DEBUG("*** Outlier removal was successful! No more outlier found!"); 
+    vnl_vector<unsigned int> allIndices(*notOutliersIndices);
+    notOutliersIndices->set_size(activeRows.size());
+    for ( unsigned int i = 0; i < activeRows.size(); ++i )
+    {
+      notOutliersIndices->put(i, allIndices[activeRows[i]]);
+    }
   }
 
   return PLUS_SUCCESS; 
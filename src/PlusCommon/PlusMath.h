@@ -37,7 +37,7 @@ class vtkPlusCommonExport PlusMath
 public:
 
   /*!
-    Solve Ax = b sparse linear equations with robust linear least squares method (vnl_lsqr and outlier removal)
+    Solve Ax = b sparse linear equations with robust linear least squares method (normal equations and outlier removal)
     \param aMatrix The coefficient matrix of size m-by-n.
     \param bVector Column vector of length m.
     \param mean Pointer to get the resulting mean of the the LSQR fit error
@@ -47,7 +47,7 @@ public:
   */
   static PlusStatus LSQRMinimize(const std::vector< std::vector<double> > &aMatrix, const std::vector<double> &bVector, vnl_vector<double> &resultVector, double* mean = NULL, double* stdev = NULL, vnl_vector<unsigned int>* notOutliersIndices=NULL); 
   /*!
-    Solve Ax = b sparse linear equations with robust linear least squares method (vnl_lsqr and outlier removal)
+    Solve Ax = b sparse linear equations with robust linear least squares method (normal equations and outlier removal)
     \param aMatrix The coefficient matrix of size m-by-n.
     \param bVector Column vector of length m.
     \param mean Pointer to get the resulting mean of the the LSQR fit error
@@ -57,7 +57,7 @@ public:
   */
   static PlusStatus LSQRMinimize(const std::vector<vnl_vector<double> > &aMatrix, const std::vector<double> &bVector, vnl_vector<double> &resultVector, double* mean = NULL, double* stdev = NULL , vnl_vector<unsigned int>* notOutliersIndices=NULL); 
   /*!
-    Solve Ax = b sparse linear equations with robust linear least squares method (vnl_lsqr and outlier removal)
+    Solve Ax = b sparse linear equations with robust linear least squares method (normal equations and outlier removal)
     \param sparseMatrixLeftSide The coefficient matrix of size m-by-n. (aMatrix)
     \param vectorRightSide Column vector of length m. (bVector)
     \param mean Pointer to get the resulting mean of the the LSQR fit error
@@ -266,16 +266,29 @@ protected:
   PlusMath(); 
   ~PlusMath();
 
-  /*! Remove outliers from Ax = b sparse linear equations after linear least squares method (vnl_lsqr) */
-  static PlusStatus RemoveOutliersFromLSQR(
-    vnl_sparse_matrix<double> &sparseMatrixLeftSide, 
-    vnl_vector<double> &vectorRightSide, 
+  /*!
+    Solve Ax = b linear equations with linear least squares method and iterative outlier removal.
+    The normal equations (A^T*A, A^T*b) are accumulated once and the contribution of the rejected
+    equations is subtracted from them, so each iteration only solves a small n-by-n system.
+    Residuals of large systems are computed on multiple threads.
+    \param aMatrix The coefficient matrix of size m-by-n, stored row by row
+    \param bVector Column vector of length m
+    \param numberOfUnknowns Number of columns of the coefficient matrix (n)
+    \param resultVector to store the results
+    \param mean Pointer to get the resulting mean of the fit error
+    \param stdev Pointer to get the resulting standard deviation of the fit error
+    \param notOutliersIndices Row that were not removed during the outliers rejection process
+    \param thresholdMultiplier An equation is an outlier if its error differs from the mean by more than thresholdMultiplier * stdev
+  */
+  static PlusStatus SolveLinearLeastSquaresWithOutlierRemoval(
+    const std::vector<double> &aMatrix, 
+    const std::vector<double> &bVector, 
+    unsigned int numberOfUnknowns, 
     vnl_vector<double> &resultVector, 
-    bool &outlierFound, 
-    double thresholdMultiplier = 3.0, 
     double* mean = NULL, 
     double* stdev = NULL,
-    vnl_vector<unsigned int>* nonOutlierIndices = NULL
+    vnl_vector<unsigned int>* notOutliersIndices = NULL,
+    double thresholdMultiplier = 3.0
   ); 
 
 private: 
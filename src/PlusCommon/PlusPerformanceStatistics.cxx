@@ -0,0 +1,411 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusPerformanceStatistics.h"
+#include "vtkPlusRecursiveCriticalSection.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLDataElement.h"
+
+#include <iomanip>
+
+//----------------------------------------------------------------------------
+namespace
+{
+  // Protects the histogram and counter maps (not the recording of samples)
+  vtkPlusSimpleRecursiveCriticalSection PerformanceStatisticsCriticalSection;
+
+  //----------------------------------------------------------------------------
+  std::string FormatValue(double value)
+  {
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(3) << value;
+    return ss.str();
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusPerformanceHistogram::PlusPerformanceHistogram(const std::string& name, const std::string& unit)
+  : Name(name)
+  , Unit(unit)
+{
+  this->Reset();
+}
+
+//----------------------------------------------------------------------------
+uint64_t PlusPerformanceHistogram::QuantizeValue(double value)
+{
+  const double maxQuantizedValue = static_cast<double>((static_cast<uint64_t>(1) << MAX_VALUE_BITS) - 1);
+  double quantizedValue = value * VALUE_SCALE + 0.5;
+  if (!(quantizedValue > 0)) // also catches NaN
+  {
+    return 0;
+  }
+  if (quantizedValue > maxQuantizedValue)
+  {
+    quantizedValue = maxQuantizedValue;
+  }
+  return static_cast<uint64_t>(quantizedValue);
+}
+
+//----------------------------------------------------------------------------
+unsigned int PlusPerformanceHistogram::GetBucketIndex(uint64_t quantizedValue)
+{
+  if (quantizedValue < NUMBER_OF_LINEAR_BUCKETS)
+  {
+    return static_cast<unsigned int>(quantizedValue);
+  }
+  // Find the most significant bit
+  unsigned int msb = 0;
+  uint64_t v = quantizedValue;
+  if (v >> 32) { v >>= 32; msb += 32; }
+  if (v >> 16) { v >>= 16; msb += 16; }
+  if (v >> 8) { v >>= 8; msb += 8; }
+  if (v >> 4) { v >>= 4; msb += 4; }
+  if (v >> 2) { v >>= 2; msb += 2; }
+  if (v >> 1) { msb += 1; }
+  // The bits below the most significant bit select the sub-bucket
+  const unsigned int subBucket = static_cast<unsigned int>(quantizedValue >> (msb - SUB_BUCKET_BITS)) & ((1 << SUB_BUCKET_BITS) - 1);
+  return NUMBER_OF_LINEAR_BUCKETS + (msb - 4) * (1 << SUB_BUCKET_BITS) + subBucket;
+}
+
+//----------------------------------------------------------------------------
+uint64_t PlusPerformanceHistogram::GetBucketMidValue(unsigned int bucketIndex)
+{
+  if (bucketIndex < NUMBER_OF_LINEAR_BUCKETS)
+  {
+    return bucketIndex;
+  }
+  const unsigned int msb = 4 + (bucketIndex - NUMBER_OF_LINEAR_BUCKETS) / (1 << SUB_BUCKET_BITS);
+  const unsigned int subBucket = (bucketIndex - NUMBER_OF_LINEAR_BUCKETS) % (1 << SUB_BUCKET_BITS);
+  const uint64_t bucketWidth = static_cast<uint64_t>(1) << (msb - SUB_BUCKET_BITS);
+  return ((1 << SUB_BUCKET_BITS) + subBucket) * bucketWidth + bucketWidth / 2;
+}
+
+//----------------------------------------------------------------------------
+void PlusPerformanceHistogram::AddSample(double value)
+{
+  const uint64_t quantizedValue = QuantizeValue(value);
+  this->BucketCounts[GetBucketIndex(quantizedValue)].fetch_add(1, std::memory_order_relaxed);
+  this->NumberOfSamples.fetch_add(1, std::memory_order_relaxed);
+  this->QuantizedSum.fetch_add(quantizedValue, std::memory_order_relaxed);
+  this->QuantizedLastSample.store(quantizedValue, std::memory_order_relaxed);
+  uint64_t maximum = this->QuantizedMaximum.load(std::memory_order_relaxed);
+  while (quantizedValue > maximum && !this->QuantizedMaximum.compare_exchange_weak(maximum, quantizedValue, std::memory_order_relaxed))
+  {
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusPerformanceHistogram::Reset()
+{
+  for (unsigned int i = 0; i < NUMBER_OF_BUCKETS; ++i)
+  {
+    this->BucketCounts[i].store(0, std::memory_order_relaxed);
+  }
+  this->NumberOfSamples.store(0, std::memory_order_relaxed);
+  this->QuantizedSum.store(0, std::memory_order_relaxed);
+  this->QuantizedMaximum.store(0, std::memory_order_relaxed);
+  this->QuantizedLastSample.store(0, std::memory_order_relaxed);
+  this->ResetTime.store(vtkPlusAccurateTimer::GetSystemTime(), std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+uint64_t PlusPerformanceHistogram::GetNumberOfSamples() const
+{
+  return this->NumberOfSamples.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+double PlusPerformanceHistogram::GetMean() const
+{
+  const uint64_t numberOfSamples = this->GetNumberOfSamples();
+  if (numberOfSamples == 0)
+  {
+    return 0.0;
+  }
+  return static_cast<double>(this->QuantizedSum.load(std::memory_order_relaxed)) / numberOfSamples / VALUE_SCALE;
+}
+
+//----------------------------------------------------------------------------
+double PlusPerformanceHistogram::GetMaximum() const
+{
+  return static_cast<double>(this->QuantizedMaximum.load(std::memory_order_relaxed)) / VALUE_SCALE;
+}
+
+//----------------------------------------------------------------------------
+double PlusPerformanceHistogram::GetLastSample() const
+{
+  return static_cast<double>(this->QuantizedLastSample.load(std::memory_order_relaxed)) / VALUE_SCALE;
+}
+
+//----------------------------------------------------------------------------
+double PlusPerformanceHistogram::GetPercentile(double percent) const
+{
+  // Samples may be added while the percentile is computed, so use a snapshot of the bucket counts
+  uint64_t bucketCounts[NUMBER_OF_BUCKETS];
+  uint64_t numberOfSamples = 0;
+  for (unsigned int i = 0; i < NUMBER_OF_BUCKETS; ++i)
+  {
+    bucketCounts[i] = this->BucketCounts[i].load(std::memory_order_relaxed);
+    numberOfSamples += bucketCounts[i];
+  }
+  if (numberOfSamples == 0)
+  {
+    return 0.0;
+  }
+
+  // Rank of the sample that is at the requested percentile (1-based)
+  uint64_t rank = static_cast<uint64_t>(percent / 100.0 * numberOfSamples + 0.5);
+  if (rank < 1)
+  {
+    rank = 1;
+  }
+  else if (rank > numberOfSamples)
+  {
+    rank = numberOfSamples;
+  }
+
+  const uint64_t quantizedMaximum = this->QuantizedMaximum.load(std::memory_order_relaxed);
+  uint64_t numberOfSamplesBelow = 0;
+  for (unsigned int i = 0; i < NUMBER_OF_BUCKETS; ++i)
+  {
+    numberOfSamplesBelow += bucketCounts[i];
+    if (numberOfSamplesBelow >= rank)
+    {
+      uint64_t quantizedValue = GetBucketMidValue(i);
+      if (quantizedValue > quantizedMaximum && quantizedMaximum > 0)
+      {
+        // The value cannot be larger than the largest sample
+        quantizedValue = quantizedMaximum;
+      }
+      return static_cast<double>(quantizedValue) / VALUE_SCALE;
+    }
+  }
+  return this->GetMaximum();
+}
+
+//----------------------------------------------------------------------------
+double PlusPerformanceHistogram::GetSampleRate() const
+{
+  const double elapsedTimeSec = vtkPlusAccurateTimer::GetSystemTime() - this->ResetTime.load(std::memory_order_relaxed);
+  if (elapsedTimeSec <= 0)
+  {
+    return 0.0;
+  }
+  return this->GetNumberOfSamples() / elapsedTimeSec;
+}
+
+//----------------------------------------------------------------------------
+void PlusPerformanceHistogram::WriteSummary(vtkXMLDataElement* parentElement) const
+{
+  vtkSmartPointer<vtkXMLDataElement> histogramElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  histogramElement->SetName("Histogram");
+  histogramElement->SetAttribute("Name", this->Name.c_str());
+  histogramElement->SetAttribute("Unit", this->Unit.c_str());
+  histogramElement->SetAttribute("Count", PlusCommon::ToString<uint64_t>(this->GetNumberOfSamples()).c_str());
+  histogramElement->SetAttribute("RatePerSec", FormatValue(this->GetSampleRate()).c_str());
+  histogramElement->SetAttribute("Mean", FormatValue(this->GetMean()).c_str());
+  histogramElement->SetAttribute("P50", FormatValue(this->GetPercentile(50)).c_str());
+  histogramElement->SetAttribute("P99", FormatValue(this->GetPercentile(99)).c_str());
+  histogramElement->SetAttribute("Max", FormatValue(this->GetMaximum()).c_str());
+  histogramElement->SetAttribute("Last", FormatValue(this->GetLastSample()).c_str());
+  parentElement->AddNestedElement(histogramElement);
+}
+
+//----------------------------------------------------------------------------
+PlusPerformanceCounter::PlusPerformanceCounter(const std::string& name)
+  : Name(name)
+  , Value(0)
+{
+}
+
+//----------------------------------------------------------------------------
+void PlusPerformanceCounter::WriteSummary(vtkXMLDataElement* parentElement) const
+{
+  vtkSmartPointer<vtkXMLDataElement> counterElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  counterElement->SetName("Counter");
+  counterElement->SetAttribute("Name", this->Name.c_str());
+  counterElement->SetAttribute("Value", PlusCommon::ToString<uint64_t>(this->GetValue()).c_str());
+  parentElement->AddNestedElement(counterElement);
+}
+
+//----------------------------------------------------------------------------
+PlusPerformanceStatistics::PlusPerformanceStatistics()
+  : LoggingPeriodSec(0.0)
+  , LastLoggingTime(0.0)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusPerformanceStatistics::~PlusPerformanceStatistics()
+{
+  for (HistogramMapType::iterator it = this->Histograms.begin(); it != this->Histograms.end(); ++it)
+  {
+    delete it->second;
+  }
+  this->Histograms.clear();
+  for (CounterMapType::iterator it = this->Counters.begin(); it != this->Counters.end(); ++it)
+  {
+    delete it->second;
+  }
+  this->Counters.clear();
+}
+
+//----------------------------------------------------------------------------
+PlusPerformanceStatistics* PlusPerformanceStatistics::GetInstance()
+{
+  // Initialization of a function-local static is thread-safe.
+  // The instance is intentionally not deleted at exit, as acquisition threads may still record samples.
+  static PlusPerformanceStatistics* instance = new PlusPerformanceStatistics;
+  return instance;
+}
+
+//----------------------------------------------------------------------------
+PlusPerformanceHistogram* PlusPerformanceStatistics::GetHistogram(const std::string& name, const std::string& unit /*= "ms"*/)
+{
+  PlusLockGuard<vtkPlusSimpleRecursiveCriticalSection> mapGuard(&PerformanceStatisticsCriticalSection);
+  HistogramMapType::iterator histogramIt = this->Histograms.find(name);
+  ++this->HistogramReferenceCounts[name];
+  if (histogramIt != this->Histograms.end())
+  {
+    return histogramIt->second;
+  }
+  PlusPerformanceHistogram* histogram = new PlusPerformanceHistogram(name, unit);
+  this->Histograms[name] = histogram;
+  return histogram;
+}
+
+//----------------------------------------------------------------------------
+void PlusPerformanceStatistics::ReleaseHistogram(PlusPerformanceHistogram* histogram)
+{
+  if (histogram == NULL)
+  {
+    return;
+  }
+  PlusLockGuard<vtkPlusSimpleRecursiveCriticalSection> mapGuard(&PerformanceStatisticsCriticalSection);
+  HistogramMapType::iterator histogramIt = this->Histograms.find(histogram->GetName());
+  if (histogramIt == this->Histograms.end() || histogramIt->second != histogram)
+  {
+    LOG_ERROR("PlusPerformanceStatistics::ReleaseHistogram failed: histogram " << histogram->GetName() << " is not registered");
+    return;
+  }
+  unsigned int& referenceCount = this->HistogramReferenceCounts[histogram->GetName()];
+  if (referenceCount > 1)
+  {
+    --referenceCount;
+    return;
+  }
+  this->HistogramReferenceCounts.erase(histogram->GetName());
+  this->Histograms.erase(histogramIt);
+  delete histogram;
+}
+
+//----------------------------------------------------------------------------
+PlusPerformanceCounter* PlusPerformanceStatistics::GetCounter(const std::string& name)
+{
+  PlusLockGuard<vtkPlusSimpleRecursiveCriticalSection> mapGuard(&PerformanceStatisticsCriticalSection);
+  CounterMapType::iterator counterIt = this->Counters.find(name);
+  if (counterIt != this->Counters.end())
+  {
+    return counterIt->second;
+  }
+  PlusPerformanceCounter* counter = new PlusPerformanceCounter(name);
+  this->Counters[name] = counter;
+  return counter;
+}
+
+//----------------------------------------------------------------------------
+void PlusPerformanceStatistics::Reset()
+{
+  PlusLockGuard<vtkPlusSimpleRecursiveCriticalSection> mapGuard(&PerformanceStatisticsCriticalSection);
+  for (HistogramMapType::iterator it = this->Histograms.begin(); it != this->Histograms.end(); ++it)
+  {
+    it->second->Reset();
+  }
+  for (CounterMapType::iterator it = this->Counters.begin(); it != this->Counters.end(); ++it)
+  {
+    it->second->Reset();
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusPerformanceStatistics::WriteSummary(vtkXMLDataElement* statisticsElement)
+{
+  if (statisticsElement == NULL)
+  {
+    LOG_ERROR("Failed to write performance statistics: invalid XML element");
+    return;
+  }
+  statisticsElement->SetName("PerformanceStatistics");
+  PlusLockGuard<vtkPlusSimpleRecursiveCriticalSection> mapGuard(&PerformanceStatisticsCriticalSection);
+  for (HistogramMapType::iterator it = this->Histograms.begin(); it != this->Histograms.end(); ++it)
+  {
+    it->second->WriteSummary(statisticsElement);
+  }
+  for (CounterMapType::iterator it = this->Counters.begin(); it != this->Counters.end(); ++it)
+  {
+    it->second->WriteSummary(statisticsElement);
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusPerformanceStatistics::LogSummary()
+{
+  PlusLockGuard<vtkPlusSimpleRecursiveCriticalSection> mapGuard(&PerformanceStatisticsCriticalSection);
+  for (HistogramMapType::iterator it = this->Histograms.begin(); it != this->Histograms.end(); ++it)
+  {
+    const PlusPerformanceHistogram* histogram = it->second;
+    if (histogram->GetNumberOfSamples() == 0)
+    {
+      continue;
+    }
+    LOG_INFO("Performance: " << histogram->GetName() << " count=" << histogram->GetNumberOfSamples()
+             << " rate=" << FormatValue(histogram->GetSampleRate()) << "/s"
+             << " mean=" << FormatValue(histogram->GetMean())
+             << " p50=" << FormatValue(histogram->GetPercentile(50))
+             << " p99=" << FormatValue(histogram->GetPercentile(99))
+             << " max=" << FormatValue(histogram->GetMaximum()) << " " << histogram->GetUnit());
+  }
+  for (CounterMapType::iterator it = this->Counters.begin(); it != this->Counters.end(); ++it)
+  {
+    LOG_INFO("Performance: " << it->second->GetName() << " = " << it->second->GetValue());
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusPerformanceStatistics::SetLoggingPeriodSec(double periodSec)
+{
+  this->LoggingPeriodSec.store(periodSec);
+  this->LastLoggingTime.store(vtkPlusAccurateTimer::GetSystemTime());
+}
+
+//----------------------------------------------------------------------------
+double PlusPerformanceStatistics::GetLoggingPeriodSec() const
+{
+  return this->LoggingPeriodSec.load();
+}
+
+//----------------------------------------------------------------------------
+void PlusPerformanceStatistics::UpdatePeriodicLogging()
+{
+  const double loggingPeriodSec = this->LoggingPeriodSec.load(std::memory_order_relaxed);
+  if (loggingPeriodSec <= 0)
+  {
+    return;
+  }
+  const double currentTime = vtkPlusAccurateTimer::GetSystemTime();
+  double lastLoggingTime = this->LastLoggingTime.load(std::memory_order_relaxed);
+  if (currentTime - lastLoggingTime < loggingPeriodSec)
+  {
+    return;
+  }
+  // Only one of the callers should log if multiple threads call this method at the same time
+  if (this->LastLoggingTime.compare_exchange_strong(lastLoggingTime, currentTime))
+  {
+    this->LogSummary();
+  }
+}
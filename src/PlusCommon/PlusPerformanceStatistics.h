@@ -0,0 +1,235 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusPerformanceStatistics_h
+#define __PlusPerformanceStatistics_h
+
+#include "vtkPlusCommonExport.h"
+
+#include "vtkPlusAccurateTimer.h"
+
+#include <atomic>
+#include <map>
+#include <stdint.h>
+#include <string>
+
+class vtkXMLDataElement;
+
+/*!
+  \class PlusPerformanceHistogram
+  \brief Collects the distribution of a measured value (typically a duration in milliseconds) without locking
+
+  Samples are counted in logarithmic buckets (8 buckets per power of two), so percentiles are
+  computed with less than 7% relative error, while maximum, mean, and last values are exact
+  (at 0.001 unit resolution). AddSample may be called from any number of threads concurrently.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusPerformanceHistogram
+{
+public:
+  PlusPerformanceHistogram(const std::string& name, const std::string& unit);
+
+  /*! Record a new sample. Negative values are recorded as 0. */
+  void AddSample(double value);
+
+  /*! Remove all samples and restart the sample rate measurement */
+  void Reset();
+
+  const std::string& GetName() const { return this->Name; }
+  const std::string& GetUnit() const { return this->Unit; }
+
+  uint64_t GetNumberOfSamples() const;
+  double GetMean() const;
+  double GetMaximum() const;
+  double GetLastSample() const;
+
+  /*! Get the value below which the given percentage of samples fall (e.g., percent=99 for p99) */
+  double GetPercentile(double percent) const;
+
+  /*! Average number of samples per second since the creation or last reset of the histogram */
+  double GetSampleRate() const;
+
+  /*! Add an element with the histogram summary to the parent element */
+  void WriteSummary(vtkXMLDataElement* parentElement) const;
+
+protected:
+  /*! Values are stored as integers, in 1/VALUE_SCALE units */
+  static const int VALUE_SCALE = 1000;
+  /*! Values up to 16/VALUE_SCALE have their own bucket, larger values are counted in 8 buckets per power of two */
+  static const unsigned int NUMBER_OF_LINEAR_BUCKETS = 16;
+  static const unsigned int SUB_BUCKET_BITS = 3;
+  static const unsigned int MAX_VALUE_BITS = 48;
+  static const unsigned int NUMBER_OF_BUCKETS = NUMBER_OF_LINEAR_BUCKETS + (MAX_VALUE_BITS - 4) * (1 << SUB_BUCKET_BITS);
+
+  static uint64_t QuantizeValue(double value);
+  static unsigned int GetBucketIndex(uint64_t quantizedValue);
+  /*! Get the value in the middle of the range of values counted in the bucket */
+  static uint64_t GetBucketMidValue(unsigned int bucketIndex);
+
+  std::string Name;
+  std::string Unit;
+  std::atomic<uint64_t> BucketCounts[NUMBER_OF_BUCKETS];
+  std::atomic<uint64_t> NumberOfSamples;
+  std::atomic<uint64_t> QuantizedSum;
+  std::atomic<uint64_t> QuantizedMaximum;
+  std::atomic<uint64_t> QuantizedLastSample;
+  std::atomic<double> ResetTime;
+
+private:
+  PlusPerformanceHistogram(const PlusPerformanceHistogram&);
+  void operator=(const PlusPerformanceHistogram&);
+};
+
+/*!
+  \class PlusPerformanceCounter
+  \brief Counts events (e.g., dropped items) without locking
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusPerformanceCounter
+{
+public:
+  PlusPerformanceCounter(const std::string& name);
+
+  void Increment(uint64_t count = 1) { this->Value.fetch_add(count, std::memory_order_relaxed); }
+  uint64_t GetValue() const { return this->Value.load(std::memory_order_relaxed); }
+  void Reset() { this->Value.store(0, std::memory_order_relaxed); }
+
+  const std::string& GetName() const { return this->Name; }
+
+  /*! Add an element with the counter value to the parent element */
+  void WriteSummary(vtkXMLDataElement* parentElement) const;
+
+protected:
+  std::string Name;
+  std::atomic<uint64_t> Value;
+
+private:
+  PlusPerformanceCounter(const PlusPerformanceCounter&);
+  void operator=(const PlusPerformanceCounter&);
+};
+
+/*!
+  \class PlusPerformanceScopedTimer
+  \brief Records the time elapsed between construction and destruction (in milliseconds) into a histogram
+
+  Usage example:
+  \code
+  {
+    PlusPerformanceScopedTimer timer(this->InternalUpdateDurationStatistics);
+    this->InternalUpdate();
+  }
+  \endcode
+
+  If the histogram is NULL then nothing is recorded.
+
+  \ingroup PlusLibCommon
+*/
+class PlusPerformanceScopedTimer
+{
+public:
+  PlusPerformanceScopedTimer(PlusPerformanceHistogram* histogram)
+    : Histogram(histogram)
+    , StartTime(histogram != NULL ? vtkPlusAccurateTimer::GetSystemTime() : 0)
+  {
+  }
+  ~PlusPerformanceScopedTimer()
+  {
+    if (this->Histogram != NULL)
+    {
+      this->Histogram->AddSample((vtkPlusAccurateTimer::GetSystemTime() - this->StartTime) * 1000.0);
+    }
+  }
+
+protected:
+  PlusPerformanceHistogram* Histogram;
+  double StartTime;
+
+private:
+  PlusPerformanceScopedTimer(const PlusPerformanceScopedTimer&);
+  void operator=(const PlusPerformanceScopedTimer&);
+};
+
+/*!
+  \class PlusPerformanceStatistics
+  \brief This singleton class keeps track of all the performance histograms and counters of the process
+
+  Components get a histogram or counter by name once (e.g., when the device is connected) and then record
+  samples into it directly, without any locking or lookup. Getting a histogram or counter with an
+  existing name returns the existing object. Counters, and histograms that are never released, are kept
+  until the process exits, therefore their names must come from a bounded set. Histograms with names that
+  contain per-connection identifiers must be released by each user (see ReleaseHistogram) when the
+  connection is closed.
+
+  Naming convention: [ComponentType].[ComponentId].[Quantity], for example Device.TrackerDevice.InternalUpdateMs.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusPerformanceStatistics
+{
+public:
+  /*! Get the single instance of the class */
+  static PlusPerformanceStatistics* GetInstance();
+
+  /*! Get a histogram by name. If the histogram does not exist yet then it is created. */
+  PlusPerformanceHistogram* GetHistogram(const std::string& name, const std::string& unit = "ms");
+
+  /*!
+    Release a histogram that was obtained by GetHistogram. The histogram is deleted when all the users
+    that got it have released it, therefore the caller must not record samples into it anymore.
+  */
+  void ReleaseHistogram(PlusPerformanceHistogram* histogram);
+
+  /*! Get a counter by name. If the counter does not exist yet then it is created. */
+  PlusPerformanceCounter* GetCounter(const std::string& name);
+
+  /*! Reset all histograms and counters */
+  void Reset();
+
+  /*!
+    Write the summary of all histograms and counters into an XML element. Example:
+    \code
+    <PerformanceStatistics>
+      <Histogram Name="Device.VideoDevice.InternalUpdateMs" Unit="ms" Count="1503" RatePerSec="30.1" Mean="2.1" P50="2.0" P99="4.1" Max="7.3" Last="1.9" />
+      <Counter Name="Buffer.VideoDevice-Video.DroppedItems" Value="2" />
+    </PerformanceStatistics>
+    \endcode
+  */
+  void WriteSummary(vtkXMLDataElement* statisticsElement);
+
+  /*! Write the summary of all histograms and counters into the log */
+  void LogSummary();
+
+  /*!
+    Set the period of logging the summary of all statistics. If the period is not positive (default)
+    then the statistics are not logged periodically.
+  */
+  void SetLoggingPeriodSec(double periodSec);
+  double GetLoggingPeriodSec() const;
+
+  /*! Log the summary if the logging period elapsed since the last logging. Should be called regularly from a processing loop. */
+  void UpdatePeriodicLogging();
+
+protected:
+  PlusPerformanceStatistics();
+  ~PlusPerformanceStatistics();
+
+  typedef std::map<std::string, PlusPerformanceHistogram*> HistogramMapType;
+  typedef std::map<std::string, PlusPerformanceCounter*> CounterMapType;
+
+  HistogramMapType Histograms;
+  /*! Number of GetHistogram calls that have not been followed by ReleaseHistogram, for each histogram name */
+  std::map<std::string, unsigned int> HistogramReferenceCounts;
+  CounterMapType Counters;
+  std::atomic<double> LoggingPeriodSec;
+  std::atomic<double> LastLoggingTime;
+
+private:
+  PlusPerformanceStatistics(const PlusPerformanceStatistics&);
+  void operator=(const PlusPerformanceStatistics&);
+};
+
+#endif
@@ -15,6 +15,8 @@ See License.txt for details.
 #include "vtkPoints.h"
 #include "vtkXMLUtilities.h"
 
+#include <algorithm>
+
 //----------------------------------------------------------------------------
 // ************************* TrackedFrame ************************************
 //----------------------------------------------------------------------------
@@ -24,6 +26,16 @@ const std::string PlusTrackedFrame::TransformPostfix = "Transform";
 const std::string PlusTrackedFrame::TransformStatusPostfix = "TransformStatus";
 const int FLOATING_POINT_PRECISION = 16; // Number of digits used when writing transforms and timestamps
 
+namespace
+{
+  //----------------------------------------------------------------------------
+  PlusFrameFields::FieldId GetTimestampFieldId()
+  {
+    static const PlusFrameFields::FieldId timestampFieldId = PlusFrameFields::GetFieldId("Timestamp");
+    return timestampFieldId;
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusTrackedFrame::PlusTrackedFrame()
 {
@@ -114,32 +126,34 @@ PlusStatus PlusTrackedFrame::PrintToXML(vtkXMLDataElement* trackedFrame, const s
     trackedFrame->SetVectorAttribute("FrameSize", 3, frameSizeSigned);
   }
 
-  for (auto fieldIter = CustomFrameFields.begin(); fieldIter != CustomFrameFields.end(); ++fieldIter)
+  for (unsigned int fieldIndex = 0; fieldIndex < this->CustomFrameFields.GetNumberOfFields(); ++fieldIndex)
   {
+    const std::string& fieldName = this->CustomFrameFields.GetFieldNameAt(fieldIndex);
     // Only use requested transforms mechanism if the vector is not empty
-    if (!requestedTransforms.empty() && (IsTransform(fieldIter->first) || IsTransformStatus(fieldIter->first)))
+    if (!requestedTransforms.empty() && (IsTransform(fieldName) || IsTransformStatus(fieldName)))
     {
-      if (IsTransformStatus(fieldIter->first))
+      if (IsTransformStatus(fieldName))
       {
         continue;
       }
-      if (std::find(requestedTransforms.begin(), requestedTransforms.end(), PlusTransformName(fieldIter->first)) == requestedTransforms.end())
+      if (std::find(requestedTransforms.begin(), requestedTransforms.end(), PlusTransformName(fieldName)) == requestedTransforms.end())
       {
         continue;
       }
-      auto statusName = fieldIter->first;
-      statusName = statusName.substr(0, fieldIter->first.length() - TransformPostfix.length());
+      auto statusName = fieldName;
+      statusName = statusName.substr(0, fieldName.length() - TransformPostfix.length());
       statusName = statusName.append(TransformStatusPostfix);
+      const std::string* statusValue = this->CustomFrameFields.GetFieldValue(statusName);
       vtkSmartPointer<vtkXMLDataElement> customField = vtkSmartPointer<vtkXMLDataElement>::New();
       customField->SetName("CustomFrameField");
       customField->SetAttribute("Name", statusName.c_str());
-      customField->SetAttribute("Value", CustomFrameFields[statusName].c_str());
+      customField->SetAttribute("Value", statusValue != NULL ? statusValue->c_str() : "");
       trackedFrame->AddNestedElement(customField);
     }
     vtkSmartPointer<vtkXMLDataElement> customField = vtkSmartPointer<vtkXMLDataElement>::New();
     customField->SetName("CustomFrameField");
-    customField->SetAttribute("Name", fieldIter->first.c_str());
-    customField->SetAttribute("Value", fieldIter->second.c_str());
+    customField->SetAttribute("Name", fieldName.c_str());
+    customField->SetAttribute("Value", this->CustomFrameFields.GetFieldValueAt(fieldIndex).c_str());
     trackedFrame->AddNestedElement(customField);
   }
 
@@ -286,13 +300,27 @@ void PlusTrackedFrame::SetImageData(const PlusVideoFrame& value)
   this->ImageData.GetFrameSize(this->FrameSize);
 }
 
+//----------------------------------------------------------------------------
+void PlusTrackedFrame::ClearImageData()
+{
+  // The image is moved into a temporary frame, which deletes it
+  PlusVideoFrame emptyFrame;
+  this->ImageData.SwapImage(emptyFrame);
+  this->ImageData.SetImageType(emptyFrame.GetImageType());
+  this->ImageData.SetImageOrientation(emptyFrame.GetImageOrientation());
+  this->FrameSize[0] = 0;
+  this->FrameSize[1] = 0;
+  this->FrameSize[2] = 1; // single-slice frame by default
+}
+
 //----------------------------------------------------------------------------
 void PlusTrackedFrame::SetTimestamp(double value)
 {
   this->Timestamp = value;
-  std::ostringstream strTimestamp;
-  strTimestamp << std::setprecision(FLOATING_POINT_PRECISION) << this->Timestamp;
-  this->CustomFrameFields["Timestamp"] = strTimestamp.str();
+  // Format into a local buffer (same output as a stream with setprecision) so that the existing field value can be reused
+  char strTimestamp[64] = {0};
+  int length = snprintf(strTimestamp, sizeof(strTimestamp), "%.*g", FLOATING_POINT_PRECISION, this->Timestamp);
+  this->CustomFrameFields.SetFieldValue(GetTimestampFieldId(), strTimestamp, length);
 }
 
 //----------------------------------------------------------------------------
@@ -338,7 +366,7 @@ void PlusTrackedFrame::SetFiducialPointsCoordinatePx(vtkPoints* fiducialPoints)
 }
 
 //----------------------------------------------------------------------------
-void PlusTrackedFrame::SetCustomFrameField(std::string name, std::string value)
+void PlusTrackedFrame::SetCustomFrameField(const std::string& name, const std::string& value)
 {
   if (STRCASECMP(name.c_str(), "Timestamp") == 0)
   {
@@ -353,7 +381,36 @@ void PlusTrackedFrame::SetCustomFrameField(std::string name, std::string value)
     }
   }
 
-  this->CustomFrameFields[name] = value;
+  this->CustomFrameFields.SetFieldValue(name, value);
+}
+
+//----------------------------------------------------------------------------
+void PlusTrackedFrame::SetCustomFrameFields(const PlusFrameFields& fields)
+{
+  this->CustomFrameFields.SetFieldValues(fields);
+
+  // Keep the timestamp member consistent with the Timestamp field, as in SetCustomFrameField
+  const std::string* timestampValue = fields.GetFieldValue(GetTimestampFieldId());
+  if (timestampValue != NULL)
+  {
+    double timestamp(0);
+    if (PlusCommon::StringToDouble(timestampValue->c_str(), timestamp) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to convert Timestamp '" << *timestampValue << "' to double");
+    }
+    else
+    {
+      this->Timestamp = timestamp;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusTrackedFrame::FieldMapType PlusTrackedFrame::GetCustomFields() const
+{
+  FieldMapType fieldMap;
+  this->CustomFrameFields.GetFieldMap(fieldMap);
+  return fieldMap;
 }
 
 //----------------------------------------------------------------------------
@@ -365,11 +422,10 @@ const char* PlusTrackedFrame::GetCustomFrameField(const char* fieldName)
     return NULL;
   }
 
-  FieldMapType::iterator fieldIterator;
-  fieldIterator = this->CustomFrameFields.find(fieldName);
-  if (fieldIterator != this->CustomFrameFields.end())
+  const std::string* fieldValue = this->CustomFrameFields.GetFieldValue(fieldName);
+  if (fieldValue != NULL)
   {
-    return fieldIterator->second.c_str();
+    return fieldValue->c_str();
   }
   return NULL;
 }
@@ -389,16 +445,21 @@ PlusStatus PlusTrackedFrame::DeleteCustomFrameField(const char* fieldName)
     return PLUS_FAIL;
   }
 
-  FieldMapType::iterator field = this->CustomFrameFields.find(fieldName);
-  if (field != this->CustomFrameFields.end())
+  if (this->CustomFrameFields.RemoveField(fieldName))
   {
-    this->CustomFrameFields.erase(field);
     return PLUS_SUCCESS;
   }
   LOG_DEBUG("Failed to delete custom frame field - could find field " << fieldName);
   return PLUS_FAIL;
 }
 
+//----------------------------------------------------------------------------
+void PlusTrackedFrame::DeleteCustomFrameFieldsExcept(std::vector<PlusFrameFields::FieldId>& keptFieldIds)
+{
+  keptFieldIds.push_back(GetTimestampFieldId());
+  std::sort(keptFieldIds.begin(), keptFieldIds.end());
+  this->CustomFrameFields.RemoveFieldsExcept(keptFieldIds);
+}
 
 //----------------------------------------------------------------------------
 bool PlusTrackedFrame::IsCustomFrameTransformNameDefined(const PlusTransformName& transformName)
@@ -426,9 +487,7 @@ bool PlusTrackedFrame::IsCustomFrameFieldDefined(const char* fieldName)
     return false;
   }
 
-  FieldMapType::iterator fieldIterator;
-  fieldIterator = this->CustomFrameFields.find(fieldName);
-  if (fieldIterator != this->CustomFrameFields.end())
+  if (this->CustomFrameFields.GetFieldValue(fieldName) != NULL)
   {
     // field is found
     return true;
@@ -518,52 +577,87 @@ PlusStatus PlusTrackedFrame::GetCustomFrameTransformStatus(const PlusTransformNa
 PlusStatus PlusTrackedFrame::SetCustomFrameTransformStatus(const PlusTransformName& frameTransformName, TrackedFrameFieldStatus status)
 {
   std::string transformStatusName;
-  if (frameTransformName.GetTransformName(transformStatusName) != PLUS_SUCCESS)
+  if (GetTransformStatusFieldName(frameTransformName, transformStatusName) != PLUS_SUCCESS)
   {
     LOG_ERROR("Unable to set custom transform status, transform name is wrong!");
     return PLUS_FAIL;
   }
 
-  // Append TransformStatus to the end of the transform name
-  if (IsTransform(transformStatusName))
-  {
-    transformStatusName.append("Status");
-  }
-  else if (!IsTransformStatus(transformStatusName))
+  this->SetCustomFrameTransformStatusField(transformStatusName, status);
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusTrackedFrame::SetCustomFrameTransform(const PlusTransformName& frameTransformName, double transform[16])
+{
+  std::string transformName;
+  if (GetTransformFieldName(frameTransformName, transformName) != PLUS_SUCCESS)
   {
-    transformStatusName.append(TransformStatusPostfix);
+    LOG_ERROR("Unable to get custom transform, transform name is wrong!");
+    return PLUS_FAIL;
   }
 
-  std::string strStatus = PlusTrackedFrame::ConvertFieldStatusToString(status);
-
-  this->SetCustomFrameField(transformStatusName, strStatus);
+  this->SetCustomFrameTransformField(transformName, transform);
 
   return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
-PlusStatus PlusTrackedFrame::SetCustomFrameTransform(const PlusTransformName& frameTransformName, double transform[16])
+void PlusTrackedFrame::SetCustomFrameTransformField(const std::string& transformFieldName, const double transform[16])
 {
-  std::ostringstream strTransform;
+  // Each value is written as "%.16g " (at most 24 characters + terminator)
+  char strTransform[16 * 32] = {0};
+  int length = 0;
   for (int i = 0; i < 16; ++i)
   {
-    strTransform << std::setprecision(FLOATING_POINT_PRECISION) << transform[ i ] << " ";
+    length += snprintf(strTransform + length, sizeof(strTransform) - length, "%.*g ", FLOATING_POINT_PRECISION, transform[i]);
   }
+  this->CustomFrameFields.SetFieldValue(PlusFrameFields::GetFieldId(transformFieldName), strTransform, length);
+}
 
-  std::string transformName;
-  if (frameTransformName.GetTransformName(transformName) != PLUS_SUCCESS)
+//----------------------------------------------------------------------------
+void PlusTrackedFrame::SetCustomFrameTransformStatusField(const std::string& transformStatusFieldName, TrackedFrameFieldStatus status)
+{
+  static const std::string okStatus("OK");
+  static const std::string invalidStatus("INVALID");
+  this->CustomFrameFields.SetFieldValue(transformStatusFieldName, (status == FIELD_OK ? okStatus : invalidStatus));
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusTrackedFrame::GetTransformFieldName(const PlusTransformName& frameTransformName, std::string& transformFieldName)
+{
+  if (frameTransformName.GetTransformName(transformFieldName) != PLUS_SUCCESS)
   {
-    LOG_ERROR("Unable to get custom transform, transform name is wrong!");
     return PLUS_FAIL;
   }
 
   // Append Transform to the end of the transform name
-  if (!IsTransform(transformName))
+  if (!IsTransform(transformFieldName))
   {
-    transformName.append(TransformPostfix);
+    transformFieldName.append(TransformPostfix);
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusTrackedFrame::GetTransformStatusFieldName(const PlusTransformName& frameTransformName, std::string& transformStatusFieldName)
+{
+  if (frameTransformName.GetTransformName(transformStatusFieldName) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
   }
 
-  SetCustomFrameField(transformName, strTransform.str());
+  // Append TransformStatus to the end of the transform name
+  if (IsTransform(transformStatusFieldName))
+  {
+    transformStatusFieldName.append("Status");
+  }
+  else if (!IsTransformStatus(transformStatusFieldName))
+  {
+    transformStatusFieldName.append(TransformStatusPostfix);
+  }
 
   return PLUS_SUCCESS;
 }
@@ -661,9 +755,9 @@ PlusStatus PlusTrackedFrame::WriteToFile(const std::string& filename, vtkMatrix4
 void PlusTrackedFrame::GetCustomFrameFieldNameList(std::vector<std::string>& fieldNames)
 {
   fieldNames.clear();
-  for (FieldMapType::const_iterator it = this->CustomFrameFields.begin(); it != this->CustomFrameFields.end(); it++)
+  for (unsigned int fieldIndex = 0; fieldIndex < this->CustomFrameFields.GetNumberOfFields(); ++fieldIndex)
   {
-    fieldNames.push_back(it->first);
+    fieldNames.push_back(this->CustomFrameFields.GetFieldNameAt(fieldIndex));
   }
 }
 
@@ -671,12 +765,13 @@ void PlusTrackedFrame::GetCustomFrameFieldNameList(std::vector<std::string>& fie
 void PlusTrackedFrame::GetCustomFrameTransformNameList(std::vector<PlusTransformName>& transformNames)
 {
   transformNames.clear();
-  for (FieldMapType::const_iterator it = this->CustomFrameFields.begin(); it != this->CustomFrameFields.end(); it++)
+  for (unsigned int fieldIndex = 0; fieldIndex < this->CustomFrameFields.GetNumberOfFields(); ++fieldIndex)
   {
-    if (IsTransform(it->first))
+    const std::string& fieldName = this->CustomFrameFields.GetFieldNameAt(fieldIndex);
+    if (IsTransform(fieldName))
     {
       PlusTransformName trName;
-      trName.SetTransformName(it->first.substr(0, it->first.length() - TransformPostfix.length()).c_str());
+      trName.SetTransformName(fieldName.substr(0, fieldName.length() - TransformPostfix.length()).c_str());
       transformNames.push_back(trName);
     }
   }
@@ -9,6 +9,7 @@
 
 #include "vtkPlusCommonExport.h"
 
+#include "PlusFrameFields.h"
 #include "PlusVideoFrame.h"
 
 class vtkMatrix4x4;
@@ -55,14 +56,17 @@ public:
   /*! Get image data */
   PlusVideoFrame* GetImageData() { return &(this->ImageData); };
 
+  /*! Remove the image data (the frame will not contain a valid image, as a newly constructed frame) */
+  void ClearImageData();
+
   /*! Set timestamp */
   void SetTimestamp(double value);
 
   /*! Get timestamp */
   double GetTimestamp() { return this->Timestamp; };
 
-  /*! Set custom frame field */
-  void SetCustomFrameField(std::string name, std::string value);
+  /*! Set custom frame field. If the field already exists then its value is overwritten in place (no reallocation if the new value fits in the existing storage). */
+  void SetCustomFrameField(const std::string& name, const std::string& value);
 
   /*! Get custom frame field value */
   const char* GetCustomFrameField(const char* fieldName);
@@ -71,6 +75,13 @@ public:
   /*! Delete custom frame field */
   PlusStatus DeleteCustomFrameField(const char* fieldName);
 
+  /*!
+    Delete all custom frame fields except the Timestamp field and the listed fields (the list is sorted in place).
+    Used when a frame is refilled: the fields that were not set from the new data are removed, while the storage
+    of the fields that were set is reused.
+  */
+  void DeleteCustomFrameFieldsExcept(std::vector<PlusFrameFields::FieldId>& keptFieldIds);
+
   /*!
     Check if a custom frame field is defined or not
     \return true, if the field is defined; false, if the field is not defined
@@ -99,6 +110,22 @@ public:
   /*! Set custom frame transform */
   PlusStatus SetCustomFrameTransform(const PlusTransformName& frameTransformName, vtkMatrix4x4* transform);
 
+  /*!
+    Set custom frame transform by the name of the field that stores it (see GetTransformFieldName).
+    Intended for callers that update the same transform repeatedly: the field name is not recomputed
+    and the existing field value is overwritten without reallocation.
+  */
+  void SetCustomFrameTransformField(const std::string& transformFieldName, const double transform[16]);
+
+  /*! Set custom frame transform status by the name of the field that stores it (see GetTransformStatusFieldName) */
+  void SetCustomFrameTransformStatusField(const std::string& transformStatusFieldName, TrackedFrameFieldStatus status);
+
+  /*! Get the name of the custom frame field that stores the transform (e.g., ProbeToTrackerTransform) */
+  static PlusStatus GetTransformFieldName(const PlusTransformName& frameTransformName, std::string& transformFieldName);
+
+  /*! Get the name of the custom frame field that stores the transform status (e.g., ProbeToTrackerTransformStatus) */
+  static PlusStatus GetTransformStatusFieldName(const PlusTransformName& frameTransformName, std::string& transformStatusFieldName);
+
   /*! Get the list of the name of all custom frame fields */
   void GetCustomFrameFieldNameList(std::vector<std::string>& fieldNames);
 
@@ -148,8 +175,17 @@ public:
   /*! Convert from field status enum to field status string */
   static std::string ConvertFieldStatusToString(TrackedFrameFieldStatus status);
 
-  /*! Return all custom fields in a map */
-  const FieldMapType& GetCustomFields() { return this->CustomFrameFields; }
+  /*! Return all custom fields in a map. Prefer GetCustomFrameFields, which does not copy the fields. */
+  FieldMapType GetCustomFields() const;
+
+  /*! Get all custom fields */
+  const PlusFrameFields& GetCustomFrameFields() const { return this->CustomFrameFields; }
+
+  /*!
+    Set the value of all custom fields of the input container (other existing fields are kept).
+    If the frame has no custom fields yet then the fields are shared with the input container until either of them is modified.
+  */
+  void SetCustomFrameFields(const PlusFrameFields& fields);
 
   /*! Returns true if the input string ends with "Transform", else false */
   static bool IsTransform(std::string str);
@@ -168,7 +204,7 @@ protected:
   PlusVideoFrame ImageData;
   double Timestamp;
 
-  FieldMapType CustomFrameFields;
+  PlusFrameFields CustomFrameFields;
 
   unsigned int FrameSize[3];
 
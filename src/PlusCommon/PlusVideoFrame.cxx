@@ -6,6 +6,7 @@ See License.txt for details.
 
 #include "PlusConfigure.h"
 #include "PlusVideoFrame.h"
+#include "PlusVideoFrameKernels.h"
 #include "itkImageBase.h"
 #include "vtkBMPReader.h"
 #include "vtkExtractVOI.h"
@@ -28,6 +29,8 @@ See License.txt for details.
 
 namespace
 {
+  bool OptimizedFlipClipEnabled = true;
+
   //----------------------------------------------------------------------------
   template<class ScalarType>
   PlusStatus FlipClipImageGeneric(vtkImageData* inputImage, const PlusVideoFrame::FlipInfoType& flipInfo, const int clipRectangleOrigin[3], const int clipRectangleSize[3], vtkImageData* outputImage)
@@ -334,6 +337,115 @@ namespace
 
     return PLUS_SUCCESS;
   }
+
+  //----------------------------------------------------------------------------
+  template<int BytesPerPixel>
+  void TransposeKijToIjk(const unsigned char* inputPixel, vtkIdType inputRowIncrementBytes, vtkIdType inputImageIncrementBytes, vtkImageData* outputImage)
+  {
+    int outputDims[3] = {0, 0, 0};
+    outputImage->GetDimensions(outputDims);
+    vtkIdType pixelIncrement(0);
+    vtkIdType outputRowIncrement(0);
+    vtkIdType outputImageIncrement(0);
+    outputImage->GetIncrements(pixelIncrement, outputRowIncrement, outputImageIncrement);
+    const int bytesPerScalar = BytesPerPixel / pixelIncrement;
+    // Input columns become output rows, input rows become output slices, input slices become output columns
+    PlusVideoFrameKernels::TransposeKijToIjk<BytesPerPixel>(inputPixel, inputRowIncrementBytes, inputImageIncrementBytes,
+        static_cast<unsigned char*>(outputImage->GetScalarPointer()), outputRowIncrement * bytesPerScalar, outputImageIncrement * bytesPerScalar,
+        outputDims[1], outputDims[2], outputDims[0]);
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+    Flip/transpose using the specialized kernels.
+    Returns false if the requested operation is not supported by the specialized kernels (then the generic implementation must be used).
+  */
+  bool FlipClipImageOptimized(vtkImageData* inputImage, const PlusVideoFrame::FlipInfoType& flipInfo, const int clipRectangleOrigin[3], vtkImageData* outputImage)
+  {
+    if (flipInfo.doubleColumn || flipInfo.doubleRow || flipInfo.eFlip)
+    {
+      return false;
+    }
+
+    const int bytesPerPixel = PlusVideoFrame::GetNumberOfBytesPerScalar(inputImage->GetScalarType()) * inputImage->GetNumberOfScalarComponents();
+    vtkIdType pixelIncrement(0);
+    vtkIdType inputRowIncrement(0);
+    vtkIdType inputImageIncrement(0);
+    inputImage->GetIncrements(pixelIncrement, inputRowIncrement, inputImageIncrement);
+    const int bytesPerScalar = bytesPerPixel / pixelIncrement;
+    const vtkIdType inputRowIncrementBytes = inputRowIncrement * bytesPerScalar;
+    const vtkIdType inputImageIncrementBytes = inputImageIncrement * bytesPerScalar;
+    const unsigned char* inputStart = static_cast<unsigned char*>(inputImage->GetScalarPointer())
+                                      + clipRectangleOrigin[2] * inputImageIncrementBytes + clipRectangleOrigin[1] * inputRowIncrementBytes + clipRectangleOrigin[0] * bytesPerPixel;
+
+    if (flipInfo.hFlip && flipInfo.tranpose == PlusVideoFrame::TRANSPOSE_NONE)
+    {
+      // flip X, or flip X and Y: reverse the pixel order in each row (and the row order for flip Y)
+      if (!PlusVideoFrameKernels::IsReverseRowSupported(bytesPerPixel))
+      {
+        return false;
+      }
+      int outputDims[3] = {0, 0, 0};
+      outputImage->GetDimensions(outputDims);
+      vtkIdType outputRowIncrement(0);
+      vtkIdType outputImageIncrement(0);
+      outputImage->GetIncrements(pixelIncrement, outputRowIncrement, outputImageIncrement);
+      const vtkIdType outputRowIncrementBytes = outputRowIncrement * bytesPerScalar;
+      const vtkIdType outputImageIncrementBytes = outputImageIncrement * bytesPerScalar;
+      unsigned char* outputStart = static_cast<unsigned char*>(outputImage->GetScalarPointer());
+      for (int z = 0; z < outputDims[2]; z++)
+      {
+        const unsigned char* inputRow = inputStart + z * inputImageIncrementBytes;
+        for (int y = 0; y < outputDims[1]; y++)
+        {
+          int outputRowIndex = flipInfo.vFlip ? (outputDims[1] - 1 - y) : y;
+          unsigned char* outputRow = outputStart + z * outputImageIncrementBytes + outputRowIndex * outputRowIncrementBytes;
+          PlusVideoFrameKernels::ReverseRow(inputRow, outputRow, outputDims[0], bytesPerPixel);
+          inputRow += inputRowIncrementBytes;
+        }
+      }
+      return true;
+    }
+
+    if (!flipInfo.hFlip && !flipInfo.vFlip && flipInfo.tranpose == PlusVideoFrame::TRANSPOSE_IJKtoKIJ)
+    {
+      switch (bytesPerPixel)
+      {
+        case 1:
+          TransposeKijToIjk<1>(inputStart, inputRowIncrementBytes, inputImageIncrementBytes, outputImage);
+          return true;
+        case 2:
+          TransposeKijToIjk<2>(inputStart, inputRowIncrementBytes, inputImageIncrementBytes, outputImage);
+          return true;
+        case 3:
+          TransposeKijToIjk<3>(inputStart, inputRowIncrementBytes, inputImageIncrementBytes, outputImage);
+          return true;
+        case 4:
+          TransposeKijToIjk<4>(inputStart, inputRowIncrementBytes, inputImageIncrementBytes, outputImage);
+          return true;
+        case 8:
+          TransposeKijToIjk<8>(inputStart, inputRowIncrementBytes, inputImageIncrementBytes, outputImage);
+          return true;
+        default:
+          return false;
+      }
+    }
+
+    // flip Y only is already copied row-by-row with memcpy in the generic implementation
+    return false;
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusVideoFrame::SetOptimizedFlipClipEnabled(bool enabled)
+{
+  OptimizedFlipClipEnabled = enabled;
+}
+
+//----------------------------------------------------------------------------
+bool PlusVideoFrame::GetOptimizedFlipClipEnabled()
+{
+  return OptimizedFlipClipEnabled;
 }
 
 //----------------------------------------------------------------------------
@@ -1242,6 +1354,11 @@ PlusStatus PlusVideoFrame::FlipClipImage(vtkImageData* inUsImage,
     outUsOrientedImage->AllocateScalars(inUsImage->GetScalarType(), inUsImage->GetNumberOfScalarComponents());
   }
 
+  if (OptimizedFlipClipEnabled && FlipClipImageOptimized(inUsImage, flipInfo, finalClipOrigin, outUsOrientedImage))
+  {
+    return PLUS_SUCCESS;
+  }
+
   int numberOfBytesPerScalar = PlusVideoFrame::GetNumberOfBytesPerScalar(inUsImage->GetScalarType());
 
   PlusStatus status(PLUS_FAIL);
@@ -1444,6 +1561,12 @@ vtkImageData* PlusVideoFrame::GetImage() const
   return this->Image;
 }
 
+//----------------------------------------------------------------------------
+void PlusVideoFrame::SwapImage(PlusVideoFrame& otherFrame)
+{
+  std::swap(this->Image, otherFrame.Image);
+}
+
 //----------------------------------------------------------------------------
 void PlusVideoFrame::SetImageData(vtkImageData* imageData)
 {
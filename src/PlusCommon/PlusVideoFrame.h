@@ -182,6 +182,12 @@ public:
   /*! Sets the pixel buffer content by copying pixel data from a vtkImageData object.*/
   PlusStatus ShallowCopyFrom(vtkImageData* frame);
 
+  /*!
+    Exchange the pixel buffers (vtkImageData objects) of this frame and the other frame, without copying any pixel data.
+    Image type and orientation are not exchanged.
+  */
+  void SwapImage(PlusVideoFrame& otherFrame);
+
   /*! Get US_IMAGE_ORIENTATION enum value from string */
   static US_IMAGE_ORIENTATION GetUsImageOrientationFromString(const char* imgOrientationStr);
   static US_IMAGE_ORIENTATION GetUsImageOrientationFromString(const std::string& imgOrientationStr);
@@ -293,6 +299,14 @@ public:
                                   const int clipRectangleSize[3],
                                   vtkImageData* outUsOrientedImage);
 
+  /*!
+  Enable or disable the specialized flip and transpose kernels in FlipClipImage (enabled by default).
+  When disabled, the generic per-component implementation is used for all cases. Intended for testing and benchmarking.
+  */
+  static void SetOptimizedFlipClipEnabled(bool enabled);
+  /*! Returns true if the specialized flip and transpose kernels are used in FlipClipImage */
+  static bool GetOptimizedFlipClipEnabled();
+
   /*! Return true if the image data is valid (e.g. not NULL) */
   bool IsImageValid() const
   {
@@ -0,0 +1,244 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusVideoFrameKernels_h
+#define __PlusVideoFrameKernels_h
+
+#include <string.h>
+
+// SSE2 is available on all x64 processors, SSSE3 (byte shuffle) is used only if the compiler is allowed to generate it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define PLUS_VIDEOFRAME_KERNELS_SSE2
+  #include <emmintrin.h>
+#endif
+#if defined(PLUS_VIDEOFRAME_KERNELS_SSE2) && (defined(__SSSE3__) || defined(__AVX__))
+  #define PLUS_VIDEOFRAME_KERNELS_SSSE3
+  #include <tmmintrin.h>
+#endif
+
+/*!
+\class PlusVideoFrameKernels
+\brief Specialized pixel copy kernels for the most common image flip and transpose operations
+
+The generic flip/clip implementation in PlusVideoFrame copies each scalar component one by one.
+These kernels operate on whole pixels of a fixed size (1, 2, 3, or 4 bytes), use SIMD shuffles
+for reversing pixel order in a row, and a cache-blocked loop for KIJ to IJK transposition.
+
+\ingroup PlusLibCommon
+*/
+class PlusVideoFrameKernels
+{
+public:
+  /*!
+    Returns true if ReverseRow has a specialized implementation for the given pixel size
+    (number of scalar components multiplied by the number of bytes per scalar).
+  */
+  static bool IsReverseRowSupported(int bytesPerPixel)
+  {
+    return bytesPerPixel >= 1 && bytesPerPixel <= 4;
+  }
+
+  /*!
+    Copy a row of pixels with reversed pixel order: output[x] = input[numberOfPixels-1-x].
+    Input and output must not overlap. Only pixel sizes accepted by IsReverseRowSupported can be used.
+  */
+  static inline void ReverseRow(const unsigned char* input, unsigned char* output, int numberOfPixels, int bytesPerPixel)
+  {
+    switch (bytesPerPixel)
+    {
+      case 1:
+        ReverseRow1(input, output, numberOfPixels);
+        break;
+      case 2:
+        ReverseRow2(input, output, numberOfPixels);
+        break;
+      case 3:
+        ReverseRow3(input, output, numberOfPixels);
+        break;
+      case 4:
+        ReverseRow4(input, output, numberOfPixels);
+        break;
+      default:
+        ReverseRowScalar(input, output, numberOfPixels, bytesPerPixel);
+    }
+  }
+
+  /*!
+    Transpose a block of images from KIJ to IJK layout.
+    The input consists of numberOfInputSlices images, each with numberOfInputRows rows of numberOfInputColumns pixels.
+    Input pixel (column i, row j, slice k) is copied to output pixel (column k, row i, slice j).
+    Increments are in bytes. The loop is processed in tiles so that both the input and output rows stay in cache.
+  */
+  template<int BytesPerPixel>
+  static void TransposeKijToIjk(const unsigned char* input, long long inputRowIncrement, long long inputSliceIncrement,
+                                unsigned char* output, long long outputRowIncrement, long long outputSliceIncrement,
+                                int numberOfInputColumns, int numberOfInputRows, int numberOfInputSlices)
+  {
+    // Tile size is chosen so that a tile of input and output (32x32 pixels of up to 8 bytes) fits into L1 cache
+    const int TILE_SIZE = 32;
+    for (int j = 0; j < numberOfInputRows; ++j)
+    {
+      const unsigned char* inputRow = input + j * inputRowIncrement;
+      unsigned char* outputSlice = output + j * outputSliceIncrement;
+      for (int kTile = 0; kTile < numberOfInputSlices; kTile += TILE_SIZE)
+      {
+        const int kEnd = (kTile + TILE_SIZE < numberOfInputSlices) ? kTile + TILE_SIZE : numberOfInputSlices;
+        for (int iTile = 0; iTile < numberOfInputColumns; iTile += TILE_SIZE)
+        {
+          const int iEnd = (iTile + TILE_SIZE < numberOfInputColumns) ? iTile + TILE_SIZE : numberOfInputColumns;
+          for (int i = iTile; i < iEnd; ++i)
+          {
+            unsigned char* outputPixel = outputSlice + i * outputRowIncrement + kTile * BytesPerPixel;
+            const unsigned char* inputPixel = inputRow + kTile * inputSliceIncrement + i * BytesPerPixel;
+            for (int k = kTile; k < kEnd; ++k)
+            {
+              memcpy(outputPixel, inputPixel, BytesPerPixel);
+              outputPixel += BytesPerPixel;
+              inputPixel += inputSliceIncrement;
+            }
+          }
+        }
+      }
+    }
+  }
+
+protected:
+  //----------------------------------------------------------------------------
+  static inline void ReverseRowScalar(const unsigned char* input, unsigned char* output, int numberOfPixels, int bytesPerPixel)
+  {
+    const unsigned char* inputPixel = input + (numberOfPixels - 1) * bytesPerPixel;
+    for (int x = 0; x < numberOfPixels; ++x)
+    {
+      memcpy(output, inputPixel, bytesPerPixel);
+      output += bytesPerPixel;
+      inputPixel -= bytesPerPixel;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  static inline void ReverseRow1(const unsigned char* input, unsigned char* output, int numberOfPixels)
+  {
+    int x = 0;
+#if defined(PLUS_VIDEOFRAME_KERNELS_SSSE3)
+    const __m128i reverseMask = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    for (; x + 16 <= numberOfPixels; x += 16)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + numberOfPixels - 16 - x));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(output + x), _mm_shuffle_epi8(v, reverseMask));
+    }
+#elif defined(PLUS_VIDEOFRAME_KERNELS_SSE2)
+    for (; x + 16 <= numberOfPixels; x += 16)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + numberOfPixels - 16 - x));
+      // swap bytes within 16-bit words, then reverse the order of the words
+      v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+      v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+      v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+      v = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(output + x), v);
+    }
+#endif
+    for (; x < numberOfPixels; ++x)
+    {
+      output[x] = input[numberOfPixels - 1 - x];
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  static inline void ReverseRow2(const unsigned char* input, unsigned char* output, int numberOfPixels)
+  {
+    int x = 0;
+#if defined(PLUS_VIDEOFRAME_KERNELS_SSE2)
+    for (; x + 8 <= numberOfPixels; x += 8)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + (numberOfPixels - 8 - x) * 2));
+      v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+      v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+      v = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(output + x * 2), v);
+    }
+#endif
+    ReverseRowScalar(input, output + x * 2, numberOfPixels - x, 2);
+  }
+
+  //----------------------------------------------------------------------------
+  static inline void ReverseRow3(const unsigned char* input, unsigned char* output, int numberOfPixels)
+  {
+    int x = 0;
+#if defined(PLUS_VIDEOFRAME_KERNELS_SSSE3)
+    // 16 pixels (48 bytes, 3 vectors) are reversed at once. Each output vector is assembled from
+    // byte shuffles of the three input vectors; mask value -128 (0x80) clears the byte.
+    static const signed char masks[3][3][16] =
+    {
+      {
+        { -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128 },
+        { -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 14 },
+        { 13, 14, 15, 10, 11, 12, 7, 8, 9, 4, 5, 6, 1, 2, 3, -128 }
+      },
+      {
+        { -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 15, -128 },
+        { 15, -128, 11, 12, 13, 8, 9, 10, 5, 6, 7, 2, 3, 4, -128, 0 },
+        { -128, 0, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128 }
+      },
+      {
+        { -128, 12, 13, 14, 9, 10, 11, 6, 7, 8, 3, 4, 5, 0, 1, 2 },
+        { 1, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128 },
+        { -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128 }
+      }
+    };
+    __m128i m[3][3];
+    for (int outputVectorIndex = 0; outputVectorIndex < 3; ++outputVectorIndex)
+    {
+      for (int inputVectorIndex = 0; inputVectorIndex < 3; ++inputVectorIndex)
+      {
+        m[outputVectorIndex][inputVectorIndex] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks[outputVectorIndex][inputVectorIndex]));
+      }
+    }
+    for (; x + 16 <= numberOfPixels; x += 16)
+    {
+      const unsigned char* inputBlock = input + (numberOfPixels - 16 - x) * 3;
+      __m128i in0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputBlock));
+      __m128i in1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputBlock + 16));
+      __m128i in2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputBlock + 32));
+      unsigned char* outputBlock = output + x * 3;
+      for (int outputVectorIndex = 0; outputVectorIndex < 3; ++outputVectorIndex)
+      {
+        __m128i out = _mm_or_si128(_mm_or_si128(
+                                     _mm_shuffle_epi8(in0, m[outputVectorIndex][0]),
+                                     _mm_shuffle_epi8(in1, m[outputVectorIndex][1])),
+                                   _mm_shuffle_epi8(in2, m[outputVectorIndex][2]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(outputBlock + outputVectorIndex * 16), out);
+      }
+    }
+#endif
+    const unsigned char* inputPixel = input + (numberOfPixels - 1 - x) * 3;
+    unsigned char* outputPixel = output + x * 3;
+    for (; x < numberOfPixels; ++x)
+    {
+      outputPixel[0] = inputPixel[0];
+      outputPixel[1] = inputPixel[1];
+      outputPixel[2] = inputPixel[2];
+      outputPixel += 3;
+      inputPixel -= 3;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  static inline void ReverseRow4(const unsigned char* input, unsigned char* output, int numberOfPixels)
+  {
+    int x = 0;
+#if defined(PLUS_VIDEOFRAME_KERNELS_SSE2)
+    for (; x + 4 <= numberOfPixels; x += 4)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + (numberOfPixels - 4 - x) * 4));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(output + x * 4), _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3)));
+    }
+#endif
+    ReverseRowScalar(input, output + x * 4, numberOfPixels - x, 4);
+  }
+};
+
+#endif
@@ -0,0 +1,248 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Verify that the SIMD pixel format conversions of PixelCodec produce exactly the same output
+// as the scalar implementation, and measure the throughput of both on a full HD frame.
+
+#include "PlusConfigure.h"
+#include "PixelCodec.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <iomanip>
+#include <string.h>
+#include <vector>
+
+namespace
+{
+  enum ConversionType
+  {
+    CONVERSION_YUY2_TO_RGB24,
+    CONVERSION_YUY2_TO_BGR24,
+    CONVERSION_YUY2_TO_GRAY,
+    CONVERSION_BGR24_TO_RGB24,
+    CONVERSION_RGB24_TO_GRAY
+  };
+
+  //----------------------------------------------------------------------------
+  const char* GetConversionName(ConversionType conversion)
+  {
+    switch (conversion)
+    {
+      case CONVERSION_YUY2_TO_RGB24:
+        return "YUY2->RGB24";
+      case CONVERSION_YUY2_TO_BGR24:
+        return "YUY2->BGR24";
+      case CONVERSION_YUY2_TO_GRAY:
+        return "YUY2->Gray";
+      case CONVERSION_BGR24_TO_RGB24:
+        return "BGR24->RGB24";
+      case CONVERSION_RGB24_TO_GRAY:
+        return "RGB24->Gray";
+    }
+    return "Unknown";
+  }
+
+  //----------------------------------------------------------------------------
+  int GetInputBytesPerPixel(ConversionType conversion)
+  {
+    return (conversion == CONVERSION_BGR24_TO_RGB24 || conversion == CONVERSION_RGB24_TO_GRAY) ? 3 : 2;
+  }
+
+  //----------------------------------------------------------------------------
+  int GetOutputBytesPerPixel(ConversionType conversion)
+  {
+    return (conversion == CONVERSION_YUY2_TO_GRAY || conversion == CONVERSION_RGB24_TO_GRAY) ? 1 : 3;
+  }
+
+  //----------------------------------------------------------------------------
+  void Convert(ConversionType conversion, bool optimized, int width, int height, unsigned char* s, unsigned char* d)
+  {
+    switch (conversion)
+    {
+      case CONVERSION_YUY2_TO_RGB24:
+        optimized ? PixelCodec::Yuv422pToBmp24(PixelCodec::ComponentOrder_RGB, width, height, s, d)
+        : PixelCodec::Yuv422pToBmp24Scalar(PixelCodec::ComponentOrder_RGB, width, height, s, d);
+        break;
+      case CONVERSION_YUY2_TO_BGR24:
+        optimized ? PixelCodec::Yuv422pToBmp24(PixelCodec::ComponentOrder_BGR, width, height, s, d)
+        : PixelCodec::Yuv422pToBmp24Scalar(PixelCodec::ComponentOrder_BGR, width, height, s, d);
+        break;
+      case CONVERSION_YUY2_TO_GRAY:
+        optimized ? PixelCodec::Yuv422pToGray(width, height, s, d) : PixelCodec::Yuv422pToGrayScalar(width, height, s, d);
+        break;
+      case CONVERSION_BGR24_TO_RGB24:
+        optimized ? PixelCodec::RgbBgrSwap(width, height, s, d) : PixelCodec::RgbBgrSwapScalar(width, height, s, d);
+        break;
+      case CONVERSION_RGB24_TO_GRAY:
+        optimized ? PixelCodec::Rgb24ToGray(width, height, s, d) : PixelCodec::Rgb24ToGrayScalar(width, height, s, d);
+        break;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  int CompareConversion(ConversionType conversion, int width, int height, std::vector<unsigned char>& input, const std::string& description)
+  {
+    // YUY2 images are processed by macropixels (pixel pairs), the last pixel is not written if the number of pixels is odd
+    int numberOfConvertedPixels = (GetInputBytesPerPixel(conversion) == 2) ? height * (width / 2) * 2 : width * height;
+    int numberOfOutputBytes = numberOfConvertedPixels * GetOutputBytesPerPixel(conversion);
+    // Fill the output buffers with different values to detect pixels that are not written
+    std::vector<unsigned char> scalarOutput(width * height * GetOutputBytesPerPixel(conversion), 0);
+    std::vector<unsigned char> optimizedOutput(scalarOutput.size(), 0xff);
+    Convert(conversion, false, width, height, &input[0], &scalarOutput[0]);
+    Convert(conversion, true, width, height, &input[0], &optimizedOutput[0]);
+    if (numberOfOutputBytes > 0 && memcmp(&scalarOutput[0], &optimizedOutput[0], numberOfOutputBytes) != 0)
+    {
+      LOG_ERROR(GetConversionName(conversion) << " output mismatch between scalar and optimized implementation (" << description << ")");
+      return 1;
+    }
+    return 0;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Convert all possible YUV values (each Y for all U, V combinations) */
+  int TestYuy2AllValues(ConversionType conversion)
+  {
+    // One row contains all V and Y values for a fixed U
+    const int width = 256 * 256;
+    std::vector<unsigned char> input(width * 2);
+    int numberOfErrors = 0;
+    for (int u = 0; u < 256; ++u)
+    {
+      unsigned char* macroPixel = &input[0];
+      for (int v = 0; v < 256; ++v)
+      {
+        for (int y = 0; y < 256; y += 2)
+        {
+          macroPixel[0] = y;
+          macroPixel[1] = u;
+          macroPixel[2] = y + 1;
+          macroPixel[3] = v;
+          macroPixel += 4;
+        }
+      }
+      std::ostringstream description;
+      description << "U=" << u;
+      numberOfErrors += CompareConversion(conversion, width, 1, input, description.str());
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Convert random images of various sizes (to exercise the scalar processing of the remaining pixels) */
+  int TestRandomImages(ConversionType conversion)
+  {
+    const int widths[] = { 1, 2, 5, 15, 16, 17, 33, 639, 640, 641 };
+    const int height = 3;
+    int numberOfErrors = 0;
+    for (unsigned int widthIndex = 0; widthIndex < sizeof(widths) / sizeof(widths[0]); ++widthIndex)
+    {
+      std::vector<unsigned char> input(widths[widthIndex] * height * GetInputBytesPerPixel(conversion));
+      for (unsigned int i = 0; i < input.size(); ++i)
+      {
+        input[i] = static_cast<unsigned char>(rand());
+      }
+      std::ostringstream description;
+      description << "size: " << widths[widthIndex] << "x" << height;
+      numberOfErrors += CompareConversion(conversion, widths[widthIndex], height, input, description.str());
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  void MeasureThroughput(ConversionType conversion, int numberOfIterations)
+  {
+    const int width = 1920;
+    const int height = 1080;
+    std::vector<unsigned char> input(width * height * GetInputBytesPerPixel(conversion));
+    for (unsigned int i = 0; i < input.size(); ++i)
+    {
+      input[i] = static_cast<unsigned char>(rand());
+    }
+    std::vector<unsigned char> output(width * height * GetOutputBytesPerPixel(conversion));
+
+    double averageTimeSec[2] = { 0, 0 };
+    for (int optimized = 0; optimized < 2; ++optimized)
+    {
+      double startTime = vtkPlusAccurateTimer::GetSystemTime();
+      for (int i = 0; i < numberOfIterations; ++i)
+      {
+        Convert(conversion, optimized != 0, width, height, &input[0], &output[0]);
+      }
+      averageTimeSec[optimized] = (vtkPlusAccurateTimer::GetSystemTime() - startTime) / numberOfIterations;
+    }
+
+    const double megaPixels = width * height / 1e6;
+    LOG_INFO(GetConversionName(conversion) << " " << width << "x" << height
+             << ": scalar " << std::fixed << std::setprecision(3) << averageTimeSec[0] * 1000 << " ms"
+             << " (" << std::setprecision(1) << (averageTimeSec[0] > 0 ? megaPixels / averageTimeSec[0] : 0) << " MPixel/s)"
+             << ", optimized " << std::setprecision(3) << averageTimeSec[1] * 1000 << " ms"
+             << " (" << std::setprecision(1) << (averageTimeSec[1] > 0 ? megaPixels / averageTimeSec[1] : 0) << " MPixel/s)");
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfIterations = 1;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--iterations", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfIterations, "Number of conversions of a full HD frame for measuring the throughput (default: 1)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfIterations < 1)
+  {
+    numberOfIterations = 1;
+  }
+
+  const ConversionType conversions[] =
+  {
+    CONVERSION_YUY2_TO_RGB24,
+    CONVERSION_YUY2_TO_BGR24,
+    CONVERSION_YUY2_TO_GRAY,
+    CONVERSION_BGR24_TO_RGB24,
+    CONVERSION_RGB24_TO_GRAY
+  };
+
+  int numberOfErrors = 0;
+  for (unsigned int i = 0; i < sizeof(conversions) / sizeof(conversions[0]); ++i)
+  {
+    if (GetInputBytesPerPixel(conversions[i]) == 2)
+    {
+      numberOfErrors += TestYuy2AllValues(conversions[i]);
+    }
+    numberOfErrors += TestRandomImages(conversions[i]);
+    MeasureThroughput(conversions[i], numberOfIterations);
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,206 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Verify that PlusFrameFields behaves the same way as a std::map of field names and values
+// (ordering, set, get, remove) and that copies share the fields until they are modified.
+
+#include "PlusConfigure.h"
+#include "PlusFrameFields.h"
+#include "PlusTrackedFrame.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  PlusStatus CheckEqualToMap(const std::string& testName, const PlusFrameFields& fields, const PlusFrameFields::FieldMapType& expectedFields)
+  {
+    PlusFrameFields::FieldMapType actualFields;
+    fields.GetFieldMap(actualFields);
+    if (actualFields != expectedFields || fields.GetNumberOfFields() != expectedFields.size())
+    {
+      LOG_ERROR(testName << ": fields do not match the expected fields");
+      return PLUS_FAIL;
+    }
+    // Fields must be in the same order as in the map
+    unsigned int fieldIndex = 0;
+    for (PlusFrameFields::FieldMapType::const_iterator it = expectedFields.begin(); it != expectedFields.end(); ++it, ++fieldIndex)
+    {
+      if (fields.GetFieldNameAt(fieldIndex) != it->first || fields.GetFieldValueAt(fieldIndex) != it->second)
+      {
+        LOG_ERROR(testName << ": field " << fieldIndex << " mismatch: expected " << it->first << "=" << it->second
+                  << ", actual " << fields.GetFieldNameAt(fieldIndex) << "=" << fields.GetFieldValueAt(fieldIndex));
+        return PLUS_FAIL;
+      }
+      const std::string* value = fields.GetFieldValue(it->first);
+      if (value == NULL || *value != it->second)
+      {
+        LOG_ERROR(testName << ": unable to get value of field " << it->first);
+        return PLUS_FAIL;
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus TestMapCompatibility()
+  {
+    PlusStatus status = PLUS_SUCCESS;
+
+    PlusFrameFields fields;
+    PlusFrameFields::FieldMapType expectedFields;
+    const char* names[] = { "ProbeToTrackerTransform", "DepthMm", "Timestamp", "ProbeToTrackerTransformStatus", "ButtonState", "FrameNumber" };
+    for (unsigned int i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+    {
+      std::ostringstream value;
+      value << "Value" << i;
+      fields.SetFieldValue(names[i], value.str());
+      expectedFields[names[i]] = value.str();
+    }
+    if (CheckEqualToMap("Set", fields, expectedFields) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+
+    // Overwrite an existing field, both by name and by identifier
+    fields.SetFieldValue("DepthMm", "60");
+    expectedFields["DepthMm"] = "60";
+    fields.SetFieldValue(PlusFrameFields::GetFieldId("ButtonState"), "Pressed");
+    expectedFields["ButtonState"] = "Pressed";
+    if (CheckEqualToMap("Overwrite", fields, expectedFields) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+
+    if (!fields.RemoveField("Timestamp") || fields.RemoveField("Timestamp") || fields.RemoveField("NeverUsedFieldName"))
+    {
+      LOG_ERROR("Unexpected result of removing fields");
+      status = PLUS_FAIL;
+    }
+    expectedFields.erase("Timestamp");
+    if (CheckEqualToMap("Remove", fields, expectedFields) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+
+    PlusFrameFields::FieldId fieldId(0);
+    if (fields.GetFieldValue("NeverUsedFieldName") != NULL || PlusFrameFields::FindFieldId("NeverUsedFieldName", fieldId))
+    {
+      LOG_ERROR("Looking up an undefined field registered its name");
+      status = PLUS_FAIL;
+    }
+    if (PlusFrameFields::GetFieldName(PlusFrameFields::GetFieldId("DepthMm")) != "DepthMm")
+    {
+      LOG_ERROR("Field name of a registered identifier does not match");
+      status = PLUS_FAIL;
+    }
+
+    fields.Clear();
+    expectedFields.clear();
+    if (!fields.IsEmpty() || CheckEqualToMap("Clear", fields, expectedFields) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+
+    return status;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus TestCopyOnWrite()
+  {
+    PlusStatus status = PLUS_SUCCESS;
+
+    PlusFrameFields original;
+    original.SetFieldValue("DepthMm", "50");
+    original.SetFieldValue("ProbeToTrackerTransformStatus", "OK");
+
+    PlusFrameFields copy(original);
+    if (copy != original || copy.GetFieldValue("DepthMm") != original.GetFieldValue("DepthMm"))
+    {
+      LOG_ERROR("Copied fields are not shared with the original");
+      status = PLUS_FAIL;
+    }
+
+    copy.SetFieldValue("DepthMm", "60");
+    if (*original.GetFieldValue("DepthMm") != "50" || *copy.GetFieldValue("DepthMm") != "60" || copy == original)
+    {
+      LOG_ERROR("Modifying a copy changed the original fields");
+      status = PLUS_FAIL;
+    }
+
+    // Merging into an empty container shares, merging into a non-empty one keeps the existing fields
+    PlusFrameFields merged;
+    merged.SetFieldValues(original);
+    merged.SetFieldValue("FrameNumber", "3");
+    merged.SetFieldValues(copy);
+    PlusFrameFields::FieldMapType expectedFields;
+    expectedFields["DepthMm"] = "60";
+    expectedFields["FrameNumber"] = "3";
+    expectedFields["ProbeToTrackerTransformStatus"] = "OK";
+    if (CheckEqualToMap("Merge", merged, expectedFields) != PLUS_SUCCESS || original.GetNumberOfFields() != 2)
+    {
+      status = PLUS_FAIL;
+    }
+
+    // Tracked frames share the fields with the containers they are set from
+    PlusTrackedFrame trackedFrame;
+    trackedFrame.SetCustomFrameFields(merged);
+    trackedFrame.SetCustomFrameField("DepthMm", "70");
+    if (std::string(trackedFrame.GetCustomFrameField("DepthMm")) != "70" || *merged.GetFieldValue("DepthMm") != "60"
+        || trackedFrame.GetCustomFields().size() != 3)
+    {
+      LOG_ERROR("Tracked frame fields are not independent from the container they were set from");
+      status = PLUS_FAIL;
+    }
+
+    return status;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfFailures = 0;
+  if (TestMapCompatibility() != PLUS_SUCCESS)
+  {
+    ++numberOfFailures;
+  }
+  if (TestCopyOnWrite() != PLUS_SUCCESS)
+  {
+    ++numberOfFailures;
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("PlusFrameFieldsTest failed");
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("PlusFrameFieldsTest completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,273 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Verify that PlusPerformanceHistogram computes correct statistics, also when samples are added
+// from multiple threads concurrently, and that PlusPerformanceStatistics reports all the metrics and
+// removes histograms when all their users released them.
+
+#include "PlusConfigure.h"
+#include "PlusPerformanceStatistics.h"
+#include "vtkMultiThreader.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLDataElement.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <math.h>
+
+namespace
+{
+  const int NUMBER_OF_SAMPLES_PER_THREAD = 100000;
+
+  //----------------------------------------------------------------------------
+  struct ConcurrentThreadInfoStruct
+  {
+    PlusPerformanceHistogram* Histogram;
+    PlusPerformanceCounter* Counter;
+  };
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE AddSamplesThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    ConcurrentThreadInfoStruct* info = static_cast<ConcurrentThreadInfoStruct*>(threadInfo->UserData);
+    for (int i = 0; i < NUMBER_OF_SAMPLES_PER_THREAD; ++i)
+    {
+      // Each thread adds the same values: 0.001, 0.002, ..., 100.000
+      info->Histogram->AddSample((i + 1) * 0.001);
+      info->Counter->Increment();
+    }
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus CheckValue(const std::string& name, double actual, double expected, double tolerance)
+  {
+    if (fabs(actual - expected) > tolerance)
+    {
+      LOG_ERROR(name << " mismatch: expected " << expected << " (tolerance " << tolerance << "), actual " << actual);
+      return PLUS_FAIL;
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus TestSingleThreaded()
+  {
+    PlusStatus status = PLUS_SUCCESS;
+
+    PlusPerformanceHistogram emptyHistogram("Empty", "ms");
+    if (emptyHistogram.GetNumberOfSamples() != 0 || emptyHistogram.GetMean() != 0 || emptyHistogram.GetPercentile(99) != 0)
+    {
+      LOG_ERROR("Statistics of an empty histogram are not zero");
+      status = PLUS_FAIL;
+    }
+
+    // Values 1, 2, ..., 1000
+    PlusPerformanceHistogram histogram("Test", "ms");
+    for (int i = 1; i <= 1000; ++i)
+    {
+      histogram.AddSample(i);
+    }
+    if (histogram.GetNumberOfSamples() != 1000)
+    {
+      LOG_ERROR("Number of samples mismatch: expected 1000, actual " << histogram.GetNumberOfSamples());
+      status = PLUS_FAIL;
+    }
+    // Percentiles have limited (7%) relative accuracy, all other values are exact
+    if (CheckValue("Mean", histogram.GetMean(), 500.5, 1e-6) != PLUS_SUCCESS
+        || CheckValue("Max", histogram.GetMaximum(), 1000, 1e-6) != PLUS_SUCCESS
+        || CheckValue("Last", histogram.GetLastSample(), 1000, 1e-6) != PLUS_SUCCESS
+        || CheckValue("P50", histogram.GetPercentile(50), 500, 500 * 0.07) != PLUS_SUCCESS
+        || CheckValue("P99", histogram.GetPercentile(99), 990, 990 * 0.07) != PLUS_SUCCESS
+        || CheckValue("P100", histogram.GetPercentile(100), 1000, 1e-6) != PLUS_SUCCESS
+        || CheckValue("P0", histogram.GetPercentile(0), 1, 1 * 0.07) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+
+    // Small and negative values
+    histogram.Reset();
+    histogram.AddSample(-5);
+    histogram.AddSample(0.004);
+    histogram.AddSample(0.012);
+    if (histogram.GetNumberOfSamples() != 3
+        || CheckValue("Small value P0", histogram.GetPercentile(0), 0, 1e-6) != PLUS_SUCCESS
+        || CheckValue("Small value P50", histogram.GetPercentile(50), 0.004, 1e-6) != PLUS_SUCCESS
+        || CheckValue("Small value Max", histogram.GetMaximum(), 0.012, 1e-6) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Small and negative values are not recorded correctly");
+      status = PLUS_FAIL;
+    }
+
+    // Percentile accuracy over a wide range of values
+    for (double value = 0.02; value < 1e8; value *= 1.37)
+    {
+      PlusPerformanceHistogram singleValueHistogram("SingleValue", "ms");
+      singleValueHistogram.AddSample(value);
+      singleValueHistogram.AddSample(value * 2);
+      if (CheckValue("Wide range P50", singleValueHistogram.GetPercentile(50), value, value * 0.07) != PLUS_SUCCESS)
+      {
+        status = PLUS_FAIL;
+        break;
+      }
+    }
+
+    return status;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus TestMultiThreaded(int numberOfThreads)
+  {
+    PlusStatus status = PLUS_SUCCESS;
+
+    ConcurrentThreadInfoStruct info;
+    info.Histogram = PlusPerformanceStatistics::GetInstance()->GetHistogram("Test.Concurrent.DurationMs");
+    info.Counter = PlusPerformanceStatistics::GetInstance()->GetCounter("Test.Concurrent.Items");
+
+    vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+    threader->SetNumberOfThreads(numberOfThreads);
+    threader->SetSingleMethod(AddSamplesThreadFunction, &info);
+    threader->SingleMethodExecute();
+
+    const uint64_t expectedNumberOfSamples = static_cast<uint64_t>(numberOfThreads) * NUMBER_OF_SAMPLES_PER_THREAD;
+    if (info.Histogram->GetNumberOfSamples() != expectedNumberOfSamples || info.Counter->GetValue() != expectedNumberOfSamples)
+    {
+      LOG_ERROR("Samples are lost when added concurrently: expected " << expectedNumberOfSamples << ", histogram count "
+                << info.Histogram->GetNumberOfSamples() << ", counter value " << info.Counter->GetValue());
+      status = PLUS_FAIL;
+    }
+    if (CheckValue("Concurrent mean", info.Histogram->GetMean(), 50.0005, 1e-6) != PLUS_SUCCESS
+        || CheckValue("Concurrent max", info.Histogram->GetMaximum(), 100, 1e-6) != PLUS_SUCCESS
+        || CheckValue("Concurrent P50", info.Histogram->GetPercentile(50), 50, 50 * 0.07) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+
+    // Same name must return the same object
+    if (PlusPerformanceStatistics::GetInstance()->GetHistogram("Test.Concurrent.DurationMs") != info.Histogram
+        || PlusPerformanceStatistics::GetInstance()->GetCounter("Test.Concurrent.Items") != info.Counter)
+    {
+      LOG_ERROR("Getting a metric with an existing name created a new object");
+      status = PLUS_FAIL;
+    }
+
+    vtkSmartPointer<vtkXMLDataElement> statisticsElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    PlusPerformanceStatistics::GetInstance()->WriteSummary(statisticsElement);
+    if (statisticsElement->FindNestedElementWithNameAndAttribute("Histogram", "Name", "Test.Concurrent.DurationMs") == NULL
+        || statisticsElement->FindNestedElementWithNameAndAttribute("Counter", "Name", "Test.Concurrent.Items") == NULL)
+    {
+      LOG_ERROR("Performance statistics summary is incomplete");
+      status = PLUS_FAIL;
+    }
+
+    PlusPerformanceStatistics::GetInstance()->Reset();
+    if (info.Histogram->GetNumberOfSamples() != 0 || info.Counter->GetValue() != 0)
+    {
+      LOG_ERROR("Performance statistics are not reset");
+      status = PLUS_FAIL;
+    }
+
+    return status;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus TestReleaseHistogram()
+  {
+    PlusStatus status = PLUS_SUCCESS;
+
+    // Two users of the same per-connection histogram
+    PlusPerformanceHistogram* histogram = PlusPerformanceStatistics::GetInstance()->GetHistogram("Test.Client1.DurationMs");
+    PlusPerformanceHistogram* sharedHistogram = PlusPerformanceStatistics::GetInstance()->GetHistogram("Test.Client1.DurationMs");
+    if (sharedHistogram != histogram)
+    {
+      LOG_ERROR("Getting a histogram with an existing name created a new object");
+      return PLUS_FAIL;
+    }
+    histogram->AddSample(1.0);
+
+    vtkSmartPointer<vtkXMLDataElement> statisticsElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    PlusPerformanceStatistics::GetInstance()->ReleaseHistogram(histogram);
+    PlusPerformanceStatistics::GetInstance()->WriteSummary(statisticsElement);
+    if (statisticsElement->FindNestedElementWithNameAndAttribute("Histogram", "Name", "Test.Client1.DurationMs") == NULL
+        || sharedHistogram->GetNumberOfSamples() != 1)
+    {
+      LOG_ERROR("Histogram is removed while it is still in use");
+      status = PLUS_FAIL;
+    }
+
+    statisticsElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    PlusPerformanceStatistics::GetInstance()->ReleaseHistogram(sharedHistogram);
+    PlusPerformanceStatistics::GetInstance()->WriteSummary(statisticsElement);
+    if (statisticsElement->FindNestedElementWithNameAndAttribute("Histogram", "Name", "Test.Client1.DurationMs") != NULL)
+    {
+      LOG_ERROR("Histogram is not removed after all users released it");
+      status = PLUS_FAIL;
+    }
+
+    // A released name can be used again, starting with no samples
+    histogram = PlusPerformanceStatistics::GetInstance()->GetHistogram("Test.Client1.DurationMs");
+    if (histogram->GetNumberOfSamples() != 0)
+    {
+      LOG_ERROR("Histogram created with the name of a released histogram is not empty");
+      status = PLUS_FAIL;
+    }
+    PlusPerformanceStatistics::GetInstance()->ReleaseHistogram(histogram);
+
+    return status;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfThreads = 4;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of threads adding samples concurrently (default: 4)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfFailures = 0;
+  if (TestSingleThreaded() != PLUS_SUCCESS)
+  {
+    ++numberOfFailures;
+  }
+  if (TestMultiThreaded(numberOfThreads) != PLUS_SUCCESS)
+  {
+    ++numberOfFailures;
+  }
+  if (TestReleaseHistogram() != PLUS_SUCCESS)
+  {
+    ++numberOfFailures;
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("PlusPerformanceStatisticsTest failed");
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("PlusPerformanceStatisticsTest completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,196 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Verify that the specialized flip/transpose kernels of PlusVideoFrame::FlipClipImage produce
+// exactly the same output as the generic implementation, and measure the speed of both.
+
+#include "PlusConfigure.h"
+#include "PlusVideoFrame.h"
+#include "vtkImageData.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <iomanip>
+#include <string.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  struct FlipTestCase
+  {
+    const char* Name;
+    bool HFlip;
+    bool VFlip;
+    PlusVideoFrame::TransposeType Transpose;
+  };
+
+  //----------------------------------------------------------------------------
+  void FillRandom(vtkImageData* image)
+  {
+    unsigned char* pixel = static_cast<unsigned char*>(image->GetScalarPointer());
+    vtkIdType numberOfBytes = image->GetNumberOfPoints() * image->GetNumberOfScalarComponents() * image->GetScalarSize();
+    for (vtkIdType i = 0; i < numberOfBytes; ++i)
+    {
+      pixel[i] = static_cast<unsigned char>(rand());
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus FlipClip(vtkImageData* input, const FlipTestCase& testCase, const int clipOrigin[3], const int clipSize[3], vtkImageData* output, bool optimized, int numberOfIterations, double& averageTimeSec)
+  {
+    PlusVideoFrame::FlipInfoType flipInfo;
+    flipInfo.hFlip = testCase.HFlip;
+    flipInfo.vFlip = testCase.VFlip;
+    flipInfo.tranpose = testCase.Transpose;
+
+    PlusVideoFrame::SetOptimizedFlipClipEnabled(optimized);
+    PlusStatus status = PLUS_SUCCESS;
+    double startTime = vtkPlusAccurateTimer::GetSystemTime();
+    for (int i = 0; i < numberOfIterations; ++i)
+    {
+      if (PlusVideoFrame::FlipClipImage(input, flipInfo, clipOrigin, clipSize, output) != PLUS_SUCCESS)
+      {
+        status = PLUS_FAIL;
+      }
+    }
+    averageTimeSec = (vtkPlusAccurateTimer::GetSystemTime() - startTime) / numberOfIterations;
+    PlusVideoFrame::SetOptimizedFlipClipEnabled(true);
+    return status;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestFlipClip(int scalarType, int numberOfScalarComponents, const int dims[3], bool clip, int numberOfIterations)
+  {
+    const FlipTestCase testCases[] =
+    {
+      { "FlipX", true, false, PlusVideoFrame::TRANSPOSE_NONE },
+      { "FlipY", false, true, PlusVideoFrame::TRANSPOSE_NONE },
+      { "FlipXY", true, true, PlusVideoFrame::TRANSPOSE_NONE },
+      { "TransposeKIJtoIJK", false, false, PlusVideoFrame::TRANSPOSE_IJKtoKIJ }
+    };
+
+    vtkSmartPointer<vtkImageData> input = vtkSmartPointer<vtkImageData>::New();
+    input->SetExtent(0, dims[0] - 1, 0, dims[1] - 1, 0, dims[2] - 1);
+    input->AllocateScalars(scalarType, numberOfScalarComponents);
+    FillRandom(input);
+
+    int clipOrigin[3] = {PlusCommon::NO_CLIP, PlusCommon::NO_CLIP, PlusCommon::NO_CLIP};
+    int clipSize[3] = {PlusCommon::NO_CLIP, PlusCommon::NO_CLIP, PlusCommon::NO_CLIP};
+    if (clip)
+    {
+      for (int i = 0; i < 3; ++i)
+      {
+        clipOrigin[i] = dims[i] / 5;
+        clipSize[i] = dims[i] - dims[i] / 5 - dims[i] / 7;
+      }
+    }
+
+    int numberOfErrors = 0;
+    for (unsigned int testCaseIndex = 0; testCaseIndex < sizeof(testCases) / sizeof(testCases[0]); ++testCaseIndex)
+    {
+      const FlipTestCase& testCase = testCases[testCaseIndex];
+      vtkSmartPointer<vtkImageData> genericOutput = vtkSmartPointer<vtkImageData>::New();
+      vtkSmartPointer<vtkImageData> optimizedOutput = vtkSmartPointer<vtkImageData>::New();
+      double genericTimeSec = 0;
+      double optimizedTimeSec = 0;
+      if (FlipClip(input, testCase, clipOrigin, clipSize, genericOutput, false, numberOfIterations, genericTimeSec) != PLUS_SUCCESS
+          || FlipClip(input, testCase, clipOrigin, clipSize, optimizedOutput, true, numberOfIterations, optimizedTimeSec) != PLUS_SUCCESS)
+      {
+        LOG_ERROR(testCase.Name << " failed");
+        numberOfErrors++;
+        continue;
+      }
+
+      int genericDims[3] = {0, 0, 0};
+      int optimizedDims[3] = {0, 0, 0};
+      genericOutput->GetDimensions(genericDims);
+      optimizedOutput->GetDimensions(optimizedDims);
+      if (genericDims[0] != optimizedDims[0] || genericDims[1] != optimizedDims[1] || genericDims[2] != optimizedDims[2])
+      {
+        LOG_ERROR(testCase.Name << " output size mismatch");
+        numberOfErrors++;
+        continue;
+      }
+      vtkIdType numberOfBytes = genericOutput->GetNumberOfPoints() * numberOfScalarComponents * genericOutput->GetScalarSize();
+      if (memcmp(genericOutput->GetScalarPointer(), optimizedOutput->GetScalarPointer(), numberOfBytes) != 0)
+      {
+        LOG_ERROR(testCase.Name << " output mismatch between generic and optimized implementation (scalar type: "
+                  << input->GetScalarTypeAsString() << ", components: " << numberOfScalarComponents << ", clip: " << (clip ? "yes" : "no") << ")");
+        numberOfErrors++;
+        continue;
+      }
+
+      LOG_INFO(testCase.Name << " " << input->GetScalarTypeAsString() << "x" << numberOfScalarComponents
+               << " " << dims[0] << "x" << dims[1] << "x" << dims[2] << (clip ? " clipped" : "")
+               << ": generic " << std::fixed << std::setprecision(3) << genericTimeSec * 1000 << " ms"
+               << ", optimized " << optimizedTimeSec * 1000 << " ms"
+               << ", speedup " << std::setprecision(1) << (optimizedTimeSec > 0 ? genericTimeSec / optimizedTimeSec : 0) << "x");
+    }
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfIterations = 1;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--iterations", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfIterations, "Number of repetitions of each operation for measuring the computation time (default: 1)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfIterations < 1)
+  {
+    numberOfIterations = 1;
+  }
+
+  int numberOfErrors = 0;
+
+  // Typical 2D frames (odd width to exercise the scalar tail of the SIMD loops)
+  const int frameSize[3] = {641, 480, 1};
+  numberOfErrors += TestFlipClip(VTK_UNSIGNED_CHAR, 1, frameSize, false, numberOfIterations);
+  numberOfErrors += TestFlipClip(VTK_UNSIGNED_CHAR, 3, frameSize, false, numberOfIterations);
+  numberOfErrors += TestFlipClip(VTK_UNSIGNED_CHAR, 4, frameSize, false, numberOfIterations);
+  numberOfErrors += TestFlipClip(VTK_SHORT, 1, frameSize, false, numberOfIterations);
+  numberOfErrors += TestFlipClip(VTK_FLOAT, 1, frameSize, false, numberOfIterations);
+  numberOfErrors += TestFlipClip(VTK_UNSIGNED_CHAR, 3, frameSize, true, numberOfIterations);
+
+  // Volumes (for transposition)
+  const int volumeSize[3] = {97, 64, 45};
+  numberOfErrors += TestFlipClip(VTK_UNSIGNED_CHAR, 1, volumeSize, false, numberOfIterations);
+  numberOfErrors += TestFlipClip(VTK_UNSIGNED_SHORT, 1, volumeSize, true, numberOfIterations);
+  numberOfErrors += TestFlipClip(VTK_UNSIGNED_CHAR, 3, volumeSize, false, numberOfIterations);
+  numberOfErrors += TestFlipClip(VTK_DOUBLE, 1, volumeSize, false, numberOfIterations);
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -91,6 +91,20 @@ void vtkPlusTrackedFrameList::Clear()
   this->TrackedFrameList.clear();
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusTrackedFrameList::ReleaseTrackedFrames(std::vector<PlusTrackedFrame*>& releasedFrames)
+{
+  for (unsigned int i = 0; i < this->TrackedFrameList.size(); i++)
+  {
+    if (this->TrackedFrameList[i] != NULL)
+    {
+      releasedFrames.push_back(this->TrackedFrameList[i]);
+      this->TrackedFrameList[i] = NULL;
+    }
+  }
+  this->TrackedFrameList.clear();
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusTrackedFrameList::PrintSelf(std::ostream& os, vtkIndent indent)
 {
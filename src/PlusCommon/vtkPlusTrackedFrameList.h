@@ -111,6 +111,12 @@ public:
   /*! Clear tracked frame list and free memory */
   virtual void Clear();
 
+  /*!
+    Remove all tracked frames from the list without deleting them. The frames are appended to releasedFrames
+    and the caller takes over their ownership (e.g., to reuse them for retrieving new frames).
+  */
+  virtual void ReleaseTrackedFrames(std::vector<PlusTrackedFrame*>& releasedFrames);
+
   /*! Set the number of following unique frames needed in the tracked frame list */
   vtkSetMacro(NumberOfUniqueFrames, int);
 
@@ -16,6 +16,16 @@ See License.txt for details.
 #include <Winsock2.h>
 #endif
 
+// STL includes
+#include <algorithm>
+
+namespace
+{
+  // Limits of the delay between reconnect attempts after the connection is lost
+  const double MIN_RECONNECT_DELAY_SEC = 0.5;
+  const double MAX_RECONNECT_DELAY_SEC = 10.0;
+}
+
 //----------------------------------------------------------------------------
 vtkPlusOpenIGTLinkDevice::vtkPlusOpenIGTLinkDevice()
   : ServerPort(-1)
@@ -26,12 +36,18 @@ vtkPlusOpenIGTLinkDevice::vtkPlusOpenIGTLinkDevice()
   , DelayBetweenRetryAttemptsSec(0.100)   // there is already a delay with a CLIENT_SOCKET_TIMEOUT_MSEC timeout, so we just add a little extra idle delay
   , MessageFactory(vtkSmartPointer<vtkPlusIgtlMessageFactory>::New())
   , SocketMutex(vtkSmartPointer<vtkPlusRecursiveCriticalSection>::New())
-  , ClientSocket(igtl::ClientSocket::New())
+  , ClientSocket(igtl::PlusClientSocket::New())
+  , LastMessageReceivedTime(0.0)
   , ReconnectOnReceiveTimeout(true)
+  , ConnectionLost(false)
+  , ReconnectDelaySec(MIN_RECONNECT_DELAY_SEC)
+  , NextReconnectAttemptTime(0.0)
   , UseReceivedTimestamps(true)
 {
   // No callback function provided by the device, so the data capture thread will be used to poll the hardware and add new items to the buffer
   this->StartThreadForInternalUpdates = true;
+  // InternalUpdate waits for incoming messages, so it must be called again as soon as it returns
+  this->WaitBetweenInternalUpdates = false;
   this->AcquisitionRate = 30;
 }
 
@@ -63,6 +79,10 @@ void vtkPlusOpenIGTLinkDevice::PrintSelf(ostream& os, vtkIndent indent)
   {
     os << indent << "Image stream: " << this->ImageStream.GetTransformName() << "\n";
   }
+  if (!this->ImageCompression.empty())
+  {
+    os << indent << "Image compression: " << this->ImageCompression << "\n";
+  }
 }
 //----------------------------------------------------------------------------
 std::string vtkPlusOpenIGTLinkDevice::GetSdkVersion()
@@ -86,6 +106,9 @@ PlusStatus vtkPlusOpenIGTLinkDevice::InternalConnect()
     return PLUS_SUCCESS;
   }
 
+  this->ConnectionLost = false;
+  this->ReconnectDelaySec = MIN_RECONNECT_DELAY_SEC;
+  this->NextReconnectAttemptTime = 0.0;
   return ClientSocketReconnect();
 }
 
@@ -149,7 +172,15 @@ PlusStatus vtkPlusOpenIGTLinkDevice::ClientSocketReconnect()
 
   if (errorCode != 0)
   {
-    LOG_ERROR("Cannot connect to the server (" << this->ServerAddress << ":" << this->ServerPort << ").");
+    if (this->ConnectionLost)
+    {
+      // The lost connection has already been reported, don't report each failed reconnect attempt
+      LOG_DEBUG("Cannot connect to the server (" << this->ServerAddress << ":" << this->ServerPort << ").");
+    }
+    else
+    {
+      LOG_ERROR("Cannot connect to the server (" << this->ServerAddress << ":" << this->ServerPort << ").");
+    }
     return PLUS_FAIL;
   }
   else
@@ -160,6 +191,7 @@ PlusStatus vtkPlusOpenIGTLinkDevice::ClientSocketReconnect()
   PlusLockGuard<vtkPlusRecursiveCriticalSection> socketGuard(this->SocketMutex);
   this->ClientSocket->SetReceiveTimeout(this->ReceiveTimeoutSec * 1000.0);   // *1000 because SetReceiveTimeout expects msec
   this->ClientSocket->SetSendTimeout(this->SendTimeoutSec * 1000.0);   // *1000 because SetSendTimeout expects msec
+  this->LastMessageReceivedTime = vtkPlusAccurateTimer::GetSystemTime();
 
   return SendRequestedMessageTypes();
 }
@@ -185,6 +217,7 @@ PlusStatus vtkPlusOpenIGTLinkDevice::SendRequestedMessageTypes()
     PlusIgtlClientInfo::ImageStream is;
     is.Name = this->ImageStream.From();
     is.EmbeddedTransformToFrame = this->ImageStream.To();
+    is.Compression = this->ImageCompression;
     clientInfo.ImageStreams.push_back(is);
   }
 
@@ -218,33 +251,56 @@ PlusStatus vtkPlusOpenIGTLinkDevice::SendRequestedMessageTypes()
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkDevice::ReconnectAfterConnectionLost()
+{
+  double now = vtkPlusAccurateTimer::GetSystemTime();
+  if (now < this->NextReconnectAttemptTime)
+  {
+    return PLUS_FAIL;
+  }
+
+  if (ClientSocketReconnect() != PLUS_SUCCESS)
+  {
+    this->NextReconnectAttemptTime = vtkPlusAccurateTimer::GetSystemTime() + this->ReconnectDelaySec;
+    LOG_DEBUG("Reconnect attempt failed in device " << this->GetDeviceId() << ", next attempt in " << this->ReconnectDelaySec << " sec");
+    this->ReconnectDelaySec = std::min(this->ReconnectDelaySec * 2, MAX_RECONNECT_DELAY_SEC);
+    return PLUS_FAIL;
+  }
+
+  LOG_INFO("Connection to the server (" << this->ServerAddress << ":" << this->ServerPort << ") is restored in device " << this->GetDeviceId());
+  this->ConnectionLost = false;
+  this->ReconnectDelaySec = MIN_RECONNECT_DELAY_SEC;
+  this->NextReconnectAttemptTime = 0.0;
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusOpenIGTLinkDevice::OnReceiveTimeout()
 {
-  if (this->GetReconnectOnReceiveTimeout())
+  if (!this->GetReconnectOnReceiveTimeout())
+  {
+    return;
+  }
+  if (!this->ConnectionLost)
   {
     LOG_WARNING("No OpenIGTLink message has been received in device " << this->GetDeviceId() << ": failed to receive OpenIGTLink transforms. Attempt to reconnect.");
-    ClientSocketReconnect();
+    this->ConnectionLost = true;
   }
+  ReconnectAfterConnectionLost();
 }
 
 //----------------------------------------------------------------------------
-void vtkPlusOpenIGTLinkDevice::ReceiveMessageHeaderWithErrorHandling(igtl::MessageHeader::Pointer& headerMsg)
+void vtkPlusOpenIGTLinkDevice::OnSocketError()
 {
-  PlusLockGuard<vtkPlusRecursiveCriticalSection> socketGuard(this->SocketMutex);
-  PlusStatus socketStatus = ReceiveMessageHeader(headerMsg);
-  if (socketStatus == PLUS_FAIL || !this->ClientSocket->GetConnected())
+  if (!this->ConnectionLost)
   {
-    // There is a socket error
-    if (this->GetReconnectOnReceiveTimeout())
-    {
-      LOG_ERROR("Socket error in device " << this->GetDeviceId() << ": failed to receive OpenIGTLink transforms. Attempt to reconnect.");
-      ClientSocketReconnect();
-    }
-    else
-    {
-      LOG_ERROR("Socket error in device " << this->GetDeviceId() << ": failed to receive OpenIGTLink transforms");
-    }
+    LOG_ERROR("Socket error in device " << this->GetDeviceId() << ": failed to receive OpenIGTLink messages." << (this->GetReconnectOnReceiveTimeout() ? " Attempt to reconnect." : ""));
+    this->ConnectionLost = true;
+  }
+  if (this->GetReconnectOnReceiveTimeout())
+  {
+    ReconnectAfterConnectionLost();
   }
 }
 
@@ -253,12 +309,12 @@ PlusStatus vtkPlusOpenIGTLinkDevice::ReceiveMessageHeader(igtl::MessageHeader::P
 {
   headerMsg = this->MessageFactory->CreateHeaderMessage(IGTL_HEADER_VERSION_1);
 
+  // Callers wait for the data with WaitForData, so there is no need to retry here:
+  // if no data is received then the connection has been closed or the receive timeout elapsed
   int numOfBytesReceived = 0;
   {
     PlusLockGuard<vtkPlusRecursiveCriticalSection> socketGuard(this->SocketMutex);
-    RETRY_UNTIL_TRUE(
-      (numOfBytesReceived = this->ClientSocket->Receive(headerMsg->GetBufferPointer(), headerMsg->GetBufferSize())) != 0,
-      this->NumberOfRetryAttempts, this->DelayBetweenRetryAttemptsSec);
+    numOfBytesReceived = this->ClientSocket->Receive(headerMsg->GetBufferPointer(), headerMsg->GetBufferSize());
   }
 
   if (numOfBytesReceived > 0)
@@ -313,6 +369,90 @@ PlusStatus vtkPlusOpenIGTLinkDevice::ReceiveMessageHeader(igtl::MessageHeader::P
   return socketError ? PLUS_FAIL : PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkDevice::ReceiveAvailableMessages(int& numberOfReceivedMessages)
+{
+  numberOfReceivedMessages = 0;
+
+  // Wait at most one acquisition period, so that the caller can regularly update the buffers (e.g., invalidate stale transforms)
+  double waitTimeoutSec = this->ReceiveTimeoutSec;
+  if (this->AcquisitionRate > 0 && 1.0 / this->AcquisitionRate < waitTimeoutSec)
+  {
+    waitTimeoutSec = 1.0 / this->AcquisitionRate;
+  }
+
+  if (!this->ClientSocket->GetConnected())
+  {
+    // Reconnect attempts are throttled by OnSocketError. Wait one acquisition period while there is no connection,
+    // as the data capture thread calls this method again right away.
+    OnSocketError();
+    if (!this->ClientSocket->GetConnected())
+    {
+      vtkPlusAccurateTimer::Delay(waitTimeoutSec);
+      return PLUS_FAIL;
+    }
+  }
+
+  double startTime = vtkPlusAccurateTimer::GetSystemTime();
+  int waitResult = this->ClientSocket->WaitForData(waitTimeoutSec);
+  while (waitResult > 0)
+  {
+    igtl::MessageHeader::Pointer headerMsg;
+    if (ReceiveMessageHeader(headerMsg) != PLUS_SUCCESS || headerMsg.IsNull())
+    {
+      // Data was available but a message header could not be read: the connection has been closed by the server
+      {
+        PlusLockGuard<vtkPlusRecursiveCriticalSection> socketGuard(this->SocketMutex);
+        this->ClientSocket->CloseSocket();
+      }
+      OnSocketError();
+      return PLUS_FAIL;
+    }
+    this->LastMessageReceivedTime = vtkPlusAccurateTimer::GetSystemTime();
+    ++numberOfReceivedMessages;
+
+    // We've received valid header data
+    headerMsg->Unpack(this->IgtlMessageCrcCheckEnabled);
+    if (ProcessReceivedMessage(headerMsg) != PLUS_SUCCESS)
+    {
+      // The message body may have been partially read, so the remaining messages cannot be processed reliably
+      return PLUS_FAIL;
+    }
+
+    if (this->LastMessageReceivedTime - startTime > waitTimeoutSec)
+    {
+      // The server sends data faster than we can process, let the caller store the data received so far
+      LOG_TRACE("Stop receiving messages in device " << this->GetDeviceId() << " after " << numberOfReceivedMessages << " messages, more messages are available");
+      return PLUS_SUCCESS;
+    }
+
+    // Check if the next message is already available, without waiting
+    waitResult = this->ClientSocket->WaitForData(0);
+  }
+
+  if (waitResult < 0)
+  {
+    OnSocketError();
+    return PLUS_FAIL;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkDevice::ProcessReceivedMessage(igtl::MessageHeader::Pointer headerMsg)
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> socketGuard(this->SocketMutex);
+  this->ClientSocket->Skip(headerMsg->GetBodySizeToRead(), 0);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusOpenIGTLinkDevice::IsReceiveTimedOut() const
+{
+  return vtkPlusAccurateTimer::GetSystemTime() - this->LastMessageReceivedTime > this->ReceiveTimeoutSec;
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusOpenIGTLinkDevice::ReadConfiguration(vtkXMLDataElement* rootConfigElement)
 {
@@ -320,6 +460,7 @@ PlusStatus vtkPlusOpenIGTLinkDevice::ReadConfiguration(vtkXMLDataElement* rootCo
   XML_READ_STRING_ATTRIBUTE_REQUIRED(ServerAddress, deviceConfig);
   XML_READ_SCALAR_ATTRIBUTE_REQUIRED(int, ServerPort, deviceConfig);
   XML_READ_STRING_ATTRIBUTE_OPTIONAL(MessageType, deviceConfig);
+  XML_READ_STRING_ATTRIBUTE_OPTIONAL(ImageCompression, deviceConfig);
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, ReceiveTimeoutSec, deviceConfig);
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, SendTimeoutSec, deviceConfig);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(IgtlMessageCrcCheckEnabled, deviceConfig);
@@ -335,6 +476,7 @@ PlusStatus vtkPlusOpenIGTLinkDevice::WriteConfiguration(vtkXMLDataElement* rootC
   XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(ServerAddress, rootConfigElement);
   deviceConfig->SetIntAttribute("ServerPort", this->ServerPort);
   XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(MessageType, rootConfigElement);
+  XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(ImageCompression, deviceConfig);
   deviceConfig->SetDoubleAttribute("ReceiveTimeoutSec", this->ReceiveTimeoutSec);
   deviceConfig->SetDoubleAttribute("SendTimeoutSec", this->SendTimeoutSec);
   deviceConfig->SetAttribute("IgtlMessageCrcCheckEnabled", this->IgtlMessageCrcCheckEnabled ? "true" : "false");
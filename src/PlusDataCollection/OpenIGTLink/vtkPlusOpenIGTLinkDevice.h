@@ -12,8 +12,8 @@
 #include "vtkPlusDevice.h"
 
 // IGTL includes
-#include <igtlClientSocket.h>
 #include <igtlMessageBase.h>
+#include "igtlPlusClientSocket.h"
 
 class vtkPlusIgtlMessageFactory;
 
@@ -21,6 +21,11 @@ class vtkPlusIgtlMessageFactory;
   \class vtkPlusOpenIGTLinkDevice
   \brief Common base class for OpenIGTLink-based tracking and video devices
 
+  The data capture thread is not paced by the acquisition rate: each InternalUpdate call waits for the next
+  message (for at most one acquisition period) and then processes all the messages that are already available
+  on the socket. This prevents messages from piling up in the socket buffer when the server sends data
+  faster than the acquisition rate.
+
   \ingroup PlusLibDataCollection
 */
 class vtkPlusDataCollectionExport vtkPlusOpenIGTLinkDevice : public vtkPlusDevice
@@ -61,6 +66,14 @@ public:
   /*! Get image streams to be sent when message type is a type that sends an image */
   vtkGetMacro(ImageStream, PlusTransformName);
 
+  /*!
+    Set compression method of the requested image stream (NONE, ZLIB, DELTA_RLE, DELTA_ZLIB).
+    If set then the server sends the images in COMPIMAGE messages. See vtkPlusIgtlImageCompressor.
+  */
+  vtkSetStdStringMacro(ImageCompression);
+  /*! Get compression method of the requested image stream */
+  vtkGetStdStringMacro(ImageCompression);
+
   /*! Set OpenIGTLink server address */
   vtkSetStdStringMacro(ServerAddress);
   /*! Get OpenIGTLink server address */
@@ -96,6 +109,13 @@ protected:
   /*! Reconnect the client socket. Used when the connection is established or there is a socket error. */
   virtual PlusStatus ClientSocketReconnect();
 
+  /*!
+    Reconnect the client socket after the connection has been lost. Attempts are skipped until the reconnect delay elapses
+    since the previous failed attempt. The delay is doubled after each failed attempt (up to a maximum), so that
+    the server and the log are not flooded while the server is unavailable.
+  */
+  PlusStatus ReconnectAfterConnectionLost();
+
   /*! Sends the requested message types when connection is established */
   virtual PlusStatus SendRequestedMessageTypes();
 
@@ -106,9 +126,10 @@ protected:
   void OnReceiveTimeout();
 
   /*!
-    Calls ReceiveMessageHeader and logs the error and/or reconnect as needed.
+    Log the socket error and attempt to reconnect if ReconnectOnReceiveTimeout is enabled.
+    The error is only logged once until the connection is restored.
   */
-  void ReceiveMessageHeaderWithErrorHandling(igtl::MessageHeader::Pointer& headerMsg);
+  void OnSocketError();
 
   /*!
     Receive an OpenITGLink message header.
@@ -117,6 +138,25 @@ protected:
   */
   virtual PlusStatus ReceiveMessageHeader(igtl::MessageHeader::Pointer& headerMsg);
 
+  /*!
+    Wait for the next message (for at most one acquisition period, but not longer than ReceiveTimeoutSec) and then
+    receive all the messages that are already available on the socket, without waiting between them.
+    ProcessReceivedMessage is called for each received message.
+    Receiving stops after one acquisition period even if more messages are available, so that the caller can
+    add the received data to the buffers regularly even if the server sends data faster than it can be processed.
+    Returns PLUS_FAIL if there was a socket error or a message could not be processed.
+  */
+  PlusStatus ReceiveAvailableMessages(int& numberOfReceivedMessages);
+
+  /*!
+    Read the body of the message from the socket and process it.
+    Message types that the device does not use must be skipped. The default implementation skips all messages.
+  */
+  virtual PlusStatus ProcessReceivedMessage(igtl::MessageHeader::Pointer headerMsg);
+
+  /*! Returns true if no message has been received in the last ReceiveTimeoutSec seconds */
+  bool IsReceiveTimedOut() const;
+
   /*! Set the ReconnectOnReceiveTimeout flag */
   vtkSetMacro(ReconnectOnReceiveTimeout, bool);
 
@@ -128,6 +168,9 @@ protected:
   /*! Image stream to send when message type wants to send an image */
   PlusTransformName ImageStream;
 
+  /*! Compression method requested for the image stream */
+  std::string ImageCompression;
+
   /*! OpenIGTLink server address */
   std::string ServerAddress;
 
@@ -154,11 +197,23 @@ protected:
   vtkSmartPointer<vtkPlusRecursiveCriticalSection> SocketMutex;
 
   /*! OpenIGTLink client socket */
-  igtl::ClientSocket::Pointer ClientSocket;
+  igtl::PlusClientSocket::Pointer ClientSocket;
+
+  /*! System time when the last message was received (or when the connection was established) */
+  double LastMessageReceivedTime;
 
   /*! Attempt a reconnection if no data is received */
   bool ReconnectOnReceiveTimeout;
 
+  /*! True after the connection is lost (socket error or receive timeout) until it is restored. Used for logging only once per state change. */
+  bool ConnectionLost;
+
+  /*! Delay before the next reconnect attempt, doubled after each failed attempt */
+  double ReconnectDelaySec;
+
+  /*! System time before which no reconnect attempt is made */
+  double NextReconnectAttemptTime;
+
   /*!
     Use the timestamp embedded in the OpenIGTLink message (the timestamp is converted form the UTC time to system time).
     If it is false then the time of reception is used as timestamp.
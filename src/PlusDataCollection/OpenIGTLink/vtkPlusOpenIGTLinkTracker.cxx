@@ -78,13 +78,34 @@ PlusStatus vtkPlusOpenIGTLinkTracker::InternalUpdate()
     return PLUS_FAIL;
   }
 
+  this->ReceivedTransforms.clear();
+  int numberOfReceivedMessages = 0;
+  PlusStatus receiveStatus = this->ReceiveAvailableMessages(numberOfReceivedMessages);
+
+  // Store the transforms even if there was an error, as the messages received before the error are valid
+  PlusStatus status = PLUS_SUCCESS;
+  if (this->IsTDataMessageType())
+  {
+    status = this->InternalUpdateTData();
+  }
+  else
+  {
+    status = this->InternalUpdateGeneral();
+  }
+
+  return (receiveStatus == PLUS_SUCCESS) ? status : PLUS_FAIL;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkTracker::ProcessReceivedMessage(igtl::MessageHeader::Pointer headerMsg)
+{
   if (this->IsTDataMessageType())
   {
-    return this->InternalUpdateTData();
+    return this->ProcessTrackingDataMessage(headerMsg);
   }
   else
   {
-    return this->InternalUpdateGeneral();
+    return this->ProcessTransformMessageGeneral(headerMsg);
   }
 }
 
@@ -93,52 +114,45 @@ PlusStatus vtkPlusOpenIGTLinkTracker::InternalUpdateTData()
 {
   LOG_TRACE("vtkPlusOpenIGTLinkTracker::InternalUpdateTData");
 
-  igtl::MessageBase::Pointer bodyMsg;
-  igtl::MessageHeader::Pointer headerMsg;
-
-  while (true)
+  if (this->ReceivedTransforms.empty())
   {
-    ReceiveMessageHeaderWithErrorHandling(headerMsg);
-
-    if (headerMsg.IsNull())
+    // Has not received data
+    double unfilteredTimestamp = vtkPlusAccurateTimer::GetSystemTime();
+    if (this->UseLastTransformsOnReceiveTimeout)
     {
-      // Has not received data
-      if (this->UseLastTransformsOnReceiveTimeout)
-      {
-        // The server only sends update if a transform is modified, it's not an error
-        LOG_TRACE("No OpenIGTLink message has been received in device " << this->GetDeviceId());
-        // Store the last known transform values (useful when the server only notifies about transform changes
-        double unfilteredTimestamp = vtkPlusAccurateTimer::GetSystemTime();
-        StoreMostRecentTransformValues(unfilteredTimestamp);
-        return PLUS_SUCCESS;
-      }
-      else
-      {
-        OnReceiveTimeout();
-        PlusLockGuard<vtkPlusRecursiveCriticalSection> socketGuard(this->SocketMutex);
-        if (!this->ClientSocket->GetConnected())
-        {
-          // Could not restore the connection, set transform status to INVALID
-          double unfilteredTimestamp = vtkPlusAccurateTimer::GetSystemTime();
-          StoreInvalidTransforms(unfilteredTimestamp);
-        }
-        return PLUS_FAIL;
-      }
+      // The server only sends update if a transform is modified, it's not an error
+      LOG_TRACE("No OpenIGTLink message has been received in device " << this->GetDeviceId());
+      // Store the last known transform values (useful when the server only notifies about transform changes
+      return StoreMostRecentTransformValues(unfilteredTimestamp);
     }
-
-    // We've received valid header data
-    headerMsg->Unpack(this->IgtlMessageCrcCheckEnabled);
-
-    bodyMsg = this->IgtlMessageFactory->CreateReceiveMessage(headerMsg);
-    if (typeid(*bodyMsg) == typeid(igtl::TrackingDataMessage))
+    if (!this->IsReceiveTimedOut())
+    {
+      // The next message may still arrive in time
+      return PLUS_SUCCESS;
+    }
+    OnReceiveTimeout();
+    PlusLockGuard<vtkPlusRecursiveCriticalSection> socketGuard(this->SocketMutex);
+    if (!this->ClientSocket->GetConnected())
     {
-      // received a TDATA message
-      break;
+      // Could not restore the connection, set transform status to INVALID
+      StoreInvalidTransforms(unfilteredTimestamp);
     }
+    return PLUS_FAIL;
+  }
 
+  return StoreReceivedTransforms();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkTracker::ProcessTrackingDataMessage(igtl::MessageHeader::Pointer headerMsg)
+{
+  igtl::MessageBase::Pointer bodyMsg = this->IgtlMessageFactory->CreateReceiveMessage(headerMsg);
+  if (typeid(*bodyMsg) != typeid(igtl::TrackingDataMessage))
+  {
     // data type is unknown, ignore it
     PlusLockGuard<vtkPlusRecursiveCriticalSection> socketGuard(this->SocketMutex);
     this->ClientSocket->Skip(headerMsg->GetBodySizeToRead(), 0);
+    return PLUS_SUCCESS;
   }
 
   // TDATA message
@@ -157,12 +171,11 @@ PlusStatus vtkPlusOpenIGTLinkTracker::InternalUpdateTData()
     return PLUS_FAIL;
   }
 
+  // Each TDATA message contains all the tools, so the transforms of previous messages in this update are not needed anymore
+  this->ReceivedTransforms.clear();
+
   // for now just use system time, all coordinates will be sequential.
   double unfilteredTimestamp = vtkPlusAccurateTimer::GetSystemTime();
-  double filteredTimestamp = unfilteredTimestamp; // No need to filter already filtered timestamped items received over OpenIGTLink
-  // We store the list of identified tools (tools we get information about from the tracker).
-  // The tools that are missing from the tracker message are assumed to be out of view.
-  std::set<std::string> identifiedToolSourceIds;
   for (int i = 0; i < tdataMsg->GetNumberOfTrackingDataElements(); ++ i)
   {
     igtl::TrackingDataElement::Pointer tdataElem = igtl::TrackingDataElement::New();
@@ -180,39 +193,29 @@ PlusStatus vtkPlusOpenIGTLinkTracker::InternalUpdateTData()
       }
     }
 
-    // Get timestamp
-    igtl::TimeStamp::Pointer igtlTimestamp = igtl::TimeStamp::New();
-    tdataMsg->GetTimeStamp(igtlTimestamp);
-
-    // Get igtl transform name
-    std::string igtlTransformName = tdataElem->GetName();
-
     // Set internal transform name
-    PlusTransformName transformName(igtlTransformName.c_str(), this->TrackerInternalCoordinateSystemName);
-    if (this->ToolTimeStampedUpdateWithoutFiltering(transformName.GetTransformName().c_str(), toolMatrix, TOOL_OK, unfilteredTimestamp, filteredTimestamp) == PLUS_SUCCESS)
-    {
-      identifiedToolSourceIds.insert(transformName.GetTransformName());
-    }
-    else
-    {
-      LOG_INFO("ToolTimeStampedUpdate failed for tool: " << transformName.From() << " with timestamp: " << std::fixed << unfilteredTimestamp);
-      // DO NOT return here: we want to update the other tools.
-    }
+    PlusTransformName transformName(tdataElem->GetName(), this->TrackerInternalCoordinateSystemName);
+    ReceivedTransform& receivedTransform = this->ReceivedTransforms[transformName.GetTransformName()];
+    receivedTransform.Matrix = toolMatrix;
+    receivedTransform.Status = TOOL_OK;
+    receivedTransform.UnfilteredTimestamp = unfilteredTimestamp;
   }
-  // Set status for non-detected tools
-  vtkSmartPointer<vtkMatrix4x4> toolMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-  toolMatrix->Identity();
+
+  // The tools that are missing from the tracker message are assumed to be out of view.
   for (DataSourceContainerConstIterator it = this->GetToolIteratorBegin(); it != this->GetToolIteratorEnd(); ++it)
   {
-    if (identifiedToolSourceIds.find(it->second->GetId()) != identifiedToolSourceIds.end())
+    if (this->ReceivedTransforms.find(it->second->GetId()) != this->ReceivedTransforms.end())
     {
-      // this tool has been found and update has been already called with the correct transform
       LOG_TRACE("Tool " << it->second->GetId() << ": found");
       continue;
     }
     LOG_TRACE("Tool " << it->second->GetId() << ": not found");
-    this->ToolTimeStampedUpdateWithoutFiltering(it->second->GetId(), toolMatrix, TOOL_OUT_OF_VIEW, unfilteredTimestamp, filteredTimestamp);
+    ReceivedTransform& receivedTransform = this->ReceivedTransforms[it->second->GetId()];
+    receivedTransform.Matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    receivedTransform.Status = TOOL_OUT_OF_VIEW;
+    receivedTransform.UnfilteredTimestamp = unfilteredTimestamp;
   }
+
   return PLUS_SUCCESS;
 }
 
@@ -221,32 +224,9 @@ PlusStatus vtkPlusOpenIGTLinkTracker::InternalUpdateGeneral()
 {
   LOG_TRACE("vtkPlusOpenIGTLinkTracker::InternalUpdateGeneral");
 
-  double unfilteredTimestamp = vtkPlusAccurateTimer::GetSystemTime();
-
-  double maxAllocatedProcessingTime = 2.0;
-  // set maxAllocatedProcessingTime to 2 acquisition periods to allow reading all transforms even when there aare slight delays
-  if (this->GetAcquisitionRate() > 2.0 / maxAllocatedProcessingTime)
-  {
-    maxAllocatedProcessingTime = 2.0 / this->GetAcquisitionRate();
-  }
-
-  igtl::MessageHeader::Pointer headerMsg;
-
-  bool moreMessagesPossible = true;
-  while (moreMessagesPossible)
-  {
-    if (ProcessTransformMessageGeneral(moreMessagesPossible) != PLUS_SUCCESS)
-    {
-      // an error occurred, stop processing the messages in this update iteration
-      break;
-    }
-    if (vtkPlusAccurateTimer::GetSystemTime() - unfilteredTimestamp > maxAllocatedProcessingTime)
-    {
-      // no more time for processing messages in this iteration
-      break;
-    }
-  }
+  PlusStatus status = StoreReceivedTransforms();
 
+  double unfilteredTimestamp = vtkPlusAccurateTimer::GetSystemTime();
   if (this->UseLastTransformsOnReceiveTimeout)
   {
     // Store all the other transforms with the last known value
@@ -267,26 +247,12 @@ PlusStatus vtkPlusOpenIGTLinkTracker::InternalUpdateGeneral()
     return PLUS_FAIL;
   }
 
-  return PLUS_SUCCESS;
+  return status;
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusOpenIGTLinkTracker::ProcessTransformMessageGeneral(bool& moreMessagesPossible)
+PlusStatus vtkPlusOpenIGTLinkTracker::ProcessTransformMessageGeneral(igtl::MessageHeader::Pointer headerMsg)
 {
-  igtl::MessageHeader::Pointer headerMsg;
-  ReceiveMessageHeaderWithErrorHandling(headerMsg);
-  if (headerMsg.IsNull())
-  {
-    // did not receive transform message, so there are no more available
-    moreMessagesPossible = false;
-    return PLUS_SUCCESS;
-  }
-
-  moreMessagesPossible = true;
-
-  // We've received valid header data
-  headerMsg->Unpack(this->IgtlMessageCrcCheckEnabled);
-
   // Accept TRANSFORM or POSITION message
   double unfilteredTimestampUtc = 0;
   vtkSmartPointer<vtkMatrix4x4> toolMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
@@ -321,8 +287,9 @@ PlusStatus vtkPlusOpenIGTLinkTracker::ProcessTransformMessageGeneral(bool& moreM
   PlusTransformName transformName;
   if (transformName.SetTransformName(igtlTransformName.c_str()) != PLUS_SUCCESS)
   {
+    // The message has been read completely, so the following messages can still be processed
     LOG_ERROR("Failed to update tracker tool - unrecognized transform name: " << igtlTransformName);
-    return PLUS_FAIL;
+    return PLUS_SUCCESS;
   }
 
   double unfilteredTimestamp = 0;
@@ -337,19 +304,33 @@ PlusStatus vtkPlusOpenIGTLinkTracker::ProcessTransformMessageGeneral(bool& moreM
     unfilteredTimestamp = vtkPlusAccurateTimer::GetSystemTime();
   }
 
-  // No need to filter already filtered timestamped items received over OpenIGTLink
-  // If the original timestamps are not used it's still safer not to use filtering, as filtering assumes uniform frame rate, which is not guaranteed
-  double filteredTimestamp = unfilteredTimestamp;
+  // Keep only the most recent value of each transform, it will be added to the buffer at the end of the update
+  ReceivedTransform& receivedTransform = this->ReceivedTransforms[transformName.GetTransformName()];
+  receivedTransform.Matrix = toolMatrix;
+  receivedTransform.Status = TOOL_OK;
+  receivedTransform.UnfilteredTimestamp = unfilteredTimestamp;
 
-  // Store the transform that we've just received
-  // TODO: we should not write it into the buffer until we have all the tools ready (if we are not using the original timestamps)
-  if (this->ToolTimeStampedUpdateWithoutFiltering(transformName.GetTransformName().c_str(), toolMatrix, TOOL_OK, unfilteredTimestamp, filteredTimestamp) != PLUS_SUCCESS)
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkTracker::StoreReceivedTransforms()
+{
+  PlusStatus status = PLUS_SUCCESS;
+  for (ReceivedTransformMapType::iterator it = this->ReceivedTransforms.begin(); it != this->ReceivedTransforms.end(); ++it)
   {
-    LOG_INFO("ToolTimeStampedUpdate failed for tool: " << transformName.GetTransformName() << " with timestamp: " << std::fixed << unfilteredTimestamp);
-    return PLUS_FAIL;
+    // No need to filter already filtered timestamped items received over OpenIGTLink
+    // If the original timestamps are not used it's still safer not to use filtering, as filtering assumes uniform frame rate, which is not guaranteed
+    double unfilteredTimestamp = it->second.UnfilteredTimestamp;
+    double filteredTimestamp = unfilteredTimestamp;
+    if (this->ToolTimeStampedUpdateWithoutFiltering(it->first, it->second.Matrix, it->second.Status, unfilteredTimestamp, filteredTimestamp) != PLUS_SUCCESS)
+    {
+      LOG_INFO("ToolTimeStampedUpdate failed for tool: " << it->first << " with timestamp: " << std::fixed << unfilteredTimestamp);
+      // DO NOT return here: we want to update the other tools.
+      status = PLUS_FAIL;
+    }
   }
-
-  return PLUS_SUCCESS;
+  return status;
 }
 
 //----------------------------------------------------------------------------
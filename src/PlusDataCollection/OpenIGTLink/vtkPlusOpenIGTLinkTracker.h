@@ -28,7 +28,11 @@ public:
   /*! Disconnect from device */
   virtual PlusStatus InternalDisconnect();
 
-  /*! Get an update from the tracking system and push the new transforms to the tools. This function is called by the tracker thread.*/
+  /*!
+    Receive all available messages and push the new transforms to the tools. This function is called by the tracker thread.
+    If a transform is received multiple times (because messages are queued up) then only the most recent value is stored,
+    so that the latency does not grow if the server sends data faster than the acquisition rate.
+  */
   PlusStatus InternalUpdate();
 
   /*! Read configuration from xml data */
@@ -58,15 +62,24 @@ protected:
 
   virtual PlusStatus SendRequestedMessageTypes();
 
-  /*! Process TRANSFORM or POSITION messages (add the received transform to the buffer) */
+  /*! Read a TRANSFORM, POSITION, or TDATA message and store the received transforms in ReceivedTransforms */
+  virtual PlusStatus ProcessReceivedMessage( igtl::MessageHeader::Pointer headerMsg );
+
+  /*! Add the transforms received in TRANSFORM or POSITION messages to the buffers */
   PlusStatus InternalUpdateGeneral();
 
   /*! Process a single TRANSFORM or POSITION message */
-  PlusStatus ProcessTransformMessageGeneral( bool& moreMessagesPossible );
+  PlusStatus ProcessTransformMessageGeneral( igtl::MessageHeader::Pointer headerMsg );
 
-  /*! Process a TDATA message (add all the received transforms to the buffers) */
+  /*! Add the transforms received in TDATA messages to the buffers */
   PlusStatus InternalUpdateTData();
 
+  /*! Process a single TDATA message */
+  PlusStatus ProcessTrackingDataMessage( igtl::MessageHeader::Pointer headerMsg );
+
+  /*! Add the transforms that were received in the current update to the buffers */
+  PlusStatus StoreReceivedTransforms();
+
   /*!
     Store the latest transforms again in the buffers with the provided timestamp.
     If no transforms are defined then identity transform will be stored.
@@ -95,6 +108,20 @@ protected:
   /*! igtl Factory for message handling */
   vtkSmartPointer<vtkPlusIgtlMessageFactory> IgtlMessageFactory;
 
+  struct ReceivedTransform
+  {
+    vtkSmartPointer<vtkMatrix4x4> Matrix;
+    ToolStatus Status;
+    double UnfilteredTimestamp;
+  };
+  typedef std::map<std::string, ReceivedTransform> ReceivedTransformMapType;
+
+  /*!
+    Transforms received in the current update, by transform name.
+    If a transform is received multiple times in the same update then only the most recent value is kept.
+  */
+  ReceivedTransformMapType ReceivedTransforms;
+
 private:
   vtkPlusOpenIGTLinkTracker( const vtkPlusOpenIGTLinkTracker& );
   void operator=( const vtkPlusOpenIGTLinkTracker& );
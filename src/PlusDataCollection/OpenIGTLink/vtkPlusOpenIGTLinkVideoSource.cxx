@@ -8,12 +8,15 @@ See License.txt for details.
 #include "vtkPlusOpenIGTLinkVideoSource.h"
 
 #include "igtlImageMessage.h"
+#include "igtlPlusCompressedImageMessage.h"
 #include "PlusVideoFrame.h"
 #include "PlusTrackedFrame.h"
 #include "vtkImageData.h"
+#include "vtkMatrix4x4.h"
 #include "vtkObjectFactory.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
+#include "vtkPlusIgtlImageCompressor.h"
 #include "vtkPlusIgtlMessageCommon.h"
 
 vtkStandardNewMacro(vtkPlusOpenIGTLinkVideoSource);
@@ -46,40 +49,80 @@ PlusStatus vtkPlusOpenIGTLinkVideoSource::InternalUpdate()
     return PLUS_SUCCESS;
   }
 
-  igtl::MessageHeader::Pointer headerMsg;
-  if (ReceiveMessageHeader(headerMsg) == PLUS_FAIL)
+  // Add all the frames that are already received, so that they don't pile up in the socket buffer
+  int numberOfReceivedMessages = 0;
+  if (this->ReceiveAvailableMessages(numberOfReceivedMessages) != PLUS_SUCCESS)
   {
     if (!this->IsRecording() || !this->GetConnected())
     {
       // Disconnect while waiting for message, exit gracefully
       return PLUS_SUCCESS;
     }
-    OnReceiveTimeout();
     return PLUS_FAIL;
   }
 
-  if (headerMsg == nullptr)
-  {
-    // Not a problem, just no messages received this timeout period
-    return PLUS_SUCCESS;
-  }
-
-  // We've received valid header data
-  headerMsg->Unpack(this->IgtlMessageCrcCheckEnabled);
+  // Not a problem if no messages are received, just wait for them in the next update
+  return PLUS_SUCCESS;
+}
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkVideoSource::ProcessReceivedMessage(igtl::MessageHeader::Pointer headerMsg)
+{
   // Set unfiltered and filtered timestamp by converting UTC to system timestamp
   double unfilteredTimestamp = vtkPlusAccurateTimer::GetSystemTime();
 
   PlusTrackedFrame trackedFrame;
+  PlusVideoFrame* videoFrame = NULL;
+  bool adoptVideoFrame = false;
   igtl::MessageBase::Pointer bodyMsg = IgtlMessageFactory->CreateReceiveMessage(headerMsg);
 
   if (typeid(*bodyMsg) == typeid(igtl::ImageMessage))
   {
-    if (vtkPlusIgtlMessageCommon::UnpackImageMessage(bodyMsg, this->ClientSocket, trackedFrame, this->ImageMessageEmbeddedTransformName, this->IgtlMessageCrcCheckEnabled) != PLUS_SUCCESS)
+    // Pixel data is received directly into a recycled frame, which is then adopted by the video buffer without copying
+    double imageTimestampUtc = 0;
+    vtkSmartPointer<vtkMatrix4x4> ijkToRasMatrix;
+    if (this->ImageMessageEmbeddedTransformName.IsValid())
+    {
+      ijkToRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    }
+    if (vtkPlusIgtlMessageCommon::UnpackImageMessage(bodyMsg, this->ClientSocket, this->ReceivedImageFrame, imageTimestampUtc, ijkToRasMatrix, this->IgtlMessageCrcCheckEnabled) != PLUS_SUCCESS)
     {
       LOG_ERROR("Couldn't get image from OpenIGTLink server!");
       return PLUS_FAIL;
     }
+    if (ijkToRasMatrix != NULL)
+    {
+      trackedFrame.SetCustomFrameTransform(this->ImageMessageEmbeddedTransformName, ijkToRasMatrix);
+    }
+    videoFrame = &this->ReceivedImageFrame;
+    adoptVideoFrame = true;
+  }
+  else if (typeid(*bodyMsg) == typeid(igtl::PlusCompressedImageMessage))
+  {
+    // Pixel data is decompressed into a recycled frame, the same way as IMAGE messages are received
+    vtkSmartPointer<vtkPlusIgtlImageCompressor>& decompressor = this->ImageDecompressors[headerMsg->GetDeviceName()];
+    if (decompressor.GetPointer() == NULL)
+    {
+      decompressor = vtkSmartPointer<vtkPlusIgtlImageCompressor>::New();
+    }
+    double imageTimestampUtc = 0;
+    vtkSmartPointer<vtkMatrix4x4> ijkToRasMatrix;
+    if (this->ImageMessageEmbeddedTransformName.IsValid())
+    {
+      ijkToRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    }
+    if (vtkPlusIgtlMessageCommon::UnpackCompressedImageMessage(bodyMsg, this->ClientSocket, decompressor, this->ReceivedImageFrame, imageTimestampUtc, ijkToRasMatrix, this->IgtlMessageCrcCheckEnabled) != PLUS_SUCCESS)
+    {
+      // The message has been read completely, the following key frame can still be decoded
+      LOG_ERROR("Couldn't get compressed image from OpenIGTLink server!");
+      return PLUS_FAIL;
+    }
+    if (ijkToRasMatrix != NULL)
+    {
+      trackedFrame.SetCustomFrameTransform(this->ImageMessageEmbeddedTransformName, ijkToRasMatrix);
+    }
+    videoFrame = &this->ReceivedImageFrame;
+    adoptVideoFrame = true;
   }
   else if (typeid(*bodyMsg) == typeid(igtl::PlusTrackedFrameMessage))
   {
@@ -95,6 +138,7 @@ PlusStatus vtkPlusOpenIGTLinkVideoSource::InternalUpdate()
       // The received timestamp is in UTC and timestamps in the buffer are in system time, so conversion is needed
       unfilteredTimestamp = vtkPlusAccurateTimer::GetSystemTimeFromUniversalTime(unfilteredTimestampUtc);
     }
+    videoFrame = trackedFrame.GetImageData();
   }
   else
   {
@@ -119,25 +163,34 @@ PlusStatus vtkPlusOpenIGTLinkVideoSource::InternalUpdate()
     return PLUS_FAIL;
   }
 
+  if (videoFrame == NULL)
+  {
+    LOG_ERROR("Invalid video frame received, cannot add it to the video buffer");
+    return PLUS_FAIL;
+  }
+
   // If the buffer is empty, set the pixel type and frame size to the first received properties
   if (aSource->GetNumberOfItems() == 0)
   {
-    PlusVideoFrame* videoFrame = trackedFrame.GetImageData();
-    if (videoFrame == NULL)
-    {
-      LOG_ERROR("Invalid video frame received, cannot use it to initialize the video buffer");
-      return PLUS_FAIL;
-    }
+    unsigned int frameSize[3] = { 0, 0, 0 };
+    videoFrame->GetFrameSize(frameSize);
     aSource->SetPixelType(videoFrame->GetVTKScalarPixelType());
     aSource->SetNumberOfScalarComponents(videoFrame->GetNumberOfScalarComponents());
     aSource->SetImageType(videoFrame->GetImageType());
-    aSource->SetInputFrameSize(trackedFrame.GetFrameSize());
+    aSource->SetInputFrameSize(frameSize);
   }
   PlusTrackedFrame::FieldMapType customFields = trackedFrame.GetCustomFields();
-  PlusStatus status = aSource->AddItem(trackedFrame.GetImageData(), this->FrameNumber, unfilteredTimestamp, filteredTimestamp, &customFields);
+  PlusStatus addItemStatus = adoptVideoFrame
+                             ? aSource->AddItemAdoptFrame(*videoFrame, this->FrameNumber, unfilteredTimestamp, filteredTimestamp, &customFields)
+                             : aSource->AddItem(videoFrame, this->FrameNumber, unfilteredTimestamp, filteredTimestamp, &customFields);
+  if (addItemStatus != PLUS_SUCCESS)
+  {
+    // The message has been read completely, so the following messages can still be processed
+    LOG_DEBUG("Failed to add frame to the video buffer of device " << this->GetDeviceId() << " with timestamp: " << std::fixed << unfilteredTimestamp);
+  }
   this->Modified();
 
-  return status;
+  return PLUS_SUCCESS;
 }
 
 //-----------------------------------------------------------------------------
@@ -145,6 +198,11 @@ PlusStatus vtkPlusOpenIGTLinkVideoSource::ReadConfiguration(vtkXMLDataElement* r
 {
   XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_READING(deviceConfig, rootConfigElement);
   XML_READ_CSTRING_ATTRIBUTE_OPTIONAL(ImageMessageEmbeddedTransformName, deviceConfig);
+  if (!this->ImageCompression.empty() && !this->ImageStream.IsValid() && this->ImageMessageEmbeddedTransformName.IsValid())
+  {
+    // Compression is requested per image stream, so request the image stream that has the embedded transform
+    this->SetImageStream(this->ImageMessageEmbeddedTransformName);
+  }
   return PLUS_SUCCESS;
 }
 
@@ -11,6 +11,7 @@
 #include "vtkPlusDataCollectionExport.h"
 #include "vtkPlusOpenIGTLinkDevice.h"
 #include "vtkPlusIgtlMessageFactory.h"
+#include "PlusVideoFrame.h"
 
 /*!
   \class vtkPlusOpenIGTLinkVideoSource
@@ -27,7 +28,7 @@ public:
   vtkTypeMacro( vtkPlusOpenIGTLinkVideoSource, vtkPlusOpenIGTLinkDevice );
   virtual void PrintSelf( ostream& os, vtkIndent indent );
 
-  /*! Get an update from the tracking system and push the new transforms to the tools. This function is called by the tracker thread.*/
+  /*! Receive all available image messages and add the frames to the video buffer. This function is called by the data capture thread.*/
   PlusStatus InternalUpdate();
 
   /*! Read configuration from xml data */
@@ -50,12 +51,24 @@ protected:
   vtkPlusOpenIGTLinkVideoSource();
   virtual ~vtkPlusOpenIGTLinkVideoSource();
 
+  /*! Read an IMAGE, COMPIMAGE, or TRACKEDFRAME message and add the frame to the video buffer */
+  virtual PlusStatus ProcessReceivedMessage( igtl::MessageHeader::Pointer headerMsg );
+
   /*! Name of the transform that is supplied with the IMAGE OpenIGTLink message */
   PlusTransformName ImageMessageEmbeddedTransformName;
 
   /*! igtl Factory for message handling */
   vtkSmartPointer<vtkPlusIgtlMessageFactory> IgtlMessageFactory;
 
+  /*!
+    Frame that IMAGE message pixel data is received into. It is swapped into the video buffer when the frame is added,
+    and then it holds the pixel buffer of the overwritten buffer item, so no memory allocation or copying is needed for the next frame.
+  */
+  PlusVideoFrame ReceivedImageFrame;
+
+  /*! Decompressors for COMPIMAGE messages, indexed by device name. They keep the previous frame for decoding delta compressed frames. */
+  vtkPlusIgtlMessageFactory::ImageCompressorMapType ImageDecompressors;
+
 private:
   vtkPlusOpenIGTLinkVideoSource( const vtkPlusOpenIGTLinkVideoSource& ); // Not implemented.
   void operator=( const vtkPlusOpenIGTLinkVideoSource& ); // Not implemented.
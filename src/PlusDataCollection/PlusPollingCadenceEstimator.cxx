@@ -0,0 +1,170 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusPollingCadenceEstimator.h"
+
+#include <algorithm>
+
+namespace
+{
+  // Number of item intervals that have to be observed before the delivery time is predicted
+  const int MIN_NUMBER_OF_INTERVALS_FOR_LOCK = 5;
+  // Weight of a new interval in the running average of the period
+  const double PERIOD_ADAPTATION_RATE = 0.1;
+  // Latency change if the item was already available at the first poll (fraction of the period)
+  const double LATENCY_DECREASE_PERIOD_FRACTION = 0.005;
+  // Latency change after an empty poll at or after the predicted availability time (fraction of the period)
+  const double LATENCY_INCREASE_PERIOD_FRACTION = 0.05;
+  // If an item is late then the device is polled again after this fraction of the period
+  const double RETRY_PERIOD_FRACTION = 0.1;
+  // If no item is received for this many periods then the estimates are relearned
+  const double LOCK_LOSS_PERIODS = 4.0;
+  // The first poll for the next item is at least this fraction of the period shorter than the period after the poll that found the previous item
+  const double PERIOD_MARGIN_FRACTION = 0.25;
+  // Minimum time between polls
+  const double MIN_POLL_INTERVAL_SEC = 0.001;
+  // Minimum time between polls once the period is learned (fraction of the period)
+  const double MIN_POLL_INTERVAL_PERIOD_FRACTION = 0.1;
+  // An item that is retrieved within this fraction of the period after its timestamp looks like it was created by the poll
+  const double POLL_DRIVEN_MAX_DELAY_PERIOD_FRACTION = 0.02;
+  // Number of consecutive items that have to look like created by the poll to consider the device poll-driven
+  const int MIN_NUMBER_OF_ITEMS_FOR_POLL_DRIVEN = 20;
+}
+
+//----------------------------------------------------------------------------
+PlusPollingCadenceEstimator::PlusPollingCadenceEstimator()
+{
+  this->Reset();
+}
+
+//----------------------------------------------------------------------------
+void PlusPollingCadenceEstimator::Reset()
+{
+  this->HasItem = false;
+  this->Locked = false;
+  this->LastItemUid = 0;
+  this->LastItemTimestampSec = 0.0;
+  this->LastDetectionTimeSec = 0.0;
+  this->NumberOfIntervals = 0;
+  this->PeriodSec = 0.0;
+  this->LatencySec = 0.0;
+  this->LastPhaseErrorSec = 0.0;
+  this->NextItemLate = false;
+  this->NumberOfPollDrivenItems = 0;
+  this->PollDriven = false;
+}
+
+//----------------------------------------------------------------------------
+bool PlusPollingCadenceEstimator::Update(double pollTimeSec, BufferItemUidType latestItemUid, double latestItemTimestampSec)
+{
+  if (this->HasItem && latestItemUid == this->LastItemUid)
+  {
+    // No new item
+    if (this->Locked)
+    {
+      if (pollTimeSec - this->LastDetectionTimeSec > LOCK_LOSS_PERIODS * this->PeriodSec)
+      {
+        // The device stopped delivering data or its rate changed significantly
+        this->Locked = false;
+        this->NumberOfIntervals = 0;
+      }
+      else if (pollTimeSec >= this->LastItemTimestampSec + this->PeriodSec + this->LatencySec)
+      {
+        // The item is not available yet at the predicted time
+        this->LatencySec += LATENCY_INCREASE_PERIOD_FRACTION * this->PeriodSec;
+        this->NextItemLate = true;
+      }
+    }
+    // A device that creates an item at each poll never has empty polls
+    this->NumberOfPollDrivenItems = 0;
+    this->PollDriven = false;
+    return false;
+  }
+
+  const double delaySec = pollTimeSec - latestItemTimestampSec;
+  if (!this->HasItem || latestItemUid < this->LastItemUid)
+  {
+    // First item or the buffer was cleared
+    this->HasItem = true;
+    this->NumberOfIntervals = 0;
+    this->Locked = false;
+    this->LatencySec = std::max(0.0, delaySec);
+    this->NumberOfPollDrivenItems = 0;
+    this->PollDriven = false;
+  }
+  else if (latestItemTimestampSec > this->LastItemTimestampSec)
+  {
+    if (this->Locked)
+    {
+      const double predictedAvailabilityTimeSec = this->LastItemTimestampSec + this->PeriodSec + this->LatencySec;
+      this->LastPhaseErrorSec = pollTimeSec - predictedAvailabilityTimeSec;
+
+      // If the device timestamps the items when it is polled (e.g., it reads the current value of a sensor) then each item
+      // is available right at its timestamp and the learned period is just the time between polls: polling earlier would
+      // only make the learned period shorter. Such a device is polled at the learned period instead of the predicted time.
+      if (!this->NextItemLate && delaySec < POLL_DRIVEN_MAX_DELAY_PERIOD_FRACTION * this->PeriodSec)
+      {
+        this->NumberOfPollDrivenItems++;
+      }
+      else
+      {
+        this->NumberOfPollDrivenItems = 0;
+      }
+      this->PollDriven = (this->NumberOfPollDrivenItems >= MIN_NUMBER_OF_ITEMS_FOR_POLL_DRIVEN);
+
+      if (!this->NextItemLate && !this->PollDriven)
+      {
+        // The item was available at the first poll, maybe it would have been available earlier.
+        // Items are never available before their timestamp (a device that timestamps items when it is polled would be polled faster and faster).
+        this->LatencySec = std::max(0.0, this->LatencySec - LATENCY_DECREASE_PERIOD_FRACTION * this->PeriodSec);
+      }
+    }
+    else
+    {
+      // While the polling is not locked to the items, the smallest delay is the best estimate of the latency
+      this->LatencySec = std::max(0.0, this->NumberOfIntervals == 0 ? delaySec : std::min(this->LatencySec, delaySec));
+    }
+
+    const double intervalSec = (latestItemTimestampSec - this->LastItemTimestampSec) / (latestItemUid - this->LastItemUid);
+    this->PeriodSec = (this->NumberOfIntervals == 0 ? intervalSec : this->PeriodSec + PERIOD_ADAPTATION_RATE * (intervalSec - this->PeriodSec));
+    this->NumberOfIntervals++;
+    this->Locked = (this->NumberOfIntervals >= MIN_NUMBER_OF_INTERVALS_FOR_LOCK);
+  }
+
+  this->LastItemUid = latestItemUid;
+  this->LastItemTimestampSec = latestItemTimestampSec;
+  this->LastDetectionTimeSec = pollTimeSec;
+  this->NextItemLate = false;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+double PlusPollingCadenceEstimator::GetNextPollTime(double pollTimeSec, double fallbackPeriodSec) const
+{
+  if (!this->Locked)
+  {
+    return pollTimeSec + fallbackPeriodSec;
+  }
+  if (this->PollDriven)
+  {
+    return pollTimeSec + this->PeriodSec;
+  }
+
+  double nextPollTimeSec = this->LastItemTimestampSec + this->PeriodSec + std::max(0.0, this->LatencySec);
+  if (nextPollTimeSec <= pollTimeSec)
+  {
+    // The item is late, check again soon
+    nextPollTimeSec = pollTimeSec + RETRY_PERIOD_FRACTION * this->PeriodSec;
+  }
+  else
+  {
+    // Do not poll for the next item much sooner than one period after the previous item was found
+    nextPollTimeSec = std::max(nextPollTimeSec, this->LastDetectionTimeSec + (1.0 - PERIOD_MARGIN_FRACTION) * this->PeriodSec);
+  }
+  // The poll rate is bounded relative to the learned rate (not by the fallback rate, which may be lower than the delivery rate)
+  return std::max(nextPollTimeSec, pollTimeSec + std::max(MIN_POLL_INTERVAL_PERIOD_FRACTION * this->PeriodSec, MIN_POLL_INTERVAL_SEC));
+}
@@ -0,0 +1,98 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusPollingCadenceEstimator_h
+#define __PlusPollingCadenceEstimator_h
+
+#include "vtkPlusDataCollectionExport.h"
+#include "PlusStreamBufferItem.h"
+
+/*!
+  \class PlusPollingCadenceEstimator
+  \brief Estimates when a polled device delivers new data, to poll it right after the data becomes available
+
+  After each poll the timestamp and UID of the latest item in the buffer of the device are passed to Update().
+  The estimator learns the period between consecutive items (from the item timestamps) and the latency between the
+  item timestamp and the time when the item can be retrieved by polling. Once the period is known, GetNextPollTime()
+  returns the predicted availability time of the next item. If the item is not available yet at that time then
+  the device is polled again after a small fraction of the period. The time between polls is never shorter than
+  a small fraction of the learned period, and the first poll for the next item is not much sooner than one learned
+  period after the poll that found the previous item. The fallback period (the period of the acquisition rate of the
+  device) does not limit the polling, so the device is polled at its delivery rate even if that is higher.
+
+  The latency is locked to the availability of the items: it is decreased by a small step if an item is already
+  available at the first poll, and increased by a larger step after each empty poll. The ratio of the steps
+  makes about one item out of ten require an additional poll, which keeps the polling delay low even if the
+  delivery times are jittery. The latency is never negative.
+
+  A device that timestamps its items when it is polled looks like its items are available right at their timestamp,
+  and its learned period is just the time between polls. If many consecutive items are retrieved at their timestamp
+  without any empty poll then the device is considered poll-driven and it is polled at the learned period (which
+  was learned while polling at the fallback period), so its polling does not get faster and faster.
+
+  The phase error is the time between the predicted availability of an item and the poll that found it.
+
+  All times are in seconds, in the same time reference as the item timestamps (system time).
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusPollingCadenceEstimator
+{
+public:
+  PlusPollingCadenceEstimator();
+
+  /*! Forget all the estimates (e.g., when recording is restarted) */
+  void Reset();
+
+  /*!
+    Process the result of a poll.
+    \param pollTimeSec Time of the poll
+    \param latestItemUid UID of the latest item in the buffer after the poll
+    \param latestItemTimestampSec Timestamp of the latest item in the buffer after the poll
+    \return True if the poll found new items
+  */
+  bool Update(double pollTimeSec, BufferItemUidType latestItemUid, double latestItemTimestampSec);
+
+  /*!
+    Time of the next poll.
+    \param pollTimeSec Time of the last poll
+    \param fallbackPeriodSec Polling period that is used until the delivery period of the device is learned
+  */
+  double GetNextPollTime(double pollTimeSec, double fallbackPeriodSec) const;
+
+  /*! True if enough items were observed to predict the delivery time of the next item */
+  bool IsLocked() const { return this->Locked; }
+
+  /*! True if the device seems to create the items when it is polled (then it is polled at the learned period) */
+  bool IsPollDriven() const { return this->PollDriven; }
+
+  /*! Estimated time between consecutive items. 0 if not known yet. */
+  double GetEstimatedPeriodSec() const { return this->NumberOfIntervals > 0 ? this->PeriodSec : 0.0; }
+
+  /*! Estimated time between the item timestamp and the time when the item can be retrieved by polling */
+  double GetEstimatedLatencySec() const { return this->LatencySec; }
+
+  /*! Phase error of the last poll that found new items (only valid if the estimator is locked) */
+  double GetLastPhaseErrorSec() const { return this->LastPhaseErrorSec; }
+
+protected:
+  bool HasItem;
+  bool Locked;
+  BufferItemUidType LastItemUid;
+  double LastItemTimestampSec;
+  double LastDetectionTimeSec;
+  int NumberOfIntervals;
+  double PeriodSec;
+  double LatencySec;
+  double LastPhaseErrorSec;
+  /*! True if there was an empty poll after the predicted availability time of the next item */
+  bool NextItemLate;
+  /*! Number of consecutive items that were retrieved at their timestamp, without an empty poll */
+  int NumberOfPollDrivenItems;
+  bool PollDriven;
+};
+
+#endif
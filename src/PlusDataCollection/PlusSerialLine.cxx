@@ -6,12 +6,90 @@
 
 #include "PlusConfigure.h"
 #include "PlusSerialLine.h"
+#include "vtkPlusAccurateTimer.h"
+
+#include <algorithm>
+#include <string.h>
+
+#ifndef _WIN32
+  #include <errno.h>
+  #include <fcntl.h>
+  #include <poll.h>
+  #include <sys/ioctl.h>
+  #include <termios.h>
+  #include <unistd.h>
+#endif
+
+namespace
+{
+  /*! Maximum number of bytes that are read from the port at once */
+  const int READ_CHUNK_SIZE = 4096;
+
+  //----------------------------------------------------------------------------
+  /*! Milliseconds remaining until the deadline (in system time), 0 if the deadline has passed */
+  int GetRemainingTimeMs(double deadlineSec)
+  {
+    double remainingSec = deadlineSec - vtkPlusAccurateTimer::GetSystemTime();
+    return (remainingSec > 0 ? static_cast<int>(remainingSec * 1000.0 + 0.5) : 0);
+  }
+
+#ifndef _WIN32
+  //----------------------------------------------------------------------------
+  bool GetPosixSpeed(unsigned long speed, speed_t& posixSpeed)
+  {
+    switch (speed)
+    {
+      case 1200: posixSpeed = B1200; return true;
+      case 2400: posixSpeed = B2400; return true;
+      case 4800: posixSpeed = B4800; return true;
+      case 9600: posixSpeed = B9600; return true;
+      case 19200: posixSpeed = B19200; return true;
+      case 38400: posixSpeed = B38400; return true;
+      case 57600: posixSpeed = B57600; return true;
+      case 115200: posixSpeed = B115200; return true;
+      case 230400: posixSpeed = B230400; return true;
+#ifdef B460800
+      case 460800: posixSpeed = B460800; return true;
+#endif
+#ifdef B921600
+      case 921600: posixSpeed = B921600; return true;
+#endif
+      default:
+        return false;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Wait for the requested poll event, returns the poll() result (retried if interrupted by a signal) */
+  int PollHandle(int handle, short events, int timeoutMs, short& returnedEvents)
+  {
+    struct pollfd pollDescriptor;
+    pollDescriptor.fd = handle;
+    pollDescriptor.events = events;
+    pollDescriptor.revents = 0;
+    int result = 0;
+    do
+    {
+      result = poll(&pollDescriptor, 1, timeoutMs);
+    }
+    while (result < 0 && errno == EINTR);
+    returnedEvents = pollDescriptor.revents;
+    return result;
+  }
+#endif
+}
 
 //----------------------------------------------------------------------------
 SerialLine::SerialLine()
   : MaxReplyTime(1000)
   , SerialPortSpeed(9600)
   , CommHandle(INVALID_HANDLE_VALUE)
+  , ReadMinimumCharacters(0)
+  , ReadCharacterTimeoutDeciSec(0)
+  , ReadBufferStart(0)
+#ifdef _WIN32
+  , CurrentReadTimeoutMs(-1)
+#endif
 {
 
 }
@@ -28,13 +106,17 @@ SerialLine::~SerialLine()
 //----------------------------------------------------------------------------
 void SerialLine::Close()
 {
-#ifdef _WIN32
   if (CommHandle != INVALID_HANDLE_VALUE)
   {
+#ifdef _WIN32
     CloseHandle(CommHandle);
-  }
+#else
+    close(CommHandle);
 #endif
+  }
   CommHandle = INVALID_HANDLE_VALUE;
+  this->ReadBuffer.clear();
+  this->ReadBufferStart = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -75,11 +157,13 @@ bool SerialLine::Open()
     return false;
   }
 
+  // Reads return as soon as at least one byte is available or when the read timeout expires
+  // (the read timeout is set before each read, see FillReadBuffer)
   COMMTIMEOUTS timeouts;
   GetCommTimeouts(CommHandle, &timeouts);
-  timeouts.ReadIntervalTimeout = 200;
-  timeouts.ReadTotalTimeoutConstant = MaxReplyTime;
-  timeouts.ReadTotalTimeoutMultiplier = 100;
+  timeouts.ReadIntervalTimeout = MAXDWORD;
+  timeouts.ReadTotalTimeoutConstant = (MaxReplyTime > 0 ? MaxReplyTime : 1);
+  timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
   timeouts.WriteTotalTimeoutConstant = MaxReplyTime;
   timeouts.WriteTotalTimeoutMultiplier = 100;
   if (!SetCommTimeouts(CommHandle, &timeouts))
@@ -87,12 +171,71 @@ bool SerialLine::Open()
     Close();
     return false;
   }
+  this->CurrentReadTimeoutMs = timeouts.ReadTotalTimeoutConstant;
 
   return true;
 #else
-  LOG_ERROR("SerialLine::Open() is only implemented on Windows");
-  CommHandle = INVALID_HANDLE_VALUE;
-  return false;
+  // Open in non-blocking mode, so that opening does not wait for the carrier detect signal
+  CommHandle = open(this->PortName.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (CommHandle == INVALID_HANDLE_VALUE)
+  {
+    LOG_DEBUG("Failed to open serial port " << this->PortName << ": " << strerror(errno));
+    return false;
+  }
+
+  speed_t speed;
+  if (!GetPosixSpeed(SerialPortSpeed, speed))
+  {
+    LOG_ERROR("Unsupported serial port speed: " << SerialPortSpeed);
+    Close();
+    return false;
+  }
+
+  struct termios options;
+  if (tcgetattr(CommHandle, &options) != 0)
+  {
+    LOG_ERROR("Failed to get serial port attributes of " << this->PortName << ": " << strerror(errno));
+    Close();
+    return false;
+  }
+
+  // Raw mode: no line editing, echo, signals, or character translation; 8 data bits, no parity, 1 stop bit
+  options.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF | IXANY);
+  options.c_oflag &= ~OPOST;
+  options.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+  options.c_cflag &= ~(CSIZE | PARENB | CSTOPB);
+#ifdef CRTSCTS
+  options.c_cflag &= ~CRTSCTS;
+#endif
+  options.c_cflag |= CS8 | CLOCAL | CREAD;
+  options.c_cc[VMIN] = this->ReadMinimumCharacters;
+  options.c_cc[VTIME] = this->ReadCharacterTimeoutDeciSec;
+  cfsetispeed(&options, speed);
+  cfsetospeed(&options, speed);
+  if (tcsetattr(CommHandle, TCSANOW, &options) != 0)
+  {
+    LOG_ERROR("Failed to set serial port attributes of " << this->PortName << ": " << strerror(errno));
+    Close();
+    return false;
+  }
+
+  // Discard any data that was received before the port was opened
+  tcflush(CommHandle, TCIOFLUSH);
+
+  if (this->ReadMinimumCharacters > 0 || this->ReadCharacterTimeoutDeciSec > 0)
+  {
+    // VMIN and VTIME only have an effect in blocking mode. A read is only started when poll() reports
+    // available data, so the read blocks only until VMIN bytes are collected or VTIME expires.
+    int flags = fcntl(CommHandle, F_GETFL, 0);
+    if (flags < 0 || fcntl(CommHandle, F_SETFL, flags & ~O_NONBLOCK) < 0)
+    {
+      LOG_ERROR("Failed to set blocking mode for serial port " << this->PortName << ": " << strerror(errno));
+      Close();
+      return false;
+    }
+  }
+
+  return true;
 #endif
 }
 
@@ -129,8 +272,39 @@ int SerialLine::Write(const BYTE* data, int numberOfBytesToWrite)
   }
   return numberOfBytesWrittenTotal;
 #else
-  LOG_ERROR("SerialLine::Write() is only implemented on Windows");
-  return 0;
+  if (CommHandle == INVALID_HANDLE_VALUE)
+  {
+    LOG_ERROR("Failed to write to serial port: port is not open");
+    return 0;
+  }
+  double deadlineSec = vtkPlusAccurateTimer::GetSystemTime() + MaxReplyTime / 1000.0;
+  int numberOfBytesWrittenTotal = 0;
+  while (numberOfBytesWrittenTotal < numberOfBytesToWrite)
+  {
+    ssize_t numberOfBytesWritten = write(CommHandle, &data[numberOfBytesWrittenTotal], numberOfBytesToWrite - numberOfBytesWrittenTotal);
+    if (numberOfBytesWritten > 0)
+    {
+      numberOfBytesWrittenTotal += static_cast<int>(numberOfBytesWritten);
+      continue;
+    }
+    if (numberOfBytesWritten < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (numberOfBytesWritten < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+      LOG_ERROR("Failed to write to serial port " << this->PortName << ": " << strerror(errno));
+      break;
+    }
+    // Output buffer is full, wait until there is space in it
+    short returnedEvents = 0;
+    if (PollHandle(CommHandle, POLLOUT, GetRemainingTimeMs(deadlineSec), returnedEvents) <= 0 || !(returnedEvents & POLLOUT))
+    {
+      // timed out
+      break;
+    }
+  }
+  return numberOfBytesWrittenTotal;
 #endif
 }
 
@@ -141,47 +315,203 @@ bool SerialLine::Write(const BYTE data)
 }
 
 //----------------------------------------------------------------------------
-int SerialLine::Read(BYTE* data, int maxNumberOfBytesToRead)
+int SerialLine::FillReadBuffer(int timeoutMs)
 {
+  if (CommHandle == INVALID_HANDLE_VALUE)
+  {
+    return -1;
+  }
+
+  // Reclaim the space of the already read bytes
+  if (this->ReadBufferStart > 0 && this->ReadBufferStart == this->ReadBuffer.size())
+  {
+    this->ReadBuffer.clear();
+    this->ReadBufferStart = 0;
+  }
+  else if (this->ReadBufferStart > READ_CHUNK_SIZE)
+  {
+    this->ReadBuffer.erase(0, this->ReadBufferStart);
+    this->ReadBufferStart = 0;
+  }
+
+  char chunk[READ_CHUNK_SIZE];
+
 #ifdef _WIN32
+  // With ReadIntervalTimeout = ReadTotalTimeoutMultiplier = MAXDWORD, ReadFile returns immediately if there are
+  // bytes in the input queue, otherwise it returns as soon as a byte is received or the total timeout expires.
+  // Both timeouts set to MAXDWORD with 0 constant is not allowed, therefore the shortest wait is 1ms.
+  int readTimeoutMs = (timeoutMs > 0 ? timeoutMs : 1);
+  if (readTimeoutMs != this->CurrentReadTimeoutMs)
+  {
+    COMMTIMEOUTS timeouts;
+    GetCommTimeouts(CommHandle, &timeouts);
+    timeouts.ReadIntervalTimeout = MAXDWORD;
+    timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
+    timeouts.ReadTotalTimeoutConstant = readTimeoutMs;
+    if (!SetCommTimeouts(CommHandle, &timeouts))
+    {
+      LOG_ERROR("Failed to set serial port read timeout");
+      return -1;
+    }
+    this->CurrentReadTimeoutMs = readTimeoutMs;
+  }
+
+  DWORD numberOfBytesRead = 0;
+  if (ReadFile(CommHandle, chunk, READ_CHUNK_SIZE, &numberOfBytesRead, NULL) == FALSE)
+  {
+    if (GetLastError() == ERROR_OPERATION_ABORTED)
+    {
+      // system error: clear error, the caller may retry
+      DWORD errors = 0;
+      ClearCommError(CommHandle, &errors, NULL);
+      return 0;
+    }
+    return -1;
+  }
+  this->ReadBuffer.append(chunk, numberOfBytesRead);
+  return static_cast<int>(numberOfBytesRead);
+#else
+  short returnedEvents = 0;
+  int pollResult = PollHandle(CommHandle, POLLIN, timeoutMs, returnedEvents);
+  if (pollResult == 0)
+  {
+    // timed out
+    return 0;
+  }
+  if (pollResult < 0 || !(returnedEvents & POLLIN))
+  {
+    // error or hang-up without any data
+    return -1;
+  }
+
+  ssize_t numberOfBytesRead = 0;
+  do
+  {
+    numberOfBytesRead = read(CommHandle, chunk, READ_CHUNK_SIZE);
+  }
+  while (numberOfBytesRead < 0 && errno == EINTR);
+  if (numberOfBytesRead < 0)
+  {
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+  }
+  this->ReadBuffer.append(chunk, numberOfBytesRead);
+  return static_cast<int>(numberOfBytesRead);
+#endif
+}
+
+//----------------------------------------------------------------------------
+unsigned int SerialLine::GetNumberOfBufferedBytes() const
+{
+  return static_cast<unsigned int>(this->ReadBuffer.size() - this->ReadBufferStart);
+}
+
+//----------------------------------------------------------------------------
+void SerialLine::ConsumeBufferedBytes(unsigned int numberOfBytes)
+{
+  this->ReadBufferStart += std::min(numberOfBytes, this->GetNumberOfBufferedBytes());
+}
+
+//----------------------------------------------------------------------------
+int SerialLine::Read(BYTE* data, int maxNumberOfBytesToRead)
+{
+  double deadlineSec = vtkPlusAccurateTimer::GetSystemTime() + MaxReplyTime / 1000.0;
   int numberOfBytesReadTotal = 0;
-  while (maxNumberOfBytesToRead > 0)
+  while (numberOfBytesReadTotal < maxNumberOfBytesToRead)
   {
-    DWORD numberOfBytesRead;
-    if (ReadFile(CommHandle, &data[numberOfBytesReadTotal], maxNumberOfBytesToRead, &numberOfBytesRead, NULL) == FALSE)
+    unsigned int numberOfBytesToCopy = std::min(this->GetNumberOfBufferedBytes(), static_cast<unsigned int>(maxNumberOfBytesToRead - numberOfBytesReadTotal));
+    if (numberOfBytesToCopy > 0)
     {
-      DWORD lastError = GetLastError();
-      if (lastError == ERROR_OPERATION_ABORTED)
+      memcpy(&data[numberOfBytesReadTotal], this->ReadBuffer.data() + this->ReadBufferStart, numberOfBytesToCopy);
+      this->ConsumeBufferedBytes(numberOfBytesToCopy);
+      numberOfBytesReadTotal += numberOfBytesToCopy;
+      continue;
+    }
+    if (this->FillReadBuffer(GetRemainingTimeMs(deadlineSec)) <= 0)
+    {
+      // timed out or error
+      break;
+    }
+  }
+  return numberOfBytesReadTotal;
+}
+
+//----------------------------------------------------------------------------
+bool SerialLine::Read(BYTE& data)
+{
+  return Read(&data, 1) == 1;
+}
+
+//----------------------------------------------------------------------------
+bool SerialLine::WaitForData(int timeoutMs)
+{
+  if (this->GetNumberOfBufferedBytes() > 0)
+  {
+    return true;
+  }
+  return this->FillReadBuffer(timeoutMs) > 0;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus SerialLine::ReadLine(std::string& line, const std::string& lineEnding, int timeoutMs)
+{
+  line.clear();
+  double deadlineSec = vtkPlusAccurateTimer::GetSystemTime() + timeoutMs / 1000.0;
+  // Number of unread bytes that have already been searched for the line ending
+  std::string::size_type searchOffset = 0;
+  while (true)
+  {
+    unsigned int numberOfBufferedBytes = this->GetNumberOfBufferedBytes();
+    if (lineEnding.empty())
+    {
+      // Without line ending any received data is a complete line
+      if (numberOfBufferedBytes > 0)
       {
-        // system error: clear error and retry
-        DWORD errors = 0;
-        ClearCommError(CommHandle, &errors, NULL);
+        line.assign(this->ReadBuffer, this->ReadBufferStart, numberOfBufferedBytes);
+        this->ConsumeBufferedBytes(numberOfBufferedBytes);
+        return PLUS_SUCCESS;
       }
-      else
+    }
+    else
+    {
+      std::string::size_type lineEndingPosition = this->ReadBuffer.find(lineEnding, this->ReadBufferStart + searchOffset);
+      if (lineEndingPosition != std::string::npos)
       {
-        // other error
-        return numberOfBytesReadTotal;
+        line.assign(this->ReadBuffer, this->ReadBufferStart, lineEndingPosition - this->ReadBufferStart);
+        this->ConsumeBufferedBytes(static_cast<unsigned int>(lineEndingPosition - this->ReadBufferStart + lineEnding.size()));
+        return PLUS_SUCCESS;
+      }
+      // The last few bytes may be the beginning of the line ending, so they are searched again when more data is received
+      if (numberOfBufferedBytes >= lineEnding.size())
+      {
+        searchOffset = numberOfBufferedBytes - lineEnding.size() + 1;
       }
     }
-    else if (numberOfBytesRead == 0)
+
+    if (this->FillReadBuffer(GetRemainingTimeMs(deadlineSec)) <= 0)
     {
-      // no characters read, must have timed out
-      return numberOfBytesReadTotal;
+      // timed out or error, return the incomplete line
+      line.assign(this->ReadBuffer, this->ReadBufferStart, std::string::npos);
+      this->ConsumeBufferedBytes(this->GetNumberOfBufferedBytes());
+      return PLUS_FAIL;
     }
-    maxNumberOfBytesToRead -= numberOfBytesRead;
-    numberOfBytesReadTotal += numberOfBytesRead;
   }
-  return numberOfBytesReadTotal;
-#else
-  LOG_ERROR("SerialLine::Read() is only implemented on Windows");
-  return 0;
-#endif
 }
 
 //----------------------------------------------------------------------------
-bool SerialLine::Read(BYTE& data)
+bool SerialLine::ReadFrame(BYTE* data, int frameSize, int timeoutMs)
 {
-  return Read(&data, 1) == 1;
+  double deadlineSec = vtkPlusAccurateTimer::GetSystemTime() + timeoutMs / 1000.0;
+  while (this->GetNumberOfBufferedBytes() < static_cast<unsigned int>(frameSize))
+  {
+    if (this->FillReadBuffer(GetRemainingTimeMs(deadlineSec)) <= 0)
+    {
+      // timed out or error, keep the incomplete frame in the buffer
+      return false;
+    }
+  }
+  memcpy(data, this->ReadBuffer.data() + this->ReadBufferStart, frameSize);
+  this->ConsumeBufferedBytes(frameSize);
+  return true;
 }
 
 //----------------------------------------------------------------------------
@@ -193,7 +523,7 @@ SerialLine::DWORD SerialLine::ClearError()
   ClearCommError(CommHandle, &dwErrors, &comStat);
   return dwErrors;
 #else
-  LOG_ERROR("SerialLine::ClearError() is only implemented on Windows");
+  // Communication errors are reported by the failing read or write call, there is no error flag to clear
   return 0;
 #endif
 }
@@ -216,6 +546,18 @@ int SerialLine::GetMaxReplyTime() const
   return MaxReplyTime;
 }
 
+//----------------------------------------------------------------------------
+void SerialLine::SetReadMinimumCharacters(unsigned char minimumCharacters)
+{
+  ReadMinimumCharacters = minimumCharacters;
+}
+
+//----------------------------------------------------------------------------
+void SerialLine::SetReadCharacterTimeoutDeciSec(unsigned char timeoutDeciSec)
+{
+  ReadCharacterTimeoutDeciSec = timeoutDeciSec;
+}
+
 //----------------------------------------------------------------------------
 bool SerialLine::IsHandleAlive() const
 {
@@ -229,10 +571,14 @@ unsigned int SerialLine::GetNumberOfBytesAvailableForReading() const
   DWORD dwErrorFlags = 0;
   COMSTAT comStat;
   ClearCommError(CommHandle, &dwErrorFlags, &comStat);
-  return ((int) comStat.cbInQue);
+  return ((int) comStat.cbInQue) + this->GetNumberOfBufferedBytes();
 #else
-  LOG_ERROR("SerialLine::GetNumberOfBytesAvailableForReading() is only implemented on Windows");
-  return 0;
+  int numberOfBytesInDriver = 0;
+  if (CommHandle == INVALID_HANDLE_VALUE || ioctl(CommHandle, FIONREAD, &numberOfBytesInDriver) != 0)
+  {
+    numberOfBytesInDriver = 0;
+  }
+  return static_cast<unsigned int>(numberOfBytesInDriver) + this->GetNumberOfBufferedBytes();
 #endif
 }
 
@@ -253,8 +599,13 @@ PlusStatus SerialLine::SetDTR(bool onOff)
     return PLUS_FAIL;
   }
 #else
-  LOG_ERROR("SerialLine::SetDTR() is only implemented on Windows");
-  return PLUS_FAIL;
+  int modemLines = TIOCM_DTR;
+  if (ioctl(CommHandle, onOff ? TIOCMBIS : TIOCMBIC, &modemLines) != 0)
+  {
+    LOG_ERROR("SerialLine::SetDTR() failed: " << strerror(errno));
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
 #endif
 }
 
@@ -275,7 +626,12 @@ PlusStatus SerialLine::SetRTS(bool onOff)
     return PLUS_FAIL;
   }
 #else
-  LOG_ERROR("SerialLine::SetRTS() is only implemented on Windows");
-  return PLUS_FAIL;
+  int modemLines = TIOCM_RTS;
+  if (ioctl(CommHandle, onOff ? TIOCMBIS : TIOCMBIC, &modemLines) != 0)
+  {
+    LOG_ERROR("SerialLine::SetRTS() failed: " << strerror(errno));
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
 #endif
 }
@@ -20,8 +20,13 @@ See License.txt for details.
 \class SerialLine
 \brief Class for reading and writing data through the serial (RS-232) port
 
-The class currently only works on Windows. If serial communication is needed on other platforms then
-sample code can be found in src\Utilities\ndicapi\ndicapi_serial.* or at https://github.com/wjwwood/serial.
+On Windows the port is accessed through the Win32 communication API, on other platforms through
+POSIX termios (port name is the device file, e.g., /dev/ttyS0 or /dev/ttyUSB0).
+
+Received data is collected in an internal buffer, which allows reading complete lines or fixed-size
+frames, leaving any extra received bytes for the next read. Waiting for data does not poll:
+the calling thread is woken up as soon as data arrives (poll() on POSIX, ReadFile with
+"return on first byte" timeouts on Windows).
 
 \ingroup PlusLibDataCollection
 */
@@ -60,6 +65,25 @@ public:
   /*! Read a single byte from the serial port. Returns true if successful. */
   bool Read(BYTE& data);
 
+  /*!
+    Wait until data is available for reading, but maximum timeoutMs milliseconds.
+    Returns true if data is available.
+  */
+  bool WaitForData(int timeoutMs);
+
+  /*!
+    Read bytes until the line ending is received, but maximum for timeoutMs milliseconds.
+    The line is returned without the line ending. If the line ending is not received within the timeout
+    then all the received bytes are returned in line and PLUS_FAIL is returned.
+  */
+  PlusStatus ReadLine(std::string& line, const std::string& lineEnding, int timeoutMs);
+
+  /*!
+    Read exactly frameSize bytes, waiting maximum timeoutMs milliseconds for them.
+    If the frame is incomplete then the already received bytes are kept for the next read and false is returned.
+  */
+  bool ReadFrame(BYTE* data, int frameSize, int timeoutMs);
+
   /*! Set the serial port name e.g. COM1 */
   SetStdStringMacro(PortName);
   /*! Get the serial port name */
@@ -74,6 +98,21 @@ public:
   /*! Get the serial port max reply time */
   int GetMaxReplyTime() const;
 
+  /*!
+    Set the minimum number of bytes that the driver collects before a read returns (termios VMIN).
+    Only used on POSIX systems, must be set before Open(). If VMIN or VTIME is non-zero then
+    the port is used in blocking mode, which reduces the number of wake-ups when large frames are received.
+    Reads are only started when data is available, but if VTIME is 0 then a read waits until VMIN bytes
+    are received, even if it takes longer than the requested timeout.
+  */
+  void SetReadMinimumCharacters(unsigned char minimumCharacters);
+
+  /*!
+    Set the maximum time between received bytes in tenths of a second before a read returns (termios VTIME).
+    Only used on POSIX systems, must be set before Open().
+  */
+  void SetReadCharacterTimeoutDeciSec(unsigned char timeoutDeciSec);
+
   /*! Check the handle alive status */
   bool IsHandleAlive() const;
 
@@ -90,10 +129,33 @@ public:
   DWORD ClearError();
 
 private:
+  /*!
+    Wait maximum timeoutMs milliseconds for data and append all received bytes to the read buffer.
+    Returns the number of bytes added, 0 on timeout and -1 on error.
+  */
+  int FillReadBuffer(int timeoutMs);
+
+  /*! Number of bytes received but not read yet */
+  unsigned int GetNumberOfBufferedBytes() const;
+
+  /*! Remove bytes from the beginning of the read buffer */
+  void ConsumeBufferedBytes(unsigned int numberOfBytes);
+
   HANDLE      CommHandle;
   std::string PortName;
   DWORD       SerialPortSpeed;
   int         MaxReplyTime;
+  unsigned char ReadMinimumCharacters;
+  unsigned char ReadCharacterTimeoutDeciSec;
+
+  /*! Received bytes, the unread data starts at ReadBufferStart */
+  std::string ReadBuffer;
+  std::string::size_type ReadBufferStart;
+
+#ifdef _WIN32
+  /*! Read timeout that is currently set in the port, to avoid setting the same value before each read */
+  int CurrentReadTimeoutMs;
+#endif
 };
 
 #endif
\ No newline at end of file
@@ -49,7 +49,10 @@ StreamBufferItem& StreamBufferItem::operator=( StreamBufferItem const& dataItem
   this->UnfilteredTimeStamp = dataItem.UnfilteredTimeStamp;
   this->Index = dataItem.Index;
   this->Uid = dataItem.Uid;
+
+  // Fields are not copied, only shared until either item modifies them
   this->CustomFrameFields = dataItem.CustomFrameFields;
+
   this->Status = dataItem.Status;
   this->Matrix->DeepCopy( dataItem.Matrix );
   this->ValidTransformData = dataItem.ValidTransformData;
@@ -58,9 +61,9 @@ StreamBufferItem& StreamBufferItem::operator=( StreamBufferItem const& dataItem
 }
 
 //----------------------------------------------------------------------------
-void StreamBufferItem::SetCustomFrameField( std::string fieldName, std::string fieldValue )
+void StreamBufferItem::SetCustomFrameField( const std::string& fieldName, const std::string& fieldValue )
 {
-  this->CustomFrameFields[fieldName] = fieldValue;
+  this->CustomFrameFields.SetFieldValue( fieldName, fieldValue );
 }
 
 //----------------------------------------------------------------------------
@@ -107,6 +110,36 @@ PlusStatus StreamBufferItem::GetMatrix( vtkMatrix4x4* outputMatrix )
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus StreamBufferItem::SetMatrix( const double matrix[16] )
+{
+  if ( matrix == NULL )
+  {
+    LOG_ERROR( "Failed to set matrix - input matrix is NULL!" );
+    return PLUS_FAIL;
+  }
+
+  ValidTransformData = true;
+
+  this->Matrix->DeepCopy( matrix );
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus StreamBufferItem::GetMatrix( double outputMatrix[16] )
+{
+  if ( outputMatrix == NULL )
+  {
+    LOG_ERROR( "Failed to copy matrix - output matrix is NULL!" );
+    return PLUS_FAIL;
+  }
+
+  vtkMatrix4x4::DeepCopy( outputMatrix, this->Matrix );
+
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 void StreamBufferItem::SetStatus( ToolStatus status )
 {
@@ -122,5 +155,5 @@ ToolStatus StreamBufferItem::GetStatus() const
 //----------------------------------------------------------------------------
 bool StreamBufferItem::HasValidFieldData() const
 {
-  return this->CustomFrameFields.size() > 0;
+  return !this->CustomFrameFields.IsEmpty();
 }
\ No newline at end of file
@@ -10,6 +10,7 @@ See License.txt for details.
 #include "vtkPlusDataCollectionExport.h"
 
 #include "PlusCommon.h"
+#include "PlusFrameFields.h"
 #include "PlusVideoFrame.h"
 
 #include "vtkSmartPointer.h"
@@ -87,7 +88,7 @@ public:
   void SetUid( BufferItemUidType uid ) { this->Uid = uid; };
 
   /*! Set custom frame field */
-  void SetCustomFrameField( std::string fieldName, std::string fieldValue );
+  void SetCustomFrameField( const std::string& fieldName, const std::string& fieldValue );
 
   /*! Get custom frame field value */
   const char* GetCustomFrameField( const char* fieldName )
@@ -98,16 +99,22 @@ public:
       return NULL;
     }
 
-    FieldMapType::iterator fieldIterator;
-    fieldIterator = this->CustomFrameFields.find( fieldName );
-    if ( fieldIterator != this->CustomFrameFields.end() )
+    const std::string* fieldValue = this->CustomFrameFields.GetFieldValue( fieldName );
+    if ( fieldValue != NULL )
     {
-      return fieldIterator->second.c_str();
+      return fieldValue->c_str();
     }
     return NULL;
   }
-  /*! Get custom frame field map */
-  FieldMapType& GetCustomFrameFieldMap()
+  /*! Get custom frame field map. Prefer GetCustomFrameFields, which does not copy the fields. */
+  FieldMapType GetCustomFrameFieldMap() const
+  {
+    FieldMapType fieldMap;
+    this->CustomFrameFields.GetFieldMap( fieldMap );
+    return fieldMap;
+  }
+  /*! Get custom frame fields */
+  const PlusFrameFields& GetCustomFrameFields() const
   {
     return this->CustomFrameFields;
   }
@@ -120,10 +127,8 @@ public:
       return PLUS_FAIL;
     }
 
-    FieldMapType::iterator field = this->CustomFrameFields.find( fieldName );
-    if ( field != this->CustomFrameFields.end() )
+    if ( this->CustomFrameFields.RemoveField( fieldName ) )
     {
-      this->CustomFrameFields.erase( field );
       return PLUS_SUCCESS;
     }
     LOG_DEBUG( "Failed to delete custom frame field - could find field " << fieldName );
@@ -139,6 +144,10 @@ public:
   PlusStatus SetMatrix( vtkMatrix4x4* matrix );
   /*! Get tracker matrix */
   PlusStatus GetMatrix( vtkMatrix4x4* outputMatrix );
+  /*! Set tracker matrix from 16 elements in row-major order */
+  PlusStatus SetMatrix( const double matrix[16] );
+  /*! Get tracker matrix as 16 elements in row-major order (does not require a matrix object) */
+  PlusStatus GetMatrix( double outputMatrix[16] );
 
   /*! Set tracker item status */
   void SetStatus( ToolStatus status );
@@ -163,8 +172,8 @@ protected:
   /*! unique identifier assigned by the storage buffer, it is guaranteed to increase monotonously, by one for each frame that is added to the buffer*/
   BufferItemUidType Uid;
 
-  /*! Custom frame fields */
-  FieldMapType CustomFrameFields;
+  /*! Custom frame fields (shared with copies of the item until modified) */
+  PlusFrameFields CustomFrameFields;
 
   bool ValidTransformData;
   PlusVideoFrame Frame;
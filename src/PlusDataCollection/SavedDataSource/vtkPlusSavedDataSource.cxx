@@ -12,7 +12,9 @@ See License.txt for details.
 #include "vtkPlusBuffer.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
+#include "vtkPlusRecursiveCriticalSection.h"
 #include "vtkPlusSavedDataSource.h"
+#include "vtkPlusSequenceIOBase.h"
 #include "vtkPlusTrackedFrameList.h"
 #include "vtksys/SystemTools.hxx"
 
@@ -31,6 +33,19 @@ vtkPlusSavedDataSource::vtkPlusSavedDataSource()
   , LastAddedFrameUid(0)
   , LastAddedLoopIndex(0)
   , SimulatedStream(VIDEO_STREAM)
+  , StreamingEnabled(false)
+  , ReadAheadFrameCount(16)
+  , ReplaySpeedFactor(1.0)
+  , StreamingReader(NULL)
+  , StreamingLoopFirstFrameIndex(0)
+  , StreamingLoopLastFrameIndex(0)
+  , ReadAheadMutex(vtkPlusRecursiveCriticalSection::New())
+  , ReadAheadThreadId(-1)
+  , ReadAheadRunRequested(false)
+  , ReadAheadThreadAlive(false)
+  , StreamingFramePeriodSec(0.0)
+  , StreamingLoopReplayStartTime(0.0)
+  , StreamingLastReplayedFrameTime(-1.0)
 {
   // No callback function provided by the device, so the data capture thread will be used to poll the hardware and add new items to the buffer
   this->StartThreadForInternalUpdates = true;
@@ -45,18 +60,28 @@ vtkPlusSavedDataSource::~vtkPlusSavedDataSource()
     this->Disconnect();
   }
   DeleteLocalBuffers();
+  DeleteStreamingReader();
+  DELETE_IF_NOT_NULL(this->ReadAheadMutex);
 }
 
 //----------------------------------------------------------------------------
 void vtkPlusSavedDataSource::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+  os << indent << "StreamingEnabled: " << (this->StreamingEnabled ? "TRUE" : "FALSE") << std::endl;
+  os << indent << "ReadAheadFrameCount: " << this->ReadAheadFrameCount << std::endl;
+  os << indent << "ReplaySpeedFactor: " << this->ReplaySpeedFactor << std::endl;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusSavedDataSource::InternalUpdate()
 {
   //LOG_TRACE("vtkPlusSavedDataSource::InternalUpdate");
+  if (this->StreamingReader != NULL)
+  {
+    return InternalUpdateStreaming();
+  }
+
   const int numberOfFramesInTheLoop = this->LoopLastFrameUid - this->LoopFirstFrameUid + 1;
 
   // Determine the UID and loop index of the next frame that will be added
@@ -84,13 +109,31 @@ PlusStatus vtkPlusSavedDataSource::InternalUpdate()
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusSavedDataSource::InternalUpdateOriginalTimestamp(BufferItemUidType frameToBeAddedUid, int frameToBeAddedLoopIndex)
 {
-  // Compute elapsed time since we started the acquisition
-  double elapsedTime = vtkPlusAccurateTimer::GetSystemTime() - this->GetOutputDataSource()->GetStartTime();
+  // Compute elapsed time since we started the acquisition (in the time reference of the recording)
+  double elapsedTime = (vtkPlusAccurateTimer::GetSystemTime() - this->GetOutputDataSource()->GetStartTime()) * this->ReplaySpeedFactor;
   double loopTime = this->LoopStopTime_Local - this->LoopStartTime_Local;
 
   const int numberOfFramesInTheLoop = this->LoopLastFrameUid - this->LoopFirstFrameUid + 1;
   int currentLoopIndex = 0; // how many loops have we completed so far?
   BufferItemUidType currentFrameUid = 0; // uid of the frame that has been acquired most recently (uid of the last frame that has to be added in this update)
+  if (this->ReplaySpeedFactor <= 0)
+  {
+    // Replay as fast as possible: add a fixed number of frames in each update, timestamps are computed the same way as in real-time replay
+    currentLoopIndex = this->LastAddedLoopIndex;
+    currentFrameUid = this->LastAddedFrameUid + this->GetMaximumNumberOfFramesPerUpdate();
+    while (currentFrameUid > this->LoopLastFrameUid)
+    {
+      currentLoopIndex++;
+      currentFrameUid -= numberOfFramesInTheLoop;
+    }
+    if ((!this->RepeatEnabled || loopTime == 0) && currentLoopIndex > 0)
+    {
+      // stop at the end of the loop
+      currentLoopIndex = 0;
+      currentFrameUid = this->LoopLastFrameUid;
+    }
+  }
+  else
   {
     double currentFrameTime_Local = 0; // current time in the Local buffer time reference
     if (!this->RepeatEnabled || loopTime == 0)
@@ -349,6 +392,217 @@ PlusStatus vtkPlusSavedDataSource::InternalUpdateCurrentTimestamp(BufferItemUidT
   return status;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSavedDataSource::InternalUpdateStreaming()
+{
+  double elapsedTime = (vtkPlusAccurateTimer::GetSystemTime() - this->GetOutputDataSource()->GetStartTime()) * this->ReplaySpeedFactor;
+  double loopTime = this->LoopStopTime_Local - this->LoopStartTime_Local;
+
+  // Without original timestamps one frame is added in each update (same as in InternalUpdateCurrentTimestamp).
+  // In real-time replay all the frames that are due are added, when replaying as fast as possible the number of frames per update is limited.
+  int maxNumberOfFramesToBeAdded = 1;
+  if (this->UseOriginalTimestamps)
+  {
+    maxNumberOfFramesToBeAdded = (this->ReplaySpeedFactor > 0) ? this->ReadAheadFrameCount : this->GetMaximumNumberOfFramesPerUpdate();
+  }
+
+  PlusStatus status(PLUS_SUCCESS);
+  for (int addedFrames = 0; addedFrames < maxNumberOfFramesToBeAdded; addedFrames++)
+  {
+    ReadAheadFrame* frameToBeAdded = NULL;
+    {
+      PlusLockGuard<vtkPlusRecursiveCriticalSection> readAheadMutexGuardedLock(this->ReadAheadMutex);
+      if (!this->ReadAheadFrames.empty())
+      {
+        frameToBeAdded = this->ReadAheadFrames.front();
+      }
+    }
+    if (frameToBeAdded == NULL)
+    {
+      // The next frame has not been read yet (it will be added in a later update, with its original timestamp)
+      // or the end of the replay is reached
+      break;
+    }
+
+    // Time of the frame since the start of the replay, in the time reference of the recording
+    double frameTime = this->StreamingLoopReplayStartTime + this->StreamingFrameTimestamps_Local[frameToBeAdded->FrameIndex] - this->LoopStartTime_Local + frameToBeAdded->LoopIndex * loopTime;
+    if (this->UseOriginalTimestamps && this->ReplaySpeedFactor > 0 && frameTime > elapsedTime)
+    {
+      // the frame is not due yet
+      break;
+    }
+
+    this->FrameNumber++;
+    this->StreamingLastReplayedFrameTime = frameTime;
+    if (frameToBeAdded->ImageValid)
+    {
+      // UNDEFINED_TIMESTAMP => use current timestamp
+      double timestamp = this->UseOriginalTimestamps ? frameTime + this->GetOutputDataSource()->GetStartTime() : UNDEFINED_TIMESTAMP;
+      if (this->AddVideoItemToVideoSources(this->GetVideoSources(), frameToBeAdded->Frame, this->FrameNumber, timestamp, timestamp, &frameToBeAdded->FrameFields) != PLUS_SUCCESS)
+      {
+        status = PLUS_FAIL;
+      }
+    }
+    else
+    {
+      LOG_DEBUG("Frame " << frameToBeAdded->FrameIndex << " is not replayed: the image is marked as invalid in the sequence file");
+    }
+
+    {
+      PlusLockGuard<vtkPlusRecursiveCriticalSection> readAheadMutexGuardedLock(this->ReadAheadMutex);
+      this->ReadAheadFrames.pop_front();
+      this->FreeReadAheadFrames.push_back(frameToBeAdded);
+    }
+  }
+
+  this->Modified();
+  return status;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusSavedDataSource::GetMaximumNumberOfFramesPerUpdate()
+{
+  // Add at most half of the output buffer at once, so that the frames are not overwritten before they could be processed
+  vtkPlusDataSource* outputDataSource = this->GetOutputDataSource();
+  int bufferSize = (outputDataSource != NULL) ? outputDataSource->GetBufferSize() : 0;
+  return std::max(1, bufferSize / 2);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSavedDataSource::StartReadAhead()
+{
+  this->StopReadAhead();
+
+  if (this->StreamingReader->StartSequentialImageRead(this->StreamingLoopFirstFrameIndex) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to start reading images from sequence file: " << this->SequenceFile);
+    return PLUS_FAIL;
+  }
+
+  for (int i = 0; i < std::max(1, this->ReadAheadFrameCount); ++i)
+  {
+    this->FreeReadAheadFrames.push_back(new ReadAheadFrame);
+  }
+
+  this->ReadAheadRunRequested = true;
+  this->ReadAheadThreadAlive = true;
+  this->ReadAheadThreadId = this->Threader->SpawnThread((vtkThreadFunctionType)&ReadAheadThread, this);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSavedDataSource::StopReadAhead()
+{
+  if (this->ReadAheadThreadId >= 0)
+  {
+    this->ReadAheadRunRequested = false;
+    while (this->ReadAheadThreadAlive)
+    {
+      // Wait until the thread stops
+      vtkPlusAccurateTimer::Delay(0.01);
+    }
+    this->ReadAheadThreadId = -1;
+  }
+
+  if (this->StreamingReader != NULL)
+  {
+    this->StreamingReader->StopSequentialImageRead();
+  }
+
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> readAheadMutexGuardedLock(this->ReadAheadMutex);
+  for (std::deque<ReadAheadFrame*>::iterator it = this->ReadAheadFrames.begin(); it != this->ReadAheadFrames.end(); ++it)
+  {
+    delete *it;
+  }
+  this->ReadAheadFrames.clear();
+  for (std::vector<ReadAheadFrame*>::iterator it = this->FreeReadAheadFrames.begin(); it != this->FreeReadAheadFrames.end(); ++it)
+  {
+    delete *it;
+  }
+  this->FreeReadAheadFrames.clear();
+}
+
+//----------------------------------------------------------------------------
+void* vtkPlusSavedDataSource::ReadAheadThread(vtkMultiThreader::ThreadInfo* data)
+{
+  vtkPlusSavedDataSource* self = (vtkPlusSavedDataSource*)(data->UserData);
+  vtkPlusTrackedFrameList* frameFieldList = self->StreamingReader->GetTrackedFrameList();
+
+  int frameIndex = self->StreamingLoopFirstFrameIndex;
+  int loopIndex = 0;
+  while (self->ReadAheadRunRequested)
+  {
+    if (frameIndex > self->StreamingLoopLastFrameIndex)
+    {
+      if (!self->RepeatEnabled)
+      {
+        // all the frames have been read
+        break;
+      }
+      // Continue from the first frame of the loop
+      if (self->StreamingReader->StartSequentialImageRead(self->StreamingLoopFirstFrameIndex) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to restart reading images from sequence file: " << self->SequenceFile);
+        break;
+      }
+      frameIndex = self->StreamingLoopFirstFrameIndex;
+      loopIndex++;
+    }
+
+    ReadAheadFrame* frame = NULL;
+    {
+      PlusLockGuard<vtkPlusRecursiveCriticalSection> readAheadMutexGuardedLock(self->ReadAheadMutex);
+      if (!self->FreeReadAheadFrames.empty())
+      {
+        frame = self->FreeReadAheadFrames.back();
+        self->FreeReadAheadFrames.pop_back();
+      }
+    }
+    if (frame == NULL)
+    {
+      // All the read-ahead frames are waiting to be replayed
+      vtkPlusAccurateTimer::Delay(0.005);
+      continue;
+    }
+
+    int readFrameIndex = 0;
+    if (self->StreamingReader->ReadNextFrameImage(frame->Frame, readFrameIndex, frame->ImageValid) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read frame " << frameIndex << " from sequence file: " << self->SequenceFile);
+      PlusLockGuard<vtkPlusRecursiveCriticalSection> readAheadMutexGuardedLock(self->ReadAheadMutex);
+      self->FreeReadAheadFrames.push_back(frame);
+      break;
+    }
+    frame->FrameIndex = frameIndex;
+    frame->LoopIndex = loopIndex;
+    frame->FrameFields.clear();
+    if (self->UseAllFrameFields)
+    {
+      const PlusTrackedFrame::FieldMapType& fields = frameFieldList->GetTrackedFrame(frameIndex)->GetCustomFields();
+      for (PlusTrackedFrame::FieldMapType::const_iterator fieldIt = fields.begin(); fieldIt != fields.end(); ++fieldIt)
+      {
+        // skip special fields, same as when the whole file is loaded into the local buffer
+        if (PlusCommon::IsEqualInsensitive(fieldIt->first, "TimeStamp")
+            || PlusCommon::IsEqualInsensitive(fieldIt->first, "UnfilteredTimestamp")
+            || PlusCommon::IsEqualInsensitive(fieldIt->first, "FrameNumber"))
+        {
+          continue;
+        }
+        frame->FrameFields[fieldIt->first] = fieldIt->second;
+      }
+    }
+
+    {
+      PlusLockGuard<vtkPlusRecursiveCriticalSection> readAheadMutexGuardedLock(self->ReadAheadMutex);
+      self->ReadAheadFrames.push_back(frame);
+    }
+    frameIndex++;
+  }
+
+  self->ReadAheadThreadAlive = false;
+  return NULL;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusSavedDataSource::Probe()
 {
@@ -379,6 +633,16 @@ PlusStatus vtkPlusSavedDataSource::InternalConnect()
     return PLUS_FAIL;
   }
 
+  DeleteStreamingReader();
+  if (this->StreamingEnabled)
+  {
+    if (this->SimulatedStream == VIDEO_STREAM)
+    {
+      return InternalConnectVideoStreaming(foundAbsoluteImagePath);
+    }
+    LOG_WARNING("Streaming is only supported for replaying video, the tracking data is loaded into memory from " << this->SequenceFile);
+  }
+
   vtkSmartPointer<vtkPlusTrackedFrameList> savedDataBuffer = vtkSmartPointer<vtkPlusTrackedFrameList>::New();
 
   // Read sequence file into tracked frame list
@@ -428,31 +692,133 @@ PlusStatus vtkPlusSavedDataSource::InternalConnect()
 
   // When we reach the last frame we have to wait one frame period before
   // playing the first frame, so we have to add one frame period to the loop length (loopTime)
-  double framePeriodSec = 0;
-  double frameRate = GetLocalBuffer()->GetFrameRate();
+  this->LoopStopTime_Local = latestTimestamp_Local + GetFramePeriodSec(GetLocalBuffer()->GetFrameRate());
+
+  this->LastAddedFrameUid = this->LoopFirstFrameUid - 1;
+  this->LastAddedLoopIndex = 0;
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusSavedDataSource::GetFramePeriodSec(double frameRate)
+{
   if (frameRate != 0.0)
   {
-    framePeriodSec = 1.0 / frameRate;
+    return 1.0 / frameRate;
   }
-  else
+
+  // There is probably only one frame in the buffer, so use the AcquisitionRate
+  // (instead of trying to find out the frame period from the frame rate in the file)
+  if (this->AcquisitionRate != 0.0)
   {
-    // There is probably only one frame in the buffer, so use the AcquisitionRate
-    // (instead of trying to find out the frame period from the frame rate in the file)
-    if (this->AcquisitionRate != 0.0)
-    {
-      framePeriodSec = 1.0 / this->AcquisitionRate;
-    }
-    else
+    return 1.0 / this->AcquisitionRate;
+  }
+
+  LOG_ERROR("Invalid AcquisitionRate: " << this->AcquisitionRate);
+  return 1.0;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSavedDataSource::InternalConnectVideoStreaming(const std::string& sequenceFilePath)
+{
+  vtkPlusDataSource* outputDataSource = this->GetOutputDataSource();
+  if (outputDataSource == NULL)
+  {
+    return PLUS_FAIL;
+  }
+
+  DeleteLocalBuffers();
+
+  // Only the frame fields are read now, images are read during replay
+  this->StreamingReader = vtkPlusSequenceIO::CreateSequenceHandlerForFile(sequenceFilePath);
+  if (this->StreamingReader == NULL)
+  {
+    LOG_ERROR("Unable to connect to saved data video source: unsupported sequence file format: " << this->SequenceFile);
+    return PLUS_FAIL;
+  }
+  vtkSmartPointer<vtkPlusTrackedFrameList> frameFieldList = vtkSmartPointer<vtkPlusTrackedFrameList>::New();
+  this->StreamingReader->SetTrackedFrameList(frameFieldList);
+  this->StreamingReader->SetFileName(sequenceFilePath);
+  if (this->StreamingReader->ReadHeader() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to connect to saved data video source: failed to read sequence file header: " << this->SequenceFile);
+    DeleteStreamingReader();
+    return PLUS_FAIL;
+  }
+
+  const int numberOfFrames = frameFieldList->GetNumberOfTrackedFrames();
+  if (numberOfFrames < 1)
+  {
+    LOG_ERROR("Failed to connect to saved dataset - there is no frame in the sequence file!");
+    DeleteStreamingReader();
+    return PLUS_FAIL;
+  }
+  this->StreamingFrameTimestamps_Local.resize(numberOfFrames);
+  for (int frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+  {
+    this->StreamingFrameTimestamps_Local[frameIndex] = frameFieldList->GetTrackedFrame(frameIndex)->GetTimestamp();
+  }
+
+  // Read the first valid image to get the image format
+  PlusVideoFrame firstFrame;
+  bool imageValid = false;
+  if (this->StreamingReader->StartSequentialImageRead(0) != PLUS_SUCCESS)
+  {
+    DeleteStreamingReader();
+    return PLUS_FAIL;
+  }
+  for (int frameIndex = 0; frameIndex < numberOfFrames && !imageValid; ++frameIndex)
+  {
+    int readFrameIndex = 0;
+    if (this->StreamingReader->ReadNextFrameImage(firstFrame, readFrameIndex, imageValid) != PLUS_SUCCESS)
     {
-      LOG_ERROR("Invalid AcquisitionRate: " << this->AcquisitionRate);
-      framePeriodSec = 1.0;
+      LOG_ERROR("Unable to connect to saved data video source: failed to read image data from " << this->SequenceFile);
+      DeleteStreamingReader();
+      return PLUS_FAIL;
     }
   }
-  this->LoopStopTime_Local = latestTimestamp_Local + framePeriodSec;
+  this->StreamingReader->StopSequentialImageRead();
+  if (!imageValid)
+  {
+    LOG_ERROR("Failed to connect to saved dataset - there is no valid image in the sequence file!");
+    DeleteStreamingReader();
+    return PLUS_FAIL;
+  }
 
-  this->LastAddedFrameUid = this->LoopFirstFrameUid - 1;
-  this->LastAddedLoopIndex = 0;
+  if (outputDataSource->SetImageType(firstFrame.GetImageType()) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to set video buffer image type");
+    DeleteStreamingReader();
+    return PLUS_FAIL;
+  }
+  unsigned int frameSize[3] = {0, 0, 0};
+  firstFrame.GetFrameSize(frameSize);
+  if (SetVideoSourcesFormat(firstFrame.GetImageOrientation(), frameSize, firstFrame.GetNumberOfScalarComponents(), firstFrame.GetVTKScalarPixelType()) != PLUS_SUCCESS)
+  {
+    DeleteStreamingReader();
+    return PLUS_FAIL;
+  }
+
+  // Set the default loop to the whole file
+  this->StreamingLoopFirstFrameIndex = 0;
+  this->StreamingLoopLastFrameIndex = numberOfFrames - 1;
+  this->LoopStartTime_Local = this->StreamingFrameTimestamps_Local[0];
+  double frameRate = 0.0;
+  if (numberOfFrames > 1 && this->StreamingFrameTimestamps_Local[numberOfFrames - 1] > this->StreamingFrameTimestamps_Local[0])
+  {
+    frameRate = (numberOfFrames - 1) / (this->StreamingFrameTimestamps_Local[numberOfFrames - 1] - this->StreamingFrameTimestamps_Local[0]);
+  }
+  this->StreamingFramePeriodSec = GetFramePeriodSec(frameRate);
+  this->LoopStopTime_Local = this->StreamingFrameTimestamps_Local[numberOfFrames - 1] + this->StreamingFramePeriodSec;
+  this->StreamingLoopReplayStartTime = 0.0;
+  this->StreamingLastReplayedFrameTime = -1.0;
 
+  if (StartReadAhead() != PLUS_SUCCESS)
+  {
+    DeleteStreamingReader();
+    return PLUS_FAIL;
+  }
   return PLUS_SUCCESS;
 }
 
@@ -484,26 +850,33 @@ PlusStatus vtkPlusSavedDataSource::InternalConnectVideo(vtkPlusTrackedFrameList*
   this->LocalVideoBuffer->CopyImagesFromTrackedFrameList(savedDataBuffer, vtkPlusBuffer::READ_FILTERED_IGNORE_UNFILTERED_TIMESTAMPS, this->UseAllFrameFields);
   savedDataBuffer->Clear();
 
+  return SetVideoSourcesFormat(this->LocalVideoBuffer->GetImageOrientation(), this->LocalVideoBuffer->GetFrameSize(),
+                               this->LocalVideoBuffer->GetNumberOfScalarComponents(), this->LocalVideoBuffer->GetPixelType());
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSavedDataSource::SetVideoSourcesFormat(US_IMAGE_ORIENTATION imageOrientation, unsigned int frameSize[3], int numberOfScalarComponents, PlusCommon::VTKScalarPixelType pixelType)
+{
   PlusStatus result(PLUS_SUCCESS);
   for (DataSourceContainerIterator it = this->VideoSources.begin(); it != this->VideoSources.end(); ++it)
   {
     vtkPlusDataSource* source(it->second);
 
-    if (source->SetInputImageOrientation(this->LocalVideoBuffer->GetImageOrientation()) != PLUS_SUCCESS)
+    if (source->SetInputImageOrientation(imageOrientation) != PLUS_SUCCESS)
     {
       LOG_ERROR(source->GetId() << ": Failed to set video image orientation");
       result = PLUS_FAIL;
       continue;
     }
 
-    if (source->SetInputFrameSize(this->LocalVideoBuffer->GetFrameSize()) != PLUS_SUCCESS)
+    if (source->SetInputFrameSize(frameSize) != PLUS_SUCCESS)
     {
       LOG_ERROR(source->GetId() << ": Failed to set video image orientation");
       result = PLUS_FAIL;
       continue;
     }
 
-    if (source->SetNumberOfScalarComponents(this->LocalVideoBuffer->GetNumberOfScalarComponents()) != PLUS_SUCCESS)
+    if (source->SetNumberOfScalarComponents(numberOfScalarComponents) != PLUS_SUCCESS)
     {
       LOG_ERROR(source->GetId() << ": Failed to set video image orientation");
       result = PLUS_FAIL;
@@ -512,14 +885,14 @@ PlusStatus vtkPlusSavedDataSource::InternalConnectVideo(vtkPlusTrackedFrameList*
 
     source->Clear();
 
-    if (source->SetInputFrameSize(this->LocalVideoBuffer->GetFrameSize()) != PLUS_SUCCESS)
+    if (source->SetInputFrameSize(frameSize) != PLUS_SUCCESS)
     {
       LOG_ERROR(source->GetId() << ": Failed to set video image orientation");
       result = PLUS_FAIL;
       continue;
     }
 
-    if (source->SetPixelType(this->LocalVideoBuffer->GetPixelType()) != PLUS_SUCCESS)
+    if (source->SetPixelType(pixelType) != PLUS_SUCCESS)
     {
       LOG_ERROR(source->GetId() << ": Failed to set video image orientation");
       result = PLUS_FAIL;
@@ -596,6 +969,7 @@ PlusStatus vtkPlusSavedDataSource::InternalConnectTracker(vtkPlusTrackedFrameLis
 PlusStatus vtkPlusSavedDataSource::InternalDisconnect()
 {
   DeleteLocalBuffers();
+  DeleteStreamingReader();
   return PLUS_SUCCESS;
 }
 
@@ -652,6 +1026,18 @@ PlusStatus vtkPlusSavedDataSource::ReadConfiguration(vtkXMLDataElement* rootConf
 
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(RepeatEnabled, deviceConfig);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(UseOriginalTimestamps, deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(StreamingEnabled, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, ReadAheadFrameCount, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, ReplaySpeedFactor, deviceConfig);
+  if (this->ReadAheadFrameCount < 1)
+  {
+    LOG_WARNING("ReadAheadFrameCount must be at least 1, it is changed from " << this->ReadAheadFrameCount << " to 1");
+    this->ReadAheadFrameCount = 1;
+  }
+  if (this->ReplaySpeedFactor != 1.0 && !this->UseOriginalTimestamps)
+  {
+    LOG_WARNING("ReplaySpeedFactor is ignored, because UseOriginalTimestamps is disabled (one frame is replayed in each update)");
+  }
 
   const char* useData = deviceConfig->GetAttribute("UseData");
   if (useData != NULL)
@@ -689,6 +1075,9 @@ PlusStatus vtkPlusSavedDataSource::WriteConfiguration(vtkXMLDataElement* rootCon
   XML_WRITE_CSTRING_ATTRIBUTE_IF_NOT_NULL(SequenceFile, imageAcquisitionConfig);
   XML_WRITE_BOOL_ATTRIBUTE(RepeatEnabled, imageAcquisitionConfig);
   XML_WRITE_BOOL_ATTRIBUTE(UseOriginalTimestamps, imageAcquisitionConfig);
+  XML_WRITE_BOOL_ATTRIBUTE(StreamingEnabled, imageAcquisitionConfig);
+  imageAcquisitionConfig->SetIntAttribute("ReadAheadFrameCount", this->ReadAheadFrameCount);
+  imageAcquisitionConfig->SetDoubleAttribute("ReplaySpeedFactor", this->ReplaySpeedFactor);
 
   if (this->UseAllFrameFields)
   {
@@ -750,9 +1139,55 @@ void vtkPlusSavedDataSource::GetLoopTimeRange(double& loopStartTime, double& loo
 //-----------------------------------------------------------------------------
 void vtkPlusSavedDataSource::SetLoopTimeRange(double loopStartTime, double loopStopTime)
 {
+  if (this->StreamingReader != NULL)
+  {
+    PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(this->UpdateMutex);
+
+    // The read-ahead thread uses the loop range, so stop it before the range is changed.
+    // Frames that were already read from the old range are dropped.
+    StopReadAhead();
+
+    // Replay the first frame of the new range now (or right after the last replayed frame),
+    // instead of at the time when it would have been replayed if the new range had been used from the start
+    double replayStartTime = 0.0;
+    if (this->IsRecording() && this->UseOriginalTimestamps && this->ReplaySpeedFactor > 0)
+    {
+      replayStartTime = (vtkPlusAccurateTimer::GetSystemTime() - this->GetOutputDataSource()->GetStartTime()) * this->ReplaySpeedFactor;
+    }
+    if (this->StreamingLastReplayedFrameTime >= 0)
+    {
+      replayStartTime = std::max(replayStartTime, this->StreamingLastReplayedFrameTime + this->StreamingFramePeriodSec);
+    }
+    this->StreamingLoopReplayStartTime = replayStartTime;
+
+    this->LoopStartTime_Local = loopStartTime;
+    this->LoopStopTime_Local = loopStopTime;
+    const int numberOfFrames = static_cast<int>(this->StreamingFrameTimestamps_Local.size());
+    this->StreamingLoopFirstFrameIndex = numberOfFrames - 1;
+    for (int frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+    {
+      if (this->StreamingFrameTimestamps_Local[frameIndex] >= loopStartTime)
+      {
+        this->StreamingLoopFirstFrameIndex = frameIndex;
+        break;
+      }
+    }
+    this->StreamingLoopLastFrameIndex = this->StreamingLoopFirstFrameIndex;
+    for (int frameIndex = numberOfFrames - 1; frameIndex > this->StreamingLoopFirstFrameIndex; --frameIndex)
+    {
+      if (this->StreamingFrameTimestamps_Local[frameIndex] <= loopStopTime)
+      {
+        this->StreamingLoopLastFrameIndex = frameIndex;
+        break;
+      }
+    }
+    // Restart reading ahead from the first frame of the new loop
+    StartReadAhead();
+    return;
+  }
+
   this->LoopStartTime_Local = loopStartTime;
   this->LoopStopTime_Local = loopStopTime;
-
   this->LoopFirstFrameUid = GetClosestFrameUidWithinTimeRange(this->LoopStartTime_Local, this->LoopStartTime_Local, this->LoopStopTime_Local);
   this->LoopLastFrameUid = GetClosestFrameUidWithinTimeRange(this->LoopStopTime_Local, this->LoopStartTime_Local, this->LoopStopTime_Local);
 
@@ -845,6 +1280,18 @@ void vtkPlusSavedDataSource::DeleteLocalBuffers()
   this->LocalTrackerBuffers.clear();
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusSavedDataSource::DeleteStreamingReader()
+{
+  StopReadAhead();
+  if (this->StreamingReader != NULL)
+  {
+    this->StreamingReader->Delete();
+    this->StreamingReader = NULL;
+  }
+  this->StreamingFrameTimestamps_Local.clear();
+}
+
 //----------------------------------------------------------------------------
 vtkPlusBuffer* vtkPlusSavedDataSource::GetLocalBuffer()
 {
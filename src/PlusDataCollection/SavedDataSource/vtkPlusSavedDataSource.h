@@ -11,7 +11,11 @@ See License.txt for details.
 
 #include "vtkPlusDevice.h"
 
+#include <atomic>
+#include <deque>
+
 class vtkPlusBuffer;
+class vtkPlusSequenceIOBase;
 
 class vtkPlusDataCollectionExport vtkPlusSavedDataSource;
 
@@ -27,6 +31,13 @@ Attributes:
 \li UseOriginalTimestamps: if true then the original timestamps (recorded originally in the source file)
   will be replayed exactly, otherwise only the timestamp difference will be replayed exactly,
   starting from the current time (TRUE|FALSE)
+\li StreamingEnabled: if true then video frames are read from the file during replay by a background thread,
+  only a few frames ahead of the replay position, instead of loading the whole file into memory at connect (TRUE|FALSE).
+  Tracking data is always loaded into memory.
+\li ReadAheadFrameCount: maximum number of frames that are read ahead from the file if StreamingEnabled is true
+\li ReplaySpeedFactor: replay speed relative to the original recording speed if UseOriginalTimestamps is true (e.g., 4 replays
+  4x faster than real-time). If it is 0 then the frames are replayed as fast as possible. Timestamps are always computed from the
+  recorded timestamps, so the output is the same for any replay speed.
 
 */
 class vtkPlusDataCollectionExport vtkPlusSavedDataSource : public vtkPlusDevice
@@ -73,6 +84,23 @@ public:
   /*! Read the timestamps from the file and use provide them in the output (instead of the current time) */
   vtkBooleanMacro( UseOriginalTimestamps, bool );
 
+  /*! Read video frames from the file during replay instead of loading the whole file into memory at connect */
+  vtkGetMacro( StreamingEnabled, bool );
+  /*! Read video frames from the file during replay instead of loading the whole file into memory at connect */
+  vtkSetMacro( StreamingEnabled, bool );
+  /*! Read video frames from the file during replay instead of loading the whole file into memory at connect */
+  vtkBooleanMacro( StreamingEnabled, bool );
+
+  /*! Maximum number of frames that are read ahead from the file in streaming mode */
+  vtkGetMacro( ReadAheadFrameCount, int );
+  /*! Maximum number of frames that are read ahead from the file in streaming mode */
+  vtkSetMacro( ReadAheadFrameCount, int );
+
+  /*! Replay speed relative to the recording speed, 0 means as fast as possible. Only used if UseOriginalTimestamps is enabled. */
+  vtkGetMacro( ReplaySpeedFactor, double );
+  /*! Replay speed relative to the recording speed, 0 means as fast as possible. Only used if UseOriginalTimestamps is enabled. */
+  vtkSetMacro( ReplaySpeedFactor, double );
+
   /*! Get local video buffer */
   vtkGetObjectMacro( LocalVideoBuffer, vtkPlusBuffer );
 
@@ -98,6 +126,12 @@ protected:
   /*! Connect to device, in case the output is a video stream */
   virtual PlusStatus InternalConnectVideo( vtkPlusTrackedFrameList* savedDataBuffer );
 
+  /*! Connect to device, in case the output is a video stream that is read from the file during replay */
+  virtual PlusStatus InternalConnectVideoStreaming( const std::string& sequenceFilePath );
+
+  /*! Set the image format of all the video sources */
+  PlusStatus SetVideoSourcesFormat( US_IMAGE_ORIENTATION imageOrientation, unsigned int frameSize[3], int numberOfScalarComponents, PlusCommon::VTKScalarPixelType pixelType );
+
   /*! Connect to device, in case the output is a tracker stream */
   virtual PlusStatus InternalConnectTracker( vtkPlusTrackedFrameList* savedDataBuffer );
 
@@ -113,6 +147,24 @@ protected:
   /*! Internal update, called when the original timestamps are used */
   PlusStatus InternalUpdateOriginalTimestamp( BufferItemUidType frameToBeAddedUid, int frameToBeAddedLoopIndex );
 
+  /*! Internal update, called when the video frames are read from the file during replay */
+  PlusStatus InternalUpdateStreaming();
+
+  /*! Get the replay time of one frame, used as the time between the last and first frame when the replay is repeated */
+  double GetFramePeriodSec( double frameRate );
+
+  /*! Get the maximum number of frames that are added in one update when replaying as fast as possible */
+  int GetMaximumNumberOfFramesPerUpdate();
+
+  /*! Start reading frames from the file in the background, starting from the first frame of the loop */
+  PlusStatus StartReadAhead();
+
+  /*! Stop reading frames from the file and discard all the frames that have been read ahead */
+  void StopReadAhead();
+
+  /*! Thread that reads the frames from the file in streaming mode */
+  static void* ReadAheadThread( vtkMultiThreader::ThreadInfo* data );
+
   BufferItemUidType GetClosestFrameUidWithinTimeRange( double time_Local, double startTime_Local, double stopTime_Local );
 
   /*! Get local tracker buffer */
@@ -129,7 +181,23 @@ protected:
 
   void DeleteLocalBuffers();
 
+  /*! Stop reading frames and delete the reader that is used in streaming mode */
+  void DeleteStreamingReader();
+
 protected:
+  /*! A frame that has been read ahead from the file in streaming mode */
+  struct ReadAheadFrame
+  {
+    /*! Index of the frame in the file */
+    int FrameIndex;
+    /*! Index of the loop when the frame is replayed */
+    int LoopIndex;
+    /*! False if the image is marked as invalid in the file */
+    bool ImageValid;
+    PlusVideoFrame Frame;
+    StreamBufferItem::FieldMapType FrameFields;
+  };
+
   /*! Byte alignment of each row in the framebuffer */
   int FrameBufferRowAlignment;
 
@@ -181,6 +249,57 @@ protected:
 
   SimulatedStreamType SimulatedStream;
 
+  /*! Read video frames from the file during replay instead of loading the whole file into memory at connect */
+  bool StreamingEnabled;
+
+  /*! Maximum number of frames that are read ahead from the file in streaming mode */
+  int ReadAheadFrameCount;
+
+  /*! Replay speed relative to the recording speed, 0 means as fast as possible */
+  double ReplaySpeedFactor;
+
+  /*! Reader of the sequence file in streaming mode (frame fields of all frames are kept in memory, images are read on demand). NULL if not streaming. */
+  vtkPlusSequenceIOBase* StreamingReader;
+
+  /*! Timestamp of each frame in the file (in local buffer time), in streaming mode */
+  std::vector<double> StreamingFrameTimestamps_Local;
+
+  /*! Index of the first frame in the file that is replayed, in streaming mode */
+  int StreamingLoopFirstFrameIndex;
+
+  /*! Index of the last frame in the file that is replayed, in streaming mode */
+  int StreamingLoopLastFrameIndex;
+
+  /*! Frames that have been read ahead, in replay order */
+  std::deque<ReadAheadFrame*> ReadAheadFrames;
+
+  /*! Frames that can be reused for reading ahead */
+  std::vector<ReadAheadFrame*> FreeReadAheadFrames;
+
+  /*! Mutex for accessing the read-ahead frame lists */
+  vtkPlusRecursiveCriticalSection* ReadAheadMutex;
+
+  /*! Read-ahead thread id, -1 if not running */
+  int ReadAheadThreadId;
+
+  /*! Set by the controlling thread to request the read-ahead thread to keep running */
+  std::atomic<bool> ReadAheadRunRequested;
+
+  /*! True while the read-ahead thread is running */
+  std::atomic<bool> ReadAheadThreadAlive;
+
+  /*! Period of the frames in the file (in seconds), in streaming mode */
+  double StreamingFramePeriodSec;
+
+  /*!
+    Replay time (seconds since the start of recording, in the time reference of the file) when the first frame of
+    the current loop range is replayed, in streaming mode. Nonzero after the loop range is changed during recording.
+  */
+  double StreamingLoopReplayStartTime;
+
+  /*! Replay time of the last replayed frame, negative if no frame has been replayed yet, in streaming mode */
+  double StreamingLastReplayedFrameTime;
+
 private:
   static vtkPlusSavedDataSource* Instance;
   vtkPlusSavedDataSource( const vtkPlusSavedDataSource& ); // Not implemented.
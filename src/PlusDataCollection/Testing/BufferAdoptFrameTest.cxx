@@ -0,0 +1,280 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file BufferAdoptFrameTest.cxx
+  \brief This program tests adding video frames to a buffer with vtkPlusBuffer::AddItemAdoptFrame.
+
+  When the frame has the buffer's orientation and no clipping is requested then the buffer item must take over
+  the pixel buffer of the frame: the frame gets back the pixel buffer of the overwritten item, and the pixel buffer
+  that was adopted is returned to the frame when its item is overwritten. When clipping or flipping is requested
+  then the pixels must be copied into the buffer item and the frame must keep its own pixel buffer.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusVideoFrame.h"
+#include "vtkPlusBuffer.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <vector>
+
+//----------------------------------------------------------------------------
+namespace
+{
+  const unsigned int FRAME_SIZE[3] = {64, 48, 1};
+  const int CLIP_RECTANGLE_ORIGIN[3] = {8, 4, 0};
+  const int CLIP_RECTANGLE_SIZE[3] = {32, 24, 1};
+  const int NO_CLIP_RECTANGLE[3] = {PlusCommon::NO_CLIP, PlusCommon::NO_CLIP, PlusCommon::NO_CLIP};
+  const int FULL_FRAME_ORIGIN[3] = {0, 0, 0};
+  const int BUFFER_SIZE = 3;
+  const int NUMBER_OF_ADOPTED_FRAMES = 10;
+
+  //----------------------------------------------------------------------------
+  unsigned char GetPixelValue(unsigned int x, unsigned int y, int frameIndex)
+  {
+    return static_cast<unsigned char>((x + 3 * y + frameIndex) % 256);
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus SetUpBuffer(vtkPlusBuffer* buffer, unsigned int frameSizeX, unsigned int frameSizeY)
+  {
+    if (buffer->SetImageOrientation(US_IMG_ORIENT_MF) != PLUS_SUCCESS
+        || buffer->SetImageType(US_IMG_BRIGHTNESS) != PLUS_SUCCESS
+        || buffer->SetPixelType(VTK_UNSIGNED_CHAR) != PLUS_SUCCESS
+        || buffer->SetNumberOfScalarComponents(1) != PLUS_SUCCESS
+        || buffer->SetFrameSize(frameSizeX, frameSizeY, 1) != PLUS_SUCCESS
+        || buffer->SetBufferSize(BUFFER_SIZE) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  void FillFrame(PlusVideoFrame& frame, int frameIndex)
+  {
+    unsigned char* pixels = static_cast<unsigned char*>(frame.GetScalarPointer());
+    for (unsigned int y = 0; y < FRAME_SIZE[1]; ++y)
+    {
+      for (unsigned int x = 0; x < FRAME_SIZE[0]; ++x)
+      {
+        pixels[y * FRAME_SIZE[0] + x] = GetPixelValue(x, y, frameIndex);
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Check that the frame still has the specified pixel buffer with the content of the frame with the specified index
+  bool IsFrameUnchanged(PlusVideoFrame& frame, void* pixelPointer, int frameIndex)
+  {
+    if (frame.GetScalarPointer() != pixelPointer)
+    {
+      LOG_ERROR("Frame " << frameIndex << " lost its pixel buffer although its pixels had to be copied");
+      return false;
+    }
+    const unsigned char* pixels = static_cast<const unsigned char*>(pixelPointer);
+    for (unsigned int y = 0; y < FRAME_SIZE[1]; ++y)
+    {
+      for (unsigned int x = 0; x < FRAME_SIZE[0]; ++x)
+      {
+        if (pixels[y * FRAME_SIZE[0] + x] != GetPixelValue(x, y, frameIndex))
+        {
+          LOG_ERROR("Pixel (" << x << ", " << y << ") of frame " << frameIndex << " was modified when the frame was added to the buffer");
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  // Check that the latest item of the buffer contains the frame with the specified index, clipped to the
+  // rectangle that starts at the clip origin and optionally flipped horizontally
+  bool IsLatestItemValid(vtkPlusBuffer* buffer, int frameIndex, const int clipOrigin[3], bool horizontalFlip)
+  {
+    StreamBufferItem item;
+    if (buffer->GetLatestStreamBufferItem(&item) != ITEM_OK)
+    {
+      LOG_ERROR("Failed to get the latest item of the buffer for frame " << frameIndex);
+      return false;
+    }
+    if (item.GetIndex() != static_cast<unsigned long>(frameIndex))
+    {
+      LOG_ERROR("Latest item of the buffer has frame index " << item.GetIndex() << " (expected: " << frameIndex << ")");
+      return false;
+    }
+    unsigned int itemFrameSize[3] = {0, 0, 0};
+    item.GetFrame().GetFrameSize(itemFrameSize);
+    const unsigned char* pixels = static_cast<const unsigned char*>(item.GetFrame().GetScalarPointer());
+    for (unsigned int y = 0; y < itemFrameSize[1]; ++y)
+    {
+      for (unsigned int x = 0; x < itemFrameSize[0]; ++x)
+      {
+        unsigned int inputX = clipOrigin[0] + (horizontalFlip ? itemFrameSize[0] - 1 - x : x);
+        unsigned int inputY = clipOrigin[1] + y;
+        if (pixels[y * itemFrameSize[0] + x] != GetPixelValue(inputX, inputY, frameIndex))
+        {
+          LOG_ERROR("Pixel (" << x << ", " << y << ") of buffered frame " << frameIndex << " is " << static_cast<int>(pixels[y * itemFrameSize[0] + x])
+                    << " (expected: " << static_cast<int>(GetPixelValue(inputX, inputY, frameIndex)) << ")");
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  // Frames that need neither clipping nor flipping are adopted: the pixel buffers are swapped, not copied
+  int TestAdoption()
+  {
+    int numberOfErrors(0);
+
+    vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+    if (SetUpBuffer(buffer, FRAME_SIZE[0], FRAME_SIZE[1]) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to set up the buffer for frame adoption");
+      return 1;
+    }
+
+    PlusVideoFrame frame;
+    frame.AllocateFrame(FRAME_SIZE, VTK_UNSIGNED_CHAR, 1);
+    frame.SetImageOrientation(US_IMG_ORIENT_MF);
+    frame.SetImageType(US_IMG_BRIGHTNESS);
+
+    std::vector<void*> adoptedPixelPointers;
+    for (int i = 0; i < NUMBER_OF_ADOPTED_FRAMES; ++i)
+    {
+      FillFrame(frame, i);
+      void* pixelPointer = frame.GetScalarPointer();
+      adoptedPixelPointers.push_back(pixelPointer);
+      double timestamp = 1.0 + i * 0.1;
+      if (buffer->AddItemAdoptFrame(frame, i, NO_CLIP_RECTANGLE, NO_CLIP_RECTANGLE, timestamp, timestamp) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add frame " << i << " to the buffer by adoption");
+        numberOfErrors++;
+        continue;
+      }
+      if (frame.GetScalarPointer() == NULL || frame.GetScalarPointer() == pixelPointer)
+      {
+        LOG_ERROR("Frame " << i << " did not get a pixel buffer of the buffer in exchange for its own");
+        numberOfErrors++;
+      }
+      unsigned int returnedFrameSize[3] = {0, 0, 0};
+      frame.GetFrameSize(returnedFrameSize);
+      if (returnedFrameSize[0] != FRAME_SIZE[0] || returnedFrameSize[1] != FRAME_SIZE[1] || returnedFrameSize[2] != FRAME_SIZE[2])
+      {
+        LOG_ERROR("Pixel buffer returned for frame " << i << " does not have the frame size of the buffer");
+        numberOfErrors++;
+      }
+      // Once the buffer is full, the item that adopted the pixel buffer BUFFER_SIZE frames ago is overwritten and its pixel buffer is returned
+      if (i >= BUFFER_SIZE && frame.GetScalarPointer() != adoptedPixelPointers[i - BUFFER_SIZE])
+      {
+        LOG_ERROR("Frame " << i << " did not get back the pixel buffer that was adopted with frame " << i - BUFFER_SIZE);
+        numberOfErrors++;
+      }
+      if (!IsLatestItemValid(buffer, i, FULL_FRAME_ORIGIN, false))
+      {
+        numberOfErrors++;
+      }
+    }
+
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  // Frames that have to be clipped or flipped are copied and the frame keeps its pixel buffer
+  int TestFallbackToCopy(const char* caseName, US_IMAGE_ORIENTATION frameOrientation, const int clipRectangleOrigin[3], const int clipRectangleSize[3])
+  {
+    int numberOfErrors(0);
+
+    bool clippingRequested = PlusCommon::IsClippingRequested(clipRectangleOrigin, clipRectangleSize);
+    vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+    if (SetUpBuffer(buffer, clippingRequested ? clipRectangleSize[0] : FRAME_SIZE[0], clippingRequested ? clipRectangleSize[1] : FRAME_SIZE[1]) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to set up the buffer for " << caseName);
+      return 1;
+    }
+
+    PlusVideoFrame frame;
+    frame.AllocateFrame(FRAME_SIZE, VTK_UNSIGNED_CHAR, 1);
+    frame.SetImageOrientation(frameOrientation);
+    frame.SetImageType(US_IMG_BRIGHTNESS);
+
+    for (int i = 0; i < NUMBER_OF_ADOPTED_FRAMES; ++i)
+    {
+      FillFrame(frame, i);
+      void* pixelPointer = frame.GetScalarPointer();
+      double timestamp = 1.0 + i * 0.1;
+      if (buffer->AddItemAdoptFrame(frame, i, clipRectangleOrigin, clipRectangleSize, timestamp, timestamp) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add frame " << i << " to the buffer with " << caseName);
+        numberOfErrors++;
+        continue;
+      }
+      if (!IsFrameUnchanged(frame, pixelPointer, i))
+      {
+        LOG_ERROR("Frame " << i << " was not copied with " << caseName);
+        numberOfErrors++;
+      }
+      if (!IsLatestItemValid(buffer, i, clippingRequested ? clipRectangleOrigin : FULL_FRAME_ORIGIN, frameOrientation != US_IMG_ORIENT_MF))
+      {
+        LOG_ERROR("Frame " << i << " is not stored correctly with " << caseName);
+        numberOfErrors++;
+      }
+    }
+
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors(0);
+  numberOfErrors += TestAdoption();
+  // UF to MF orientation requires a horizontal flip
+  numberOfErrors += TestFallbackToCopy("flipping", US_IMG_ORIENT_UF, NO_CLIP_RECTANGLE, NO_CLIP_RECTANGLE);
+  numberOfErrors += TestFallbackToCopy("clipping", US_IMG_ORIENT_MF, CLIP_RECTANGLE_ORIGIN, CLIP_RECTANGLE_SIZE);
+  numberOfErrors += TestFallbackToCopy("clipping and flipping", US_IMG_ORIENT_UF, CLIP_RECTANGLE_ORIGIN, CLIP_RECTANGLE_SIZE);
+
+  if (numberOfErrors != 0)
+  {
+    LOG_INFO("Test failed!");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully!");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,453 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file DeviceSchedulerTest.cxx
+  \brief This program tests that vtkPlusDeviceScheduler updates several devices at their acquisition rates,
+  updates devices after their inputs, can remove devices while they are being updated (also from their own update),
+  and stops updating all devices when they stop recording.
+
+  The test devices record the start and end time of each InternalUpdate call.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDevice.h"
+#include "vtkPlusDeviceScheduler.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+  // Number of deleted test devices
+  std::atomic<int> NumberOfDeletedTestDevices(0);
+}
+
+//----------------------------------------------------------------------------
+/*! Device that records the times of its updates */
+class vtkPlusSchedulerTestDevice : public vtkPlusDevice
+{
+public:
+  static vtkPlusSchedulerTestDevice* New();
+  vtkTypeMacro(vtkPlusSchedulerTestDevice, vtkPlusDevice);
+
+  /*! Time spent in each InternalUpdate call */
+  void SetUpdateDurationSec(double durationSec) { this->UpdateDurationSec = durationSec; }
+
+  /*! Remove the device from the scheduler in its own update, after the specified number of updates */
+  void SetRemoveFromSchedulerAfterUpdates(int numberOfUpdates) { this->RemoveFromSchedulerAfterUpdates = numberOfUpdates; }
+
+  /*! Use the output of the other device as input (the scheduler updates this device after the input device) */
+  void SetInputDevice(vtkPlusSchedulerTestDevice* inputDevice)
+  {
+    this->InputDevice = inputDevice;
+    this->InputChannel = vtkSmartPointer<vtkPlusChannel>::New();
+    this->InputChannel->SetChannelId((std::string(inputDevice->GetDeviceId()) + "Output").c_str());
+    this->InputChannel->SetOwnerDevice(inputDevice);
+    this->AddInputChannel(this->InputChannel);
+  }
+
+  int GetNumberOfUpdates()
+  {
+    std::lock_guard<std::mutex> lock(this->UpdateTimesMutex);
+    return static_cast<int>(this->UpdateStartTimes.size());
+  }
+
+  /*! Number of updates per second, measured from the first to the last update */
+  double GetMeasuredUpdateRate()
+  {
+    std::lock_guard<std::mutex> lock(this->UpdateTimesMutex);
+    if (this->UpdateStartTimes.size() < 2)
+    {
+      return 0.0;
+    }
+    return (this->UpdateStartTimes.size() - 1) / (this->UpdateStartTimes.back() - this->UpdateStartTimes.front());
+  }
+
+  double GetLastUpdateEndTime()
+  {
+    std::lock_guard<std::mutex> lock(this->UpdateTimesMutex);
+    return this->LastUpdateEndTime;
+  }
+
+  bool IsUpdateInProgress() const { return this->UpdateInProgress; }
+  bool IsRemovedFromScheduler() const { return this->RemovedFromScheduler; }
+
+  /*! Number of updates that started while the input device was being updated */
+  int GetNumberOfUpdatesDuringInputUpdate() const { return this->NumberOfUpdatesDuringInputUpdate; }
+
+  /*! Number of updates that started without any new input update since the previous update */
+  int GetNumberOfUpdatesWithoutNewInput() const { return this->NumberOfUpdatesWithoutNewInput; }
+
+  /*! Mean time between the end of the last input update and the start of the updates */
+  double GetMeanInputDelaySec()
+  {
+    std::lock_guard<std::mutex> lock(this->UpdateTimesMutex);
+    return this->NumberOfInputDelays > 0 ? this->InputDelaySumSec / this->NumberOfInputDelays : 0.0;
+  }
+
+protected:
+  vtkPlusSchedulerTestDevice()
+    : UpdateDurationSec(0.001)
+    , RemoveFromSchedulerAfterUpdates(0)
+    , InputDevice(NULL)
+    , LastUpdateEndTime(0.0)
+    , LastInputUpdateEndTime(0.0)
+    , InputDelaySumSec(0.0)
+    , NumberOfInputDelays(0)
+    , UpdateInProgress(false)
+    , RemovedFromScheduler(false)
+    , NumberOfUpdatesDuringInputUpdate(0)
+    , NumberOfUpdatesWithoutNewInput(0)
+  {
+    this->StartThreadForInternalUpdates = true;
+  }
+
+  virtual ~vtkPlusSchedulerTestDevice()
+  {
+    ++NumberOfDeletedTestDevices;
+  }
+
+  virtual PlusStatus InternalUpdate()
+  {
+    this->UpdateInProgress = true;
+    const double updateStartTime = vtkPlusAccurateTimer::GetSystemTime();
+    if (this->InputDevice != NULL)
+    {
+      if (this->InputDevice->IsUpdateInProgress())
+      {
+        this->NumberOfUpdatesDuringInputUpdate++;
+      }
+      const double inputUpdateEndTime = this->InputDevice->GetLastUpdateEndTime();
+      if (inputUpdateEndTime > 0)
+      {
+        std::lock_guard<std::mutex> lock(this->UpdateTimesMutex);
+        if (inputUpdateEndTime == this->LastInputUpdateEndTime)
+        {
+          this->NumberOfUpdatesWithoutNewInput++;
+        }
+        this->InputDelaySumSec += updateStartTime - inputUpdateEndTime;
+        this->NumberOfInputDelays++;
+        this->LastInputUpdateEndTime = inputUpdateEndTime;
+      }
+    }
+
+    vtkPlusAccurateTimer::Delay(this->UpdateDurationSec);
+
+    int numberOfUpdates(0);
+    {
+      std::lock_guard<std::mutex> lock(this->UpdateTimesMutex);
+      this->UpdateStartTimes.push_back(updateStartTime);
+      this->LastUpdateEndTime = vtkPlusAccurateTimer::GetSystemTime();
+      numberOfUpdates = static_cast<int>(this->UpdateStartTimes.size());
+    }
+    this->UpdateInProgress = false;
+
+    if (this->RemoveFromSchedulerAfterUpdates > 0 && numberOfUpdates == this->RemoveFromSchedulerAfterUpdates)
+    {
+      this->GetDeviceScheduler()->RemoveDevice(this);
+      this->RemovedFromScheduler = true;
+      // The owner may release the device now, the scheduler must keep it alive until the update returns
+      vtkPlusAccurateTimer::Delay(0.05);
+    }
+    return PLUS_SUCCESS;
+  }
+
+  double UpdateDurationSec;
+  int RemoveFromSchedulerAfterUpdates;
+  vtkPlusSchedulerTestDevice* InputDevice;
+  vtkSmartPointer<vtkPlusChannel> InputChannel;
+
+  std::mutex UpdateTimesMutex;
+  std::vector<double> UpdateStartTimes;
+  double LastUpdateEndTime;
+  double LastInputUpdateEndTime;
+  double InputDelaySumSec;
+  int NumberOfInputDelays;
+
+  std::atomic<bool> UpdateInProgress;
+  std::atomic<bool> RemovedFromScheduler;
+  std::atomic<int> NumberOfUpdatesDuringInputUpdate;
+  std::atomic<int> NumberOfUpdatesWithoutNewInput;
+
+private:
+  vtkPlusSchedulerTestDevice(const vtkPlusSchedulerTestDevice&);
+  void operator=(const vtkPlusSchedulerTestDevice&);
+};
+
+vtkStandardNewMacro(vtkPlusSchedulerTestDevice);
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  vtkSmartPointer<vtkPlusSchedulerTestDevice> CreateDevice(const std::string& deviceId, double acquisitionRate, vtkPlusDeviceScheduler* scheduler)
+  {
+    vtkSmartPointer<vtkPlusSchedulerTestDevice> device = vtkSmartPointer<vtkPlusSchedulerTestDevice>::New();
+    device->SetDeviceId(deviceId);
+    device->SetAcquisitionRate(acquisitionRate);
+    device->SetDeviceScheduler(scheduler);
+    return device;
+  }
+
+  //----------------------------------------------------------------------------
+  // Update several independent devices and a chain of devices, then stop all of them
+  int TestUpdateRatesAndOrder(vtkPlusDeviceScheduler* scheduler)
+  {
+    int numberOfErrors(0);
+
+    std::vector<vtkSmartPointer<vtkPlusSchedulerTestDevice> > devices;
+    devices.push_back(CreateDevice("Fast", 50, scheduler));
+    devices.push_back(CreateDevice("Slow", 20, scheduler));
+    vtkSmartPointer<vtkPlusSchedulerTestDevice> chainInput = CreateDevice("ChainInput", 30, scheduler);
+    chainInput->SetUpdateDurationSec(0.003);
+    devices.push_back(chainInput);
+    vtkSmartPointer<vtkPlusSchedulerTestDevice> chainMiddle = CreateDevice("ChainMiddle", 30, scheduler);
+    chainMiddle->SetInputDevice(chainInput);
+    devices.push_back(chainMiddle);
+    vtkSmartPointer<vtkPlusSchedulerTestDevice> chainOutput = CreateDevice("ChainOutput", 30, scheduler);
+    chainOutput->SetInputDevice(chainMiddle);
+    devices.push_back(chainOutput);
+
+    // Start the dependent devices first, the scheduler has to order the updates anyway
+    for (std::vector<vtkSmartPointer<vtkPlusSchedulerTestDevice> >::reverse_iterator it = devices.rbegin(); it != devices.rend(); ++it)
+    {
+      if ((*it)->StartRecording() != PLUS_SUCCESS || !scheduler->IsDeviceScheduled(*it))
+      {
+        LOG_ERROR("Failed to start recording of device " << (*it)->GetDeviceId() << " using the device scheduler");
+        return numberOfErrors + 1;
+      }
+    }
+
+    vtkPlusAccurateTimer::Delay(2.0);
+
+    for (std::vector<vtkSmartPointer<vtkPlusSchedulerTestDevice> >::iterator it = devices.begin(); it != devices.end(); ++it)
+    {
+      if ((*it)->StopRecording() != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to stop recording of device " << (*it)->GetDeviceId());
+        numberOfErrors++;
+      }
+    }
+
+    // Update rates
+    for (std::vector<vtkSmartPointer<vtkPlusSchedulerTestDevice> >::iterator it = devices.begin(); it != devices.end(); ++it)
+    {
+      double measuredRate = (*it)->GetMeasuredUpdateRate();
+      LOG_INFO("Device " << (*it)->GetDeviceId() << ": " << (*it)->GetNumberOfUpdates() << " updates, " << measuredRate << " updates per second (acquisition rate: " << (*it)->GetAcquisitionRate() << ")");
+      if (std::abs(measuredRate - (*it)->GetAcquisitionRate()) > 0.2 * (*it)->GetAcquisitionRate())
+      {
+        LOG_ERROR("Device " << (*it)->GetDeviceId() << " update rate (" << measuredRate << ") differs from its acquisition rate (" << (*it)->GetAcquisitionRate() << ")");
+        numberOfErrors++;
+      }
+    }
+
+    // Dependent devices are updated after their inputs, never in parallel with them
+    vtkPlusSchedulerTestDevice* dependentDevices[2] = { chainMiddle, chainOutput };
+    for (int i = 0; i < 2; ++i)
+    {
+      double maxMeanInputDelaySec = 0.5 / dependentDevices[i]->GetAcquisitionRate();
+      LOG_INFO("Device " << dependentDevices[i]->GetDeviceId() << ": mean delay after input update " << dependentDevices[i]->GetMeanInputDelaySec() * 1000.0 << "ms, "
+               << dependentDevices[i]->GetNumberOfUpdatesWithoutNewInput() << " updates without new input");
+      if (dependentDevices[i]->GetNumberOfUpdatesDuringInputUpdate() > 0)
+      {
+        LOG_ERROR("Device " << dependentDevices[i]->GetDeviceId() << " was updated " << dependentDevices[i]->GetNumberOfUpdatesDuringInputUpdate() << " times while its input was being updated");
+        numberOfErrors++;
+      }
+      if (dependentDevices[i]->GetMeanInputDelaySec() > maxMeanInputDelaySec)
+      {
+        LOG_ERROR("Device " << dependentDevices[i]->GetDeviceId() << " is not updated right after its input: mean delay " << dependentDevices[i]->GetMeanInputDelaySec() * 1000.0 << "ms");
+        numberOfErrors++;
+      }
+      if (dependentDevices[i]->GetNumberOfUpdatesWithoutNewInput() > 0.1 * dependentDevices[i]->GetNumberOfUpdates())
+      {
+        LOG_ERROR("Device " << dependentDevices[i]->GetDeviceId() << " was updated " << dependentDevices[i]->GetNumberOfUpdatesWithoutNewInput() << " times without a new input update");
+        numberOfErrors++;
+      }
+    }
+
+    // No update after stopping the recording
+    std::vector<int> numberOfUpdatesAfterStop;
+    for (std::vector<vtkSmartPointer<vtkPlusSchedulerTestDevice> >::iterator it = devices.begin(); it != devices.end(); ++it)
+    {
+      if (scheduler->IsDeviceScheduled(*it))
+      {
+        LOG_ERROR("Device " << (*it)->GetDeviceId() << " is still scheduled after it stopped recording");
+        numberOfErrors++;
+      }
+      numberOfUpdatesAfterStop.push_back((*it)->GetNumberOfUpdates());
+    }
+    vtkPlusAccurateTimer::Delay(0.2);
+    for (unsigned int i = 0; i < devices.size(); ++i)
+    {
+      if (devices[i]->GetNumberOfUpdates() != numberOfUpdatesAfterStop[i])
+      {
+        LOG_ERROR("Device " << devices[i]->GetDeviceId() << " was updated after it stopped recording");
+        numberOfErrors++;
+      }
+    }
+
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  // Remove a device while it is being updated, from another thread
+  int TestRemoveDuringUpdate(vtkPlusDeviceScheduler* scheduler)
+  {
+    int numberOfErrors(0);
+
+    vtkSmartPointer<vtkPlusSchedulerTestDevice> device = CreateDevice("SlowUpdate", 10, scheduler);
+    device->SetUpdateDurationSec(0.05);
+    if (device->StartRecording() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to start recording of device " << device->GetDeviceId());
+      return 1;
+    }
+
+    double timeoutTime = vtkPlusAccurateTimer::GetSystemTime() + 2.0;
+    while (!device->IsUpdateInProgress() && vtkPlusAccurateTimer::GetSystemTime() < timeoutTime)
+    {
+      vtkPlusAccurateTimer::Delay(0.001);
+    }
+    if (!device->IsUpdateInProgress())
+    {
+      LOG_ERROR("Device " << device->GetDeviceId() << " is not updated by the scheduler");
+      device->StopRecording();
+      return 1;
+    }
+
+    // Returns only after the update in progress is completed
+    scheduler->RemoveDevice(device);
+    if (device->IsUpdateInProgress())
+    {
+      LOG_ERROR("Device scheduler returned from RemoveDevice while the update of the device was in progress");
+      numberOfErrors++;
+    }
+    int numberOfUpdatesAfterRemove = device->GetNumberOfUpdates();
+    vtkPlusAccurateTimer::Delay(0.3);
+    if (device->GetNumberOfUpdates() != numberOfUpdatesAfterRemove || scheduler->IsDeviceScheduled(device))
+    {
+      LOG_ERROR("Device " << device->GetDeviceId() << " was updated after it was removed from the device scheduler");
+      numberOfErrors++;
+    }
+
+    device->StopRecording();
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  // A device removes itself from the scheduler in its update, and its owner releases it before the update returns
+  int TestRemoveFromOwnUpdate(vtkPlusDeviceScheduler* scheduler)
+  {
+    int numberOfErrors(0);
+
+    vtkSmartPointer<vtkPlusSchedulerTestDevice> device = CreateDevice("SelfRemoving", 50, scheduler);
+    device->SetRemoveFromSchedulerAfterUpdates(5);
+    if (device->StartRecording() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to start recording of device " << device->GetDeviceId());
+      return 1;
+    }
+
+    double timeoutTime = vtkPlusAccurateTimer::GetSystemTime() + 2.0;
+    while (!device->IsRemovedFromScheduler() && vtkPlusAccurateTimer::GetSystemTime() < timeoutTime)
+    {
+      vtkPlusAccurateTimer::Delay(0.001);
+    }
+    if (!device->IsRemovedFromScheduler() || scheduler->IsDeviceScheduled(device))
+    {
+      LOG_ERROR("Device " << device->GetDeviceId() << " failed to remove itself from the device scheduler");
+      device->StopRecording();
+      return 1;
+    }
+
+    // The update that removed the device is still in progress, the scheduler keeps the device alive
+    const int numberOfDeletedDevices = NumberOfDeletedTestDevices;
+    device = NULL;
+    if (NumberOfDeletedTestDevices != numberOfDeletedDevices)
+    {
+      LOG_ERROR("Device was deleted while its update was in progress");
+      numberOfErrors++;
+    }
+
+    // The scheduler releases the device when the update is completed
+    timeoutTime = vtkPlusAccurateTimer::GetSystemTime() + 2.0;
+    while (NumberOfDeletedTestDevices == numberOfDeletedDevices && vtkPlusAccurateTimer::GetSystemTime() < timeoutTime)
+    {
+      vtkPlusAccurateTimer::Delay(0.001);
+    }
+    if (NumberOfDeletedTestDevices == numberOfDeletedDevices)
+    {
+      LOG_ERROR("Device scheduler did not release the device that removed itself");
+      numberOfErrors++;
+    }
+
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+  int numberOfThreads = 2;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+  args.AddArgument("--number-of-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of worker threads of the device scheduler (default: 2)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors = 0;
+  {
+    vtkSmartPointer<vtkPlusDeviceScheduler> scheduler = vtkSmartPointer<vtkPlusDeviceScheduler>::New();
+    if (scheduler->SetNumberOfThreads(numberOfThreads) != PLUS_SUCCESS)
+    {
+      return EXIT_FAILURE;
+    }
+
+    numberOfErrors += TestUpdateRatesAndOrder(scheduler);
+    numberOfErrors += TestRemoveDuringUpdate(scheduler);
+    numberOfErrors += TestRemoveFromOwnUpdate(scheduler);
+
+    // All devices are removed, the scheduler stops its threads without warnings when it is deleted
+  }
+
+  if (numberOfErrors != 0)
+  {
+    LOG_INFO("Test failed!");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully!");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,246 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PollingCadenceEstimatorTest.cxx
+  \brief This program tests that PlusPollingCadenceEstimator learns the delivery period and latency of a simulated
+  device and schedules polls so that few polls are empty and data is retrieved soon after it becomes available,
+  also if the acquisition rate is lower than the delivery rate, and that devices that timestamp their items when
+  they are polled are not polled faster and faster.
+
+  Time is simulated, so the test does not depend on the load of the computer.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusPollingCadenceEstimator.h"
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+  struct PollingResult
+  {
+    int NumberOfPolls;
+    int NumberOfEmptyPolls;
+    double MeanRetrievalDelaySec;
+    double MinPollIntervalSec;
+  };
+
+  //----------------------------------------------------------------------------
+  // Simulated device: item i has timestamp i*periodSec (+ jitter) and it can be retrieved latencySec (+ jitter) later
+  PollingResult SimulatePolling(PlusPollingCadenceEstimator& estimator, double startTimeSec, int numberOfItems,
+                                double periodSec, double latencySec, double jitterSec, double fallbackPeriodSec)
+  {
+    std::mt19937 randomGenerator(1);
+    std::normal_distribution<double> jitter(0.0, jitterSec);
+    std::vector<double> timestamps;
+    std::vector<double> availabilityTimes;
+    for (int i = 0; i < numberOfItems; ++i)
+    {
+      timestamps.push_back(startTimeSec + i * periodSec + jitter(randomGenerator));
+      availabilityTimes.push_back(timestamps.back() + latencySec + std::abs(jitter(randomGenerator)));
+    }
+
+    PollingResult result = { 0, 0, 0.0, 1e10 };
+    int numberOfRetrievedItems = 0;
+    double pollTimeSec = startTimeSec;
+    while (pollTimeSec < timestamps.back())
+    {
+      result.NumberOfPolls++;
+      int numberOfAvailableItems = numberOfRetrievedItems;
+      while (numberOfAvailableItems < numberOfItems && availabilityTimes[numberOfAvailableItems] <= pollTimeSec)
+      {
+        result.MeanRetrievalDelaySec += pollTimeSec - availabilityTimes[numberOfAvailableItems];
+        numberOfAvailableItems++;
+      }
+      if (numberOfAvailableItems == numberOfRetrievedItems)
+      {
+        result.NumberOfEmptyPolls++;
+      }
+      numberOfRetrievedItems = numberOfAvailableItems;
+      if (numberOfRetrievedItems > 0)
+      {
+        estimator.Update(pollTimeSec, numberOfRetrievedItems, timestamps[numberOfRetrievedItems - 1]);
+      }
+      double nextPollTimeSec = estimator.GetNextPollTime(pollTimeSec, fallbackPeriodSec);
+      result.MinPollIntervalSec = std::min(result.MinPollIntervalSec, nextPollTimeSec - pollTimeSec);
+      pollTimeSec = nextPollTimeSec;
+    }
+    if (numberOfRetrievedItems > 0)
+    {
+      result.MeanRetrievalDelaySec /= numberOfRetrievedItems;
+    }
+    return result;
+  }
+
+  //----------------------------------------------------------------------------
+  // Simulated device that creates an item whenever it is polled, timestamped timestampOffsetSec after the start of the poll
+  PollingResult SimulatePollDrivenDevice(PlusPollingCadenceEstimator& estimator, double startTimeSec, int numberOfPolls, double timestampOffsetSec, double fallbackPeriodSec)
+  {
+    PollingResult result = { 0, 0, 0.0, 1e10 };
+    double pollTimeSec = startTimeSec;
+    for (int i = 0; i < numberOfPolls; ++i)
+    {
+      result.NumberOfPolls++;
+      estimator.Update(pollTimeSec, i + 1, pollTimeSec + timestampOffsetSec);
+      double nextPollTimeSec = estimator.GetNextPollTime(pollTimeSec, fallbackPeriodSec);
+      result.MinPollIntervalSec = std::min(result.MinPollIntervalSec, nextPollTimeSec - pollTimeSec);
+      pollTimeSec = nextPollTimeSec;
+    }
+    return result;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors = 0;
+
+  const double periodSec = 1.0 / 30.0;
+  const double latencySec = 0.005;
+  const double jitterSec = 0.001;
+
+  // Polling at 100fps and at 20fps (too fast and too slow for a 30fps device) should converge to the same schedule
+  const double fallbackPeriodsSec[2] = { 1.0 / 100.0, 1.0 / 20.0 };
+  for (int i = 0; i < 2; ++i)
+  {
+    PlusPollingCadenceEstimator estimator;
+    PollingResult result = SimulatePolling(estimator, 1000.0, 3000, periodSec, latencySec, jitterSec, fallbackPeriodsSec[i]);
+    double emptyPollRatio = static_cast<double>(result.NumberOfEmptyPolls) / result.NumberOfPolls;
+    LOG_INFO("Fallback period " << fallbackPeriodsSec[i] * 1000.0 << "ms: " << result.NumberOfPolls << " polls, " << emptyPollRatio * 100.0 << "% empty, mean retrieval delay "
+             << result.MeanRetrievalDelaySec * 1000.0 << "ms, estimated period " << estimator.GetEstimatedPeriodSec() * 1000.0 << "ms, estimated latency "
+             << estimator.GetEstimatedLatencySec() * 1000.0 << "ms");
+
+    if (!estimator.IsLocked())
+    {
+      LOG_ERROR("Estimator is not locked to the delivery of the items");
+      numberOfErrors++;
+    }
+    if (estimator.IsPollDriven())
+    {
+      LOG_ERROR("Device that delivers items " << latencySec * 1000.0 << "ms after their timestamp is detected as poll-driven");
+      numberOfErrors++;
+    }
+    if (std::abs(estimator.GetEstimatedPeriodSec() - periodSec) > 0.01 * periodSec)
+    {
+      LOG_ERROR("Estimated period " << estimator.GetEstimatedPeriodSec() << "s differs from the actual period " << periodSec << "s");
+      numberOfErrors++;
+    }
+    if (emptyPollRatio > 0.2)
+    {
+      LOG_ERROR("Too many empty polls: " << emptyPollRatio * 100.0 << "%");
+      numberOfErrors++;
+    }
+    if (result.MeanRetrievalDelaySec > 0.2 * periodSec)
+    {
+      LOG_ERROR("Mean retrieval delay is too long: " << result.MeanRetrievalDelaySec * 1000.0 << "ms");
+      numberOfErrors++;
+    }
+    // Late items are polled again after 10% of the learned period, which may be slightly shorter than the actual period
+    if (result.MinPollIntervalSec < 0.09 * periodSec)
+    {
+      LOG_ERROR("Device was polled too frequently: " << result.MinPollIntervalSec * 1000.0 << "ms between polls");
+      numberOfErrors++;
+    }
+  }
+
+  // A device that timestamps its items when it is polled must keep being polled at the acquisition rate
+  // (the items seem to be available right at their timestamp, which must not make the polling faster and faster).
+  // The timestamp may be right at the start of the poll or a bit later (e.g., when the device answers the request).
+  const double acquisitionPeriodSec = 1.0 / 50.0;
+  const double timestampOffsetsSec[2] = { 0.0, 0.0003 };
+  for (int i = 0; i < 2; ++i)
+  {
+    PlusPollingCadenceEstimator estimator;
+    PollingResult result = SimulatePollDrivenDevice(estimator, 1000.0, 5000, timestampOffsetsSec[i], acquisitionPeriodSec);
+    LOG_INFO("Poll-driven device (timestamp offset " << timestampOffsetsSec[i] * 1000.0 << "ms): minimum time between polls " << result.MinPollIntervalSec * 1000.0
+             << "ms, estimated period " << estimator.GetEstimatedPeriodSec() * 1000.0 << "ms, estimated latency " << estimator.GetEstimatedLatencySec() * 1000.0 << "ms");
+    if (!estimator.IsPollDriven())
+    {
+      LOG_ERROR("Device that timestamps its items when it is polled is not detected as poll-driven");
+      numberOfErrors++;
+    }
+    if (result.MinPollIntervalSec < acquisitionPeriodSec - 1e-9)
+    {
+      LOG_ERROR("Poll-driven device was polled faster than the acquisition rate: " << result.MinPollIntervalSec * 1000.0 << "ms between polls");
+      numberOfErrors++;
+    }
+    if (estimator.GetEstimatedLatencySec() < 0)
+    {
+      LOG_ERROR("Estimated latency is negative: " << estimator.GetEstimatedLatencySec() * 1000.0 << "ms");
+      numberOfErrors++;
+    }
+    // Until the device is detected as poll-driven, polls are scheduled from the item timestamps, so a timestamp offset makes the period slightly longer
+    if (std::abs(estimator.GetEstimatedPeriodSec() - acquisitionPeriodSec) > 0.05 * acquisitionPeriodSec)
+    {
+      LOG_ERROR("Estimated period of the poll-driven device " << estimator.GetEstimatedPeriodSec() << "s differs from the acquisition period " << acquisitionPeriodSec << "s");
+      numberOfErrors++;
+    }
+  }
+
+  // If the device stops delivering data then the estimator falls back to the fixed polling period
+  {
+    PlusPollingCadenceEstimator estimator;
+    SimulatePolling(estimator, 1000.0, 100, periodSec, latencySec, jitterSec, 0.01);
+    double pollTimeSec = estimator.GetNextPollTime(1000.0 + 100 * periodSec, 0.01);
+    for (int i = 0; i < 100 && estimator.IsLocked(); ++i)
+    {
+      estimator.Update(pollTimeSec, 100, 1000.0 + 99 * periodSec);
+      pollTimeSec = estimator.GetNextPollTime(pollTimeSec, 0.01);
+    }
+    if (estimator.IsLocked())
+    {
+      LOG_ERROR("Estimator remained locked after the device stopped delivering data");
+      numberOfErrors++;
+    }
+    else if (std::abs(estimator.GetNextPollTime(2000.0, 0.01) - 2000.01) > 1e-9)
+    {
+      LOG_ERROR("Estimator does not use the fallback period after losing lock");
+      numberOfErrors++;
+    }
+  }
+
+  if (numberOfErrors != 0)
+  {
+    LOG_INFO("Test failed!");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully!");
+  return EXIT_SUCCESS;
+}
@@ -7,6 +7,10 @@ See License.txt for details.
 /*!
   \file ReplayRecordedDataTest.cxx
   \brief This program tests if a recorded tracked ultrasound buffer can be read.
+
+  With --streaming-enabled the saved data sources read the frames from the file during the replay,
+  at the speed set by --replay-speed-factor. The replayed timestamps are checked against the elapsed
+  time, before and after the loop range is changed during the replay.
 */ 
 
 #include "PlusConfigure.h"
@@ -16,8 +20,125 @@ See License.txt for details.
 #include "vtkXMLUtilities.h"
 
 #include "vtkPlusDataCollector.h"
+#include "vtkPlusDataSource.h"
 #include "vtkPlusSavedDataSource.h"
 
+namespace
+{
+  // Allowed difference between the replayed and the expected timestamps, to account for the update period and scheduling jitter
+  const double REPLAY_TIME_TOLERANCE_SEC = 0.5;
+
+  //----------------------------------------------------------------------------
+  void OverrideSavedDataSourceConfiguration(vtkXMLDataElement* configRootElement, double replaySpeedFactor)
+  {
+    vtkXMLDataElement* dataCollectionElement = configRootElement->FindNestedElementWithName("DataCollection");
+    if (dataCollectionElement == NULL)
+    {
+      return;
+    }
+    for (int i = 0; i < dataCollectionElement->GetNumberOfNestedElements(); ++i)
+    {
+      vtkXMLDataElement* deviceElement = dataCollectionElement->GetNestedElement(i);
+      if (STRCASECMP(deviceElement->GetName(), "Device") != 0 || deviceElement->GetAttribute("Type") == NULL
+          || STRCASECMP(deviceElement->GetAttribute("Type"), "SavedDataSource") != 0)
+      {
+        continue;
+      }
+      deviceElement->SetAttribute("StreamingEnabled", "TRUE");
+      deviceElement->SetAttribute("UseOriginalTimestamps", "TRUE");
+      deviceElement->SetDoubleAttribute("ReplaySpeedFactor", replaySpeedFactor);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Checks that each video source of the saved data sources received frames and the frames are not replayed ahead of time.
+  // The latest timestamps are stored in latestTimestamps (one element for each video source) and must be larger than the previous values.
+  PlusStatus CheckReplayedTimestamps(vtkPlusDataCollector* dataCollector, double replaySpeedFactor, std::vector<double>& latestTimestamps)
+  {
+    PlusStatus status = PLUS_SUCCESS;
+    unsigned int sourceIndex = 0;
+    for (DeviceCollectionConstIterator it = dataCollector->GetDeviceConstIteratorBegin(); it != dataCollector->GetDeviceConstIteratorEnd(); ++it)
+    {
+      vtkPlusSavedDataSource* savedDataSource = dynamic_cast<vtkPlusSavedDataSource*>(*it);
+      if (savedDataSource == NULL || !savedDataSource->GetStreamingEnabled())
+      {
+        continue;
+      }
+      std::vector<vtkPlusDataSource*> videoSources = savedDataSource->GetVideoSources();
+      for (std::vector<vtkPlusDataSource*>::iterator sourceIt = videoSources.begin(); sourceIt != videoSources.end(); ++sourceIt, ++sourceIndex)
+      {
+        double latestTimestamp = 0.0;
+        if ((*sourceIt)->GetLatestTimeStamp(latestTimestamp) != ITEM_OK)
+        {
+          LOG_ERROR("No frame has been replayed by " << savedDataSource->GetDeviceId());
+          status = PLUS_FAIL;
+          continue;
+        }
+        double expectedReplayTime = (vtkPlusAccurateTimer::GetSystemTime() - (*sourceIt)->GetStartTime()) * replaySpeedFactor;
+        double replayTime = latestTimestamp - (*sourceIt)->GetStartTime();
+        if (replayTime > expectedReplayTime + REPLAY_TIME_TOLERANCE_SEC)
+        {
+          LOG_ERROR(savedDataSource->GetDeviceId() << " replays the frames too fast: replay time is " << replayTime << " sec, expected at most " << expectedReplayTime << " sec");
+          status = PLUS_FAIL;
+        }
+        if (sourceIndex >= latestTimestamps.size())
+        {
+          latestTimestamps.push_back(latestTimestamp);
+          continue;
+        }
+        if (latestTimestamp <= latestTimestamps[sourceIndex])
+        {
+          LOG_ERROR(savedDataSource->GetDeviceId() << " did not replay new frames: latest timestamp is " << latestTimestamp << ", previously " << latestTimestamps[sourceIndex]);
+          status = PLUS_FAIL;
+        }
+        latestTimestamps[sourceIndex] = latestTimestamp;
+      }
+    }
+    return status;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus TestStreamingReplay(vtkPlusDataCollector* dataCollector, double replaySpeedFactor, double replayDurationSec)
+  {
+    if (dataCollector->Start() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to start data collection");
+      return PLUS_FAIL;
+    }
+
+    PlusStatus status = PLUS_SUCCESS;
+    std::vector<double> latestTimestamps;
+    vtkPlusAccurateTimer::Delay(replayDurationSec);
+    if (CheckReplayedTimestamps(dataCollector, replaySpeedFactor, latestTimestamps) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+
+    // Replay only the second half of the loop from now on
+    for (DeviceCollectionConstIterator it = dataCollector->GetDeviceConstIteratorBegin(); it != dataCollector->GetDeviceConstIteratorEnd(); ++it)
+    {
+      vtkPlusSavedDataSource* savedDataSource = dynamic_cast<vtkPlusSavedDataSource*>(*it);
+      if (savedDataSource == NULL || !savedDataSource->GetStreamingEnabled())
+      {
+        continue;
+      }
+      double loopStartTime = 0.0;
+      double loopStopTime = 0.0;
+      savedDataSource->GetLoopTimeRange(loopStartTime, loopStopTime);
+      savedDataSource->SetLoopTimeRange((loopStartTime + loopStopTime) / 2, loopStopTime);
+    }
+
+    vtkPlusAccurateTimer::Delay(replayDurationSec);
+    if (CheckReplayedTimestamps(dataCollector, replaySpeedFactor, latestTimestamps) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+
+    dataCollector->Stop();
+    return status;
+  }
+}
+
 
 int main( int argc, char** argv )
 {
@@ -27,6 +148,9 @@ int main( int argc, char** argv )
   std::string  inputConfigFileName;
   std::string  inputVideoBufferMetafile;
   std::string  inputTrackerBufferMetafile;
+  bool         streamingEnabled = false;
+  double       replaySpeedFactor = 1.0;
+  double       replayDurationSec = 2.0;
   int          verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
   vtksys::CommandLineArguments args;
@@ -34,6 +158,12 @@ int main( int argc, char** argv )
 
   args.AddArgument( "--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT,
     &inputConfigFileName, "Name of the input configuration file." );
+  args.AddBooleanArgument( "--streaming-enabled", &streamingEnabled,
+    "Read the frames from the file during the replay in all saved data sources and check the replayed timestamps" );
+  args.AddArgument( "--replay-speed-factor", vtksys::CommandLineArguments::EQUAL_ARGUMENT,
+    &replaySpeedFactor, "Replay speed relative to the recording speed, used with --streaming-enabled (default: 1.0)" );
+  args.AddArgument( "--replay-duration-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT,
+    &replayDurationSec, "Time to replay before and after changing the loop range, used with --streaming-enabled (default: 2.0)" );
   args.AddArgument( "--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, 
     &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug 5=trace)" );  
 
@@ -54,6 +184,16 @@ int main( int argc, char** argv )
     return EXIT_FAILURE;
   }
 
+  if ( streamingEnabled )
+  {
+    if ( replaySpeedFactor <= 0 )
+    {
+      LOG_ERROR("Replay speed factor must be positive: " << replaySpeedFactor);
+      return EXIT_FAILURE;
+    }
+    OverrideSavedDataSourceConfiguration(configRootElement, replaySpeedFactor);
+  }
+
   vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
 
   vtkSmartPointer<vtkPlusDataCollector> dataCollector = vtkSmartPointer<vtkPlusDataCollector>::New();
@@ -65,7 +205,13 @@ int main( int argc, char** argv )
 
   // TODO: Check if the read transforms are really the same as in the ones recorded in the data file.
 
+  int exitCode = EXIT_SUCCESS;
+  if ( streamingEnabled && TestStreamingReplay(dataCollector, replaySpeedFactor, replayDurationSec) != PLUS_SUCCESS )
+  {
+    exitCode = EXIT_FAILURE;
+  }
+
   dataCollector->Disconnect();
   
-  return EXIT_SUCCESS;
+  return exitCode;
 }
@@ -0,0 +1,318 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file SerialLineTest.cxx
+  \brief This program tests serial communication through SerialLine and vtkPlusGenericSerialDevice on POSIX systems.
+
+  A pseudo-terminal pair replaces the serial port: the tested classes open the slave side, while a responder
+  thread serves the master side. The responder replies to each line it receives and sends binary frames in
+  multiple chunks on request.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusSerialLine.h"
+#include "vtkPlusGenericSerialDevice.h"
+
+// VTK includes
+#include <vtkMultiThreader.h>
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+#include <vtksys/SystemTools.hxx>
+
+// System includes
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace
+{
+  const int FRAME_SIZE = 10;
+  const int TIMEOUT_MS = 2000;
+  const int SHORT_TIMEOUT_MS = 200;
+
+  //----------------------------------------------------------------------------
+  struct ResponderInfo
+  {
+    int MasterHandle;
+    std::atomic<bool> StopRequested;
+  };
+
+  //----------------------------------------------------------------------------
+  void WriteToMaster(int masterHandle, const std::string& data)
+  {
+    std::string::size_type numberOfBytesWritten = 0;
+    while (numberOfBytesWritten < data.size())
+    {
+      ssize_t result = write(masterHandle, data.data() + numberOfBytesWritten, data.size() - numberOfBytesWritten);
+      if (result < 0 && errno != EINTR && errno != EAGAIN)
+      {
+        return;
+      }
+      if (result > 0)
+      {
+        numberOfBytesWritten += result;
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+    Replies "ACK <command>" followed by CR to each CR-terminated command. The FRAME command is answered
+    by a binary frame of FRAME_SIZE bytes, sent in two parts with a short delay between them.
+  */
+  VTK_THREAD_RETURN_TYPE ResponderThread(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    ResponderInfo* info = static_cast<ResponderInfo*>(threadInfo->UserData);
+    std::string received;
+    while (!info->StopRequested)
+    {
+      struct pollfd pollDescriptor;
+      pollDescriptor.fd = info->MasterHandle;
+      pollDescriptor.events = POLLIN;
+      pollDescriptor.revents = 0;
+      if (poll(&pollDescriptor, 1, 50) <= 0 || !(pollDescriptor.revents & POLLIN))
+      {
+        continue;
+      }
+      char buffer[256];
+      ssize_t numberOfBytesRead = read(info->MasterHandle, buffer, sizeof(buffer));
+      if (numberOfBytesRead <= 0)
+      {
+        continue;
+      }
+      received.append(buffer, numberOfBytesRead);
+      std::string::size_type lineEndingPosition;
+      while ((lineEndingPosition = received.find('\r')) != std::string::npos)
+      {
+        std::string command = received.substr(0, lineEndingPosition);
+        received.erase(0, lineEndingPosition + 1);
+        if (command == "FRAME")
+        {
+          std::string frame;
+          for (int i = 0; i < FRAME_SIZE; ++i)
+          {
+            frame.push_back(static_cast<char>(i == 3 ? '\r' : i * 17));
+          }
+          WriteToMaster(info->MasterHandle, frame.substr(0, FRAME_SIZE / 2));
+          vtksys::SystemTools::Delay(50);
+          WriteToMaster(info->MasterHandle, frame.substr(FRAME_SIZE / 2));
+        }
+        else
+        {
+          WriteToMaster(info->MasterHandle, "ACK " + command + "\r");
+        }
+      }
+    }
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestSerialLine(const std::string& portName)
+  {
+    int numberOfErrors = 0;
+
+    SerialLine serial;
+    serial.SetPortName(portName);
+    serial.SetSerialPortSpeed(115200);
+    serial.SetMaxReplyTime(TIMEOUT_MS);
+    if (!serial.Open())
+    {
+      LOG_ERROR("Failed to open serial port " << portName);
+      return 1;
+    }
+
+    // Line reading: two commands sent at once, replies are read line by line
+    std::string commands = "HELLO\rWORLD\r";
+    if (serial.Write(reinterpret_cast<const SerialLine::BYTE*>(commands.data()), commands.size()) != static_cast<int>(commands.size()))
+    {
+      LOG_ERROR("Failed to write commands");
+      numberOfErrors++;
+    }
+    std::string line;
+    if (serial.ReadLine(line, "\r", TIMEOUT_MS) != PLUS_SUCCESS || line != "ACK HELLO")
+    {
+      LOG_ERROR("Unexpected first reply: '" << line << "'");
+      numberOfErrors++;
+    }
+    if (serial.ReadLine(line, "\r", TIMEOUT_MS) != PLUS_SUCCESS || line != "ACK WORLD")
+    {
+      LOG_ERROR("Unexpected second reply: '" << line << "'");
+      numberOfErrors++;
+    }
+
+    // No more data: waiting times out, but not much earlier than requested
+    double startTime = vtkPlusAccurateTimer::GetSystemTime();
+    if (serial.WaitForData(SHORT_TIMEOUT_MS))
+    {
+      LOG_ERROR("Data is reported to be available, but the responder did not send any");
+      numberOfErrors++;
+    }
+    double waitTimeMs = (vtkPlusAccurateTimer::GetSystemTime() - startTime) * 1000.0;
+    if (waitTimeMs < SHORT_TIMEOUT_MS * 0.8)
+    {
+      LOG_ERROR("Waiting for data returned too early: after " << waitTimeMs << "ms instead of " << SHORT_TIMEOUT_MS << "ms");
+      numberOfErrors++;
+    }
+    if (serial.ReadLine(line, "\r", 0) != PLUS_FAIL || !line.empty())
+    {
+      LOG_ERROR("Reading a line succeeded without any data");
+      numberOfErrors++;
+    }
+
+    // Frame reading: the frame arrives in two parts and contains the line ending character
+    if (serial.Write(reinterpret_cast<const SerialLine::BYTE*>("FRAME\r"), 6) != 6)
+    {
+      LOG_ERROR("Failed to write frame request");
+      numberOfErrors++;
+    }
+    SerialLine::BYTE frame[FRAME_SIZE] = {0};
+    if (!serial.ReadFrame(frame, FRAME_SIZE, TIMEOUT_MS))
+    {
+      LOG_ERROR("Failed to read frame");
+      numberOfErrors++;
+    }
+    for (int i = 0; i < FRAME_SIZE; ++i)
+    {
+      SerialLine::BYTE expected = static_cast<SerialLine::BYTE>(i == 3 ? '\r' : i * 17);
+      if (frame[i] != expected)
+      {
+        LOG_ERROR("Frame byte " << i << " mismatch: expected " << int(expected) << ", received " << int(frame[i]));
+        numberOfErrors++;
+      }
+    }
+
+    // Incomplete frame: the received part is kept and completed by the next read
+    if (serial.Write(reinterpret_cast<const SerialLine::BYTE*>("FRAME\r"), 6) != 6)
+    {
+      LOG_ERROR("Failed to write frame request");
+      numberOfErrors++;
+    }
+    SerialLine::BYTE doubleFrame[2 * FRAME_SIZE] = {0};
+    if (serial.ReadFrame(doubleFrame, 2 * FRAME_SIZE, SHORT_TIMEOUT_MS))
+    {
+      LOG_ERROR("Reading a frame succeeded although not enough data was sent");
+      numberOfErrors++;
+    }
+    if (serial.GetNumberOfBytesAvailableForReading() != FRAME_SIZE)
+    {
+      LOG_ERROR("Incomplete frame is not kept: " << serial.GetNumberOfBytesAvailableForReading() << " bytes available instead of " << FRAME_SIZE);
+      numberOfErrors++;
+    }
+    if (serial.Write(reinterpret_cast<const SerialLine::BYTE*>("FRAME\r"), 6) != 6 || !serial.ReadFrame(doubleFrame, 2 * FRAME_SIZE, TIMEOUT_MS)
+        || memcmp(doubleFrame, frame, FRAME_SIZE) != 0 || memcmp(doubleFrame + FRAME_SIZE, frame, FRAME_SIZE) != 0)
+    {
+      LOG_ERROR("Failed to complete the frame");
+      numberOfErrors++;
+    }
+
+    serial.Close();
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestGenericSerialDevice(const std::string& portName)
+  {
+    int numberOfErrors = 0;
+
+    vtkSmartPointer<vtkPlusGenericSerialDevice> device = vtkSmartPointer<vtkPlusGenericSerialDevice>::New();
+    device->SetDeviceId("SerialDevice");
+    device->SetSerialPortName(portName);
+    device->SetBaudRate(115200);
+    device->SetMaximumReplyDelaySec(TIMEOUT_MS / 1000.0);
+    device->SetMaximumReplyDurationSec(TIMEOUT_MS / 1000.0);
+    if (device->Connect() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to connect to generic serial device on " << portName);
+      return 1;
+    }
+
+    // The reply must be available as soon as the responder sends it, not after a polling period
+    const int numberOfRoundTrips = 20;
+    double startTime = vtkPlusAccurateTimer::GetSystemTime();
+    for (int i = 0; i < numberOfRoundTrips; ++i)
+    {
+      std::ostringstream command;
+      command << "COMMAND" << i;
+      std::string reply;
+      if (device->SendText(command.str(), &reply) != PLUS_SUCCESS || reply != "ACK " + command.str())
+      {
+        LOG_ERROR("Unexpected reply to " << command.str() << ": '" << reply << "'");
+        numberOfErrors++;
+      }
+    }
+    double averageRoundTripTimeMs = (vtkPlusAccurateTimer::GetSystemTime() - startTime) * 1000.0 / numberOfRoundTrips;
+    LOG_INFO("Average command round-trip time: " << averageRoundTripTimeMs << "ms");
+
+    device->Disconnect();
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  // Create the pseudo-terminal pair
+  int masterHandle = posix_openpt(O_RDWR | O_NOCTTY);
+  if (masterHandle < 0 || grantpt(masterHandle) != 0 || unlockpt(masterHandle) != 0 || ptsname(masterHandle) == NULL)
+  {
+    LOG_ERROR("Failed to create pseudo-terminal");
+    return EXIT_FAILURE;
+  }
+  std::string slaveName = ptsname(masterHandle);
+  LOG_INFO("Serial port replaced by pseudo-terminal " << slaveName);
+
+  ResponderInfo responderInfo;
+  responderInfo.MasterHandle = masterHandle;
+  responderInfo.StopRequested = false;
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+  int responderThreadId = threader->SpawnThread(ResponderThread, &responderInfo);
+
+  int numberOfErrors = TestSerialLine(slaveName);
+  numberOfErrors += TestGenericSerialDevice(slaveName);
+
+  responderInfo.StopRequested = true;
+  threader->TerminateThread(responderThreadId);
+  close(masterHandle);
+
+  if (numberOfErrors != 0)
+  {
+    LOG_INFO("Test failed!");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully!");
+  return EXIT_SUCCESS;
+}
@@ -20,6 +20,7 @@ See License.txt for details.
 // VTK includes
 #include <vtksys/CommandLineArguments.hxx>
 #include <vtksys/SystemTools.hxx>
+#include <vtkDoubleArray.h>
 #include <vtkTable.h>
 
 
@@ -33,6 +34,7 @@ int main(int argc, char** argv)
   int inputAveragedItemsForFiltering(20);
   double inputMaxTimestampDifference(0.080);
   double inputMinStdevReductionFactor(3.0);
+  bool inputRobustFiltering(false);
   std::string inputTransformName;
 
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
@@ -45,6 +47,7 @@ int main(int argc, char** argv)
   args.AddArgument("--source-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputMetafile, "Input sequence metafile.");
   args.AddArgument("--averaged-items-for-filtering", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputAveragedItemsForFiltering, "Number of averaged items used for filtering (Default: 20).");
   args.AddArgument("--max-timestamp-difference", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputMaxTimestampDifference, "The maximum difference between the filtered and nonfiltered timestamps for each frame (Default: 0.08s).");
+  args.AddArgument("--robust-filtering", vtksys::CommandLineArguments::NO_ARGUMENT, &inputRobustFiltering, "Limit the effect of outlier timestamps on the filtering.");
   args.AddArgument("--min-stdev-reduction-factor", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputMinStdevReductionFactor, "Minimum factor that the filtering should reduces the standard deviation of the frame periods on filtered data (Default: 3.0 ).");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
 
@@ -88,6 +91,8 @@ int main(int argc, char** argv)
   LOG_INFO("Copy buffer to tracker buffer...");
   vtkSmartPointer<vtkPlusBuffer> trackerBuffer = vtkSmartPointer<vtkPlusBuffer>::New();
   trackerBuffer->SetTimeStampReporting(true);
+  trackerBuffer->SetAveragedItemsForFiltering(inputAveragedItemsForFiltering);
+  trackerBuffer->SetRobustTimestampFiltering(inputRobustFiltering);
   // compute filtered timestamps now to test the filtering
   if (trackerBuffer->CopyTransformFromTrackedFrameList(trackerFrameList, vtkPlusBuffer::READ_UNFILTERED_COMPUTE_FILTERED_TIMESTAMPS, transformName) != PLUS_SUCCESS)
   {
@@ -185,6 +190,49 @@ int main(int argc, char** argv)
     numberOfErrors++;
   }
 
+  // 3. Without robust filtering the filtered timestamps shall be the same as the values of the line fitted to the last (averaged items) unfiltered timestamps
+  // (the buffer computes the line incrementally, here it is computed directly)
+  vtkDoubleArray* reportFrameNumbers = vtkDoubleArray::SafeDownCast(timestampReportTable->GetColumnByName("FrameNumber"));
+  vtkDoubleArray* reportUnfilteredTimestamps = vtkDoubleArray::SafeDownCast(timestampReportTable->GetColumnByName("UnfilteredTimestamp"));
+  vtkDoubleArray* reportFilteredTimestamps = vtkDoubleArray::SafeDownCast(timestampReportTable->GetColumnByName("FilteredTimestamp"));
+  if (!inputRobustFiltering && reportFrameNumbers != NULL && reportUnfilteredTimestamps != NULL && reportFilteredTimestamps != NULL && inputAveragedItemsForFiltering > 1)
+  {
+    const double maxAllowedFitDifference = 1e-6;
+    double maxFitDifference(0);
+    for (vtkIdType row = inputAveragedItemsForFiltering - 1; row < timestampReportTable->GetNumberOfRows(); ++row)
+    {
+      double xMean(0);
+      double yMean(0);
+      for (vtkIdType i = row - inputAveragedItemsForFiltering + 1; i <= row; ++i)
+      {
+        xMean += reportFrameNumbers->GetValue(i);
+        yMean += reportUnfilteredTimestamps->GetValue(i);
+      }
+      xMean /= inputAveragedItemsForFiltering;
+      yMean /= inputAveragedItemsForFiltering;
+      double covarianceXY(0);
+      double varianceX(0);
+      for (vtkIdType i = row - inputAveragedItemsForFiltering + 1; i <= row; ++i)
+      {
+        double xiMinusXmean = reportFrameNumbers->GetValue(i) - xMean;
+        covarianceXY += xiMinusXmean * (reportUnfilteredTimestamps->GetValue(i) - yMean);
+        varianceX += xiMinusXmean * xiMinusXmean;
+      }
+      double expectedFilteredTimestamp = yMean + covarianceXY / varianceX * (reportFrameNumbers->GetValue(row) - xMean);
+      double fitDifference = fabs(expectedFilteredTimestamp - reportFilteredTimestamps->GetValue(row));
+      if (fitDifference > maxFitDifference)
+      {
+        maxFitDifference = fitDifference;
+      }
+    }
+    LOG_INFO("Maximum difference from directly computed line fit: " << maxFitDifference * 1000 << "ms");
+    if (maxFitDifference > maxAllowedFitDifference)
+    {
+      LOG_ERROR("Filtered timestamps differ from the directly computed line fit (difference: " << maxFitDifference << "s, threshold: " << maxAllowedFitDifference << "s)");
+      numberOfErrors++;
+    }
+  }
+
   std::string reportFile = vtksys::SystemTools::GetCurrentWorkingDirectory() + std::string("/TimestampReport.txt");
 
   if (PlusPlotter::WriteTableToFile(*timestampReportTable, reportFile.c_str()) != PLUS_SUCCESS)
@@ -0,0 +1,457 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file TrackedFrameRetrievalAllocationTest.cxx
+  \brief This program tests that retrieving tracked frames from a channel into a reused frame object
+  does not allocate memory once the frame and the channel's temporary items are set up, that
+  GetTrackedFrameList reuses recycled frames, and that reused frames do not keep any content
+  (transforms, fields, image) from their previous use.
+
+  Memory allocations are counted by replacing the global operator new. On platforms where the replacement
+  does not apply to allocations made inside shared libraries (e.g., Windows DLLs) the check is less strict.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusTrackedFrame.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusTrackedFrameList.h"
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkTransform.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <cstdlib>
+#include <new>
+#include <set>
+
+//----------------------------------------------------------------------------
+// Allocation counting
+
+static bool AllocationCountingEnabled = false;
+static long AllocationCount = 0;
+
+void* operator new(std::size_t size)
+{
+  if (AllocationCountingEnabled)
+  {
+    ++AllocationCount;
+  }
+  void* ptr = malloc(size > 0 ? size : 1);
+  if (ptr == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void* ptr) throw()
+{
+  free(ptr);
+}
+
+void operator delete[](void* ptr) throw()
+{
+  free(ptr);
+}
+
+//----------------------------------------------------------------------------
+namespace
+{
+  const unsigned int FRAME_SIZE[3] = {64, 48, 1};
+  const double VIDEO_FRAME_PERIOD_SEC = 0.1;
+  const double TRACKER_FRAME_PERIOD_SEC = 0.03;
+  const int NUMBER_OF_VIDEO_FRAMES = 20;
+  const int NUMBER_OF_RETRIEVALS = 200;
+  const int NUMBER_OF_LIST_FRAMES = 5;
+
+  //----------------------------------------------------------------------------
+  int GetNumberOfTrackerFrames()
+  {
+    return static_cast<int>(NUMBER_OF_VIDEO_FRAMES * VIDEO_FRAME_PERIOD_SEC / TRACKER_FRAME_PERIOD_SEC) + 3;
+  }
+
+  //----------------------------------------------------------------------------
+  double GetTrackerTimestamp(int trackerFrameIndex)
+  {
+    return 1.0 - TRACKER_FRAME_PERIOD_SEC + 0.005 + trackerFrameIndex * TRACKER_FRAME_PERIOD_SEC;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus FillDataSources(vtkPlusDataSource* videoSource, vtkPlusDataSource* toolSource, vtkPlusDataSource* fieldSource)
+  {
+    std::vector<unsigned char> pixels(FRAME_SIZE[0] * FRAME_SIZE[1] * FRAME_SIZE[2], 0);
+    for (int i = 0; i < NUMBER_OF_VIDEO_FRAMES; ++i)
+    {
+      double timestamp = 1.0 + i * VIDEO_FRAME_PERIOD_SEC;
+      std::fill(pixels.begin(), pixels.end(), static_cast<unsigned char>(i));
+      PlusTrackedFrame::FieldMapType customFields;
+      customFields["DepthMm"] = (i % 2 == 0 ? "50" : "60");
+      if (videoSource->AddItem(&pixels[0], US_IMG_ORIENT_MF, FRAME_SIZE, VTK_UNSIGNED_CHAR, 1, US_IMG_BRIGHTNESS, 0, i, timestamp, timestamp, &customFields) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add video frame " << i);
+        return PLUS_FAIL;
+      }
+    }
+
+    // Tracking data covers the video frames, with timestamps between the video timestamps so that transforms are interpolated
+    vtkSmartPointer<vtkTransform> toolTransform = vtkSmartPointer<vtkTransform>::New();
+    for (int i = 0; i < GetNumberOfTrackerFrames(); ++i)
+    {
+      double timestamp = GetTrackerTimestamp(i);
+      toolTransform->Identity();
+      toolTransform->Translate(i * 0.5, 10.0, -i * 0.25);
+      toolTransform->RotateY(i * 2.0);
+      if (toolSource->AddTimeStampedItem(toolTransform->GetMatrix(), TOOL_OK, i, timestamp, timestamp) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add tracker item " << i);
+        return PLUS_FAIL;
+      }
+      PlusTrackedFrame::FieldMapType fields;
+      fields["ButtonState"] = (i % 3 == 0 ? "Pressed" : "Released");
+      if (fieldSource->AddItem(fields, i, timestamp, timestamp) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add field data item " << i);
+        return PLUS_FAIL;
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  bool IsFrameEqual(PlusTrackedFrame& reusedFrame, PlusTrackedFrame& newFrame)
+  {
+    if (reusedFrame.GetCustomFields() != newFrame.GetCustomFields())
+    {
+      return false;
+    }
+    PlusVideoFrame* reusedImage = reusedFrame.GetImageData();
+    PlusVideoFrame* newImage = newFrame.GetImageData();
+    if (reusedImage->GetFrameSizeInBytes() != newImage->GetFrameSizeInBytes())
+    {
+      return false;
+    }
+    return memcmp(reusedImage->GetScalarPointer(), newImage->GetScalarPointer(), newImage->GetFrameSizeInBytes()) == 0;
+  }
+
+  //----------------------------------------------------------------------------
+  // Retrieve frames while the tools, field data sources and fields change and check that
+  // the recycled and reused frames are the same as newly retrieved frames
+  int TestVaryingFrameContent(vtkPlusDataSource* videoSource, vtkPlusDataSource* probeSource, vtkPlusDataSource* footSwitchSource, const std::vector<double>& videoTimestamps)
+  {
+    int numberOfErrors(0);
+
+    // The fields of the pedal items differ between consecutive items
+    vtkSmartPointer<vtkPlusDataSource> stylusSource = vtkSmartPointer<vtkPlusDataSource>::New();
+    stylusSource->SetId("StylusToTracker");
+    stylusSource->SetType(DATA_SOURCE_TYPE_TOOL);
+    stylusSource->SetBufferSize(200);
+    vtkSmartPointer<vtkPlusDataSource> pedalSource = vtkSmartPointer<vtkPlusDataSource>::New();
+    pedalSource->SetId("Pedal");
+    pedalSource->SetType(DATA_SOURCE_TYPE_FIELDDATA);
+    pedalSource->SetBufferSize(200);
+    vtkSmartPointer<vtkTransform> stylusTransform = vtkSmartPointer<vtkTransform>::New();
+    for (int i = 0; i < GetNumberOfTrackerFrames(); ++i)
+    {
+      double timestamp = GetTrackerTimestamp(i);
+      stylusTransform->Identity();
+      stylusTransform->Translate(-i * 0.5, 20.0, i * 0.25);
+      PlusTrackedFrame::FieldMapType fields;
+      if (i % 2 == 0)
+      {
+        fields["PedalState"] = "Down";
+      }
+      else
+      {
+        fields["PedalAngleDeg"] = "12";
+      }
+      if (stylusSource->AddTimeStampedItem(stylusTransform->GetMatrix(), TOOL_OK, i, timestamp, timestamp) != PLUS_SUCCESS
+          || pedalSource->AddItem(fields, i, timestamp, timestamp) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add stylus or pedal item " << i);
+        return 1;
+      }
+    }
+
+    vtkSmartPointer<vtkPlusChannel> channel = vtkSmartPointer<vtkPlusChannel>::New();
+    channel->SetChannelId("VaryingContentStream");
+    channel->SetVideoSource(videoSource);
+    channel->AddTool(probeSource);
+    channel->AddTool(stylusSource);
+    channel->AddFieldDataSource(footSwitchSource);
+    channel->AddFieldDataSource(pedalSource);
+
+    vtkSmartPointer<vtkPlusTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkPlusTrackedFrameList>::New();
+    double timestampOfLastFrameAlreadyGot = videoTimestamps[0];
+    if (channel->GetTrackedFrameList(timestampOfLastFrameAlreadyGot, trackedFrameList, NUMBER_OF_LIST_FRAMES) != PLUS_SUCCESS
+        || trackedFrameList->GetNumberOfTrackedFrames() != static_cast<unsigned int>(NUMBER_OF_LIST_FRAMES))
+    {
+      LOG_ERROR("Failed to get " << NUMBER_OF_LIST_FRAMES << " frames with all the data sources into the tracked frame list");
+      return 1;
+    }
+    for (unsigned int i = 0; i < trackedFrameList->GetNumberOfTrackedFrames(); ++i)
+    {
+      if (!trackedFrameList->GetTrackedFrame(i)->IsCustomFrameTransformNameDefined(PlusTransformName("Stylus", "Tracker")))
+      {
+        LOG_ERROR("StylusToTracker transform is missing from tracked frame " << i << " of the list");
+        numberOfErrors++;
+      }
+    }
+    channel->RecycleTrackedFrames(trackedFrameList);
+
+    // Frames that are refilled after a tool and a field data source are removed must not keep their fields
+    channel->RemoveTool("StylusToTracker");
+    channel->RemoveFieldDataSource("Pedal");
+    timestampOfLastFrameAlreadyGot = videoTimestamps[0];
+    if (channel->GetTrackedFrameList(timestampOfLastFrameAlreadyGot, trackedFrameList, NUMBER_OF_LIST_FRAMES) != PLUS_SUCCESS
+        || trackedFrameList->GetNumberOfTrackedFrames() != static_cast<unsigned int>(NUMBER_OF_LIST_FRAMES))
+    {
+      LOG_ERROR("Failed to get " << NUMBER_OF_LIST_FRAMES << " frames into the tracked frame list after removing data sources");
+      return numberOfErrors + 1;
+    }
+    for (unsigned int i = 0; i < trackedFrameList->GetNumberOfTrackedFrames(); ++i)
+    {
+      PlusTrackedFrame* listFrame = trackedFrameList->GetTrackedFrame(i);
+      if (listFrame->IsCustomFrameTransformNameDefined(PlusTransformName("Stylus", "Tracker"))
+          || listFrame->IsCustomFrameFieldDefined("StylusToTrackerTransformStatus")
+          || listFrame->IsCustomFrameFieldDefined("PedalState")
+          || listFrame->IsCustomFrameFieldDefined("PedalAngleDeg"))
+      {
+        LOG_ERROR("Recycled tracked frame " << i << " kept a field of a removed data source");
+        numberOfErrors++;
+      }
+      PlusTrackedFrame newFrame;
+      if (channel->GetTrackedFrame(listFrame->GetTimestamp(), newFrame) != PLUS_SUCCESS || !IsFrameEqual(*listFrame, newFrame))
+      {
+        LOG_ERROR("Recycled tracked frame " << i << " content differs from a newly retrieved frame after removing data sources");
+        numberOfErrors++;
+      }
+    }
+    channel->RecycleTrackedFrames(trackedFrameList);
+
+    // Fields of a field data source that differ between frames must not be kept in a reused frame
+    channel->AddFieldDataSource(pedalSource);
+    PlusTrackedFrame reusedFrame;
+    for (unsigned int i = 0; i < videoTimestamps.size(); ++i)
+    {
+      PlusTrackedFrame newFrame;
+      if (channel->GetTrackedFrame(videoTimestamps[i], reusedFrame) != PLUS_SUCCESS
+          || channel->GetTrackedFrame(videoTimestamps[i], newFrame) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to get tracked frame with varying fields at time " << videoTimestamps[i]);
+        numberOfErrors++;
+        continue;
+      }
+      if (!IsFrameEqual(reusedFrame, newFrame))
+      {
+        LOG_ERROR("Reused tracked frame with varying fields differs from a newly retrieved frame at time " << videoTimestamps[i]);
+        numberOfErrors++;
+      }
+    }
+
+    // A frame retrieved without image data must not keep the image of its previous use
+    if (channel->GetTrackedFrame(videoTimestamps[1], reusedFrame, false) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to get tracked frame without image data at time " << videoTimestamps[1]);
+      numberOfErrors++;
+    }
+    else if (reusedFrame.GetImageData()->IsImageValid())
+    {
+      LOG_ERROR("Reused tracked frame kept its image when it was retrieved without image data");
+      numberOfErrors++;
+    }
+
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  // Set up a channel with a video source, a tool and a field data source
+  vtkSmartPointer<vtkPlusDataSource> videoSource = vtkSmartPointer<vtkPlusDataSource>::New();
+  videoSource->SetId("Video");
+  videoSource->SetType(DATA_SOURCE_TYPE_VIDEO);
+  videoSource->SetInputImageOrientation(US_IMG_ORIENT_MF);
+  videoSource->SetOutputImageOrientation(US_IMG_ORIENT_MF);
+  videoSource->SetImageType(US_IMG_BRIGHTNESS);
+  videoSource->SetPixelType(VTK_UNSIGNED_CHAR);
+  videoSource->SetNumberOfScalarComponents(1);
+  videoSource->SetInputFrameSize(FRAME_SIZE[0], FRAME_SIZE[1], FRAME_SIZE[2]);
+  videoSource->SetBufferSize(NUMBER_OF_VIDEO_FRAMES);
+
+  vtkSmartPointer<vtkPlusDataSource> toolSource = vtkSmartPointer<vtkPlusDataSource>::New();
+  toolSource->SetId("ProbeToTracker");
+  toolSource->SetType(DATA_SOURCE_TYPE_TOOL);
+  toolSource->SetBufferSize(200);
+
+  vtkSmartPointer<vtkPlusDataSource> fieldSource = vtkSmartPointer<vtkPlusDataSource>::New();
+  fieldSource->SetId("FootSwitch");
+  fieldSource->SetType(DATA_SOURCE_TYPE_FIELDDATA);
+  fieldSource->SetBufferSize(200);
+
+  vtkSmartPointer<vtkPlusChannel> channel = vtkSmartPointer<vtkPlusChannel>::New();
+  channel->SetChannelId("TrackedVideoStream");
+  channel->SetVideoSource(videoSource);
+  channel->AddTool(toolSource);
+  channel->AddFieldDataSource(fieldSource);
+
+  if (FillDataSources(videoSource, toolSource, fieldSource) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Test failed: unable to fill the data sources");
+    return EXIT_FAILURE;
+  }
+
+  std::vector<double> videoTimestamps;
+  for (int i = 0; i < NUMBER_OF_VIDEO_FRAMES; ++i)
+  {
+    videoTimestamps.push_back(1.0 + i * VIDEO_FRAME_PERIOD_SEC);
+  }
+
+  int numberOfErrors(0);
+
+  // Warm up: the first retrievals set up the reused frame and the channel's temporary items.
+  // Each retrieved frame is also compared to a frame that is retrieved into a new object.
+  PlusTrackedFrame reusedFrame;
+  for (unsigned int i = 0; i < videoTimestamps.size(); ++i)
+  {
+    PlusTrackedFrame newFrame;
+    if (channel->GetTrackedFrame(videoTimestamps[i], reusedFrame) != PLUS_SUCCESS
+        || channel->GetTrackedFrame(videoTimestamps[i], newFrame) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to get tracked frame at time " << videoTimestamps[i]);
+      numberOfErrors++;
+      continue;
+    }
+    if (!IsFrameEqual(reusedFrame, newFrame))
+    {
+      LOG_ERROR("Tracked frame retrieved into a reused object differs from the one retrieved into a new object at time " << videoTimestamps[i]);
+      numberOfErrors++;
+    }
+    if (!reusedFrame.IsCustomFrameTransformNameDefined(PlusTransformName("Probe", "Tracker")))
+    {
+      LOG_ERROR("ProbeToTracker transform is missing from the tracked frame at time " << videoTimestamps[i]);
+      numberOfErrors++;
+    }
+  }
+
+  // Steady state: refilling the same frame object must not allocate memory
+  long numberOfFailedRetrievals = 0;
+  AllocationCount = 0;
+  AllocationCountingEnabled = true;
+  for (int i = 0; i < NUMBER_OF_RETRIEVALS; ++i)
+  {
+    if (channel->GetTrackedFrame(videoTimestamps[i % videoTimestamps.size()], reusedFrame) != PLUS_SUCCESS)
+    {
+      numberOfFailedRetrievals++;
+    }
+  }
+  AllocationCountingEnabled = false;
+  long steadyStateAllocationCount = AllocationCount;
+
+  if (numberOfFailedRetrievals > 0)
+  {
+    LOG_ERROR("Failed to get " << numberOfFailedRetrievals << " tracked frames in steady state");
+    numberOfErrors++;
+  }
+  if (steadyStateAllocationCount != 0)
+  {
+    LOG_ERROR("Memory was allocated " << steadyStateAllocationCount << " times during " << NUMBER_OF_RETRIEVALS << " tracked frame retrievals into a reused frame (expected: 0)");
+    numberOfErrors++;
+  }
+  else
+  {
+    LOG_INFO("No memory allocation during " << NUMBER_OF_RETRIEVALS << " tracked frame retrievals into a reused frame");
+  }
+
+  // Tracked frame list: recycled frames are reused by the next GetTrackedFrameList call
+  vtkSmartPointer<vtkPlusTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkPlusTrackedFrameList>::New();
+  double timestampOfLastFrameAlreadyGot = videoTimestamps[0];
+  if (channel->GetTrackedFrameList(timestampOfLastFrameAlreadyGot, trackedFrameList, NUMBER_OF_LIST_FRAMES) != PLUS_SUCCESS
+      || trackedFrameList->GetNumberOfTrackedFrames() != static_cast<unsigned int>(NUMBER_OF_LIST_FRAMES))
+  {
+    LOG_ERROR("Failed to get " << NUMBER_OF_LIST_FRAMES << " frames into the tracked frame list");
+    numberOfErrors++;
+  }
+  std::set<PlusTrackedFrame*> recycledFrames;
+  for (unsigned int i = 0; i < trackedFrameList->GetNumberOfTrackedFrames(); ++i)
+  {
+    recycledFrames.insert(trackedFrameList->GetTrackedFrame(i));
+  }
+  channel->RecycleTrackedFrames(trackedFrameList);
+  if (trackedFrameList->GetNumberOfTrackedFrames() != 0)
+  {
+    LOG_ERROR("Tracked frame list is not empty after recycling its frames");
+    numberOfErrors++;
+  }
+
+  timestampOfLastFrameAlreadyGot = videoTimestamps[0];
+  if (channel->GetTrackedFrameList(timestampOfLastFrameAlreadyGot, trackedFrameList, NUMBER_OF_LIST_FRAMES) != PLUS_SUCCESS
+      || trackedFrameList->GetNumberOfTrackedFrames() != static_cast<unsigned int>(NUMBER_OF_LIST_FRAMES))
+  {
+    LOG_ERROR("Failed to get " << NUMBER_OF_LIST_FRAMES << " frames into the tracked frame list after recycling");
+    numberOfErrors++;
+  }
+  for (unsigned int i = 0; i < trackedFrameList->GetNumberOfTrackedFrames(); ++i)
+  {
+    PlusTrackedFrame* listFrame = trackedFrameList->GetTrackedFrame(i);
+    if (recycledFrames.find(listFrame) == recycledFrames.end())
+    {
+      LOG_ERROR("Tracked frame " << i << " of the list is not a recycled frame");
+      numberOfErrors++;
+    }
+    PlusTrackedFrame newFrame;
+    if (channel->GetTrackedFrame(listFrame->GetTimestamp(), newFrame) != PLUS_SUCCESS || !IsFrameEqual(*listFrame, newFrame))
+    {
+      LOG_ERROR("Recycled tracked frame " << i << " content differs from a newly retrieved frame");
+      numberOfErrors++;
+    }
+  }
+
+  numberOfErrors += TestVaryingFrameContent(videoSource, toolSource, fieldSource, videoTimestamps);
+
+  if (numberOfErrors != 0)
+  {
+    LOG_INFO("Test failed!");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully!");
+  return EXIT_SUCCESS;
+}
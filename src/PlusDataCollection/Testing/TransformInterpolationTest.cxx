@@ -162,6 +162,74 @@ int main(int argc, char **argv)
     prevmatrix->DeepCopy(matrix);      
   }
 
+  // Check batch retrieval results 
+  //****************************
+
+  std::vector<BufferItemUidType> rangeUids; 
+  std::vector<double> rangeTimestamps; 
+  if ( trackerBuffer->GetItemUidsFromTimeRange(startTime, endTime, rangeUids, rangeTimestamps) != ITEM_OK )
+  {
+    LOG_ERROR("Failed to get tracker buffer items between " << std::fixed << startTime << " and " << endTime); 
+    numberOfErrors++; 
+  }
+  else if ( static_cast<int>(rangeUids.size()) != trackerBuffer->GetNumberOfItems() || rangeTimestamps.size() != rangeUids.size() )
+  {
+    LOG_ERROR("Number of items in the full time range mismatch (retrieved: " << rangeUids.size() << ", expected: " << trackerBuffer->GetNumberOfItems() << ")"); 
+    numberOfErrors++; 
+  }
+  else
+  {
+    for ( unsigned int i = 1; i < rangeUids.size(); ++i )
+    {
+      if ( rangeUids[i] != rangeUids[i - 1] + 1 || rangeTimestamps[i] <= rangeTimestamps[i - 1] )
+      {
+        LOG_ERROR("Items in the time range are not consecutive (uid: " << rangeUids[i] << ", timestamp: " << std::fixed << rangeTimestamps[i] << ")"); 
+        numberOfErrors++; 
+      }
+    }
+  }
+
+  std::vector<double> sampleTimes; 
+  for ( double newTime = startTime; newTime < endTime; newTime += 1.0 / (frameRate * 5.0) )
+  {
+    sampleTimes.push_back(newTime); 
+  }
+  std::vector<StreamBufferItem> batchItems; 
+  std::vector<ItemStatus> batchItemStatuses; 
+  // Return value is not checked, items may be missing at some times, only the consistency with single item retrieval is tested
+  trackerBuffer->GetStreamBufferItemsFromTimes(sampleTimes, batchItems, batchItemStatuses, vtkPlusBuffer::INTERPOLATED); 
+  if ( batchItems.size() != sampleTimes.size() || batchItemStatuses.size() != sampleTimes.size() )
+  {
+    LOG_ERROR("Number of batch items mismatch (retrieved: " << batchItems.size() << ", expected: " << sampleTimes.size() << ")"); 
+    return EXIT_FAILURE; 
+  }
+  for ( unsigned int i = 0; i < sampleTimes.size(); ++i )
+  {
+    StreamBufferItem bufferItem;
+    ItemStatus itemStatus = trackerBuffer->GetStreamBufferItemFromTime(sampleTimes[i], &bufferItem, vtkPlusBuffer::INTERPOLATED); 
+    if ( itemStatus != batchItemStatuses[i] )
+    {
+      LOG_ERROR("Batch item status mismatch at time " << std::fixed << sampleTimes[i]); 
+      numberOfErrors++; 
+      continue; 
+    }
+    if ( itemStatus != ITEM_OK || bufferItem.GetStatus() != TOOL_OK )
+    {
+      continue; 
+    }
+    if ( bufferItem.GetMatrix(matrix) != PLUS_SUCCESS || batchItems[i].GetMatrix(prevmatrix) != PLUS_SUCCESS )
+    {
+      LOG_ERROR("Failed to get matrix from buffer!"); 
+      numberOfErrors++; 
+      continue; 
+    }
+    if ( PlusMath::GetPositionDifference(matrix, prevmatrix) > 0.001 || PlusMath::GetOrientationDifference(matrix, prevmatrix) > 0.001 )
+    {
+      LOG_ERROR("Batch item transform mismatch at time " << std::fixed << sampleTimes[i]); 
+      numberOfErrors++; 
+    }
+  }
+
   if ( numberOfErrors != 0 )
   {
     LOG_INFO("Test failed!");
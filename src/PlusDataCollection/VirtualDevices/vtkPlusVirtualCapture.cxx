@@ -5,6 +5,7 @@ See License.txt for details.
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "PlusPerformanceStatistics.h"
 #include "PlusTrackedFrame.h"
 #include "vtkPlusMetaImageSequenceIO.h"
 #include "vtkObjectFactory.h"
@@ -51,6 +52,8 @@ vtkPlusVirtualCapture::vtkPlusVirtualCapture()
   , IsData3D(false)
   , WriterAccessMutex(vtkSmartPointer<vtkPlusRecursiveCriticalSection>::New())
   , GracePeriodLogLevel(vtkPlusLogger::LOG_LEVEL_DEBUG)
+  , WriteQueueStatistics(NULL)
+  , WriteDurationStatistics(NULL)
 {
   this->AcquisitionRate = 30.0;
   this->MissingInputGracePeriodSec = 2.0;
@@ -131,6 +134,10 @@ PlusStatus vtkPlusVirtualCapture::InternalConnect()
     return PLUS_FAIL;
   }
 
+  std::string statisticsNamePrefix = std::string("VirtualCapture.") + this->GetDeviceId() + ".";
+  this->WriteQueueStatistics = PlusPerformanceStatistics::GetInstance()->GetHistogram(statisticsNamePrefix + "WriteQueueFrames", "frames");
+  this->WriteDurationStatistics = PlusPerformanceStatistics::GetInstance()->GetHistogram(statisticsNamePrefix + "WriteMs");
+
   if (this->GetEnableCapturingOnStart())
   {
     this->SetEnableCapturing(true);
@@ -609,9 +616,15 @@ PlusStatus vtkPlusVirtualCapture::WriteFrames(bool force)
 
   this->SetIsData3D(this->RecordedFrames->GetTrackedFrame(0)->GetFrameSize()[2] > 1);
 
+  if (this->WriteQueueStatistics != NULL)
+  {
+    this->WriteQueueStatistics->AddSample(this->RecordedFrames->GetNumberOfTrackedFrames());
+  }
+
   if (force || !this->IsFrameBuffered() ||
       (this->IsFrameBuffered() && this->RecordedFrames->GetNumberOfTrackedFrames() > this->GetFrameBufferSize()))
   {
+    PlusPerformanceScopedTimer writeTimer(this->WriteDurationStatistics);
     if (this->Writer->AppendImagesToHeader() != PLUS_SUCCESS)
     {
       LOG_ERROR("Unable to append image data to header.");
@@ -12,6 +12,7 @@ See License.txt for details.
 #include "vtkPlusSequenceIOBase.h"
 #include <string>
 
+class PlusPerformanceHistogram;
 class vtkPlusTrackedFrameList;
 
 /*!
@@ -173,6 +174,11 @@ protected:
 
   vtkPlusLogger::LogLevelType GracePeriodLogLevel;
 
+  /*! Number of recorded frames waiting to be written to file, sampled each time frames may be written */
+  PlusPerformanceHistogram* WriteQueueStatistics;
+  /*! Time spent with writing the recorded frames to file */
+  PlusPerformanceHistogram* WriteDurationStatistics;
+
   PlusStatus GetInputTrackedFrame(PlusTrackedFrame& aFrame);
   PlusStatus GetInputTrackedFrameListSampled(double& lastAlreadyRecordedFrameTimestamp, double& nextFrameToBeRecordedTimestamp, vtkPlusTrackedFrameList* recordedFrames, double requestedFramePeriodSec, double maxProcessingTimeSec);
   PlusStatus GetLatestInputItemTimestamp(double& timestamp);
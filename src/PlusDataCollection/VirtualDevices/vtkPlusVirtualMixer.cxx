@@ -110,8 +110,11 @@ PlusStatus vtkPlusVirtualMixer::NotifyConfigured()
   }
   vtkPlusChannel* outputChannel = this->OutputChannels[0];
 
+  // The output channel only references the data sources of the input channels (no data is copied),
+  // so the buffers must not be cleared here, as they belong to the input devices
   outputChannel->RemoveTools();
-  outputChannel->Clear();
+  outputChannel->RemoveFieldDataSources();
+  outputChannel->SetVideoSource(NULL);
 
   for (ChannelContainerIterator it = this->InputChannels.begin(); it != this->InputChannels.end(); ++it)
   {
@@ -157,6 +160,21 @@ PlusStatus vtkPlusVirtualMixer::NotifyConfigured()
       }
     }
 
+    for (DataSourceContainerConstIterator inputFieldDataIter = anInputChannel->GetFieldDataSourcesStartConstIterator(); inputFieldDataIter != anInputChannel->GetFieldDataSourcesEndConstIterator(); ++inputFieldDataIter)
+    {
+      vtkPlusDataSource* anInputFieldDataSource = inputFieldDataIter->second;
+      vtkPlusDataSource* anOutputFieldDataSource = NULL;
+      if (outputChannel->GetFieldDataSource(anOutputFieldDataSource, anInputFieldDataSource->GetId()) == PLUS_SUCCESS)
+      {
+        if (anOutputFieldDataSource != anInputFieldDataSource)
+        {
+          LOG_ERROR("Name collision! Two field data sources are outputting the same field: " << anInputFieldDataSource->GetId() << ". Consider using a virtual device to resolve them first.");
+        }
+        continue;
+      }
+      outputChannel->AddFieldDataSource(anInputFieldDataSource);
+    }
+
     if (anInputChannel->GetRfProcessor() != NULL && outputChannel->GetRfProcessor() == NULL)
     {
       outputChannel->SetRfProcessor(anInputChannel->GetRfProcessor());
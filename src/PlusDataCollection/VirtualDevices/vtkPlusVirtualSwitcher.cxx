@@ -70,44 +70,45 @@ PlusStatus vtkPlusVirtualSwitcher::InternalUpdate()
   //    correctly detect this situation and wait a few frames before switching
       // if timestamp not changed within 'FRAME_COUNT_BEFORE_INACTIVE' frames, then do new stream check
 
+  if( this->CurrentActiveInputChannel == NULL )
+  {
+    // No stream has been selected yet (or all streams were inactive), check if any of them started to provide data
+    this->SelectActiveChannel();
+    return PLUS_SUCCESS;
+  }
+
   double latestCurrentTimestamp(0);
-  if( this->CurrentActiveInputChannel != NULL )
+  if( this->CurrentActiveInputChannel->GetLatestTimestamp(latestCurrentTimestamp) != PLUS_SUCCESS )
   {
-    if( this->CurrentActiveInputChannel->GetLatestTimestamp(latestCurrentTimestamp) != PLUS_SUCCESS )
-    {
-      LOG_ERROR("Unable to retrieve timestamp from active stream.");
-      return PLUS_FAIL;
-    }
-    if( this->LastRecordedTimestampMap[this->CurrentActiveInputChannel] == 0 )
-    {
-      this->LastRecordedTimestampMap[this->CurrentActiveInputChannel] = latestCurrentTimestamp;
-      return PLUS_SUCCESS;
-    }
+    LOG_ERROR("Unable to retrieve timestamp from active stream.");
+    return PLUS_FAIL;
+  }
+  if( this->LastRecordedTimestampMap[this->CurrentActiveInputChannel] == 0 )
+  {
+    this->LastRecordedTimestampMap[this->CurrentActiveInputChannel] = latestCurrentTimestamp;
+    return PLUS_SUCCESS;
+  }
 
-    if( latestCurrentTimestamp > this->LastRecordedTimestampMap[this->CurrentActiveInputChannel] )
+  if( latestCurrentTimestamp > this->LastRecordedTimestampMap[this->CurrentActiveInputChannel] )
+  {
+    // Device is still active
+    this->LastRecordedTimestampMap[this->CurrentActiveInputChannel] = latestCurrentTimestamp;
+    this->FramesWhileInactive = 0;
+    return PLUS_SUCCESS;
+  }
+  else
+  {
+    if( FramesWhileInactive >= FRAME_COUNT_BEFORE_INACTIVE )
     {
-      // Device is still active
-      return PLUS_SUCCESS;
+      this->FramesWhileInactive = 0;
+      // Device is no longer active
+      // The output keeps referencing the last active stream if no other stream is active
+      this->SelectActiveChannel();
     }
     else
     {
-      if( FramesWhileInactive >= FRAME_COUNT_BEFORE_INACTIVE )
-      {
-        this->FramesWhileInactive = 0;
-        // Device is no longer active
-        if( this->SelectActiveChannel() == PLUS_FAIL )
-        {
-          // No active devices, don't copy anything!
-          return PLUS_SUCCESS;
-        }
-      }
-      else
-      {
-        FramesWhileInactive++;
-      }
+      FramesWhileInactive++;
     }
-
-    this->CopyInputChannelToOutputChannel();
   }
 
   return PLUS_SUCCESS;
@@ -138,8 +139,12 @@ PlusStatus vtkPlusVirtualSwitcher::SelectActiveChannel()
   if( ActiveChannels.size() > 0 )
   {
     // For now, just choose the first... maybe in the future make it more elegant
-    this->SetCurrentActiveInputChannel(ActiveChannels[0]);
-    this->CopyInputChannelToOutputChannel();
+    if( this->CurrentActiveInputChannel != ActiveChannels[0] )
+    {
+      this->SetCurrentActiveInputChannel(ActiveChannels[0]);
+      // The output channel only has to be updated when the selection changes, as it references the data sources of the active channel
+      this->CopyInputChannelToOutputChannel();
+    }
 
     // We will also now need to output the correct transform associated with the new stream
     // Is there any way to make this generic?
@@ -200,10 +205,10 @@ PlusStatus vtkPlusVirtualSwitcher::NotifyConfigured()
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusVirtualSwitcher::CopyInputChannelToOutputChannel()
 {
-  // Only destroy if things have to change
-  if( this->CurrentActiveInputChannel != NULL )
+  if( this->CurrentActiveInputChannel != NULL && this->OutputChannel != NULL )
   {
-    // no need to do a deep copy, iterators are used to access data anyways
+    // No data is copied, the output channel references the data sources of the active input channel,
+    // so frames are read directly from the buffers of the input device
     this->OutputChannel->ShallowCopy(*this->CurrentActiveInputChannel);
   }
 
@@ -47,6 +47,7 @@ protected:
 
   PlusStatus SelectActiveChannel();
 
+  /*! Make the output channel reference the data sources of the active input channel (no data is copied) */
   PlusStatus CopyInputChannelToOutputChannel();
 
   vtkPlusVirtualSwitcher();
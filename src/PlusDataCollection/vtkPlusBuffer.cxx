@@ -6,6 +6,7 @@ See License.txt for details.
 
 #include "PlusConfigure.h"
 #include "PlusMath.h"
+#include "PlusPerformanceStatistics.h"
 #include "PlusTrackedFrame.h"
 #include "vtkDoubleArray.h"
 #include "vtkImageData.h"
@@ -24,6 +25,20 @@ static const double ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG = 10; // if the in
 
 vtkStandardNewMacro(vtkPlusBuffer);
 
+//----------------------------------------------------------------------------
+// Returns the rotation angle between two orientations (specified by unit quaternions) in degrees, in the range of [0, 180].
+// Same as PlusMath::GetOrientationDifference, but it does not need to create any VTK objects.
+static double GetQuaternionOrientationDifferenceDeg(const double quatA[4], const double quatB[4])
+{
+  double dotProduct = fabs(quatA[0] * quatB[0] + quatA[1] * quatB[1] + quatA[2] * quatB[2] + quatA[3] * quatB[3]);
+  if (dotProduct > 1.0)
+  {
+    // may happen due to numerical inaccuracy
+    dotProduct = 1.0;
+  }
+  return vtkMath::DegreesFromRadians(2.0 * acos(dotProduct));
+}
+
 #define LOCAL_LOG_ERROR(msg) \
 { \
   std::ostringstream msgStream; \
@@ -54,17 +69,20 @@ vtkStandardNewMacro(vtkPlusBuffer);
 }
 #define LOCAL_LOG_DEBUG(msg) \
 { \
-  std::ostringstream msgStream; \
-  if( this->DescriptiveName == NULL ) \
-{ \
-  msgStream << " " << msg << std::ends; \
-} \
-  else \
-{ \
-  msgStream << this->DescriptiveName << ": " << msg << std::ends; \
-} \
-  std::string finalStr(msgStream.str()); \
-  LOG_DEBUG(finalStr); \
+  if (vtkPlusLogger::Instance()->GetLogLevel()>=vtkPlusLogger::LOG_LEVEL_DEBUG) \
+  { \
+    std::ostringstream msgStream; \
+    if( this->DescriptiveName == NULL ) \
+    { \
+      msgStream << " " << msg << std::ends; \
+    } \
+    else \
+    { \
+      msgStream << this->DescriptiveName << ": " << msg << std::ends; \
+    } \
+    std::string finalStr(msgStream.str()); \
+    LOG_DEBUG(finalStr); \
+  } \
 }
 
 //----------------------------------------------------------------------------
@@ -78,6 +96,8 @@ vtkPlusBuffer::vtkPlusBuffer()
   , StreamBuffer(vtkPlusTimestampedCircularBuffer::New())
   , MaxAllowedTimeDifference(0.5)
   , DescriptiveName(NULL)
+  , FillLevelStatistics(NULL)
+  , DroppedItemsStatistics(NULL)
 {
   this->FrameSize[0] = 0;
   this->FrameSize[1] = 0;
@@ -115,6 +135,50 @@ void vtkPlusBuffer::PrintSelf(ostream& os, vtkIndent indent)
   }
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::SetDescriptiveName(const char* descriptiveName)
+{
+  if (this->DescriptiveName == NULL && descriptiveName == NULL)
+  {
+    return;
+  }
+  if (this->DescriptiveName != NULL && descriptiveName != NULL && strcmp(this->DescriptiveName, descriptiveName) == 0)
+  {
+    return;
+  }
+  delete[] this->DescriptiveName;
+  this->DescriptiveName = NULL;
+  this->FillLevelStatistics = NULL;
+  this->DroppedItemsStatistics = NULL;
+  if (descriptiveName != NULL)
+  {
+    this->DescriptiveName = new char[strlen(descriptiveName) + 1];
+    strcpy(this->DescriptiveName, descriptiveName);
+    // Only named buffers are included in the statistics, temporary buffers would just clutter the report
+    std::string statisticsNamePrefix = std::string("Buffer.") + descriptiveName + ".";
+    this->FillLevelStatistics = PlusPerformanceStatistics::GetInstance()->GetHistogram(statisticsNamePrefix + "FillLevelPercent", "%");
+    this->DroppedItemsStatistics = PlusPerformanceStatistics::GetInstance()->GetCounter(statisticsNamePrefix + "DroppedItems");
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::UpdatePerformanceStatistics(bool itemAdded)
+{
+  if (!itemAdded)
+  {
+    if (this->DroppedItemsStatistics != NULL)
+    {
+      this->DroppedItemsStatistics->Increment();
+    }
+    return;
+  }
+  if (this->FillLevelStatistics != NULL && this->StreamBuffer->GetBufferSize() > 0)
+  {
+    this->FillLevelStatistics->AddSample(100.0 * this->StreamBuffer->GetNumberOfItems() / this->StreamBuffer->GetBufferSize());
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusBuffer::AllocateMemoryForFrames()
 {
@@ -278,6 +342,36 @@ PlusStatus vtkPlusBuffer::AddItem(const PlusVideoFrame* frame,
   return this->AddItem(frame->GetImage(), frame->GetImageOrientation(), frame->GetImageType(), frameNumber, clipRectangleOrigin, clipRectangleSize, unfilteredTimestamp, filteredTimestamp, customFields);
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::AddItemAdoptFrame(PlusVideoFrame& frame,
+    long frameNumber,
+    const int clipRectangleOrigin[3],
+    const int clipRectangleSize[3],
+    double unfilteredTimestamp/*=UNDEFINED_TIMESTAMP*/,
+    double filteredTimestamp/*=UNDEFINED_TIMESTAMP*/,
+    const PlusTrackedFrame::FieldMapType* customFields /*=NULL*/)
+{
+  if (frame.GetImage() == NULL)
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Unable to add NULL frame to video buffer!");
+    return PLUS_FAIL;
+  }
+
+  PlusVideoFrame::FlipInfoType flipInfo;
+  if (PlusCommon::IsClippingRequested(clipRectangleOrigin, clipRectangleSize)
+      || PlusVideoFrame::GetFlipAxes(frame.GetImageOrientation(), frame.GetImageType(), this->ImageOrientation, flipInfo) != PLUS_SUCCESS
+      || flipInfo.hFlip || flipInfo.vFlip || flipInfo.eFlip || flipInfo.tranpose != PlusVideoFrame::TRANSPOSE_NONE)
+  {
+    // Pixels have to be reordered or clipped, which requires copying
+    return this->AddItem(&frame, frameNumber, clipRectangleOrigin, clipRectangleSize, unfilteredTimestamp, filteredTimestamp, customFields);
+  }
+
+  unsigned int frameSizeInPx[3] = { 0, 0, 0 };
+  frame.GetFrameSize(frameSizeInPx);
+  return this->AddVideoItem(&frame, NULL, frameSizeInPx, flipInfo, frame.GetVTKScalarPixelType(), static_cast<unsigned int>(frame.GetNumberOfScalarComponents()), frame.GetImageType(),
+                            frameNumber, clipRectangleOrigin, clipRectangleSize, unfilteredTimestamp, filteredTimestamp, customFields);
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusBuffer::AddItem(const PlusTrackedFrame::FieldMapType& fields,
                                   long frameNumber,
@@ -304,6 +398,7 @@ PlusStatus vtkPlusBuffer::AddItem(const PlusTrackedFrame::FieldMapType& fields,
     if (!filteredTimestampProbablyValid)
     {
       LOG_INFO("Filtered timestamp is probably invalid for tracker buffer item with item index=" << frameNumber << ", time=" << unfilteredTimestamp << ". The item may have been tagged with an inaccurate timestamp, therefore it will not be recorded.");
+      this->UpdatePerformanceStatistics(false);
       return PLUS_SUCCESS;
     }
   }
@@ -320,8 +415,10 @@ PlusStatus vtkPlusBuffer::AddItem(const PlusTrackedFrame::FieldMapType& fields,
   {
     // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
     LOCAL_LOG_DEBUG("vtkPlusBuffer: Failed to prepare for adding new frame to tracker buffer!");
+    this->UpdatePerformanceStatistics(false);
     return PLUS_FAIL;
   }
+  this->UpdatePerformanceStatistics(true);
 
   // get the pointer to the correct location in the tracker buffer, where this data needs to be copied
   StreamBufferItem* newObjectInBuffer = this->StreamBuffer->GetBufferItemPointerFromBufferIndex(bufferIndex);
@@ -360,6 +457,43 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
                                   double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/,
                                   double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/,
                                   const PlusTrackedFrame::FieldMapType* customFields /*= NULL */)
+{
+  if (imageDataPtr == NULL)
+  {
+    LOG_ERROR("vtkPlusBuffer: Unable to add NULL frame to video buffer!");
+    return PLUS_FAIL;
+  }
+
+  PlusVideoFrame::FlipInfoType flipInfo;
+  if (PlusVideoFrame::GetFlipAxes(usImageOrientation, imageType, this->ImageOrientation, flipInfo) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to convert image data to the requested orientation, from " << PlusVideoFrame::GetStringFromUsImageOrientation(usImageOrientation) <<
+              " to " << PlusVideoFrame::GetStringFromUsImageOrientation(this->ImageOrientation));
+    return PLUS_FAIL;
+  }
+
+  // Skip the numberOfBytesToSkip bytes, e.g. header size
+  unsigned char* byteImageDataPtr = reinterpret_cast<unsigned char*>(imageDataPtr);
+  byteImageDataPtr += numberOfBytesToSkip;
+
+  return this->AddVideoItem(NULL, byteImageDataPtr, inputFrameSizeInPx, flipInfo, pixelType, numberOfScalarComponents, imageType,
+                            frameNumber, clipRectangleOrigin, clipRectangleSize, unfilteredTimestamp, filteredTimestamp, customFields);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::AddVideoItem(PlusVideoFrame* frameToAdopt,
+                                       unsigned char* imageDataPtr,
+                                       const unsigned int inputFrameSizeInPx[3],
+                                       const PlusVideoFrame::FlipInfoType& flipInfo,
+                                       PlusCommon::VTKScalarPixelType pixelType,
+                                       unsigned int numberOfScalarComponents,
+                                       US_IMAGE_TYPE imageType,
+                                       long frameNumber,
+                                       const int clipRectangleOrigin[3],
+                                       const int clipRectangleSize[3],
+                                       double unfilteredTimestamp,
+                                       double filteredTimestamp,
+                                       const PlusTrackedFrame::FieldMapType* customFields)
 {
   if (unfilteredTimestamp == UNDEFINED_TIMESTAMP)
   {
@@ -378,6 +512,7 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
     {
       LOG_INFO("Filtered timestamp is probably invalid for video buffer item with item index=" << frameNumber << ", time=" <<
                unfilteredTimestamp << ". The item may have been tagged with an inaccurate timestamp, therefore it will not be recorded.");
+      this->UpdatePerformanceStatistics(false);
       return PLUS_SUCCESS;
     }
   }
@@ -386,20 +521,6 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
     this->StreamBuffer->AddToTimeStampReport(frameNumber, unfilteredTimestamp, filteredTimestamp);
   }
 
-  if (imageDataPtr == NULL)
-  {
-    LOG_ERROR("vtkPlusBuffer: Unable to add NULL frame to video buffer!");
-    return PLUS_FAIL;
-  }
-
-  PlusVideoFrame::FlipInfoType flipInfo;
-  if (PlusVideoFrame::GetFlipAxes(usImageOrientation, imageType, this->ImageOrientation, flipInfo) != PLUS_SUCCESS)
-  {
-    LOG_ERROR("Failed to convert image data to the requested orientation, from " << PlusVideoFrame::GetStringFromUsImageOrientation(usImageOrientation) <<
-              " to " << PlusVideoFrame::GetStringFromUsImageOrientation(this->ImageOrientation));
-    return PLUS_FAIL;
-  }
-
   // Calculate the output frame size to validate that buffer is correctly setup
   unsigned int outputFrameSizeInPx[3] = { inputFrameSizeInPx[0], inputFrameSizeInPx[1], inputFrameSizeInPx[2] };
   if (PlusCommon::IsClippingRequested(clipRectangleOrigin, clipRectangleSize))
@@ -423,7 +544,6 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
     return PLUS_FAIL;
   }
 
-
   int bufferIndex(0);
   BufferItemUidType itemUid;
   PlusLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
@@ -431,10 +551,12 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
   {
     // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
     LOCAL_LOG_DEBUG("vtkPlusBuffer: Failed to prepare for adding new frame to video buffer!");
+    this->UpdatePerformanceStatistics(false);
     return PLUS_FAIL;
   }
+  this->UpdatePerformanceStatistics(true);
 
-  // get the pointer to the correct location in the frame buffer, where this data needs to be copied
+  // get the pointer to the correct location in the frame buffer, where this data needs to be stored
   StreamBufferItem* newObjectInBuffer = this->StreamBuffer->GetBufferItemPointerFromBufferIndex(bufferIndex);
   if (newObjectInBuffer == NULL)
   {
@@ -456,11 +578,13 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
     return PLUS_FAIL;
   }
 
-  // Skip the numberOfBytesToSkip bytes, e.g. header size
-  unsigned char* byteImageDataPtr = reinterpret_cast<unsigned char*>(imageDataPtr);
-  byteImageDataPtr += numberOfBytesToSkip;
-
-  if (PlusVideoFrame::GetOrientedClippedImage(byteImageDataPtr, flipInfo, imageType, pixelType, numberOfScalarComponents, inputFrameSizeInPx, newObjectInBuffer->GetFrame(), clipRectangleOrigin, clipRectangleSize) != PLUS_SUCCESS)
+  if (frameToAdopt != NULL)
+  {
+    // The item takes over the pixel buffer of the frame and the frame gets the pixel buffer of the overwritten item.
+    // Readers always copy the item content while the buffer is locked, so they never see the recycled pixel buffer.
+    newObjectInBuffer->GetFrame().SwapImage(*frameToAdopt);
+  }
+  else if (PlusVideoFrame::GetOrientedClippedImage(imageDataPtr, flipInfo, imageType, pixelType, numberOfScalarComponents, inputFrameSizeInPx, newObjectInBuffer->GetFrame(), clipRectangleOrigin, clipRectangleSize) != PLUS_SUCCESS)
   {
     LOCAL_LOG_ERROR("Failed to convert input US image to the requested orientation!");
     return PLUS_FAIL;
@@ -512,6 +636,7 @@ PlusStatus vtkPlusBuffer::AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus st
     if (!filteredTimestampProbablyValid)
     {
       LOG_INFO("Filtered timestamp is probably invalid for tracker buffer item with item index=" << frameNumber << ", time=" << unfilteredTimestamp << ". The item may have been tagged with an inaccurate timestamp, therefore it will not be recorded.");
+      this->UpdatePerformanceStatistics(false);
       return PLUS_SUCCESS;
     }
   }
@@ -528,8 +653,10 @@ PlusStatus vtkPlusBuffer::AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus st
   {
     // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
     LOCAL_LOG_DEBUG("vtkPlusBuffer: Failed to prepare for adding new frame to tracker buffer!");
+    this->UpdatePerformanceStatistics(false);
     return PLUS_FAIL;
   }
+  this->UpdatePerformanceStatistics(true);
 
   // get the pointer to the correct location in the tracker buffer, where this data needs to be copied
   StreamBufferItem* newObjectInBuffer = this->StreamBuffer->GetBufferItemPointerFromBufferIndex(bufferIndex);
@@ -606,6 +733,18 @@ int vtkPlusBuffer::GetAveragedItemsForFiltering()
   return this->StreamBuffer->GetAveragedItemsForFiltering();
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::SetRobustTimestampFiltering(bool robustTimestampFiltering)
+{
+  this->StreamBuffer->SetRobustTimestampFiltering(robustTimestampFiltering);
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusBuffer::GetRobustTimestampFiltering()
+{
+  return this->StreamBuffer->GetRobustTimestampFiltering();
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusBuffer::SetStartTime(double startTime)
 {
@@ -1002,6 +1141,23 @@ PlusStatus vtkPlusBuffer::GetPrevNextBufferItemFromTime(double time, StreamBuffe
 {
   PlusLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
 
+  StreamBufferItem* itemAptr = NULL;
+  StreamBufferItem* itemBptr = NULL;
+  if (this->GetPrevNextBufferItemPointerFromTime(time, itemAptr, itemBptr) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  itemA.DeepCopy(itemAptr);
+  itemB.DeepCopy(itemBptr);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+// Same as GetPrevNextBufferItemFromTime, but returns pointers to the items in the buffer instead of copies.
+// The caller must hold the StreamBuffer lock while the pointers are in use.
+PlusStatus vtkPlusBuffer::GetPrevNextBufferItemPointerFromTime(double time, StreamBufferItem*& itemA, StreamBufferItem*& itemB)
+{
   // The returned item is computed by interpolation between itemA and itemB in time. The itemA is the closest item to the requested time.
   // Accept itemA (the closest item) as is if it is very close to the requested time.
   // Accept interpolation between itemA and itemB if all the followings are true:
@@ -1027,7 +1183,7 @@ PlusStatus vtkPlusBuffer::GetPrevNextBufferItemFromTime(double time, StreamBuffe
     }
     return PLUS_FAIL;
   }
-  status = this->GetStreamBufferItem(itemAuid, &itemA);
+  status = this->StreamBuffer->GetBufferItemPointerFromUid(itemAuid, itemA);
   if (status != ITEM_OK)
   {
     LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get data buffer item with Uid: " << itemAuid);
@@ -1035,7 +1191,7 @@ PlusStatus vtkPlusBuffer::GetPrevNextBufferItemFromTime(double time, StreamBuffe
   }
 
   // If tracker is out of view, etc. then we don't have a valid before and after the requested time, so we cannot do interpolation
-  if (itemA.GetStatus() != TOOL_OK)
+  if (itemA->GetStatus() != TOOL_OK)
   {
     // tracker is out of view, ...
     LOCAL_LOG_DEBUG("vtkPlusBuffer: Cannot do data interpolation. The closest item to the requested time (time: " << std::fixed << time << ", uid: " << itemAuid << ") is invalid.");
@@ -1054,7 +1210,7 @@ PlusStatus vtkPlusBuffer::GetPrevNextBufferItemFromTime(double time, StreamBuffe
   if (fabs(itemAtime - time) < NEGLIGIBLE_TIME_DIFFERENCE)
   {
     //No need for interpolation, it's very close to the closest element
-    itemB.DeepCopy(&itemA);
+    itemB = itemA;
     return PLUS_SUCCESS;
   }
 
@@ -1098,14 +1254,14 @@ PlusStatus vtkPlusBuffer::GetPrevNextBufferItemFromTime(double time, StreamBuffe
     return PLUS_FAIL;
   }
   // Get the item
-  status = this->GetStreamBufferItem(itemBuid, &itemB);
+  status = this->StreamBuffer->GetBufferItemPointerFromUid(itemBuid, itemB);
   if (status != ITEM_OK)
   {
     LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get data buffer item with Uid: " << itemBuid);
     return PLUS_FAIL;
   }
   // If there is no valid element on the other side of the requested time, then we cannot do an interpolation
-  if (itemB.GetStatus() != TOOL_OK)
+  if (itemB->GetStatus() != TOOL_OK)
   {
     LOCAL_LOG_DEBUG("vtkPlusBuffer: Cannot get a second element (uid=" << itemBuid << ") on the other side of the requested time (" << std::fixed << time << ")");
     return PLUS_FAIL;
@@ -1131,6 +1287,94 @@ ItemStatus vtkPlusBuffer::GetStreamBufferItemFromTime(double time, StreamBufferI
   }
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::GetStreamBufferItemsFromTimes(const std::vector<double>& timestamps, std::vector<StreamBufferItem>& items, std::vector<ItemStatus>& itemStatuses, DataItemTemporalInterpolationType interpolation)
+{
+  // The lock is recursive, so the item retrieval methods only increment the lock count
+  PlusLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+
+  items.resize(timestamps.size());
+  itemStatuses.resize(timestamps.size());
+  PlusStatus status = PLUS_SUCCESS;
+  for (unsigned int i = 0; i < timestamps.size(); ++i)
+  {
+    itemStatuses[i] = this->GetStreamBufferItemFromTime(timestamps[i], &items[i], interpolation);
+    if (itemStatuses[i] != ITEM_OK)
+    {
+      status = PLUS_FAIL;
+    }
+  }
+  return status;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBuffer::GetItemUidsFromTimeRange(double timestampFrom, double timestampTo, std::vector<BufferItemUidType>& uids, std::vector<double>& timestamps)
+{
+  uids.clear();
+  timestamps.clear();
+
+  if (timestampFrom > timestampTo)
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Invalid time range (from: " << std::fixed << timestampFrom << ", to: " << timestampTo << ")");
+    return ITEM_UNKNOWN_ERROR;
+  }
+
+  PlusLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+
+  if (this->StreamBuffer->GetNumberOfItems() < 1)
+  {
+    return ITEM_NOT_AVAILABLE_YET;
+  }
+
+  BufferItemUidType uidFrom(0);
+  ItemStatus status = this->StreamBuffer->GetItemUidFromTime(timestampFrom, uidFrom);
+  if (status == ITEM_NOT_AVAILABLE_ANYMORE)
+  {
+    // The beginning of the range is not in the buffer anymore, start from the oldest item
+    uidFrom = this->StreamBuffer->GetOldestItemUidInBuffer();
+  }
+  else if (status != ITEM_OK)
+  {
+    return status;
+  }
+
+  BufferItemUidType uidTo(0);
+  status = this->StreamBuffer->GetItemUidFromTime(timestampTo, uidTo);
+  if (status == ITEM_NOT_AVAILABLE_YET)
+  {
+    // The end of the range is not in the buffer yet, stop at the latest item
+    uidTo = this->StreamBuffer->GetLatestItemUidInBuffer();
+  }
+  else if (status != ITEM_OK)
+  {
+    return status;
+  }
+
+  const double localTimeOffsetSec = this->StreamBuffer->GetLocalTimeOffsetSec();
+  for (BufferItemUidType uid = uidFrom; uid <= uidTo; ++uid)
+  {
+    StreamBufferItem* item = NULL;
+    status = this->StreamBuffer->GetBufferItemPointerFromUid(uid, item);
+    if (status != ITEM_OK)
+    {
+      LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get data buffer item with Uid: " << uid);
+      uids.clear();
+      timestamps.clear();
+      return status;
+    }
+    // The items that are the closest to the range limits may be just outside the range
+    double itemTimestamp = item->GetFilteredTimestamp(localTimeOffsetSec);
+    if (itemTimestamp < timestampFrom - NEGLIGIBLE_TIME_DIFFERENCE || itemTimestamp > timestampTo + NEGLIGIBLE_TIME_DIFFERENCE)
+    {
+      continue;
+    }
+    uids.push_back(uid);
+    timestamps.push_back(itemTimestamp);
+  }
+
+  return ITEM_OK;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusBuffer::ModifyBufferItemFrameField(BufferItemUidType uid, const std::string& key, const std::string& value)
 {
@@ -1205,10 +1449,12 @@ ItemStatus vtkPlusBuffer::GetStreamBufferItemFromClosestTime(double time, Stream
 // The flags correspond to the closest element.
 ItemStatus vtkPlusBuffer::GetInterpolatedStreamBufferItemFromTime(double time, StreamBufferItem* bufferItem)
 {
-  StreamBufferItem itemA;
-  StreamBufferItem itemB;
+  // Work directly on the items stored in the buffer (no temporary item copies), so keep the buffer locked
+  PlusLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
 
-  if (GetPrevNextBufferItemFromTime(time, itemA, itemB) != PLUS_SUCCESS)
+  StreamBufferItem* itemA = NULL;
+  StreamBufferItem* itemB = NULL;
+  if (GetPrevNextBufferItemPointerFromTime(time, itemA, itemB) != PLUS_SUCCESS)
   {
     // cannot get two neighbors, so cannot do interpolation
     // it may be normal (e.g., when tracker out of view), so don't return with an error
@@ -1225,33 +1471,33 @@ ItemStatus vtkPlusBuffer::GetInterpolatedStreamBufferItemFromTime(double time, S
     return ITEM_OK;
   }
 
-  if (itemA.GetUid() == itemB.GetUid())
+  if (itemA->GetUid() == itemB->GetUid())
   {
     // exact match, no need for interpolation
-    bufferItem->DeepCopy(&itemA);
+    bufferItem->DeepCopy(itemA);
     return ITEM_OK;
   }
 
   //============== Get item weights ==================
 
   double itemAtime(0);
-  if (this->StreamBuffer->GetTimeStamp(itemA.GetUid(), itemAtime) != ITEM_OK)
+  if (this->StreamBuffer->GetTimeStamp(itemA->GetUid(), itemAtime) != ITEM_OK)
   {
-    LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get data buffer timestamp (time: " << std::fixed << time << ", uid: " << itemA.GetUid() << ")");
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get data buffer timestamp (time: " << std::fixed << time << ", uid: " << itemA->GetUid() << ")");
     return ITEM_UNKNOWN_ERROR;
   }
 
   double itemBtime(0);
-  if (this->StreamBuffer->GetTimeStamp(itemB.GetUid(), itemBtime) != ITEM_OK)
+  if (this->StreamBuffer->GetTimeStamp(itemB->GetUid(), itemBtime) != ITEM_OK)
   {
-    LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get data buffer timestamp (time: " << std::fixed << time << ", uid: " << itemB.GetUid() << ")");
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get data buffer timestamp (time: " << std::fixed << time << ", uid: " << itemB->GetUid() << ")");
     return ITEM_UNKNOWN_ERROR;
   }
 
   if (fabs(itemAtime - itemBtime) < NEGLIGIBLE_TIME_DIFFERENCE)
   {
     // exact time match, no need for interpolation
-    bufferItem->DeepCopy(&itemA);
+    bufferItem->DeepCopy(itemA);
     bufferItem->SetFilteredTimestamp(time);
     bufferItem->SetUnfilteredTimestamp(time);
     return ITEM_OK;
@@ -1262,8 +1508,8 @@ ItemStatus vtkPlusBuffer::GetInterpolatedStreamBufferItemFromTime(double time, S
 
   //============== Get transform matrices ==================
 
-  vtkSmartPointer<vtkMatrix4x4> itemAmatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-  if (itemA.GetMatrix(itemAmatrix) != PLUS_SUCCESS)
+  double itemAmatrix[16] = {0};
+  if (itemA->GetMatrix(itemAmatrix) != PLUS_SUCCESS)
   {
     LOCAL_LOG_ERROR("Failed to get item A matrix");
     return ITEM_UNKNOWN_ERROR;
@@ -1272,14 +1518,14 @@ ItemStatus vtkPlusBuffer::GetInterpolatedStreamBufferItemFromTime(double time, S
   double xyzA[3] = {0, 0, 0};
   for (int i = 0; i < 3; i++)
   {
-    matrixA[i][0] = itemAmatrix->GetElement(i, 0);
-    matrixA[i][1] = itemAmatrix->GetElement(i, 1);
-    matrixA[i][2] = itemAmatrix->GetElement(i, 2);
-    xyzA[i] = itemAmatrix->GetElement(i, 3);
+    matrixA[i][0] = itemAmatrix[i * 4 + 0];
+    matrixA[i][1] = itemAmatrix[i * 4 + 1];
+    matrixA[i][2] = itemAmatrix[i * 4 + 2];
+    xyzA[i] = itemAmatrix[i * 4 + 3];
   }
 
-  vtkSmartPointer<vtkMatrix4x4> itemBmatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-  if (itemB.GetMatrix(itemBmatrix) != PLUS_SUCCESS)
+  double itemBmatrix[16] = {0};
+  if (itemB->GetMatrix(itemBmatrix) != PLUS_SUCCESS)
   {
     LOCAL_LOG_ERROR("Failed to get item B matrix");
     return ITEM_UNKNOWN_ERROR;
@@ -1288,10 +1534,10 @@ ItemStatus vtkPlusBuffer::GetInterpolatedStreamBufferItemFromTime(double time, S
   double xyzB[3] = {0, 0, 0};
   for (int i = 0; i < 3; i++)
   {
-    matrixB[i][0] = itemBmatrix->GetElement(i, 0);
-    matrixB[i][1] = itemBmatrix->GetElement(i, 1);
-    matrixB[i][2] = itemBmatrix->GetElement(i, 2);
-    xyzB[i] = itemBmatrix->GetElement(i, 3);
+    matrixB[i][0] = itemBmatrix[i * 4 + 0];
+    matrixB[i][1] = itemBmatrix[i * 4 + 1];
+    matrixB[i][2] = itemBmatrix[i * 4 + 2];
+    xyzB[i] = itemBmatrix[i * 4 + 3];
   }
 
   //============== Interpolate rotation ==================
@@ -1305,33 +1551,34 @@ ItemStatus vtkPlusBuffer::GetInterpolatedStreamBufferItemFromTime(double time, S
   double interpolatedRotation[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
   vtkMath::QuaternionToMatrix3x3(interpolatedRotationQuat, interpolatedRotation);
 
-  vtkSmartPointer<vtkMatrix4x4> interpolatedMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  double interpolatedMatrix[16] = {0};
   for (int i = 0; i < 3; i++)
   {
-    interpolatedMatrix->Element[i][0] = interpolatedRotation[i][0];
-    interpolatedMatrix->Element[i][1] = interpolatedRotation[i][1];
-    interpolatedMatrix->Element[i][2] = interpolatedRotation[i][2];
-    interpolatedMatrix->Element[i][3] = xyzA[i] * itemAweight + xyzB[i] * itemBweight;
+    interpolatedMatrix[i * 4 + 0] = interpolatedRotation[i][0];
+    interpolatedMatrix[i * 4 + 1] = interpolatedRotation[i][1];
+    interpolatedMatrix[i * 4 + 2] = interpolatedRotation[i][2];
+    interpolatedMatrix[i * 4 + 3] = xyzA[i] * itemAweight + xyzB[i] * itemBweight;
   }
+  interpolatedMatrix[15] = 1.0;
 
   //============== Interpolate time ==================
 
-  double itemAunfilteredTimestamp = itemA.GetUnfilteredTimestamp(0.0);   // 0.0 because timestamps in the buffer are in local time
-  double itemBunfilteredTimestamp = itemB.GetUnfilteredTimestamp(0.0);   // 0.0 because timestamps in the buffer are in local time
+  double itemAunfilteredTimestamp = itemA->GetUnfilteredTimestamp(0.0);   // 0.0 because timestamps in the buffer are in local time
+  double itemBunfilteredTimestamp = itemB->GetUnfilteredTimestamp(0.0);   // 0.0 because timestamps in the buffer are in local time
   double interpolatedUnfilteredTimestamp = itemAunfilteredTimestamp * itemAweight + itemBunfilteredTimestamp * itemBweight;
 
   //============== Write interpolated results into the bufferItem ==================
 
-  bufferItem->DeepCopy(&itemA);
+  bufferItem->DeepCopy(itemA);
   bufferItem->SetMatrix(interpolatedMatrix);
   bufferItem->SetFilteredTimestamp(time - this->StreamBuffer->GetLocalTimeOffsetSec());   // global = local + offset => local = global - offset
   bufferItem->SetUnfilteredTimestamp(interpolatedUnfilteredTimestamp);
 
-  double angleDiffA = PlusMath::GetOrientationDifference(interpolatedMatrix, itemAmatrix);
-  double angleDiffB = PlusMath::GetOrientationDifference(interpolatedMatrix, itemBmatrix);
-  if (fabs(angleDiffA) > ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG && fabs(angleDiffB) > ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG)
+  double angleDiffA = GetQuaternionOrientationDifferenceDeg(interpolatedRotationQuat, matrixAquat);
+  double angleDiffB = GetQuaternionOrientationDifferenceDeg(interpolatedRotationQuat, matrixBquat);
+  if (angleDiffA > ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG && angleDiffB > ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG)
   {
-    LOCAL_LOG_WARNING("Angle difference between interpolated orientations is large (" << fabs(angleDiffA) << " and " << fabs(angleDiffB) << " deg, warning threshold is " << ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG << "), interpolation may be inaccurate. Consider moving the tools slower.");
+    LOCAL_LOG_WARNING("Angle difference between interpolated orientations is large (" << angleDiffA << " and " << angleDiffB << " deg, warning threshold is " << ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG << "), interpolation may be inaccurate. Consider moving the tools slower.");
   }
 
   return ITEM_OK;
@@ -22,6 +22,8 @@ See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
 #include "vtkObject.h"
 #include "vtkPlusTimestampedCircularBuffer.h"
 
+class PlusPerformanceCounter;
+class PlusPerformanceHistogram;
 class vtkPlusDevice;
 enum ToolStatus;
 
@@ -87,6 +89,20 @@ public:
                              double unfilteredTimestamp = UNDEFINED_TIMESTAMP,
                              double filteredTimestamp = UNDEFINED_TIMESTAMP,
                              const PlusTrackedFrame::FieldMapType* customFields = NULL);
+  /*!
+    Add a frame plus a timestamp to the buffer with frame index, without copying the pixel data.
+    The pixel buffer of the frame is swapped with the pixel buffer of the new buffer item, therefore
+    after the call the frame contains the pixel buffer of the overwritten (oldest) item, with undefined content.
+    This buffer has the buffer's frame geometry, so it can be reused for receiving the next frame without any memory allocation.
+    If the frame has to be reoriented or clipped then the pixels are copied, the same way as in AddItem.
+  */
+  virtual PlusStatus AddItemAdoptFrame(PlusVideoFrame& frame,
+                                       long frameNumber,
+                                       const int clipRectangleOrigin[3],
+                                       const int clipRectangleSize[3],
+                                       double unfilteredTimestamp = UNDEFINED_TIMESTAMP,
+                                       double filteredTimestamp = UNDEFINED_TIMESTAMP,
+                                       const PlusTrackedFrame::FieldMapType* customFields = NULL);
   /*!
     Add a frame plus a timestamp to the buffer with frame index.
     Additionally an optional field name&value can be added,
@@ -155,6 +171,13 @@ public:
   };
   /*! Get a frame that was acquired at the specified time from buffer */
   virtual ItemStatus GetStreamBufferItemFromTime(double time, StreamBufferItem* bufferItem, DataItemTemporalInterpolationType interpolation);
+  /*!
+    Get frames for multiple timestamps from the buffer. The buffer is locked only once for all the timestamps,
+    therefore this is faster than calling GetStreamBufferItemFromTime for each timestamp and no new items are added meanwhile.
+    The items and itemStatuses vectors are resized to the number of timestamps (existing items are reused).
+    Returns PLUS_FAIL if any of the items could not be retrieved, the status of each item is stored in itemStatuses.
+  */
+  virtual PlusStatus GetStreamBufferItemsFromTimes(const std::vector<double>& timestamps, std::vector<StreamBufferItem>& items, std::vector<ItemStatus>& itemStatuses, DataItemTemporalInterpolationType interpolation);
   virtual PlusStatus ModifyBufferItemFrameField(BufferItemUidType uid, const std::string& key, const std::string& value);
 
   /*! Get latest timestamp in the buffer */
@@ -197,6 +220,13 @@ public:
   {
     return this->StreamBuffer->GetItemUidFromTime(time, uid);
   }
+  /*!
+    Get the UID and timestamp of all items that were acquired between timestampFrom and timestampTo (inclusive), in increasing order.
+    The range is resolved while the buffer is locked, so the returned items are consecutive even if new items are added meanwhile.
+    If only part of the range is in the buffer then the items of that part are returned.
+    Returns ITEM_NOT_AVAILABLE_YET or ITEM_NOT_AVAILABLE_ANYMORE if the whole range is outside the buffer.
+  */
+  virtual ItemStatus GetItemUidsFromTimeRange(double timestampFrom, double timestampTo, std::vector<BufferItemUidType>& uids, std::vector<double>& timestamps);
 
   /*! Set the local time offset in seconds (global = local + offset) */
   virtual void SetLocalTimeOffsetSec(double offsetSec);
@@ -248,6 +278,11 @@ public:
 
   virtual int GetAveragedItemsForFiltering();
 
+  /*! Limit the effect of outlier timestamps on the timestamp filtering */
+  virtual void SetRobustTimestampFiltering(bool robustTimestampFiltering);
+
+  virtual bool GetRobustTimestampFiltering();
+
   /*! Set recording start time */
   virtual void SetStartTime(double startTime);
   /*! Get recording start time */
@@ -306,7 +341,8 @@ public:
   virtual PlusStatus WriteToSequenceFile(const char* filename, bool useCompression = false);
 
   vtkGetStringMacro(DescriptiveName);
-  vtkSetStringMacro(DescriptiveName);
+  /*! Set the name of the buffer that is used in log messages and performance statistics */
+  virtual void SetDescriptiveName(const char* descriptiveName);
 
 protected:
   vtkPlusBuffer();
@@ -321,9 +357,34 @@ protected:
   */
   virtual bool CheckFrameFormat(const unsigned int frameSizeInPx[3], PlusCommon::VTKScalarPixelType pixelType, US_IMAGE_TYPE imgType, int numberOfScalarComponents);
 
+  /*!
+    Add a video frame to the buffer: create the filtered timestamp, check the frame format and fill the next buffer item.
+    If frameToAdopt is not NULL then the item takes over its pixel buffer, otherwise the pixels at imageDataPtr are copied,
+    reoriented according to flipInfo and clipped to the clip rectangle.
+  */
+  PlusStatus AddVideoItem(PlusVideoFrame* frameToAdopt,
+                          unsigned char* imageDataPtr,
+                          const unsigned int inputFrameSizeInPx[3],
+                          const PlusVideoFrame::FlipInfoType& flipInfo,
+                          PlusCommon::VTKScalarPixelType pixelType,
+                          unsigned int numberOfScalarComponents,
+                          US_IMAGE_TYPE imageType,
+                          long frameNumber,
+                          const int clipRectangleOrigin[3],
+                          const int clipRectangleSize[3],
+                          double unfilteredTimestamp,
+                          double filteredTimestamp,
+                          const PlusTrackedFrame::FieldMapType* customFields);
+
   /*! Returns the two buffer items that are closest previous and next buffer items relative to the specified time. itemA is the closest item */
   PlusStatus GetPrevNextBufferItemFromTime(double time, StreamBufferItem& itemA, StreamBufferItem& itemB);
 
+  /*!
+    Same as GetPrevNextBufferItemFromTime but returns pointers to the items stored in the buffer instead of copying them.
+    The caller must keep the StreamBuffer locked while the returned pointers are used.
+  */
+  PlusStatus GetPrevNextBufferItemPointerFromTime(double time, StreamBufferItem*& itemA, StreamBufferItem*& itemB);
+
   /*!
   Interpolate the matrix for the given timestamp from the two nearest transforms in the buffer.
   The rotation is interpolated with SLERP interpolation, and the position is interpolated with linear interpolation.
@@ -337,6 +398,9 @@ protected:
   /*! Get tracker buffer item from the closest timestamp */
   virtual ItemStatus GetStreamBufferItemFromClosestTime(double time, StreamBufferItem* bufferItem);
 
+  /*! Record the fill level of the buffer after an item is added or count the item as dropped */
+  void UpdatePerformanceStatistics(bool itemAdded);
+
 protected:
   /*! Image frame size in pixel */
   unsigned int FrameSize[3];
@@ -362,6 +426,11 @@ protected:
 
   char* DescriptiveName;
 
+  /*! Percentage of the buffer that is filled with valid items, recorded each time an item is added */
+  PlusPerformanceHistogram* FillLevelStatistics;
+  /*! Number of items that were not added to the buffer (e.g., because of invalid or non-increasing timestamp) */
+  PlusPerformanceCounter* DroppedItemsStatistics;
+
 private:
   vtkPlusBuffer(const vtkPlusBuffer&);
   void operator=(const vtkPlusBuffer&);
@@ -6,11 +6,13 @@ See License.txt for details.
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusPerformanceStatistics.h"
 #include "PlusPlotter.h"
 #include "vtkPlusBuffer.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
 #include "vtkPlusHTMLGenerator.h"
+#include "vtkPlusRecursiveCriticalSection.h"
 #include "vtkPlusTrackedFrameList.h"
 
 // VTK includes
@@ -19,6 +21,9 @@ See License.txt for details.
 #include <vtkObjectFactory.h>
 #include <vtkTable.h>
 
+// STL includes
+#include <cmath>
+
 //----------------------------------------------------------------------------
 
 vtkStandardNewMacro(vtkPlusChannel);
@@ -29,6 +34,24 @@ vtkStandardNewMacro(vtkPlusChannel);
 // This time should be long enough to comfortably retrieve a frame from the buffer.
 static const double SAMPLING_SKIPPING_MARGIN_SEC = 0.1;
 
+// Maximum number of recycled tracked frames kept for reuse. Pooled frames may hold large images, so the pool is limited.
+static const unsigned int MAX_TRACKED_FRAME_POOL_SIZE = 200;
+
+// Maximum difference between timestamps that are considered to be the same (in seconds)
+static const double NEGLIGIBLE_TIME_DIFFERENCE = 0.00001;
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  void AppendFieldIds(const PlusFrameFields& fields, std::vector<PlusFrameFields::FieldId>& fieldIds)
+  {
+    for (unsigned int i = 0; i < fields.GetNumberOfFields(); ++i)
+    {
+      fieldIds.push_back(fields.GetFieldIdAt(i));
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkPlusChannel::vtkPlusChannel(void)
   : VideoSource(NULL)
@@ -37,6 +60,8 @@ vtkPlusChannel::vtkPlusChannel(void)
   , RfProcessor(NULL)
   , BlankImage(vtkImageData::New())
   , SaveRfProcessingParameters(false)
+  , GetTrackedFrameStatistics(NULL)
+  , PoolMutex(vtkPlusRecursiveCriticalSection::New())
 {
   // Default size for brightness frame
   this->BrightnessFrameSize[0] = 640;
@@ -65,6 +90,42 @@ vtkPlusChannel::~vtkPlusChannel(void)
   DELETE_IF_NOT_NULL(this->BlankImage);
 
   DELETE_IF_NOT_NULL(this->RfProcessor);
+
+  for (std::vector<TrackedFrameScratch*>::iterator it = this->TrackedFrameScratchPool.begin(); it != this->TrackedFrameScratchPool.end(); ++it)
+  {
+    delete *it;
+  }
+  this->TrackedFrameScratchPool.clear();
+  for (std::vector<PlusTrackedFrame*>::iterator it = this->TrackedFramePool.begin(); it != this->TrackedFramePool.end(); ++it)
+  {
+    delete *it;
+  }
+  this->TrackedFramePool.clear();
+
+  DELETE_IF_NOT_NULL(this->PoolMutex);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusChannel::SetChannelId(const char* channelId)
+{
+  if (this->ChannelId == NULL && channelId == NULL)
+  {
+    return;
+  }
+  if (this->ChannelId != NULL && channelId != NULL && strcmp(this->ChannelId, channelId) == 0)
+  {
+    return;
+  }
+  delete[] this->ChannelId;
+  this->ChannelId = NULL;
+  this->GetTrackedFrameStatistics = NULL;
+  if (channelId != NULL)
+  {
+    this->ChannelId = new char[strlen(channelId) + 1];
+    strcpy(this->ChannelId, channelId);
+    this->GetTrackedFrameStatistics = PlusPerformanceStatistics::GetInstance()->GetHistogram(std::string("Channel.") + channelId + ".GetTrackedFrameMs");
+  }
+  this->Modified();
 }
 
 //----------------------------------------------------------------------------
@@ -312,6 +373,7 @@ PlusStatus vtkPlusChannel::RemoveTool(const std::string& toolSourceId)
 PlusStatus vtkPlusChannel::RemoveTools()
 {
   this->Tools.clear();
+  this->TimestampMasterTool = NULL;
 
   return PLUS_SUCCESS;
 }
@@ -472,29 +534,17 @@ void vtkPlusChannel::ShallowCopy(vtkDataObject* otherObject)
 //----------------------------------------------------------------------------
 void vtkPlusChannel::ShallowCopy(const vtkPlusChannel& aChannel)
 {
-  this->Clear();
-
-  vtkPlusDataSource* aSource = NULL;
-  if (aChannel.HasVideoSource() && aChannel.GetVideoSource(aSource))
-  {
-    this->VideoSource = aSource;
-  }
-  for (DataSourceContainerConstIterator it = aChannel.GetToolsStartConstIterator(); it != aChannel.GetToolsEndConstIterator(); ++it)
+  if (&aChannel == this)
   {
-    if (this->AddTool(it->second) != PLUS_SUCCESS)
-    {
-      LOG_ERROR("Unable to add a tool when shallow copying a channel.");
-      continue;
-    }
-  }
-  for (DataSourceContainerConstIterator it = aChannel.GetFieldDataSourcesStartConstIterator(); it != aChannel.GetFieldDataSourcesEndConstIterator(); ++it)
-  {
-    if (this->AddFieldDataSource(it->second) != PLUS_SUCCESS)
-    {
-      LOG_ERROR("Unable to add a field data source when shallow copying a channel.");
-      continue;
-    }
+    return;
   }
+
+  // The data sources are shared with the other channel, their buffers must not be cleared here
+  this->VideoSource = aChannel.VideoSource;
+  this->Tools = aChannel.Tools;
+  this->TimestampMasterTool = aChannel.TimestampMasterTool;
+  this->FieldDataSources = aChannel.FieldDataSources;
+  this->Modified();
 }
 
 //----------------------------------------------------------------------------
@@ -505,10 +555,42 @@ void vtkPlusChannel::SetVideoSource(vtkPlusDataSource* aSource)
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, PlusTrackedFrame& aTrackedFrame, bool enableImageData/*=true*/)
+{
+  PlusPerformanceScopedTimer getTrackedFrameTimer(this->GetTrackedFrameStatistics);
+
+  // Each concurrent caller gets its own temporary items, which are reused in subsequent calls
+  TrackedFrameScratch* scratch = this->AcquireTrackedFrameScratch();
+  PlusStatus status = this->GetTrackedFrameUsingScratch(timestamp, aTrackedFrame, enableImageData, *scratch);
+  this->ReleaseTrackedFrameScratch(scratch);
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+StreamBufferItem* vtkPlusChannel::GetBatchItem(TrackedFrameScratch& scratch, TrackedFrameScratch::SourceItem& sourceItem, double timestamp)
+{
+  // Batch items can only be used if they were retrieved for the requested time
+  // (the time may differ from the batch timestamp if, for example, a previous item had to be retrieved from the closest time)
+  int frameIndex = scratch.BatchFrameIndex;
+  if (frameIndex < 0 || frameIndex >= static_cast<int>(sourceItem.BatchItems.size())
+      || sourceItem.BatchItemStatuses[frameIndex] != ITEM_OK
+      || fabs(scratch.BatchTimestamps[frameIndex] - timestamp) > NEGLIGIBLE_TIME_DIFFERENCE)
+  {
+    return NULL;
+  }
+  return &sourceItem.BatchItems[frameIndex];
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusChannel::GetTrackedFrameUsingScratch(double timestamp, PlusTrackedFrame& aTrackedFrame, bool enableImageData, TrackedFrameScratch& scratch)
 {
   int numberOfErrors(0);
   double synchronizedTimestamp(0);
 
+  // The frame may be recycled: every field that is not set from the current data is removed at the end
+  scratch.FrameFieldIds.clear();
+  aTrackedFrame.SetFiducialPointsCoordinatePx(NULL);
+
   // Get frame UID
   if (this->HasVideoSource() && enableImageData)
   {
@@ -518,7 +600,16 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, PlusTrackedFrame& a
       return PLUS_FAIL;
     }
     BufferItemUidType frameUID = 0;
-    ItemStatus status = this->VideoSource->GetItemUidFromTime(timestamp, frameUID);
+    ItemStatus status = ITEM_OK;
+    if (scratch.BatchFrameIndex >= 0 && !scratch.BatchVideoUids.empty())
+    {
+      // The frame UID is already known
+      frameUID = scratch.BatchVideoUids[scratch.BatchFrameIndex];
+    }
+    else
+    {
+      status = this->VideoSource->GetItemUidFromTime(timestamp, frameUID);
+    }
     if (status != ITEM_OK)
     {
       if (status == ITEM_NOT_AVAILABLE_ANYMORE)
@@ -539,26 +630,25 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, PlusTrackedFrame& a
       return PLUS_FAIL;
     }
 
-    StreamBufferItem CurrentStreamBufferItem;
-    if (this->VideoSource->GetStreamBufferItem(frameUID, &CurrentStreamBufferItem) != ITEM_OK)
+    StreamBufferItem& currentStreamBufferItem = scratch.VideoItem;
+    if (this->VideoSource->GetStreamBufferItem(frameUID, &currentStreamBufferItem) != ITEM_OK)
     {
       LOG_ERROR("Couldn't get video buffer item by frame UID: " << frameUID);
       return PLUS_FAIL;
     }
 
-    // Copy frame
-    PlusVideoFrame frame = CurrentStreamBufferItem.GetFrame();
-    aTrackedFrame.SetImageData(frame);
+    // Copy frame (the image buffer of the tracked frame is reused if the frame geometry is unchanged)
+    aTrackedFrame.SetImageData(currentStreamBufferItem.GetFrame());
 
     // Copy all custom fields
-    StreamBufferItem::FieldMapType fieldMap = CurrentStreamBufferItem.GetCustomFrameFieldMap();
-    StreamBufferItem::FieldMapType::iterator fieldIterator;
-    for (fieldIterator = fieldMap.begin(); fieldIterator != fieldMap.end(); fieldIterator++)
-    {
-      aTrackedFrame.SetCustomFrameField((*fieldIterator).first, (*fieldIterator).second);
-    }
+    aTrackedFrame.SetCustomFrameFields(currentStreamBufferItem.GetCustomFrameFields());
+    AppendFieldIds(currentStreamBufferItem.GetCustomFrameFields(), scratch.FrameFieldIds);
 
-    synchronizedTimestamp = CurrentStreamBufferItem.GetTimestamp(this->VideoSource->GetLocalTimeOffsetSec());
+    synchronizedTimestamp = currentStreamBufferItem.GetTimestamp(this->VideoSource->GetLocalTimeOffsetSec());
+  }
+  else
+  {
+    aTrackedFrame.ClearImageData();
   }
 
   if (synchronizedTimestamp == 0)
@@ -572,16 +662,27 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, PlusTrackedFrame& a
   for (DataSourceContainerConstIterator it = this->GetToolsStartIterator(); it != this->GetToolsEndIterator(); ++it)
   {
     vtkPlusDataSource* aTool = it->second;
-    PlusTransformName toolTransformName(aTool->GetId());
-    if (!toolTransformName.IsValid())
+    TrackedFrameScratch::SourceItem& toolItem = scratch.SourceItems[it->first];
+    if (toolItem.TransformFieldName.empty())
     {
-      LOG_ERROR("Tool transform name is invalid!");
-      numberOfErrors++;
-      continue;
+      // The field names are computed only once for each tool
+      PlusTransformName toolTransformName(aTool->GetId());
+      if (!toolTransformName.IsValid()
+          || PlusTrackedFrame::GetTransformFieldName(toolTransformName, toolItem.TransformFieldName) != PLUS_SUCCESS
+          || PlusTrackedFrame::GetTransformStatusFieldName(toolTransformName, toolItem.TransformStatusFieldName) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Tool transform name is invalid!");
+        toolItem.TransformFieldName.clear();
+        numberOfErrors++;
+        continue;
+      }
+      toolItem.TransformFieldId = PlusFrameFields::GetFieldId(toolItem.TransformFieldName);
+      toolItem.TransformStatusFieldId = PlusFrameFields::GetFieldId(toolItem.TransformStatusFieldName);
     }
 
-    StreamBufferItem bufferItem;
-    ItemStatus result = aTool->GetStreamBufferItemFromTime(synchronizedTimestamp, &bufferItem, vtkPlusBuffer::INTERPOLATED);
+    StreamBufferItem* batchItem = GetBatchItem(scratch, toolItem, synchronizedTimestamp);
+    StreamBufferItem& bufferItem = (batchItem != NULL ? *batchItem : toolItem.Item);
+    ItemStatus result = (batchItem != NULL ? ITEM_OK : aTool->GetStreamBufferItemFromTime(synchronizedTimestamp, &bufferItem, vtkPlusBuffer::INTERPOLATED));
     if (result != ITEM_OK)
     {
       double latestTimestamp(0);
@@ -603,35 +704,22 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, PlusTrackedFrame& a
       continue;
     }
 
-    vtkSmartPointer<vtkMatrix4x4> dMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-    if (bufferItem.GetMatrix(dMatrix) != PLUS_SUCCESS)
+    double toolMatrix[16] = {0};
+    if (bufferItem.GetMatrix(toolMatrix) != PLUS_SUCCESS)
     {
       LOG_ERROR("Failed to get matrix from buffer item for tool " << aTool->GetId());
       numberOfErrors++;
       continue;
     }
 
-    if (aTrackedFrame.SetCustomFrameTransform(toolTransformName, dMatrix) != PLUS_SUCCESS)
-    {
-      LOG_ERROR("Failed to set transform for tool " << aTool->GetId());
-      numberOfErrors++;
-      continue;
-    }
-
-    if (aTrackedFrame.SetCustomFrameTransformStatus(toolTransformName, vtkPlusDevice::ConvertToolStatusToTrackedFrameFieldStatus(bufferItem.GetStatus())) != PLUS_SUCCESS)
-    {
-      LOG_ERROR("Failed to set transform status for tool " << aTool->GetId());
-      numberOfErrors++;
-      continue;
-    }
+    aTrackedFrame.SetCustomFrameTransformField(toolItem.TransformFieldName, toolMatrix);
+    aTrackedFrame.SetCustomFrameTransformStatusField(toolItem.TransformStatusFieldName, vtkPlusDevice::ConvertToolStatusToTrackedFrameFieldStatus(bufferItem.GetStatus()));
 
     // Copy all custom fields
-    StreamBufferItem::FieldMapType fieldMap = bufferItem.GetCustomFrameFieldMap();
-    StreamBufferItem::FieldMapType::iterator fieldIterator;
-    for (fieldIterator = fieldMap.begin(); fieldIterator != fieldMap.end(); fieldIterator++)
-    {
-      aTrackedFrame.SetCustomFrameField((*fieldIterator).first, (*fieldIterator).second);
-    }
+    aTrackedFrame.SetCustomFrameFields(bufferItem.GetCustomFrameFields());
+    scratch.FrameFieldIds.push_back(toolItem.TransformFieldId);
+    scratch.FrameFieldIds.push_back(toolItem.TransformStatusFieldId);
+    AppendFieldIds(bufferItem.GetCustomFrameFields(), scratch.FrameFieldIds);
 
     synchronizedTimestamp = bufferItem.GetTimestamp(aTool->GetLocalTimeOffsetSec());
   }
@@ -640,8 +728,10 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, PlusTrackedFrame& a
   {
     vtkPlusDataSource* aSource = it->second;
 
-    StreamBufferItem bufferItem;
-    ItemStatus result = aSource->GetStreamBufferItemFromTime(synchronizedTimestamp, &bufferItem, vtkPlusBuffer::CLOSEST_TIME);
+    TrackedFrameScratch::SourceItem& fieldDataItem = scratch.SourceItems[it->first];
+    StreamBufferItem* batchItem = GetBatchItem(scratch, fieldDataItem, synchronizedTimestamp);
+    StreamBufferItem& bufferItem = (batchItem != NULL ? *batchItem : fieldDataItem.Item);
+    ItemStatus result = (batchItem != NULL ? ITEM_OK : aSource->GetStreamBufferItemFromTime(synchronizedTimestamp, &bufferItem, vtkPlusBuffer::CLOSEST_TIME));
     if (result != ITEM_OK)
     {
       double latestTimestamp(0);
@@ -664,12 +754,8 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, PlusTrackedFrame& a
     }
 
     // Copy all custom fields
-    StreamBufferItem::FieldMapType fieldMap = bufferItem.GetCustomFrameFieldMap();
-    StreamBufferItem::FieldMapType::iterator fieldIterator;
-    for (fieldIterator = fieldMap.begin(); fieldIterator != fieldMap.end(); fieldIterator++)
-    {
-      aTrackedFrame.SetCustomFrameField((*fieldIterator).first, (*fieldIterator).second);
-    }
+    aTrackedFrame.SetCustomFrameFields(bufferItem.GetCustomFrameFields());
+    AppendFieldIds(bufferItem.GetCustomFrameFields(), scratch.FrameFieldIds);
 
     synchronizedTimestamp = bufferItem.GetTimestamp(aSource->GetLocalTimeOffsetSec());
   }
@@ -677,9 +763,75 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, PlusTrackedFrame& a
   // Copy frame timestamp
   aTrackedFrame.SetTimestamp(synchronizedTimestamp);
 
+  // Remove fields left in the frame by its previous use (e.g., transform of a tool that is now missing)
+  aTrackedFrame.DeleteCustomFrameFieldsExcept(scratch.FrameFieldIds);
+
   return (numberOfErrors == 0 ? PLUS_SUCCESS : PLUS_FAIL);
 }
 
+//----------------------------------------------------------------------------
+vtkPlusChannel::TrackedFrameScratch* vtkPlusChannel::AcquireTrackedFrameScratch()
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> poolGuardedLock(this->PoolMutex);
+  if (this->TrackedFrameScratchPool.empty())
+  {
+    return new TrackedFrameScratch;
+  }
+  TrackedFrameScratch* scratch = this->TrackedFrameScratchPool.back();
+  this->TrackedFrameScratchPool.pop_back();
+  return scratch;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusChannel::ReleaseTrackedFrameScratch(TrackedFrameScratch* scratch)
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> poolGuardedLock(this->PoolMutex);
+  this->TrackedFrameScratchPool.push_back(scratch);
+}
+
+//----------------------------------------------------------------------------
+PlusTrackedFrame* vtkPlusChannel::AcquireTrackedFrame()
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> poolGuardedLock(this->PoolMutex);
+  if (this->TrackedFramePool.empty())
+  {
+    return new PlusTrackedFrame;
+  }
+  PlusTrackedFrame* trackedFrame = this->TrackedFramePool.back();
+  this->TrackedFramePool.pop_back();
+  return trackedFrame;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusChannel::ReleaseTrackedFrame(PlusTrackedFrame* trackedFrame)
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> poolGuardedLock(this->PoolMutex);
+  if (this->TrackedFramePool.size() >= MAX_TRACKED_FRAME_POOL_SIZE)
+  {
+    delete trackedFrame;
+    return;
+  }
+  this->TrackedFramePool.push_back(trackedFrame);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusChannel::RecycleTrackedFrames(vtkPlusTrackedFrameList* aTrackedFrameList)
+{
+  if (aTrackedFrameList == NULL)
+  {
+    LOG_ERROR("Unable to recycle tracked frames - tracked frame list is NULL!");
+    return;
+  }
+
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> poolGuardedLock(this->PoolMutex);
+  aTrackedFrameList->ReleaseTrackedFrames(this->TrackedFramePool);
+  while (this->TrackedFramePool.size() > MAX_TRACKED_FRAME_POOL_SIZE)
+  {
+    delete this->TrackedFramePool.back();
+    this->TrackedFramePool.pop_back();
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetTrackedFrame(PlusTrackedFrame& trackedFrame)
 {
@@ -918,112 +1070,114 @@ PlusStatus vtkPlusChannel::GetTrackedFrameList(double& aTimestampOfLastFrameAlre
 
   LOG_TRACE("Number of added frames: " << numberOfFramesToAdd << " out of " << numberOfFramesSinceTimestamp);
 
-  // If we couldn't find any frames (or one of the items were invalid)
-  // set the timestamp to the most recent one
-  if (numberOfFramesToAdd == 0)
+  // Tool and field data items are retrieved for all the frames at once, using temporary items from the pool
+  TrackedFrameScratch* scratch = this->AcquireTrackedFrameScratch();
+  status = this->AddTrackedFramesToList(timestampFrom, mostRecentTimestamp, numberOfFramesToAdd, aTimestampOfLastFrameAlreadyGot, aTrackedFrameList, *scratch);
+  this->ReleaseTrackedFrameScratch(scratch);
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusChannel::AddTrackedFramesToList(double timestampFrom, double timestampTo, int numberOfFramesToAdd, double& aTimestampOfLastFrameAlreadyGot, vtkPlusTrackedFrameList* aTrackedFrameList, TrackedFrameScratch& scratch)
+{
+  if (numberOfFramesToAdd <= 0)
   {
-    timestampFrom = mostRecentTimestamp;
+    return PLUS_SUCCESS;
   }
 
-  for (int i = 0; i < numberOfFramesToAdd; ++i)
+  // Get the timestamps of all the frames to add with a single buffer query
+  vtkPlusDataSource* timingSource = NULL;
+  if (this->GetVideoDataAvailable())
   {
-    // Only add this frame if it has not been already added
-    if (timestampFrom > aTimestampOfLastFrameAlreadyGot || aTimestampOfLastFrameAlreadyGot == UNDEFINED_TIMESTAMP)
+    timingSource = this->VideoSource;
+  }
+  else if (this->GetTrackingEnabled())
+  {
+    if (this->GetTimestampMasterTool(timingSource) != PLUS_SUCCESS)
     {
-      // Get tracked frame from buffer
-      PlusTrackedFrame* trackedFrame = new PlusTrackedFrame;
-
-      if (this->GetTrackedFrame(timestampFrom, *trackedFrame) != PLUS_SUCCESS)
-      {
-        delete trackedFrame;
-        LOG_ERROR("Unable to get tracked frame by time: " << std::fixed << timestampFrom);
-        return PLUS_FAIL;
-      }
-
-      // Add tracked frame to the list
-      aTimestampOfLastFrameAlreadyGot = trackedFrame->GetTimestamp();
-      if (aTrackedFrameList->TakeTrackedFrame(trackedFrame, vtkPlusTrackedFrameList::SKIP_INVALID_FRAME) != PLUS_SUCCESS)
-      {
-        LOG_ERROR("Unable to add tracked frame to the list!");
-        return PLUS_FAIL;
-      }
+      LOG_ERROR("Failed to get tracked frame list - there is no active tool!");
+      return PLUS_FAIL;
     }
+  }
+  else if (this->GetFieldDataAvailable())
+  {
+    timingSource = this->FieldDataSources.begin()->second;
+  }
 
-    // Get next timestamp
-    if (this->GetVideoDataAvailable() && i < numberOfFramesToAdd - 1)
+  if (timingSource != NULL)
+  {
+    if (timingSource->GetItemUidsFromTimeRange(timestampFrom, timestampTo, scratch.BatchVideoUids, scratch.BatchTimestamps) != ITEM_OK)
     {
-      BufferItemUidType videoUid(0);
-      if (this->VideoSource->GetItemUidFromTime(timestampFrom, videoUid) != ITEM_OK)
-      {
-        LOG_ERROR("Failed to get video buffer item UID from time: " << std::fixed << timestampFrom);
-        return PLUS_FAIL;
-      }
-
-      if (videoUid >= this->VideoSource->GetLatestItemUidInBuffer())
-      {
-        LOG_WARNING("Requested video uid (" << videoUid + 1 << ") is not in the buffer yet!");
-        break;
-      }
-
-      // Get the timestamp of the next item in the buffer
-      if (this->VideoSource->GetTimeStamp(++videoUid, timestampFrom) != ITEM_OK)
-      {
-        LOG_ERROR("Unable to get timestamp from video buffer by UID: " << videoUid);
-        return PLUS_FAIL;
-      }
+      LOG_ERROR("Failed to get " << timingSource->GetId() << " buffer items between " << std::fixed << timestampFrom << " and " << timestampTo);
+      return PLUS_FAIL;
     }
-    else if (this->GetTrackingEnabled() && i < numberOfFramesToAdd - 1)
+    if (scratch.BatchTimestamps.size() > static_cast<unsigned int>(numberOfFramesToAdd))
     {
-      vtkPlusDataSource* masterTool = NULL;
-      if (this->GetTimestampMasterTool(masterTool) != PLUS_SUCCESS)
-      {
-        LOG_ERROR("Failed to get tracked frame list - there is no active tool!");
-        return PLUS_FAIL;
-      }
+      scratch.BatchTimestamps.resize(numberOfFramesToAdd);
+      scratch.BatchVideoUids.resize(numberOfFramesToAdd);
+    }
+    if (timingSource != this->VideoSource)
+    {
+      scratch.BatchVideoUids.clear();
+    }
+  }
+  else
+  {
+    // All the frames would have the same timestamp, so only one of them could be added
+    scratch.BatchVideoUids.clear();
+    scratch.BatchTimestamps.assign(1, timestampFrom);
+  }
 
-      BufferItemUidType trackerUid(0);
-      if (masterTool->GetItemUidFromTime(timestampFrom, trackerUid) != ITEM_OK)
-      {
-        LOG_ERROR("Failed to get tracker buffer item UID from time: " << std::fixed << timestampFrom);
-        return PLUS_FAIL;
-      }
+  // Get the items of all the frames with a single query of each tool and field data buffer.
+  // Items that cannot be retrieved now are requested again when the frame is assembled (and the error is reported then).
+  for (DataSourceContainerConstIterator it = this->GetToolsStartIterator(); it != this->GetToolsEndIterator(); ++it)
+  {
+    TrackedFrameScratch::SourceItem& toolItem = scratch.SourceItems[it->first];
+    it->second->GetStreamBufferItemsFromTimes(scratch.BatchTimestamps, toolItem.BatchItems, toolItem.BatchItemStatuses, vtkPlusBuffer::INTERPOLATED);
+  }
+  for (DataSourceContainerConstIterator it = this->GetFieldDataSourcesStartIterator(); it != this->GetFieldDataSourcesEndIterator(); ++it)
+  {
+    TrackedFrameScratch::SourceItem& fieldDataItem = scratch.SourceItems[it->first];
+    it->second->GetStreamBufferItemsFromTimes(scratch.BatchTimestamps, fieldDataItem.BatchItems, fieldDataItem.BatchItemStatuses, vtkPlusBuffer::CLOSEST_TIME);
+  }
 
-      if (trackerUid >= masterTool->GetLatestItemUidInBuffer())
-      {
-        LOG_ERROR("Requested tracker uid (" << trackerUid + 1 << ") is not in the buffer yet!");
-        break;
-      }
+  PlusStatus status = PLUS_SUCCESS;
+  for (unsigned int i = 0; i < scratch.BatchTimestamps.size(); ++i)
+  {
+    double frameTimestamp = scratch.BatchTimestamps[i];
 
-      // Get the timestamp of the next item in the buffer
-      if (masterTool->GetTimeStamp(++trackerUid, timestampFrom) != ITEM_OK)
-      {
-        LOG_WARNING("Unable to get timestamp from tracker buffer by UID: " << trackerUid);
-        return PLUS_FAIL;
-      }
-    }
-    else if (this->GetFieldDataAvailable() && i < numberOfFramesToAdd - 1)
+    // Only add this frame if it has not been already added
+    if (frameTimestamp <= aTimestampOfLastFrameAlreadyGot && aTimestampOfLastFrameAlreadyGot != UNDEFINED_TIMESTAMP)
     {
-      vtkPlusDataSource* firstFieldDataSource = this->FieldDataSources.begin()->second;
+      continue;
+    }
 
-      BufferItemUidType fieldUid(0);
-      if (firstFieldDataSource->GetItemUidFromTime(timestampFrom, fieldUid) != ITEM_OK)
-      {
-        LOG_ERROR("Failed to get tracker buffer item UID from time: " << std::fixed << timestampFrom);
-        return PLUS_FAIL;
-      }
+    // Get tracked frame from buffer (a recycled frame is refilled if available)
+    PlusTrackedFrame* trackedFrame = this->AcquireTrackedFrame();
 
-      if (fieldUid >= firstFieldDataSource->GetLatestItemUidInBuffer())
-      {
-        LOG_ERROR("Requested tracker uid (" << fieldUid + 1 << ") is not in the buffer yet!");
-        break;
-      }
+    PlusStatus frameStatus = PLUS_SUCCESS;
+    {
+      PlusPerformanceScopedTimer getTrackedFrameTimer(this->GetTrackedFrameStatistics);
+      scratch.BatchFrameIndex = i;
+      frameStatus = this->GetTrackedFrameUsingScratch(frameTimestamp, *trackedFrame, true, scratch);
+      scratch.BatchFrameIndex = -1;
+    }
+    if (frameStatus != PLUS_SUCCESS)
+    {
+      this->ReleaseTrackedFrame(trackedFrame);
+      LOG_ERROR("Unable to get tracked frame by time: " << std::fixed << frameTimestamp);
+      status = PLUS_FAIL;
+      break;
+    }
 
-      // Get the timestamp of the next item in the buffer
-      if (firstFieldDataSource->GetTimeStamp(++fieldUid, timestampFrom) != ITEM_OK)
-      {
-        LOG_WARNING("Unable to get timestamp from field data buffer by UID: " << fieldUid);
-        return PLUS_FAIL;
-      }
+    // Add tracked frame to the list
+    aTimestampOfLastFrameAlreadyGot = trackedFrame->GetTimestamp();
+    if (aTrackedFrameList->TakeTrackedFrame(trackedFrame, vtkPlusTrackedFrameList::SKIP_INVALID_FRAME) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to add tracked frame to the list!");
+      status = PLUS_FAIL;
+      break;
     }
   }
 
@@ -1090,12 +1244,12 @@ PlusStatus vtkPlusChannel::GetTrackedFrameListSampled(double& aTimestampOfLastFr
       // This frame has been already added. Don't spend time with retrieving this frame, just jump to the next
       continue;
     }
-    // Get tracked frame from buffer (actually copies pixel and field data)
-    PlusTrackedFrame* trackedFrame = new PlusTrackedFrame;
+    // Get tracked frame from buffer (actually copies pixel and field data, a recycled frame is refilled if available)
+    PlusTrackedFrame* trackedFrame = this->AcquireTrackedFrame();
     if (GetTrackedFrame(closestTimestamp, *trackedFrame) != PLUS_SUCCESS)
     {
       LOG_WARNING("vtkPlusChannel::GetTrackedFrameListSampled: Unable retrieve frame from the devices for time: " << std::fixed << aTimestampOfNextFrameToBeAdded << ", probably the item is not available in the buffers anymore. Frames may be lost.");
-      delete trackedFrame;
+      this->ReleaseTrackedFrame(trackedFrame);
       continue;
     }
     aTimestampOfLastFrameAlreadyGot = trackedFrame->GetTimestamp();
@@ -13,11 +13,14 @@
 #include "PlusStreamBufferItem.h"
 #include "vtkDataObject.h"
 #include "vtkPlusRfProcessor.h"
+#include "vtkPlusTimestampedCircularBuffer.h"
 
+class PlusPerformanceHistogram;
 class PlusTrackedFrame;
 class vtkPlusHTMLGenerator;
 class vtkPlusDataSource;
 class vtkPlusDevice;
+class vtkPlusRecursiveCriticalSection;
 class vtkPlusTrackedFrameList;
 
 typedef std::map<std::string, vtkPlusDataSource*> DataSourceContainer;
@@ -107,6 +110,10 @@ public:
     \param timestamp Timestamp of the requested tracked frame
     \param trackedFrame Target tracked frame
     \param enableImageData Enable returning of image data. Tracking data will be interpolated at the timestamp of the image data.
+    The same trackedFrame object may be passed in repeated calls: it is refilled in place, the image buffer is reused if the
+    frame geometry is unchanged and transform and field values are overwritten without memory reallocation.
+    Fields, image and fiducial points that are not set from the data at the requested time are removed (the result is the same
+    as for a newly constructed frame).
   */
   virtual PlusStatus GetTrackedFrame(double timestamp, PlusTrackedFrame& trackedFrame, bool enableImageData = true);
   virtual PlusStatus GetTrackedFrame(PlusTrackedFrame& trackedFrame);
@@ -132,6 +139,14 @@ public:
   */
   PlusStatus GetTrackedFrameList(double& aTimestampOfLastFrameAlreadyGot, vtkPlusTrackedFrameList* aTrackedFrameList, int aMaxNumberOfFramesToAdd);
 
+  /*!
+    Move all frames of a tracked frame list into the frame pool of the channel. GetTrackedFrameList and GetTrackedFrameListSampled
+    take the frames from this pool and refill them, therefore recycling the frames instead of clearing the list
+    avoids memory allocation and image buffer reallocation for each retrieved frame.
+    Recycled frames are refilled completely: fields of the previous use that are not set from the new data are removed.
+  */
+  void RecycleTrackedFrames(vtkPlusTrackedFrameList* aTrackedFrameList);
+
   /*! Get the closest tracked frame timestamp to the specified time */
   virtual double GetClosestTrackedFrameTimestampByTime(double time);
 
@@ -141,9 +156,14 @@ public:
   /*! Return the oldest synchronized timestamp in the buffers */
   virtual PlusStatus GetOldestTimestamp(double& ts);
 
+  /*! Clear the buffers of all the data sources of the channel */
   virtual PlusStatus Clear();
 
   virtual void ShallowCopy(vtkDataObject*);
+  /*!
+    Make this channel reference the data sources of the other channel (instead of its current data sources).
+    No data is copied and the contents of the buffers are not modified.
+  */
   virtual void ShallowCopy(const vtkPlusChannel& aChannel);
 
   virtual PlusStatus GetLatestTimestamp(double& aTimestamp) const;
@@ -155,7 +175,8 @@ public:
   PlusStatus GetCustomAttribute(const std::string& attributeId, std::string& output) const;
   PlusStatus GetCustomAttributeMap(CustomAttributeMap& output) const;
 
-  vtkSetStringMacro(ChannelId);
+  /*! Set the channel identifier, which is also used in the performance statistics names */
+  virtual void SetChannelId(const char* channelId);
   vtkGetStringMacro(ChannelId);
 
   vtkGetObjectMacro(RfProcessor, vtkPlusRfProcessor);
@@ -170,9 +191,65 @@ public:
   virtual PlusStatus GenerateDataAcquisitionReport(vtkPlusHTMLGenerator* htmlReport);
 
 protected:
+  /*! Temporary buffer items for assembling a tracked frame. Kept in a pool to avoid memory allocations in GetTrackedFrame. */
+  struct TrackedFrameScratch
+  {
+    TrackedFrameScratch() : BatchFrameIndex(-1) {}
+
+    struct SourceItem
+    {
+      SourceItem() : TransformFieldId(0), TransformStatusFieldId(0) {}
+
+      StreamBufferItem Item;
+      /*! Names of the frame fields that store the transform and its status (only used for tools) */
+      std::string TransformFieldName;
+      std::string TransformStatusFieldName;
+      PlusFrameFields::FieldId TransformFieldId;
+      PlusFrameFields::FieldId TransformStatusFieldId;
+      /*! Items of the source for each frame of the batch (see BatchTimestamps) */
+      std::vector<StreamBufferItem> BatchItems;
+      std::vector<ItemStatus> BatchItemStatuses;
+    };
+    StreamBufferItem VideoItem;
+    /*! Tool and field data source items, the key is the data source id */
+    std::map<std::string, SourceItem> SourceItems;
+
+    /*! Timestamps of the frames that are assembled together in GetTrackedFrameList (their tool and field data items are retrieved at once) */
+    std::vector<double> BatchTimestamps;
+    /*! Video item UIDs of the frames of the batch. Empty if the frame timestamps are not defined by the video source. */
+    std::vector<BufferItemUidType> BatchVideoUids;
+    /*! Index of the frame of the batch that is being assembled, -1 if the frame is not part of a batch */
+    int BatchFrameIndex;
+
+    /*! Identifiers of the fields that are set in the frame that is being assembled */
+    std::vector<PlusFrameFields::FieldId> FrameFieldIds;
+  };
+
   /*! Get number of tracked frames between two given timestamps (inclusive) */
   virtual int GetNumberOfFramesBetweenTimestamps(double aTimestampFrom, double aTimestampTo);
 
+  /*! Get tracked frame using the provided temporary buffer items (see GetTrackedFrame) */
+  PlusStatus GetTrackedFrameUsingScratch(double timestamp, PlusTrackedFrame& trackedFrame, bool enableImageData, TrackedFrameScratch& scratch);
+
+  /*! Get the item of the source that was retrieved for the frame of the batch that is being assembled. Returns NULL if it is not available for the specified time. */
+  static StreamBufferItem* GetBatchItem(TrackedFrameScratch& scratch, TrackedFrameScratch::SourceItem& sourceItem, double timestamp);
+
+  /*!
+    Add the tracked frames between the specified timestamps (at most numberOfFramesToAdd frames) to the list.
+    Timestamps of the frames and items of the tools and field data sources are retrieved with a single query of each buffer.
+  */
+  PlusStatus AddTrackedFramesToList(double timestampFrom, double timestampTo, int numberOfFramesToAdd, double& aTimestampOfLastFrameAlreadyGot, vtkPlusTrackedFrameList* aTrackedFrameList, TrackedFrameScratch& scratch);
+
+  /*! Get temporary buffer items from the pool (allocated if the pool is empty) */
+  TrackedFrameScratch* AcquireTrackedFrameScratch();
+  /*! Return temporary buffer items to the pool */
+  void ReleaseTrackedFrameScratch(TrackedFrameScratch* scratch);
+
+  /*! Get a tracked frame from the frame pool (allocated if the pool is empty). The caller takes over the ownership of the frame. */
+  PlusTrackedFrame* AcquireTrackedFrame();
+  /*! Return a tracked frame to the frame pool */
+  void ReleaseTrackedFrame(PlusTrackedFrame* trackedFrame);
+
 protected:
   DataSourceContainer       FieldDataSources;
   DataSourceContainer       Tools;
@@ -198,6 +275,14 @@ protected:
 
   CustomAttributeMap CustomAttributes;
 
+  /*! Duration of retrieving a tracked frame */
+  PlusPerformanceHistogram* GetTrackedFrameStatistics;
+
+  /*! Pools of reusable objects for tracked frame retrieval, protected by PoolMutex */
+  std::vector<TrackedFrameScratch*> TrackedFrameScratchPool;
+  std::vector<PlusTrackedFrame*> TrackedFramePool;
+  vtkPlusRecursiveCriticalSection* PoolMutex;
+
   vtkPlusChannel(void);
   virtual ~vtkPlusChannel(void);
 
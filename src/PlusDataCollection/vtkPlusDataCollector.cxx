@@ -13,6 +13,7 @@ See License.txt for details.
 #include "vtkPlusDataSource.h"
 #include "vtkPlusDevice.h"
 #include "vtkPlusDeviceFactory.h"
+#include "vtkPlusDeviceScheduler.h"
 #include "vtkPlusSavedDataSource.h"
 #include "vtkPlusTrackedFrameList.h"
 
@@ -89,6 +90,19 @@ PlusStatus vtkPlusDataCollector::ReadConfiguration(vtkXMLDataElement* aConfig)
     LOG_DEBUG("StartupDelaySec: " << std::fixed << startupDelaySec);
   }
 
+  // Read DeviceSchedulerNumberOfThreads
+  int deviceSchedulerNumberOfThreads(0);
+  if (dataCollectionElement->GetScalarAttribute("DeviceSchedulerNumberOfThreads", deviceSchedulerNumberOfThreads) && deviceSchedulerNumberOfThreads > 0)
+  {
+    this->DeviceScheduler = vtkSmartPointer<vtkPlusDeviceScheduler>::New();
+    if (this->DeviceScheduler->SetNumberOfThreads(deviceSchedulerNumberOfThreads) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Invalid DeviceSchedulerNumberOfThreads: " << deviceSchedulerNumberOfThreads);
+      return PLUS_FAIL;
+    }
+    LOG_DEBUG("DeviceSchedulerNumberOfThreads: " << deviceSchedulerNumberOfThreads);
+  }
+
   std::set<std::string> existingDeviceIds;
 
   for (int i = 0; i < dataCollectionElement->GetNumberOfNestedElements(); ++i)
@@ -121,6 +135,7 @@ PlusStatus vtkPlusDataCollector::ReadConfiguration(vtkXMLDataElement* aConfig)
       continue;
     }
     device->SetDataCollector(this);
+    device->SetDeviceScheduler(this->DeviceScheduler);
     if (device->ReadConfiguration(aConfig) != PLUS_SUCCESS)
     {
       LOG_ERROR("Failed to read parameters of device: " << deviceElement->GetAttribute("Id") << " (type: " << deviceElement->GetAttribute("Type") << ")");
@@ -243,6 +258,14 @@ PlusStatus vtkPlusDataCollector::WriteConfiguration(vtkXMLDataElement* aConfig)
   }
 
   dataCollectionConfig->SetDoubleAttribute("StartupDelaySec", GetStartupDelaySec());
+  if (this->DeviceScheduler != NULL)
+  {
+    dataCollectionConfig->SetIntAttribute("DeviceSchedulerNumberOfThreads", this->DeviceScheduler->GetNumberOfThreads());
+  }
+  else
+  {
+    XML_REMOVE_ATTRIBUTE(dataCollectionConfig, "DeviceSchedulerNumberOfThreads");
+  }
 
   PlusStatus status = PLUS_SUCCESS;
 
@@ -593,12 +616,7 @@ PlusStatus vtkPlusDataCollector::GetVideoData(vtkPlusChannel* aRequestedChannel,
     trackedFrame->SetTimestamp(itemTimestamp);
 
     // Copy all custom fields
-    StreamBufferItem::FieldMapType fieldMap = currentStreamBufferItem.GetCustomFrameFieldMap();
-    StreamBufferItem::FieldMapType::iterator fieldIterator;
-    for (fieldIterator = fieldMap.begin(); fieldIterator != fieldMap.end(); fieldIterator++)
-    {
-      trackedFrame->SetCustomFrameField((*fieldIterator).first, (*fieldIterator).second);
-    }
+    trackedFrame->SetCustomFrameFields(currentStreamBufferItem.GetCustomFrameFields());
 
     // Add tracked frame to the list
     if (aTrackedFrameList->TakeTrackedFrame(trackedFrame, vtkPlusTrackedFrameList::SKIP_INVALID_FRAME) != PLUS_SUCCESS)
@@ -691,6 +709,10 @@ PlusStatus vtkPlusDataCollector::AddDevice(vtkPlusDevice* aDevice)
   }
 
   aDevice->SetDataCollector(this);
+  if (this->DeviceScheduler != NULL)
+  {
+    aDevice->SetDeviceScheduler(this->DeviceScheduler);
+  }
   Devices.push_back(aDevice);
   return PLUS_SUCCESS;
 }
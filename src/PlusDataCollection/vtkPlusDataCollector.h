@@ -18,6 +18,7 @@ See License.txt for details.
 class PlusTrackedFrame;
 class vtkPlusChannel;
 class vtkPlusDeviceFactory;
+class vtkPlusDeviceScheduler;
 class vtkPlusTrackedFrameList;
 class vtkXMLDataElement;
 
@@ -153,6 +154,9 @@ public:
   /*! Get startup delay in sec to give some time to the buffers for proper initialization */
   vtkGetMacro(StartupDelaySec, double);
 
+  /*! Get the scheduler that updates the devices from shared threads. NULL if each device uses its own thread (DeviceSchedulerNumberOfThreads is not set). */
+  vtkPlusDeviceScheduler* GetDeviceScheduler() const { return this->DeviceScheduler; }
+
 protected:
   vtkPlusDataCollector();
   virtual ~vtkPlusDataCollector();
@@ -162,6 +166,9 @@ protected:
 
   vtkSmartPointer<vtkPlusDeviceFactory> DeviceFactory;
 
+  /*! Optional, if set then polling devices are updated from a shared pool of threads */
+  vtkSmartPointer<vtkPlusDeviceScheduler> DeviceScheduler;
+
   DeviceCollection Devices;
 
   bool Connected;
@@ -378,6 +378,10 @@ PlusStatus vtkPlusDataSource::ReadConfiguration(vtkXMLDataElement* sourceElement
     LOG_DEBUG("AveragedItemsForFiltering is not defined in source element \"" << this->GetId() << "\". Using default value: " << this->GetBuffer()->GetAveragedItemsForFiltering());
   }
 
+  bool robustTimestampFiltering = this->GetBuffer()->GetRobustTimestampFiltering();
+  XML_READ_BOOL_ATTRIBUTE_NONMEMBER_OPTIONAL(RobustTimestampFiltering, robustTimestampFiltering, sourceElement);
+  this->GetBuffer()->SetRobustTimestampFiltering(robustTimestampFiltering);
+
   std::string descName;
   if (!aDescriptiveNameForBuffer.empty())
   {
@@ -439,6 +443,11 @@ PlusStatus vtkPlusDataSource::WriteConfiguration(vtkXMLDataElement* aSourceEleme
     aSourceElement->SetIntAttribute("AveragedItemsForFiltering", this->GetBuffer()->GetAveragedItemsForFiltering());
   }
 
+  if (aSourceElement->GetAttribute("RobustTimestampFiltering") != NULL)
+  {
+    XML_WRITE_BOOL_ATTRIBUTE_NONMEMBER(RobustTimestampFiltering, this->GetBuffer()->GetRobustTimestampFiltering(), aSourceElement);
+  }
+
   // Write custom properties
   if (this->CustomProperties.size() > 0)
   {
@@ -528,6 +537,12 @@ PlusStatus vtkPlusDataSource::AddItem(const PlusVideoFrame* frame, long frameNum
   return this->GetBuffer()->AddItem(frame, frameNumber, this->ClipRectangleOrigin, this->ClipRectangleSize, unfilteredTimestamp, filteredTimestamp, customFields);
 }
 
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusDataSource::AddItemAdoptFrame(PlusVideoFrame& frame, long frameNumber, double unfilteredTimestamp/*=UNDEFINED_TIMESTAMP*/, double filteredTimestamp/*=UNDEFINED_TIMESTAMP*/, const PlusTrackedFrame::FieldMapType* customFields /*= NULL*/)
+{
+  return this->GetBuffer()->AddItemAdoptFrame(frame, frameNumber, this->ClipRectangleOrigin, this->ClipRectangleSize, unfilteredTimestamp, filteredTimestamp, customFields);
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusDataSource::AddItem(void* imageDataPtr, US_IMAGE_ORIENTATION usImageOrientation, const int frameSizeInPx[3], PlusCommon::VTKScalarPixelType pixelType,
                                       int numberOfScalarComponents, US_IMAGE_TYPE imageType, int numberOfBytesToSkip, long frameNumber, double unfilteredTimestamp/*=UNDEFINED_TIMESTAMP*/,
@@ -794,6 +809,12 @@ ItemStatus vtkPlusDataSource::GetItemUidFromTime(double time, BufferItemUidType&
   return this->GetBuffer()->GetItemUidFromTime(time, uid);
 }
 
+//-----------------------------------------------------------------------------
+ItemStatus vtkPlusDataSource::GetItemUidsFromTimeRange(double timestampFrom, double timestampTo, std::vector<BufferItemUidType>& uids, std::vector<double>& timestamps)
+{
+  return this->GetBuffer()->GetItemUidsFromTimeRange(timestampFrom, timestampTo, uids, timestamps);
+}
+
 //-----------------------------------------------------------------------------
 bool vtkPlusDataSource::GetLatestItemHasValidVideoData()
 {
@@ -836,6 +857,12 @@ ItemStatus vtkPlusDataSource::GetStreamBufferItemFromTime(double time, StreamBuf
   return this->GetBuffer()->GetStreamBufferItemFromTime(time, bufferItem, interpolation);
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataSource::GetStreamBufferItemsFromTimes(const std::vector<double>& timestamps, std::vector<StreamBufferItem>& items, std::vector<ItemStatus>& itemStatuses, vtkPlusBuffer::DataItemTemporalInterpolationType interpolation)
+{
+  return this->GetBuffer()->GetStreamBufferItemsFromTimes(timestamps, items, itemStatuses, interpolation);
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDataSource::ModifyBufferItemFrameField(BufferItemUidType uid, const std::string& key, const std::string& value)
 {
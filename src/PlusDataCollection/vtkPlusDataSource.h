@@ -122,6 +122,8 @@ public:
   virtual BufferItemUidType GetOldestItemUidInBuffer();
   virtual BufferItemUidType GetLatestItemUidInBuffer();
   virtual ItemStatus GetItemUidFromTime(double time, BufferItemUidType& uid);
+  /*! Get the UID and timestamp of all items that were acquired in the specified time range (see vtkPlusBuffer::GetItemUidsFromTimeRange) */
+  virtual ItemStatus GetItemUidsFromTimeRange(double timestampFrom, double timestampTo, std::vector<BufferItemUidType>& uids, std::vector<double>& timestamps);
 
   /*! Returns true if the latest item contains valid video data */
   virtual bool GetLatestItemHasValidVideoData();
@@ -140,6 +142,8 @@ public:
   virtual ItemStatus GetOldestStreamBufferItem(StreamBufferItem* bufferItem);
   /*! Get a frame that was acquired at the specified time from buffer */
   virtual ItemStatus GetStreamBufferItemFromTime(double time, StreamBufferItem* bufferItem, vtkPlusBuffer::DataItemTemporalInterpolationType interpolation);
+  /*! Get frames for multiple timestamps, locking the buffer only once (see vtkPlusBuffer::GetStreamBufferItemsFromTimes) */
+  virtual PlusStatus GetStreamBufferItemsFromTimes(const std::vector<double>& timestamps, std::vector<StreamBufferItem>& items, std::vector<ItemStatus>& itemStatuses, vtkPlusBuffer::DataItemTemporalInterpolationType interpolation);
   /*! Update a field in the specified stream buffer item */
   virtual PlusStatus ModifyBufferItemFrameField(BufferItemUidType uid, const std::string& key, const std::string& value);
 
@@ -200,6 +204,13 @@ public:
   virtual PlusStatus AddItem(const PlusVideoFrame* frame, long frameNumber, double unfilteredTimestamp = UNDEFINED_TIMESTAMP,
                              double filteredTimestamp = UNDEFINED_TIMESTAMP, const PlusTrackedFrame::FieldMapType* customFields = NULL);
 
+  /*!
+    Add a frame plus a timestamp to the buffer with frame index, by swapping the pixel buffer of the frame with the buffer item's pixel buffer.
+    After the call the frame holds a recycled pixel buffer with the buffer's frame geometry (see vtkPlusBuffer::AddItemAdoptFrame).
+  */
+  virtual PlusStatus AddItemAdoptFrame(PlusVideoFrame& frame, long frameNumber, double unfilteredTimestamp = UNDEFINED_TIMESTAMP,
+                                       double filteredTimestamp = UNDEFINED_TIMESTAMP, const PlusTrackedFrame::FieldMapType* customFields = NULL);
+
   /*!
     Add a frame plus a timestamp to the buffer with frame index.
     Additionally an optional field name&value can be added,
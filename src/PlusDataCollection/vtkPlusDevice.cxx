@@ -6,10 +6,12 @@ See License.txt for details.
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusPerformanceStatistics.h"
 #include "vtkPlusBuffer.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
 #include "vtkPlusDevice.h"
+#include "vtkPlusDeviceScheduler.h"
 #include "vtkPlusRecursiveCriticalSection.h"
 #include "vtkPlusSequenceIO.h"
 #include "vtkPlusTrackedFrameList.h"
@@ -120,6 +122,14 @@ vtkPlusDevice::vtkPlusDevice()
   , Connected(0)
   , Threader(vtkMultiThreader::New())
   , ThreadId(-1)
+  , DeviceScheduler(NULL)
+  , InternalUpdateStartTimes(FRAME_RATE_AVERAGING, 0.0)
+  , InternalUpdateCount(0)
+  , InternalUpdateDurationStatistics(NULL)
+  , InternalUpdatePeriodStatistics(NULL)
+  , AdaptiveAcquisitionRate(false)
+  , PollPhaseErrorStatistics(NULL)
+  , EmptyPollStatistics(NULL)
   , CurrentStreamBufferItem(new StreamBufferItem())
   , ToolReferenceFrameName("")
   , DeviceId("")
@@ -134,6 +144,7 @@ vtkPlusDevice::vtkPlusDevice()
   , OutputNeedsInitialization(1)
   , CorrectlyConfigured(true)
   , StartThreadForInternalUpdates(false)
+  , WaitBetweenInternalUpdates(true)
   , LocalTimeOffsetSec(0.0)
   , MissingInputGracePeriodSec(0.0)
   , RequireImageOrientationInConfiguration(false)
@@ -181,6 +192,12 @@ vtkPlusDevice::~vtkPlusDevice()
 
   DELETE_IF_NOT_NULL(this->Threader);
 
+  if (this->DeviceScheduler != NULL)
+  {
+    this->DeviceScheduler->UnRegister(this);
+    this->DeviceScheduler = NULL;
+  }
+
   DELETE_IF_NOT_NULL(this->UpdateMutex);
 
   LOCAL_LOG_TRACE("vtkPlusDevice::~vtkPlusDevice() completed");
@@ -194,6 +211,7 @@ void vtkPlusDevice::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "Connected: " << (this->Connected ? "Yes\n" : "No\n");
   os << indent << "SDK version: " << this->GetSdkVersion() << "\n";
   os << indent << "AcquisitionRate: " << this->AcquisitionRate << "\n";
+  os << indent << "AdaptiveAcquisitionRate: " << (this->AdaptiveAcquisitionRate ? "Yes\n" : "No\n");
   os << indent << "Recording: " << (this->Recording ? "On\n" : "Off\n");
 
   for (ChannelContainerConstIterator it = this->OutputChannels.begin(); it != this->OutputChannels.end(); ++it)
@@ -615,6 +633,21 @@ double vtkPlusDevice::GetInternalUpdateRate() const
   return this->InternalUpdateRate;
 }
 
+//----------------------------------------------------------------------------
+double vtkPlusDevice::GetEstimatedDeliveryRate()
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(this->UpdateMutex);
+  double periodSec = this->PollingCadenceEstimator.GetEstimatedPeriodSec();
+  return periodSec > 0 ? 1.0 / periodSec : 0.0;
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusDevice::GetEstimatedPollPhaseErrorSec()
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(this->UpdateMutex);
+  return this->PollingCadenceEstimator.GetLastPhaseErrorSec();
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusDevice::SetAcquisitionRate(double aRate)
 {
@@ -1057,6 +1090,8 @@ PlusStatus vtkPlusDevice::ReadConfiguration(vtkXMLDataElement* rootXMLElement)
     LOCAL_LOG_DEBUG("Unable to find acquisition rate in device element when it is required, using default " << this->GetAcquisitionRate());
   }
 
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(AdaptiveAcquisitionRate, deviceXMLElement);
+
   vtkXMLDataElement* outputChannelsElement = deviceXMLElement->FindNestedElementWithName("OutputChannels");
   if (outputChannelsElement != NULL)
   {
@@ -1182,6 +1217,15 @@ PlusStatus vtkPlusDevice::WriteConfiguration(vtkXMLDataElement* config)
     deviceDataElement->SetDoubleAttribute("LocalTimeOffsetSec", this->GetLocalTimeOffsetSec());
   }
 
+  if (this->AdaptiveAcquisitionRate)
+  {
+    XML_WRITE_BOOL_ATTRIBUTE(AdaptiveAcquisitionRate, deviceDataElement);
+  }
+  else
+  {
+    XML_REMOVE_ATTRIBUTE(deviceDataElement, "AdaptiveAcquisitionRate");
+  }
+
   return PLUS_SUCCESS;
 }
 
@@ -1265,9 +1309,35 @@ PlusStatus vtkPlusDevice::StartRecording()
 
   if (this->StartThreadForInternalUpdates)
   {
-    this->ThreadId =
-      this->Threader->SpawnThread((vtkThreadFunctionType)\
-                                  &vtkDataCaptureThread, this);
+    std::string statisticsNamePrefix = std::string("Device.") + this->GetDeviceId() + ".";
+    this->InternalUpdateDurationStatistics = PlusPerformanceStatistics::GetInstance()->GetHistogram(statisticsNamePrefix + "InternalUpdateMs");
+    this->InternalUpdatePeriodStatistics = PlusPerformanceStatistics::GetInstance()->GetHistogram(statisticsNamePrefix + "InternalUpdatePeriodMs");
+    this->InternalUpdateStartTimes.assign(FRAME_RATE_AVERAGING, 0.0);
+    this->InternalUpdateCount = 0;
+    this->PollingCadenceEstimator.Reset();
+    if (this->AdaptiveAcquisitionRate)
+    {
+      this->PollPhaseErrorStatistics = PlusPerformanceStatistics::GetInstance()->GetHistogram(statisticsNamePrefix + "PollPhaseErrorMs");
+      this->EmptyPollStatistics = PlusPerformanceStatistics::GetInstance()->GetCounter(statisticsNamePrefix + "EmptyPolls");
+    }
+
+    // Devices that wait for data in InternalUpdate would block the shared threads of the scheduler
+    if (this->DeviceScheduler != NULL && this->WaitBetweenInternalUpdates)
+    {
+      if (this->DeviceScheduler->AddDevice(this) != PLUS_SUCCESS)
+      {
+        LOCAL_LOG_ERROR("Cannot start recording, the device could not be added to the device scheduler");
+        this->Recording = 0;
+        this->InternalStopRecording();
+        return PLUS_FAIL;
+      }
+    }
+    else
+    {
+      this->ThreadId =
+        this->Threader->SpawnThread((vtkThreadFunctionType)\
+                                    &vtkDataCaptureThread, this);
+    }
   }
 
   this->Modified();
@@ -1291,6 +1361,12 @@ PlusStatus vtkPlusDevice::StopRecording()
   this->ThreadId = -1;
   this->Recording = 0;
 
+  if (this->DeviceScheduler != NULL && this->DeviceScheduler->IsDeviceScheduled(this))
+  {
+    // Returns after the update in progress (if any) is completed
+    this->DeviceScheduler->RemoveDevice(this);
+  }
+
   if (this->GetStartThreadForInternalUpdates())
   {
     LOCAL_LOG_DEBUG("Wait for internal update thread to terminate");
@@ -1321,44 +1397,137 @@ void* vtkPlusDevice::vtkDataCaptureThread(vtkMultiThreader::ThreadInfo* data)
   vtkPlusDevice* self = (vtkPlusDevice*)(data->UserData);
 
   double rate = self->GetAcquisitionRate();
-  double currtime[FRAME_RATE_AVERAGING] = {0};
-  unsigned long updatecount = 0;
   self->ThreadAlive = true;
 
   while (self->IsRecording() && self->GetCorrectlyConfigured())
   {
     double newtime = vtkPlusAccurateTimer::GetSystemTime();
-    // get current tracking rate over last few updates
-    double difftime = newtime - currtime[updatecount % FRAME_RATE_AVERAGING];
-    currtime[updatecount % FRAME_RATE_AVERAGING] = newtime;
-    if (updatecount > FRAME_RATE_AVERAGING && difftime != 0)
+    if (self->ExecuteInternalUpdate(newtime) != PLUS_SUCCESS)
     {
-      self->InternalUpdateRate = (FRAME_RATE_AVERAGING / difftime);
+      // recording has been stopped
+      break;
     }
 
+    if (self->WaitBetweenInternalUpdates)
     {
-      // Lock before update
-      PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(self->UpdateMutex);
-      if (!self->Recording)
+      double delay = (self->GetNextInternalUpdateTime(newtime, 1.0 / rate) - vtkPlusAccurateTimer::GetSystemTime());
+      if (delay > 0)
       {
-        // recording has been stopped
-        break;
+        vtkPlusAccurateTimer::Delay(delay);
       }
-      self->InternalUpdate();
-      self->UpdateTime.Modified();
     }
+  }
+
+  self->ThreadAlive = false;
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDevice::ExecuteInternalUpdate(double updateStartTime)
+{
+  // get current update rate over last few updates
+  int averagingIndex = this->InternalUpdateCount % FRAME_RATE_AVERAGING;
+  double difftime = updateStartTime - this->InternalUpdateStartTimes[averagingIndex];
+  if (this->InternalUpdateCount > FRAME_RATE_AVERAGING && difftime != 0)
+  {
+    this->InternalUpdateRate = (FRAME_RATE_AVERAGING / difftime);
+  }
+  if (this->InternalUpdateCount > 0 && this->InternalUpdatePeriodStatistics != NULL)
+  {
+    double previousUpdateTime = this->InternalUpdateStartTimes[(this->InternalUpdateCount - 1) % FRAME_RATE_AVERAGING];
+    this->InternalUpdatePeriodStatistics->AddSample((updateStartTime - previousUpdateTime) * 1000.0);
+  }
+  this->InternalUpdateStartTimes[averagingIndex] = updateStartTime;
+  this->InternalUpdateCount++;
+
+  // Lock before update
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(this->UpdateMutex);
+  if (!this->Recording)
+  {
+    // recording has been stopped
+    return PLUS_FAIL;
+  }
+  {
+    PlusPerformanceScopedTimer internalUpdateTimer(this->InternalUpdateDurationStatistics);
+    this->InternalUpdate();
+  }
+  this->UpdateTime.Modified();
+  if (this->AdaptiveAcquisitionRate)
+  {
+    this->UpdatePollingCadence(updateStartTime);
+  }
+  return PLUS_SUCCESS;
+}
 
-    double delay = (newtime + 1.0 / rate - vtkPlusAccurateTimer::GetSystemTime());
-    if (delay > 0)
+//----------------------------------------------------------------------------
+void vtkPlusDevice::UpdatePollingCadence(double pollTime)
+{
+  vtkPlusDataSource* cadenceSource = NULL;
+  if (!this->VideoSources.empty())
+  {
+    cadenceSource = this->VideoSources.begin()->second;
+  }
+  else if (!this->Tools.empty())
+  {
+    cadenceSource = this->Tools.begin()->second;
+  }
+  if (cadenceSource == NULL || cadenceSource->GetNumberOfItems() < 1)
+  {
+    return;
+  }
+
+  BufferItemUidType latestItemUid = cadenceSource->GetLatestItemUidInBuffer();
+  double latestItemTimestamp = 0;
+  if (cadenceSource->GetTimeStamp(latestItemUid, latestItemTimestamp) != ITEM_OK)
+  {
+    return;
+  }
+
+  if (this->PollingCadenceEstimator.Update(pollTime, latestItemUid, latestItemTimestamp))
+  {
+    if (this->PollingCadenceEstimator.IsLocked() && this->PollPhaseErrorStatistics != NULL)
     {
-      vtkPlusAccurateTimer::Delay(delay);
+      this->PollPhaseErrorStatistics->AddSample(this->PollingCadenceEstimator.GetLastPhaseErrorSec() * 1000.0);
     }
+  }
+  else if (this->EmptyPollStatistics != NULL)
+  {
+    this->EmptyPollStatistics->Increment();
+  }
+}
 
-    updatecount++;
+//----------------------------------------------------------------------------
+double vtkPlusDevice::GetNextInternalUpdateTime(double updateStartTime, double periodSec)
+{
+  if (!this->AdaptiveAcquisitionRate)
+  {
+    return updateStartTime + periodSec;
   }
+  return this->PollingCadenceEstimator.GetNextPollTime(updateStartTime, periodSec);
+}
 
-  self->ThreadAlive = false;
-  return NULL;
+//----------------------------------------------------------------------------
+void vtkPlusDevice::SetDeviceScheduler(vtkPlusDeviceScheduler* scheduler)
+{
+  if (this->DeviceScheduler == scheduler)
+  {
+    return;
+  }
+  if (this->Recording)
+  {
+    LOCAL_LOG_ERROR("The device scheduler cannot be changed while the device is recording");
+    return;
+  }
+  if (this->DeviceScheduler != NULL)
+  {
+    this->DeviceScheduler->UnRegister(this);
+  }
+  this->DeviceScheduler = scheduler;
+  if (this->DeviceScheduler != NULL)
+  {
+    this->DeviceScheduler->Register(this);
+  }
+  this->Modified();
 }
 
 //----------------------------------------------------------------------------
@@ -2064,6 +2233,12 @@ bool vtkPlusDevice::GetStartThreadForInternalUpdates() const
   return this->StartThreadForInternalUpdates;
 }
 
+//----------------------------------------------------------------------------
+bool vtkPlusDevice::GetWaitBetweenInternalUpdates() const
+{
+  return this->WaitBetweenInternalUpdates;
+}
+
 //----------------------------------------------------------------------------
 double vtkPlusDevice::GetRecordingStartTime() const
 {
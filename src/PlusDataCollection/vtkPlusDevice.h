@@ -9,6 +9,7 @@ See License.txt for details.
 
 #include "PlusCommon.h"
 #include "PlusConfigure.h"
+#include "PlusPollingCadenceEstimator.h"
 #include "PlusStreamBufferItem.h"
 #include "PlusTrackedFrame.h"
 #include "vtkImageAlgorithm.h"
@@ -23,6 +24,9 @@ class vtkPlusBuffer;
 class vtkPlusDataCollector;
 class vtkPlusDataSource;
 class vtkPlusDevice;
+class vtkPlusDeviceScheduler;
+class PlusPerformanceCounter;
+class PlusPerformanceHistogram;
 class vtkPlusHTMLGenerator;
 class vtkXMLDataElement;
 
@@ -155,6 +159,21 @@ public:
   /*! Get the internal update rate for this tracking system.  This is the number of buffer entry items sent by the device per second (per tool). */
   double GetInternalUpdateRate() const;
 
+  /*!
+  Enable adaptive polling. Instead of calling InternalUpdate() at AcquisitionRate, the device is polled right after new data
+  is expected to be available, as learned from the timestamps of the acquired items (see PlusPollingCadenceEstimator).
+  AcquisitionRate is used until the delivery period is learned. Devices that timestamp their items when they are polled keep being polled at the learned rate. Only used if StartThreadForInternalUpdates and WaitBetweenInternalUpdates are enabled.
+  */
+  vtkSetMacro(AdaptiveAcquisitionRate, bool);
+  vtkGetMacro(AdaptiveAcquisitionRate, bool);
+  vtkBooleanMacro(AdaptiveAcquisitionRate, bool);
+
+  /*! Number of items delivered by the device per second, as estimated by adaptive polling. 0 if not known yet. */
+  double GetEstimatedDeliveryRate();
+
+  /*! Delay between the availability of the latest item and the poll that retrieved it, as estimated by adaptive polling */
+  double GetEstimatedPollPhaseErrorSec();
+
   /*! Get the data source object for the specified Id name, checks both video and tools */
   PlusStatus GetDataSource(const char* aSourceId, vtkPlusDataSource*& aSource);
   PlusStatus GetDataSource(const std::string& aSourceId, vtkPlusDataSource*& aSource);
@@ -245,6 +264,13 @@ public:
   /*! Set the parent data collector */
   virtual void SetDataCollector(vtkPlusDataCollector* _arg);
 
+  /*!
+  Set the scheduler that calls InternalUpdate() from a shared pool of threads instead of a data capture thread of the device.
+  Only used if StartThreadForInternalUpdates and WaitBetweenInternalUpdates are enabled. Cannot be changed while recording.
+  */
+  virtual void SetDeviceScheduler(vtkPlusDeviceScheduler* scheduler);
+  vtkGetObjectMacro(DeviceScheduler, vtkPlusDeviceScheduler);
+
   /*! Set buffer size of all available tools */
   void SetToolsBufferSize(int aBufferSize);
 
@@ -260,7 +286,8 @@ public:
   in this function. It should call ToolUpdate() for each tool.
   Note that vtkPlusDevice.cxx starts up a separate thread after
   InternalStartRecording() is called, and that InternalUpdate() is
-  called repeatedly from within that thread.  Therefore, any code
+  called repeatedly from within that thread (or from the threads of
+  the device scheduler).  Therefore, any code
   within InternalUpdate() must be thread safe.  You can temporarily
   pause the thread by locking this->UpdateMutex->Lock() e.g. if you
   need to communicate with the device from outside of InternalUpdate().
@@ -451,6 +478,19 @@ public:
 protected:
   static void* vtkDataCaptureThread(vtkMultiThreader::ThreadInfo* data);
 
+  /*!
+  Call InternalUpdate() once while holding the update mutex and record the update rate and duration.
+  Used by the data capture thread and the device scheduler. Returns PLUS_FAIL if recording has been stopped.
+  */
+  PlusStatus ExecuteInternalUpdate(double updateStartTime);
+  friend class vtkPlusDeviceScheduler;
+
+  /*! Start time of the InternalUpdate() call that follows the one started at updateStartTime (updateStartTime + periodSec, unless adaptive polling is enabled) */
+  double GetNextInternalUpdateTime(double updateStartTime, double periodSec);
+
+  /*! Pass the latest item of the first video source (or tool, if there is no video source) to the polling cadence estimator */
+  void UpdatePollingCadence(double pollTime);
+
   /*! Should be overridden to connect to the hardware */
   virtual PlusStatus InternalConnect() { return PLUS_SUCCESS; }
 
@@ -529,6 +569,9 @@ protected:
   vtkSetMacro(StartThreadForInternalUpdates, bool);
   bool GetStartThreadForInternalUpdates() const;
 
+  vtkSetMacro(WaitBetweenInternalUpdates, bool);
+  bool GetWaitBetweenInternalUpdates() const;
+
   vtkSetMacro(RecordingStartTime, double);
   double GetRecordingStartTime() const;
 
@@ -552,6 +595,20 @@ protected:
   /*! Recording thread id */
   int ThreadId;
 
+  /*! Scheduler that calls InternalUpdate instead of the recording thread, if set */
+  vtkPlusDeviceScheduler* DeviceScheduler;
+
+  /*! Start times of the last few internal updates, for computing InternalUpdateRate */
+  std::vector<double> InternalUpdateStartTimes;
+  unsigned long InternalUpdateCount;
+  PlusPerformanceHistogram* InternalUpdateDurationStatistics;
+  PlusPerformanceHistogram* InternalUpdatePeriodStatistics;
+
+  bool AdaptiveAcquisitionRate;
+  PlusPollingCadenceEstimator PollingCadenceEstimator;
+  PlusPerformanceHistogram* PollPhaseErrorStatistics;
+  PlusPerformanceCounter* EmptyPollStatistics;
+
   ChannelContainer  OutputChannels;
   ChannelContainer  InputChannels;
 
@@ -596,6 +653,13 @@ protected:
   */
   bool StartThreadForInternalUpdates;
 
+  /*!
+  If enabled (default), then the data capture thread waits after each InternalUpdate call so that InternalUpdate is called
+  at the acquisition rate. Devices that wait for new data in InternalUpdate (e.g., on a socket with a timeout) should disable it,
+  so that data is processed as soon as it arrives.
+  */
+  bool WaitBetweenInternalUpdates;
+
   /*! Value to use when mixing data with another temporally calibrated device*/
   double LocalTimeOffsetSec;
 
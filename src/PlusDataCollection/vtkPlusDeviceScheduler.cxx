@@ -0,0 +1,497 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusPerformanceStatistics.h"
+#include "vtkPlusDevice.h"
+#include "vtkPlusDeviceScheduler.h"
+
+// VTK includes
+#include <vtkMultiThreader.h>
+#include <vtkObjectFactory.h>
+
+// STL includes
+#include <algorithm>
+#include <chrono>
+
+//----------------------------------------------------------------------------
+
+vtkStandardNewMacro(vtkPlusDeviceScheduler);
+
+namespace
+{
+  const int DEFAULT_NUMBER_OF_THREADS = 2;
+}
+
+//----------------------------------------------------------------------------
+vtkPlusDeviceScheduler::ScheduledDevice::ScheduledDevice()
+  : DeadlineSec(0.0)
+  , NominalDeadlineSec(0.0)
+  , DependencyLevel(0)
+  , QueueSequence(0)
+  , Queued(false)
+  , UpdateInProgress(false)
+  , InputsUpdated(false)
+  , InputsUpdatedTimeSec(0.0)
+  , JitterStatistics(NULL)
+  , OverrunStatistics(NULL)
+{
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusDeviceScheduler::QueueKey::operator<(const QueueKey& other) const
+{
+  if (this->DeadlineSec != other.DeadlineSec)
+  {
+    return this->DeadlineSec < other.DeadlineSec;
+  }
+  if (this->DependencyLevel != other.DependencyLevel)
+  {
+    return this->DependencyLevel < other.DependencyLevel;
+  }
+  return this->QueueSequence < other.QueueSequence;
+}
+
+//----------------------------------------------------------------------------
+vtkPlusDeviceScheduler::vtkPlusDeviceScheduler()
+  : NumberOfThreads(DEFAULT_NUMBER_OF_THREADS)
+  , NextQueueSequence(0)
+  , StopRequested(false)
+  , Threader(vtkMultiThreader::New())
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusDeviceScheduler::~vtkPlusDeviceScheduler()
+{
+  this->StopWorkers();
+
+  // Devices that were not removed (their recording was not stopped) are not updated anymore
+  for (ScheduledDeviceMapType::iterator it = this->ScheduledDevices.begin(); it != this->ScheduledDevices.end(); ++it)
+  {
+    LOG_WARNING("Device " << it->first->GetDeviceId() << " is still scheduled when the device scheduler is deleted");
+    it->first->UnRegister(this);
+  }
+  this->ScheduledDevices.clear();
+  this->Queue.clear();
+
+  DELETE_IF_NOT_NULL(this->Threader);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDeviceScheduler::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  os << indent << "NumberOfScheduledDevices: " << this->ScheduledDevices.size() << "\n";
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDeviceScheduler::SetNumberOfThreads(int numberOfThreads)
+{
+  if (numberOfThreads < 1)
+  {
+    LOG_ERROR("Invalid number of device scheduler threads: " << numberOfThreads << ". At least one thread is required.");
+    return PLUS_FAIL;
+  }
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  if (!this->WorkerThreadIds.empty())
+  {
+    LOG_ERROR("The number of device scheduler threads cannot be changed after the scheduler has been started");
+    return PLUS_FAIL;
+  }
+  this->NumberOfThreads = numberOfThreads;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusDeviceScheduler::GetNumberOfThreads() const
+{
+  return this->NumberOfThreads;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDeviceScheduler::AddDevice(vtkPlusDevice* device)
+{
+  if (device == NULL)
+  {
+    LOG_ERROR("vtkPlusDeviceScheduler::AddDevice failed: invalid device");
+    return PLUS_FAIL;
+  }
+  if (device->GetAcquisitionRate() <= 0)
+  {
+    LOG_WARNING("Device " << device->GetDeviceId() << " has an invalid acquisition rate (" << device->GetAcquisitionRate()
+                << "), it is updated at " << vtkPlusDevice::VIRTUAL_DEVICE_FRAME_RATE << " fps");
+  }
+
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  if (this->ScheduledDevices.find(device) != this->ScheduledDevices.end())
+  {
+    LOG_DEBUG("Device " << device->GetDeviceId() << " is already scheduled");
+    return PLUS_SUCCESS;
+  }
+
+  device->Register(this);
+  ScheduledDevice& scheduledDevice = this->ScheduledDevices[device];
+  std::string statisticsNamePrefix = std::string("Device.") + device->GetDeviceId() + ".";
+  scheduledDevice.JitterStatistics = PlusPerformanceStatistics::GetInstance()->GetHistogram(statisticsNamePrefix + "SchedulerJitterMs");
+  scheduledDevice.OverrunStatistics = PlusPerformanceStatistics::GetInstance()->GetCounter(statisticsNamePrefix + "SchedulerOverruns");
+
+  this->UpdateDependencies();
+  this->Enqueue(device, scheduledDevice, vtkPlusAccurateTimer::GetSystemTime());
+
+  if (this->WorkerThreadIds.empty())
+  {
+    this->StartWorkers();
+  }
+  this->QueueChanged.notify_all();
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDeviceScheduler::RemoveDevice(vtkPlusDevice* device)
+{
+  bool removedDuringOwnUpdate(false);
+  {
+    std::unique_lock<std::mutex> lock(this->Mutex);
+    ScheduledDeviceMapType::iterator scheduledDeviceIt = this->ScheduledDevices.find(device);
+    if (scheduledDeviceIt == this->ScheduledDevices.end())
+    {
+      LOG_DEBUG("vtkPlusDeviceScheduler::RemoveDevice: device is not scheduled");
+      return PLUS_SUCCESS;
+    }
+    this->Dequeue(device, scheduledDeviceIt->second);
+
+    // Wait for the completion of the update in progress, unless the device is removed from its own update
+    while (scheduledDeviceIt->second.UpdateInProgress && scheduledDeviceIt->second.UpdateThreadId != std::this_thread::get_id())
+    {
+      this->QueueChanged.wait(lock);
+    }
+
+    // The update in progress still uses the device, the worker thread releases the device when the update returns
+    removedDuringOwnUpdate = scheduledDeviceIt->second.UpdateInProgress;
+    if (removedDuringOwnUpdate)
+    {
+      this->DevicesRemovedDuringUpdate.push_back(device);
+    }
+
+    this->ScheduledDevices.erase(scheduledDeviceIt);
+    this->UpdateDependencies();
+    this->QueueChanged.notify_all();
+  }
+
+  if (!removedDuringOwnUpdate)
+  {
+    device->UnRegister(this);
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusDeviceScheduler::IsDeviceScheduled(vtkPlusDevice* device)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->ScheduledDevices.find(device) != this->ScheduledDevices.end();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDeviceScheduler::StartWorkers()
+{
+  this->StopRequested = false;
+  for (int i = 0; i < this->NumberOfThreads; ++i)
+  {
+    this->WorkerThreadIds.push_back(this->Threader->SpawnThread((vtkThreadFunctionType)&WorkerThread, this));
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDeviceScheduler::StopWorkers()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->StopRequested = true;
+    this->QueueChanged.notify_all();
+  }
+  // TerminateThread waits for the completion of the thread function
+  for (std::vector<int>::iterator it = this->WorkerThreadIds.begin(); it != this->WorkerThreadIds.end(); ++it)
+  {
+    this->Threader->TerminateThread(*it);
+  }
+  this->WorkerThreadIds.clear();
+}
+
+//----------------------------------------------------------------------------
+void* vtkPlusDeviceScheduler::WorkerThread(void* data)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(data);
+  vtkPlusDeviceScheduler* self = static_cast<vtkPlusDeviceScheduler*>(threadInfo->UserData);
+  self->RunWorker();
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDeviceScheduler::RunWorker()
+{
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  while (!this->StopRequested)
+  {
+    double currentTimeSec = vtkPlusAccurateTimer::GetSystemTime();
+    double nextDeadlineSec = -1.0;
+    vtkPlusDevice* device = this->GetNextReadyDevice(currentTimeSec, nextDeadlineSec);
+    if (device == NULL)
+    {
+      if (nextDeadlineSec < 0)
+      {
+        // Nothing to do until a device is added or an update completes
+        this->QueueChanged.wait(lock);
+      }
+      else
+      {
+        this->QueueChanged.wait_for(lock, std::chrono::duration<double>(nextDeadlineSec - currentTimeSec));
+      }
+      continue;
+    }
+
+    ScheduledDevice& scheduledDevice = this->ScheduledDevices[device];
+    this->Dequeue(device, scheduledDevice);
+    scheduledDevice.UpdateInProgress = true;
+    scheduledDevice.UpdateThreadId = std::this_thread::get_id();
+    const double deadlineSec = scheduledDevice.DeadlineSec;
+    const double nominalDeadlineSec = scheduledDevice.NominalDeadlineSec;
+    const double jitterReferenceSec = (scheduledDevice.InputsUpdated ? scheduledDevice.InputsUpdatedTimeSec : deadlineSec);
+    scheduledDevice.InputsUpdated = false;
+    PlusPerformanceHistogram* jitterStatistics = scheduledDevice.JitterStatistics;
+    PlusPerformanceCounter* overrunStatistics = scheduledDevice.OverrunStatistics;
+
+    // The device is registered by the scheduler, so it cannot be deleted while its update is in progress
+    lock.unlock();
+
+    const double updateStartTimeSec = vtkPlusAccurateTimer::GetSystemTime();
+    jitterStatistics->AddSample(std::max(0.0, updateStartTimeSec - jitterReferenceSec) * 1000.0);
+    bool continueUpdates = device->IsRecording() && device->GetCorrectlyConfigured()
+                           && device->ExecuteInternalUpdate(updateStartTimeSec) == PLUS_SUCCESS;
+    const double acquisitionRate = device->GetAcquisitionRate();
+    const double periodSec = 1.0 / (acquisitionRate > 0 ? acquisitionRate : vtkPlusDevice::VIRTUAL_DEVICE_FRAME_RATE);
+    // Adaptive polling devices compute their next update time from the time of the actual update
+    const bool adaptiveAcquisitionRate = device->GetAdaptiveAcquisitionRate();
+    const double nextNominalDeadlineSec = adaptiveAcquisitionRate
+                                          ? device->GetNextInternalUpdateTime(updateStartTimeSec, periodSec)
+                                          : device->GetNextInternalUpdateTime(nominalDeadlineSec, periodSec);
+    const double updateEndTimeSec = vtkPlusAccurateTimer::GetSystemTime();
+
+    lock.lock();
+    std::vector<vtkPlusDevice*>::iterator removedDeviceIt = std::find(this->DevicesRemovedDuringUpdate.begin(), this->DevicesRemovedDuringUpdate.end(), device);
+    if (removedDeviceIt != this->DevicesRemovedDuringUpdate.end())
+    {
+      // The device removed itself during the update, release it now that the update is completed (this may delete the device)
+      this->DevicesRemovedDuringUpdate.erase(removedDeviceIt);
+      this->QueueChanged.notify_all();
+      lock.unlock();
+      device->UnRegister(this);
+      lock.lock();
+      continue;
+    }
+    ScheduledDeviceMapType::iterator scheduledDeviceIt = this->ScheduledDevices.find(device);
+    if (scheduledDeviceIt == this->ScheduledDevices.end())
+    {
+      // Cannot happen: RemoveDevice called from another thread waits for the completion of the update
+      this->QueueChanged.notify_all();
+      continue;
+    }
+    scheduledDeviceIt->second.UpdateInProgress = false;
+
+    if (continueUpdates)
+    {
+      // Keep the phase of the updates, but do not try to catch up with missed deadlines.
+      // An adaptive polling device may ask to be polled again right away (e.g., if its data is late), which is not an overrun:
+      // its update overruns only if it takes longer than its acquisition period.
+      const double overrunTimeSec = (adaptiveAcquisitionRate ? updateStartTimeSec + periodSec : nextNominalDeadlineSec);
+      if (updateEndTimeSec > overrunTimeSec)
+      {
+        overrunStatistics->Increment();
+      }
+      const double nextDeadlineSec = std::max(nextNominalDeadlineSec, updateEndTimeSec);
+      this->Enqueue(device, scheduledDeviceIt->second, nextDeadlineSec);
+
+      // Update the devices that use this device as input now, if they are due soon anyway.
+      // The completed deadline of this device is used as their deadline, which puts them in the queue before the next update of this device.
+      for (std::vector<vtkPlusDevice*>::iterator dependentIt = scheduledDeviceIt->second.DependentDevices.begin();
+           dependentIt != scheduledDeviceIt->second.DependentDevices.end(); ++dependentIt)
+      {
+        ScheduledDevice& dependentDevice = this->ScheduledDevices[*dependentIt];
+        if (!dependentDevice.Queued)
+        {
+          continue;
+        }
+        const double dependentAcquisitionRate = (*dependentIt)->GetAcquisitionRate();
+        const double dependentPeriodSec = 1.0 / (dependentAcquisitionRate > 0 ? dependentAcquisitionRate : vtkPlusDevice::VIRTUAL_DEVICE_FRAME_RATE);
+        if (updateEndTimeSec >= dependentDevice.DeadlineSec - 0.5 * dependentPeriodSec)
+        {
+          dependentDevice.InputsUpdated = true;
+          dependentDevice.InputsUpdatedTimeSec = updateEndTimeSec;
+          if (deadlineSec < dependentDevice.DeadlineSec)
+          {
+            // The next deadlines are still computed from the nominal deadline to keep the update rate
+            const double dependentNominalDeadlineSec = dependentDevice.NominalDeadlineSec;
+            this->Enqueue(*dependentIt, dependentDevice, deadlineSec);
+            dependentDevice.NominalDeadlineSec = dependentNominalDeadlineSec;
+          }
+        }
+      }
+    }
+
+    this->QueueChanged.notify_all();
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkPlusDevice* vtkPlusDeviceScheduler::GetNextReadyDevice(double currentTimeSec, double& nextDeadlineSec)
+{
+  nextDeadlineSec = -1.0;
+  for (std::set<QueueKey>::const_iterator it = this->Queue.begin(); it != this->Queue.end(); ++it)
+  {
+    if (it->DeadlineSec > currentTimeSec)
+    {
+      // None of the following devices are due yet
+      nextDeadlineSec = it->DeadlineSec;
+      return NULL;
+    }
+    const ScheduledDevice& scheduledDevice = this->ScheduledDevices[it->Device];
+    if (scheduledDevice.InputsUpdated || !this->IsAnyInputPending(scheduledDevice, currentTimeSec))
+    {
+      return it->Device;
+    }
+  }
+  // All the due devices wait for their inputs
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusDeviceScheduler::IsAnyInputPending(const ScheduledDevice& scheduledDevice, double currentTimeSec)
+{
+  for (std::vector<vtkPlusDevice*>::const_iterator it = scheduledDevice.InputDevices.begin(); it != scheduledDevice.InputDevices.end(); ++it)
+  {
+    const ScheduledDevice& inputDevice = this->ScheduledDevices[*it];
+    if (inputDevice.UpdateInProgress || (inputDevice.Queued && inputDevice.DeadlineSec <= currentTimeSec))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDeviceScheduler::Enqueue(vtkPlusDevice* device, ScheduledDevice& scheduledDevice, double deadlineSec)
+{
+  this->Dequeue(device, scheduledDevice);
+  scheduledDevice.DeadlineSec = deadlineSec;
+  scheduledDevice.NominalDeadlineSec = deadlineSec;
+  scheduledDevice.QueueSequence = this->NextQueueSequence++;
+  QueueKey key = { scheduledDevice.DeadlineSec, scheduledDevice.DependencyLevel, scheduledDevice.QueueSequence, device };
+  this->Queue.insert(key);
+  scheduledDevice.Queued = true;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDeviceScheduler::Dequeue(vtkPlusDevice* device, ScheduledDevice& scheduledDevice)
+{
+  if (!scheduledDevice.Queued)
+  {
+    return;
+  }
+  QueueKey key = { scheduledDevice.DeadlineSec, scheduledDevice.DependencyLevel, scheduledDevice.QueueSequence, device };
+  this->Queue.erase(key);
+  scheduledDevice.Queued = false;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDeviceScheduler::UpdateDependencies()
+{
+  // Remove the queue entries, as the dependency levels are part of the queue keys
+  std::vector<vtkPlusDevice*> queuedDevices;
+  for (ScheduledDeviceMapType::iterator it = this->ScheduledDevices.begin(); it != this->ScheduledDevices.end(); ++it)
+  {
+    if (it->second.Queued)
+    {
+      queuedDevices.push_back(it->first);
+      this->Dequeue(it->first, it->second);
+    }
+    it->second.InputDevices.clear();
+    it->second.DependentDevices.clear();
+    it->second.DependencyLevel = -1;
+  }
+
+  // Only the inputs that are updated by this scheduler are taken into account
+  for (ScheduledDeviceMapType::iterator it = this->ScheduledDevices.begin(); it != this->ScheduledDevices.end(); ++it)
+  {
+    std::vector<vtkPlusDevice*> inputDevices;
+    it->first->GetInputDevices(inputDevices);
+    for (std::vector<vtkPlusDevice*>::iterator inputIt = inputDevices.begin(); inputIt != inputDevices.end(); ++inputIt)
+    {
+      if (*inputIt != it->first && this->ScheduledDevices.find(*inputIt) != this->ScheduledDevices.end()
+          && std::find(it->second.InputDevices.begin(), it->second.InputDevices.end(), *inputIt) == it->second.InputDevices.end())
+      {
+        it->second.InputDevices.push_back(*inputIt);
+      }
+    }
+  }
+
+  // Compute the levels, this also removes circular dependencies
+  for (ScheduledDeviceMapType::iterator it = this->ScheduledDevices.begin(); it != this->ScheduledDevices.end(); ++it)
+  {
+    std::set<vtkPlusDevice*> devicesOnPath;
+    this->ComputeDependencyLevel(it->first, devicesOnPath);
+  }
+
+  for (ScheduledDeviceMapType::iterator it = this->ScheduledDevices.begin(); it != this->ScheduledDevices.end(); ++it)
+  {
+    for (std::vector<vtkPlusDevice*>::iterator inputIt = it->second.InputDevices.begin(); inputIt != it->second.InputDevices.end(); ++inputIt)
+    {
+      this->ScheduledDevices[*inputIt].DependentDevices.push_back(it->first);
+    }
+  }
+
+  for (std::vector<vtkPlusDevice*>::iterator it = queuedDevices.begin(); it != queuedDevices.end(); ++it)
+  {
+    ScheduledDevice& scheduledDevice = this->ScheduledDevices[*it];
+    const double nominalDeadlineSec = scheduledDevice.NominalDeadlineSec;
+    this->Enqueue(*it, scheduledDevice, scheduledDevice.DeadlineSec);
+    scheduledDevice.NominalDeadlineSec = nominalDeadlineSec;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusDeviceScheduler::ComputeDependencyLevel(vtkPlusDevice* device, std::set<vtkPlusDevice*>& devicesOnPath)
+{
+  ScheduledDevice& scheduledDevice = this->ScheduledDevices[device];
+  if (scheduledDevice.DependencyLevel >= 0)
+  {
+    return scheduledDevice.DependencyLevel;
+  }
+
+  devicesOnPath.insert(device);
+  int level = 0;
+  std::vector<vtkPlusDevice*>::iterator inputIt = scheduledDevice.InputDevices.begin();
+  while (inputIt != scheduledDevice.InputDevices.end())
+  {
+    if (devicesOnPath.find(*inputIt) != devicesOnPath.end())
+    {
+      LOG_WARNING("Circular dependency between devices " << device->GetDeviceId() << " and " << (*inputIt)->GetDeviceId()
+                  << ", the device scheduler ignores the dependency");
+      inputIt = scheduledDevice.InputDevices.erase(inputIt);
+      continue;
+    }
+    level = std::max(level, this->ComputeDependencyLevel(*inputIt, devicesOnPath) + 1);
+    ++inputIt;
+  }
+  devicesOnPath.erase(device);
+
+  scheduledDevice.DependencyLevel = level;
+  return level;
+}
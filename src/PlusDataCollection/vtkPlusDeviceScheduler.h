@@ -0,0 +1,167 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusDeviceScheduler_h
+#define __vtkPlusDeviceScheduler_h
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusDataCollectionExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STL includes
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+class PlusPerformanceCounter;
+class PlusPerformanceHistogram;
+class vtkMultiThreader;
+class vtkPlusDevice;
+
+/*!
+  \class vtkPlusDeviceScheduler
+  \brief Calls InternalUpdate of multiple devices at their acquisition rate from a small pool of worker threads
+
+  Without a scheduler each device that requires polling (StartThreadForInternalUpdates) runs its own data capture thread
+  that sleeps between the InternalUpdate calls. With many devices (especially virtual devices, such as mixers, switchers,
+  capture devices, processors) these threads wake up independently of each other and compete for the processor.
+
+  The scheduler keeps the devices in a queue ordered by their next update deadline and the worker threads call
+  InternalUpdate of the device that is due. Updates of a device never overlap. If an update ends later than the
+  next deadline of the device then the missed updates are skipped instead of being executed in a burst.
+
+  Devices that use other scheduled devices as inputs are updated right after their inputs: a device is not updated
+  while any of its inputs is being updated or is due, and when an input update completes, the device is updated
+  immediately if its own deadline is less than half of its period away. This keeps the latency of chains of virtual devices low.
+
+  Statistics recorded for each device:
+  - Device.[DeviceId].SchedulerJitterMs: time between the deadline and the actual start of the update
+  - Device.[DeviceId].SchedulerOverruns: number of times one or more deadlines of the device were missed
+
+  Devices that wait for new data in InternalUpdate (WaitBetweenInternalUpdates is disabled) would block a worker thread,
+  therefore they keep using their own data capture thread.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport vtkPlusDeviceScheduler : public vtkObject
+{
+public:
+  static vtkPlusDeviceScheduler* New();
+  vtkTypeMacro(vtkPlusDeviceScheduler, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /*! Set the number of worker threads. Can only be changed before the first device is added. */
+  PlusStatus SetNumberOfThreads(int numberOfThreads);
+  int GetNumberOfThreads() const;
+
+  /*! Start calling InternalUpdate of the device at its acquisition rate. The worker threads are started when the first device is added. */
+  PlusStatus AddDevice(vtkPlusDevice* device);
+
+  /*!
+    Stop calling InternalUpdate of the device. If an update of the device is in progress then the method returns
+    only after the update is completed (unless it is called from the update itself: in this case the scheduler
+    keeps its reference to the device until the update is completed).
+  */
+  PlusStatus RemoveDevice(vtkPlusDevice* device);
+
+  /*! Returns true if the device is currently scheduled */
+  bool IsDeviceScheduled(vtkPlusDevice* device);
+
+protected:
+  vtkPlusDeviceScheduler();
+  virtual ~vtkPlusDeviceScheduler();
+
+  struct ScheduledDevice
+  {
+    ScheduledDevice();
+
+    /*! Start time of the next update (system time, in seconds) */
+    double DeadlineSec;
+    /*! Deadline according to the acquisition rate of the device. Differs from DeadlineSec if the update was moved earlier because an input was updated. */
+    double NominalDeadlineSec;
+    /*! Devices with a higher dependency level are updated after their inputs if their deadlines are the same */
+    int DependencyLevel;
+    /*! Order of insertion into the queue, to keep the order of devices with the same deadline and level stable */
+    unsigned long QueueSequence;
+    bool Queued;
+    bool UpdateInProgress;
+    /*! Thread of the update in progress */
+    std::thread::id UpdateThreadId;
+    /*! Set when an input device completed an update, the device is then updated even if other inputs are due */
+    bool InputsUpdated;
+    /*! Time when an input completed an update, jitter is measured from this time if InputsUpdated is set */
+    double InputsUpdatedTimeSec;
+    /*! Scheduled devices that provide input for this device */
+    std::vector<vtkPlusDevice*> InputDevices;
+    /*! Scheduled devices that use this device as input */
+    std::vector<vtkPlusDevice*> DependentDevices;
+    PlusPerformanceHistogram* JitterStatistics;
+    PlusPerformanceCounter* OverrunStatistics;
+  };
+
+  /*! Queue entries are ordered by deadline, dependency level and insertion order */
+  struct QueueKey
+  {
+    double DeadlineSec;
+    int DependencyLevel;
+    unsigned long QueueSequence;
+    vtkPlusDevice* Device;
+    bool operator<(const QueueKey& other) const;
+  };
+
+  typedef std::map<vtkPlusDevice*, ScheduledDevice> ScheduledDeviceMapType;
+
+  static void* WorkerThread(void* data);
+
+  /*! Worker thread main loop */
+  void RunWorker();
+
+  /*! Find the first device in the queue that can be updated now. Returns NULL if no device is ready and sets the time of the next deadline. */
+  vtkPlusDevice* GetNextReadyDevice(double currentTimeSec, double& nextDeadlineSec);
+
+  /*! Returns true if any input of the device is being updated or is due */
+  bool IsAnyInputPending(const ScheduledDevice& scheduledDevice, double currentTimeSec);
+
+  /*! Insert the device into the queue with the specified deadline (removes the previous queue entry, if any) */
+  void Enqueue(vtkPlusDevice* device, ScheduledDevice& scheduledDevice, double deadlineSec);
+  void Dequeue(vtkPlusDevice* device, ScheduledDevice& scheduledDevice);
+
+  /*! Update the input and dependent device lists and dependency levels of all scheduled devices */
+  void UpdateDependencies();
+  int ComputeDependencyLevel(vtkPlusDevice* device, std::set<vtkPlusDevice*>& visitedDevices);
+
+  void StartWorkers();
+  void StopWorkers();
+
+  int NumberOfThreads;
+
+  ScheduledDeviceMapType ScheduledDevices;
+  /*! Devices that were removed from their own update. They are unregistered by the worker thread when the update is completed. */
+  std::vector<vtkPlusDevice*> DevicesRemovedDuringUpdate;
+  std::set<QueueKey> Queue;
+  unsigned long NextQueueSequence;
+
+  /*! Protects all the scheduling data members */
+  std::mutex Mutex;
+  /*! Signaled when the queue changes or an update completes */
+  std::condition_variable QueueChanged;
+  bool StopRequested;
+
+  vtkMultiThreader* Threader;
+  std::vector<int> WorkerThreadIds;
+
+private:
+  vtkPlusDeviceScheduler(const vtkPlusDeviceScheduler&);
+  void operator=(const vtkPlusDeviceScheduler&);
+};
+
+#endif
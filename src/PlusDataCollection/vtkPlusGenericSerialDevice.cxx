@@ -105,17 +105,29 @@ PlusStatus vtkPlusGenericSerialDevice::InternalConnect()
     return PLUS_FAIL;
   }
 
-  // COM port name format is different for port number under/over 10 (see Microsoft KB115831)
-  // Port number<10: COMn
-  // Port number>=10: \\.\COMn
   std::ostringstream strComPort;
-  if (this->SerialPort < 10)
+  if (!this->SerialPortName.empty())
   {
-    strComPort << "COM" << this->SerialPort;
+    strComPort << this->SerialPortName;
   }
   else
   {
-    strComPort << "\\\\.\\COM" << this->SerialPort;
+#ifdef _WIN32
+    // COM port name format is different for port number under/over 10 (see Microsoft KB115831)
+    // Port number<10: COMn
+    // Port number>=10: \\.\COMn
+    if (this->SerialPort < 10)
+    {
+      strComPort << "COM" << this->SerialPort;
+    }
+    else
+    {
+      strComPort << "\\\\.\\COM" << this->SerialPort;
+    }
+#else
+    // Port 1 is the first serial port device (same numbering as in the NDI tracker)
+    strComPort << "/dev/ttyS" << (this->SerialPort > 0 ? this->SerialPort - 1 : 0);
+#endif
   }
   this->Serial->SetPortName(strComPort.str());
 
@@ -239,16 +251,13 @@ PlusStatus vtkPlusGenericSerialDevice::SendText(const std::string& textToSend, s
   // Either update or send commands - but not simultaneously
   PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
 
-  // Write text
-  unsigned char packetLength = textToSend.size();
-  for (int i = 0; i < packetLength; i++)
+  // Write text and line ending at once
+  std::string packet = textToSend + this->LineEndingBin;
+  int packetLength = static_cast<int>(packet.size());
+  if (this->Serial->Write(reinterpret_cast<const unsigned char*>(packet.data()), packetLength) != packetLength)
   {
-    this->Serial->Write(textToSend[i]);
-  }
-  // Write line ending
-  for (std::string::iterator lineEndingIt = this->LineEndingBin.begin(); lineEndingIt != this->LineEndingBin.end(); ++lineEndingIt)
-  {
-    this->Serial->Write(*lineEndingIt);
+    LOG_ERROR("Failed to send text to serial device: " << textToSend);
+    return PLUS_FAIL;
   }
   // Get response
   if (textReceived != NULL)
@@ -274,64 +283,32 @@ PlusStatus vtkPlusGenericSerialDevice::SendText(const std::string& textToSend, s
 //-------------------------------------------------------------------------
 bool vtkPlusGenericSerialDevice::WaitForResponse()
 {
-  const int waitPeriodSec = 0.010;
-
-  double startTime = vtkPlusAccurateTimer::GetSystemTime();
-  while (this->Serial->GetNumberOfBytesAvailableForReading() == 0)
-  {
-    if (vtkPlusAccurateTimer::GetSystemTime() - startTime > this->MaximumReplyDelaySec)
-    {
-      // waiting time expired
-      return false;
-    }
-    vtksys::SystemTools::Delay(waitPeriodSec * 1000);
-  }
-  // data available for reading
-  return true;
+  // Returns as soon as data is received, no polling
+  return this->Serial->WaitForData(static_cast<int>(this->MaximumReplyDelaySec * 1000.0 + 0.5));
 }
 
 //-------------------------------------------------------------------------
 PlusStatus vtkPlusGenericSerialDevice::ReceiveResponse(std::string& textReceived, ReplyTermination acceptReply/*=REQUIRE_LINE_ENDING*/)
 {
-  textReceived.clear();
-  double startTime = vtkPlusAccurateTimer::GetSystemTime();
-
   // Read the the response (until line ending is found or timeout)
-  unsigned int lineEndingLength = this->LineEndingBin.size();
-  unsigned char d = 0;
-  bool lineEndingFound = false;
-  do
+  if (this->Serial->ReadLine(textReceived, this->LineEndingBin, static_cast<int>(this->MaximumReplyDurationSec * 1000.0 + 0.5)) != PLUS_SUCCESS)
   {
-    while (!this->Serial->Read(d))
+    // waiting time expired
+    if (acceptReply == REQUIRE_LINE_ENDING)
     {
-      if (vtkPlusAccurateTimer::GetSystemTime() - startTime > this->MaximumReplyDurationSec)
-      {
-        // waiting time expired
-        if (acceptReply == REQUIRE_LINE_ENDING)
-        {
-          LOG_ERROR("Failed to get a proper response within configured time (" << this->MaximumReplyDurationSec << " sec)");
-          return PLUS_FAIL;
-        }
-        else if (acceptReply == REQUIRE_NOT_EMPTY && textReceived.empty())
-        {
-          LOG_ERROR("Failed to read a complete line from serial device. Received: " << textReceived);
-          return PLUS_FAIL;
-        }
-        else
-        {
-          return PLUS_SUCCESS;
-        }
-      }
+      LOG_ERROR("Failed to get a proper response within configured time (" << this->MaximumReplyDurationSec << " sec)");
+      return PLUS_FAIL;
+    }
+    else if (acceptReply == REQUIRE_NOT_EMPTY && textReceived.empty())
+    {
+      LOG_ERROR("Failed to read a complete line from serial device. Received: " << textReceived);
+      return PLUS_FAIL;
+    }
+    else
+    {
+      return PLUS_SUCCESS;
     }
-    textReceived.push_back(d);
-    lineEndingFound = textReceived.size() >= lineEndingLength
-                      && (this->LineEndingBin.compare(textReceived.substr(textReceived.size() - lineEndingLength, lineEndingLength)) == 0);
-
   }
-  while (!lineEndingFound);
-
-  // Remove line ending
-  textReceived.erase(textReceived.size() - lineEndingLength, lineEndingLength);
 
   // Store in frame
   if (this->FieldDataSource != nullptr)
@@ -361,6 +338,7 @@ PlusStatus vtkPlusGenericSerialDevice::ReadConfiguration(vtkXMLDataElement* root
 {
   XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_READING(deviceConfig, rootConfigElement);
   XML_READ_SCALAR_ATTRIBUTE_REQUIRED(unsigned long, SerialPort, deviceConfig);
+  XML_READ_STRING_ATTRIBUTE_OPTIONAL(SerialPortName, deviceConfig);
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(unsigned long, BaudRate, deviceConfig);
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, MaximumReplyDelaySec, deviceConfig);
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, MaximumReplyDurationSec, deviceConfig);
@@ -373,6 +351,10 @@ PlusStatus vtkPlusGenericSerialDevice::WriteConfiguration(vtkXMLDataElement* roo
 {
   XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_WRITING(deviceConfig, rootConfigElement);
   deviceConfig->SetUnsignedLongAttribute("SerialPort", this->SerialPort);
+  if (!this->SerialPortName.empty())
+  {
+    deviceConfig->SetAttribute("SerialPortName", this->SerialPortName.c_str());
+  }
   deviceConfig->SetUnsignedLongAttribute("BaudRate", this->BaudRate);
   deviceConfig->SetDoubleAttribute("MaximumReplyDelaySec", this->MaximumReplyDelaySec);
   deviceConfig->SetDoubleAttribute("MaximumReplyDurationSec", this->MaximumReplyDurationSec);
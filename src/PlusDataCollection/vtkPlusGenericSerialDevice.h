@@ -52,6 +52,9 @@ public:
   virtual bool IsTracker() const { return false; }
 
   vtkSetMacro(SerialPort, unsigned long);
+  /*! Name of the serial port device (e.g., /dev/ttyUSB0). If empty then the name is determined from SerialPort. */
+  vtkSetStdStringMacro(SerialPortName);
+  vtkGetStdStringMacro(SerialPortName);
   vtkSetMacro(BaudRate, unsigned long);
   vtkSetMacro(MaximumReplyDelaySec, double);
   vtkSetMacro(MaximumReplyDurationSec, double);
@@ -106,7 +109,7 @@ protected:
   vtkPlusGenericSerialDevice();
   ~vtkPlusGenericSerialDevice();
 
-  /*! Wait until the serial device makes some data available for reading but maximum up to ReplyTimeoutSec */
+  /*! Wait until the serial device makes some data available for reading but maximum up to MaximumReplyDelaySec */
   virtual bool WaitForResponse();
 
 private:
@@ -117,9 +120,12 @@ protected:
   /*! Serial (RS232) line connection */
   SerialLine* Serial;
 
-  /*! Used COM port number for serial communication (ComPort: 1 => Port name: "COM1")*/
+  /*! Used COM port number for serial communication (ComPort: 1 => Port name: "COM1" on Windows, "/dev/ttyS0" on other platforms)*/
   unsigned long SerialPort;
 
+  /*! Serial port device name, overrides SerialPort if not empty */
+  std::string SerialPortName;
+
   /*! Baud rate for serial communication. */
   unsigned long BaudRate;
 
@@ -12,6 +12,11 @@ See License.txt for details.
 #include "vtkTable.h"
 #include "vtkVariantArray.h"
 
+#include <algorithm>
+
+// In robust timestamp filtering, timestamps are limited to this many standard deviations from the fitted line
+static const double ROBUST_FILTERING_MAX_RESIDUAL_STDEV = 3.0;
+
 vtkStandardNewMacro(vtkPlusTimestampedCircularBuffer);
 
 //----------------------------------------------------------------------------
@@ -22,6 +27,15 @@ vtkPlusTimestampedCircularBuffer::vtkPlusTimestampedCircularBuffer()
   , LocalTimeOffsetSec(0.0)
   , LatestItemUid(0)
   , AveragedItemsForFiltering(20)
+  , FilterAnchorIndex(0.0)
+  , FilterAnchorTimestamp(0.0)
+  , FilterSumX(0.0)
+  , FilterSumY(0.0)
+  , FilterSumXX(0.0)
+  , FilterSumXY(0.0)
+  , FilterSumYY(0.0)
+  , RobustTimestampFiltering(false)
+  , FilterConsecutiveOutliers(0)
   , MaxAllowedFilteringTimeDifference(0.5)
   , TimeStampReportTable(NULL)
   , TimeStampReporting(false)
@@ -409,6 +423,15 @@ void vtkPlusTimestampedCircularBuffer::DeepCopy(vtkPlusTimestampedCircularBuffer
   this->FilterContainersOldestIndex = buffer->FilterContainersOldestIndex;
   this->FilterContainerTimestampVector = buffer->FilterContainerTimestampVector;
   this->FilterContainerIndexVector = buffer->FilterContainerIndexVector;
+  this->FilterAnchorIndex = buffer->FilterAnchorIndex;
+  this->FilterAnchorTimestamp = buffer->FilterAnchorTimestamp;
+  this->FilterSumX = buffer->FilterSumX;
+  this->FilterSumY = buffer->FilterSumY;
+  this->FilterSumXX = buffer->FilterSumXX;
+  this->FilterSumXY = buffer->FilterSumXY;
+  this->FilterSumYY = buffer->FilterSumYY;
+  this->RobustTimestampFiltering = buffer->RobustTimestampFiltering;
+  this->FilterConsecutiveOutliers = buffer->FilterConsecutiveOutliers;
 
   this->BufferItemContainer = buffer->BufferItemContainer;
   this->Unlock();
@@ -536,27 +559,41 @@ PlusStatus vtkPlusTimestampedCircularBuffer::CreateFilteredTimeStampForItem(unsi
     // this call set elements to null
     this->FilterContainerIndexVector.set_size(this->AveragedItemsForFiltering);
     this->FilterContainerTimestampVector.set_size(this->AveragedItemsForFiltering);
-    this->FilterContainersOldestIndex = 0;
-    this->FilterContainersNumberOfValidElements = 0;
+    ResetTimestampFilter();
   }
 
   // We store the last AveragedItemsForFiltering unfiltered timestamp and item indexes, because these are used for computing the filtered timestamp.
   if (this->AveragedItemsForFiltering > 1)
   {
-    this->FilterContainerIndexVector(this->FilterContainersOldestIndex) = itemIndex;
-    this->FilterContainerTimestampVector[this->FilterContainersOldestIndex] = inUnfilteredTimestamp;
-    this->FilterContainersNumberOfValidElements++;
-    this->FilterContainersOldestIndex++;
-
-    if (this->FilterContainersNumberOfValidElements > this->AveragedItemsForFiltering)
-    {
-      this->FilterContainersNumberOfValidElements = this->AveragedItemsForFiltering;
-    }
-
-    if (this->FilterContainersOldestIndex >= this->AveragedItemsForFiltering)
+    double timestampToBeAdded = inUnfilteredTimestamp;
+    if (this->RobustTimestampFiltering && this->FilterContainersNumberOfValidElements == this->AveragedItemsForFiltering && this->AveragedItemsForFiltering > 2)
     {
-      this->FilterContainersOldestIndex = 0;
+      // Limit the distance of the new timestamp from the line fitted to the previous items, so that
+      // a few items with delayed transfer do not pull the line away (and so the filtered timestamps of all the following items).
+      double residualStdev = 0;
+      double predictedTimestamp = GetTimestampFromFilterLine(itemIndex, &residualStdev);
+      double maxResidual = std::max(ROBUST_FILTERING_MAX_RESIDUAL_STDEV * residualStdev, this->NegligibleTimeDifferenceSec);
+      double residual = inUnfilteredTimestamp - predictedTimestamp;
+      if (fabs(residual) > maxResidual)
+      {
+        this->FilterConsecutiveOutliers++;
+        if (this->FilterConsecutiveOutliers > this->AveragedItemsForFiltering / 2)
+        {
+          // Too many outliers in a row: the timing of the items has changed (e.g., the acquisition rate is changed), start a new fit
+          LOG_DEBUG("Timestamp filtering is restarted at item index " << itemIndex << ", because the last " << this->FilterConsecutiveOutliers << " timestamps did not fit the previous timing");
+          ResetTimestampFilter();
+        }
+        else
+        {
+          timestampToBeAdded = predictedTimestamp + (residual > 0 ? maxResidual : -maxResidual);
+        }
+      }
+      else
+      {
+        this->FilterConsecutiveOutliers = 0;
+      }
     }
+    AddItemToTimestampFilter(itemIndex, timestampToBeAdded);
   }
 
   // If we don't have enough unfiltered timestamps or we don't want to use afiltering then just use the unfiltered timestamps
@@ -589,21 +626,9 @@ PlusStatus vtkPlusTimestampedCircularBuffer::CreateFilteredTimeStampForItem(unsi
   //   a = sum( (x(i)-xMean) * (y(i)-yMean) ) / sum( (x(i)-xMean) * (x(i)-xMean) )
   //   b = yMean - a*xMean
   //
+  // The sums are updated incrementally, see GetTimestampFromFilterLine.
 
-  double xMean = this->FilterContainerIndexVector.mean();
-  double yMean = this->FilterContainerTimestampVector.mean();
-  double covarianceXY = 0;
-  double varianceX = 0;
-  for (int i = this->FilterContainerTimestampVector.size() - 1; i >= 0; i--)
-  {
-    double xiMinusXmean = (this->FilterContainerIndexVector(i) - xMean);
-    covarianceXY += xiMinusXmean * (this->FilterContainerTimestampVector(i) - yMean);
-    varianceX += xiMinusXmean * xiMinusXmean;
-  }
-  double a = covarianceXY / varianceX;
-  double b = yMean - a * xMean;
-
-  outFilteredTimestamp = a * itemIndex + b;
+  outFilteredTimestamp = GetTimestampFromFilterLine(itemIndex);
 
   if (this->TimeStampLogging)
   {
@@ -627,6 +652,107 @@ PlusStatus vtkPlusTimestampedCircularBuffer::CreateFilteredTimeStampForItem(unsi
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::ResetTimestampFilter()
+{
+  this->FilterContainersOldestIndex = 0;
+  this->FilterContainersNumberOfValidElements = 0;
+  this->FilterConsecutiveOutliers = 0;
+  this->FilterSumX = 0;
+  this->FilterSumY = 0;
+  this->FilterSumXX = 0;
+  this->FilterSumXY = 0;
+  this->FilterSumYY = 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::AddItemToTimestampFilter(unsigned long itemIndex, double timestamp)
+{
+  if (this->FilterContainersNumberOfValidElements == 0)
+  {
+    this->FilterAnchorIndex = itemIndex;
+    this->FilterAnchorTimestamp = timestamp;
+  }
+
+  if (this->FilterContainersNumberOfValidElements == this->AveragedItemsForFiltering)
+  {
+    // The window is full, the oldest item is overwritten
+    double x = this->FilterContainerIndexVector(this->FilterContainersOldestIndex) - this->FilterAnchorIndex;
+    double y = this->FilterContainerTimestampVector(this->FilterContainersOldestIndex) - this->FilterAnchorTimestamp;
+    this->FilterSumX -= x;
+    this->FilterSumY -= y;
+    this->FilterSumXX -= x * x;
+    this->FilterSumXY -= x * y;
+    this->FilterSumYY -= y * y;
+  }
+  else
+  {
+    this->FilterContainersNumberOfValidElements++;
+  }
+
+  this->FilterContainerIndexVector(this->FilterContainersOldestIndex) = itemIndex;
+  this->FilterContainerTimestampVector(this->FilterContainersOldestIndex) = timestamp;
+  double x = itemIndex - this->FilterAnchorIndex;
+  double y = timestamp - this->FilterAnchorTimestamp;
+  this->FilterSumX += x;
+  this->FilterSumY += y;
+  this->FilterSumXX += x * x;
+  this->FilterSumXY += x * y;
+  this->FilterSumYY += y * y;
+
+  this->FilterContainersOldestIndex++;
+  if (this->FilterContainersOldestIndex >= this->AveragedItemsForFiltering)
+  {
+    this->FilterContainersOldestIndex = 0;
+    // Once in each window length, so the cost per item remains constant
+    ReanchorTimestampFilter();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::ReanchorTimestampFilter()
+{
+  unsigned int newestIndex = (this->FilterContainersOldestIndex + this->AveragedItemsForFiltering - 1) % this->AveragedItemsForFiltering;
+  this->FilterAnchorIndex = this->FilterContainerIndexVector(newestIndex);
+  this->FilterAnchorTimestamp = this->FilterContainerTimestampVector(newestIndex);
+
+  this->FilterSumX = 0;
+  this->FilterSumY = 0;
+  this->FilterSumXX = 0;
+  this->FilterSumXY = 0;
+  this->FilterSumYY = 0;
+  for (unsigned int i = 0; i < this->FilterContainersNumberOfValidElements; ++i)
+  {
+    double x = this->FilterContainerIndexVector(i) - this->FilterAnchorIndex;
+    double y = this->FilterContainerTimestampVector(i) - this->FilterAnchorTimestamp;
+    this->FilterSumX += x;
+    this->FilterSumY += y;
+    this->FilterSumXX += x * x;
+    this->FilterSumXY += x * y;
+    this->FilterSumYY += y * y;
+  }
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusTimestampedCircularBuffer::GetTimestampFromFilterLine(unsigned long itemIndex, double* residualStdevPtr /*=NULL*/)
+{
+  double n = this->FilterContainersNumberOfValidElements;
+  double xMean = this->FilterSumX / n;
+  double yMean = this->FilterSumY / n;
+  double covarianceXY = this->FilterSumXY - this->FilterSumX * yMean;
+  double varianceX = this->FilterSumXX - this->FilterSumX * xMean;
+  double a = covarianceXY / varianceX;
+
+  if (residualStdevPtr != NULL)
+  {
+    // sum of squared residuals = sum( (y(i)-yMean)^2 ) - a * sum( (x(i)-xMean) * (y(i)-yMean) )
+    double sumSquaredResiduals = (this->FilterSumYY - this->FilterSumY * yMean) - a * covarianceXY;
+    *residualStdevPtr = (n > 2 && sumSquaredResiduals > 0) ? sqrt(sumSquaredResiduals / (n - 2)) : 0.0;
+  }
+
+  return this->FilterAnchorTimestamp + yMean + a * ((itemIndex - this->FilterAnchorIndex) - xMean);
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusTimestampedCircularBuffer::GetTimeStampReportTable(vtkTable* timeStampReportTable)
 {
@@ -175,6 +175,10 @@ public:
     and so the timestamp is affected by data transfer speed (which may slightly vary).
     A line is fitted to the index and timestamp of the last (AveragedItemsForFiltering) items.
     The filtered timestamp is the time value that corresponds to the frame index according to the fitted line.
+    The line is computed from running sums that are updated as items enter and leave the window, so the
+    computation time does not depend on the number of averaged items.
+    If RobustTimestampFiltering is enabled then timestamps that are far from the fitted line are limited
+    before they are added to the window, so that a few delayed items do not distort the line.
     If the filtered timestamp is very different from the non-filtered timestamp then
     filteredTimestampProbablyValid will be false and it is recommended not to use that item,
     because its timestamp is probably incorrect.
@@ -202,6 +206,13 @@ public:
   /*! Get number of items used for timestamp filtering (with LSQR mimimizer) */
   vtkGetMacro( AveragedItemsForFiltering, int );
 
+  /*! If enabled then outlier timestamps have limited effect on the timestamp filtering. See CreateFilteredTimeStampForItem. */
+  vtkSetMacro( RobustTimestampFiltering, bool );
+  /*! If enabled then outlier timestamps have limited effect on the timestamp filtering. See CreateFilteredTimeStampForItem. */
+  vtkGetMacro( RobustTimestampFiltering, bool );
+  /*! If enabled then outlier timestamps have limited effect on the timestamp filtering. See CreateFilteredTimeStampForItem. */
+  vtkBooleanMacro( RobustTimestampFiltering, bool );
+
   /*! Set recording start time */
   vtkSetMacro( StartTime, double );
   /*! Get recording start time */
@@ -211,6 +222,24 @@ protected:
   vtkPlusTimestampedCircularBuffer();
   ~vtkPlusTimestampedCircularBuffer();
 
+  /*! Remove all items from the timestamp filter window */
+  void ResetTimestampFilter();
+
+  /*! Add an item to the timestamp filter window (the oldest item is removed if the window is full) */
+  void AddItemToTimestampFilter( unsigned long itemIndex, double timestamp );
+
+  /*!
+    Recompute the running sums of the timestamp filter window relative to the newest item.
+    Keeps the sums small and removes the rounding errors that accumulate from adding and removing items.
+  */
+  void ReanchorTimestampFilter();
+
+  /*!
+    Get the timestamp that corresponds to the item index according to the line fitted to the timestamp filter window.
+    \param residualStdevPtr If not NULL then the standard deviation of the timestamps from the fitted line is returned here
+  */
+  double GetTimestampFromFilterLine( unsigned long itemIndex, double* residualStdevPtr = NULL );
+
 protected:
   vtkPlusRecursiveCriticalSection* Mutex;
 
@@ -247,6 +276,26 @@ protected:
   /*! Number of averaged items used for filtering - read from config files */
   unsigned int AveragedItemsForFiltering;
 
+  /*!
+    Item index and timestamp that are subtracted from the values in the timestamp filter window
+    before they are added to the running sums (to keep the sums numerically accurate)
+  */
+  double FilterAnchorIndex;
+  double FilterAnchorTimestamp;
+
+  /*! Running sums of the (anchored) item indexes (x) and timestamps (y) in the timestamp filter window */
+  double FilterSumX;
+  double FilterSumY;
+  double FilterSumXX;
+  double FilterSumXY;
+  double FilterSumYY;
+
+  /*! Limit the effect of outlier timestamps on the timestamp filtering */
+  bool RobustTimestampFiltering;
+
+  /*! Number of outlier timestamps received in a row, used for detecting a change in the timing of the items */
+  unsigned int FilterConsecutiveOutliers;
+
   /*!
     Maximum time difference that is allowed between filtered and the non-filtered timestamp (in seconds).
     If the filtered value differs too much from the non-filtered one, then it rejects the filtering result.
@@ -7,9 +7,12 @@ See License.txt for details.
 #include "PlusConfigure.h"
 
 #include "PlusIgtlClientInfo.h"
+#include "vtkPlusIgtlImageCompressor.h"
 
 #include "igtl_header.h"
 
+#include <algorithm>
+
 //----------------------------------------------------------------------------
 PlusIgtlClientInfo::PlusIgtlClientInfo()
   : ClientHeaderVersion(IGTL_HEADER_VERSION_1)
@@ -20,6 +23,144 @@ PlusIgtlClientInfo::PlusIgtlClientInfo()
 
 }
 
+//----------------------------------------------------------------------------
+PlusIgtlClientInfo::ImageStream::ImageStream()
+  : DownsamplingFactor(1)
+  , DownsamplingMethod(DOWNSAMPLING_AVERAGE)
+  , Grayscale(false)
+{
+  for (int i = 0; i < 3; ++i)
+  {
+    this->ClipRectangleOrigin[i] = PlusCommon::NO_CLIP;
+    this->ClipRectangleSize[i] = PlusCommon::NO_CLIP;
+  }
+}
+
+//----------------------------------------------------------------------------
+bool PlusIgtlClientInfo::ImageStream::IsProcessingRequested() const
+{
+  return PlusCommon::IsClippingRequested(this->ClipRectangleOrigin, this->ClipRectangleSize)
+         || this->DownsamplingFactor > 1
+         || this->Grayscale;
+}
+
+//----------------------------------------------------------------------------
+std::string PlusIgtlClientInfo::ImageStream::GetStringFromDownsamplingMethod(DownsamplingMethodType method)
+{
+  switch (method)
+  {
+    case DOWNSAMPLING_DECIMATE:
+      return "DECIMATE";
+    case DOWNSAMPLING_AVERAGE:
+      return "AVERAGE";
+  }
+  return "";
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusIgtlClientInfo::ImageStream::ReadProcessingOptions(vtkXMLDataElement* imageElement)
+{
+  if (imageElement == NULL)
+  {
+    LOG_ERROR("Unable to read image stream processing options - element is NULL");
+    return PLUS_FAIL;
+  }
+
+  ImageStream defaults;
+  PlusStatus status = PLUS_SUCCESS;
+
+  // Clip rectangle can be specified in 2D, in that case the first slice is used
+  int clipRectangleOrigin[3] = { 0, 0, 0 };
+  int clipRectangleSize[3] = { 0, 0, 1 };
+  int clipRectangleOriginComponents = imageElement->GetVectorAttribute("ClipRectangleOrigin", 3, clipRectangleOrigin);
+  int clipRectangleSizeComponents = imageElement->GetVectorAttribute("ClipRectangleSize", 3, clipRectangleSize);
+  std::copy(defaults.ClipRectangleOrigin, defaults.ClipRectangleOrigin + 3, this->ClipRectangleOrigin);
+  std::copy(defaults.ClipRectangleSize, defaults.ClipRectangleSize + 3, this->ClipRectangleSize);
+  if (clipRectangleOriginComponents > 0 || clipRectangleSizeComponents > 0)
+  {
+    if (clipRectangleOriginComponents < 2 || clipRectangleSizeComponents < 2 || clipRectangleOriginComponents != clipRectangleSizeComponents)
+    {
+      LOG_WARNING("ClipRectangleOrigin and ClipRectangleSize attributes of image stream " << this->Name << " must both have 2 or 3 components. Clipping is disabled.");
+      status = PLUS_FAIL;
+    }
+    else if (clipRectangleOrigin[0] < 0 || clipRectangleOrigin[1] < 0 || clipRectangleOrigin[2] < 0
+             || clipRectangleSize[0] <= 0 || clipRectangleSize[1] <= 0 || clipRectangleSize[2] <= 0)
+    {
+      LOG_WARNING("Invalid clip rectangle of image stream " << this->Name << ": origin must not be negative and size must be positive. Clipping is disabled.");
+      status = PLUS_FAIL;
+    }
+    else
+    {
+      std::copy(clipRectangleOrigin, clipRectangleOrigin + 3, this->ClipRectangleOrigin);
+      std::copy(clipRectangleSize, clipRectangleSize + 3, this->ClipRectangleSize);
+    }
+  }
+
+  this->DownsamplingFactor = defaults.DownsamplingFactor;
+  if (imageElement->GetAttribute("DownsamplingFactor") != NULL)
+  {
+    int downsamplingFactor = 1;
+    if (!imageElement->GetScalarAttribute("DownsamplingFactor", downsamplingFactor) || downsamplingFactor < 1)
+    {
+      LOG_WARNING("Invalid DownsamplingFactor attribute of image stream " << this->Name << ": " << imageElement->GetAttribute("DownsamplingFactor")
+                  << ". It must be a positive integer. Downsampling is disabled.");
+      status = PLUS_FAIL;
+    }
+    else
+    {
+      this->DownsamplingFactor = downsamplingFactor;
+    }
+  }
+
+  this->DownsamplingMethod = defaults.DownsamplingMethod;
+  const char* downsamplingMethod = imageElement->GetAttribute("DownsamplingMethod");
+  if (downsamplingMethod != NULL)
+  {
+    if (STRCASECMP(downsamplingMethod, "DECIMATE") == 0)
+    {
+      this->DownsamplingMethod = DOWNSAMPLING_DECIMATE;
+    }
+    else if (STRCASECMP(downsamplingMethod, "AVERAGE") == 0)
+    {
+      this->DownsamplingMethod = DOWNSAMPLING_AVERAGE;
+    }
+    else
+    {
+      LOG_WARNING("Unknown DownsamplingMethod attribute value of image stream " << this->Name << ": " << downsamplingMethod
+                  << ". Valid values: DECIMATE, AVERAGE.");
+      status = PLUS_FAIL;
+    }
+  }
+
+  this->Grayscale = defaults.Grayscale;
+  const char* grayscale = imageElement->GetAttribute("Grayscale");
+  if (grayscale != NULL)
+  {
+    this->Grayscale = STRCASECMP(grayscale, "TRUE") == 0;
+  }
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+void PlusIgtlClientInfo::ImageStream::WriteProcessingOptions(vtkXMLDataElement* imageElement) const
+{
+  if (PlusCommon::IsClippingRequested(this->ClipRectangleOrigin, this->ClipRectangleSize))
+  {
+    imageElement->SetVectorAttribute("ClipRectangleOrigin", 3, this->ClipRectangleOrigin);
+    imageElement->SetVectorAttribute("ClipRectangleSize", 3, this->ClipRectangleSize);
+  }
+  if (this->DownsamplingFactor > 1)
+  {
+    imageElement->SetIntAttribute("DownsamplingFactor", this->DownsamplingFactor);
+    imageElement->SetAttribute("DownsamplingMethod", GetStringFromDownsamplingMethod(this->DownsamplingMethod).c_str());
+  }
+  if (this->Grayscale)
+  {
+    imageElement->SetAttribute("Grayscale", "TRUE");
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusStatus PlusIgtlClientInfo::SetClientInfoFromXmlData(const char* strXmlData)
 {
@@ -134,6 +275,21 @@ PlusStatus PlusIgtlClientInfo::SetClientInfoFromXmlData(vtkXMLDataElement* xmlda
       ImageStream stream;
       stream.EmbeddedTransformToFrame = embeddedTransformToFrame;
       stream.Name = name;
+      const char* compression = imageNames->GetNestedElement(i)->GetAttribute("Compression");
+      if (compression != NULL)
+      {
+        vtkPlusIgtlImageCompressor::CompressionMethodType compressionMethod = vtkPlusIgtlImageCompressor::COMPRESSION_NONE;
+        if (vtkPlusIgtlImageCompressor::GetCompressionMethodFromString(compression, compressionMethod) == PLUS_SUCCESS)
+        {
+          stream.Compression = compression;
+        }
+        else
+        {
+          LOG_WARNING("Unknown Compression attribute value of ImageNames/Image element: " << compression << ". Image will be sent uncompressed.");
+        }
+      }
+      // Invalid options are reported and ignored, the image is still sent
+      stream.ReadProcessingOptions(imageNames->GetNestedElement(i));
       clientInfo.ImageStreams.push_back(stream);
     }
   }
@@ -226,6 +382,11 @@ void PlusIgtlClientInfo::GetClientInfoInXmlData(std::string& strXmlData)
     image->SetName("Image");
     image->SetAttribute("Name", ImageStreams[i].Name.c_str());
     image->SetAttribute("EmbeddedTransformToFrame", ImageStreams[i].EmbeddedTransformToFrame.c_str());
+    if (!ImageStreams[i].Compression.empty())
+    {
+      image->SetAttribute("Compression", ImageStreams[i].Compression.c_str());
+    }
+    ImageStreams[i].WriteProcessingOptions(image);
     imageNames->AddNestedElement(image);
   }
   xmldata->AddNestedElement(imageNames);
@@ -303,7 +464,26 @@ void PlusIgtlClientInfo::PrintSelf(ostream& os, vtkIndent indent)
       {
         os << ", ";
       }
-      os << this->ImageStreams[i].Name << " (EmbeddedTransformToFrame: " << this->ImageStreams[i].EmbeddedTransformToFrame << ")";
+      os << this->ImageStreams[i].Name << " (EmbeddedTransformToFrame: " << this->ImageStreams[i].EmbeddedTransformToFrame;
+      if (!this->ImageStreams[i].Compression.empty())
+      {
+        os << ", Compression: " << this->ImageStreams[i].Compression;
+      }
+      const ImageStream& stream = this->ImageStreams[i];
+      if (PlusCommon::IsClippingRequested(stream.ClipRectangleOrigin, stream.ClipRectangleSize))
+      {
+        os << ", ClipRectangleOrigin: " << stream.ClipRectangleOrigin[0] << " " << stream.ClipRectangleOrigin[1] << " " << stream.ClipRectangleOrigin[2]
+           << ", ClipRectangleSize: " << stream.ClipRectangleSize[0] << " " << stream.ClipRectangleSize[1] << " " << stream.ClipRectangleSize[2];
+      }
+      if (stream.DownsamplingFactor > 1)
+      {
+        os << ", DownsamplingFactor: " << stream.DownsamplingFactor << " (" << ImageStream::GetStringFromDownsamplingMethod(stream.DownsamplingMethod) << ")";
+      }
+      if (stream.Grayscale)
+      {
+        os << ", Grayscale";
+      }
+      os << ")";
     }
   }
   else
@@ -28,12 +28,50 @@ struct vtkPlusOpenIGTLinkExport PlusIgtlClientInfo
   /*! Helper struct for storing image stream and embedded transform frame names
   IGTL image message device name: [Name]_[EmbeddedTransformToFrame]
   */
-  struct ImageStream
+  struct vtkPlusOpenIGTLinkExport ImageStream
   {
+    enum DownsamplingMethodType
+    {
+      DOWNSAMPLING_DECIMATE,  /*!< keep the top-left pixel of each block */
+      DOWNSAMPLING_AVERAGE    /*!< average the pixels of each block (8-bit images only, others are decimated) */
+    };
+
+    ImageStream();
+
+    /*! True if the image has to be cropped, downsampled, or converted to grayscale before sending */
+    bool IsProcessingRequested() const;
+
+    /*!
+      Read ClipRectangleOrigin, ClipRectangleSize, DownsamplingFactor, DownsamplingMethod, and Grayscale attributes.
+      Missing attributes are set to the default (no processing).
+    */
+    PlusStatus ReadProcessingOptions(vtkXMLDataElement* imageElement);
+
+    /*! Write the processing options that differ from the default as attributes */
+    void WriteProcessingOptions(vtkXMLDataElement* imageElement) const;
+
+    static std::string GetStringFromDownsamplingMethod(DownsamplingMethodType method);
+
     /*! Name of the image stream and the IGTL image message embedded transform "From" frame */
     std::string Name;
     /*! Name of the IGTL image message embedded transform "To" frame */
     std::string EmbeddedTransformToFrame;
+    /*!
+      Pixel data compression method requested by the client (see vtkPlusIgtlImageCompressor, e.g., ZLIB, DELTA_RLE).
+      If empty or NONE then the image is sent in an IMAGE message, otherwise in a COMPIMAGE message.
+    */
+    std::string Compression;
+    /*!
+      Region of interest that is sent to the client, in pixels. If origin and size are specified in 2D then the first slice
+      is used. A value of PlusCommon::NO_CLIP means that the full image is sent.
+    */
+    int ClipRectangleOrigin[3];
+    int ClipRectangleSize[3];
+    /*! The region of interest is downsampled by this integer factor along the I and J axes (1 = no downsampling) */
+    int DownsamplingFactor;
+    DownsamplingMethodType DownsamplingMethod;
+    /*! If true then RGB images are converted to grayscale (average of the color components) */
+    bool Grayscale;
   };
 
   PlusIgtlClientInfo();
@@ -69,14 +107,14 @@ struct vtkPlusOpenIGTLinkExport PlusIgtlClientInfo
   std::vector<ImageStream> ImageStreams;
 
   /*! A new TDATA is only sent if the time elapsed is at least the resolution
-     value (otherwise we don't send this tracking data to the client) */
+     value in milliseconds (otherwise we don't send this tracking data to the client) */
   int Resolution;
 
   /*! flag for start TDATA transmission request: true on STT, false on STP.
      If the start requested flag is false then don't send TDATA to the client. */
   bool TDATARequested;
 
-  /*! timestamp of the last sent TDATA message. */
+  /*! timestamp of the last sent TDATA message (UTC). */
   double LastTDATASentTimeStamp;
 };
 
@@ -0,0 +1,283 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Verify that all vtkPlusIgtlImageCompressor compression methods reproduce a sequence of frames exactly,
+// both with a single band and with multiple bands compressed in parallel, and that key frames are inserted
+// as expected for delta compression. Also verify that compressors of different streams record their
+// performance statistics separately and release them when they are deleted.
+
+#include "PlusConfigure.h"
+#include "PlusPerformanceStatistics.h"
+#include "PlusVideoFrame.h"
+#include "vtkPlusIgtlImageCompressor.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLDataElement.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+namespace
+{
+  const int NUMBER_OF_FRAMES = 10;
+  const int KEY_FRAME_INTERVAL = 4;
+
+  //----------------------------------------------------------------------------
+  // Static background with a moving bright rectangle, similar to an ultrasound image with a static background
+  void GenerateFrame(PlusVideoFrame& frame, int frameIndex)
+  {
+    unsigned int frameSize[3] = { 0, 0, 0 };
+    frame.GetFrameSize(frameSize);
+    int numberOfComponents = frame.GetNumberOfScalarComponents();
+    unsigned char* pixels = static_cast<unsigned char*>(frame.GetScalarPointer());
+    for (unsigned int y = 0; y < frameSize[1]; ++y)
+    {
+      for (unsigned int x = 0; x < frameSize[0]; ++x)
+      {
+        unsigned char value = static_cast<unsigned char>((x / 8 + y / 8) % 2 ? 40 : 0);
+        if (x >= 10 + 7 * static_cast<unsigned int>(frameIndex) && x < 60 + 7 * static_cast<unsigned int>(frameIndex) && y >= 20 && y < 70)
+        {
+          value = static_cast<unsigned char>(200 + frameIndex);
+        }
+        for (int c = 0; c < numberOfComponents; ++c)
+        {
+          pixels[(y * frameSize[0] + x) * numberOfComponents + c] = static_cast<unsigned char>(value + c);
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus TestCompressionMethod(vtkPlusIgtlImageCompressor::CompressionMethodType method, const int frameSize[3], int numberOfComponents, int numberOfThreads)
+  {
+    std::string methodName = vtkPlusIgtlImageCompressor::GetStringFromCompressionMethod(method);
+    vtkPlusIgtlImageCompressor::CompressionMethodType parsedMethod = vtkPlusIgtlImageCompressor::COMPRESSION_NONE;
+    if (vtkPlusIgtlImageCompressor::GetCompressionMethodFromString(methodName, parsedMethod) != PLUS_SUCCESS || parsedMethod != method)
+    {
+      LOG_ERROR("Compression method name " << methodName << " is not recognized");
+      return PLUS_FAIL;
+    }
+
+    vtkSmartPointer<vtkPlusIgtlImageCompressor> compressor = vtkSmartPointer<vtkPlusIgtlImageCompressor>::New();
+    compressor->SetCompressionMethod(method);
+    compressor->SetNumberOfThreads(numberOfThreads);
+    compressor->SetKeyFrameInterval(KEY_FRAME_INTERVAL);
+    vtkSmartPointer<vtkPlusIgtlImageCompressor> decompressor = vtkSmartPointer<vtkPlusIgtlImageCompressor>::New();
+    decompressor->SetNumberOfThreads(numberOfThreads);
+
+    PlusVideoFrame frame;
+    PlusVideoFrame decompressedFrame;
+    if (frame.AllocateFrame(frameSize, VTK_UNSIGNED_CHAR, numberOfComponents) != PLUS_SUCCESS
+        || decompressedFrame.AllocateFrame(frameSize, VTK_UNSIGNED_CHAR, numberOfComponents) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to allocate frames");
+      return PLUS_FAIL;
+    }
+
+    bool deltaMethod = (method == vtkPlusIgtlImageCompressor::COMPRESSION_DELTA_RLE || method == vtkPlusIgtlImageCompressor::COMPRESSION_DELTA_ZLIB);
+    std::vector<unsigned char> compressedData;
+    for (int frameIndex = 0; frameIndex < NUMBER_OF_FRAMES; ++frameIndex)
+    {
+      GenerateFrame(frame, frameIndex);
+
+      bool keyFrame = false;
+      if (compressor->Compress(frame, compressedData, keyFrame) != PLUS_SUCCESS)
+      {
+        LOG_ERROR(methodName << ": failed to compress frame " << frameIndex);
+        return PLUS_FAIL;
+      }
+
+      bool expectedKeyFrame = !deltaMethod || (frameIndex % (KEY_FRAME_INTERVAL + 1) == 0);
+      if (keyFrame != expectedKeyFrame)
+      {
+        LOG_ERROR(methodName << ": key frame flag mismatch at frame " << frameIndex << ": expected " << expectedKeyFrame << ", actual " << keyFrame);
+        return PLUS_FAIL;
+      }
+
+      if (decompressor->Decompress(compressedData.empty() ? NULL : &compressedData[0], compressedData.size(), method, keyFrame, decompressedFrame) != PLUS_SUCCESS)
+      {
+        LOG_ERROR(methodName << ": failed to decompress frame " << frameIndex);
+        return PLUS_FAIL;
+      }
+
+      if (memcmp(frame.GetScalarPointer(), decompressedFrame.GetScalarPointer(), frame.GetFrameSizeInBytes()) != 0)
+      {
+        LOG_ERROR(methodName << ": decompressed frame " << frameIndex << " differs from the original frame (" << numberOfThreads << " threads)");
+        return PLUS_FAIL;
+      }
+
+      if (method != vtkPlusIgtlImageCompressor::COMPRESSION_NONE && compressedData.size() >= frame.GetFrameSizeInBytes())
+      {
+        LOG_ERROR(methodName << ": frame " << frameIndex << " is not compressed: " << compressedData.size() << " bytes");
+        return PLUS_FAIL;
+      }
+    }
+
+    LOG_INFO(methodName << " (" << numberOfThreads << " threads): last frame compressed from " << frame.GetFrameSizeInBytes() << " to " << compressedData.size() << " bytes");
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusPerformanceHistogram* FindHistogram(const std::string& name)
+  {
+    vtkSmartPointer<vtkXMLDataElement> statisticsElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    PlusPerformanceStatistics::GetInstance()->WriteSummary(statisticsElement);
+    if (statisticsElement->FindNestedElementWithNameAndAttribute("Histogram", "Name", name.c_str()) == NULL)
+    {
+      return NULL;
+    }
+    // The histogram exists, so this does not create a new one (the extra reference is released by the caller)
+    return PlusPerformanceStatistics::GetInstance()->GetHistogram(name);
+  }
+
+  //----------------------------------------------------------------------------
+  // Two streams of the same client are compressed with different methods and different number of frames,
+  // as done by the OpenIGTLink server, which names the statistics IgtlServer.[port].Client[id].[stream].
+  PlusStatus TestStatisticsPerStream()
+  {
+    const int frameSize[3] = { 160, 120, 1 };
+    const std::string firstStreamPrefix = "IgtlServer.18944.Client1.Image_Reference.";
+    const std::string secondStreamPrefix = "IgtlServer.18944.Client1.Image_Probe.";
+    const int numberOfFirstStreamFrames = 3;
+    const int numberOfSecondStreamFrames = 5;
+
+    PlusVideoFrame frame;
+    if (frame.AllocateFrame(frameSize, VTK_UNSIGNED_CHAR, 1) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to allocate frame");
+      return PLUS_FAIL;
+    }
+
+    vtkSmartPointer<vtkPlusIgtlImageCompressor> firstCompressor = vtkSmartPointer<vtkPlusIgtlImageCompressor>::New();
+    firstCompressor->SetCompressionMethod(vtkPlusIgtlImageCompressor::COMPRESSION_ZLIB);
+    firstCompressor->SetStatisticsNamePrefix(firstStreamPrefix);
+    vtkSmartPointer<vtkPlusIgtlImageCompressor> secondCompressor = vtkSmartPointer<vtkPlusIgtlImageCompressor>::New();
+    secondCompressor->SetCompressionMethod(vtkPlusIgtlImageCompressor::COMPRESSION_DELTA_RLE);
+    secondCompressor->SetStatisticsNamePrefix(secondStreamPrefix);
+
+    std::vector<unsigned char> compressedData;
+    bool keyFrame = false;
+    for (int frameIndex = 0; frameIndex < numberOfSecondStreamFrames; ++frameIndex)
+    {
+      GenerateFrame(frame, frameIndex);
+      if ((frameIndex < numberOfFirstStreamFrames && firstCompressor->Compress(frame, compressedData, keyFrame) != PLUS_SUCCESS)
+          || secondCompressor->Compress(frame, compressedData, keyFrame) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to compress frame " << frameIndex);
+        return PLUS_FAIL;
+      }
+    }
+
+    PlusStatus status = PLUS_SUCCESS;
+    const std::string histogramNames[4] = { firstStreamPrefix + "CompressMs", firstStreamPrefix + "CompressionRatio", secondStreamPrefix + "CompressMs", secondStreamPrefix + "CompressionRatio" };
+    const uint64_t expectedNumberOfSamples[4] = { numberOfFirstStreamFrames, numberOfFirstStreamFrames, numberOfSecondStreamFrames, numberOfSecondStreamFrames };
+    for (int i = 0; i < 4; ++i)
+    {
+      PlusPerformanceHistogram* histogram = FindHistogram(histogramNames[i]);
+      if (histogram == NULL)
+      {
+        LOG_ERROR("Performance statistics " << histogramNames[i] << " is not reported");
+        status = PLUS_FAIL;
+        continue;
+      }
+      if (histogram->GetNumberOfSamples() != expectedNumberOfSamples[i])
+      {
+        LOG_ERROR("Performance statistics " << histogramNames[i] << " number of samples mismatch: expected " << expectedNumberOfSamples[i] << ", actual " << histogram->GetNumberOfSamples());
+        status = PLUS_FAIL;
+      }
+      PlusPerformanceStatistics::GetInstance()->ReleaseHistogram(histogram);
+    }
+
+    // Deleting the compressor of the first stream (stream is no longer compressed or client disconnected) removes only its statistics
+    firstCompressor = NULL;
+    for (int i = 0; i < 4; ++i)
+    {
+      bool expectedToExist = (i >= 2);
+      PlusPerformanceHistogram* histogram = FindHistogram(histogramNames[i]);
+      if ((histogram != NULL) != expectedToExist)
+      {
+        LOG_ERROR("Performance statistics " << histogramNames[i] << " is " << (expectedToExist ? "removed" : "not removed") << " after the compressor of the first stream is deleted");
+        status = PLUS_FAIL;
+      }
+      PlusPerformanceStatistics::GetInstance()->ReleaseHistogram(histogram);
+    }
+
+    secondCompressor = NULL;
+    if (FindHistogram(histogramNames[2]) != NULL || FindHistogram(histogramNames[3]) != NULL)
+    {
+      LOG_ERROR("Performance statistics of the second stream are not removed after its compressor is deleted");
+      status = PLUS_FAIL;
+    }
+
+    return status;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  const vtkPlusIgtlImageCompressor::CompressionMethodType methods[] =
+  {
+    vtkPlusIgtlImageCompressor::COMPRESSION_NONE,
+    vtkPlusIgtlImageCompressor::COMPRESSION_ZLIB,
+    vtkPlusIgtlImageCompressor::COMPRESSION_DELTA_RLE,
+    vtkPlusIgtlImageCompressor::COMPRESSION_DELTA_ZLIB
+  };
+  // Small frame is compressed in one band, large frame is split into multiple bands
+  const int smallFrameSize[3] = { 160, 120, 1 };
+  const int largeFrameSize[3] = { 1024, 768, 1 };
+
+  int numberOfFailures = 0;
+  for (unsigned int i = 0; i < sizeof(methods) / sizeof(methods[0]); ++i)
+  {
+    if (TestCompressionMethod(methods[i], smallFrameSize, 1, 1) != PLUS_SUCCESS)
+    {
+      ++numberOfFailures;
+    }
+    if (TestCompressionMethod(methods[i], largeFrameSize, 1, 4) != PLUS_SUCCESS)
+    {
+      ++numberOfFailures;
+    }
+    if (TestCompressionMethod(methods[i], largeFrameSize, 3, 3) != PLUS_SUCCESS)
+    {
+      ++numberOfFailures;
+    }
+  }
+
+  if (TestStatisticsPerStream() != PLUS_SUCCESS)
+  {
+    ++numberOfFailures;
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("vtkPlusIgtlImageCompressorTest failed");
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("vtkPlusIgtlImageCompressorTest completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,281 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Verify that vtkPlusIgtlImageProcessor crops, downsamples, and converts images to grayscale
+// the same way as a straightforward reference implementation, that processed frames are cached by option set,
+// and that the image messages of processed frames describe the downsampling by the spacing (with orthonormal normals).
+
+#include "PlusConfigure.h"
+#include "PlusVideoFrame.h"
+#include "igtlImageMessage.h"
+#include "vtkImageData.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusIgtlImageProcessor.h"
+#include "vtkPlusIgtlMessageCommon.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <cmath>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  void GenerateFrame(PlusVideoFrame& frame)
+  {
+    unsigned int frameSize[3] = { 0, 0, 0 };
+    frame.GetFrameSize(frameSize);
+    int numberOfComponents = frame.GetNumberOfScalarComponents();
+    unsigned char* pixels = static_cast<unsigned char*>(frame.GetScalarPointer());
+    for (unsigned int i = 0; i < frameSize[0] * frameSize[1] * frameSize[2] * numberOfComponents; ++i)
+    {
+      pixels[i] = static_cast<unsigned char>((i * 7919 + (i / 13) * 31) % 256);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Reference implementation: crop, downsample, then convert to grayscale, one pixel at a time
+  unsigned char GetExpectedPixel(const PlusVideoFrame& frame, const PlusIgtlClientInfo::ImageStream& options, int x, int y, int component)
+  {
+    unsigned int frameSize[3] = { 0, 0, 0 };
+    frame.GetFrameSize(frameSize);
+    int numberOfComponents = frame.GetNumberOfScalarComponents();
+    const unsigned char* pixels = static_cast<const unsigned char*>(frame.GetScalarPointer());
+    int factor = options.DownsamplingFactor;
+    int inputX = options.ClipRectangleOrigin[0] + x * factor;
+    int inputY = options.ClipRectangleOrigin[1] + y * factor;
+
+    // Grayscale value is the average of the R, G, B components
+    int firstComponent = options.Grayscale ? 0 : component;
+    int numberOfAveragedComponents = options.Grayscale ? 3 : 1;
+
+    unsigned int componentSum = 0;
+    for (int c = 0; c < numberOfAveragedComponents; ++c)
+    {
+      unsigned int blockSum = 0;
+      int blockSize = (options.DownsamplingMethod == PlusIgtlClientInfo::ImageStream::DOWNSAMPLING_AVERAGE) ? factor : 1;
+      for (int j = 0; j < blockSize; ++j)
+      {
+        for (int i = 0; i < blockSize; ++i)
+        {
+          blockSum += pixels[((inputY + j) * frameSize[0] + inputX + i) * numberOfComponents + firstComponent + c];
+        }
+      }
+      componentSum += (blockSum + blockSize * blockSize / 2) / (blockSize * blockSize);
+    }
+    return static_cast<unsigned char>(componentSum / numberOfAveragedComponents);
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus TestProcessing(vtkPlusIgtlImageProcessor* processor, const int frameSize[3], int numberOfComponents, const PlusIgtlClientInfo::ImageStream& options)
+  {
+    PlusVideoFrame frame;
+    if (frame.AllocateFrame(frameSize, VTK_UNSIGNED_CHAR, numberOfComponents) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to allocate frame");
+      return PLUS_FAIL;
+    }
+    GenerateFrame(frame);
+
+    processor->ResetCache();
+    const PlusVideoFrame* processedFrame = NULL;
+    vtkSmartPointer<vtkMatrix4x4> processedToInputImageTransform = vtkSmartPointer<vtkMatrix4x4>::New();
+    if (processor->GetProcessedFrame(frame, options, processedFrame, processedToInputImageTransform) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to process frame");
+      return PLUS_FAIL;
+    }
+
+    // The same options must return the cached frame
+    const PlusVideoFrame* cachedFrame = NULL;
+    if (processor->GetProcessedFrame(frame, options, cachedFrame, NULL) != PLUS_SUCCESS || cachedFrame != processedFrame)
+    {
+      LOG_ERROR("Processed frame is not cached");
+      return PLUS_FAIL;
+    }
+
+    unsigned int processedSize[3] = { 0, 0, 0 };
+    processedFrame->GetFrameSize(processedSize);
+    int expectedSize[2] = { options.ClipRectangleSize[0] / options.DownsamplingFactor, options.ClipRectangleSize[1] / options.DownsamplingFactor };
+    int expectedNumberOfComponents = options.Grayscale ? 1 : numberOfComponents;
+    if (static_cast<int>(processedSize[0]) != expectedSize[0] || static_cast<int>(processedSize[1]) != expectedSize[1]
+        || processedFrame->GetNumberOfScalarComponents() != expectedNumberOfComponents)
+    {
+      LOG_ERROR("Processed frame size mismatch: expected " << expectedSize[0] << "x" << expectedSize[1] << "x" << expectedNumberOfComponents
+                << ", actual " << processedSize[0] << "x" << processedSize[1] << "x" << processedFrame->GetNumberOfScalarComponents());
+      return PLUS_FAIL;
+    }
+
+    const unsigned char* processedPixels = static_cast<const unsigned char*>(processedFrame->GetScalarPointer());
+    for (int y = 0; y < expectedSize[1]; ++y)
+    {
+      for (int x = 0; x < expectedSize[0]; ++x)
+      {
+        for (int c = 0; c < expectedNumberOfComponents; ++c)
+        {
+          unsigned char expected = GetExpectedPixel(frame, options, x, y, c);
+          unsigned char actual = processedPixels[(y * expectedSize[0] + x) * expectedNumberOfComponents + c];
+          if (expected != actual)
+          {
+            LOG_ERROR("Pixel mismatch at (" << x << ", " << y << ", " << c << "): expected " << static_cast<int>(expected) << ", actual " << static_cast<int>(actual));
+            return PLUS_FAIL;
+          }
+        }
+      }
+    }
+
+    // The first processed pixel is at the clip origin (or at the center of the first averaged block)
+    double blockCenterOffset = (options.DownsamplingMethod == PlusIgtlClientInfo::ImageStream::DOWNSAMPLING_AVERAGE) ? (options.DownsamplingFactor - 1) / 2.0 : 0.0;
+    double expectedOrigin[2] = { options.ClipRectangleOrigin[0] + blockCenterOffset, options.ClipRectangleOrigin[1] + blockCenterOffset };
+    if (processedToInputImageTransform->GetElement(0, 3) != expectedOrigin[0] || processedToInputImageTransform->GetElement(1, 3) != expectedOrigin[1]
+        || processedToInputImageTransform->GetElement(0, 0) != 1.0 || processedToInputImageTransform->GetElement(1, 1) != 1.0)
+    {
+      LOG_ERROR("Processed to input image transform mismatch");
+      return PLUS_FAIL;
+    }
+
+    // The downsampling is described by the spacing
+    double processedSpacing[3] = { 0.0, 0.0, 0.0 };
+    processedFrame->GetImage()->GetSpacing(processedSpacing);
+    if (processedSpacing[0] != options.DownsamplingFactor || processedSpacing[1] != options.DownsamplingFactor || processedSpacing[2] != 1.0)
+    {
+      LOG_ERROR("Processed frame spacing mismatch: expected " << options.DownsamplingFactor << ", actual " << processedSpacing[0] << ", " << processedSpacing[1] << ", " << processedSpacing[2]);
+      return PLUS_FAIL;
+    }
+
+    // The image message sent to the clients must have orthonormal normals and the spacing of the processed frame
+    igtl::ImageMessage::Pointer imageMessage = igtl::ImageMessage::New();
+    if (vtkPlusIgtlMessageCommon::PackImageMessage(imageMessage, *processedFrame, 0.0, *processedToInputImageTransform) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to pack image message of the processed frame");
+      return PLUS_FAIL;
+    }
+    float normals[3][3];
+    imageMessage->GetNormals(normals[0], normals[1], normals[2]);
+    for (int i = 0; i < 3; ++i)
+    {
+      for (int j = 0; j < 3; ++j)
+      {
+        double dotProduct = normals[i][0] * normals[j][0] + normals[i][1] * normals[j][1] + normals[i][2] * normals[j][2];
+        if (std::abs(dotProduct - (i == j ? 1.0 : 0.0)) > 1e-5)
+        {
+          LOG_ERROR("Image message normals are not orthonormal: normal " << i << " . normal " << j << " = " << dotProduct);
+          return PLUS_FAIL;
+        }
+      }
+    }
+    float messageSpacing[3] = { 0.0f, 0.0f, 0.0f };
+    imageMessage->GetSpacing(messageSpacing);
+    if (std::abs(messageSpacing[0] - options.DownsamplingFactor) > 1e-5 || std::abs(messageSpacing[1] - options.DownsamplingFactor) > 1e-5)
+    {
+      LOG_ERROR("Image message spacing mismatch: expected " << options.DownsamplingFactor << ", actual " << messageSpacing[0] << ", " << messageSpacing[1]);
+      return PLUS_FAIL;
+    }
+
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusIgtlClientInfo::ImageStream CreateOptions(int originX, int originY, int sizeX, int sizeY, int factor, PlusIgtlClientInfo::ImageStream::DownsamplingMethodType method, bool grayscale)
+  {
+    PlusIgtlClientInfo::ImageStream options;
+    options.ClipRectangleOrigin[0] = originX;
+    options.ClipRectangleOrigin[1] = originY;
+    options.ClipRectangleOrigin[2] = 0;
+    options.ClipRectangleSize[0] = sizeX;
+    options.ClipRectangleSize[1] = sizeY;
+    options.ClipRectangleSize[2] = 1;
+    options.DownsamplingFactor = factor;
+    options.DownsamplingMethod = method;
+    options.Grayscale = grayscale;
+    return options;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  vtkSmartPointer<vtkPlusIgtlImageProcessor> processor = vtkSmartPointer<vtkPlusIgtlImageProcessor>::New();
+  const int frameSize[3] = { 160, 120, 1 };
+  int numberOfFailures = 0;
+
+  // Grayscale images: vectorized 2x averaging (odd widths exercise the remainder loop), generic averaging, decimation
+  if (TestProcessing(processor, frameSize, 1, CreateOptions(0, 0, 160, 120, 2, PlusIgtlClientInfo::ImageStream::DOWNSAMPLING_AVERAGE, false)) != PLUS_SUCCESS)
+  {
+    ++numberOfFailures;
+  }
+  if (TestProcessing(processor, frameSize, 1, CreateOptions(5, 3, 101, 77, 2, PlusIgtlClientInfo::ImageStream::DOWNSAMPLING_AVERAGE, false)) != PLUS_SUCCESS)
+  {
+    ++numberOfFailures;
+  }
+  if (TestProcessing(processor, frameSize, 1, CreateOptions(7, 9, 100, 90, 3, PlusIgtlClientInfo::ImageStream::DOWNSAMPLING_AVERAGE, false)) != PLUS_SUCCESS)
+  {
+    ++numberOfFailures;
+  }
+  if (TestProcessing(processor, frameSize, 1, CreateOptions(7, 9, 100, 90, 4, PlusIgtlClientInfo::ImageStream::DOWNSAMPLING_DECIMATE, false)) != PLUS_SUCCESS)
+  {
+    ++numberOfFailures;
+  }
+
+  // Color images: crop only, averaging with and without grayscale conversion
+  if (TestProcessing(processor, frameSize, 3, CreateOptions(10, 20, 64, 48, 1, PlusIgtlClientInfo::ImageStream::DOWNSAMPLING_AVERAGE, false)) != PLUS_SUCCESS)
+  {
+    ++numberOfFailures;
+  }
+  if (TestProcessing(processor, frameSize, 3, CreateOptions(10, 20, 64, 48, 2, PlusIgtlClientInfo::ImageStream::DOWNSAMPLING_AVERAGE, false)) != PLUS_SUCCESS)
+  {
+    ++numberOfFailures;
+  }
+  if (TestProcessing(processor, frameSize, 3, CreateOptions(1, 2, 150, 110, 2, PlusIgtlClientInfo::ImageStream::DOWNSAMPLING_AVERAGE, true)) != PLUS_SUCCESS)
+  {
+    ++numberOfFailures;
+  }
+  if (TestProcessing(processor, frameSize, 4, CreateOptions(0, 0, 160, 120, 1, PlusIgtlClientInfo::ImageStream::DOWNSAMPLING_DECIMATE, true)) != PLUS_SUCCESS)
+  {
+    ++numberOfFailures;
+  }
+
+  // Without any processing options the input frame is used directly
+  PlusVideoFrame frame;
+  frame.AllocateFrame(frameSize, VTK_UNSIGNED_CHAR, 1);
+  const PlusVideoFrame* processedFrame = NULL;
+  if (processor->GetProcessedFrame(frame, PlusIgtlClientInfo::ImageStream(), processedFrame, NULL) != PLUS_SUCCESS || processedFrame != &frame)
+  {
+    LOG_ERROR("Input frame is not used directly when no processing is requested");
+    ++numberOfFailures;
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("vtkPlusIgtlImageProcessorTest failed");
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("vtkPlusIgtlImageProcessorTest completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,66 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "igtlPlusClientSocket.h"
+
+#ifdef _WIN32
+  #include <Winsock2.h>
+#else
+  #include <errno.h>
+  #include <sys/select.h>
+  #include <sys/time.h>
+#endif
+
+namespace igtl
+{
+
+//----------------------------------------------------------------------------
+PlusClientSocket::PlusClientSocket() : ClientSocket()
+{
+}
+
+//----------------------------------------------------------------------------
+PlusClientSocket::~PlusClientSocket()
+{
+}
+
+//----------------------------------------------------------------------------
+int PlusClientSocket::WaitForData(double timeoutSec)
+{
+  if (!this->GetConnected())
+  {
+    return -1;
+  }
+
+  fd_set readSockets;
+  FD_ZERO(&readSockets);
+  FD_SET(this->m_SocketDescriptor, &readSockets);
+
+  if (timeoutSec < 0)
+  {
+    timeoutSec = 0;
+  }
+  struct timeval timeout;
+  timeout.tv_sec = static_cast<long>(timeoutSec);
+  timeout.tv_usec = static_cast<long>((timeoutSec - timeout.tv_sec) * 1000000.0);
+
+  int result = select(this->m_SocketDescriptor + 1, &readSockets, NULL, NULL, &timeout);
+  if (result < 0)
+  {
+#ifndef _WIN32
+    if (errno == EINTR)
+    {
+      // Interrupted by a signal, report it as a timeout and let the caller wait again
+      return 0;
+    }
+#endif
+    return -1;
+  }
+  return (result > 0 && FD_ISSET(this->m_SocketDescriptor, &readSockets)) ? 1 : 0;
+}
+
+} // namespace igtl
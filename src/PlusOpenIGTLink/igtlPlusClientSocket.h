@@ -0,0 +1,53 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __igtlPlusClientSocket_h
+#define __igtlPlusClientSocket_h
+
+#include "vtkPlusOpenIGTLinkExport.h"
+
+#include "igtlClientSocket.h"
+
+namespace igtl
+{
+
+/*!
+  \class PlusClientSocket
+  \brief OpenIGTLink client socket that can wait for incoming data without reading it
+
+  Receive blocks until the requested number of bytes arrive or the receive timeout elapses.
+  WaitForData allows checking if a message is already available (or waiting for it with a
+  timeout) so that all the pending messages can be read without any unnecessary delay.
+
+  \ingroup PlusLibOpenIGTLink
+*/
+class vtkPlusOpenIGTLinkExport PlusClientSocket: public ClientSocket
+{
+public:
+  typedef PlusClientSocket               Self;
+  typedef ClientSocket                   Superclass;
+  typedef SmartPointer<Self>             Pointer;
+  typedef SmartPointer<const Self>       ConstPointer;
+
+  igtlTypeMacro( igtl::PlusClientSocket, igtl::ClientSocket );
+  igtlNewMacro( igtl::PlusClientSocket );
+
+public:
+  /*!
+    Wait until data can be read from the socket, for at most timeoutSec seconds (0 means checking without waiting).
+    Returns 1 if data is available (or the connection is closed by the peer, which is reported by the next Receive call),
+    0 if no data arrived within the timeout, -1 if the socket is not connected or there is a socket error.
+  */
+  int WaitForData( double timeoutSec );
+
+protected:
+  PlusClientSocket();
+  ~PlusClientSocket();
+};
+
+} // namespace igtl
+
+#endif
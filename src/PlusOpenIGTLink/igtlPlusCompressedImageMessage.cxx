@@ -0,0 +1,198 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "igtlPlusCompressedImageMessage.h"
+#include "vtkPlusIgtlMessageFactory.h"
+
+namespace igtl
+{
+  //----------------------------------------------------------------------------
+  PlusCompressedImageMessage::PlusCompressedImageMessage()
+    : MessageBase()
+  {
+    this->m_SendMessageType = "COMPIMAGE";
+  }
+
+  //----------------------------------------------------------------------------
+  PlusCompressedImageMessage::~PlusCompressedImageMessage()
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  igtl::MessageBase::Pointer PlusCompressedImageMessage::Clone()
+  {
+    igtl::MessageBase::Pointer clone;
+    {
+      vtkSmartPointer<vtkPlusIgtlMessageFactory> factory = vtkSmartPointer<vtkPlusIgtlMessageFactory>::New();
+      clone = dynamic_cast<igtl::MessageBase*>(factory->CreateSendMessage(this->GetMessageType(), this->GetHeaderVersion()).GetPointer());
+    }
+
+    igtl::PlusCompressedImageMessage::Pointer msg = dynamic_cast<igtl::PlusCompressedImageMessage*>(clone.GetPointer());
+
+    int bodySize = this->m_MessageSize - IGTL_HEADER_SIZE;
+    msg->InitBuffer();
+    msg->CopyHeader(this);
+    msg->AllocateBuffer(bodySize);
+    if (bodySize > 0)
+    {
+      msg->CopyBody(this);
+    }
+
+    return clone;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus PlusCompressedImageMessage::SetImageProperties(const PlusVideoFrame& frame)
+  {
+    unsigned int frameSize[3] = { 0, 0, 0 };
+    frame.GetFrameSize(frameSize);
+    if (frameSize[0] > static_cast<unsigned int>(std::numeric_limits<igtl_uint16>::max()) ||
+        frameSize[1] > static_cast<unsigned int>(std::numeric_limits<igtl_uint16>::max()) ||
+        frameSize[2] > static_cast<unsigned int>(std::numeric_limits<igtl_uint16>::max()))
+    {
+      LOG_ERROR("Frame size element is too large to be sent over OpenIGTLink. Cannot set compressed image.");
+      return PLUS_FAIL;
+    }
+
+    this->m_MessageHeader.m_FrameSize[0] = frameSize[0];
+    this->m_MessageHeader.m_FrameSize[1] = frameSize[1];
+    this->m_MessageHeader.m_FrameSize[2] = frameSize[2];
+    this->m_MessageHeader.m_ScalarType = PlusVideoFrame::GetIGTLScalarPixelTypeFromVTK(frame.GetVTKScalarPixelType());
+    this->m_MessageHeader.m_NumberOfComponents = frame.GetNumberOfScalarComponents();
+    this->m_MessageHeader.m_ImageType = frame.GetImageType();
+    this->m_MessageHeader.m_ImageOrientation = (igtl_uint16)frame.GetImageOrientation();
+
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus PlusCompressedImageMessage::AllocateFrame(PlusVideoFrame& frame)
+  {
+    int frameSize[3] = { this->m_MessageHeader.m_FrameSize[0], this->m_MessageHeader.m_FrameSize[1], this->m_MessageHeader.m_FrameSize[2] };
+    if (frame.AllocateFrame(frameSize, PlusVideoFrame::GetVTKScalarPixelTypeFromIGTL(this->m_MessageHeader.m_ScalarType), this->m_MessageHeader.m_NumberOfComponents) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to allocate memory for frame received in Plus compressed image message");
+      return PLUS_FAIL;
+    }
+    // Carry the image type forward
+    frame.SetImageType((US_IMAGE_TYPE)this->m_MessageHeader.m_ImageType);
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  void PlusCompressedImageMessage::SetCompression(int compressionMethod, bool keyFrame)
+  {
+    this->m_MessageHeader.m_CompressionMethod = compressionMethod;
+    this->m_MessageHeader.m_Flags = keyFrame ? FLAG_KEY_FRAME : 0;
+  }
+
+  //----------------------------------------------------------------------------
+  int PlusCompressedImageMessage::GetCompressionMethod()
+  {
+    return this->m_MessageHeader.m_CompressionMethod;
+  }
+
+  //----------------------------------------------------------------------------
+  bool PlusCompressedImageMessage::IsKeyFrame()
+  {
+    return (this->m_MessageHeader.m_Flags & FLAG_KEY_FRAME) != 0;
+  }
+
+  //----------------------------------------------------------------------------
+  std::vector<unsigned char>& PlusCompressedImageMessage::GetCompressedDataBuffer()
+  {
+    return this->m_CompressedData;
+  }
+
+  //----------------------------------------------------------------------------
+  const unsigned char* PlusCompressedImageMessage::GetCompressedData()
+  {
+    return this->m_Content + this->m_MessageHeader.GetMessageHeaderSize();
+  }
+
+  //----------------------------------------------------------------------------
+  size_t PlusCompressedImageMessage::GetCompressedDataSize()
+  {
+    return this->m_MessageHeader.m_CompressedDataSizeInBytes;
+  }
+
+  //----------------------------------------------------------------------------
+  void PlusCompressedImageMessage::SetEmbeddedImageTransform(const vtkMatrix4x4& matrix)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      for (int j = 0; j < 4; ++j)
+      {
+        this->m_MessageHeader.m_EmbeddedImageTransform[i][j] = matrix.GetElement(i, j);
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void PlusCompressedImageMessage::GetEmbeddedImageTransform(vtkMatrix4x4* matrix)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      for (int j = 0; j < 4; ++j)
+      {
+        matrix->SetElement(i, j, this->m_MessageHeader.m_EmbeddedImageTransform[i][j]);
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  int PlusCompressedImageMessage::CalculateContentBufferSize()
+  {
+    return this->m_MessageHeader.GetMessageHeaderSize() + this->m_CompressedData.size();
+  }
+
+  //----------------------------------------------------------------------------
+  int PlusCompressedImageMessage::PackContent()
+  {
+    AllocateBuffer();
+
+    this->m_MessageHeader.m_CompressedDataSizeInBytes = this->m_CompressedData.size();
+
+    // Copy header
+    CompressedImageHeader* header = (CompressedImageHeader*)(this->m_Content);
+    memcpy(header, &(this->m_MessageHeader), this->m_MessageHeader.GetMessageHeaderSize());
+
+    // Copy compressed pixel data
+    if (!this->m_CompressedData.empty())
+    {
+      memcpy(this->m_Content + this->m_MessageHeader.GetMessageHeaderSize(), &(this->m_CompressedData[0]), this->m_CompressedData.size());
+    }
+
+    // Convert header endian
+    header->ConvertEndianness();
+
+    return 1;
+  }
+
+  //----------------------------------------------------------------------------
+  int PlusCompressedImageMessage::UnpackContent()
+  {
+    size_t headerSize = this->m_MessageHeader.GetMessageHeaderSize();
+    if (static_cast<size_t>(this->GetBufferBodySize()) < headerSize)
+    {
+      LOG_ERROR("Plus compressed image message is too short");
+      return 0;
+    }
+
+    // Copy header and convert header endian
+    memcpy(&(this->m_MessageHeader), this->m_Content, headerSize);
+    this->m_MessageHeader.ConvertEndianness();
+
+    if (headerSize + this->m_MessageHeader.m_CompressedDataSizeInBytes > static_cast<size_t>(this->GetBufferBodySize()))
+    {
+      LOG_ERROR("Plus compressed image message is incomplete");
+      return 0;
+    }
+
+    return 1;
+  }
+}
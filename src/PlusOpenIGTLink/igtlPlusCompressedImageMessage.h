@@ -0,0 +1,171 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __igtlPlusCompressedImageMessage_h
+#define __igtlPlusCompressedImageMessage_h
+
+#include "vtkPlusOpenIGTLinkExport.h"
+
+#include "PlusVideoFrame.h"
+#include "igtl_types.h"
+#include "igtl_win32header.h"
+#include "igtlMessageBase.h"
+#include "igtlObject.h"
+#include "igtl_header.h"
+#include "igtl_util.h"
+#include "vtkMatrix4x4.h"
+#include <vector>
+
+namespace igtl
+{
+  // This command prevents 4-byte alignment in the struct (which enables m_FrameSize[3])
+#pragma pack(1)     /* For 1-byte boundary in memory */
+
+  /*!
+    \class PlusCompressedImageMessage
+    \brief IGTL message helper class for losslessly compressed image messages
+
+    The message contains the image geometry, the embedded image transform, and the
+    pixel data compressed by vtkPlusIgtlImageCompressor. Delta compressed frames can
+    only be decoded if all the previous frames of the same device have been decoded
+    since the last key frame.
+
+    \ingroup PlusLibOpenIGTLink
+  */
+  class vtkPlusOpenIGTLinkExport PlusCompressedImageMessage: public MessageBase
+  {
+  public:
+    typedef PlusCompressedImageMessage      Self;
+    typedef MessageBase                     Superclass;
+    typedef SmartPointer<Self>              Pointer;
+    typedef SmartPointer<const Self>        ConstPointer;
+
+    igtlTypeMacro(igtl::PlusCompressedImageMessage, igtl::MessageBase);
+    igtlNewMacro(igtl::PlusCompressedImageMessage);
+
+  public:
+    /*! Override clone so that we use the plus igtl factory */
+    virtual igtl::MessageBase::Pointer Clone();
+
+    /*! Set image geometry, pixel type, and image type from the uncompressed frame */
+    PlusStatus SetImageProperties(const PlusVideoFrame& frame);
+
+    /*! Allocate the frame with the geometry and pixel type of the received image */
+    PlusStatus AllocateFrame(PlusVideoFrame& frame);
+
+    /*! Set the compression method (vtkPlusIgtlImageCompressor::CompressionMethodType) and key frame flag */
+    void SetCompression(int compressionMethod, bool keyFrame);
+    int GetCompressionMethod();
+    bool IsKeyFrame();
+
+    /*! Buffer that the compressed pixel data is written to before packing the message */
+    std::vector<unsigned char>& GetCompressedDataBuffer();
+
+    /*! Get compressed pixel data of an unpacked message. The data is stored in the message buffer. */
+    const unsigned char* GetCompressedData();
+    size_t GetCompressedDataSize();
+
+    /*! Set the embedded transform of the underlying image */
+    void SetEmbeddedImageTransform(const vtkMatrix4x4& matrix);
+
+    /*! Get the embedded transform of the underlying image */
+    void GetEmbeddedImageTransform(vtkMatrix4x4* matrix);
+
+  protected:
+    class CompressedImageHeader
+    {
+    public:
+      CompressedImageHeader()
+        : m_ScalarType(0)
+        , m_NumberOfComponents(0)
+        , m_ImageType(0)
+        , m_ImageOrientation(0)
+        , m_CompressionMethod(0)
+        , m_Flags(0)
+        , m_CompressedDataSizeInBytes(0)
+      {
+        m_FrameSize[0] = m_FrameSize[1] = m_FrameSize[2] = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+          for (int j = 0; j < 4; ++j)
+          {
+            m_EmbeddedImageTransform[i][j] = (i == j) ? 1.f : 0.f;
+          }
+        }
+      }
+
+      size_t GetMessageHeaderSize()
+      {
+        size_t headersize = 0;
+        headersize += sizeof(igtl_uint16);        // m_ScalarType
+        headersize += sizeof(igtl_uint16);        // m_NumberOfComponents
+        headersize += sizeof(igtl_uint16);        // m_ImageType
+        headersize += sizeof(igtl_uint16) * 3;    // m_FrameSize[3]
+        headersize += sizeof(igtl_uint16);        // m_ImageOrientation
+        headersize += sizeof(igtl_uint16);        // m_CompressionMethod
+        headersize += sizeof(igtl_uint16);        // m_Flags
+        headersize += sizeof(igtl_uint32);        // m_CompressedDataSizeInBytes
+        headersize += sizeof(igtl::Matrix4x4);    // m_EmbeddedImageTransform[4][4]
+
+        return headersize;
+      }
+
+      void ConvertEndianness()
+      {
+        if (igtl_is_little_endian())
+        {
+          m_ScalarType = BYTE_SWAP_INT16(m_ScalarType);
+          m_NumberOfComponents = BYTE_SWAP_INT16(m_NumberOfComponents);
+          m_ImageType = BYTE_SWAP_INT16(m_ImageType);
+          m_FrameSize[0] = BYTE_SWAP_INT16(m_FrameSize[0]);
+          m_FrameSize[1] = BYTE_SWAP_INT16(m_FrameSize[1]);
+          m_FrameSize[2] = BYTE_SWAP_INT16(m_FrameSize[2]);
+          m_ImageOrientation = BYTE_SWAP_INT16(m_ImageOrientation);
+          m_CompressionMethod = BYTE_SWAP_INT16(m_CompressionMethod);
+          m_Flags = BYTE_SWAP_INT16(m_Flags);
+          m_CompressedDataSizeInBytes = BYTE_SWAP_INT32(m_CompressedDataSizeInBytes);
+          igtl_uint32* matrixElements = reinterpret_cast<igtl_uint32*>(m_EmbeddedImageTransform);
+          for (int i = 0; i < 16; ++i)
+          {
+            matrixElements[i] = BYTE_SWAP_INT32(matrixElements[i]);
+          }
+        }
+      }
+
+      igtl_uint16     m_ScalarType;                 /* scalar type */
+      igtl_uint16     m_NumberOfComponents;         /* number of scalar components */
+      igtl_uint16     m_ImageType;                  /* image type */
+      igtl_uint16     m_FrameSize[3];               /* entire image volume size */
+      igtl_uint16     m_ImageOrientation;           /* orientation of the image */
+      igtl_uint16     m_CompressionMethod;          /* compression method of the pixel data */
+      igtl_uint16     m_Flags;                      /* bit 0: key frame */
+      igtl_uint32     m_CompressedDataSizeInBytes;  /* size of the compressed pixel data, in bytes */
+      igtl::Matrix4x4 m_EmbeddedImageTransform;     /* matrix representing the IJK to world transformation */
+    };
+
+    enum
+    {
+      FLAG_KEY_FRAME = 0x0001
+    };
+
+    virtual int  CalculateContentBufferSize();
+    virtual int  PackContent();
+    virtual int  UnpackContent();
+
+    PlusCompressedImageMessage();
+    ~PlusCompressedImageMessage();
+
+    CompressedImageHeader m_MessageHeader;
+
+    /*! Compressed pixel data to be packed */
+    std::vector<unsigned char> m_CompressedData;
+  };
+
+#pragma pack()
+
+} // namespace igtl
+
+#endif
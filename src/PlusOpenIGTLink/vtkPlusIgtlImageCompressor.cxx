@@ -0,0 +1,612 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusPerformanceStatistics.h"
+#include "PlusVideoFrame.h"
+#include "vtkPlusIgtlImageCompressor.h"
+
+#include "vtkObjectFactory.h"
+#include "vtk_zlib.h"
+
+#include <algorithm>
+
+vtkStandardNewMacro(vtkPlusIgtlImageCompressor);
+
+namespace
+{
+  // Bands smaller than this are not worth compressing in a separate thread
+  const size_t MINIMUM_BAND_SIZE_BYTES = 256 * 1024;
+
+  // Upper limit for the number of bands in received data, to reject corrupted data
+  const unsigned int MAXIMUM_NUMBER_OF_BANDS = 1024;
+
+  // Zero runs shorter than this are stored as literals
+  const size_t MINIMUM_ZERO_RUN_LENGTH = 4;
+
+  //----------------------------------------------------------------------------
+  void WriteUint32(unsigned char* output, uint32_t value)
+  {
+    output[0] = static_cast<unsigned char>(value >> 24);
+    output[1] = static_cast<unsigned char>(value >> 16);
+    output[2] = static_cast<unsigned char>(value >> 8);
+    output[3] = static_cast<unsigned char>(value);
+  }
+
+  //----------------------------------------------------------------------------
+  uint32_t ReadUint32(const unsigned char* input)
+  {
+    return (static_cast<uint32_t>(input[0]) << 24) | (static_cast<uint32_t>(input[1]) << 16) | (static_cast<uint32_t>(input[2]) << 8) | static_cast<uint32_t>(input[3]);
+  }
+
+  //----------------------------------------------------------------------------
+  // Write an unsigned integer using 7 bits per byte, the highest bit indicates that more bytes follow
+  void WriteVariableLengthInteger(unsigned char*& output, size_t value)
+  {
+    while (value >= 0x80)
+    {
+      *(output++) = static_cast<unsigned char>(value | 0x80);
+      value >>= 7;
+    }
+    *(output++) = static_cast<unsigned char>(value);
+  }
+
+  //----------------------------------------------------------------------------
+  bool ReadVariableLengthInteger(const unsigned char*& input, const unsigned char* inputEnd, size_t& value)
+  {
+    value = 0;
+    for (unsigned int shift = 0; shift < sizeof(size_t) * 8; shift += 7)
+    {
+      if (input >= inputEnd)
+      {
+        return false;
+      }
+      unsigned char byte = *(input++);
+      value |= static_cast<size_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  //----------------------------------------------------------------------------
+  bool IsDeltaCompression(vtkPlusIgtlImageCompressor::CompressionMethodType method)
+  {
+    return method == vtkPlusIgtlImageCompressor::COMPRESSION_DELTA_RLE || method == vtkPlusIgtlImageCompressor::COMPRESSION_DELTA_ZLIB;
+  }
+
+  //----------------------------------------------------------------------------
+  // Run-length encoding is only efficient for difference images, so key frames are compressed with zlib
+  vtkPlusIgtlImageCompressor::CompressionMethodType GetBandCompressionMethod(vtkPlusIgtlImageCompressor::CompressionMethodType method, bool keyFrame)
+  {
+    if (method == vtkPlusIgtlImageCompressor::COMPRESSION_DELTA_RLE && keyFrame)
+    {
+      return vtkPlusIgtlImageCompressor::COMPRESSION_ZLIB;
+    }
+    return method;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkPlusIgtlImageCompressor::vtkPlusIgtlImageCompressor()
+  : CompressionMethod(COMPRESSION_ZLIB)
+  , NumberOfThreads(0)
+  , KeyFrameInterval(30)
+  , ZlibCompressionLevel(1)
+  , NumberOfFramesSinceKeyFrame(0)
+  , Threader(vtkMultiThreader::New())
+  , CompressionRatioStatistics(NULL)
+  , CompressStatistics(NULL)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusIgtlImageCompressor::~vtkPlusIgtlImageCompressor()
+{
+  DELETE_IF_NOT_NULL(this->Threader);
+  PlusPerformanceStatistics::GetInstance()->ReleaseHistogram(this->CompressionRatioStatistics);
+  PlusPerformanceStatistics::GetInstance()->ReleaseHistogram(this->CompressStatistics);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlImageCompressor::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "CompressionMethod: " << GetStringFromCompressionMethod(this->CompressionMethod) << std::endl;
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << std::endl;
+  os << indent << "KeyFrameInterval: " << this->KeyFrameInterval << std::endl;
+  os << indent << "ZlibCompressionLevel: " << this->ZlibCompressionLevel << std::endl;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusIgtlImageCompressor::GetStringFromCompressionMethod(CompressionMethodType method)
+{
+  switch (method)
+  {
+    case COMPRESSION_NONE:
+      return "NONE";
+    case COMPRESSION_ZLIB:
+      return "ZLIB";
+    case COMPRESSION_DELTA_RLE:
+      return "DELTA_RLE";
+    case COMPRESSION_DELTA_ZLIB:
+      return "DELTA_ZLIB";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlImageCompressor::GetCompressionMethodFromString(const std::string& methodName, CompressionMethodType& method)
+{
+  const CompressionMethodType methods[] = { COMPRESSION_NONE, COMPRESSION_ZLIB, COMPRESSION_DELTA_RLE, COMPRESSION_DELTA_ZLIB };
+  for (unsigned int i = 0; i < sizeof(methods) / sizeof(methods[0]); ++i)
+  {
+    if (PlusCommon::IsEqualInsensitive(methodName, GetStringFromCompressionMethod(methods[i])))
+    {
+      method = methods[i];
+      return PLUS_SUCCESS;
+    }
+  }
+  return PLUS_FAIL;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlImageCompressor::SetCompressionMethod(CompressionMethodType method)
+{
+  if (this->CompressionMethod == method)
+  {
+    return;
+  }
+  this->CompressionMethod = method;
+  this->ResetReferenceFrame();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlImageCompressor::SetStatisticsNamePrefix(const std::string& statisticsNamePrefix)
+{
+  PlusPerformanceStatistics::GetInstance()->ReleaseHistogram(this->CompressionRatioStatistics);
+  PlusPerformanceStatistics::GetInstance()->ReleaseHistogram(this->CompressStatistics);
+  this->CompressionRatioStatistics = PlusPerformanceStatistics::GetInstance()->GetHistogram(statisticsNamePrefix + "CompressionRatio", "x");
+  this->CompressStatistics = PlusPerformanceStatistics::GetInstance()->GetHistogram(statisticsNamePrefix + "CompressMs");
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlImageCompressor::ResetReferenceFrame()
+{
+  this->ReferenceFrame.clear();
+  this->NumberOfFramesSinceKeyFrame = 0;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusIgtlImageCompressor::GetNumberOfBands(size_t frameSizeInBytes)
+{
+  int maximumNumberOfBands = (this->NumberOfThreads > 0) ? this->NumberOfThreads : vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  maximumNumberOfBands = std::max(1, std::min(maximumNumberOfBands, VTK_MAX_THREADS));
+  size_t numberOfBands = frameSizeInBytes / MINIMUM_BAND_SIZE_BYTES;
+  return static_cast<int>(std::max<size_t>(1, std::min<size_t>(numberOfBands, maximumNumberOfBands)));
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlImageCompressor::GetBandRange(const BandTask& task, int band, size_t& start, size_t& size)
+{
+  start = static_cast<size_t>(static_cast<uint64_t>(task.FrameSizeInBytes) * band / task.NumberOfBands);
+  size_t end = static_cast<size_t>(static_cast<uint64_t>(task.FrameSizeInBytes) * (band + 1) / task.NumberOfBands);
+  size = end - start;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlImageCompressor::ExecuteBandTask(vtkThreadFunctionType function, BandTask& task)
+{
+  task.Self = this;
+  task.BandSucceeded.assign(task.NumberOfBands, 0);
+  if (task.NumberOfBands == 1)
+  {
+    // No need for starting a thread
+    vtkMultiThreader::ThreadInfo threadInfo;
+    threadInfo.ThreadID = 0;
+    threadInfo.NumberOfThreads = 1;
+    threadInfo.UserData = &task;
+    function(&threadInfo);
+  }
+  else
+  {
+    this->Threader->SetNumberOfThreads(task.NumberOfBands);
+    this->Threader->SetSingleMethod(function, &task);
+    this->Threader->SingleMethodExecute();
+  }
+  for (int band = 0; band < task.NumberOfBands; ++band)
+  {
+    if (!task.BandSucceeded[band])
+    {
+      return PLUS_FAIL;
+    }
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkPlusIgtlImageCompressor::CompressBandThreadFunction(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  BandTask* task = static_cast<BandTask*>(threadInfo->UserData);
+  task->BandSucceeded[threadInfo->ThreadID] = CompressBand(*task, threadInfo->ThreadID) ? 1 : 0;
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkPlusIgtlImageCompressor::DecompressBandThreadFunction(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  BandTask* task = static_cast<BandTask*>(threadInfo->UserData);
+  task->BandSucceeded[threadInfo->ThreadID] = DecompressBand(*task, threadInfo->ThreadID) ? 1 : 0;
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusIgtlImageCompressor::CompressBand(BandTask& task, int band)
+{
+  size_t start = 0;
+  size_t size = 0;
+  GetBandRange(task, band, start, size);
+  const unsigned char* input = task.Frame + start;
+  std::vector<unsigned char>& output = task.Self->BandBuffers[band];
+
+  // Compute the difference from the previous frame and update the reference frame
+  const unsigned char* source = input;
+  if (IsDeltaCompression(task.Method))
+  {
+    unsigned char* reference = &(task.Self->ReferenceFrame[start]);
+    if (!task.KeyFrame)
+    {
+      std::vector<unsigned char>& difference = task.Self->DifferenceBuffers[band];
+      if (difference.size() < size)
+      {
+        difference.resize(size);
+      }
+      for (size_t i = 0; i < size; ++i)
+      {
+        difference[i] = static_cast<unsigned char>(input[i] - reference[i]);
+      }
+      source = &difference[0];
+    }
+    memcpy(reference, input, size);
+  }
+
+  switch (GetBandCompressionMethod(task.Method, task.KeyFrame))
+  {
+    case COMPRESSION_NONE:
+    {
+      if (output.size() < size)
+      {
+        output.resize(size);
+      }
+      memcpy(&output[0], source, size);
+      task.CompressedBandSizes[band] = size;
+      return true;
+    }
+    case COMPRESSION_ZLIB:
+    case COMPRESSION_DELTA_ZLIB:
+    {
+      uLongf compressedSize = compressBound(static_cast<uLong>(size));
+      if (output.size() < compressedSize)
+      {
+        output.resize(compressedSize);
+      }
+      if (compress2(&output[0], &compressedSize, source, static_cast<uLong>(size), task.Self->ZlibCompressionLevel) != Z_OK)
+      {
+        return false;
+      }
+      task.CompressedBandSizes[band] = compressedSize;
+      return true;
+    }
+    case COMPRESSION_DELTA_RLE:
+    {
+      // Worst case is a 1-byte literal after each minimum length zero run (3 bytes for every 5 input bytes)
+      size_t maximumCompressedSize = size + size / 2 + 32;
+      if (output.size() < maximumCompressedSize)
+      {
+        output.resize(maximumCompressedSize);
+      }
+      task.CompressedBandSizes[band] = RunLengthEncode(source, size, &output[0]);
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusIgtlImageCompressor::DecompressBand(BandTask& task, int band)
+{
+  size_t start = 0;
+  size_t size = 0;
+  GetBandRange(task, band, start, size);
+  unsigned char* output = task.Frame + start;
+  const unsigned char* input = task.CompressedData + task.CompressedBandOffsets[band];
+  size_t inputSize = task.CompressedBandSizes[band];
+
+  // Difference images are decoded into a temporary buffer and then added to the reference frame
+  const bool deltaFrame = IsDeltaCompression(task.Method) && !task.KeyFrame;
+  unsigned char* target = output;
+  if (deltaFrame)
+  {
+    std::vector<unsigned char>& difference = task.Self->BandBuffers[band];
+    if (difference.size() < size)
+    {
+      difference.resize(size);
+    }
+    target = &difference[0];
+  }
+
+  switch (GetBandCompressionMethod(task.Method, task.KeyFrame))
+  {
+    case COMPRESSION_NONE:
+    {
+      if (inputSize != size)
+      {
+        return false;
+      }
+      memcpy(target, input, size);
+      break;
+    }
+    case COMPRESSION_ZLIB:
+    case COMPRESSION_DELTA_ZLIB:
+    {
+      uLongf decompressedSize = static_cast<uLongf>(size);
+      if (uncompress(target, &decompressedSize, input, static_cast<uLong>(inputSize)) != Z_OK || decompressedSize != size)
+      {
+        return false;
+      }
+      break;
+    }
+    case COMPRESSION_DELTA_RLE:
+    {
+      if (!RunLengthDecode(input, inputSize, target, size))
+      {
+        return false;
+      }
+      break;
+    }
+    default:
+      return false;
+  }
+
+  if (IsDeltaCompression(task.Method))
+  {
+    unsigned char* reference = &(task.Self->ReferenceFrame[start]);
+    if (deltaFrame)
+    {
+      for (size_t i = 0; i < size; ++i)
+      {
+        output[i] = static_cast<unsigned char>(reference[i] + target[i]);
+      }
+    }
+    memcpy(reference, output, size);
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+size_t vtkPlusIgtlImageCompressor::RunLengthEncode(const unsigned char* input, size_t inputSize, unsigned char* output)
+{
+  // Sequence of (zero run length, literal length, literal bytes) tokens
+  unsigned char* outputStart = output;
+  size_t position = 0;
+  while (position < inputSize)
+  {
+    size_t zeroRunStart = position;
+    while (position < inputSize && input[position] == 0)
+    {
+      ++position;
+    }
+    size_t zeroRunLength = position - zeroRunStart;
+
+    // Literal lasts until a long enough zero run or the end of the input
+    size_t literalStart = position;
+    while (position < inputSize)
+    {
+      if (input[position] != 0)
+      {
+        ++position;
+        continue;
+      }
+      size_t zeroRunEnd = position;
+      while (zeroRunEnd < inputSize && input[zeroRunEnd] == 0 && zeroRunEnd - position < MINIMUM_ZERO_RUN_LENGTH)
+      {
+        ++zeroRunEnd;
+      }
+      if (zeroRunEnd - position >= MINIMUM_ZERO_RUN_LENGTH || zeroRunEnd == inputSize)
+      {
+        break;
+      }
+      position = zeroRunEnd;
+    }
+    size_t literalLength = position - literalStart;
+
+    WriteVariableLengthInteger(output, zeroRunLength);
+    WriteVariableLengthInteger(output, literalLength);
+    memcpy(output, input + literalStart, literalLength);
+    output += literalLength;
+  }
+  return output - outputStart;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusIgtlImageCompressor::RunLengthDecode(const unsigned char* input, size_t inputSize, unsigned char* output, size_t outputSize)
+{
+  const unsigned char* inputEnd = input + inputSize;
+  size_t position = 0;
+  while (input < inputEnd)
+  {
+    size_t zeroRunLength = 0;
+    size_t literalLength = 0;
+    if (!ReadVariableLengthInteger(input, inputEnd, zeroRunLength) || !ReadVariableLengthInteger(input, inputEnd, literalLength))
+    {
+      return false;
+    }
+    if (zeroRunLength > outputSize - position || literalLength > outputSize - position - zeroRunLength || literalLength > static_cast<size_t>(inputEnd - input))
+    {
+      return false;
+    }
+    memset(output + position, 0, zeroRunLength);
+    position += zeroRunLength;
+    memcpy(output + position, input, literalLength);
+    position += literalLength;
+    input += literalLength;
+  }
+  return position == outputSize;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlImageCompressor::Compress(const PlusVideoFrame& frame, std::vector<unsigned char>& compressedData, bool& keyFrame)
+{
+  PlusPerformanceScopedTimer compressTimer(this->CompressStatistics);
+
+  BandTask task;
+  task.Method = this->CompressionMethod;
+  task.Frame = static_cast<unsigned char*>(frame.GetScalarPointer());
+  task.FrameSizeInBytes = frame.GetFrameSizeInBytes();
+  task.CompressedData = NULL;
+  if (task.Frame == NULL || task.FrameSizeInBytes == 0)
+  {
+    LOG_ERROR("Failed to compress image - frame is empty");
+    return PLUS_FAIL;
+  }
+
+  keyFrame = true;
+  if (IsDeltaCompression(this->CompressionMethod))
+  {
+    if (this->ReferenceFrame.size() != task.FrameSizeInBytes)
+    {
+      // No reference frame or the frame size has changed
+      this->ReferenceFrame.resize(task.FrameSizeInBytes);
+    }
+    else if (this->NumberOfFramesSinceKeyFrame < this->KeyFrameInterval)
+    {
+      keyFrame = false;
+    }
+    this->NumberOfFramesSinceKeyFrame = keyFrame ? 0 : this->NumberOfFramesSinceKeyFrame + 1;
+  }
+  task.KeyFrame = keyFrame;
+
+  task.NumberOfBands = this->GetNumberOfBands(task.FrameSizeInBytes);
+  task.CompressedBandSizes.assign(task.NumberOfBands, 0);
+  if (static_cast<int>(this->BandBuffers.size()) < task.NumberOfBands)
+  {
+    this->BandBuffers.resize(task.NumberOfBands);
+    this->DifferenceBuffers.resize(task.NumberOfBands);
+  }
+
+  if (this->ExecuteBandTask(&vtkPlusIgtlImageCompressor::CompressBandThreadFunction, task) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to compress image with " << GetStringFromCompressionMethod(this->CompressionMethod) << " method");
+    this->ResetReferenceFrame();
+    return PLUS_FAIL;
+  }
+
+  // Assemble the compressed data: number of bands, band sizes, band data
+  size_t headerSize = sizeof(uint32_t) * (1 + task.NumberOfBands);
+  size_t compressedDataSize = headerSize;
+  for (int band = 0; band < task.NumberOfBands; ++band)
+  {
+    compressedDataSize += task.CompressedBandSizes[band];
+  }
+  compressedData.resize(compressedDataSize);
+  WriteUint32(&compressedData[0], task.NumberOfBands);
+  size_t offset = headerSize;
+  for (int band = 0; band < task.NumberOfBands; ++band)
+  {
+    WriteUint32(&compressedData[sizeof(uint32_t) * (1 + band)], static_cast<uint32_t>(task.CompressedBandSizes[band]));
+    if (task.CompressedBandSizes[band] > 0)
+    {
+      memcpy(&compressedData[offset], &(this->BandBuffers[band][0]), task.CompressedBandSizes[band]);
+    }
+    offset += task.CompressedBandSizes[band];
+  }
+
+  if (this->CompressionRatioStatistics != NULL)
+  {
+    this->CompressionRatioStatistics->AddSample(static_cast<double>(task.FrameSizeInBytes) / compressedDataSize);
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlImageCompressor::Decompress(const unsigned char* compressedData, size_t compressedDataSize, CompressionMethodType method, bool keyFrame, PlusVideoFrame& frame)
+{
+  BandTask task;
+  task.Method = method;
+  task.KeyFrame = keyFrame;
+  task.Frame = static_cast<unsigned char*>(frame.GetScalarPointer());
+  task.FrameSizeInBytes = frame.GetFrameSizeInBytes();
+  task.CompressedData = compressedData;
+  if (task.Frame == NULL || task.FrameSizeInBytes == 0)
+  {
+    LOG_ERROR("Failed to decompress image - output frame is not allocated");
+    return PLUS_FAIL;
+  }
+
+  if (compressedData == NULL || compressedDataSize < sizeof(uint32_t))
+  {
+    LOG_ERROR("Failed to decompress image - compressed data is incomplete");
+    return PLUS_FAIL;
+  }
+  uint32_t numberOfBands = ReadUint32(compressedData);
+  size_t headerSize = sizeof(uint32_t) * (1 + static_cast<size_t>(numberOfBands));
+  if (numberOfBands < 1 || numberOfBands > MAXIMUM_NUMBER_OF_BANDS || numberOfBands > task.FrameSizeInBytes || compressedDataSize < headerSize)
+  {
+    LOG_ERROR("Failed to decompress image - invalid compressed data header");
+    return PLUS_FAIL;
+  }
+  task.NumberOfBands = static_cast<int>(numberOfBands);
+  task.CompressedBandOffsets.resize(numberOfBands);
+  task.CompressedBandSizes.resize(numberOfBands);
+  size_t offset = headerSize;
+  for (uint32_t band = 0; band < numberOfBands; ++band)
+  {
+    task.CompressedBandOffsets[band] = offset;
+    task.CompressedBandSizes[band] = ReadUint32(compressedData + sizeof(uint32_t) * (1 + band));
+    offset += task.CompressedBandSizes[band];
+  }
+  if (offset > compressedDataSize)
+  {
+    LOG_ERROR("Failed to decompress image - compressed data is incomplete");
+    return PLUS_FAIL;
+  }
+
+  if (IsDeltaCompression(method))
+  {
+    if (keyFrame)
+    {
+      this->ReferenceFrame.resize(task.FrameSizeInBytes);
+    }
+    else if (this->ReferenceFrame.size() != task.FrameSizeInBytes)
+    {
+      LOG_ERROR("Failed to decompress image - the previous frame is not available, waiting for the next key frame");
+      return PLUS_FAIL;
+    }
+  }
+
+  if (static_cast<int>(this->BandBuffers.size()) < task.NumberOfBands)
+  {
+    this->BandBuffers.resize(task.NumberOfBands);
+  }
+
+  if (this->ExecuteBandTask(&vtkPlusIgtlImageCompressor::DecompressBandThreadFunction, task) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to decompress image with " << GetStringFromCompressionMethod(method) << " method");
+    this->ResetReferenceFrame();
+    return PLUS_FAIL;
+  }
+
+  return PLUS_SUCCESS;
+}
@@ -0,0 +1,170 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusIgtlImageCompressor_h
+#define __vtkPlusIgtlImageCompressor_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusOpenIGTLinkExport.h"
+
+#include "vtkMultiThreader.h"
+#include "vtkObject.h"
+
+#include <vector>
+
+class PlusPerformanceHistogram;
+class PlusVideoFrame;
+
+/*!
+  \class vtkPlusIgtlImageCompressor
+  \brief Lossless compression of a stream of video frames for sending them over OpenIGTLink
+
+  Compression methods:
+  - NONE: pixel data is not compressed
+  - ZLIB: each frame is compressed with zlib (deflate)
+  - DELTA_RLE: the byte-wise difference between the frame and the previous frame is run-length encoded.
+    Very fast and efficient for images with mostly static content (e.g., ultrasound images with a static background).
+    Key frames are compressed with zlib.
+  - DELTA_ZLIB: the byte-wise difference between the frame and the previous frame is compressed with zlib.
+
+  Delta methods send a key frame (that does not depend on the previous frame) periodically (see KeyFrameInterval)
+  and whenever the frame geometry changes, so a receiver can always recover within a few frames.
+
+  The pixel data is split into bands that are compressed (and decompressed) in parallel, each band independently,
+  so that compression of large frames does not slow down the data sender thread.
+
+  The same class is used for compression and decompression, but the two must not be mixed in the same instance,
+  because both keep the last frame as reference for delta compression. The compressed data layout:
+  number of bands (uint32), compressed size of each band (uint32), compressed band data; all integers in network byte order.
+
+  \ingroup PlusLibOpenIGTLink
+*/
+class vtkPlusOpenIGTLinkExport vtkPlusIgtlImageCompressor : public vtkObject
+{
+public:
+  enum CompressionMethodType
+  {
+    COMPRESSION_NONE = 0,
+    COMPRESSION_ZLIB = 1,
+    COMPRESSION_DELTA_RLE = 2,
+    COMPRESSION_DELTA_ZLIB = 3
+  };
+
+  static vtkPlusIgtlImageCompressor* New();
+  vtkTypeMacro(vtkPlusIgtlImageCompressor, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /*! Get compression method name (NONE, ZLIB, DELTA_RLE, DELTA_ZLIB) */
+  static std::string GetStringFromCompressionMethod(CompressionMethodType method);
+
+  /*! Get compression method from name (case insensitive). Returns PLUS_FAIL if the name is not recognized. */
+  static PlusStatus GetCompressionMethodFromString(const std::string& methodName, CompressionMethodType& method);
+
+  /*! Set compression method. The next compressed frame will be a key frame. */
+  void SetCompressionMethod(CompressionMethodType method);
+  vtkGetMacro(CompressionMethod, CompressionMethodType);
+
+  /*! Maximum number of threads used for compression and decompression. 0 means the number of processors. */
+  vtkSetMacro(NumberOfThreads, int);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /*! A key frame is sent after this many delta compressed frames */
+  vtkSetMacro(KeyFrameInterval, int);
+  vtkGetMacro(KeyFrameInterval, int);
+
+  /*! zlib compression level (1 = fastest, 9 = best compression) */
+  vtkSetClampMacro(ZlibCompressionLevel, int, 1, 9);
+  vtkGetMacro(ZlibCompressionLevel, int);
+
+  /*!
+    Record compression ratio and compression time in the performance statistics.
+    Histogram names: [prefix]CompressionRatio, [prefix]CompressMs
+    The histograms are released when the prefix is changed or the compressor is deleted.
+  */
+  void SetStatisticsNamePrefix(const std::string& statisticsNamePrefix);
+
+  /*! Forget the reference frame. The next compressed frame will be a key frame. */
+  void ResetReferenceFrame();
+
+  /*!
+    Compress the pixel data of the frame.
+    \param frame Input frame
+    \param compressedData Output compressed data
+    \param keyFrame Set to true if the compressed frame does not depend on the previous frame
+  */
+  PlusStatus Compress(const PlusVideoFrame& frame, std::vector<unsigned char>& compressedData, bool& keyFrame);
+
+  /*!
+    Decompress pixel data into the frame. The frame must be already allocated with the geometry of the compressed frame.
+    \param method Compression method that was used for compressing the data
+    \param keyFrame True if the compressed frame does not depend on the previous frame
+  */
+  PlusStatus Decompress(const unsigned char* compressedData, size_t compressedDataSize, CompressionMethodType method, bool keyFrame, PlusVideoFrame& frame);
+
+protected:
+  vtkPlusIgtlImageCompressor();
+  virtual ~vtkPlusIgtlImageCompressor();
+
+  /*! Information shared by all band compression and decompression threads */
+  struct BandTask
+  {
+    vtkPlusIgtlImageCompressor* Self;
+    CompressionMethodType Method;
+    bool KeyFrame;
+    unsigned char* Frame;
+    size_t FrameSizeInBytes;
+    int NumberOfBands;
+    const unsigned char* CompressedData;
+    std::vector<size_t> CompressedBandOffsets;
+    std::vector<size_t> CompressedBandSizes;
+    std::vector<int> BandSucceeded;
+  };
+
+  /*! Compute the number of bands for a frame size */
+  int GetNumberOfBands(size_t frameSizeInBytes);
+
+  /*! Run the function for all bands, in parallel if there are multiple bands. Returns PLUS_FAIL if any of the bands failed. */
+  PlusStatus ExecuteBandTask(vtkThreadFunctionType function, BandTask& task);
+
+  static void GetBandRange(const BandTask& task, int band, size_t& start, size_t& size);
+
+  static VTK_THREAD_RETURN_TYPE CompressBandThreadFunction(void* arg);
+  static VTK_THREAD_RETURN_TYPE DecompressBandThreadFunction(void* arg);
+
+  static bool CompressBand(BandTask& task, int band);
+  static bool DecompressBand(BandTask& task, int band);
+
+  /*! Run-length encode runs of zero bytes. Returns the number of bytes written. */
+  static size_t RunLengthEncode(const unsigned char* input, size_t inputSize, unsigned char* output);
+  static bool RunLengthDecode(const unsigned char* input, size_t inputSize, unsigned char* output, size_t outputSize);
+
+  CompressionMethodType CompressionMethod;
+  int NumberOfThreads;
+  int KeyFrameInterval;
+  int ZlibCompressionLevel;
+
+  /*! Number of frames that have been compressed since the last key frame */
+  int NumberOfFramesSinceKeyFrame;
+
+  /*! Last compressed or decompressed frame, used as reference for delta compression */
+  std::vector<unsigned char> ReferenceFrame;
+
+  /*! Per-band buffers for compressed data (when compressing) or decoded difference (when decompressing) */
+  std::vector< std::vector<unsigned char> > BandBuffers;
+  /*! Per-band buffers for the difference image (when compressing with delta compression) */
+  std::vector< std::vector<unsigned char> > DifferenceBuffers;
+
+  vtkMultiThreader* Threader;
+
+  PlusPerformanceHistogram* CompressionRatioStatistics;
+  PlusPerformanceHistogram* CompressStatistics;
+
+private:
+  vtkPlusIgtlImageCompressor(const vtkPlusIgtlImageCompressor&);
+  void operator=(const vtkPlusIgtlImageCompressor&);
+};
+
+#endif
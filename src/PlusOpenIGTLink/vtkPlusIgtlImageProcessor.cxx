@@ -0,0 +1,264 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PixelCodec.h"
+#include "PlusPerformanceStatistics.h"
+#include "vtkPlusIgtlImageProcessor.h"
+
+#include "vtkImageData.h"
+#include "vtkMatrix4x4.h"
+#include "vtkObjectFactory.h"
+
+#include <algorithm>
+
+vtkStandardNewMacro(vtkPlusIgtlImageProcessor);
+
+//----------------------------------------------------------------------------
+vtkPlusIgtlImageProcessor::vtkPlusIgtlImageProcessor()
+  : ProcessStatistics(NULL)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusIgtlImageProcessor::~vtkPlusIgtlImageProcessor()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlImageProcessor::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Number of cached option sets: " << this->Cache.size() << std::endl;
+  for (std::map<std::string, CachedFrame>::const_iterator it = this->Cache.begin(); it != this->Cache.end(); ++it)
+  {
+    os << indent.GetNextIndent() << it->first << (it->second.Valid ? " (valid)" : "") << std::endl;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlImageProcessor::SetStatisticsNamePrefix(const std::string& statisticsNamePrefix)
+{
+  this->ProcessStatistics = PlusPerformanceStatistics::GetInstance()->GetHistogram(statisticsNamePrefix + "ImageProcessingMs");
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlImageProcessor::ResetCache()
+{
+  for (std::map<std::string, CachedFrame>::iterator it = this->Cache.begin(); it != this->Cache.end();)
+  {
+    if (!it->second.Valid)
+    {
+      // Not used since the last reset, no client needs these options anymore
+      this->Cache.erase(it++);
+      continue;
+    }
+    it->second.Valid = false;
+    ++it;
+  }
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusIgtlImageProcessor::GetCacheKey(const PlusIgtlClientInfo::ImageStream& options)
+{
+  std::ostringstream key;
+  if (PlusCommon::IsClippingRequested(options.ClipRectangleOrigin, options.ClipRectangleSize))
+  {
+    key << "Clip(" << options.ClipRectangleOrigin[0] << "," << options.ClipRectangleOrigin[1] << "," << options.ClipRectangleOrigin[2]
+        << ";" << options.ClipRectangleSize[0] << "," << options.ClipRectangleSize[1] << "," << options.ClipRectangleSize[2] << ")";
+  }
+  if (options.DownsamplingFactor > 1)
+  {
+    key << "Downsample(" << options.DownsamplingFactor << "," << PlusIgtlClientInfo::ImageStream::GetStringFromDownsamplingMethod(options.DownsamplingMethod) << ")";
+  }
+  if (options.Grayscale)
+  {
+    key << "Grayscale";
+  }
+  return key.str();
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusIgtlImageProcessor::IsAveragingApplied(const PlusVideoFrame& inputFrame, const PlusIgtlClientInfo::ImageStream& options)
+{
+  return options.DownsamplingFactor > 1
+         && options.DownsamplingMethod == PlusIgtlClientInfo::ImageStream::DOWNSAMPLING_AVERAGE
+         && inputFrame.GetVTKScalarPixelType() == VTK_UNSIGNED_CHAR;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusIgtlImageProcessor::IsGrayscaleConversionApplied(const PlusVideoFrame& inputFrame, const PlusIgtlClientInfo::ImageStream& options)
+{
+  return options.Grayscale
+         && inputFrame.GetVTKScalarPixelType() == VTK_UNSIGNED_CHAR
+         && (inputFrame.GetNumberOfScalarComponents() == 3 || inputFrame.GetNumberOfScalarComponents() == 4);
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusIgtlImageProcessor::IsProcessingRequired(const PlusVideoFrame& inputFrame, const PlusIgtlClientInfo::ImageStream& options)
+{
+  return PlusCommon::IsClippingRequested(options.ClipRectangleOrigin, options.ClipRectangleSize)
+         || options.DownsamplingFactor > 1
+         || IsGrayscaleConversionApplied(inputFrame, options);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlImageProcessor::GetProcessedToInputImageTransform(const PlusVideoFrame& inputFrame, const PlusIgtlClientInfo::ImageStream& options, vtkMatrix4x4* processedToInputImageTransform)
+{
+  processedToInputImageTransform->Identity();
+  double origin[3] = { 0.0, 0.0, 0.0 };
+  if (PlusCommon::IsClippingRequested(options.ClipRectangleOrigin, options.ClipRectangleSize))
+  {
+    origin[0] = options.ClipRectangleOrigin[0];
+    origin[1] = options.ClipRectangleOrigin[1];
+    origin[2] = options.ClipRectangleOrigin[2];
+  }
+  double factor = std::max(options.DownsamplingFactor, 1);
+  // An averaged pixel represents the center of the block, a decimated pixel the top-left pixel of the block
+  double blockCenterOffset = IsAveragingApplied(inputFrame, options) ? (factor - 1.0) / 2.0 : 0.0;
+  double inputSpacing[3] = { 1.0, 1.0, 1.0 };
+  if (inputFrame.GetImage() != NULL)
+  {
+    inputFrame.GetImage()->GetSpacing(inputSpacing);
+  }
+  processedToInputImageTransform->SetElement(0, 3, (origin[0] + blockCenterOffset) * inputSpacing[0]);
+  processedToInputImageTransform->SetElement(1, 3, (origin[1] + blockCenterOffset) * inputSpacing[1]);
+  processedToInputImageTransform->SetElement(2, 3, origin[2] * inputSpacing[2]);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlImageProcessor::GetProcessedFrame(const PlusVideoFrame& inputFrame, const PlusIgtlClientInfo::ImageStream& options,
+    const PlusVideoFrame*& processedFrame, vtkMatrix4x4* processedToInputImageTransform)
+{
+  if (!IsProcessingRequired(inputFrame, options))
+  {
+    processedFrame = &inputFrame;
+    if (processedToInputImageTransform != NULL)
+    {
+      processedToInputImageTransform->Identity();
+    }
+    return PLUS_SUCCESS;
+  }
+
+  CachedFrame& cachedFrame = this->Cache[GetCacheKey(options)];
+  if (!cachedFrame.Valid)
+  {
+    PlusPerformanceScopedTimer processTimer(this->ProcessStatistics);
+    cachedFrame.Status = this->ProcessFrame(inputFrame, options, cachedFrame.Frame);
+    cachedFrame.Valid = true;
+  }
+
+  processedFrame = &cachedFrame.Frame;
+  if (processedToInputImageTransform != NULL)
+  {
+    GetProcessedToInputImageTransform(inputFrame, options, processedToInputImageTransform);
+  }
+  return cachedFrame.Status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlImageProcessor::ProcessFrame(const PlusVideoFrame& inputFrame, const PlusIgtlClientInfo::ImageStream& options, PlusVideoFrame& outputFrame)
+{
+  if (!inputFrame.IsImageValid())
+  {
+    LOG_ERROR("Unable to process image - input image is invalid");
+    return PLUS_FAIL;
+  }
+
+  unsigned int inputSize[3] = { 0, 0, 0 };
+  inputFrame.GetFrameSize(inputSize);
+
+  // The clip rectangle is limited to the image extent
+  int clipOrigin[3] = { 0, 0, 0 };
+  int clipSize[3] = { static_cast<int>(inputSize[0]), static_cast<int>(inputSize[1]), static_cast<int>(inputSize[2]) };
+  if (PlusCommon::IsClippingRequested(options.ClipRectangleOrigin, options.ClipRectangleSize))
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      if (options.ClipRectangleOrigin[i] < 0 || options.ClipRectangleOrigin[i] >= static_cast<int>(inputSize[i]) || options.ClipRectangleSize[i] <= 0)
+      {
+        LOG_ERROR("Unable to process image - clip rectangle origin (" << options.ClipRectangleOrigin[0] << ", " << options.ClipRectangleOrigin[1] << ", " << options.ClipRectangleOrigin[2]
+                  << ") is outside the image (" << inputSize[0] << "x" << inputSize[1] << "x" << inputSize[2] << ")");
+        return PLUS_FAIL;
+      }
+      clipOrigin[i] = options.ClipRectangleOrigin[i];
+      clipSize[i] = std::min(options.ClipRectangleSize[i], static_cast<int>(inputSize[i]) - clipOrigin[i]);
+    }
+  }
+
+  int factor = std::max(options.DownsamplingFactor, 1);
+  int outputSize[3] = { clipSize[0] / factor, clipSize[1] / factor, clipSize[2] };
+  if (outputSize[0] == 0 || outputSize[1] == 0)
+  {
+    LOG_ERROR("Unable to process image - clipped image size (" << clipSize[0] << "x" << clipSize[1] << ") is smaller than the downsampling factor (" << factor << ")");
+    return PLUS_FAIL;
+  }
+
+  bool averaging = IsAveragingApplied(inputFrame, options);
+  bool grayscale = IsGrayscaleConversionApplied(inputFrame, options);
+  bool resampling = PlusCommon::IsClippingRequested(options.ClipRectangleOrigin, options.ClipRectangleSize) || factor > 1;
+  int numberOfComponents = inputFrame.GetNumberOfScalarComponents();
+  int bytesPerPixel = inputFrame.GetNumberOfBytesPerPixel();
+
+  if (outputFrame.AllocateFrame(outputSize, inputFrame.GetVTKScalarPixelType(), grayscale ? 1 : numberOfComponents) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to process image - failed to allocate output frame");
+    return PLUS_FAIL;
+  }
+  outputFrame.SetImageType(grayscale ? US_IMG_BRIGHTNESS : inputFrame.GetImageType());
+  outputFrame.SetImageOrientation(inputFrame.GetImageOrientation());
+  double spacing[3] = { 1.0, 1.0, 1.0 };
+  inputFrame.GetImage()->GetSpacing(spacing);
+  outputFrame.GetImage()->SetSpacing(spacing[0] * factor, spacing[1] * factor, spacing[2]);
+
+  int inputRowStride = inputSize[0] * bytesPerPixel;
+  int inputSliceStride = inputRowStride * inputSize[1];
+  int resampledSliceSize = outputSize[0] * outputSize[1] * bytesPerPixel;
+  if (grayscale && resampling && this->IntermediateBuffer.size() < static_cast<size_t>(resampledSliceSize))
+  {
+    this->IntermediateBuffer.resize(resampledSliceSize);
+  }
+
+  const unsigned char* input = static_cast<const unsigned char*>(inputFrame.GetScalarPointer())
+                               + clipOrigin[2] * inputSliceStride + clipOrigin[1] * inputRowStride + clipOrigin[0] * bytesPerPixel;
+  unsigned char* output = static_cast<unsigned char*>(outputFrame.GetScalarPointer());
+  int outputSliceSize = outputSize[0] * outputSize[1] * outputFrame.GetNumberOfBytesPerPixel();
+  for (int z = 0; z < outputSize[2]; ++z)
+  {
+    const unsigned char* inputSlice = input + z * inputSliceStride;
+    unsigned char* outputSlice = output + z * outputSliceSize;
+
+    // Crop and downsample in one pass
+    const unsigned char* resampledSlice = inputSlice;
+    if (resampling)
+    {
+      unsigned char* resampledOutput = grayscale ? &this->IntermediateBuffer[0] : outputSlice;
+      if (averaging)
+      {
+        PixelCodec::DownsampleAverage(clipSize[0], clipSize[1], numberOfComponents, inputRowStride, factor, inputSlice, resampledOutput);
+      }
+      else
+      {
+        PixelCodec::DownsampleDecimate(clipSize[0], clipSize[1], bytesPerPixel, inputRowStride, factor, inputSlice, resampledOutput);
+      }
+      resampledSlice = resampledOutput;
+    }
+
+    if (grayscale)
+    {
+      if (numberOfComponents == 3)
+      {
+        PixelCodec::Rgb24ToGray(outputSize[0], outputSize[1], const_cast<unsigned char*>(resampledSlice), outputSlice);
+      }
+      else
+      {
+        PixelCodec::Rgba32ToGray(outputSize[0], outputSize[1], const_cast<unsigned char*>(resampledSlice), outputSlice);
+      }
+    }
+  }
+
+  return PLUS_SUCCESS;
+}
@@ -0,0 +1,112 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusIgtlImageProcessor_h
+#define __vtkPlusIgtlImageProcessor_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusOpenIGTLinkExport.h"
+
+#include "PlusIgtlClientInfo.h"
+#include "PlusVideoFrame.h"
+#include "vtkObject.h"
+
+#include <map>
+#include <vector>
+
+class PlusPerformanceHistogram;
+class vtkMatrix4x4;
+
+/*!
+  \class vtkPlusIgtlImageProcessor
+  \brief Crops, downsamples, and converts to grayscale the images that are sent to OpenIGTLink clients
+
+  The processing options are defined per client and image stream (see PlusIgtlClientInfo::ImageStream).
+  Processed frames are cached by option set, so if multiple clients request the same options then the
+  frame is processed only once. Call ResetCache before processing a new frame.
+
+  Processing order: the clip rectangle is cropped, then downsampled, then converted to grayscale.
+  Cropping and downsampling are performed in a single pass over the input image. The spacing of the
+  downsampled image is the spacing of the input image multiplied by the downsampling factor.
+
+  \ingroup PlusLibOpenIGTLink
+*/
+class vtkPlusOpenIGTLinkExport vtkPlusIgtlImageProcessor : public vtkObject
+{
+public:
+  static vtkPlusIgtlImageProcessor* New();
+  vtkTypeMacro(vtkPlusIgtlImageProcessor, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /*!
+    Record processing time in the performance statistics.
+    Histogram name: [prefix]ImageProcessingMs
+  */
+  void SetStatisticsNamePrefix(const std::string& statisticsNamePrefix);
+
+  /*! Invalidate the cached frames. Memory of the frames is kept for processing the next frame. */
+  void ResetCache();
+
+  /*!
+    Get the frame processed with the stream options. The result is cached until ResetCache is called.
+    \param processedFrame Set to the processed frame, or to the input frame if no processing is requested.
+      The frame is owned by this object (or the caller) and is valid until the next ResetCache call.
+    \param processedToInputImageTransform If not NULL then set to the transform from the processed frame's
+      image coordinate system to the input frame's image coordinate system (see GetProcessedToInputImageTransform)
+  */
+  PlusStatus GetProcessedFrame(const PlusVideoFrame& inputFrame, const PlusIgtlClientInfo::ImageStream& options,
+                               const PlusVideoFrame*& processedFrame, vtkMatrix4x4* processedToInputImageTransform);
+
+  /*! Process the input frame with the stream options into the output frame (without caching) */
+  PlusStatus ProcessFrame(const PlusVideoFrame& inputFrame, const PlusIgtlClientInfo::ImageStream& options, PlusVideoFrame& outputFrame);
+
+  /*! Returns true if the stream options modify the input frame (e.g., grayscale conversion of a grayscale image does not) */
+  static bool IsProcessingRequired(const PlusVideoFrame& inputFrame, const PlusIgtlClientInfo::ImageStream& options);
+
+  /*!
+    Compute the transform from the processed frame's image coordinate system to the input frame's image coordinate system
+    (pixel index multiplied by the image spacing). The downsampling is described by the spacing of the processed frame,
+    so the transform is a translation to the first processed pixel: the clip rectangle origin, or the center of the
+    first averaged block.
+  */
+  static void GetProcessedToInputImageTransform(const PlusVideoFrame& inputFrame, const PlusIgtlClientInfo::ImageStream& options, vtkMatrix4x4* processedToInputImageTransform);
+
+protected:
+  vtkPlusIgtlImageProcessor();
+  virtual ~vtkPlusIgtlImageProcessor();
+
+  /*! Get the key that identifies the options in the cache */
+  static std::string GetCacheKey(const PlusIgtlClientInfo::ImageStream& options);
+
+  /*! True if the pixels are averaged during downsampling (only 8-bit images are averaged, others are decimated) */
+  static bool IsAveragingApplied(const PlusVideoFrame& inputFrame, const PlusIgtlClientInfo::ImageStream& options);
+
+  /*! True if the pixels are converted to grayscale (only 8-bit RGB and RGBA images are converted) */
+  static bool IsGrayscaleConversionApplied(const PlusVideoFrame& inputFrame, const PlusIgtlClientInfo::ImageStream& options);
+
+  struct CachedFrame
+  {
+    CachedFrame() : Valid(false), Status(PLUS_FAIL) {}
+    /*! True if the frame has been processed since the last ResetCache call */
+    bool Valid;
+    PlusStatus Status;
+    PlusVideoFrame Frame;
+  };
+
+  /*! Processed frames, indexed by the processing options */
+  std::map<std::string, CachedFrame> Cache;
+
+  /*! Holds the downsampled image before grayscale conversion */
+  std::vector<unsigned char> IntermediateBuffer;
+
+  PlusPerformanceHistogram* ProcessStatistics;
+
+private:
+  vtkPlusIgtlImageProcessor(const vtkPlusIgtlImageProcessor&);
+  void operator=(const vtkPlusIgtlImageProcessor&);
+};
+
+#endif
@@ -8,6 +8,7 @@ See License.txt for details.
 #include "PlusConfigure.h"
 #include "PlusTrackedFrame.h"
 #include "PlusVideoFrame.h"
+#include "vtkPlusIgtlImageCompressor.h"
 #include "vtkPlusIgtlMessageCommon.h"
 #include "vtkPlusTrackedFrameList.h"
 #include "vtkPlusTransformRepository.h"
@@ -19,6 +20,7 @@ See License.txt for details.
 #include <vtkTransform.h>
 
 // OpenIGTLink includes
+#include <igtl_image.h>
 #include <igtl_tdata.h>
 
 // OpenIGTLinkIO includes
@@ -211,6 +213,15 @@ PlusStatus vtkPlusIgtlMessageCommon::UnpackUsMessage(igtl::MessageHeader::Pointe
 PlusStatus vtkPlusIgtlMessageCommon::PackImageMessage(igtl::ImageMessage::Pointer imageMessage,
     PlusTrackedFrame& trackedFrame,
     const vtkMatrix4x4& matrix)
+{
+  return PackImageMessage(imageMessage, *trackedFrame.GetImageData(), trackedFrame.GetTimestamp(), matrix);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageCommon::PackImageMessage(igtl::ImageMessage::Pointer imageMessage,
+    const PlusVideoFrame& frame,
+    double timestamp,
+    const vtkMatrix4x4& matrix)
 {
   if (imageMessage.IsNull())
   {
@@ -218,14 +229,13 @@ PlusStatus vtkPlusIgtlMessageCommon::PackImageMessage(igtl::ImageMessage::Pointe
     return PLUS_FAIL;
   }
 
-  if (!trackedFrame.GetImageData()->IsImageValid())
+  if (!frame.IsImageValid())
   {
     LOG_WARNING("Unable to send image message - image data is NOT valid!");
     return PLUS_FAIL;
   }
 
-  double timestamp = trackedFrame.GetTimestamp();
-  vtkImageData* frameImage = trackedFrame.GetImageData()->GetImage();
+  vtkImageData* frameImage = frame.GetImage();
 
   igtl::TimeStamp::Pointer igtlFrameTime = igtl::TimeStamp::New();
   igtlFrameTime->SetTime(timestamp);
@@ -234,8 +244,8 @@ PlusStatus vtkPlusIgtlMessageCommon::PackImageMessage(igtl::ImageMessage::Pointe
   int subSizePixels[3] = { 0 };
   int subOffset[3] = { 0 };
   double imageSpacingMm[3] = {0};
-  int scalarType = PlusVideoFrame::GetIGTLScalarPixelTypeFromVTK(trackedFrame.GetImageData()->GetVTKScalarPixelType());
-  int numScalarComponents = trackedFrame.GetImageData()->GetNumberOfScalarComponents();
+  int scalarType = PlusVideoFrame::GetIGTLScalarPixelTypeFromVTK(frame.GetVTKScalarPixelType());
+  int numScalarComponents = frame.GetNumberOfScalarComponents();
 
   frameImage->GetDimensions(imageSizePixels);
   frameImage->GetSpacing(imageSpacingMm);
@@ -279,6 +289,37 @@ PlusStatus vtkPlusIgtlMessageCommon::UnpackImageMessage(igtl::MessageHeader::Poi
     PlusTrackedFrame& trackedFrame,
     const PlusTransformName& embeddedTransformName,
     int crccheck)
+{
+  PlusVideoFrame frame;
+  double timestamp = 0;
+  vtkSmartPointer<vtkMatrix4x4> ijkToRasMatrix;
+  if (embeddedTransformName.IsValid())
+  {
+    ijkToRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  }
+
+  if (vtkPlusIgtlMessageCommon::UnpackImageMessage(headerMsg, socket, frame, timestamp, ijkToRasMatrix, crccheck) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  trackedFrame.SetImageData(frame);
+  trackedFrame.SetTimestamp(timestamp);
+  if (ijkToRasMatrix != NULL)
+  {
+    trackedFrame.SetCustomFrameTransform(embeddedTransformName, ijkToRasMatrix);
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageCommon::UnpackImageMessage(igtl::MessageHeader::Pointer headerMsg,
+    igtl::Socket* socket,
+    PlusVideoFrame& frame,
+    double& timestamp,
+    vtkMatrix4x4* ijkToRasMatrix,
+    int crccheck)
 {
   if (headerMsg.IsNull())
   {
@@ -299,31 +340,105 @@ PlusStatus vtkPlusIgtlMessageCommon::UnpackImageMessage(igtl::MessageHeader::Poi
     imgMsg = igtl::ImageMessage::New();
   }
   imgMsg->SetMessageHeader(headerMsg);
-  imgMsg->AllocateBuffer();
 
-  socket->Receive(imgMsg->GetBufferBodyPointer(), imgMsg->GetBufferBodySize());
+  // Version 1 message body: image header followed by the pixel data. If the message contains the full image
+  // in the native byte order then the pixels are received directly into the frame, without any intermediate buffer.
+  // CRC is computed for the whole body by ImageMessage::Unpack, therefore if CRC check is requested then the
+  // message is received into the message buffer.
+  const igtlUint64 bodySize = headerMsg->GetBodySizeToRead();
+  bool pixelDataReceived = false;
+  if (!crccheck && headerMsg->GetHeaderVersion() == IGTL_HEADER_VERSION_1 && bodySize >= IGTL_IMAGE_HEADER_SIZE)
+  {
+    igtl_image_header imageHeader; // in network byte order
+    if (socket->Receive(&imageHeader, IGTL_IMAGE_HEADER_SIZE) != IGTL_IMAGE_HEADER_SIZE)
+    {
+      LOG_ERROR("Couldn't receive image message header from server!");
+      return PLUS_FAIL;
+    }
+    igtl_image_header hostImageHeader = imageHeader;
+    igtl_image_convert_byte_order(&hostImageHeader);
 
-  int c = imgMsg->Unpack(crccheck);
-  if (!(c & igtl::MessageHeader::UNPACK_BODY))
+    PlusCommon::VTKScalarPixelType pixelType = PlusVideoFrame::GetVTKScalarPixelTypeFromIGTL(hostImageHeader.scalar_type);
+    bool fullImage = true;
+    for (int i = 0; i < 3; ++i)
+    {
+      if (hostImageHeader.subvol_offset[i] != 0 || hostImageHeader.subvol_size[i] != hostImageHeader.size[i])
+      {
+        fullImage = false;
+      }
+    }
+    const int hostEndian = igtl_is_little_endian() ? IGTL_IMAGE_ENDIAN_LITTLE : IGTL_IMAGE_ENDIAN_BIG;
+    bool supportedPixelType = (pixelType != VTK_VOID)
+                              && (hostImageHeader.endian == hostEndian || PlusVideoFrame::GetNumberOfBytesPerScalar(pixelType) == 1);
+
+    if (hostImageHeader.header_version == IGTL_IMAGE_HEADER_VERSION && fullImage && supportedPixelType
+        && bodySize == IGTL_IMAGE_HEADER_SIZE + igtl_image_get_data_size(&hostImageHeader))
+    {
+      int imgSize[3] = { hostImageHeader.size[0], hostImageHeader.size[1], hostImageHeader.size[2] };
+      if (frame.AllocateFrame(imgSize, pixelType, hostImageHeader.num_components) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to allocate image data for tracked frame!");
+        return PLUS_FAIL;
+      }
+      int pixelDataSize = static_cast<int>(bodySize - IGTL_IMAGE_HEADER_SIZE);
+      if (socket->Receive(frame.GetScalarPointer(), pixelDataSize) != pixelDataSize)
+      {
+        LOG_ERROR("Couldn't receive image message from server!");
+        return PLUS_FAIL;
+      }
+      pixelDataReceived = true;
+
+      // Image parameters are only needed for computing the embedded transform
+      imgMsg->SetDimensions(imgSize);
+      imgMsg->SetScalarType(hostImageHeader.scalar_type);
+      imgMsg->SetNumComponents(hostImageHeader.num_components);
+      imgMsg->SetCoordinateSystem(hostImageHeader.coord);
+      float spacing[3] = { 0 };
+      float origin[3] = { 0 };
+      float normI[3] = { 0 };
+      float normJ[3] = { 0 };
+      float normK[3] = { 0 };
+      igtl_image_get_matrix(spacing, origin, normI, normJ, normK, &hostImageHeader);
+      imgMsg->SetSpacing(spacing);
+      imgMsg->SetOrigin(origin);
+      imgMsg->SetNormals(normI, normJ, normK);
+    }
+    else
+    {
+      // Receive the rest of the message and unpack it from the message buffer
+      imgMsg->AllocateBuffer();
+      memcpy(imgMsg->GetBufferBodyPointer(), &imageHeader, IGTL_IMAGE_HEADER_SIZE);
+      socket->Receive(static_cast<unsigned char*>(imgMsg->GetBufferBodyPointer()) + IGTL_IMAGE_HEADER_SIZE, bodySize - IGTL_IMAGE_HEADER_SIZE);
+    }
+  }
+  else
   {
-    LOG_ERROR("Couldn't receive image message from server!");
-    return PLUS_FAIL;
+    imgMsg->AllocateBuffer();
+    socket->Receive(imgMsg->GetBufferBodyPointer(), imgMsg->GetBufferBodySize());
   }
 
-  // if CRC check is OK. Read data.
-  igtl::TimeStamp::Pointer igtlTimestamp = igtl::TimeStamp::New();
-  imgMsg->GetTimeStamp(igtlTimestamp);
+  if (!pixelDataReceived)
+  {
+    int c = imgMsg->Unpack(crccheck);
+    if (!(c & igtl::MessageHeader::UNPACK_BODY))
+    {
+      LOG_ERROR("Couldn't receive image message from server!");
+      return PLUS_FAIL;
+    }
 
-  int imgSize[3] = {0}; // image dimension in pixels
-  imgMsg->GetDimensions(imgSize);
+    int imgSize[3] = {0}; // image dimension in pixels
+    imgMsg->GetDimensions(imgSize);
 
-  // Set scalar pixel type
-  PlusCommon::VTKScalarPixelType pixelType = PlusVideoFrame::GetVTKScalarPixelTypeFromIGTL(imgMsg->GetScalarType());
-  PlusVideoFrame frame;
-  if (frame.AllocateFrame(imgSize, pixelType, imgMsg->GetNumComponents()) != PLUS_SUCCESS)
-  {
-    LOG_ERROR("Failed to allocate image data for tracked frame!");
-    return PLUS_FAIL;
+    // Set scalar pixel type
+    PlusCommon::VTKScalarPixelType pixelType = PlusVideoFrame::GetVTKScalarPixelTypeFromIGTL(imgMsg->GetScalarType());
+    if (frame.AllocateFrame(imgSize, pixelType, imgMsg->GetNumComponents()) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to allocate image data for tracked frame!");
+      return PLUS_FAIL;
+    }
+
+    // Copy image to buffer
+    memcpy(frame.GetScalarPointer(), imgMsg->GetScalarPointer(), frame.GetFrameSizeInBytes());
   }
 
   // Set the image type to support color images
@@ -331,22 +446,139 @@ PlusStatus vtkPlusIgtlMessageCommon::UnpackImageMessage(igtl::MessageHeader::Poi
   {
     frame.SetImageType((imgMsg->GetNumComponents() == igtl::ImageMessage::DTYPE_VECTOR) ? US_IMG_RGB_COLOR : US_IMG_BRIGHTNESS);
   }
+  else
+  {
+    frame.SetImageType(US_IMG_BRIGHTNESS);
+  }
 
-  // Copy image to buffer
-  memcpy(frame.GetScalarPointer(), imgMsg->GetScalarPointer(), frame.GetFrameSizeInBytes());
-
-  trackedFrame.SetImageData(frame);
-  trackedFrame.SetTimestamp(igtlTimestamp->GetTimeStamp());
+  igtl::TimeStamp::Pointer igtlTimestamp = igtl::TimeStamp::New();
+  imgMsg->GetTimeStamp(igtlTimestamp);
+  timestamp = igtlTimestamp->GetTimeStamp();
 
-  if (embeddedTransformName.IsValid())
+  if (ijkToRasMatrix != NULL)
   {
-    vtkSmartPointer<vtkMatrix4x4> vtkMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-    if (igtlio::ImageConverter::IGTLImageToVTKTransform(imgMsg, vtkMatrix) != 1)
+    if (igtlio::ImageConverter::IGTLImageToVTKTransform(imgMsg, ijkToRasMatrix) != 1)
     {
       LOG_ERROR("Failed to unpack image message - unable to extract IJKToRAS transform");
       return PLUS_FAIL;
     }
-    trackedFrame.SetCustomFrameTransform(embeddedTransformName, vtkMatrix);
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageCommon::PackCompressedImageMessage(igtl::PlusCompressedImageMessage::Pointer compressedImageMessage,
+    const PlusVideoFrame& frame,
+    double timestamp,
+    const vtkMatrix4x4& matrix,
+    vtkPlusIgtlImageCompressor* compressor)
+{
+  if (compressedImageMessage.IsNull())
+  {
+    LOG_ERROR("Failed to pack compressed image message - input compressed image message is NULL");
+    return PLUS_FAIL;
+  }
+
+  if (compressor == NULL)
+  {
+    LOG_ERROR("Failed to pack compressed image message - compressor is NULL");
+    return PLUS_FAIL;
+  }
+
+  if (!frame.IsImageValid())
+  {
+    LOG_WARNING("Unable to send compressed image message - image data is NOT valid!");
+    return PLUS_FAIL;
+  }
+
+  if (compressedImageMessage->SetImageProperties(frame) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  bool keyFrame = true;
+  if (compressor->Compress(frame, compressedImageMessage->GetCompressedDataBuffer(), keyFrame) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to pack compressed image message - unable to compress image");
+    return PLUS_FAIL;
+  }
+  compressedImageMessage->SetCompression(compressor->GetCompressionMethod(), keyFrame);
+  compressedImageMessage->SetEmbeddedImageTransform(matrix);
+
+  igtl::TimeStamp::Pointer igtlFrameTime = igtl::TimeStamp::New();
+  igtlFrameTime->SetTime(timestamp);
+  compressedImageMessage->SetTimeStamp(igtlFrameTime);
+  compressedImageMessage->Pack();
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageCommon::UnpackCompressedImageMessage(igtl::MessageHeader::Pointer headerMsg,
+    igtl::Socket* socket,
+    vtkPlusIgtlImageCompressor* decompressor,
+    PlusVideoFrame& frame,
+    double& timestamp,
+    vtkMatrix4x4* ijkToRasMatrix,
+    int crccheck)
+{
+  if (headerMsg.IsNull())
+  {
+    LOG_ERROR("Unable to unpack compressed image message - header message is NULL!");
+    return PLUS_FAIL;
+  }
+
+  if (socket == NULL)
+  {
+    LOG_ERROR("Unable to unpack compressed image message - socket is NULL!");
+    return PLUS_FAIL;
+  }
+
+  if (decompressor == NULL)
+  {
+    LOG_ERROR("Unable to unpack compressed image message - decompressor is NULL!");
+    socket->Skip(headerMsg->GetBodySizeToRead(), 0);
+    return PLUS_FAIL;
+  }
+
+  igtl::PlusCompressedImageMessage::Pointer compressedImageMsg = dynamic_cast<igtl::PlusCompressedImageMessage*>(headerMsg.GetPointer());
+  if (compressedImageMsg.IsNull())
+  {
+    compressedImageMsg = igtl::PlusCompressedImageMessage::New();
+  }
+  compressedImageMsg->SetMessageHeader(headerMsg);
+  compressedImageMsg->AllocateBuffer();
+
+  socket->Receive(compressedImageMsg->GetBufferBodyPointer(), compressedImageMsg->GetBufferBodySize());
+
+  int c = compressedImageMsg->Unpack(crccheck);
+  if (!(c & igtl::MessageHeader::UNPACK_BODY))
+  {
+    LOG_ERROR("Couldn't receive compressed image message from server!");
+    return PLUS_FAIL;
+  }
+
+  if (compressedImageMsg->AllocateFrame(frame) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  if (decompressor->Decompress(compressedImageMsg->GetCompressedData(), compressedImageMsg->GetCompressedDataSize(),
+                               static_cast<vtkPlusIgtlImageCompressor::CompressionMethodType>(compressedImageMsg->GetCompressionMethod()),
+                               compressedImageMsg->IsKeyFrame(), frame) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to unpack compressed image message - unable to decompress image");
+    return PLUS_FAIL;
+  }
+
+  igtl::TimeStamp::Pointer igtlTimestamp = igtl::TimeStamp::New();
+  compressedImageMsg->GetTimeStamp(igtlTimestamp);
+  timestamp = igtlTimestamp->GetTimeStamp();
+
+  if (ijkToRasMatrix != NULL)
+  {
+    compressedImageMsg->GetEmbeddedImageTransform(ijkToRasMatrix);
   }
 
   return PLUS_SUCCESS;
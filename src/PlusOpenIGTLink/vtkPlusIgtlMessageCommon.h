@@ -18,6 +18,7 @@ See License.txt for details.
 #include <igtlImageMessage.h>
 #include <igtlImageMetaMessage.h>
 #include <igtlMessageBase.h>
+#include <igtlPlusCompressedImageMessage.h>
 #include <igtlPlusTrackedFrameMessage.h>
 #include <igtlPlusUsMessage.h>
 #include <igtlPolyDataMessage.h>
@@ -29,6 +30,8 @@ See License.txt for details.
 
 class vtkXMLDataElement;
 class PlusTrackedFrame;
+class PlusVideoFrame;
+class vtkPlusIgtlImageCompressor;
 class vtkPolyData;
 class vtkPlusTransformRepository;
 
@@ -62,9 +65,33 @@ public:
   /*! Pack image message from tracked frame */
   static PlusStatus PackImageMessage(igtl::ImageMessage::Pointer imageMessage, PlusTrackedFrame& trackedFrame, const vtkMatrix4x4& matrix);
 
+  /*! Pack image message from video frame (e.g., a cropped or downsampled copy of the tracked frame image) */
+  static PlusStatus PackImageMessage(igtl::ImageMessage::Pointer imageMessage, const PlusVideoFrame& frame, double timestamp, const vtkMatrix4x4& matrix);
+
   /*! Unpack image message to tracked frame */
   static PlusStatus UnpackImageMessage(igtl::MessageHeader::Pointer headerMsg, igtl::Socket* socket, PlusTrackedFrame& trackedFrame, const PlusTransformName& embeddedTransformName, int crccheck);
 
+  /*!
+    Unpack image message to a video frame.
+    If the message contains the full image in a version 1 message and no CRC check is requested then the pixel data is received from
+    the socket directly into the pixel buffer of the frame. The frame is only reallocated if its geometry differs from the received image,
+    so a frame can be reused for receiving many messages without any memory allocation (see vtkPlusBuffer::AddItemAdoptFrame).
+    \param timestamp Timestamp of the message (UTC)
+    \param ijkToRasMatrix If not NULL then it is set to the IJK to RAS transform of the image
+  */
+  static PlusStatus UnpackImageMessage(igtl::MessageHeader::Pointer headerMsg, igtl::Socket* socket, PlusVideoFrame& frame, double& timestamp, vtkMatrix4x4* ijkToRasMatrix, int crccheck);
+
+  /*! Pack compressed image message from video frame. The compressor keeps the reference frame of the stream for delta compression. */
+  static PlusStatus PackCompressedImageMessage(igtl::PlusCompressedImageMessage::Pointer compressedImageMessage, const PlusVideoFrame& frame, double timestamp, const vtkMatrix4x4& matrix, vtkPlusIgtlImageCompressor* compressor);
+
+  /*!
+    Unpack compressed image message to a video frame.
+    The same decompressor must be used for all the messages of a device, as delta compressed frames are decoded using the previous frame.
+    \param timestamp Timestamp of the message (UTC)
+    \param ijkToRasMatrix If not NULL then it is set to the embedded image transform
+  */
+  static PlusStatus UnpackCompressedImageMessage(igtl::MessageHeader::Pointer headerMsg, igtl::Socket* socket, vtkPlusIgtlImageCompressor* decompressor, PlusVideoFrame& frame, double& timestamp, vtkMatrix4x4* ijkToRasMatrix, int crccheck);
+
   /*! Pack image message from vtkImageData volume */
   static PlusStatus PackImageMessage(igtl::ImageMessage::Pointer imageMessage, vtkImageData* volume, vtkMatrix4x4* volumeToReferenceTransform, double timestamp);
 
@@ -23,6 +23,7 @@ See License.txt for details.
 #include "igtlCommandMessage.h"
 #include "igtlImageMessage.h"
 #include "igtlPlusClientInfoMessage.h"
+#include "igtlPlusCompressedImageMessage.h"
 #include "igtlPlusTrackedFrameMessage.h"
 #include "igtlPlusUsMessage.h"
 #include "igtlPositionMessage.h"
@@ -37,8 +38,10 @@ vtkStandardNewMacro(vtkPlusIgtlMessageFactory);
 //----------------------------------------------------------------------------
 vtkPlusIgtlMessageFactory::vtkPlusIgtlMessageFactory()
   : IgtlFactory(igtl::MessageFactory::New())
+  , PackTrackingDataWithFrames(true)
 {
   this->IgtlFactory->AddMessageType("CLIENTINFO", (PointerToMessageBaseNew)&igtl::PlusClientInfoMessage::New);
+  this->IgtlFactory->AddMessageType("COMPIMAGE", (PointerToMessageBaseNew)&igtl::PlusCompressedImageMessage::New);
   this->IgtlFactory->AddMessageType("TRACKEDFRAME", (PointerToMessageBaseNew)&igtl::PlusTrackedFrameMessage::New);
   this->IgtlFactory->AddMessageType("USMESSAGE", (PointerToMessageBaseNew)&igtl::PlusUsMessage::New);
 }
@@ -53,6 +56,7 @@ vtkPlusIgtlMessageFactory::~vtkPlusIgtlMessageFactory()
 void vtkPlusIgtlMessageFactory::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+  os << indent << "PackTrackingDataWithFrames: " << (this->PackTrackingDataWithFrames ? "true" : "false") << std::endl;
   this->PrintAvailableMessageTypes(os, indent);
 }
 
@@ -127,7 +131,8 @@ igtl::MessageBase::Pointer vtkPlusIgtlMessageFactory::CreateSendMessage(const st
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusIgtlMessageFactory::PackMessages(const PlusIgtlClientInfo& clientInfo, std::vector<igtl::MessageBase::Pointer>& igtlMessages, PlusTrackedFrame& trackedFrame,
-    bool packValidTransformsOnly, vtkPlusTransformRepository* transformRepository/*=NULL*/)
+    bool packValidTransformsOnly, vtkPlusTransformRepository* transformRepository/*=NULL*/, ImageCompressorMapType* imageCompressors/*=NULL*/,
+    vtkPlusIgtlImageProcessor* imageProcessor/*=NULL*/)
 {
   int numberOfErrors(0);
   igtlMessages.clear();
@@ -177,7 +182,6 @@ PlusStatus vtkPlusIgtlMessageFactory::PackMessages(const PlusIgtlClientInfo& cli
           continue;
         }
 
-        igtl::ImageMessage::Pointer imageMessage = dynamic_cast<igtl::ImageMessage*>(igtlMessage->Clone().GetPointer());
         std::string deviceName = imageTransformName.From() + std::string("_") + imageTransformName.To();
         if (trackedFrame.IsCustomFrameFieldDefined(PlusTrackedFrame::FIELD_FRIENDLY_DEVICE_NAME))
         {
@@ -185,8 +189,74 @@ PlusStatus vtkPlusIgtlMessageFactory::PackMessages(const PlusIgtlClientInfo& cli
           // The transform name is passed in the metadata
           deviceName = trackedFrame.GetCustomFrameField(PlusTrackedFrame::FIELD_FRIENDLY_DEVICE_NAME);
         }
+
+        // Crop, downsample, and convert to grayscale as requested by the client for this stream
+        const PlusVideoFrame* frame = trackedFrame.GetImageData();
+        if (imageProcessor != NULL && imageStream.IsProcessingRequested())
+        {
+          vtkSmartPointer<vtkMatrix4x4> processedToInputImageTransform = vtkSmartPointer<vtkMatrix4x4>::New();
+          if (imageProcessor->GetProcessedFrame(*trackedFrame.GetImageData(), imageStream, frame, processedToInputImageTransform) != PLUS_SUCCESS)
+          {
+            LOG_ERROR("Failed to create " << messageType << " message - unable to process image of stream " << imageStream.Name);
+            numberOfErrors++;
+            continue;
+          }
+          // Only the origin is moved, the downsampling is described by the spacing of the processed frame
+          vtkMatrix4x4::Multiply4x4(matrix, processedToInputImageTransform, matrix);
+        }
+
+        // Send compressed image if the client requested it for this stream
+        vtkPlusIgtlImageCompressor* compressor = NULL;
+        if (imageCompressors != NULL)
+        {
+          ImageCompressorMapType::iterator compressorIt = imageCompressors->find(imageStream.Name);
+          if (compressorIt != imageCompressors->end())
+          {
+            compressor = compressorIt->second;
+          }
+        }
+        if (compressor != NULL)
+        {
+          igtl::PlusCompressedImageMessage::Pointer compressedImageMessage = dynamic_cast<igtl::PlusCompressedImageMessage*>(this->CreateSendMessage("COMPIMAGE", clientInfo.ClientHeaderVersion).GetPointer());
+          if (compressedImageMessage.IsNull())
+          {
+            LOG_ERROR("Failed to create COMPIMAGE message");
+            numberOfErrors++;
+            continue;
+          }
+          compressedImageMessage->SetDeviceName(deviceName.c_str());
+          // COMPIMAGE has no spacing field, its embedded transform maps pixel indices, so it has to include the downsampling
+          vtkSmartPointer<vtkMatrix4x4> embeddedImageTransform = vtkSmartPointer<vtkMatrix4x4>::New();
+          embeddedImageTransform->DeepCopy(matrix);
+          if (frame != trackedFrame.GetImageData())
+          {
+            double inputSpacing[3] = { 1.0, 1.0, 1.0 };
+            double processedSpacing[3] = { 1.0, 1.0, 1.0 };
+            trackedFrame.GetImageData()->GetImage()->GetSpacing(inputSpacing);
+            frame->GetImage()->GetSpacing(processedSpacing);
+            for (int column = 0; column < 3; ++column)
+            {
+              for (int row = 0; row < 3; ++row)
+              {
+                embeddedImageTransform->SetElement(row, column, matrix->GetElement(row, column) * processedSpacing[column] / inputSpacing[column]);
+              }
+            }
+          }
+          if (vtkPlusIgtlMessageCommon::PackCompressedImageMessage(compressedImageMessage, *frame, trackedFrame.GetTimestamp(), *embeddedImageTransform, compressor) != PLUS_SUCCESS)
+          {
+            LOG_ERROR("Failed to create COMPIMAGE message - unable to pack compressed image message");
+            // The client will not receive this frame, so the next frame must not depend on it
+            compressor->ResetReferenceFrame();
+            numberOfErrors++;
+            continue;
+          }
+          igtlMessages.push_back(compressedImageMessage.GetPointer());
+          continue;
+        }
+
+        igtl::ImageMessage::Pointer imageMessage = dynamic_cast<igtl::ImageMessage*>(igtlMessage->Clone().GetPointer());
         imageMessage->SetDeviceName(deviceName.c_str());
-        if (vtkPlusIgtlMessageCommon::PackImageMessage(imageMessage, trackedFrame, *matrix) != PLUS_SUCCESS)
+        if (vtkPlusIgtlMessageCommon::PackImageMessage(imageMessage, *frame, trackedFrame.GetTimestamp(), *matrix) != PLUS_SUCCESS)
         {
           LOG_ERROR("Failed to create " << messageType << " message - unable to pack image message");
           numberOfErrors++;
@@ -221,32 +291,12 @@ PlusStatus vtkPlusIgtlMessageFactory::PackMessages(const PlusIgtlClientInfo& cli
     // Tracking data message
     else if (typeid(*igtlMessage) == typeid(igtl::TrackingDataMessage))
     {
-      if (clientInfo.TDATARequested && clientInfo.LastTDATASentTimeStamp + clientInfo.Resolution < trackedFrame.GetTimestamp())
+      if (this->PackTrackingDataWithFrames && IsTrackingDataDue(clientInfo, trackedFrame.GetTimestamp()))
       {
-        std::map<std::string, vtkSmartPointer<vtkMatrix4x4> > transforms;
-        for (std::vector<PlusTransformName>::const_iterator transformNameIterator = clientInfo.TransformNames.begin(); transformNameIterator != clientInfo.TransformNames.end(); ++transformNameIterator)
+        if (this->PackTrackingDataMessage(clientInfo, igtlMessages, trackedFrame.GetTimestamp(), packValidTransformsOnly, transformRepository) != PLUS_SUCCESS)
         {
-          PlusTransformName transformName = (*transformNameIterator);
-
-          bool isValid = false;
-          vtkSmartPointer<vtkMatrix4x4> mat = vtkSmartPointer<vtkMatrix4x4>::New();
-          transformRepository->GetTransform(transformName, mat, &isValid);
-
-          if (!isValid && packValidTransformsOnly)
-          {
-            LOG_TRACE("Attempted to send invalid transform over IGT Link when server has prevented sending.");
-            continue;
-          }
-
-          std::string transformNameStr;
-          transformName.GetTransformName(transformNameStr);
-
-          transforms[transformNameStr] = mat;
+          numberOfErrors++;
         }
-
-        igtl::TrackingDataMessage::Pointer trackingDataMessage = dynamic_cast<igtl::TrackingDataMessage*>(igtlMessage->Clone().GetPointer());
-        vtkPlusIgtlMessageCommon::PackTrackingDataMessage(trackingDataMessage, transforms, trackedFrame.GetTimestamp());
-        igtlMessages.push_back(trackingDataMessage.GetPointer());
       }
     }
     // Position message
@@ -353,3 +403,70 @@ PlusStatus vtkPlusIgtlMessageFactory::PackMessages(const PlusIgtlClientInfo& cli
   return (numberOfErrors == 0 ? PLUS_SUCCESS : PLUS_FAIL);
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageFactory::PackTrackingDataMessage(const PlusIgtlClientInfo& clientInfo, std::vector<igtl::MessageBase::Pointer>& igtlMessages, double timestamp,
+    bool packValidTransformsOnly, vtkPlusTransformRepository* transformRepository)
+{
+  if (transformRepository == NULL)
+  {
+    LOG_ERROR("Failed to pack TDATA message - transform repository is not available");
+    return PLUS_FAIL;
+  }
+
+  std::map<std::string, vtkSmartPointer<vtkMatrix4x4> > transforms;
+  for (std::vector<PlusTransformName>::const_iterator transformNameIterator = clientInfo.TransformNames.begin(); transformNameIterator != clientInfo.TransformNames.end(); ++transformNameIterator)
+  {
+    PlusTransformName transformName = (*transformNameIterator);
+
+    bool isValid = false;
+    vtkSmartPointer<vtkMatrix4x4> mat = vtkSmartPointer<vtkMatrix4x4>::New();
+    transformRepository->GetTransform(transformName, mat, &isValid);
+
+    if (!isValid && packValidTransformsOnly)
+    {
+      LOG_TRACE("Attempted to send invalid transform over IGT Link when server has prevented sending.");
+      continue;
+    }
+
+    std::string transformNameStr;
+    transformName.GetTransformName(transformNameStr);
+
+    transforms[transformNameStr] = mat;
+  }
+
+  igtl::MessageBase::Pointer igtlMessage;
+  try
+  {
+    igtlMessage = this->IgtlFactory->CreateSendMessage("TDATA", clientInfo.ClientHeaderVersion);
+  }
+  catch (std::invalid_argument* e)
+  {
+    LOG_ERROR("Unable to create message: " << e);
+    return PLUS_FAIL;
+  }
+
+  igtl::TrackingDataMessage::Pointer trackingDataMessage = dynamic_cast<igtl::TrackingDataMessage*>(igtlMessage.GetPointer());
+  if (trackingDataMessage.IsNull())
+  {
+    LOG_ERROR("Failed to pack TDATA message - unable to create message instance");
+    return PLUS_FAIL;
+  }
+  if (vtkPlusIgtlMessageCommon::PackTrackingDataMessage(trackingDataMessage, transforms, timestamp) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to pack TDATA message");
+    return PLUS_FAIL;
+  }
+  igtlMessages.push_back(trackingDataMessage.GetPointer());
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusIgtlMessageFactory::IsTrackingDataDue(const PlusIgtlClientInfo& clientInfo, double timestamp)
+{
+  if (!clientInfo.TDATARequested)
+  {
+    return false;
+  }
+  // Resolution is specified in milliseconds by the OpenIGTLink protocol
+  return clientInfo.LastTDATASentTimeStamp + clientInfo.Resolution * 0.001 <= timestamp;
+}
@@ -14,6 +14,11 @@
 #include "igtlMessageBase.h"
 #include "igtlMessageFactory.h"
 #include "PlusIgtlClientInfo.h" 
+#include "vtkPlusIgtlImageCompressor.h"
+#include "vtkPlusIgtlImageProcessor.h"
+#include "vtkSmartPointer.h"
+
+#include <map>
 
 class vtkXMLDataElement; 
 class PlusTrackedFrame; 
@@ -37,6 +42,9 @@ public:
   /*! Function pointer for storing New() static methods of igtl::MessageBase classes */ 
   typedef igtl::MessageBase::Pointer (*PointerToMessageBaseNew)(); 
 
+  /*! Image compressors of a client, indexed by image stream name */
+  typedef std::map<std::string, vtkSmartPointer<vtkPlusIgtlImageCompressor> > ImageCompressorMapType;
+
   /*! 
   Get pointer to message type new function, or NULL if the message type not registered 
   Usage: igtl::MessageBase::Pointer message = GetMessageTypeNewPointer("IMAGE")(); 
@@ -70,9 +78,38 @@ public:
   \param igtMessages Output list for the generated IGTL messages
   \param trackedFrame Input tracked frame data used for IGTL message generation 
   \param transformRepository Transform repository used for computing the selected transforms 
+  \param imageCompressors Compressors of image streams that the client requested compression for. Images of a stream
+    are sent in COMPIMAGE messages instead of IMAGE messages if a compressor is available for the stream.
+  \param imageProcessor Crops, downsamples, and converts images to grayscale as requested in the image stream options.
+    Processed images are cached in the processor, so that they can be reused for other clients with the same options.
+    If NULL then the image stream options are ignored.
   */ 
   PlusStatus PackMessages(const PlusIgtlClientInfo& clientInfo, std::vector<igtl::MessageBase::Pointer>& igtMessages, PlusTrackedFrame& trackedFrame, 
-    bool packValidTransformsOnly, vtkPlusTransformRepository* transformRepository=NULL); 
+    bool packValidTransformsOnly, vtkPlusTransformRepository* transformRepository=NULL, ImageCompressorMapType* imageCompressors=NULL,
+    vtkPlusIgtlImageProcessor* imageProcessor=NULL); 
+
+  /*!
+  Pack all the transforms requested by the client into a single TDATA message.
+  The transforms are computed by the transform repository, which must contain the transforms at the given timestamp.
+  \param timestamp Timestamp of the transforms, as sent to the client (UTC)
+  \param igtMessages The generated TDATA message is appended to this list
+  */
+  PlusStatus PackTrackingDataMessage(const PlusIgtlClientInfo& clientInfo, std::vector<igtl::MessageBase::Pointer>& igtMessages, double timestamp,
+    bool packValidTransformsOnly, vtkPlusTransformRepository* transformRepository);
+
+  /*!
+  Returns true if the client requested tracking data (STT_TDATA) and the resolution (minimum time between
+  TDATA messages, in milliseconds) has elapsed since the last TDATA message was sent to the client.
+  */
+  static bool IsTrackingDataDue(const PlusIgtlClientInfo& clientInfo, double timestamp);
+
+  /*!
+  If enabled (default) then PackMessages generates TDATA messages from the tracked frames.
+  Disable it if TDATA messages are sent separately, at the native rate of the tracker.
+  */
+  vtkSetMacro(PackTrackingDataWithFrames, bool);
+  vtkGetMacro(PackTrackingDataWithFrames, bool);
+  vtkBooleanMacro(PackTrackingDataWithFrames, bool);
 
 protected:
   vtkPlusIgtlMessageFactory();
@@ -80,6 +117,8 @@ protected:
 
   igtl::MessageFactory::Pointer IgtlFactory;
 
+  bool PackTrackingDataWithFrames;
+
 private:
   vtkPlusIgtlMessageFactory(const vtkPlusIgtlMessageFactory&);
   void operator=(const vtkPlusIgtlMessageFactory&);
@@ -0,0 +1,106 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusPerformanceStatistics.h"
+#include "vtkPlusGetPerformanceStatisticsCommand.h"
+
+#include <vtkXMLDataElement.h>
+
+vtkStandardNewMacro(vtkPlusGetPerformanceStatisticsCommand);
+
+namespace
+{
+  static const std::string GET_PERFORMANCE_STATISTICS_CMD = "GetPerformanceStatistics";
+}
+
+//----------------------------------------------------------------------------
+vtkPlusGetPerformanceStatisticsCommand::vtkPlusGetPerformanceStatisticsCommand()
+  : Reset(false)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusGetPerformanceStatisticsCommand::~vtkPlusGetPerformanceStatisticsCommand()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusGetPerformanceStatisticsCommand::SetNameToGetPerformanceStatistics()
+{
+  this->SetName(GET_PERFORMANCE_STATISTICS_CMD);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusGetPerformanceStatisticsCommand::GetCommandNames(std::list<std::string>& cmdNames)
+{
+  cmdNames.clear();
+  cmdNames.push_back(GET_PERFORMANCE_STATISTICS_CMD);
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusGetPerformanceStatisticsCommand::GetDescription(const std::string& commandName)
+{
+  std::string desc;
+  if (commandName.empty() || PlusCommon::IsEqualInsensitive(commandName, GET_PERFORMANCE_STATISTICS_CMD))
+  {
+    desc += GET_PERFORMANCE_STATISTICS_CMD;
+    desc += ": Retrieve the performance statistics (durations, rates, dropped items) of the server. Attributes: Reset: if TRUE then statistics are reset after retrieval.";
+  }
+  return desc;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusGetPerformanceStatisticsCommand::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Reset: " << (this->Reset ? "true" : "false") << std::endl;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusGetPerformanceStatisticsCommand::ReadConfiguration(vtkXMLDataElement* aConfig)
+{
+  if (vtkPlusCommand::ReadConfiguration(aConfig) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(Reset, aConfig);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusGetPerformanceStatisticsCommand::WriteConfiguration(vtkXMLDataElement* aConfig)
+{
+  if (vtkPlusCommand::WriteConfiguration(aConfig) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  XML_WRITE_BOOL_ATTRIBUTE(Reset, aConfig);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusGetPerformanceStatisticsCommand::Execute()
+{
+  LOG_DEBUG("vtkPlusGetPerformanceStatisticsCommand::Execute: reset=" << (this->Reset ? "true" : "false"));
+
+  vtkSmartPointer<vtkXMLDataElement> statisticsElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  PlusPerformanceStatistics::GetInstance()->WriteSummary(statisticsElement);
+  if (this->Reset)
+  {
+    PlusPerformanceStatistics::GetInstance()->Reset();
+  }
+
+  std::ostringstream statisticsStream;
+  if (PlusCommon::XML::PrintXML(statisticsStream, vtkIndent(0), statisticsElement) != PLUS_SUCCESS)
+  {
+    this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", "Failed to write performance statistics.");
+    return PLUS_FAIL;
+  }
+
+  this->QueueCommandResponse(PLUS_SUCCESS, statisticsStream.str());
+  return PLUS_SUCCESS;
+}
@@ -0,0 +1,64 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusGetPerformanceStatisticsCommand_h
+#define __vtkPlusGetPerformanceStatisticsCommand_h
+
+#include "vtkPlusServerExport.h"
+#include "vtkPlusCommand.h"
+
+/*!
+  \class vtkPlusGetPerformanceStatisticsCommand
+  \brief This command returns the summary of the performance statistics (durations, rates, dropped items) of the server
+
+  The response message contains the PerformanceStatistics XML element (see PlusPerformanceStatistics::WriteSummary).
+  If Reset is enabled then all statistics are reset after the summary is created.
+
+  \ingroup PlusLibPlusServer
+ */
+class vtkPlusServerExport vtkPlusGetPerformanceStatisticsCommand : public vtkPlusCommand
+{
+public:
+  static vtkPlusGetPerformanceStatisticsCommand* New();
+  vtkTypeMacro(vtkPlusGetPerformanceStatisticsCommand, vtkPlusCommand);
+  virtual void PrintSelf(ostream& os, vtkIndent indent);
+  virtual vtkPlusCommand* Clone() { return New(); }
+
+  /*! Executes the command  */
+  virtual PlusStatus Execute();
+
+  /*! Read command parameters from XML */
+  virtual PlusStatus ReadConfiguration(vtkXMLDataElement* aConfig);
+
+  /*! Write command parameters to XML */
+  virtual PlusStatus WriteConfiguration(vtkXMLDataElement* aConfig);
+
+  /*! Get all the command names that this class can execute */
+  virtual void GetCommandNames(std::list<std::string>& cmdNames);
+
+  /*! Gets the description for the specified command name. */
+  virtual std::string GetDescription(const std::string& commandName);
+
+  vtkGetMacro(Reset, bool);
+  vtkSetMacro(Reset, bool);
+  vtkBooleanMacro(Reset, bool);
+
+  void SetNameToGetPerformanceStatistics();
+
+protected:
+  vtkPlusGetPerformanceStatisticsCommand();
+  virtual ~vtkPlusGetPerformanceStatisticsCommand();
+
+protected:
+  /*! If enabled then all statistics are reset after the summary is created */
+  bool Reset;
+
+private:
+  vtkPlusGetPerformanceStatisticsCommand(const vtkPlusGetPerformanceStatisticsCommand&);
+  void operator=(const vtkPlusGetPerformanceStatisticsCommand&);
+};
+
+#endif
@@ -0,0 +1,133 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommandProcessor.h"
+#include "vtkPlusOpenIGTLinkServer.h"
+#include "vtkPlusSetImageStreamOptionsCommand.h"
+
+#include <vtkXMLDataElement.h>
+
+vtkStandardNewMacro(vtkPlusSetImageStreamOptionsCommand);
+
+namespace
+{
+  static const std::string SET_IMAGE_STREAM_OPTIONS_CMD = "SetImageStreamOptions";
+}
+
+//----------------------------------------------------------------------------
+vtkPlusSetImageStreamOptionsCommand::vtkPlusSetImageStreamOptionsCommand()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusSetImageStreamOptionsCommand::~vtkPlusSetImageStreamOptionsCommand()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSetImageStreamOptionsCommand::SetNameToSetImageStreamOptions()
+{
+  this->SetName(SET_IMAGE_STREAM_OPTIONS_CMD);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSetImageStreamOptionsCommand::SetImageStreamOptions(const PlusIgtlClientInfo::ImageStream& imageStreamOptions)
+{
+  this->ImageStreamOptions = imageStreamOptions;
+}
+
+//----------------------------------------------------------------------------
+const PlusIgtlClientInfo::ImageStream& vtkPlusSetImageStreamOptionsCommand::GetImageStreamOptions() const
+{
+  return this->ImageStreamOptions;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSetImageStreamOptionsCommand::GetCommandNames(std::list<std::string>& cmdNames)
+{
+  cmdNames.clear();
+  cmdNames.push_back(SET_IMAGE_STREAM_OPTIONS_CMD);
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusSetImageStreamOptionsCommand::GetDescription(const std::string& commandName)
+{
+  std::string desc;
+  if (commandName.empty() || PlusCommon::IsEqualInsensitive(commandName, SET_IMAGE_STREAM_OPTIONS_CMD))
+  {
+    desc += SET_IMAGE_STREAM_OPTIONS_CMD;
+    desc += ": Change the processing of an image stream sent to this client. Attributes: ImageName: name of the image stream."
+            " ClipRectangleOrigin, ClipRectangleSize: region of interest in pixels."
+            " DownsamplingFactor: integer downsampling factor. DownsamplingMethod: DECIMATE or AVERAGE."
+            " Grayscale: if TRUE then color images are converted to grayscale.";
+  }
+  return desc;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSetImageStreamOptionsCommand::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "ImageName: " << this->ImageStreamOptions.Name << std::endl;
+  os << indent << "ClipRectangleOrigin: " << this->ImageStreamOptions.ClipRectangleOrigin[0] << " " << this->ImageStreamOptions.ClipRectangleOrigin[1] << " " << this->ImageStreamOptions.ClipRectangleOrigin[2] << std::endl;
+  os << indent << "ClipRectangleSize: " << this->ImageStreamOptions.ClipRectangleSize[0] << " " << this->ImageStreamOptions.ClipRectangleSize[1] << " " << this->ImageStreamOptions.ClipRectangleSize[2] << std::endl;
+  os << indent << "DownsamplingFactor: " << this->ImageStreamOptions.DownsamplingFactor << std::endl;
+  os << indent << "DownsamplingMethod: " << PlusIgtlClientInfo::ImageStream::GetStringFromDownsamplingMethod(this->ImageStreamOptions.DownsamplingMethod) << std::endl;
+  os << indent << "Grayscale: " << (this->ImageStreamOptions.Grayscale ? "true" : "false") << std::endl;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSetImageStreamOptionsCommand::ReadConfiguration(vtkXMLDataElement* aConfig)
+{
+  if (vtkPlusCommand::ReadConfiguration(aConfig) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  const char* imageName = aConfig->GetAttribute("ImageName");
+  if (imageName == NULL)
+  {
+    LOG_ERROR("Unable to read " << SET_IMAGE_STREAM_OPTIONS_CMD << " command - ImageName attribute is missing");
+    return PLUS_FAIL;
+  }
+  this->ImageStreamOptions.Name = imageName;
+
+  return this->ImageStreamOptions.ReadProcessingOptions(aConfig);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSetImageStreamOptionsCommand::WriteConfiguration(vtkXMLDataElement* aConfig)
+{
+  if (vtkPlusCommand::WriteConfiguration(aConfig) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  aConfig->SetAttribute("ImageName", this->ImageStreamOptions.Name.c_str());
+  this->ImageStreamOptions.WriteProcessingOptions(aConfig);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSetImageStreamOptionsCommand::Execute()
+{
+  LOG_DEBUG("vtkPlusSetImageStreamOptionsCommand::Execute: image stream " << this->ImageStreamOptions.Name);
+
+  if (this->CommandProcessor == NULL || this->CommandProcessor->GetPlusServer() == NULL)
+  {
+    this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", "Server is not available.");
+    return PLUS_FAIL;
+  }
+
+  if (this->CommandProcessor->GetPlusServer()->SetClientImageStreamProcessingOptions(this->GetClientId(), this->ImageStreamOptions) != PLUS_SUCCESS)
+  {
+    this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", "Image stream " + this->ImageStreamOptions.Name + " is not sent to this client.");
+    return PLUS_FAIL;
+  }
+
+  this->QueueCommandResponse(PLUS_SUCCESS, "Image stream " + this->ImageStreamOptions.Name + " options updated.");
+  return PLUS_SUCCESS;
+}
@@ -0,0 +1,68 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusSetImageStreamOptionsCommand_h
+#define __vtkPlusSetImageStreamOptionsCommand_h
+
+#include "vtkPlusServerExport.h"
+#include "vtkPlusCommand.h"
+
+#include "PlusIgtlClientInfo.h"
+
+/*!
+  \class vtkPlusSetImageStreamOptionsCommand
+  \brief This command changes how an image stream is processed before it is sent to the requesting client
+
+  The image stream is identified by the ImageName attribute (the Name of the image in the client info).
+  The ClipRectangleOrigin, ClipRectangleSize, DownsamplingFactor, DownsamplingMethod, and Grayscale attributes
+  replace the current processing options of the stream, unspecified options are reset to their default (no processing).
+  Only the image stream of the client that sent the command is modified.
+
+  \ingroup PlusLibPlusServer
+ */
+class vtkPlusServerExport vtkPlusSetImageStreamOptionsCommand : public vtkPlusCommand
+{
+public:
+  static vtkPlusSetImageStreamOptionsCommand* New();
+  vtkTypeMacro(vtkPlusSetImageStreamOptionsCommand, vtkPlusCommand);
+  virtual void PrintSelf(ostream& os, vtkIndent indent);
+  virtual vtkPlusCommand* Clone() { return New(); }
+
+  /*! Executes the command  */
+  virtual PlusStatus Execute();
+
+  /*! Read command parameters from XML */
+  virtual PlusStatus ReadConfiguration(vtkXMLDataElement* aConfig);
+
+  /*! Write command parameters to XML */
+  virtual PlusStatus WriteConfiguration(vtkXMLDataElement* aConfig);
+
+  /*! Get all the command names that this class can execute */
+  virtual void GetCommandNames(std::list<std::string>& cmdNames);
+
+  /*! Gets the description for the specified command name. */
+  virtual std::string GetDescription(const std::string& commandName);
+
+  /*! Set the image stream name and processing options */
+  void SetImageStreamOptions(const PlusIgtlClientInfo::ImageStream& imageStreamOptions);
+  const PlusIgtlClientInfo::ImageStream& GetImageStreamOptions() const;
+
+  void SetNameToSetImageStreamOptions();
+
+protected:
+  vtkPlusSetImageStreamOptionsCommand();
+  virtual ~vtkPlusSetImageStreamOptionsCommand();
+
+protected:
+  /*! Image stream name and the requested processing options */
+  PlusIgtlClientInfo::ImageStream ImageStreamOptions;
+
+private:
+  vtkPlusSetImageStreamOptionsCommand(const vtkPlusSetImageStreamOptionsCommand&);
+  void operator=(const vtkPlusSetImageStreamOptionsCommand&);
+};
+
+#endif
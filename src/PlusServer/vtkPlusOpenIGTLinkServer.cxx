@@ -6,11 +6,15 @@ See License.txt for details.
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusPerformanceStatistics.h"
 #include "PlusTrackedFrame.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusCommand.h"
 #include "vtkPlusCommandProcessor.h"
 #include "vtkPlusDataCollector.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusIgtlImageCompressor.h"
+#include "vtkPlusIgtlImageProcessor.h"
 #include "vtkPlusIgtlMessageCommon.h"
 #include "vtkPlusIgtlMessageFactory.h"
 #include "vtkPlusOpenIGTLinkServer.h"
@@ -25,6 +29,10 @@ See License.txt for details.
 #include <vtkPolyData.h>
 #include <vtkPolyDataReader.h>
 
+// STL includes
+#include <cctype>
+#include <set>
+
 // OpenIGTLink includes
 #include <igtlCommandMessage.h>
 #include <igtlImageMessage.h>
@@ -80,8 +88,14 @@ vtkPlusOpenIGTLinkServer::vtkPlusOpenIGTLinkServer()
   , ConnectionReceiverThreadId(-1)
   , DataSenderThreadId(-1)
   , IgtlMessageFactory(vtkSmartPointer<vtkPlusIgtlMessageFactory>::New())
+  , ImageProcessor(vtkSmartPointer<vtkPlusIgtlImageProcessor>::New())
   , IgtlClientsMutex(vtkSmartPointer<vtkPlusRecursiveCriticalSection>::New())
   , LastSentTrackedFrameTimestamp(0)
+  , LastSentTrackingDataTimestamp(0)
+  , SendTrackingDataAtNativeRate(true)
+  , TrackingDataSendStatistics(NULL)
+  , PackStatistics(NULL)
+  , SendStatistics(NULL)
   , MaxTimeSpentWithProcessingMs(50)
   , LastProcessingTimePerFrameMs(-1)
   , SendValidTransformsOnly(true)
@@ -93,6 +107,8 @@ vtkPlusOpenIGTLinkServer::vtkPlusOpenIGTLinkServer()
   , BroadcastChannel(NULL)
   , LogWarningOnNoDataAvailable(true)
   , KeepAliveIntervalSec(CLIENT_SOCKET_TIMEOUT_SEC / 2.0)
+  , PerformanceStatisticsLoggingPeriodSec(0.0)
+  , ImageCompressionNumberOfThreads(0)
   , GracePeriodLogLevel(vtkPlusLogger::LOG_LEVEL_DEBUG)
   , MissingInputGracePeriodSec(0.0)
   , BroadcastStartTime(0.0)
@@ -171,6 +187,16 @@ PlusStatus vtkPlusOpenIGTLinkServer::StartOpenIGTLinkService()
 
   this->PlusCommandProcessor->SetPlusServer(this);
 
+  std::ostringstream statisticsNamePrefix;
+  statisticsNamePrefix << "IgtlServer." << this->ListeningPort << ".";
+  this->ImageProcessor->SetStatisticsNamePrefix(statisticsNamePrefix.str());
+  this->TrackingDataSendStatistics = PlusPerformanceStatistics::GetInstance()->GetHistogram(statisticsNamePrefix.str() + "TrackingDataSendMs");
+  this->PackStatistics = PlusPerformanceStatistics::GetInstance()->GetHistogram(statisticsNamePrefix.str() + "PackMs");
+  this->SendStatistics = PlusPerformanceStatistics::GetInstance()->GetHistogram(statisticsNamePrefix.str() + "SendMs");
+
+  // TDATA is either sent by the tracking-only send path or with the tracked frames, never both
+  this->IgtlMessageFactory->SetPackTrackingDataWithFrames(!this->SendTrackingDataAtNativeRate);
+
   this->BroadcastStartTime = vtkPlusAccurateTimer::GetSystemTime();
 
   return PLUS_SUCCESS;
@@ -348,6 +374,7 @@ void* vtkPlusOpenIGTLinkServer::DataSenderThread(vtkMultiThreader::ThreadInfo* d
       // No client connected, wait for a while
       vtkPlusAccurateTimer::Delay(0.2);
       self->LastSentTrackedFrameTimestamp = 0; // next time start sending from the most recent timestamp
+      self->LastSentTrackingDataTimestamp = 0;
       continue;
     }
 
@@ -361,8 +388,13 @@ void* vtkPlusOpenIGTLinkServer::DataSenderThread(vtkMultiThreader::ThreadInfo* d
     // Send remote command execution replies to clients before sending any images/transforms/etc...
     SendCommandResponses(*self);
 
+    // Send tracking data at the native rate of the tracker, without waiting for video frames
+    SendLatestTrackingDataToClients(*self);
+
     // Send image/tracking/string data
     SendLatestFramesToClients(*self, elapsedTimeSinceLastPacketSentSec);
+
+    PlusPerformanceStatistics::GetInstance()->UpdatePeriodicLogging();
   }
   // Close thread
   self->DataSenderThreadId = -1;
@@ -448,6 +480,12 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendLatestFramesToClients(vtkPlusOpenIGTLin
   {
     self.LastProcessingTimePerFrameMs = computationTimeMs / trackedFrameList->GetNumberOfTrackedFrames();
   }
+
+  // Frames have been sent, let the channel reuse them in the next round
+  if (self.BroadcastChannel != NULL)
+  {
+    self.BroadcastChannel->RecycleTrackedFrames(trackedFrameList);
+  }
   return PLUS_SUCCESS;
 }
 
@@ -781,6 +819,9 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendTrackedFrame(PlusTrackedFrame& trackedF
   double timestampUniversal = vtkPlusAccurateTimer::GetUniversalTimeFromSystemTime(timestampSystem);
   trackedFrame.SetTimestamp(timestampUniversal);
 
+  // Images processed for the previous frame cannot be reused
+  this->ImageProcessor->ResetCache();
+
   std::vector<int> disconnectedClientIds;
   {
     // Lock before we send message to the clients
@@ -793,12 +834,17 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendTrackedFrame(PlusTrackedFrame& trackedF
       std::vector<igtl::MessageBase::Pointer> igtlMessages;
       std::vector<igtl::MessageBase::Pointer>::iterator igtlMessageIterator;
 
-      if (this->IgtlMessageFactory->PackMessages(clientIterator->ClientInfo, igtlMessages, trackedFrame, this->SendValidTransformsOnly, this->TransformRepository) != PLUS_SUCCESS)
       {
-        LOG_WARNING("Failed to pack all IGT messages");
+        PlusPerformanceScopedTimer packTimer(this->PackStatistics);
+        this->UpdateImageCompressors(*clientIterator);
+        if (this->IgtlMessageFactory->PackMessages(clientIterator->ClientInfo, igtlMessages, trackedFrame, this->SendValidTransformsOnly, this->TransformRepository, &clientIterator->ImageCompressors, this->ImageProcessor) != PLUS_SUCCESS)
+        {
+          LOG_WARNING("Failed to pack all IGT messages");
+        }
       }
 
       // Send all messages to a client
+      PlusPerformanceScopedTimer sendTimer(this->SendStatistics);
       for (igtlMessageIterator = igtlMessages.begin(); igtlMessageIterator != igtlMessages.end(); ++igtlMessageIterator)
       {
         igtl::MessageBase::Pointer igtlMessage = (*igtlMessageIterator);
@@ -819,8 +865,10 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendTrackedFrame(PlusTrackedFrame& trackedF
           break;
         }
 
-        // Update the TDATA timestamp, even if TDATA isn't sent (cheaper than checking for existing TDATA message type)
-        clientIterator->ClientInfo.LastTDATASentTimeStamp = trackedFrame.GetTimestamp();
+        if (typeid(*igtlMessage) == typeid(igtl::TrackingDataMessage))
+        {
+          clientIterator->ClientInfo.LastTDATASentTimeStamp = trackedFrame.GetTimestamp();
+        }
       }
     }
   }
@@ -837,6 +885,146 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendTrackedFrame(PlusTrackedFrame& trackedF
   return (numberOfErrors == 0 ? PLUS_SUCCESS : PLUS_FAIL);
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkServer::SendLatestTrackingDataToClients(vtkPlusOpenIGTLinkServer& self)
+{
+  if (!self.SendTrackingDataAtNativeRate || self.BroadcastChannel == NULL || self.BroadcastChannel->ToolCount() == 0
+      || !self.BroadcastChannel->GetTrackingDataAvailable())
+  {
+    return PLUS_SUCCESS;
+  }
+
+  bool trackingDataRequested = false;
+  {
+    PlusLockGuard<vtkPlusRecursiveCriticalSection> igtlClientsMutexGuardedLock(self.IgtlClientsMutex);
+    for (std::list<ClientData>::iterator clientIterator = self.IgtlClients.begin(); clientIterator != self.IgtlClients.end(); ++clientIterator)
+    {
+      if (clientIterator->ClientInfo.TDATARequested)
+      {
+        trackingDataRequested = true;
+        break;
+      }
+    }
+  }
+  if (!trackingDataRequested)
+  {
+    self.LastSentTrackingDataTimestamp = 0; // next time start sending from the most recent sample
+    return PLUS_SUCCESS;
+  }
+
+  // Tools of a tracker are not updated atomically, so only send samples that are already available for all tools
+  double latestCommonTimestamp = 0;
+  for (DataSourceContainerIterator it = self.BroadcastChannel->GetToolsStartIterator(); it != self.BroadcastChannel->GetToolsEndIterator(); ++it)
+  {
+    double latestTimestamp = 0;
+    if (it->second->GetLatestTimeStamp(latestTimestamp) != ITEM_OK)
+    {
+      return PLUS_SUCCESS;
+    }
+    if (it == self.BroadcastChannel->GetToolsStartIterator() || latestTimestamp < latestCommonTimestamp)
+    {
+      latestCommonTimestamp = latestTimestamp;
+    }
+  }
+
+  // New samples are detected in the buffer of the first tool, other tools are interpolated at the same timestamp.
+  // Collect the new sample timestamps from the newest one backwards; if nothing has been sent yet then only the newest one.
+  vtkPlusDataSource* referenceTool = self.BroadcastChannel->GetToolsStartIterator()->second;
+  BufferItemUidType oldestUid = referenceTool->GetOldestItemUidInBuffer();
+  std::vector<double> sampleTimestamps;
+  for (BufferItemUidType uid = referenceTool->GetLatestItemUidInBuffer(); static_cast<int>(sampleTimestamps.size()) < self.MaxNumberOfIgtlMessagesToSend; --uid)
+  {
+    double timestamp = 0;
+    if (referenceTool->GetTimeStamp(uid, timestamp) != ITEM_OK || timestamp <= self.LastSentTrackingDataTimestamp)
+    {
+      break;
+    }
+    if (timestamp <= latestCommonTimestamp)
+    {
+      sampleTimestamps.push_back(timestamp);
+      if (self.LastSentTrackingDataTimestamp == 0)
+      {
+        break;
+      }
+    }
+    if (uid == oldestUid)
+    {
+      break;
+    }
+  }
+
+  // Send the samples in chronological order
+  for (std::vector<double>::reverse_iterator timestampIt = sampleTimestamps.rbegin(); timestampIt != sampleTimestamps.rend(); ++timestampIt)
+  {
+    PlusTrackedFrame trackingFrame;
+    if (self.BroadcastChannel->GetTrackedFrame(*timestampIt, trackingFrame, false) != PLUS_SUCCESS)
+    {
+      LOG_WARNING("Failed to get tracking data from the broadcast channel at time " << std::fixed << *timestampIt);
+    }
+    else
+    {
+      self.SendTrackingData(trackingFrame);
+    }
+    self.LastSentTrackingDataTimestamp = *timestampIt;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkServer::SendTrackingData(PlusTrackedFrame& trackingFrame)
+{
+  PlusPerformanceScopedTimer sendTimer(this->TrackingDataSendStatistics);
+
+  if (this->TransformRepository == NULL || this->TransformRepository->SetTransforms(trackingFrame) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to set current transforms to transform repository");
+    return PLUS_FAIL;
+  }
+
+  // Clients receive the timestamp in UTC
+  double timestampUniversal = vtkPlusAccurateTimer::GetUniversalTimeFromSystemTime(trackingFrame.GetTimestamp());
+
+  std::vector<int> disconnectedClientIds;
+  {
+    // Lock before we send message to the clients
+    PlusLockGuard<vtkPlusRecursiveCriticalSection> igtlClientsMutexGuardedLock(this->IgtlClientsMutex);
+    for (std::list<ClientData>::iterator clientIterator = this->IgtlClients.begin(); clientIterator != this->IgtlClients.end(); ++clientIterator)
+    {
+      if (!vtkPlusIgtlMessageFactory::IsTrackingDataDue(clientIterator->ClientInfo, timestampUniversal))
+      {
+        continue;
+      }
+
+      std::vector<igtl::MessageBase::Pointer> igtlMessages;
+      if (this->IgtlMessageFactory->PackTrackingDataMessage(clientIterator->ClientInfo, igtlMessages, timestampUniversal, this->SendValidTransformsOnly, this->TransformRepository) != PLUS_SUCCESS)
+      {
+        LOG_WARNING("Failed to pack TDATA message for client " << clientIterator->ClientId);
+        continue;
+      }
+
+      igtl::MessageBase::Pointer igtlMessage = igtlMessages.front();
+      int retValue = 0;
+      RETRY_UNTIL_TRUE((retValue = clientIterator->ClientSocket->Send(igtlMessage->GetBufferPointer(), igtlMessage->GetBufferSize())) != 0, this->NumberOfRetryAttempts, this->DelayBetweenRetryAttemptsSec);
+      if (retValue == 0)
+      {
+        disconnectedClientIds.push_back(clientIterator->ClientId);
+        LOG_INFO("Client disconnected - could not send " << igtlMessage->GetMessageType() << " message to client (Timestamp: " << std::fixed << timestampUniversal << ").");
+        continue;
+      }
+      clientIterator->ClientInfo.LastTDATASentTimeStamp = timestampUniversal;
+    }
+  }
+
+  // Clean up disconnected clients
+  for (std::vector< int >::iterator it = disconnectedClientIds.begin(); it != disconnectedClientIds.end(); ++it)
+  {
+    DisconnectClient(*it);
+  }
+
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusOpenIGTLinkServer::DisconnectClient(int clientId)
 {
@@ -918,6 +1106,65 @@ void vtkPlusOpenIGTLinkServer::DisconnectClient(int clientId)
   LOG_INFO("Client disconnected (" <<  address << ":" << port << "). Number of connected clients: " << GetNumberOfConnectedClients());
 }
 
+//----------------------------------------------------------------------------
+std::string vtkPlusOpenIGTLinkServer::GetImageCompressorStatisticsNamePrefix(int listeningPort, int clientId, const std::string& streamName)
+{
+  // Stream names are chosen by the clients, keep only characters that cannot be confused with the name separator
+  std::string sanitizedStreamName = streamName;
+  for (std::string::iterator it = sanitizedStreamName.begin(); it != sanitizedStreamName.end(); ++it)
+  {
+    if (!isalnum(static_cast<unsigned char>(*it)) && *it != '-' && *it != '_')
+    {
+      *it = '_';
+    }
+  }
+  std::ostringstream statisticsNamePrefix;
+  statisticsNamePrefix << "IgtlServer." << listeningPort << ".Client" << clientId << "." << sanitizedStreamName << ".";
+  return statisticsNamePrefix.str();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusOpenIGTLinkServer::UpdateImageCompressors(ClientData& client)
+{
+  std::set<std::string> compressedStreamNames;
+  for (std::vector<PlusIgtlClientInfo::ImageStream>::const_iterator streamIt = client.ClientInfo.ImageStreams.begin(); streamIt != client.ClientInfo.ImageStreams.end(); ++streamIt)
+  {
+    vtkPlusIgtlImageCompressor::CompressionMethodType method = vtkPlusIgtlImageCompressor::COMPRESSION_NONE;
+    if (streamIt->Compression.empty()
+        || vtkPlusIgtlImageCompressor::GetCompressionMethodFromString(streamIt->Compression, method) != PLUS_SUCCESS
+        || method == vtkPlusIgtlImageCompressor::COMPRESSION_NONE)
+    {
+      continue;
+    }
+    compressedStreamNames.insert(streamIt->Name);
+
+    vtkSmartPointer<vtkPlusIgtlImageCompressor>& compressor = client.ImageCompressors[streamIt->Name];
+    bool newCompressor = (compressor.GetPointer() == NULL);
+    if (newCompressor)
+    {
+      // The compressor releases its histograms when it is deleted (stream is no longer compressed or client disconnected),
+      // so per-client statistics do not accumulate in the process
+      compressor = vtkSmartPointer<vtkPlusIgtlImageCompressor>::New();
+      compressor->SetStatisticsNamePrefix(GetImageCompressorStatisticsNamePrefix(this->ListeningPort, client.ClientId, streamIt->Name));
+    }
+    compressor->SetNumberOfThreads(this->ImageCompressionNumberOfThreads);
+    compressor->SetCompressionMethod(method);
+  }
+
+  // Remove compressors of streams that are no longer requested to be compressed
+  for (vtkPlusIgtlMessageFactory::ImageCompressorMapType::iterator compressorIt = client.ImageCompressors.begin(); compressorIt != client.ImageCompressors.end();)
+  {
+    if (compressedStreamNames.find(compressorIt->first) == compressedStreamNames.end())
+    {
+      client.ImageCompressors.erase(compressorIt++);
+    }
+    else
+    {
+      ++compressorIt;
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusOpenIGTLinkServer::KeepAlive()
 {
@@ -982,6 +1229,44 @@ PlusStatus vtkPlusOpenIGTLinkServer::GetClientInfo(unsigned int clientId, PlusIg
   return PLUS_FAIL;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkServer::SetClientImageStreamProcessingOptions(unsigned int clientId, const PlusIgtlClientInfo::ImageStream& imageStream)
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> igtlClientsMutexGuardedLock(this->IgtlClientsMutex);
+  for (std::list<ClientData>::iterator it = this->IgtlClients.begin(); it != this->IgtlClients.end(); ++it)
+  {
+    if (it->ClientId != clientId)
+    {
+      continue;
+    }
+    std::vector<PlusIgtlClientInfo::ImageStream>& streams = it->ClientInfo.ImageStreams;
+    for (std::vector<PlusIgtlClientInfo::ImageStream>::iterator streamIt = streams.begin(); streamIt != streams.end(); ++streamIt)
+    {
+      if (streamIt->Name != imageStream.Name)
+      {
+        continue;
+      }
+      std::copy(imageStream.ClipRectangleOrigin, imageStream.ClipRectangleOrigin + 3, streamIt->ClipRectangleOrigin);
+      std::copy(imageStream.ClipRectangleSize, imageStream.ClipRectangleSize + 3, streamIt->ClipRectangleSize);
+      streamIt->DownsamplingFactor = imageStream.DownsamplingFactor;
+      streamIt->DownsamplingMethod = imageStream.DownsamplingMethod;
+      streamIt->Grayscale = imageStream.Grayscale;
+      // The geometry of the sent image may change, so delta compression must restart with a key frame
+      vtkPlusIgtlMessageFactory::ImageCompressorMapType::iterator compressorIt = it->ImageCompressors.find(imageStream.Name);
+      if (compressorIt != it->ImageCompressors.end())
+      {
+        compressorIt->second->ResetReferenceFrame();
+      }
+      return PLUS_SUCCESS;
+    }
+    LOG_ERROR("Client " << clientId << " does not receive image stream " << imageStream.Name);
+    return PLUS_FAIL;
+  }
+
+  LOG_ERROR("Unable to set image stream processing options - client " << clientId << " is not found");
+  return PLUS_FAIL;
+}
+
 //------------------------------------------------------------------------------
 PlusStatus vtkPlusOpenIGTLinkServer::ReadConfiguration(vtkXMLDataElement* serverElement, const std::string& aFilename)
 {
@@ -1005,6 +1290,10 @@ PlusStatus vtkPlusOpenIGTLinkServer::ReadConfiguration(vtkXMLDataElement* server
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(SendValidTransformsOnly, serverElement);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(IgtlMessageCrcCheckEnabled, serverElement);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(LogWarningOnNoDataAvailable, serverElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, PerformanceStatisticsLoggingPeriodSec, serverElement);
+  PlusPerformanceStatistics::GetInstance()->SetLoggingPeriodSec(this->PerformanceStatisticsLoggingPeriodSec);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, ImageCompressionNumberOfThreads, serverElement);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(SendTrackingDataAtNativeRate, serverElement);
 
   this->DefaultClientInfo.IgtlMessageTypes.clear();
   this->DefaultClientInfo.TransformNames.clear();
@@ -31,6 +31,7 @@
 #include <igtlMessageBase.h>
 #include <igtlServerSocket.h>
 
+class PlusPerformanceHistogram;
 class PlusTrackedFrame;
 class vtkPlusDataCollector;
 class vtkPlusOpenIGTLinkServer;
@@ -68,6 +69,9 @@ struct ClientData
   PlusIgtlClientInfo ClientInfo;
 
   vtkPlusOpenIGTLinkServer* Server;
+
+  /// Compressors of the image streams that the client requested compressed images for
+  vtkPlusIgtlMessageFactory::ImageCompressorMapType ImageCompressors;
 };
 
 /*!
@@ -142,6 +146,13 @@ public:
     */
   virtual PlusStatus GetClientInfo(unsigned int clientId, PlusIgtlClientInfo& outClientInfo) const;
 
+  /*!
+    Update the processing options (clip rectangle, downsampling, grayscale conversion) of an image stream of a client.
+    The stream is identified by the name of imageStream. Other stream properties (embedded transform, compression) are not changed.
+    Locks access to the client info for the duration of the function
+  */
+  virtual PlusStatus SetClientImageStreamProcessingOptions(unsigned int clientId, const PlusIgtlClientInfo::ImageStream& imageStream);
+
   /*! Start server */
   PlusStatus StartOpenIGTLinkService();
 
@@ -174,6 +185,13 @@ protected:
   /*! Attempt to send any unsent frames to clients, if unsuccessful, accumulate an elapsed time */
   static PlusStatus SendLatestFramesToClients(vtkPlusOpenIGTLinkServer& self, double& elapsedTimeSinceLastPacketSentSec);
 
+  /*!
+    Send TDATA messages to the clients that requested tracking data (STT_TDATA), at the native rate of the tracker.
+    New samples are detected in the buffer of the first tool of the broadcast channel, all tools are
+    coalesced into one TDATA message per sample. The sending rate of each client is limited by its requested resolution.
+  */
+  static PlusStatus SendLatestTrackingDataToClients(vtkPlusOpenIGTLinkServer& self);
+
   /*! Process the message replies queue and send messages */
   static PlusStatus SendMessageResponses(vtkPlusOpenIGTLinkServer& self);
 
@@ -186,6 +204,9 @@ protected:
   /*! Tracked frame interface, sends the selected message type and data to all clients */
   virtual PlusStatus SendTrackedFrame(PlusTrackedFrame& trackedFrame);
 
+  /*! Send a TDATA message of the tracking-only frame to all clients that requested tracking data and are due to receive it */
+  virtual PlusStatus SendTrackingData(PlusTrackedFrame& trackingFrame);
+
   /*! Converts a command response to an OpenIGTLink message that can be sent to the client */
   igtl::MessageBase::Pointer CreateIgtlMessageFromCommandResponse(vtkPlusCommandResponse* response);
 
@@ -195,6 +216,12 @@ protected:
   /*! Stops client's data receiving thread, closes the socket, and removes the client from the client list */
   void DisconnectClient(int clientId);
 
+  /*! Create or update the image compressors of the client to match the compression requested in the client info */
+  void UpdateImageCompressors(ClientData& client);
+
+  /*! Get the prefix of the names of the performance statistics of an image stream of a client: IgtlServer.[port].Client[id].[stream]. */
+  static std::string GetImageCompressorStatisticsNamePrefix(int listeningPort, int clientId, const std::string& streamName);
+
   /*! Set IGTL CRC check flag (0: disabled, 1: enabled) */
   vtkSetMacro(IgtlMessageCrcCheckEnabled, bool);
   /*! Get IGTL CRC check flag (0: disabled, 1: enabled) */
@@ -215,6 +242,21 @@ protected:
   vtkSetMacro(KeepAliveIntervalSec, double);
   vtkGetMacroConst(KeepAliveIntervalSec, double);
 
+  /*! Period of logging the performance statistics summary. If not positive then statistics are not logged periodically. */
+  vtkSetMacro(PerformanceStatisticsLoggingPeriodSec, double);
+  vtkGetMacroConst(PerformanceStatisticsLoggingPeriodSec, double);
+
+  /*! Maximum number of threads used for compressing an image. 0 means the number of processors. */
+  vtkSetMacro(ImageCompressionNumberOfThreads, int);
+  vtkGetMacroConst(ImageCompressionNumberOfThreads, int);
+
+  /*!
+    If enabled (default) then TDATA messages are sent at the native rate of the tracker, independently from the video frames.
+    If disabled then TDATA messages are sent with the tracked frames (at most one per frame).
+  */
+  vtkSetMacro(SendTrackingDataAtNativeRate, bool);
+  vtkGetMacroConst(SendTrackingDataAtNativeRate, bool);
+
   vtkSetStdStringMacro(OutputChannelId);
   vtkSetStdStringMacro(ConfigFilename);
 
@@ -265,12 +307,30 @@ private:
   /*! igtl Factory for message sending */
   vtkSmartPointer<vtkPlusIgtlMessageFactory> IgtlMessageFactory;
 
+  /*! Crops and downsamples images for clients, each distinct option set is processed only once per frame */
+  vtkSmartPointer<vtkPlusIgtlImageProcessor> ImageProcessor;
+
   /*! Mutex instance for accessing client data list */
   vtkSmartPointer<vtkPlusRecursiveCriticalSection> IgtlClientsMutex;
 
   /*! Last sent tracked frame timestamp */
   double LastSentTrackedFrameTimestamp;
 
+  /*! Timestamp of the last tracking sample that was processed by the tracking-only send path */
+  double LastSentTrackingDataTimestamp;
+
+  bool SendTrackingDataAtNativeRate;
+
+  /*! Time spent with sending one tracking sample to all clients (IgtlServer.[port].TrackingDataSendMs) */
+  PlusPerformanceHistogram* TrackingDataSendStatistics;
+
+  /*!
+    Time spent with packing and sending the messages of one tracked frame to one client (IgtlServer.[port].PackMs, IgtlServer.[port].SendMs).
+    Samples of all clients are recorded in the same histograms, as histograms are never deleted and clients come and go.
+  */
+  PlusPerformanceHistogram* PackStatistics;
+  PlusPerformanceHistogram* SendStatistics;
+
   /*! Maximum time spent with processing (getting tracked frames, sending messages) per second (in milliseconds) */
   int MaxTimeSpentWithProcessingMs;
 
@@ -311,6 +371,10 @@ private:
 
   double KeepAliveIntervalSec;
 
+  double PerformanceStatisticsLoggingPeriodSec;
+
+  int ImageCompressionNumberOfThreads;
+
   std::string ConfigFilename;
 
   vtkPlusLogger::LogLevelType GracePeriodLogLevel;
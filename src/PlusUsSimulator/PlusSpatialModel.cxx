@@ -8,6 +8,7 @@ See License.txt for details.
 
 #include "PlusSpatialModel.h"
 
+#include "vtkGenericCell.h"
 #include "vtkMath.h"
 #include "vtkMatrix4x4.h"
 #include "vtkModifiedBSPTree.h"
@@ -18,6 +19,7 @@ See License.txt for details.
 #include "vtkProbeFilter.h"
 #include "vtkPointData.h"
 #include "vtkIdList.h"
+#include "vtkPoints.h"
 #include "vtkTriangle.h"
 
 // If fraction of the transmitted beam intensity is smaller then this value then we consider the beam to be completely absorbed
@@ -26,6 +28,15 @@ const double MINIMUM_BEAM_INTENSITY = 1e-9;
 // Characterizes the specular reflection BRDF. If the value is smaller then reflection is limited to a smaller angle range (closer to 90deg incidence angle).
 double SPECULAR_REFLECTION_BRDF_STDEV = 30.0;
 
+//-----------------------------------------------------------------------------
+PlusSpatialModel::LineIntersectionWorkspace::LineIntersectionWorkspace(int threadIndex)
+  : ThreadIndex(threadIndex)
+  , IntersectionPoints_Model(vtkSmartPointer<vtkPoints>::New())
+  , IntersectionCellIds(vtkSmartPointer<vtkIdList>::New())
+  , Cell(vtkSmartPointer<vtkGenericCell>::New())
+{
+}
+
 //-----------------------------------------------------------------------------
 PlusSpatialModel::PlusSpatialModel()
   : Name("")
@@ -45,6 +56,8 @@ PlusSpatialModel::PlusSpatialModel()
   , SurfaceDiffuseReflectionCoefficient(0.1)
   , ModelLocalizer(vtkModifiedBSPTree::New())
   , PolyData(NULL)
+  , ReferenceToModelTransform(vtkSmartPointer<vtkMatrix4x4>::New())
+  , ModelToReferenceTransform(vtkSmartPointer<vtkMatrix4x4>::New())
 {
 }
 
@@ -75,10 +88,16 @@ PlusSpatialModel::PlusSpatialModel(const PlusSpatialModel& model)
   this->ReferenceToObjectTransform = NULL;
   this->ModelLocalizer = NULL;
   this->PolyData = NULL;
+  this->ReferenceToModelTransform = vtkSmartPointer<vtkMatrix4x4>::New();
+  this->ModelToReferenceTransform = vtkSmartPointer<vtkMatrix4x4>::New();
   SetModelToObjectTransform(model.ModelToObjectTransform);
   SetReferenceToObjectTransform(model.ReferenceToObjectTransform);
   SetModelLocalizer(model.ModelLocalizer);
   SetPolyData(model.PolyData);
+  this->ThreadModelLocalizers = model.ThreadModelLocalizers;
+  // cached transforms are copied by value, as they are updated independently in each model
+  this->ReferenceToModelTransform->DeepCopy(model.ReferenceToModelTransform);
+  this->ModelToReferenceTransform->DeepCopy(model.ModelToReferenceTransform);
   this->ModelFileNeedsUpdate = model.ModelFileNeedsUpdate;
   this->PrecomputedAttenuations = model.PrecomputedAttenuations;
   this->TransducerSpatialModelMaxOverlapMm = model.TransducerSpatialModelMaxOverlapMm;
@@ -102,6 +121,10 @@ void PlusSpatialModel::operator=(const PlusSpatialModel& model)
   SetReferenceToObjectTransform(model.ReferenceToObjectTransform);
   SetModelLocalizer(model.ModelLocalizer);
   SetPolyData(model.PolyData);
+  this->ThreadModelLocalizers = model.ThreadModelLocalizers;
+  // cached transforms are copied by value, as they are updated independently in each model
+  this->ReferenceToModelTransform->DeepCopy(model.ReferenceToModelTransform);
+  this->ModelToReferenceTransform->DeepCopy(model.ModelToReferenceTransform);
   this->ModelFileNeedsUpdate = model.ModelFileNeedsUpdate;
   this->PrecomputedAttenuations = model.PrecomputedAttenuations;
   this->TransducerSpatialModelMaxOverlapMm = model.TransducerSpatialModelMaxOverlapMm;
@@ -253,13 +276,9 @@ void PlusSpatialModel::CalculateIntensity(std::vector<double>& reflectedIntensit
   }
 
   // Compute attenuation within this model
-  double intensityAttenuationCoefficientdBPerPixel = this->AttenuationCoefficientDbPerCmMhz * (distanceBetweenScanlineSamplePointsMm / 10.0) * this->ImagingFrequencyMhz;
-  // intensityAttenuationCoefficientPerPixel: should be close to 1, as it's the ratio of (transmitted beam intensity / incident beam intensity) after traversing through a single pixel
-  double intensityAttenuationCoefficientPerPixel = pow(10.0, -intensityAttenuationCoefficientdBPerPixel / 10.0);
-  // intensityAttenuatedFractionPerPixel: how big fraction of the intensity is attenuated during traversing through one voxel
-  double intensityAttenuatedFractionPerPixel = (1 - intensityAttenuationCoefficientPerPixel);
-  // intensityTransmittedFractionPerPixelTwoWay: how big fraction of the intensity is transmitted during traversing through one voxel; takes into account both propagation directions
-  double intensityTransmittedFractionPerPixelTwoWay = intensityAttenuationCoefficientPerPixel * intensityAttenuationCoefficientPerPixel;
+  double intensityAttenuatedFractionPerPixel = 0;
+  double intensityTransmittedFractionPerPixelTwoWay = 0;
+  GetAttenuationPerPixel(distanceBetweenScanlineSamplePointsMm, intensityAttenuatedFractionPerPixel, intensityTransmittedFractionPerPixelTwoWay);
 
   transmittedIntensity = surfaceTransmittedBeamIntensity * intensityTransmittedFractionPerPixelTwoWay;
 
@@ -313,11 +332,72 @@ void PlusSpatialModel::CalculateIntensity(std::vector<double>& reflectedIntensit
   // TODO: to simulate beamwidth, take into account the incidence angle and disperse the reflection on a larger area if the angle is large
 }
 
+//-----------------------------------------------------------------------------
+void PlusSpatialModel::GetAttenuationPerPixel(double distanceBetweenScanlineSamplePointsMm, double& intensityAttenuatedFractionPerPixel, double& intensityTransmittedFractionPerPixelTwoWay)
+{
+  double intensityAttenuationCoefficientdBPerPixel = this->AttenuationCoefficientDbPerCmMhz * (distanceBetweenScanlineSamplePointsMm / 10.0) * this->ImagingFrequencyMhz;
+  // intensityAttenuationCoefficientPerPixel: should be close to 1, as it's the ratio of (transmitted beam intensity / incident beam intensity) after traversing through a single pixel
+  double intensityAttenuationCoefficientPerPixel = pow(10.0, -intensityAttenuationCoefficientdBPerPixel / 10.0);
+  // intensityAttenuatedFractionPerPixel: how big fraction of the intensity is attenuated during traversing through one voxel
+  intensityAttenuatedFractionPerPixel = (1 - intensityAttenuationCoefficientPerPixel);
+  // intensityTransmittedFractionPerPixelTwoWay: how big fraction of the intensity is transmitted during traversing through one voxel; takes into account both propagation directions
+  intensityTransmittedFractionPerPixelTwoWay = intensityAttenuationCoefficientPerPixel * intensityAttenuationCoefficientPerPixel;
+}
+
+//-----------------------------------------------------------------------------
+void PlusSpatialModel::UpdateReferenceToModelTransforms()
+{
+  vtkSmartPointer<vtkMatrix4x4> objectToModelMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkMatrix4x4::Invert(this->ModelToObjectTransform, objectToModelMatrix);
+  vtkMatrix4x4::Multiply4x4(objectToModelMatrix, this->ReferenceToObjectTransform, this->ReferenceToModelTransform);
+  vtkMatrix4x4::Invert(this->ReferenceToModelTransform, this->ModelToReferenceTransform);
+}
+
+//-----------------------------------------------------------------------------
+void PlusSpatialModel::PrepareLineIntersections(int numberOfThreads, double distanceBetweenScanlineSamplePointsMm, unsigned int numberOfSamplesPerScanline)
+{
+  UpdateModelFile();
+  UpdateReferenceToModelTransforms();
+
+  if (!this->ModelFile.empty() && this->PolyData != NULL)
+  {
+    // vtkModifiedBSPTree::IntersectWithLine uses an internal cell object, therefore each thread needs its own localizer
+    while (static_cast<int>(this->ThreadModelLocalizers.size()) < numberOfThreads - 1)
+    {
+      vtkSmartPointer<vtkModifiedBSPTree> threadModelLocalizer = vtkSmartPointer<vtkModifiedBSPTree>::New();
+      threadModelLocalizer->SetDataSet(this->PolyData);
+      threadModelLocalizer->SetMaxLevel(this->ModelLocalizer->GetMaxLevel());
+      threadModelLocalizer->SetNumberOfCellsPerNode(this->ModelLocalizer->GetNumberOfCellsPerNode());
+      threadModelLocalizer->BuildLocator();
+      this->ThreadModelLocalizers.push_back(threadModelLocalizer);
+    }
+  }
+
+  // Fill the attenuation table now, so that CalculateIntensity does not need to modify it while the scanlines are processed
+  if (numberOfSamplesPerScanline > 0)
+  {
+    double intensityAttenuatedFractionPerPixel = 0;
+    double intensityTransmittedFractionPerPixelTwoWay = 0;
+    GetAttenuationPerPixel(distanceBetweenScanlineSamplePointsMm, intensityAttenuatedFractionPerPixel, intensityTransmittedFractionPerPixelTwoWay);
+    if (this->PrecomputedAttenuations.size() < numberOfSamplesPerScanline || intensityTransmittedFractionPerPixelTwoWay != this->PrecomputedAttenuations[0])
+    {
+      UpdatePrecomputedAttenuations(intensityTransmittedFractionPerPixelTwoWay, numberOfSamplesPerScanline);
+    }
+  }
+}
+
 //-----------------------------------------------------------------------------
 void PlusSpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& lineIntersections, double* scanLineStartPoint_Reference, double* scanLineEndPoint_Reference)
 {
   UpdateModelFile();
+  UpdateReferenceToModelTransforms();
+  LineIntersectionWorkspace workspace;
+  GetLineIntersections(lineIntersections, scanLineStartPoint_Reference, scanLineEndPoint_Reference, workspace);
+}
 
+//-----------------------------------------------------------------------------
+void PlusSpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& lineIntersections, double* scanLineStartPoint_Reference, double* scanLineEndPoint_Reference, LineIntersectionWorkspace& workspace)
+{
   if (this->ModelFile.empty())
   {
     // no model is defined, which means that the model is everywhere
@@ -345,19 +425,22 @@ void PlusSpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& li
     searchLineStartPoint_Reference[i] = scanLineStartPoint_Reference[i] - this->TransducerSpatialModelMaxOverlapMm * scanLineDirectionVector_Reference[i] / scanLineDirectionVectorNorm_Reference;
   }
 
-  vtkSmartPointer<vtkMatrix4x4> objectToModelMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-  vtkMatrix4x4::Invert(this->ModelToObjectTransform, objectToModelMatrix);
-  vtkSmartPointer<vtkMatrix4x4> referenceToModelMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-  vtkMatrix4x4::Multiply4x4(objectToModelMatrix, this->ReferenceToObjectTransform, referenceToModelMatrix);
+  vtkMatrix4x4* referenceToModelMatrix = this->ReferenceToModelTransform;
+  vtkMatrix4x4* modelToReferenceMatrix = this->ModelToReferenceTransform;
 
   double searchLineStartPoint_Model[4] = {0, 0, 0, 1};
   double scanLineEndPoint_Model[4] = {0, 0, 0, 1};
   referenceToModelMatrix->MultiplyPoint(searchLineStartPoint_Reference, searchLineStartPoint_Model);
   referenceToModelMatrix->MultiplyPoint(scanLineEndPoint_Reference, scanLineEndPoint_Model);
 
-  vtkSmartPointer<vtkPoints> intersectionPoints_Model = vtkSmartPointer<vtkPoints>::New();
-  vtkSmartPointer<vtkIdList> intersectionCellIds = vtkSmartPointer<vtkIdList>::New();
-  this->ModelLocalizer->IntersectWithLine(searchLineStartPoint_Model, scanLineEndPoint_Model, 0.0, intersectionPoints_Model, intersectionCellIds);
+  vtkPoints* intersectionPoints_Model = workspace.IntersectionPoints_Model;
+  vtkIdList* intersectionCellIds = workspace.IntersectionCellIds;
+  vtkModifiedBSPTree* modelLocalizer = this->ModelLocalizer;
+  if (workspace.ThreadIndex > 0 && workspace.ThreadIndex <= static_cast<int>(this->ThreadModelLocalizers.size()))
+  {
+    modelLocalizer = this->ThreadModelLocalizers[workspace.ThreadIndex - 1];
+  }
+  modelLocalizer->IntersectWithLine(searchLineStartPoint_Model, scanLineEndPoint_Model, 0.0, intersectionPoints_Model, intersectionCellIds);
 
   if (intersectionPoints_Model->GetNumberOfPoints() < 1)
   {
@@ -365,9 +448,6 @@ void PlusSpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& li
     return;
   }
 
-  vtkSmartPointer<vtkMatrix4x4> modelToReferenceMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-  vtkMatrix4x4::Invert(referenceToModelMatrix, modelToReferenceMatrix);
-
   // Measure the distance from the starting point in the reference coordinate system
   double intersectionPoint_Model[4] = {0, 0, 0, 1};
   double intersectionPoint_Reference[4] = {0, 0, 0, 1};
@@ -416,8 +496,10 @@ void PlusSpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& li
     intersectionPoints_Model->GetPoint(intersectionPointIndex, intersectionPoint_Model);
     modelToReferenceMatrix->MultiplyPoint(intersectionPoint_Model, intersectionPoint_Reference);
     intersectionInfo.IntersectionDistanceFromStartPointMm = sqrt(vtkMath::Distance2BetweenPoints(scanLineStartPoint_Reference, intersectionPoint_Reference));
-    vtkTriangle* cell = vtkTriangle::SafeDownCast(this->PolyData->GetCell(intersectionCellIds->GetId(intersectionPointIndex)));
-    if (cell != NULL && normals_Model != NULL)
+    // The cell is retrieved into the workspace, as vtkPolyData::GetCell(cellId) would use a cell object that is shared between threads
+    vtkGenericCell* cell = workspace.Cell;
+    this->PolyData->GetCell(intersectionCellIds->GetId(intersectionPointIndex), cell);
+    if (cell->GetCellType() == VTK_TRIANGLE && normals_Model != NULL)
     {
       const int NUMBER_OF_POINTS_PER_CELL = 3; // triangle cell
       double pcoords[NUMBER_OF_POINTS_PER_CELL] = {0, 0, 0};
@@ -429,12 +511,8 @@ void PlusSpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& li
       double interpolatedNormal_Model[3] = {0, 0, 0};
       for (int pointIndex = 0; pointIndex < NUMBER_OF_POINTS_PER_CELL; pointIndex++)
       {
-        double* normalAtCellCorner = normals_Model->GetTuple3(cell->GetPointId(pointIndex));
-        if (normalAtCellCorner == NULL)
-        {
-          LOG_ERROR("SpatialModel::GetLineIntersections error: invalid normal");
-          continue;
-        }
+        double normalAtCellCorner[3] = {0, 0, 0};
+        normals_Model->GetTuple(cell->GetPointId(pointIndex), normalAtCellCorner);
         interpolatedNormal_Model[0] += normalAtCellCorner[0] * weights[pointIndex];
         interpolatedNormal_Model[1] += normalAtCellCorner[1] * weights[pointIndex];
         interpolatedNormal_Model[2] += normalAtCellCorner[2] * weights[pointIndex];
@@ -461,6 +539,9 @@ PlusStatus PlusSpatialModel::UpdateModelFile()
 
   this->ModelFileNeedsUpdate = false;
 
+  // thread localizers refer to the previous model
+  this->ThreadModelLocalizers.clear();
+
   if (this->PolyData != NULL)
   {
     this->PolyData->Delete();
@@ -8,11 +8,17 @@
 
 #include <deque>
 #include <string>
+#include <vector>
 
 #include "vtkPlusUsSimulatorExport.h"
 
+#include "vtkSmartPointer.h"
+
+class vtkGenericCell;
+class vtkIdList;
 class vtkMatrix4x4;
 class vtkModifiedBSPTree;
+class vtkPoints;
 class vtkPolyData;
 
 /*!
@@ -38,6 +44,21 @@ public:
     double IntersectionIncidenceAngleRad;
   };
 
+  /*!
+    Temporary objects used for computing line intersections.
+    Each thread that computes line intersections concurrently must use its own workspace,
+    because the model localizer and the mesh cell access are not reentrant.
+  */
+  struct vtkPlusUsSimulatorExport LineIntersectionWorkspace
+  {
+    LineIntersectionWorkspace(int threadIndex = 0);
+    /*! Index of the localizer that is used by this workspace (see PrepareLineIntersections) */
+    int ThreadIndex;
+    vtkSmartPointer<vtkPoints> IntersectionPoints_Model;
+    vtkSmartPointer<vtkIdList> IntersectionCellIds;
+    vtkSmartPointer<vtkGenericCell> Cell;
+  };
+
   PlusSpatialModel();
   virtual ~PlusSpatialModel();
 
@@ -72,6 +93,22 @@ public:
   */
   void GetLineIntersections(std::deque<LineIntersectionInfo>& lineIntersections, double* scanLineStartPoint_Reference, double* scanLineEndPoint_Reference);
 
+  /*!
+    Same as GetLineIntersections, but all temporary objects are taken from the workspace and the
+    reference to model transforms that were computed in PrepareLineIntersections are used.
+    Can be called from multiple threads simultaneously if each thread uses a different workspace
+    and PrepareLineIntersections was called for the current frame.
+  */
+  void GetLineIntersections(std::deque<LineIntersectionInfo>& lineIntersections, double* scanLineStartPoint_Reference, double* scanLineEndPoint_Reference, LineIntersectionWorkspace& workspace);
+
+  /*!
+    Prepare the model for computing the intersections and intensities of a frame from multiple threads.
+    Loads the model file if needed, computes the reference to model transforms once for the frame,
+    creates a localizer for each thread, and precomputes the attenuation table for the longest scanline.
+    Must be called from a single thread, after the ReferenceToObjectTransform and the imaging frequency are set.
+  */
+  void PrepareLineIntersections(int numberOfThreads, double distanceBetweenScanlineSamplePointsMm, unsigned int numberOfSamplesPerScanline);
+
   double GetAcousticImpedanceMegarayls();
 
   /*!
@@ -100,6 +137,10 @@ protected:
 
   PlusStatus UpdateModelFile();
   void UpdatePrecomputedAttenuations(double intensityTransmittedFractionPerPixelTwoWay, int numberOfElements);
+  void UpdateReferenceToModelTransforms();
+
+  /*! Compute the attenuation coefficients of the model material for the given sampling distance */
+  void GetAttenuationPerPixel(double distanceBetweenScanlineSamplePointsMm, double& intensityAttenuatedFractionPerPixel, double& intensityTransmittedFractionPerPixelTwoWay);
 
 protected:
   //PlusStatus LoadModel(const std::string& absoluteImagePath);
@@ -186,6 +227,18 @@ protected:
 
   vtkModifiedBSPTree* ModelLocalizer;
 
+  /*!
+    Additional localizers for concurrent line intersection computation (localizer of thread i is ThreadModelLocalizers[i-1],
+    thread 0 uses ModelLocalizer). All of them are built on the same PolyData.
+  */
+  std::vector< vtkSmartPointer<vtkModifiedBSPTree> > ThreadModelLocalizers;
+
+  /*! Cached transform from the reference to the model coordinate system, updated by PrepareLineIntersections */
+  vtkSmartPointer<vtkMatrix4x4> ReferenceToModelTransform;
+
+  /*! Cached transform from the model to the reference coordinate system, updated by PrepareLineIntersections */
+  vtkSmartPointer<vtkMatrix4x4> ModelToReferenceTransform;
+
   /*! Surface mesh. Points are stored in the Model coordinate system (as in the input file) */
   vtkPolyData* PolyData;
 
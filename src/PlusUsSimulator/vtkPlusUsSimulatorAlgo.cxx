@@ -32,7 +32,6 @@ See License.txt for details.
 #include "vtkPlusUsScanConvert.h"
 
 // For noise generation
-#include "vtkLineSource.h"
 #include "vtkPerlinNoise.h"
 #include "vtkProbeFilter.h"
 #include "vtkSampleFunction.h"
@@ -41,6 +40,19 @@ See License.txt for details.
 
 vtkStandardNewMacro( vtkPlusUsSimulatorAlgo );
 
+//-----------------------------------------------------------------------------
+struct SimulateScanLinesThreadFunctionInfoStruct
+{
+  vtkPlusUsSimulatorAlgo* Algo;
+  /*! Pixel buffer of the scanlines image (one scanline per row) */
+  unsigned char* ScanLinesPixelBuffer;
+  /*! Start and end point of each scanline in the reference coordinate system (homogeneous coordinates, start point in elements 0-3, end point in elements 4-7) */
+  std::vector<double> ScanLineEndPoints_Reference;
+  double DistanceBetweenScanlineSamplePointsMm;
+  vtkPerlinNoise* NoiseFunction;
+  std::vector<PlusStatus> ThreadStatus;
+};
+
 //-----------------------------------------------------------------------------
 vtkPlusUsSimulatorAlgo::vtkPlusUsSimulatorAlgo()
   : TransformRepository( NULL )
@@ -69,6 +81,9 @@ vtkPlusUsSimulatorAlgo::vtkPlusUsSimulatorAlgo()
   this->NoisePhase[1] = 0;
   this->NoisePhase[2] = 0;
 
+  this->Threader = vtkMultiThreader::New();
+  this->NumberOfThreads = 0;
+
   // this->TransducerSpatialModel doesn't have to be initialized, as the default parameters of SpatialModel
   // are for soft tissue that should match the transducer material in acoustic impedance
 }
@@ -83,6 +98,11 @@ vtkPlusUsSimulatorAlgo::~vtkPlusUsSimulatorAlgo()
     this->RfProcessor->Delete();
     this->RfProcessor = NULL;
   }
+  if ( this->Threader != NULL )
+  {
+    this->Threader->Delete();
+    this->Threader = NULL;
+  }
   this->SetTransformRepository( NULL );
 }
 
@@ -134,9 +154,6 @@ int vtkPlusUsSimulatorAlgo::RequestData( vtkInformation* request, vtkInformation
   scanLines->SetExtent( 0, this->NumberOfSamplesPerScanline - 1, 0, this->NumberOfScanlines - 1, 0, 0 );
   scanLines->AllocateScalars( VTK_UNSIGNED_CHAR, 1 );
 
-  // Create BSPTree for fast scanline-model intersection computation
-  vtkSmartPointer<vtkPoints> scanLineIntersectionWithModel = vtkSmartPointer<vtkPoints>::New();
-
   vtkPlusUsScanConvert* scanConverter = this->RfProcessor->GetScanConverter();
   if ( scanConverter == NULL )
   {
@@ -153,12 +170,9 @@ int vtkPlusUsSimulatorAlgo::RequestData( vtkInformation* request, vtkInformation
   double distanceBetweenScanlineSamplePointsMm = scanConverter->GetDistanceBetweenScanlineSamplePointsMm();
 
   // Initialize noise generator
-  vtkSmartPointer<vtkLineSource> noiseSamplerLine_Reference = vtkSmartPointer<vtkLineSource>::New();
   vtkSmartPointer<vtkPerlinNoise> noiseFunction = vtkSmartPointer<vtkPerlinNoise>::New();
-  double samplePointPosition_Reference[3] = {0, 0, 0};
   if ( this->NoiseAmplitude > 0 )
   {
-    noiseSamplerLine_Reference->SetResolution( this->NumberOfSamplesPerScanline - 1 );
     noiseFunction->SetAmplitude( this->NoiseAmplitude );
     noiseFunction->SetFrequency( this->NoiseFrequency );
     noiseFunction->SetPhase( this->NoisePhase );
@@ -183,19 +197,14 @@ int vtkPlusUsSimulatorAlgo::RequestData( vtkInformation* request, vtkInformation
 
     return 0;
   }
-  vtkSmartPointer<vtkMatrix4x4> referenceToImageMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-  vtkMatrix4x4::Invert( imageToReferenceMatrix, referenceToImageMatrix );
 
-  // Create a few variables outside the loop to avoid reallocations and to make the code easier to read
-  vtkPoints* samplePointPositions_Reference = 0;
-  // Create a buffer outside the for loop to allow reusing it
-  std::vector<double> intensities;
-  // scanline start/end positions in Image and Reference coordinate systems
-  double scanLineStartPoint_Image[4] = {0, 0, 0, 1};
-  double scanLineEndPoint_Image[4] = {0, 0, 0, 1};
-  double scanLineStartPoint_Reference[4] = {0, 0, 0, 1};
-  double scanLineEndPoint_Reference[4] = {0, 0, 0, 1};
+  if ( this->NumberOfThreads > 0 )
+  {
+    this->Threader->SetNumberOfThreads( this->NumberOfThreads );
+  }
+  int numberOfThreads = this->Threader->GetNumberOfThreads();
 
+  // Compute the model transforms once per frame (instead of once per scanline) and prepare the models for concurrent access
   for ( std::vector<PlusSpatialModel>::iterator spatialModelIt = this->SpatialModels.begin(); spatialModelIt != this->SpatialModels.end(); ++spatialModelIt )
   {
     vtkSmartPointer<vtkMatrix4x4> referenceToObjectMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
@@ -210,44 +219,96 @@ int vtkPlusUsSimulatorAlgo::RequestData( vtkInformation* request, vtkInformation
       }
     }
     spatialModelIt->SetReferenceToObjectTransform( referenceToObjectMatrix );
+    spatialModelIt->PrepareLineIntersections( numberOfThreads, distanceBetweenScanlineSamplePointsMm, this->NumberOfSamplesPerScanline );
   }
 
+  SimulateScanLinesThreadFunctionInfoStruct str;
+  str.Algo = this;
+  str.ScanLinesPixelBuffer = static_cast<unsigned char*>( scanLines->GetScalarPointer() );
+  str.DistanceBetweenScanlineSamplePointsMm = distanceBetweenScanlineSamplePointsMm;
+  str.NoiseFunction = noiseFunction;
+  str.ThreadStatus.resize( numberOfThreads, PLUS_SUCCESS );
+
+  // Scanline start/end positions are computed in advance, as the scan converter is not meant to be used from multiple threads
+  str.ScanLineEndPoints_Reference.resize( this->NumberOfScanlines * 8 );
+  double scanLineStartPoint_Image[4] = {0, 0, 0, 1};
+  double scanLineEndPoint_Image[4] = {0, 0, 0, 1};
   for( int scanLineIndex = 0; scanLineIndex < this->NumberOfScanlines; scanLineIndex++ )
   {
     scanConverter->GetScanLineEndPoints( scanLineIndex, scanLineStartPoint_Image, scanLineEndPoint_Image );
-    imageToReferenceMatrix->MultiplyPoint( scanLineStartPoint_Image, scanLineStartPoint_Reference );
-    imageToReferenceMatrix->MultiplyPoint( scanLineEndPoint_Image, scanLineEndPoint_Reference );
+    imageToReferenceMatrix->MultiplyPoint( scanLineStartPoint_Image, &str.ScanLineEndPoints_Reference[scanLineIndex * 8] );
+    imageToReferenceMatrix->MultiplyPoint( scanLineEndPoint_Image, &str.ScanLineEndPoints_Reference[scanLineIndex * 8 + 4] );
+  }
+
+  this->Threader->SetSingleMethod( SimulateScanLinesThreadFunction, &str );
+  this->Threader->SingleMethodExecute();
 
-    if ( this->NoiseAmplitude > 0 )
+  for ( int threadIndex = 0; threadIndex < numberOfThreads; threadIndex++ )
+  {
+    if ( str.ThreadStatus[threadIndex] != PLUS_SUCCESS )
     {
-      noiseSamplerLine_Reference->SetPoint1( scanLineStartPoint_Reference );
-      noiseSamplerLine_Reference->SetPoint2( scanLineEndPoint_Reference );
-      noiseSamplerLine_Reference->Update();
-      samplePointPositions_Reference = noiseSamplerLine_Reference->GetOutput()->GetPoints();
+      return 0;
     }
+  }
+
+  vtkImageData* simulatedUsImage = vtkImageData::SafeDownCast( outInfo->Get( vtkDataObject::DATA_OBJECT() ) );
+  if ( simulatedUsImage == NULL )
+  {
+    LOG_ERROR( "vtkPlusUsSimulatorAlgo output type is invalid" );
+    return 0;
+  }
+  this->RfProcessor->SetRfFrame( scanLines, US_IMG_BRIGHTNESS );
+  simulatedUsImage->DeepCopy( this->RfProcessor->GetBrightnessScanConvertedImage() );
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkPlusUsSimulatorAlgo::SimulateScanLinesThreadFunction( void* arg )
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>( arg );
+  SimulateScanLinesThreadFunctionInfoStruct* str = static_cast<SimulateScanLinesThreadFunctionInfoStruct*>( threadInfo->UserData );
+  vtkPlusUsSimulatorAlgo* self = str->Algo;
+  int threadId = threadInfo->ThreadID;
+  int threadCount = threadInfo->NumberOfThreads;
+
+  // Create a few variables outside the loop to avoid reallocations and to make the code easier to read.
+  // All of them are owned by this thread.
+  PlusSpatialModel::LineIntersectionWorkspace intersectionWorkspace( threadId );
+  std::deque<PlusSpatialModel::LineIntersectionInfo> lineIntersectionsWithModels;
+  std::vector<double> intensities;
+  double samplePointPosition_Reference[3] = {0, 0, 0};
+  const double distanceBetweenScanlineSamplePointsMm = str->DistanceBetweenScanlineSamplePointsMm;
+  const int numberOfSamplesPerScanline = self->NumberOfSamplesPerScanline;
+
+  // Scanlines are interleaved between the threads, because models typically cover a contiguous range of scanlines
+  // and so contiguous blocks of scanlines would distribute the work unevenly
+  for( int scanLineIndex = threadId; scanLineIndex < self->NumberOfScanlines; scanLineIndex += threadCount )
+  {
+    double* scanLineStartPoint_Reference = &str->ScanLineEndPoints_Reference[scanLineIndex * 8];
+    double* scanLineEndPoint_Reference = &str->ScanLineEndPoints_Reference[scanLineIndex * 8 + 4];
 
     // Get model intersection positions along the scanline for all the models
-    std::deque<PlusSpatialModel::LineIntersectionInfo> lineIntersectionsWithModels;
-    for ( std::vector<PlusSpatialModel>::iterator spatialModelIt = this->SpatialModels.begin(); spatialModelIt != this->SpatialModels.end(); ++spatialModelIt )
+    lineIntersectionsWithModels.clear();
+    for ( std::vector<PlusSpatialModel>::iterator spatialModelIt = self->SpatialModels.begin(); spatialModelIt != self->SpatialModels.end(); ++spatialModelIt )
     {
       // Append line intersections found with this model to lineIntersectionsWithModels
-      spatialModelIt->GetLineIntersections( lineIntersectionsWithModels, scanLineStartPoint_Reference, scanLineEndPoint_Reference );
+      spatialModelIt->GetLineIntersections( lineIntersectionsWithModels, scanLineStartPoint_Reference, scanLineEndPoint_Reference, intersectionWorkspace );
     }
 
-    ConvertLineModelIntersectionsToSegmentDescriptor( lineIntersectionsWithModels );
+    self->ConvertLineModelIntersectionsToSegmentDescriptor( lineIntersectionsWithModels );
 
     int currentPixelIndex = 0;
-    int scanLineExtent[6] = {0, this->NumberOfSamplesPerScanline - 1, scanLineIndex, scanLineIndex, 0, 0};
-    unsigned char* dstPixelAddress = ( unsigned char* )scanLines->GetScalarPointerForExtent( scanLineExtent );
-    double incomingBeamIntensity = this->IncomingIntensityMwPerCm2 * 1000;
+    unsigned char* dstPixelAddress = str->ScanLinesPixelBuffer + scanLineIndex * numberOfSamplesPerScanline;
+    double incomingBeamIntensity = self->IncomingIntensityMwPerCm2 * 1000;
     int numIntersectionPoints = lineIntersectionsWithModels.size();
     if ( numIntersectionPoints < 1 )
     {
       LOG_ERROR( "No intersections with any SpatialObjects. Probably no background object is specified." );
-      return 0;
+      str->ThreadStatus[threadId] = PLUS_FAIL;
+      return VTK_THREAD_RETURN_VALUE;
     }
-    PlusSpatialModel* previousModel = &this->TransducerSpatialModel;
-    for( vtkIdType intersectionIndex = 0; ( intersectionIndex <= numIntersectionPoints ) && ( currentPixelIndex < this->NumberOfSamplesPerScanline ); intersectionIndex++ )
+    PlusSpatialModel* previousModel = &self->TransducerSpatialModel;
+    for( vtkIdType intersectionIndex = 0; ( intersectionIndex <= numIntersectionPoints ) && ( currentPixelIndex < numberOfSamplesPerScanline ); intersectionIndex++ )
     {
       // determine end of segment position and pixel color
       int endOfSegmentPixelIndex = currentPixelIndex;
@@ -256,16 +317,16 @@ int vtkPlusUsSimulatorAlgo::RequestData( vtkInformation* request, vtkInformation
       {
         distanceOfIntersectionPointFromScanLineStartPointMm = lineIntersectionsWithModels[intersectionIndex + 1].IntersectionDistanceFromStartPointMm;
         endOfSegmentPixelIndex = distanceOfIntersectionPointFromScanLineStartPointMm / distanceBetweenScanlineSamplePointsMm;
-        if ( endOfSegmentPixelIndex > this->NumberOfSamplesPerScanline )
+        if ( endOfSegmentPixelIndex > numberOfSamplesPerScanline )
         {
           // the next intersection point is out of the image
-          endOfSegmentPixelIndex = this->NumberOfSamplesPerScanline;
+          endOfSegmentPixelIndex = numberOfSamplesPerScanline;
         }
       }
       else
       {
         // last segment, after all the intersection points
-        endOfSegmentPixelIndex = this->NumberOfSamplesPerScanline;
+        endOfSegmentPixelIndex = numberOfSamplesPerScanline;
       }
 
       int numberOfFilledPixels = endOfSegmentPixelIndex - currentPixelIndex;
@@ -289,21 +350,27 @@ int vtkPlusUsSimulatorAlgo::RequestData( vtkInformation* request, vtkInformation
       currentModel->CalculateIntensity( intensities, numberOfFilledPixels, distanceBetweenScanlineSamplePointsMm, previousModel->GetAcousticImpedanceMegarayls(), incomingBeamIntensity, outgoingBeamIntensity, lineIntersectionsWithModels[intersectionIndex].IntersectionIncidenceAngleRad );
       previousModel = currentModel;
 
-      if ( this->NoiseAmplitude > 0 )
+      if ( self->NoiseAmplitude > 0 )
       {
         for ( int pixelIndex = 0; pixelIndex < numberOfFilledPixels; pixelIndex++ )
         {
-          samplePointPositions_Reference->GetPoint( currentPixelIndex + pixelIndex, samplePointPosition_Reference );
-          double noise = noiseFunction->EvaluateFunction( samplePointPosition_Reference );
+          // Sample points are evenly distributed between the scanline start and end points.
+          // Positions are rounded to float precision to get the same noise pattern as sampling with a vtkLineSource.
+          double samplePointRatio = ( numberOfSamplesPerScanline > 1 ) ? double( currentPixelIndex + pixelIndex ) / double( numberOfSamplesPerScanline - 1 ) : 0.0;
+          for ( int i = 0; i < 3; i++ )
+          {
+            samplePointPosition_Reference[i] = static_cast<float>( scanLineStartPoint_Reference[i] + samplePointRatio * ( scanLineEndPoint_Reference[i] - scanLineStartPoint_Reference[i] ) );
+          }
+          double noise = str->NoiseFunction->EvaluateFunction( samplePointPosition_Reference );
           // Noise is multiplicative: NoisySignal = signal + noise * (signal-SignalMean) = signal*(1+noise) - noise*SignalMean;
-          ( *dstPixelAddress++ ) = std::max( std::min( this->BrightnessConversionOffset + this->BrightnessConversionScale * fastPow( intensities[pixelIndex], this->BrightnessConversionGamma ) + noise, 255.0 ), 0.0 );
+          ( *dstPixelAddress++ ) = std::max( std::min( self->BrightnessConversionOffset + self->BrightnessConversionScale * fastPow( intensities[pixelIndex], self->BrightnessConversionGamma ) + noise, 255.0 ), 0.0 );
         }
       }
       else
       {
         for ( int pixelIndex = 0; pixelIndex < numberOfFilledPixels; pixelIndex++ )
         {
-          ( *dstPixelAddress++ ) = std::max( std::min( this->BrightnessConversionOffset + this->BrightnessConversionScale * fastPow( intensities[pixelIndex], this->BrightnessConversionGamma ), 255.0 ), 0.0 );
+          ( *dstPixelAddress++ ) = std::max( std::min( self->BrightnessConversionOffset + self->BrightnessConversionScale * fastPow( intensities[pixelIndex], self->BrightnessConversionGamma ), 255.0 ), 0.0 );
         }
       }
 
@@ -313,15 +380,7 @@ int vtkPlusUsSimulatorAlgo::RequestData( vtkInformation* request, vtkInformation
     }
   }
 
-  vtkImageData* simulatedUsImage = vtkImageData::SafeDownCast( outInfo->Get( vtkDataObject::DATA_OBJECT() ) );
-  if ( simulatedUsImage == NULL )
-  {
-    LOG_ERROR( "vtkPlusUsSimulatorAlgo output type is invalid" );
-    return 0;
-  }
-  this->RfProcessor->SetRfFrame( scanLines, US_IMG_BRIGHTNESS );
-  simulatedUsImage->DeepCopy( this->RfProcessor->GetBrightnessScanConvertedImage() );
-  return 1;
+  return VTK_THREAD_RETURN_VALUE;
 }
 
 bool lineIntersectionLessThan( PlusSpatialModel::LineIntersectionInfo a, PlusSpatialModel::LineIntersectionInfo b )
@@ -405,6 +464,7 @@ PlusStatus vtkPlusUsSimulatorAlgo::ReadConfiguration( vtkXMLDataElement* config
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL( double, NoiseAmplitude, usSimulatorAlgoElement );
   XML_READ_VECTOR_ATTRIBUTE_OPTIONAL( double, 3, NoiseFrequency, usSimulatorAlgoElement );
   XML_READ_VECTOR_ATTRIBUTE_OPTIONAL( double, 3, NoisePhase, usSimulatorAlgoElement );
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL( int, NumberOfThreads, usSimulatorAlgoElement );
   XML_READ_CSTRING_ATTRIBUTE_REQUIRED( ImageCoordinateFrame, usSimulatorAlgoElement );
   XML_READ_CSTRING_ATTRIBUTE_REQUIRED( ReferenceCoordinateFrame, usSimulatorAlgoElement );
 
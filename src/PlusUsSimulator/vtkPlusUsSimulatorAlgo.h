@@ -10,6 +10,7 @@
 #include "vtkPlusUsSimulatorExport.h"
 
 #include "vtkImageAlgorithm.h"
+#include "vtkMultiThreader.h"
 
 #include "PlusSpatialModel.h"
 #include "vtkPlusTransformRepository.h"
@@ -18,6 +19,7 @@ class vtkPolyDataNormals;
 class vtkTriangleFilter;
 class vtkStripper;
 class vtkModifiedBSPTree;
+class vtkPerlinNoise;
 class vtkPlusRfProcessor;
 
 /*!
@@ -89,6 +91,11 @@ public:
   vtkSetVector3Macro( NoiseFrequency, double );
   vtkSetVector3Macro( NoisePhase, double );
 
+  /*! Set the number of threads used for simulating the scanlines. If 0 then the default number of threads is used (typically the number of processor cores). */
+  vtkSetMacro( NumberOfThreads, int );
+  /*! Get the number of threads used for simulating the scanlines */
+  vtkGetMacro( NumberOfThreads, int );
+
 protected:
   virtual int FillOutputPortInformation( int port, vtkInformation* info );
   virtual int RequestData( vtkInformation* request,
@@ -97,6 +104,9 @@ protected:
 
   void ConvertLineModelIntersectionsToSegmentDescriptor( std::deque<PlusSpatialModel::LineIntersectionInfo>& lineIntersectionsWithModels );
 
+  /*! Thread function that simulates a subset of the scanlines */
+  static VTK_THREAD_RETURN_TYPE SimulateScanLinesThreadFunction( void* arg );
+
 protected:
   vtkPlusUsSimulatorAlgo();
   ~vtkPlusUsSimulatorAlgo();
@@ -146,6 +156,12 @@ private:
   double NoiseAmplitude;
   double NoiseFrequency[3];
   double NoisePhase[3];
+
+  /*! Multithreader for simulating the scanlines in parallel */
+  vtkMultiThreader* Threader;
+
+  /*! Number of threads used for simulating the scanlines. If 0 then the default number of threads is used. */
+  int NumberOfThreads;
 };
 
 #endif // __vtkPlusUsSimulatorAlgo_h
@@ -6,6 +6,7 @@
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusPerformanceStatistics.h"
 #include "PlusTrackedFrame.h"
 #include "vtkPlusFanAngleDetectorAlgo.h"
 #include "vtkPlusFillHolesInVolume.h"
@@ -42,6 +43,7 @@ vtkPlusVolumeReconstructor::vtkPlusVolumeReconstructor()
   , Reconstructor(vtkPlusPasteSliceIntoVolume::New())
   , HoleFiller(vtkPlusFillHolesInVolume::New())
   , FanAngleDetector(vtkPlusFanAngleDetectorAlgo::New())
+  , InsertSliceStatistics(PlusPerformanceStatistics::GetInstance()->GetHistogram("VolumeReconstructor.InsertSliceMs"))
   , FillHoles(false)
   , EnableFanAnglesAutoDetect(false)
   , SkipInterval(1)
@@ -519,7 +521,11 @@ PlusStatus vtkPlusVolumeReconstructor::AddTrackedFrame(PlusTrackedFrame* frame,
     return PLUS_SUCCESS;
   }
 
-  PlusStatus status = this->Reconstructor->InsertSlice(frameImage, imageToReferenceTransformMatrix);
+  PlusStatus status = PLUS_FAIL;
+  {
+    PlusPerformanceScopedTimer timer(this->InsertSliceStatistics);
+    status = this->Reconstructor->InsertSlice(frameImage, imageToReferenceTransformMatrix);
+  }
   this->Modified();
   return status;
 }
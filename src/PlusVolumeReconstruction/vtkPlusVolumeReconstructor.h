@@ -12,6 +12,7 @@
 #include "vtkPlusPasteSliceIntoVolume.h"
 #include "vtkImageAlgorithm.h"
 
+class PlusPerformanceHistogram;
 class PlusTrackedFrame;
 class vtkPlusFanAngleDetectorAlgo;
 class vtkPlusFillHolesInVolume;
@@ -216,6 +217,9 @@ protected:
   vtkPlusFillHolesInVolume* HoleFiller;
   vtkPlusFanAngleDetectorAlgo* FanAngleDetector;
 
+  /*! Duration of inserting a slice into the volume */
+  PlusPerformanceHistogram* InsertSliceStatistics;
+
   vtkSmartPointer<vtkImageData> ReconstructedVolume;
 
   /*! Defines the image coordinate system name: it corresponds to the 2D frame of the image data in the tracked frame */
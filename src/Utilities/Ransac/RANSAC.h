@@ -3,10 +3,12 @@
 
 #include <set>
 #include <vector>
+#include <algorithm>
 #include <stdlib.h>
 #include <math.h>
 #include <time.h>
 #include <limits>
+#include <vnl/vnl_random.h>
 #include "ParametersEstimator.h"
 #include "itkMultiThreader.h"
 #include "itkSimpleFastMutexLock.h"
@@ -25,6 +27,13 @@
  *    number of data objects.
  * 4. Take the largest subset of objects which agreed on the parameters and 
  *    compute a least squares fit using them.
+ *
+ * The hypotheses are shared between the threads, each thread draws its 
+ * subsets with its own random number generator (see SetRandomSeed()). 
+ * Verification of a hypothesis stops as soon as it cannot get a larger 
+ * consensus set than the best one found so far. Optionally, hypotheses are
+ * also rejected early using Wald's Sequential Probability Ratio Test (see 
+ * SetUseSPRT()).
  * 
  * This is based on:
  * Fischler M.A., Bolles R.C., 
@@ -34,6 +43,9 @@
  *
  * Hartely R., Zisserman A., "Multiple View Geometry in Computer Vision", 2001.
  *
+ * Chum O., Matas J., "Optimal Randomized RANSAC", IEEE Trans. on Pattern 
+ * Analysis and Machine Intelligence, Vol. 30(8), 2008.
+ *
  * The class template parameters are T - objects used for the parameter estimation 
  *                                      (e.g. Point2D in line estimation, 
  *                                            std::pair<Point2D,Point2D> in 
@@ -68,6 +80,44 @@ public:
   void SetNumberOfThreads( unsigned int numberOfThreads );
   unsigned int GetNumberOfThreads();
 
+  /**
+   * Set the seed of the random number generators used for selecting the 
+   * subsets. Every thread has its own generator, seeded with this value plus
+   * the index of the thread, so the result of Compute() is reproducible when
+   * a seed is set and a single thread is used. With multiple threads the
+   * sequence of subsets drawn by each thread is reproducible, but the order
+   * in which the threads find their consensus sets is not.
+   * If no seed is set (default) then the generators are seeded with the 
+   * current time in every Compute() call.
+   */
+  void SetRandomSeed( unsigned long seed );
+  void ClearRandomSeed();
+
+  /**
+   * Enable/disable the preemptive verification of hypotheses using Wald's 
+   * Sequential Probability Ratio Test (SPRT). The data objects are checked 
+   * in random order and a hypothesis is rejected as soon as the likelihood
+   * that it is a bad model is high enough, without checking the rest of the 
+   * data. The number of hypotheses is increased to compensate for the good
+   * models that are rejected this way. Disabled by default.
+   */
+  void SetUseSPRT( bool useSPRT );
+  bool GetUseSPRT();
+
+  /**
+   * Set the probabilities used by the SPRT verification.
+   * @param inlierProbability Initial estimate of the probability that a data
+   *                          object agrees with a good model (the fraction of
+   *                          inliers). During the computation it is replaced
+   *                          by the fraction of data agreeing with the best 
+   *                          model, when that is larger. Default is 0.1.
+   * @param randomAgreementProbability Probability that a data object agrees 
+   *                                   with a bad model, must be smaller than
+   *                                   inlierProbability. Default is 0.01.
+   */
+  void SetSPRTParameters( double inlierProbability, 
+                          double randomAgreementProbability );
+
   /**
    * Set the function object that is able to estimate the desired parametric 
    * entity (e.g. PlaneParametersEstimator).
@@ -107,7 +157,8 @@ protected:
 
   /**
    * Construct an instance of the RANSAC algorithm. The number of threads used 
-   * in the computation is 1, valid values are in [1, #cores].
+   * in the computation is 1, valid values are in [1, #cores]. No random seed
+   * is set and SPRT verification is disabled.
    * 
    */
   RANSAC();
@@ -124,45 +175,62 @@ private:
     */
   unsigned int Choose( unsigned int n, unsigned int m );
 
-  class SubSetIndexComparator {
-    private:
-      int length;
-    public:
-      SubSetIndexComparator(int arrayLength) : length(arrayLength){}
-      bool operator()(const int *arr1, const int *arr2) const {
-        for(int i=0; i<this->length; i++) {
-          if(arr1[i] < arr2[i])
-            return true;
-          else if(arr1[i] > arr2[i]) 
-            return false;
-        }
-        return false;      
-      }
-  };
-                   
+   /**
+    * Compute the number of hypotheses required for obtaining at least one 
+    * subset without outliers with the desired probability, given the 
+    * fraction of inliers. When SPRT verification is used the number is 
+    * increased to account for the good hypotheses that it rejects.
+    * The result is limited to the number of all possible subsets.
+    */
+  unsigned int ComputeNumberOfTries( double inlierRatio );
+
+   /**
+    * Compute the SPRT decision threshold for the current probabilities, 
+    * see Chum and Matas 2008.
+    */
+  void UpdateSPRTThreshold();
+
   static ITK_THREAD_RETURN_TYPE RANSACThreadCallback( void *arg );
 
                  //number of threads used in computing the RANSAC hypotheses
   unsigned int numberOfThreads;
 
+                 //seed of the random number generators, if set
+  unsigned long randomSeed;
+  bool randomSeedSet;
+
+                 //SPRT verification settings
+  bool useSPRT;
+  double sprtInlierProbability;
+  double sprtRandomAgreementProbability;
+
        //the following variables are shared by all threads used in the RANSAC
        //computation
 
-         //array corresponding to length of data array, data[i]== true if it 
+         //vector corresponding to length of data array, data[i]== true if it 
          //agrees with the best model, otherwise false
-  bool *bestVotes;
+  std::vector<bool> bestVotes;
   unsigned int numVotesForBest;
 
   std::vector<T> data;
 
-          //set which holds all of the subgroups/hypotheses already selected
-   std::set<int *, SubSetIndexComparator > *chosenSubSets;
+          //set which holds all of the subgroups/hypotheses already selected,
+          //each subset is stored as its sorted data indexes
+   std::set< std::vector<unsigned int> > chosenSubSets;
           //number of iterations, equivalent to desired number of hypotheses
    unsigned int numTries;
+          //number of hypotheses generated so far by all threads
+   unsigned int numHypotheses;
 
    double numerator;
    unsigned int allTries;
 
+          //seed used in the current computation
+   unsigned long computationSeed;
+          //current SPRT inlier probability and decision threshold
+   double sprtEpsilon;
+   double sprtThreshold;
+
    typename ParametersEstimator<T,S>::Pointer paramEstimator;
    itk::SimpleFastMutexLock hypothesisMutex;
    itk::SimpleFastMutexLock resultsMutex;
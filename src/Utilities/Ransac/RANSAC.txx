@@ -8,6 +8,19 @@ template<class T, class S>
 RANSAC<T,S>::RANSAC( )
 {
   this->numberOfThreads = 1;
+  this->randomSeed = 0;
+  this->randomSeedSet = false;
+  this->useSPRT = false;
+  this->sprtInlierProbability = 0.1;
+  this->sprtRandomAgreementProbability = 0.01;
+  this->numVotesForBest = 0;
+  this->numTries = 0;
+  this->numHypotheses = 0;
+  this->numerator = 0.0;
+  this->allTries = 0;
+  this->computationSeed = 0;
+  this->sprtEpsilon = this->sprtInlierProbability;
+  this->sprtThreshold = std::numeric_limits<double>::max();
 }
 
 
@@ -36,6 +49,50 @@ unsigned int RANSAC<T,S>::GetNumberOfThreads()
 }
 
 
+template<class T, class S>
+void RANSAC<T,S>::SetRandomSeed( unsigned long seed )
+{
+  this->randomSeed = seed;
+  this->randomSeedSet = true;
+}
+
+
+template<class T, class S>
+void RANSAC<T,S>::ClearRandomSeed()
+{
+  this->randomSeedSet = false;
+}
+
+
+template<class T, class S>
+void RANSAC<T,S>::SetUseSPRT( bool useSPRT )
+{
+  this->useSPRT = useSPRT;
+}
+
+
+template<class T, class S>
+bool RANSAC<T,S>::GetUseSPRT()
+{
+  return this->useSPRT;
+}
+
+
+template<class T, class S>
+void RANSAC<T,S>::SetSPRTParameters( double inlierProbability,
+                                     double randomAgreementProbability )
+{
+  if( inlierProbability<=0.0 || inlierProbability>=1.0 ||
+      randomAgreementProbability<=0.0 ||
+      randomAgreementProbability>=inlierProbability )
+     throw ExceptionObject(__FILE__,__LINE__,
+                           "Invalid setting for SPRT probabilities.");
+
+  this->sprtInlierProbability = inlierProbability;
+  this->sprtRandomAgreementProbability = randomAgreementProbability;
+}
+
+
 template<class T, class S>
 void RANSAC<T,S>::SetParametersEstimator( typename ParametersEstimator<T,S>::Pointer paramEstimator )
 {
@@ -81,21 +138,24 @@ double RANSAC<T,S>::Compute( std::vector<S> &parameters,
   unsigned int numForEstimate = this->paramEstimator->GetMinimalForEstimate();  
   size_t numDataObjects = this->data.size();
 
-  this->bestVotes = new bool[numDataObjects];
+  this->bestVotes.assign( numDataObjects, false );
                  //initalize with 0 so that the first computation which gives 
                 //any type of fit will be set to best
   this->numVotesForBest = 0;
 
-  SubSetIndexComparator subSetIndexComparator( numForEstimate );
-  this->chosenSubSets = 
-    new std::set<int *, SubSetIndexComparator >( subSetIndexComparator );
           //initialize with the number of all possible subsets
   this->allTries = Choose( numDataObjects, numForEstimate );
   this->numTries = this->allTries;
+  this->numHypotheses = 0;
   this->numerator = log( 1.0-desiredProbabilityForNoOutliers );
   
+  this->sprtEpsilon = this->sprtInlierProbability;
+  this->UpdateSPRTThreshold();
 
-  srand( (unsigned)time(NULL) ); //seed random number generator
+  if( this->randomSeedSet )
+    this->computationSeed = this->randomSeed;
+  else
+    this->computationSeed = (unsigned long)time(NULL);
 
                   //STEP2: create the threads that generate hypotheses and test
 
@@ -116,17 +176,8 @@ double RANSAC<T,S>::Compute( std::vector<S> &parameters,
     paramEstimator->LeastSquaresEstimate( leastSquaresEstimateData,parameters );
   }
                       //cleanup
-  typename std::set<int *, SubSetIndexComparator >::iterator it = 
-    this->chosenSubSets->begin();
-  typename std::set<int *, SubSetIndexComparator >::iterator chosenSubSetsEnd = 
-    this->chosenSubSets->end();
-  while( it!=chosenSubSetsEnd ) {
-    delete [] (*it);
-    it++;
-  }
-  this->chosenSubSets->clear();
-  delete this->chosenSubSets;
-  delete [] this->bestVotes;
+  this->chosenSubSets.clear();
+  this->bestVotes.clear();
 
   return (double)this->numVotesForBest/(double)numDataObjects;
 }
@@ -141,138 +192,208 @@ ITK_THREAD_RETURN_TYPE RANSAC<T,S>::RANSACThreadCallback( void *arg )
 
   if( caller != NULL )
   {
-    unsigned int maxIndex, numVotesForCur;
-    int *curSubSetIndexes(NULL);
+    unsigned int numVotesForCur, numVotesToBeat;
+    unsigned int m, l;
 
     unsigned int numDataObjects = caller->data.size();
     unsigned int numForEstimate = caller->paramEstimator->GetMinimalForEstimate();
-    std::vector<T *> exactEstimateData;
+    std::vector<T *> exactEstimateData( numForEstimate );
     std::vector<S> exactEstimateParameters;
-    double denominator;
+    std::vector<unsigned int> curSubSetIndexes( numForEstimate );
+
+    //each thread has its own generator, the global rand() is neither
+    //thread-safe nor reproducible
+    vnl_random random( caller->computationSeed + infoStruct->ThreadID );
     
     //true if data[i] agrees with the current model, otherwise false
-    bool *curVotes = new bool[numDataObjects];
-
-    //true if data[i] is NOT chosen for computing the exact fit, otherwise false
-    bool *notChosen = new bool[numDataObjects]; 
+    std::vector<bool> curVotes( numDataObjects );
 
-    for( unsigned int i = 0; i < caller->numTries; i++ )
+    //random permutation of the data indexes. The subsets are drawn by
+    //shuffling its beginning and the data is verified in its order, as the
+    //SPRT requires the data to be checked in random order
+    std::vector<unsigned int> dataIndexes( numDataObjects );
+    for( m = 0; m < numDataObjects; m++ )
+    {
+      dataIndexes[m] = m;
+    }
+    for( m = numDataObjects; m > 1; m-- )
     {
-      //randomly select data for exact model fit ('numForEstimate' objects).
-      std::fill( notChosen, notChosen+numDataObjects, true );      
-      curSubSetIndexes = new int[numForEstimate];
-      exactEstimateData.clear();
-      maxIndex = numDataObjects-1; 
+      std::swap( dataIndexes[m-1], dataIndexes[random.lrand32( 0, m-1 )] );
+    }
 
-      for( unsigned int l = 0; l < numForEstimate; l++ )
+    while( true )
+    {
+      //claim the next hypothesis and get the current state of the search
+      double sprtThreshold, sprtAgreeFactor, sprtDisagreeFactor;
+      caller->resultsMutex.Lock();
+      bool searchCompleted = caller->numHypotheses >= caller->numTries;
+      if( !searchCompleted )
       {
-        //selectedIndex is in [0,maxIndex]
-        int selectedIndex = (int)( ((float)rand() / (float)RAND_MAX) * maxIndex + 0.5);
-        unsigned int k(0);
-        int j(-1);
-        for( ; k < numDataObjects && j < selectedIndex; k++ )
-        {
-          if( notChosen[k] )
-          {
-            j++;
-          }
-        }
-        k--;
-        exactEstimateData.push_back( &(caller->data[k]) );
-        notChosen[k] = false;
-        maxIndex--;
+        caller->numHypotheses++;
+      }
+      numVotesToBeat = caller->numVotesForBest;
+      sprtThreshold = caller->sprtThreshold;
+      sprtAgreeFactor = caller->sprtRandomAgreementProbability / caller->sprtEpsilon;
+      sprtDisagreeFactor = ( 1.0 - caller->sprtRandomAgreementProbability ) /
+                           ( 1.0 - caller->sprtEpsilon );
+      caller->resultsMutex.Unlock();
+      if( searchCompleted )
+      {
+        break;
       }
       
-      //get the indexes of the chosen objects so we can check that 
-      //this sub-set hasn't been chosen already
-      unsigned int m(0);
-      unsigned int l(0);
-      for( ; m < numDataObjects; m++ )
+      //randomly select data for exact model fit ('numForEstimate' objects),
+      //partial Fisher-Yates shuffle so that only 'numForEstimate' random
+      //numbers are needed
+      for( l = 0; l < numForEstimate; l++ )
       {
-        if( !notChosen[m] )
-        {
-          curSubSetIndexes[l] = m + 1;
-          l++;
-        }
+        std::swap( dataIndexes[l], dataIndexes[random.lrand32( l, numDataObjects-1 )] );
+        curSubSetIndexes[l] = dataIndexes[l];
+        exactEstimateData[l] = &( caller->data[dataIndexes[l]] );
       }
 
-      std::pair< typename std::set<int *, SubSetIndexComparator >::iterator, bool> res;
-
-      caller->hypothesisMutex.Lock();
       //check that the sub-set just chosen is unique
-      res = caller->chosenSubSets->insert( curSubSetIndexes );
+      std::sort( curSubSetIndexes.begin(), curSubSetIndexes.end() );
+      caller->hypothesisMutex.Lock();
+      bool isNewSubSet = caller->chosenSubSets.insert( curSubSetIndexes ).second;
       caller->hypothesisMutex.Unlock();
+      if( !isNewSubSet )
+      {
+        continue;
+      }
+
+      //first time we chose this sub set
+      //use the selected data for an exact model parameter fit
+      caller->paramEstimator->Estimate( exactEstimateData,
+                                        exactEstimateParameters );
 
-      if(res.second == true)
+      //selected data is a singular configuration (e.g. three
+      //colinear points for a circle fit)
+      if( exactEstimateParameters.size() == 0 )
       {
-        //first time we chose this sub set        
-        //use the selected data for an exact model parameter fit
-        caller->paramEstimator->Estimate( exactEstimateData,
-                                          exactEstimateParameters );
-
-        //selected data is a singular configuration (e.g. three 
-        //colinear points for a circle fit)
-        if( exactEstimateParameters.size() == 0 )
+        continue;
+      }
+
+      //see how many agree on this estimate
+      numVotesForCur = 0;
+      std::fill( curVotes.begin(), curVotes.end(), false );
+      double likelihoodRatio = 1.0;
+      bool rejected = false;
+      for( m = 0; m < numDataObjects; m++ )
+      {
+        //no chance of getting a larger consensus set even if all the
+        //remaining data agrees
+        if( numVotesForCur + ( numDataObjects - m ) <= numVotesToBeat )
+        {
+          rejected = true;
+          break;
+        }
+        unsigned int dataIndex = dataIndexes[m];
+        if( caller->paramEstimator->Agree( exactEstimateParameters, caller->data[dataIndex] ) )
         {
-          continue;
+          curVotes[dataIndex] = true;
+          numVotesForCur++;
+          likelihoodRatio *= sprtAgreeFactor;
         }
+        else
+        {
+          likelihoodRatio *= sprtDisagreeFactor;
+        }
+        //more likely to be a bad model than a good one, stop the verification
+        if( caller->useSPRT && likelihoodRatio > sprtThreshold )
+        {
+          rejected = true;
+          break;
+        }
+      }
+      if( rejected )
+      {
+        continue;
+      }
 
-        //see how many agree on this estimate
-        numVotesForCur = 0;        
-        std::fill( curVotes, curVotes+numDataObjects, false );
+      //found a larger consensus set?
+      caller->resultsMutex.Lock();
+      if( numVotesForCur > caller->numVotesForBest )
+      {
+        caller->numVotesForBest = numVotesForCur;
+        caller->bestVotes = curVotes;
 
-        //continue checking data until there is no chance of getting a larger consensus set 
-        //or all the data has been checked              
-        for( m = 0; m < numDataObjects && caller->numVotesForBest-numVotesForCur < numDataObjects - m + 1; m++ )
+        //all data objects are inliers, terminate the search
+        if( caller->numVotesForBest == numDataObjects )
         {
-          if( caller->paramEstimator->Agree( exactEstimateParameters, caller->data[m] ) ) 
-          {
-            curVotes[m] = true;
-            numVotesForCur++;
-          }
-        } //found a larger consensus set?
-
-        caller->resultsMutex.Lock();
-        if( numVotesForCur > caller->numVotesForBest )
+          caller->numTries = caller->numHypotheses;
+        }
+        else
         {
-          caller->numVotesForBest = numVotesForCur;
-          for( unsigned int objIndex = 0; objIndex < numDataObjects; ++objIndex )
-          {
-            caller->bestVotes[objIndex] = curVotes[objIndex];
-          }
-          //std::copy( curVotes, curVotes+numDataObjects, caller->bestVotes );
-        
-          //all data objects are inliers, terminate the search
-          if( caller->numVotesForBest == numDataObjects )
+          //update the estimate of outliers and the number of iterations we need
+          double inlierRatio = (double)numVotesForCur/(double)numDataObjects;
+          if( caller->useSPRT && inlierRatio > caller->sprtEpsilon )
           {
-            i = caller->numTries;
-          }
-          else
-          {
-            //update the estimate of outliers and the number of iterations we need                                 
-            denominator = log( 1.0 - pow((double)numVotesForCur/(double)numDataObjects, 
-              (double)(numForEstimate)) );
-            caller->numTries = (int)( caller->numerator/denominator + 0.5 );
-
-            //there are cases when the probablistic number of tries is greater than all possible sub-sets
-            caller->numTries = caller->numTries<caller->allTries ? caller->numTries : caller->allTries;
+            caller->sprtEpsilon = inlierRatio;
+            caller->UpdateSPRTThreshold();
           }
+          caller->numTries = caller->ComputeNumberOfTries( inlierRatio );
         }
-        caller->resultsMutex.Unlock();
-
-      }
-      else
-      {
-        //this sub set already appeared, release memory
-        delete [] curSubSetIndexes;      
       }
+      caller->resultsMutex.Unlock();
     }
-    delete [] curVotes;
-    delete [] notChosen;
   }
   return ITK_THREAD_RETURN_VALUE;
 }
 
+
+template<class T, class S>
+unsigned int RANSAC<T,S>::ComputeNumberOfTries( double inlierRatio )
+{
+  double goodSubSetProbability =
+    pow( inlierRatio, (double)( this->paramEstimator->GetMinimalForEstimate() ) );
+           //probability that a good sub-set is not rejected by the SPRT
+  if( this->useSPRT )
+    goodSubSetProbability *= 1.0 - 1.0/this->sprtThreshold;
+
+  double denominator = log( 1.0 - goodSubSetProbability );
+           //good sub-sets are so unlikely that all sub-sets have to be tried
+  if( denominator >= 0.0 )
+    return this->allTries;
+
+  double tries = this->numerator/denominator + 0.5;
+           //there are cases when the probablistic number of tries is greater
+           //than all possible sub-sets
+  if( tries >= (double)this->allTries )
+    return this->allTries;
+  return (unsigned int)tries;
+}
+
+
+template<class T, class S>
+void RANSAC<T,S>::UpdateSPRTThreshold()
+{
+           //time of computing a model, in units of verifying a single data
+           //object, and the average number of models per sample. These only
+           //weakly affect the threshold, so typical values are used.
+  const double modelEstimationTime = 200.0;
+  const double modelsPerSample = 1.0;
+
+  double epsilon = this->sprtEpsilon;
+  double delta = this->sprtRandomAgreementProbability;
+  if( delta >= epsilon )
+  {
+    //SPRT can't tell good models from bad ones, never reject
+    this->sprtThreshold = std::numeric_limits<double>::max();
+    return;
+  }
+           //C = expected value of the log likelihood ratio of one data object
+           //for a bad model
+  double c = ( 1.0-delta )*log( ( 1.0-delta )/( 1.0-epsilon ) ) +
+             delta*log( delta/epsilon );
+           //A = timeM*C/modelsPerSample + 1 + log(A) has a solution A > 1,
+           //which is found by fixed point iteration
+  double a = modelEstimationTime*c/modelsPerSample + 1.0;
+  for( unsigned int i=0; i<10; i++ )
+    a = modelEstimationTime*c/modelsPerSample + 1.0 + log( a );
+  this->sprtThreshold = a;
+}
+
 /*****************************************************************************/
 
 template<class T, class S>
@@ -0,0 +1,292 @@
+#include <vector>
+#include <iostream>
+#include <itkPoint.h>
+#include "RandomNumberGenerator.h"
+#include "RANSAC.h"
+#include "PlaneParametersEstimator.h"
+#include "SphereParametersEstimator.h"
+
+const unsigned int DIMENSION = 3;
+typedef itk::Point<double, DIMENSION> PointType;
+typedef itk::RANSAC<PointType, double> RANSACType;
+
+/**
+ * Generate points on a plane with additive Gaussian noise, and outliers that
+ * are further than outlierDistance from the plane.
+ * @param planeParameters [n,a], plane normal and point on plane.
+ */
+void GeneratePlaneData( RandomNumberGenerator &random,
+                        unsigned int numInliers, unsigned int numOutliers,
+                        double outlierDistance,
+                        std::vector<PointType> &data,
+                        std::vector<double> &planeParameters );
+
+/**
+ * Generate points on a sphere with additive Gaussian noise, and outliers that
+ * are further than outlierDistance from the sphere.
+ * @param sphereParameters [c,r], sphere center and radius.
+ */
+void GenerateSphereData( RandomNumberGenerator &random,
+                         unsigned int numInliers, unsigned int numOutliers,
+                         double outlierDistance,
+                         std::vector<PointType> &data,
+                         std::vector<double> &sphereParameters );
+
+bool ComparePlanes( std::vector<double> &knownPlane,
+                    std::vector<double> &estimatedPlane,
+                    double maxDistance, std::ostream &out );
+
+bool CompareSpheres( std::vector<double> &knownSphere,
+                     std::vector<double> &estimatedSphere,
+                     double maxDistance, std::ostream &out );
+
+/**
+ * Run RANSAC with the given estimator on the data using all combinations of
+ * single/multiple threads and SPRT verification on/off. Every estimate is
+ * compared to the known parameters. Single threaded computations are
+ * repeated to check that they are reproducible with a fixed random seed.
+ */
+bool TestRANSAC( const std::string &title,
+                 itk::ParametersEstimator<PointType,double> *estimator,
+                 std::vector<PointType> &data,
+                 std::vector<double> &knownParameters,
+                 double minPercentageOfDataUsed,
+                 bool (*compare)( std::vector<double> &, std::vector<double> &,
+                                  double, std::ostream & ),
+                 double maxDistance,
+                 std::ostream &out );
+
+/*
+ * Test the RANSAC algorithm with the plane and sphere parameter estimators,
+ * using data of which a third are outliers.
+ */
+int main( int argc, char *argv[] )
+{
+  const unsigned int NUM_INLIERS = 100;
+  const unsigned int NUM_OUTLIERS = 50;
+  const double OUTLIER_DISTANCE = 20.0;
+  const double MAX_DISTANCE = 0.5;
+  const double MIN_PERCENTAGE_OF_DATA_USED =
+    0.9*NUM_INLIERS/(double)( NUM_INLIERS+NUM_OUTLIERS );
+
+              //fixed seed, so that a failure can be reproduced
+  RandomNumberGenerator random( 12345 );
+
+  std::vector<PointType> planeData;
+  std::vector<double> knownPlaneParameters;
+  GeneratePlaneData( random, NUM_INLIERS, NUM_OUTLIERS, OUTLIER_DISTANCE,
+                     planeData, knownPlaneParameters );
+  itk::PlaneParametersEstimator<DIMENSION>::Pointer planeEstimator =
+    itk::PlaneParametersEstimator<DIMENSION>::New();
+  planeEstimator->SetDelta( MAX_DISTANCE );
+  bool succeededPlane = TestRANSAC( "Plane", planeEstimator.GetPointer(),
+                                    planeData, knownPlaneParameters,
+                                    MIN_PERCENTAGE_OF_DATA_USED,
+                                    ComparePlanes, MAX_DISTANCE, std::cout );
+
+  std::vector<PointType> sphereData;
+  std::vector<double> knownSphereParameters;
+  GenerateSphereData( random, NUM_INLIERS, NUM_OUTLIERS, OUTLIER_DISTANCE,
+                      sphereData, knownSphereParameters );
+  itk::SphereParametersEstimator<DIMENSION>::Pointer sphereEstimator =
+    itk::SphereParametersEstimator<DIMENSION>::New();
+  sphereEstimator->SetDelta( MAX_DISTANCE );
+  bool succeededSphere = TestRANSAC( "Sphere", sphereEstimator.GetPointer(),
+                                     sphereData, knownSphereParameters,
+                                     MIN_PERCENTAGE_OF_DATA_USED,
+                                     CompareSpheres, MAX_DISTANCE, std::cout );
+
+  if( succeededPlane && succeededSphere )
+    return EXIT_SUCCESS;
+  return EXIT_FAILURE;
+}
+
+
+bool TestRANSAC( const std::string &title,
+                 itk::ParametersEstimator<PointType,double> *estimator,
+                 std::vector<PointType> &data,
+                 std::vector<double> &knownParameters,
+                 double minPercentageOfDataUsed,
+                 bool (*compare)( std::vector<double> &, std::vector<double> &,
+                                  double, std::ostream & ),
+                 double maxDistance,
+                 std::ostream &out )
+{
+  const double desiredProbabilityForNoOutliers = 0.999;
+  unsigned int maxNumberOfThreads =
+    itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+  unsigned int multipleThreads = maxNumberOfThreads < 4 ? maxNumberOfThreads : 4;
+  bool succeeded = true;
+
+  for( unsigned int configuration=0; configuration<4; configuration++ ) {
+    unsigned int numberOfThreads = ( configuration & 1 ) ? multipleThreads : 1;
+    bool useSPRT = ( configuration & 2 ) != 0;
+
+    RANSACType::Pointer ransacEstimator = RANSACType::New();
+    ransacEstimator->SetData( data );
+    ransacEstimator->SetParametersEstimator( estimator );
+    ransacEstimator->SetNumberOfThreads( numberOfThreads );
+    ransacEstimator->SetUseSPRT( useSPRT );
+    ransacEstimator->SetRandomSeed( 42 );
+
+    std::vector<double> parameters;
+    double percentageOfDataUsed =
+      ransacEstimator->Compute( parameters, desiredProbabilityForNoOutliers );
+
+    out<<title<<" RANSAC estimate, threads: "<<numberOfThreads;
+    out<<", SPRT: "<<( useSPRT ? "on" : "off" )<<"\n";
+    if( parameters.empty() ) {
+      out<<"\tFAILED, degenerate configuration?\n\n";
+      succeeded = false;
+      continue;
+    }
+    out<<"\tPercentage of data used: "<<percentageOfDataUsed<<"\n";
+    if( percentageOfDataUsed < minPercentageOfDataUsed ) {
+      out<<"\tFAILED, expected at least "<<minPercentageOfDataUsed<<"\n";
+      succeeded = false;
+    }
+    if( !compare( knownParameters, parameters, maxDistance, out ) )
+      succeeded = false;
+
+    if( numberOfThreads == 1 ) {
+      std::vector<double> repeatedParameters;
+      ransacEstimator->Compute( repeatedParameters, desiredProbabilityForNoOutliers );
+      if( repeatedParameters != parameters ) {
+        out<<"\tFAILED, repeated computation with the same seed gave a different result\n";
+        succeeded = false;
+      }
+    }
+    out<<"\n";
+  }
+  return succeeded;
+}
+
+
+bool ComparePlanes( std::vector<double> &knownPlane,
+                    std::vector<double> &estimatedPlane,
+                    double maxDistance, std::ostream &out )
+{
+  unsigned int i;
+  double dotProduct = 0.0;
+  for( i=0; i<DIMENSION; i++ )
+    dotProduct+= estimatedPlane[i]*knownPlane[i];
+  out<<"\tDot product of known and computed plane normals[+-1=correct]: ";
+  out<<dotProduct<<"\n";
+  double distance = 0.0;
+  for( i=0; i<DIMENSION; i++ )
+    distance+= ( estimatedPlane[DIMENSION+i] - knownPlane[DIMENSION+i] )*knownPlane[i];
+  out<<"\tTest if computed point is on known plane [0=correct]: "<<distance<<"\n";
+                   //angle between normals is less than 5 degrees
+  return fabs( dotProduct ) > 0.99619469809174553229501040247389 &&
+         fabs( distance ) < maxDistance;
+}
+
+
+bool CompareSpheres( std::vector<double> &knownSphere,
+                     std::vector<double> &estimatedSphere,
+                     double maxDistance, std::ostream &out )
+{
+  itk::Vector<double, DIMENSION> tmp;
+  for( unsigned int i=0; i<DIMENSION; i++ )
+    tmp[i] = estimatedSphere[i] - knownSphere[i];
+  double radiusDifference = fabs( estimatedSphere[DIMENSION] - knownSphere[DIMENSION] );
+  out<<"\tDistance between estimated and known sphere centers [0=correct]: ";
+  out<<tmp.GetNorm()<<"\n";
+  out<<"\tDifference between estimated and known sphere radius [0=correct]: ";
+  out<<radiusDifference<<"\n";
+  return tmp.GetNorm() < maxDistance && radiusDifference < maxDistance;
+}
+
+
+void GeneratePlaneData( RandomNumberGenerator &random,
+                        unsigned int numInliers, unsigned int numOutliers,
+                        double outlierDistance,
+                        std::vector<PointType> &data,
+                        std::vector<double> &planeParameters )
+{
+  itk::Vector<double, DIMENSION> normal, noise, tmp;
+  PointType pointOnPlane, randomPoint;
+  double noiseStandardDeviation = 0.1;
+  double coordinateMax = 100.0;
+  unsigned int i, j;
+
+  planeParameters.clear();
+         //generate points on random plane
+  for( i=0; i<DIMENSION; i++ ) {
+    normal[i] = random.uniform();
+    pointOnPlane[i] = random.uniform( -coordinateMax, coordinateMax );
+  }
+  normal.Normalize();
+  for( i=0; i<DIMENSION; i++ )
+    planeParameters.push_back( normal[i] );
+  for( i=0; i<DIMENSION; i++ )
+    planeParameters.push_back( pointOnPlane[i] );
+
+               //generate inliers
+  for( i=0; i<numInliers; i++ ) {
+    for( j=0; j<DIMENSION; j++ ) {
+      randomPoint[j] = random.uniform( -coordinateMax, coordinateMax );
+      noise[j] = random.normal( noiseStandardDeviation );
+    }
+            //project random point onto the plane and add noise
+    tmp = randomPoint - pointOnPlane;
+    randomPoint = pointOnPlane + noise + (tmp - (tmp*normal)*normal);
+    data.push_back( randomPoint );
+  }
+           //generate outliers (via rejection)
+  for( i=0; i<numOutliers; i++ ) {
+    for( j=0; j<DIMENSION; j++ ) {
+      randomPoint[j] = random.uniform( -coordinateMax, coordinateMax );
+    }
+    tmp = randomPoint - pointOnPlane;
+    if( fabs(tmp*normal)>= outlierDistance )
+      data.push_back( randomPoint );
+    else
+      i--;
+  }
+}
+
+
+void GenerateSphereData( RandomNumberGenerator &random,
+                         unsigned int numInliers, unsigned int numOutliers,
+                         double outlierDistance,
+                         std::vector<PointType> &data,
+                         std::vector<double> &sphereParameters )
+{
+  itk::Vector<double, DIMENSION> direction;
+  PointType center, randomPoint;
+  double noiseStandardDeviation = 0.1;
+  double coordinateMax = 100.0;
+  double minRadius = 20.0;
+  unsigned int i, j;
+
+  sphereParameters.clear();
+         //generate random sphere
+  for( i=0; i<DIMENSION; i++ ) {
+    center[i] = random.uniform( -coordinateMax, coordinateMax );
+    sphereParameters.push_back( center[i] );
+  }
+  double radius = random.uniform( minRadius, coordinateMax );
+  sphereParameters.push_back( radius );
+
+               //generate inliers, random directions from the center
+  for( i=0; i<numInliers; i++ ) {
+    for( j=0; j<DIMENSION; j++ )
+      direction[j] = random.normal();
+    direction.Normalize();
+    for( j=0; j<DIMENSION; j++ )
+      randomPoint[j] = center[j] + radius*direction[j] +
+                       random.normal( noiseStandardDeviation );
+    data.push_back( randomPoint );
+  }
+           //generate outliers (via rejection)
+  for( i=0; i<numOutliers; i++ ) {
+    for( j=0; j<DIMENSION; j++ )
+      randomPoint[j] = center[j] +
+                       random.uniform( -2.0*radius, 2.0*radius );
+    if( fabs( randomPoint.EuclideanDistanceTo( center ) - radius ) >= outlierDistance )
+      data.push_back( randomPoint );
+    else
+      i--;
+  }
+}